@@ -0,0 +1,119 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+#
+# Load test for the GetTile request of the QGIS map server.
+#
+# Requests all tiles of a tile matrix range with a number of concurrent
+# clients and reports the throughput in tiles/s. Run it twice to compare
+# cold (rendering) and warm (disk cache) performance, e.g.
+#
+#   mapserver_tile_loadtest.py -u http://localhost/cgi-bin/qgis_mapserv.fcgi \
+#     -m /data/project.qgs -l roads,buildings -z 10 -b 540,356,547,362 -t 8
+#
+# (C) 2012 by the Quantum GIS Project
+#
+#   This program is free software; you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation; either version 2 of the License, or
+#   (at your option) any later version.
+
+import sys
+import threading
+import time
+from optparse import OptionParser
+
+try:
+  from urllib2 import urlopen
+  from urllib import urlencode
+  from Queue import Queue, Empty
+except ImportError:
+  from urllib.request import urlopen
+  from urllib.parse import urlencode
+  from queue import Queue, Empty
+
+
+def worker( queue, results, lock ):
+  while True:
+    try:
+      url = queue.get_nowait()
+    except Empty:
+      return
+
+    start = time.time()
+    ok = True
+    size = 0
+    try:
+      response = urlopen( url )
+      data = response.read()
+      size = len( data )
+      ok = response.info().get( 'Content-Type', '' ).startswith( 'image/' )
+    except Exception:
+      ok = False
+    elapsed = time.time() - start
+
+    lock.acquire()
+    results.append( ( ok, elapsed, size ) )
+    lock.release()
+
+
+def main():
+  parser = OptionParser( usage="%prog [options]" )
+  parser.add_option( "-u", "--url", dest="url", help="map server url" )
+  parser.add_option( "-m", "--map", dest="map", default="", help="project file (MAP parameter)" )
+  parser.add_option( "-l", "--layers", dest="layers", help="comma separated layer names" )
+  parser.add_option( "-s", "--styles", dest="styles", default="", help="comma separated style names" )
+  parser.add_option( "-g", "--grid", dest="grid", default="EPSG:3857", help="tile matrix set [default: %default]" )
+  parser.add_option( "-f", "--format", dest="format", default="image/png", help="tile format [default: %default]" )
+  parser.add_option( "-z", "--zoom", dest="zoom", type="int", default=10, help="tile matrix [default: %default]" )
+  parser.add_option( "-b", "--bounds", dest="bounds", default="0,0,7,7",
+                     help="tile range mincol,minrow,maxcol,maxrow [default: %default]" )
+  parser.add_option( "-t", "--threads", dest="threads", type="int", default=4, help="concurrent clients [default: %default]" )
+  parser.add_option( "-r", "--repeat", dest="repeat", type="int", default=1, help="request every tile n times [default: %default]" )
+  ( options, args ) = parser.parse_args()
+
+  if not options.url or not options.layers:
+    parser.error( "url and layers are required" )
+
+  minCol, minRow, maxCol, maxRow = [int( v ) for v in options.bounds.split( "," )]
+
+  queue = Queue()
+  for i in range( options.repeat ):
+    for row in range( minRow, maxRow + 1 ):
+      for col in range( minCol, maxCol + 1 ):
+        params = { "SERVICE": "WMTS", "REQUEST": "GetTile", "LAYERS": options.layers, "STYLES": options.styles,
+                   "FORMAT": options.format, "TILEMATRIXSET": options.grid, "TILEMATRIX": options.zoom,
+                   "TILEROW": row, "TILECOL": col }
+        if options.map:
+          params["MAP"] = options.map
+        queue.put( options.url + "?" + urlencode( params ) )
+  total = queue.qsize()
+
+  results = []
+  lock = threading.Lock()
+  threads = [threading.Thread( target=worker, args=( queue, results, lock ) ) for i in range( options.threads )]
+
+  start = time.time()
+  for t in threads:
+    t.start()
+  for t in threads:
+    t.join()
+  elapsed = time.time() - start
+
+  failed = len( [r for r in results if not r[0]] )
+  times = sorted( [r[1] for r in results] )
+  size = sum( [r[2] for r in results] )
+
+  print( "tiles:        %d (%d failed)" % ( total, failed ) )
+  print( "clients:      %d" % options.threads )
+  print( "elapsed:      %.2f s" % elapsed )
+  print( "throughput:   %.1f tiles/s" % ( total / elapsed ) )
+  print( "transferred:  %.1f kB" % ( size / 1024.0 ) )
+  if times:
+    print( "latency:      min %.1f ms, median %.1f ms, 95%% %.1f ms, max %.1f ms" %
+           ( times[0] * 1000, times[len( times ) // 2] * 1000, times[int( len( times ) * 0.95 )] * 1000, times[-1] * 1000 ) )
+
+  return 1 if failed else 0
+
+
+if __name__ == "__main__":
+  sys.exit( main() )
@@ -17,8 +17,116 @@
 
 #include "qgsgridfilewriter.h"
 #include "qgsinterpolator.h"
+#include "qgslogger.h"
+#include "cpl_string.h"
+#include "gdal.h"
 #include <QFile>
+#include <QFuture>
 #include <QProgressDialog>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
+
+//number of cells of a band of rows interpolated by a thread
+static const int BAND_CELLS = 1 << 14;
+
+static const double NODATA_VALUE = -9999;
+
+//band of rows of the grid
+struct QgsGridFileBand
+{
+  QgsInterpolator* interpolator;
+  int firstRow;
+  int nRows; //0 if the band is not used
+  int nCols;
+  //x of the first cell center in each row and y of the cell centers in each grid row
+  double xFirstCell;
+  const double* yRows;
+  double cellSizeX;
+  //nRows rows of nCols values, NODATA_VALUE if the interpolation failed
+  QVector<double> values;
+  //true if the values are formatted as ascii grid lines into text
+  bool formatText;
+  QString text;
+  //true if the band could not be written
+  bool writeFailed;
+};
+
+static void interpolateGridBand( QgsGridFileBand& band )
+{
+  double currentXValue;
+  double interpolatedValue;
+
+  for ( int i = 0; i < band.nRows; ++i )
+  {
+    double currentYValue = band.yRows[band.firstRow + i];
+    double* values = band.values.data() + i * band.nCols;
+    currentXValue = band.xFirstCell;
+    for ( int j = 0; j < band.nCols; ++j )
+    {
+      if ( band.interpolator->interpolatePoint( currentXValue, currentYValue, interpolatedValue ) == 0 )
+      {
+        values[j] = interpolatedValue;
+      }
+      else
+      {
+        values[j] = NODATA_VALUE;
+      }
+      currentXValue += band.cellSizeX;
+    }
+  }
+
+  if ( band.formatText )
+  {
+    band.text.truncate( 0 );
+    QTextStream outStream( &band.text );
+    outStream.setRealNumberPrecision( 8 );
+    const double* values = band.values.constData();
+    for ( int i = 0; i < band.nRows; ++i )
+    {
+      for ( int j = 0; j < band.nCols; ++j )
+      {
+        outStream << *values++ << " ";
+      }
+      outStream << endl;
+    }
+  }
+}
+
+static void writeGridBands( QTextStream* outStream, GDALRasterBandH rasterBand, QVector<QgsGridFileBand>* bands )
+{
+  for ( int i = 0; i < bands->size(); ++i )
+  {
+    QgsGridFileBand& band = ( *bands )[i];
+    if ( band.nRows == 0 )
+    {
+      continue;
+    }
+    if ( outStream )
+    {
+      *outStream << band.text;
+      band.writeFailed = outStream->status() != QTextStream::Ok;
+    }
+    else
+    {
+      band.writeFailed = GDALRasterIO( rasterBand, GF_Write, 0, band.firstRow, band.nCols, band.nRows, band.values.data(),
+                                       band.nCols, band.nRows, GDT_Float64, 0, 0 ) != CE_None;
+    }
+  }
+}
+
+static bool gridBandsWriteFailed( const QVector<QgsGridFileBand>& bands )
+{
+  for ( int i = 0; i < bands.size(); ++i )
+  {
+    if ( bands[i].writeFailed )
+    {
+      return true;
+    }
+  }
+  return false;
+}
 
 QgsGridFileWriter::QgsGridFileWriter( QgsInterpolator* i, QString outputPath, QgsRectangle extent, int nCols, int nRows , double cellSizeX, double cellSizeY )
     : mInterpolator( i ), mOutputFilePath( outputPath ), mInterpolationExtent( extent ), mNumColumns( nCols ), mNumRows( nRows )
@@ -40,25 +148,90 @@ QgsGridFileWriter::~QgsGridFileWriter()
 int QgsGridFileWriter::writeFile( bool showProgressDialog )
 {
   QFile outputFile( mOutputFilePath );
+  GDALDriverH outputDriver = 0;
+  GDALDatasetH outputDataset = 0;
+  GDALRasterBandH outputRasterBand = 0;
 
-  if ( !outputFile.open( QFile::WriteOnly ) )
+  if ( mOutputFormat.isEmpty() )
   {
-    return 1;
-  }
+    if ( !outputFile.open( QFile::WriteOnly ) )
+    {
+      return 1;
+    }
 
-  if ( !mInterpolator )
+    if ( !mInterpolator )
+    {
+      outputFile.remove();
+      return 2;
+    }
+  }
+  else
   {
-    outputFile.remove();
-    return 2;
+    if ( !mInterpolator )
+    {
+      return 2;
+    }
+
+    GDALAllRegister();
+    outputDriver = GDALGetDriverByName( mOutputFormat.toLocal8Bit().data() );
+    if ( !outputDriver || !CSLFetchBoolean( GDALGetMetadata( outputDriver, NULL ), GDAL_DCAP_CREATE, false ) )
+    {
+      return 1;
+    }
+    outputDataset = GDALCreate( outputDriver, mOutputFilePath.toLocal8Bit().data(), mNumColumns, mNumRows, 1, GDT_Float32, NULL );
+    if ( !outputDataset )
+    {
+      return 1;
+    }
+    double geotransform[6] = { mInterpolationExtent.xMinimum(), mCellSizeX, 0, mInterpolationExtent.yMaximum(), 0, -mCellSizeY };
+    GDALSetGeoTransform( outputDataset, geotransform );
+    outputRasterBand = GDALGetRasterBand( outputDataset, 1 );
+    GDALSetRasterNoDataValue( outputRasterBand, NODATA_VALUE );
   }
 
   QTextStream outStream( &outputFile );
-  outStream.setRealNumberPrecision( 8 );
-  writeHeader( outStream );
+  QTextStream* textStream = 0;
+  if ( !outputDataset )
+  {
+    outStream.setRealNumberPrecision( 8 );
+    writeHeader( outStream );
+    textStream = &outStream;
+  }
 
-  double currentYValue = mInterpolationExtent.yMaximum() - mCellSizeY / 2.0; //calculate value in the center of the cell
-  double currentXValue;
-  double interpolatedValue;
+  //calculate value in the center of the cell
+  QVector<double> yRows( mNumRows );
+  double currentYValue = mInterpolationExtent.yMaximum() - mCellSizeY / 2.0;
+  for ( int i = 0; i < mNumRows; ++i )
+  {
+    yRows[i] = currentYValue;
+    currentYValue -= mCellSizeY;
+  }
+
+  //the grid is interpolated in bands of rows, one band per thread if the interpolator
+  //can be called concurrently. The next bands are interpolated while the last ones are written
+  bool concurrent = mInterpolator->prepareInterpolation();
+  int nThreads = concurrent ? qMax( 1, QThread::idealThreadCount() ) : 1;
+  int bandRows = qMax( 1, BAND_CELLS / qMax( 1, mNumColumns ) );
+
+  QVector<QgsGridFileBand> bands[2];
+  for ( int i = 0; i < 2; ++i )
+  {
+    bands[i].resize( nThreads );
+    for ( int j = 0; j < nThreads; ++j )
+    {
+      QgsGridFileBand& band = bands[i][j];
+      band.interpolator = mInterpolator;
+      band.firstRow = 0;
+      band.nRows = 0;
+      band.nCols = mNumColumns;
+      band.xFirstCell = mInterpolationExtent.xMinimum() + mCellSizeX / 2.0;
+      band.yRows = yRows.constData();
+      band.cellSizeX = mCellSizeX;
+      band.values.resize( mNumColumns * bandRows );
+      band.formatText = ( textStream != 0 );
+      band.writeFailed = false;
+    }
+  }
 
   QProgressDialog* progressDialog = 0;
   if ( showProgressDialog )
@@ -67,37 +240,80 @@ int QgsGridFileWriter::writeFile( bool showProgressDialog )
     progressDialog->setWindowModality( Qt::WindowModal );
   }
 
-  for ( int i = 0; i < mNumRows; ++i )
+  QFuture<void> writing;
+  bool canceled = false;
+  bool writeFailed = false;
+  int row = 0;
+  for ( int batch = 0; row < mNumRows; ++batch )
   {
-    currentXValue = mInterpolationExtent.xMinimum() + mCellSizeX / 2.0; //calculate value in the center of the cell
-    for ( int j = 0; j < mNumColumns; ++j )
+    QVector<QgsGridFileBand>& batchBands = bands[batch % 2];
+    for ( int i = 0; i < nThreads; ++i )
     {
-      if ( mInterpolator->interpolatePoint( currentXValue, currentYValue, interpolatedValue ) == 0 )
-      {
-        outStream << interpolatedValue << " ";
-      }
-      else
-      {
-        outStream << "-9999 ";
-      }
-      currentXValue += mCellSizeX;
+      QgsGridFileBand& band = batchBands[i];
+      band.firstRow = row;
+      band.nRows = qMin( bandRows, mNumRows - row );
+      band.writeFailed = false;
+      row += band.nRows;
     }
-    outStream << endl;
-    currentYValue -= mCellSizeY;
+
+    if ( concurrent )
+    {
+      QtConcurrent::blockingMap( batchBands, interpolateGridBand );
+    }
+    else
+    {
+      interpolateGridBand( batchBands[0] );
+    }
+
+    //the bands of the last batch have to be written before the ones of this batch
+    writing.waitForFinished();
+    if ( gridBandsWriteFailed( bands[( batch + 1 ) % 2] ) )
+    {
+      writeFailed = true;
+      break;
+    }
+    writing = QtConcurrent::run( writeGridBands, textStream, outputRasterBand, &batchBands );
 
     if ( showProgressDialog )
     {
       if ( progressDialog->wasCanceled() )
       {
-        outputFile.remove();
-        return 3;
+        canceled = true;
+        break;
       }
-      progressDialog->setValue( i );
+      progressDialog->setValue( row );
     }
   }
-
+  writing.waitForFinished();
   delete progressDialog;
-  return 0;
+  //the flags of the bands written before were checked in the loop
+  writeFailed = writeFailed || gridBandsWriteFailed( bands[0] ) || gridBandsWriteFailed( bands[1] );
+
+  //a canceled or incomplete output is deleted
+  if ( outputDataset )
+  {
+    GDALClose( outputDataset );
+    if ( canceled || writeFailed )
+    {
+      GDALDeleteDataset( outputDriver, mOutputFilePath.toLocal8Bit().data() );
+    }
+  }
+  else
+  {
+    outStream.flush();
+    writeFailed = writeFailed || outStream.status() != QTextStream::Ok;
+    if ( canceled || writeFailed )
+    {
+      outputFile.remove();
+    }
+  }
+
+  if ( writeFailed )
+  {
+    QgsDebugMsg( "could not write the grid to " + mOutputFilePath );
+    return 4;
+  }
+  return canceled ? 3 : 0;
 }
 
 int QgsGridFileWriter::writeHeader( QTextStream& outStream )
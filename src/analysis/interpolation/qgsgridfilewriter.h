@@ -24,8 +24,8 @@
 
 class QgsInterpolator;
 
-/**A class that does interpolation to a grid and writes the results to an ascii grid*/
-//todo: extend such that writing to other file types is possible
+/**A class that does interpolation to a grid and writes the results to an ascii grid
+  or to a raster file of a GDAL driver*/
 class ANALYSIS_EXPORT QgsGridFileWriter
 {
   public:
@@ -34,10 +34,18 @@ class ANALYSIS_EXPORT QgsGridFileWriter
 
     /**Writes the grid file.
      @param showProgressDialog shows a dialog with the possibility to cancel
-    @return 0 in case of success*/
+    @return 0 in case of success, 1 if the output file cannot be created, 2 if there is no interpolator,
+    3 if the interpolation was canceled and 4 if the grid could not be written. The output file is
+    deleted in the last two cases*/
 
     int writeFile( bool showProgressDialog = false );
 
+    /**Sets the GDAL driver (e.g. "GTiff") of the output file. The values are written as 32 bit floats
+      with -9999 as nodata value. An empty string (the default) writes an ascii grid
+      @note added in 1.9*/
+    void setOutputFormat( const QString& driverName ) {mOutputFormat = driverName;}
+    QString outputFormat() const {return mOutputFormat;}
+
   private:
 
     QgsGridFileWriter(); //forbidden
@@ -51,6 +59,9 @@ class ANALYSIS_EXPORT QgsGridFileWriter
 
     double mCellSizeX;
     double mCellSizeY;
+
+    /**GDAL driver name of the output file, empty for an ascii grid*/
+    QString mOutputFormat;
 };
 
 #endif
@@ -16,15 +16,48 @@
  ***************************************************************************/
 
 #include "qgsidwinterpolator.h"
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
+/**Weights above this integer distance coefficient are calculated with pow*/
+static const int MAX_INTEGER_COEFFICIENT = 16;
+
+/**Compares indices into the base data by the x or y coordinate of the vertices*/
+struct QgsIDWVertexLess
+{
+  const vertexData* data;
+  bool byX;
+  bool operator()( int a, int b ) const
+  {
+    return byX ? data[a].x < data[b].x : data[a].y < data[b].y;
+  }
+};
+
+/**Inverse distance weight. Integer coefficients are multiplied out from the squared distance
+  (only odd ones need a square root) instead of calling pow*/
+static inline double inverseDistanceWeight( double squaredDistance, double coefficient, int integerCoefficient )
+{
+  if ( integerCoefficient > 0 )
+  {
+    double denominator = ( integerCoefficient % 2 ) ? sqrt( squaredDistance ) : 1.0;
+    for ( int i = 1; i < integerCoefficient; i += 2 )
+    {
+      denominator *= squaredDistance;
+    }
+    return 1 / denominator;
+  }
+  return 1 / ( pow( sqrt( squaredDistance ), coefficient ) );
+}
+
 QgsIDWInterpolator::QgsIDWInterpolator( const QList<LayerData>& layerData ): QgsInterpolator( layerData ), mDistanceCoefficient( 2.0 )
+    , mMaxPoints( 0 ), mSearchRadius( 0 ), mIndexIsBuilt( false )
 {
 
 }
 
 QgsIDWInterpolator::QgsIDWInterpolator(): QgsInterpolator( QList<LayerData>() ), mDistanceCoefficient( 2.0 )
+    , mMaxPoints( 0 ), mSearchRadius( 0 ), mIndexIsBuilt( false )
 {
 
 }
@@ -34,6 +67,19 @@ QgsIDWInterpolator::~QgsIDWInterpolator()
 
 }
 
+bool QgsIDWInterpolator::prepareInterpolation()
+{
+  if ( !mDataIsCached )
+  {
+    cacheBaseData();
+  }
+  if ( !mIndexIsBuilt && ( mMaxPoints > 0 || mSearchRadius > 0 ) )
+  {
+    buildIndex();
+  }
+  return true;
+}
+
 int QgsIDWInterpolator::interpolatePoint( double x, double y, double& result )
 {
   if ( !mDataIsCached )
@@ -41,25 +87,67 @@ int QgsIDWInterpolator::interpolatePoint( double x, double y, double& result )
     cacheBaseData();
   }
 
+  int integerCoefficient = 0;
+  if ( mDistanceCoefficient > 0 && mDistanceCoefficient <= MAX_INTEGER_COEFFICIENT && floor( mDistanceCoefficient ) == mDistanceCoefficient )
+  {
+    integerCoefficient = ( int ) mDistanceCoefficient;
+  }
+
+  double squaredDistance;
   double currentWeight;
-  double distance;
 
   double sumCounter = 0;
   double sumDenominator = 0;
 
-  QVector<vertexData>::iterator vertex_it = mCachedBaseData.begin();
+  if ( mMaxPoints <= 0 && mSearchRadius <= 0 )
+  {
+    QVector<vertexData>::const_iterator vertex_it = mCachedBaseData.constBegin();
 
-  for ( ; vertex_it != mCachedBaseData.end(); ++vertex_it )
+    for ( ; vertex_it != mCachedBaseData.constEnd(); ++vertex_it )
+    {
+      squaredDistance = ( vertex_it->x - x ) * ( vertex_it->x - x ) + ( vertex_it->y - y ) * ( vertex_it->y - y );
+      if ( squaredDistance == 0 )
+      {
+        result = vertex_it->z;
+        return 0;
+      }
+      currentWeight = inverseDistanceWeight( squaredDistance, mDistanceCoefficient, integerCoefficient );
+      sumCounter += ( currentWeight * vertex_it->z );
+      sumDenominator += currentWeight;
+    }
+  }
+  else
   {
-    distance = sqrt(( vertex_it->x - x ) * ( vertex_it->x - x ) + ( vertex_it->y - y ) * ( vertex_it->y - y ) );
-    if (( distance - 0 ) < std::numeric_limits<double>::min() )
+    if ( !mIndexIsBuilt )
     {
-      result = vertex_it->z;
+      buildIndex();
+    }
+
+    NeighbourList neighbours;
+    double maxSquaredDistance = mSearchRadius > 0 ? mSearchRadius * mSearchRadius : std::numeric_limits<double>::max();
+    searchIndex( 0, mIndex.size(), 0, x, y, neighbours, maxSquaredDistance );
+
+    //like the unlimited search, take the value of the first vertex at the location
+    int vertexAtLocation = -1;
+    for ( int i = 0; i < neighbours.size(); ++i )
+    {
+      if ( neighbours[i].squaredDistance == 0 && ( vertexAtLocation < 0 || neighbours[i].index < vertexAtLocation ) )
+      {
+        vertexAtLocation = neighbours[i].index;
+      }
+    }
+    if ( vertexAtLocation >= 0 )
+    {
+      result = mCachedBaseData[vertexAtLocation].z;
       return 0;
     }
-    currentWeight = 1 / ( pow( distance, mDistanceCoefficient ) );
-    sumCounter += ( currentWeight * vertex_it->z );
-    sumDenominator += currentWeight;
+
+    for ( int i = 0; i < neighbours.size(); ++i )
+    {
+      currentWeight = inverseDistanceWeight( neighbours[i].squaredDistance, mDistanceCoefficient, integerCoefficient );
+      sumCounter += ( currentWeight * mCachedBaseData[neighbours[i].index].z );
+      sumDenominator += currentWeight;
+    }
   }
 
   if ( sumDenominator == 0.0 )
@@ -70,3 +158,92 @@ int QgsIDWInterpolator::interpolatePoint( double x, double y, double& result )
   result = sumCounter / sumDenominator;
   return 0;
 }
+
+void QgsIDWInterpolator::buildIndex()
+{
+  mIndex.resize( mCachedBaseData.size() );
+  for ( int i = 0; i < mIndex.size(); ++i )
+  {
+    mIndex[i] = i;
+  }
+  buildIndex( 0, mIndex.size(), 0 );
+  mIndexIsBuilt = true;
+}
+
+void QgsIDWInterpolator::buildIndex( int begin, int end, int depth )
+{
+  if ( end - begin < 2 )
+  {
+    return;
+  }
+
+  int middle = ( begin + end ) / 2;
+  QgsIDWVertexLess less;
+  less.data = mCachedBaseData.constData();
+  less.byX = ( depth % 2 == 0 );
+  int* indices = mIndex.data();
+  std::nth_element( indices + begin, indices + middle, indices + end, less );
+
+  buildIndex( begin, middle, depth + 1 );
+  buildIndex( middle + 1, end, depth + 1 );
+}
+
+void QgsIDWInterpolator::searchIndex( int begin, int end, int depth, double x, double y, NeighbourList& neighbours, double& maxSquaredDistance ) const
+{
+  if ( begin >= end )
+  {
+    return;
+  }
+
+  int middle = ( begin + end ) / 2;
+  const vertexData& vertex = mCachedBaseData.at( mIndex.at( middle ) );
+  double dx = x - vertex.x;
+  double dy = y - vertex.y;
+
+  Neighbour neighbour;
+  neighbour.squaredDistance = dx * dx + dy * dy;
+  neighbour.index = mIndex.at( middle );
+  if ( neighbour.squaredDistance <= maxSquaredDistance )
+  {
+    if ( mMaxPoints <= 0 )
+    {
+      neighbours.append( neighbour );
+    }
+    else if ( neighbours.size() < mMaxPoints )
+    {
+      neighbours.append( neighbour );
+      std::push_heap( neighbours.data(), neighbours.data() + neighbours.size() );
+      if ( neighbours.size() == mMaxPoints )
+      {
+        maxSquaredDistance = neighbours[0].squaredDistance;
+      }
+    }
+    else if ( neighbour.squaredDistance < maxSquaredDistance )
+    {
+      //replace the farthest point
+      std::pop_heap( neighbours.data(), neighbours.data() + neighbours.size() );
+      neighbours[neighbours.size() - 1] = neighbour;
+      std::push_heap( neighbours.data(), neighbours.data() + neighbours.size() );
+      maxSquaredDistance = neighbours[0].squaredDistance;
+    }
+  }
+
+  //search the side of the location first, the other one only if it can hold closer points
+  double splitDistance = ( depth % 2 == 0 ) ? dx : dy;
+  if ( splitDistance < 0 )
+  {
+    searchIndex( begin, middle, depth + 1, x, y, neighbours, maxSquaredDistance );
+    if ( splitDistance * splitDistance <= maxSquaredDistance )
+    {
+      searchIndex( middle + 1, end, depth + 1, x, y, neighbours, maxSquaredDistance );
+    }
+  }
+  else
+  {
+    searchIndex( middle + 1, end, depth + 1, x, y, neighbours, maxSquaredDistance );
+    if ( splitDistance * splitDistance <= maxSquaredDistance )
+    {
+      searchIndex( begin, middle, depth + 1, x, y, neighbours, maxSquaredDistance );
+    }
+  }
+}
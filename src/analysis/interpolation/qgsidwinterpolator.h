@@ -19,6 +19,7 @@
 #define QGSIDWINTERPOLATOR_H
 
 #include "qgsinterpolator.h"
+#include <QVarLengthArray>
 
 class ANALYSIS_EXPORT QgsIDWInterpolator: public QgsInterpolator
 {
@@ -33,16 +34,58 @@ class ANALYSIS_EXPORT QgsIDWInterpolator: public QgsInterpolator
        @return 0 in case of success*/
     int interpolatePoint( double x, double y, double& result );
 
+    /**Caches the base data and builds the point index. Afterwards interpolatePoint
+       may be called from several threads as long as the settings are not changed
+       @note added in 1.9*/
+    bool prepareInterpolation();
+
     void setDistanceCoefficient( double p ) {mDistanceCoefficient = p;}
 
+    /**Sets the number of nearest points used for a value. 0 (the default) uses all points
+       @note added in 1.9*/
+    void setMaxPoints( int n ) {mMaxPoints = n;}
+    int maxPoints() const {return mMaxPoints;}
+
+    /**Sets the distance within which points are used for a value. 0 (the default) means no limit.
+       Locations without points within the radius get no value
+       @note added in 1.9*/
+    void setSearchRadius( double r ) {mSearchRadius = r;}
+    double searchRadius() const {return mSearchRadius;}
+
   private:
 
+    /**A point found in the index*/
+    struct Neighbour
+    {
+      double squaredDistance;
+      int index;
+      bool operator<( const Neighbour& other ) const { return squaredDistance < other.squaredDistance; }
+    };
+    typedef QVarLengthArray<Neighbour, 32> NeighbourList;
+
     QgsIDWInterpolator(); //forbidden
 
+    /**Sorts mIndex into a k-d tree*/
+    void buildIndex();
+    void buildIndex( int begin, int end, int depth );
+    /**Adds the points of the index range within sqrt(maxSquaredDistance) of x/y to neighbours.
+      If mMaxPoints is set, neighbours is a max heap of the nearest points and maxSquaredDistance
+      shrinks to the distance of the farthest one as soon as the heap is full*/
+    void searchIndex( int begin, int end, int depth, double x, double y, NeighbourList& neighbours, double& maxSquaredDistance ) const;
+
     /**The parameter that sets how the values are weighted with distance.
        Smaller values mean sharper peaks at the data points. The default is a
        value of 2*/
     double mDistanceCoefficient;
+    /**Number of nearest points to use, 0 for all*/
+    int mMaxPoints;
+    /**Distance within which points are used, 0 for no limit*/
+    double mSearchRadius;
+
+    /**Indices into mCachedBaseData forming a k-d tree: the middle element of each range
+      splits it by x (even depth) or y (odd depth)*/
+    QVector<int> mIndex;
+    bool mIndexIsBuilt;
 };
 
 #endif
@@ -64,6 +64,12 @@ class ANALYSIS_EXPORT QgsInterpolator
        @return 0 in case of success*/
     virtual int interpolatePoint( double x, double y, double& result ) = 0;
 
+    /**Does the work interpolatePoint would do lazily on the first call (e.g. caching the base data)
+       so that interpolatePoint can be called from several threads at the same time afterwards.
+       @return true if the interpolator supports concurrent calls of interpolatePoint
+       @note added in 1.9*/
+    virtual bool prepareInterpolation() { return false; }
+
     /**Use a vector attribute as interpolation value*/
     void enableAttributeValueInterpolation( int attribute );
 
@@ -0,0 +1,100 @@
+/***************************************************************************
+  qgscompactgraph.cpp
+  --------------------------------------
+  Date                 : 2012-03-20
+  Copyright            : (C) 2012 by the Quantum GIS Project
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+/**
+ * \file qgscompactgraph.cpp
+ * \brief implementation of QgsCompactGraph
+ */
+
+#include "qgscompactgraph.h"
+#include "qgsgraph.h"
+
+QgsCompactGraph::QgsCompactGraph( const QgsGraph* graph )
+{
+  int vertexCount = graph->vertexCount();
+  int arcCount = graph->arcCount();
+
+  mX.resize( vertexCount );
+  mY.resize( vertexCount );
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    QgsPoint pt = graph->vertex( i ).point();
+    mX[ i ] = pt.x();
+    mY[ i ] = pt.y();
+  }
+
+  int criterionCount = 0;
+  mArcOut.resize( arcCount );
+  mArcIn.resize( arcCount );
+  mOutOffsets.fill( 0, vertexCount + 1 );
+  mInOffsets.fill( 0, vertexCount + 1 );
+  for ( int i = 0; i < arcCount; ++i )
+  {
+    const QgsGraphArc& arc = graph->arc( i );
+    mArcOut[ i ] = arc.outVertex();
+    mArcIn[ i ] = arc.inVertex();
+    ++mOutOffsets[ arc.outVertex() + 1 ];
+    ++mInOffsets[ arc.inVertex() + 1 ];
+    criterionCount = qMax( criterionCount, arc.properties().size() );
+  }
+
+  // counts to offsets
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    mOutOffsets[ i + 1 ] += mOutOffsets[ i ];
+    mInOffsets[ i + 1 ] += mInOffsets[ i ];
+  }
+
+  mOutHeads.resize( arcCount );
+  mOutArcIds.resize( arcCount );
+  mInTails.resize( arcCount );
+  mInArcIds.resize( arcCount );
+  mArcOutPos.resize( arcCount );
+  mOutCosts.resize( criterionCount );
+  mInCosts.resize( criterionCount );
+  for ( int c = 0; c < criterionCount; ++c )
+  {
+    mOutCosts[ c ].fill( 0.0, arcCount );
+    mInCosts[ c ].fill( 0.0, arcCount );
+  }
+
+  // arcs keep their order of the source graph within a vertex
+  QVector<int> outFill = mOutOffsets;
+  QVector<int> inFill = mInOffsets;
+  for ( int i = 0; i < arcCount; ++i )
+  {
+    const QgsGraphArc& arc = graph->arc( i );
+    int outPos = outFill[ arc.outVertex()]++;
+    int inPos = inFill[ arc.inVertex()]++;
+
+    mOutHeads[ outPos ] = arc.inVertex();
+    mOutArcIds[ outPos ] = i;
+    mInTails[ inPos ] = arc.outVertex();
+    mInArcIds[ inPos ] = i;
+    mArcOutPos[ i ] = outPos;
+
+    QVector<QVariant> properties = arc.properties();
+    for ( int c = 0; c < properties.size(); ++c )
+    {
+      double cost = properties[ c ].toDouble();
+      mOutCosts[ c ][ outPos ] = cost;
+      mInCosts[ c ][ inPos ] = cost;
+    }
+  }
+}
+
+double QgsCompactGraph::arcCost( int criterionNum, int arcId ) const
+{
+  return mOutCosts[ criterionNum ][ mArcOutPos[ arcId ] ];
+}
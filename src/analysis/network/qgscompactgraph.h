@@ -0,0 +1,119 @@
+/***************************************************************************
+  qgscompactgraph.h
+  --------------------------------------
+  Date                 : 2012-03-20
+  Copyright            : (C) 2012 by the Quantum GIS Project
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+/*
+ * This file describes a read-only, compact form of QgsGraph for fast routing.
+ *
+ * \file qgscompactgraph.h
+ */
+
+#ifndef QGSCOMPACTGRAPHH
+#define QGSCOMPACTGRAPHH
+
+// QT4 includes
+#include <QVector>
+
+// QGIS includes
+#include "qgspoint.h"
+
+class QgsGraph;
+
+/**
+ * \ingroup networkanalysis
+ * \class QgsCompactGraph
+ * \brief Frozen copy of a QgsGraph in compressed sparse row form
+ *
+ * The outgoing (and incoming) arcs of every vertex are stored contiguously and
+ * all arc properties are converted to plain double cost arrays, one per criterion.
+ * Arcs of vertex v are found at the positions outBegin( v ) ... outEnd( v ) - 1.
+ * Arc ids returned by outArcId() / inArcId() are the arc indexes of the source graph.
+ * @note added in 1.9
+ */
+class ANALYSIS_EXPORT QgsCompactGraph
+{
+  public:
+    /**
+     * build the compact graph. Arc properties that can not be converted to double are stored as 0.0
+     */
+    QgsCompactGraph( const QgsGraph* graph );
+
+    /**
+     * return vertex count
+     */
+    int vertexCount() const { return mX.size(); }
+
+    /**
+     * return arc count
+     */
+    int arcCount() const { return mArcOut.size(); }
+
+    /**
+     * return count of cost criteria (arc properties)
+     */
+    int criterionCount() const { return mOutCosts.size(); }
+
+    /**
+     * return vertex point
+     */
+    QgsPoint point( int vertexIdx ) const { return QgsPoint( mX[ vertexIdx ], mY[ vertexIdx ] ); }
+
+    double x( int vertexIdx ) const { return mX[ vertexIdx ]; }
+    double y( int vertexIdx ) const { return mY[ vertexIdx ]; }
+
+    // outgoing arcs
+    int outBegin( int vertexIdx ) const { return mOutOffsets[ vertexIdx ]; }
+    int outEnd( int vertexIdx ) const { return mOutOffsets[ vertexIdx + 1 ]; }
+    //! vertex the outgoing arc at position pos leads to
+    int outHead( int pos ) const { return mOutHeads[ pos ]; }
+    int outArcId( int pos ) const { return mOutArcIds[ pos ]; }
+    double outCost( int criterionNum, int pos ) const { return mOutCosts[ criterionNum ][ pos ]; }
+
+    // incoming arcs
+    int inBegin( int vertexIdx ) const { return mInOffsets[ vertexIdx ]; }
+    int inEnd( int vertexIdx ) const { return mInOffsets[ vertexIdx + 1 ]; }
+    //! vertex the incoming arc at position pos comes from
+    int inTail( int pos ) const { return mInTails[ pos ]; }
+    int inArcId( int pos ) const { return mInArcIds[ pos ]; }
+    double inCost( int criterionNum, int pos ) const { return mInCosts[ criterionNum ][ pos ]; }
+
+    // arcs by id
+    int arcOutVertex( int arcId ) const { return mArcOut[ arcId ]; }
+    int arcInVertex( int arcId ) const { return mArcIn[ arcId ]; }
+
+    /**
+     * return the cost of an arc given by id
+     */
+    double arcCost( int criterionNum, int arcId ) const;
+
+  private:
+    QVector<double> mX;
+    QVector<double> mY;
+
+    QVector<int> mArcOut;
+    QVector<int> mArcIn;
+    //! position of every arc in the outgoing arc arrays
+    QVector<int> mArcOutPos;
+
+    QVector<int> mOutOffsets;
+    QVector<int> mOutHeads;
+    QVector<int> mOutArcIds;
+    QVector< QVector<double> > mOutCosts;
+
+    QVector<int> mInOffsets;
+    QVector<int> mInTails;
+    QVector<int> mInArcIds;
+    QVector< QVector<double> > mInCosts;
+};
+
+#endif //QGSCOMPACTGRAPHH
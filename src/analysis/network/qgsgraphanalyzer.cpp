@@ -16,6 +16,7 @@
  ***************************************************************************/
 // C++ standard includes
 #include <limits>
+#include <cmath>
 
 // QT includes
 #include <QMap>
@@ -24,8 +25,119 @@
 
 //QGIS-uncludes
 #include "qgsgraph.h"
+#include "qgscompactgraph.h"
 #include "qgsgraphanalyzer.h"
 
+/**
+ * Binary min-heap of vertices with decrease-key. The heap position of
+ * every vertex is kept in an index array.
+ */
+class QgsGraphAnalyzerHeap
+{
+  public:
+    QgsGraphAnalyzerHeap( int vertexCount )
+        : mPos( vertexCount, -1 )
+    {
+    }
+
+    bool isEmpty() const
+    {
+      return mHeap.isEmpty();
+    }
+
+    double topKey() const
+    {
+      return mHeap.first().key;
+    }
+
+    /**
+     * insert a vertex or decrease its key
+     */
+    void push( int vertexIdx, double key )
+    {
+      int pos = mPos[ vertexIdx ];
+      if ( pos == -1 )
+      {
+        pos = mHeap.size();
+        mHeap.append( Entry( key, vertexIdx ) );
+        mPos[ vertexIdx ] = pos;
+      }
+      else
+      {
+        mHeap[ pos ].key = key;
+      }
+      siftUp( pos );
+    }
+
+    /**
+     * remove the vertex with the smallest key and return it
+     */
+    int pop()
+    {
+      int vertexIdx = mHeap.first().vertex;
+      mPos[ vertexIdx ] = -1;
+
+      Entry last = mHeap.last();
+      mHeap.pop_back();
+      if ( !mHeap.isEmpty() )
+      {
+        mHeap[ 0 ] = last;
+        mPos[ last.vertex ] = 0;
+        siftDown( 0 );
+      }
+      return vertexIdx;
+    }
+
+  private:
+    struct Entry
+    {
+      Entry() : key( 0.0 ), vertex( -1 ) {}
+      Entry( double k, int v ) : key( k ), vertex( v ) {}
+      double key;
+      int vertex;
+    };
+
+    void siftUp( int pos )
+    {
+      Entry e = mHeap[ pos ];
+      while ( pos > 0 )
+      {
+        int parent = ( pos - 1 ) / 2;
+        if ( mHeap[ parent ].key <= e.key )
+          break;
+        mHeap[ pos ] = mHeap[ parent ];
+        mPos[ mHeap[ pos ].vertex ] = pos;
+        pos = parent;
+      }
+      mHeap[ pos ] = e;
+      mPos[ e.vertex ] = pos;
+    }
+
+    void siftDown( int pos )
+    {
+      Entry e = mHeap[ pos ];
+      int size = mHeap.size();
+      for ( ;; )
+      {
+        int child = 2 * pos + 1;
+        if ( child >= size )
+          break;
+        if ( child + 1 < size && mHeap[ child + 1 ].key < mHeap[ child ].key )
+          ++child;
+        if ( e.key <= mHeap[ child ].key )
+          break;
+        mHeap[ pos ] = mHeap[ child ];
+        mPos[ mHeap[ pos ].vertex ] = pos;
+        pos = child;
+      }
+      mHeap[ pos ] = e;
+      mPos[ e.vertex ] = pos;
+    }
+
+    QVector<Entry> mHeap;
+    QVector<int> mPos;
+};
+
 void QgsGraphAnalyzer::dijkstra( const QgsGraph* source, int startPointIdx, int criterionNum, QVector<int>* resultTree, QVector<double>* resultCost )
 {
   QVector< double > * result = NULL;
@@ -122,3 +234,219 @@ QgsGraph* QgsGraphAnalyzer::shortestTree( const QgsGraph* source, int startVerte
 
   return treeResult;
 }
+
+void QgsGraphAnalyzer::dijkstra( const QgsCompactGraph* source, int startVertexIdx, int criterionNum, QVector<int>* resultTree, QVector<double>* resultCost )
+{
+  const double inf = std::numeric_limits<double>::infinity();
+  int vertexCount = source->vertexCount();
+
+  QVector<double> cost( vertexCount, inf );
+  QVector<int> tree;
+  if ( resultTree != NULL )
+  {
+    tree.fill( -1, vertexCount );
+  }
+
+  QgsGraphAnalyzerHeap heap( vertexCount );
+  cost[ startVertexIdx ] = 0.0;
+  heap.push( startVertexIdx, 0.0 );
+
+  while ( !heap.isEmpty() )
+  {
+    int curVertex = heap.pop();
+    double curCost = cost[ curVertex ];
+
+    int end = source->outEnd( curVertex );
+    for ( int pos = source->outBegin( curVertex ); pos < end; ++pos )
+    {
+      int v = source->outHead( pos );
+      double c = curCost + source->outCost( criterionNum, pos );
+      if ( c < cost[ v ] )
+      {
+        cost[ v ] = c;
+        if ( resultTree != NULL )
+        {
+          tree[ v ] = source->outArcId( pos );
+        }
+        heap.push( v, c );
+      }
+    }
+  }
+
+  if ( resultCost != NULL )
+  {
+    *resultCost = cost;
+  }
+  if ( resultTree != NULL )
+  {
+    *resultTree = tree;
+  }
+}
+
+double QgsGraphAnalyzer::shortestPath( const QgsCompactGraph* source, int startVertexIdx, int stopVertexIdx, int criterionNum, QList<int>* resultPath )
+{
+  const double inf = std::numeric_limits<double>::infinity();
+  int vertexCount = source->vertexCount();
+
+  if ( resultPath != NULL )
+  {
+    resultPath->clear();
+  }
+  if ( startVertexIdx < 0 || startVertexIdx >= vertexCount || stopVertexIdx < 0 || stopVertexIdx >= vertexCount )
+  {
+    return inf;
+  }
+  if ( startVertexIdx == stopVertexIdx )
+  {
+    return 0.0;
+  }
+
+  // forward search from the start vertex over outgoing arcs,
+  // backward search from the stop vertex over incoming arcs
+  QVector<double> costF( vertexCount, inf );
+  QVector<double> costB( vertexCount, inf );
+  QVector<int> arcF( vertexCount, -1 );
+  QVector<int> arcB( vertexCount, -1 );
+  QgsGraphAnalyzerHeap heapF( vertexCount );
+  QgsGraphAnalyzerHeap heapB( vertexCount );
+
+  costF[ startVertexIdx ] = 0.0;
+  costB[ stopVertexIdx ] = 0.0;
+  heapF.push( startVertexIdx, 0.0 );
+  heapB.push( stopVertexIdx, 0.0 );
+
+  double best = inf;
+  int meetVertex = -1;
+
+  while ( !heapF.isEmpty() && !heapB.isEmpty() )
+  {
+    // no shorter path can be found any more
+    if ( heapF.topKey() + heapB.topKey() >= best )
+      break;
+
+    if ( heapF.topKey() <= heapB.topKey() )
+    {
+      int curVertex = heapF.pop();
+      double curCost = costF[ curVertex ];
+      int end = source->outEnd( curVertex );
+      for ( int pos = source->outBegin( curVertex ); pos < end; ++pos )
+      {
+        int v = source->outHead( pos );
+        double c = curCost + source->outCost( criterionNum, pos );
+        if ( c < costF[ v ] )
+        {
+          costF[ v ] = c;
+          arcF[ v ] = source->outArcId( pos );
+          heapF.push( v, c );
+        }
+        if ( costF[ v ] + costB[ v ] < best )
+        {
+          best = costF[ v ] + costB[ v ];
+          meetVertex = v;
+        }
+      }
+    }
+    else
+    {
+      int curVertex = heapB.pop();
+      double curCost = costB[ curVertex ];
+      int end = source->inEnd( curVertex );
+      for ( int pos = source->inBegin( curVertex ); pos < end; ++pos )
+      {
+        int v = source->inTail( pos );
+        double c = curCost + source->inCost( criterionNum, pos );
+        if ( c < costB[ v ] )
+        {
+          costB[ v ] = c;
+          arcB[ v ] = source->inArcId( pos );
+          heapB.push( v, c );
+        }
+        if ( costF[ v ] + costB[ v ] < best )
+        {
+          best = costF[ v ] + costB[ v ];
+          meetVertex = v;
+        }
+      }
+    }
+  }
+
+  if ( meetVertex != -1 && resultPath != NULL )
+  {
+    int v = meetVertex;
+    while ( v != startVertexIdx )
+    {
+      resultPath->prepend( arcF[ v ] );
+      v = source->arcOutVertex( arcF[ v ] );
+    }
+    v = meetVertex;
+    while ( v != stopVertexIdx )
+    {
+      resultPath->append( arcB[ v ] );
+      v = source->arcInVertex( arcB[ v ] );
+    }
+  }
+
+  return best;
+}
+
+double QgsGraphAnalyzer::shortestPathAStar( const QgsCompactGraph* source, int startVertexIdx, int stopVertexIdx, int criterionNum,
+    double costPerDistance, QList<int>* resultPath )
+{
+  const double inf = std::numeric_limits<double>::infinity();
+  int vertexCount = source->vertexCount();
+
+  if ( resultPath != NULL )
+  {
+    resultPath->clear();
+  }
+  if ( startVertexIdx < 0 || startVertexIdx >= vertexCount || stopVertexIdx < 0 || stopVertexIdx >= vertexCount )
+  {
+    return inf;
+  }
+
+  double stopX = source->x( stopVertexIdx );
+  double stopY = source->y( stopVertexIdx );
+
+  QVector<double> cost( vertexCount, inf );
+  QVector<int> tree( vertexCount, -1 );
+  QgsGraphAnalyzerHeap heap( vertexCount );
+
+  cost[ startVertexIdx ] = 0.0;
+  heap.push( startVertexIdx, 0.0 );
+
+  while ( !heap.isEmpty() )
+  {
+    int curVertex = heap.pop();
+    if ( curVertex == stopVertexIdx )
+      break;
+
+    double curCost = cost[ curVertex ];
+    int end = source->outEnd( curVertex );
+    for ( int pos = source->outBegin( curVertex ); pos < end; ++pos )
+    {
+      int v = source->outHead( pos );
+      double c = curCost + source->outCost( criterionNum, pos );
+      if ( c < cost[ v ] )
+      {
+        cost[ v ] = c;
+        tree[ v ] = source->outArcId( pos );
+
+        double dx = source->x( v ) - stopX;
+        double dy = source->y( v ) - stopY;
+        heap.push( v, c + costPerDistance * sqrt( dx * dx + dy * dy ) );
+      }
+    }
+  }
+
+  if ( cost[ stopVertexIdx ] < inf && resultPath != NULL )
+  {
+    int v = stopVertexIdx;
+    while ( v != startVertexIdx )
+    {
+      resultPath->prepend( tree[ v ] );
+      v = source->arcOutVertex( tree[ v ] );
+    }
+  }
+
+  return cost[ stopVertexIdx ];
+}
@@ -19,10 +19,12 @@
 #define QGSGRAPHANALYZERH
 
 //QT-includes
+#include <QList>
 #include <QVector>
 
 // forward-declaration
 class QgsGraph;
+class QgsCompactGraph;
 
 /** \ingroup networkanalysis
  * The QGis class provides graph analysis functions
@@ -48,5 +50,45 @@ class ANALYSIS_EXPORT QgsGraphAnalyzer
      * @param criterionNum index of edge property as optimization criterion
      */
     static QgsGraph* shortestTree( const QgsGraph* source, int startVertexIdx, int criterionNum );
+
+    /**
+     * solve shortest path problem using dijkstra algorithm with an indexed binary heap.
+     * Much faster than the QgsGraph version on large graphs.
+     * @param source The source graph
+     * @param startVertexIdx index of start vertex
+     * @param criterionNum index of arc property as optimization criterion
+     * @param treeResult array represents the shortest path tree. resultTree[ vertexIndex ] == inboundingArcIndex if vertex reacheble and resultTree[ vertexIndex ] == -1 others.
+     * @param resultCost array of cost paths
+     * @note added in 1.9
+     */
+    static void dijkstra( const QgsCompactGraph* source, int startVertexIdx, int criterionNum, QVector<int>* resultTree = NULL, QVector<double>* resultCost = NULL );
+
+    /**
+     * find the shortest path between two vertices using bidirectional dijkstra algorithm
+     * @param source The source graph
+     * @param startVertexIdx index of start vertex
+     * @param stopVertexIdx index of stop vertex
+     * @param criterionNum index of arc property as optimization criterion
+     * @param resultPath receives the arc indexes of the path, from start to stop vertex
+     * @return cost of the path or infinity if stop vertex is not reachable or a vertex index is out of range
+     * @note added in 1.9
+     */
+    static double shortestPath( const QgsCompactGraph* source, int startVertexIdx, int stopVertexIdx, int criterionNum, QList<int>* resultPath = NULL );
+
+    /**
+     * find the shortest path between two vertices using A* algorithm with an euclidean distance heuristic.
+     * The result is optimal only if no arc costs less than its euclidean length multiplied by costPerDistance
+     * (e.g. 1.0 for a distance criterion in layer units, the inverse of the maximal speed for a time criterion).
+     * @param source The source graph
+     * @param startVertexIdx index of start vertex
+     * @param stopVertexIdx index of stop vertex
+     * @param criterionNum index of arc property as optimization criterion
+     * @param costPerDistance lower bound of the cost per unit of euclidean distance
+     * @param resultPath receives the arc indexes of the path, from start to stop vertex
+     * @return cost of the path or infinity if stop vertex is not reachable or a vertex index is out of range
+     * @note added in 1.9
+     */
+    static double shortestPathAStar( const QgsCompactGraph* source, int startVertexIdx, int stopVertexIdx, int criterionNum,
+                                     double costPerDistance, QList<int>* resultPath = NULL );
 };
 #endif //QGSGRAPHANALYZERH
@@ -48,3 +48,7 @@ float QgsAspectFilter::processNineCellWindow(
   }
 }
 
+void QgsAspectFilter::processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells )
+{
+  processNineCellRowWith( this, rowAbove, row, rowBelow, result, nCells );
+}
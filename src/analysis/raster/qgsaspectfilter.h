@@ -33,6 +33,9 @@ class ANALYSIS_EXPORT QgsAspectFilter: public QgsDerivativeFilter
                                  float* x12, float* x22, float* x32,
                                  float* x13, float* x23, float* x33 );
 
+    /**Calculates a row with processNineCellWindow of this class*/
+    void processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells );
+
 };
 
 #endif // QGSASPECTFILTER_H
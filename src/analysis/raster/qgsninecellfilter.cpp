@@ -17,7 +17,12 @@
 
 #include "qgsninecellfilter.h"
 #include "cpl_string.h"
+#include <QFuture>
 #include <QProgressDialog>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
 
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
 #define TO8(x) (x).toUtf8().constData()
@@ -25,6 +30,82 @@
 #define TO8(x) (x).toLocal8Bit().constData()
 #endif
 
+//number of cells of a strip processed by a thread
+static const int TILE_CELLS = 1 << 18;
+
+//horizontal strip of the raster
+struct QgsNineCellTile
+{
+  QgsNineCellFilter* filter;
+  int firstRow;
+  int nRows; //0 if the strip is not used
+  int xSize;
+  //nRows + 2 rows of xSize + 2 input values, the cells of the strip surrounded by the neighbour cells (or nodata)
+  float* input;
+  //nRows rows of xSize output values
+  float* output;
+};
+
+static void readNineCellTile( GDALRasterBandH band, QgsNineCellTile& tile, int ySize, float nodata )
+{
+  if ( tile.nRows == 0 )
+  {
+    return;
+  }
+
+  int lineSize = tile.xSize + 2;
+  int firstRow = qMax( tile.firstRow - 1, 0 );
+  int lastRow = qMin( tile.firstRow + tile.nRows, ySize - 1 );
+
+  //values outside the layer extent are nodata
+  for ( int i = 0; i < tile.nRows + 2; ++i )
+  {
+    tile.input[i * lineSize] = nodata;
+    tile.input[i * lineSize + lineSize - 1] = nodata;
+  }
+  if ( firstRow == tile.firstRow )
+  {
+    for ( int i = 0; i < lineSize; ++i )
+    {
+      tile.input[i] = nodata;
+    }
+  }
+  if ( lastRow < tile.firstRow + tile.nRows )
+  {
+    float* lastLine = tile.input + ( tile.nRows + 1 ) * lineSize;
+    for ( int i = 0; i < lineSize; ++i )
+    {
+      lastLine[i] = nodata;
+    }
+  }
+
+  int nLines = lastRow - firstRow + 1;
+  float* firstLine = tile.input + ( firstRow - tile.firstRow + 1 ) * lineSize + 1;
+  GDALRasterIO( band, GF_Read, 0, firstRow, tile.xSize, nLines, firstLine, tile.xSize, nLines, GDT_Float32, 0, ( int )( lineSize * sizeof( float ) ) );
+}
+
+static void processNineCellTile( QgsNineCellTile& tile )
+{
+  int lineSize = tile.xSize + 2;
+  for ( int i = 0; i < tile.nRows; ++i )
+  {
+    float* line = tile.input + i * lineSize;
+    tile.filter->processNineCellRow( line, line + lineSize, line + 2 * lineSize, tile.output + i * tile.xSize, tile.xSize );
+  }
+}
+
+static void writeNineCellTiles( GDALRasterBandH band, QVector<QgsNineCellTile>* tiles )
+{
+  for ( int i = 0; i < tiles->size(); ++i )
+  {
+    const QgsNineCellTile& tile = tiles->at( i );
+    if ( tile.nRows > 0 )
+    {
+      GDALRasterIO( band, GF_Write, 0, tile.firstRow, tile.xSize, tile.nRows, tile.output, tile.xSize, tile.nRows, GDT_Float32, 0, 0 );
+    }
+  }
+}
+
 QgsNineCellFilter::QgsNineCellFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat )
     : mInputFile( inputFile ), mOutputFile( outputFile ), mOutputFormat( outputFormat ), mCellSizeX( -1 ), mCellSizeY( -1 ),
     mInputNodataValue( -1 ), mOutputNodataValue( -1 ), mZFactor( 1.0 )
@@ -42,6 +123,15 @@ QgsNineCellFilter::~QgsNineCellFilter()
 
 }
 
+void QgsNineCellFilter::processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells )
+{
+  for ( int i = 0; i < nCells; ++i )
+  {
+    result[i] = processNineCellWindow( &rowAbove[i], &rowAbove[i+1], &rowAbove[i+2], &row[i], &row[i+1],
+                                       &row[i+2], &rowBelow[i], &rowBelow[i+1], &rowBelow[i+2] );
+  }
+}
+
 int QgsNineCellFilter::processRaster( QProgressDialog* p )
 {
   GDALAllRegister();
@@ -95,24 +185,47 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
     return 6;
   }
 
-  //keep only three scanlines in memory at a time
-  float* scanLine1 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float* scanLine2 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float* scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+  //the raster is processed in strips of at most TILE_CELLS cells (but at least one row), one strip per thread.
+  //The strips are aligned to whole block rows if they can hold some, otherwise a strip covers part of a
+  //block row (e.g. for rasters stored in a single block). The next strips are read and processed while
+  //the last ones are written
+  int blockXSize, blockYSize;
+  GDALGetBlockSize( rasterBand, &blockXSize, &blockYSize );
+  int tileRows = qMax( 1, TILE_CELLS / xSize );
+  if ( blockYSize > 0 && tileRows >= blockYSize )
+  {
+    tileRows = tileRows / blockYSize * blockYSize;
+  }
+  int nThreads = qMax( 1, QThread::idealThreadCount() );
 
-  float* resultLine = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+  QVector<QgsNineCellTile> tiles[2];
+  for ( int i = 0; i < 2; ++i )
+  {
+    tiles[i].resize( nThreads );
+    for ( int j = 0; j < nThreads; ++j )
+    {
+      QgsNineCellTile& tile = tiles[i][j];
+      tile.filter = this;
+      tile.firstRow = 0;
+      tile.nRows = 0;
+      tile.xSize = xSize;
+      tile.input = ( float * ) CPLMalloc( sizeof( float ) * ( xSize + 2 ) * ( tileRows + 2 ) );
+      tile.output = ( float * ) CPLMalloc( sizeof( float ) * xSize * tileRows );
+    }
+  }
 
   if ( p )
   {
     p->setMaximum( ySize );
   }
 
-  //values outside the layer extent (if the 3x3 window is on the border) are sent to the processing method as (input) nodata values
-  for ( int i = 0; i < ySize; ++i )
+  QFuture<void> writing;
+  int row = 0;
+  for ( int batch = 0; row < ySize; ++batch )
   {
     if ( p )
     {
-      p->setValue( i );
+      p->setValue( row );
     }
 
     if ( p && p->wasCanceled() )
@@ -120,67 +233,38 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
       break;
     }
 
-    if ( i == 0 )
-    {
-      //fill scanline 1 with (input) nodata for the values above the first row and feed scanline2 with the first row
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine1[a] = mInputNodataValue;
-      }
-      GDALRasterIO( rasterBand, GF_Read, 0, 0, xSize, 1, scanLine2, xSize, 1, GDT_Float32, 0, 0 );
-    }
-    else
-    {
-      //normally fetch only scanLine3 and release scanline 1 if we move forward one row
-      CPLFree( scanLine1 );
-      scanLine1 = scanLine2;
-      scanLine2 = scanLine3;
-      scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-    }
-
-    if ( i == ySize - 1 ) //fill the row below the bottom with nodata values
-    {
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine3[a] = mInputNodataValue;
-      }
-    }
-    else
+    //GDAL handles are not shared between threads, so the strips are read here
+    QVector<QgsNineCellTile>& batchTiles = tiles[batch % 2];
+    for ( int i = 0; i < nThreads; ++i )
     {
-      GDALRasterIO( rasterBand, GF_Read, 0, i + 1, xSize, 1, scanLine3, xSize, 1, GDT_Float32, 0, 0 );
+      QgsNineCellTile& tile = batchTiles[i];
+      tile.firstRow = row;
+      tile.nRows = qMin( tileRows, ySize - row );
+      row += tile.nRows;
+      readNineCellTile( rasterBand, tile, ySize, mInputNodataValue );
     }
 
-    for ( int j = 0; j < xSize; ++j )
-    {
-      if ( j == 0 )
-      {
-        resultLine[j] = processNineCellWindow( &mInputNodataValue, &scanLine1[j], &scanLine1[j+1], &mInputNodataValue, &scanLine2[j],
-                                               &scanLine2[j+1], &mInputNodataValue, &scanLine3[j], &scanLine3[j+1] );
-      }
-      else if ( j == xSize - 1 )
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j-1], &scanLine1[j], &mInputNodataValue, &scanLine2[j-1], &scanLine2[j],
-                                               &mInputNodataValue, &scanLine3[j-1], &scanLine3[j], &mInputNodataValue );
-      }
-      else
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j-1], &scanLine1[j], &scanLine1[j+1], &scanLine2[j-1], &scanLine2[j],
-                                               &scanLine2[j+1], &scanLine3[j-1], &scanLine3[j], &scanLine3[j+1] );
-      }
-    }
+    QtConcurrent::blockingMap( batchTiles, processNineCellTile );
 
-    GDALRasterIO( outputRasterBand, GF_Write, 0, i, xSize, 1, resultLine, xSize, 1, GDT_Float32, 0, 0 );
+    //the strips of the last batch have to be written before the ones of this batch
+    writing.waitForFinished();
+    writing = QtConcurrent::run( writeNineCellTiles, outputRasterBand, &batchTiles );
   }
+  writing.waitForFinished();
 
   if ( p )
   {
     p->setValue( ySize );
   }
 
-  CPLFree( resultLine );
-  CPLFree( scanLine1 );
-  CPLFree( scanLine2 );
-  CPLFree( scanLine3 );
+  for ( int i = 0; i < 2; ++i )
+  {
+    for ( int j = 0; j < nThreads; ++j )
+    {
+      CPLFree( tiles[i][j].input );
+      CPLFree( tiles[i][j].output );
+    }
+  }
 
   GDALClose( inputDataset );
 
@@ -25,7 +25,8 @@ class QProgressDialog;
 
 /**Base class for raster analysis methods that work with a 3x3 cell filter and calculate the value of each cell based on
 the cell value and the eight neighbour cells. Common examples are slope and aspect calculation in DEMs. Subclasses only implement
-the method that calculates the new value from the nine values. Everything else (reading file, writing file) is done by this subclass*/
+the method that calculates the new value from the nine values. Everything else (reading file, writing file) is done by this subclass.
+The raster is processed in strips of whole blocks on several threads*/
 
 class ANALYSIS_EXPORT QgsNineCellFilter
 {
@@ -57,6 +58,14 @@ class ANALYSIS_EXPORT QgsNineCellFilter
                                          float* x12, float* x22, float* x32,
                                          float* x13, float* x23, float* x33 ) = 0;
 
+    /**Calculates the output values of a row of cells. The input rows have a value left of the first and right of the
+      last cell (nodata at the border), so that the window of cell i is at i, i + 1 and i + 2 of the three rows.
+      It is called from several threads at the same time for different rows. The default implementation calls
+      processNineCellWindow for each cell, subclasses can override it with processNineCellRowWith to avoid the
+      virtual call per cell (classes derived from them have to override it again if they change the window function)
+      @note added in 1.9*/
+    virtual void processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells );
+
   private:
     //default constructor forbidden. We need input file, output file and format obligatory
     QgsNineCellFilter();
@@ -71,6 +80,15 @@ class ANALYSIS_EXPORT QgsNineCellFilter
     GDALDatasetH openOutputFile( GDALDatasetH inputDataset, GDALDriverH outputDriver );
 
   protected:
+    /**Calculates a row with the window function of Filter, called without virtual dispatch*/
+    template<class Filter> static void processNineCellRowWith( Filter* filter, float* rowAbove, float* row, float* rowBelow, float* result, int nCells )
+    {
+      for ( int i = 0; i < nCells; ++i )
+      {
+        result[i] = filter->Filter::processNineCellWindow( &rowAbove[i], &rowAbove[i+1], &rowAbove[i+2], &row[i], &row[i+1],
+                    &row[i+2], &rowBelow[i], &rowBelow[i+1], &rowBelow[i+2] );
+      }
+    }
 
     QString mInputFile;
     QString mOutputFile;
@@ -67,6 +67,18 @@ class ANALYSIS_EXPORT QgsRasterCalcNode
     ~QgsRasterCalcNode();
 
     Type type() const { return mType; }
+    /**Operator of an operator node
+      @note added in 1.9*/
+    Operator op() const { return mOperator; }
+    /**Raster reference of a raster node
+      @note added in 1.9*/
+    QString rasterName() const { return mRasterName; }
+    /**Left (or only) operand of an operator node
+      @note added in 1.9*/
+    const QgsRasterCalcNode* left() const { return mLeft; }
+    /**Right operand of an operator node or 0
+      @note added in 1.9*/
+    const QgsRasterCalcNode* right() const { return mRight; }
 
     //set left node
     void setLeft( QgsRasterCalcNode* left ) { delete mLeft; mLeft = left; }
@@ -20,7 +20,12 @@
 #include "qgsrasterlayer.h"
 #include "qgsrastermatrix.h"
 #include "cpl_string.h"
+#include <QFuture>
 #include <QProgressDialog>
+#include <QStringList>
+#include <QThread>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
 
 #include "gdalwarper.h"
 #include <ogr_srs_api.h>
@@ -31,6 +36,294 @@
 #define TO8(x) (x).toLocal8Bit().constData()
 #endif
 
+//number of cells of a block calculated by a thread
+static const int BLOCK_CELLS = 1 << 16;
+
+//the formula compiled to a list of instructions that calculate a single cell on a stack of values.
+//Subexpressions without raster references are calculated once during compilation
+class QgsRasterCalcProgram
+{
+  public:
+    QgsRasterCalcProgram(): mStackSize( 0 ), mIsNumber( false ), mNumber( 0 ), mNodataValue( 0 ) {}
+
+    //inputs are the raster references in the order of the input buffers
+    bool compile( const QgsRasterCalcNode* node, const QStringList& inputs, const QVector<double>& inputNodataValues )
+    {
+      mInstructions.clear();
+      mStackSize = 0;
+      int depth = 0;
+      Operand result;
+      if ( !compileNode( node, inputs, inputNodataValues, result, depth ) )
+      {
+        return false;
+      }
+      mIsNumber = result.isNumber;
+      mNumber = result.number;
+      mNodataValue = result.nodataValue;
+      return true;
+    }
+
+    void calculate( float** inputs, float* result, int nCells, float outputNodataValue ) const
+    {
+      if ( mIsNumber ) //scalar result. Insert number for every pixel
+      {
+        float value = mNumber == mNodataValue ? outputNodataValue : static_cast<float>( mNumber );
+        for ( int i = 0; i < nCells; ++i )
+        {
+          result[i] = value;
+        }
+        return;
+      }
+
+      QVector<float> stack( mStackSize );
+      float* values = stack.data();
+      const Instruction* instructions = mInstructions.constData();
+      int nInstructions = mInstructions.size();
+      for ( int i = 0; i < nCells; ++i )
+      {
+        int top = -1;
+        for ( int j = 0; j < nInstructions; ++j )
+        {
+          const Instruction& instruction = instructions[j];
+          switch ( instruction.type )
+          {
+            case Instruction::RasterValue:
+              values[++top] = inputs[instruction.input][i];
+              break;
+            case Instruction::OneArgument:
+              values[top] = QgsRasterMatrix::oneArgumentValue( instruction.oneArgOperator, values[top], instruction.nodataValue );
+              break;
+            case Instruction::MatrixMatrix:
+              --top;
+              values[top] = QgsRasterMatrix::matrixMatrixValue( instruction.twoArgOperator, values[top], instruction.nodataValue,
+                            values[top + 1], instruction.otherNodataValue );
+              break;
+            case Instruction::NumberMatrix:
+              values[top] = QgsRasterMatrix::numberMatrixValue( instruction.twoArgOperator, instruction.number, values[top], instruction.nodataValue );
+              break;
+            case Instruction::MatrixNumber:
+              values[top] = QgsRasterMatrix::matrixNumberValue( instruction.twoArgOperator, values[top], instruction.nodataValue,
+                            instruction.number, instruction.otherNodataValue );
+              break;
+          }
+        }
+        //replace all matrix nodata values with output nodatas
+        result[i] = values[0] == mNodataValue ? outputNodataValue : values[0];
+      }
+    }
+
+  private:
+    struct Instruction
+    {
+      enum Type
+      {
+        RasterValue,  //pushes the cell of an input raster
+        OneArgument,  //replaces the value on top of the stack
+        MatrixMatrix, //replaces the two values on top of the stack
+        NumberMatrix, //number as left operand, replaces the value on top of the stack
+        MatrixNumber  //number as right operand, replaces the value on top of the stack
+      };
+      Type type;
+      QgsRasterMatrix::OneArgOperator oneArgOperator;
+      QgsRasterMatrix::TwoArgOperator twoArgOperator;
+      int input;
+      double number;
+      //nodata value of the result (and of the left operand, except for NumberMatrix)
+      double nodataValue;
+      //nodata value of the right operand of MatrixMatrix and MatrixNumber
+      double otherNodataValue;
+    };
+
+    //result of a node, the nodata value of a matrix is the same for every cell
+    struct Operand
+    {
+      bool isNumber;
+      double number;
+      double nodataValue;
+    };
+
+    static bool hasRasterReference( const QgsRasterCalcNode* node )
+    {
+      if ( !node )
+      {
+        return false;
+      }
+      return node->type() == QgsRasterCalcNode::tRasterRef || hasRasterReference( node->left() ) || hasRasterReference( node->right() );
+    }
+
+    static bool oneArgOperator( QgsRasterCalcNode::Operator op, QgsRasterMatrix::OneArgOperator& matrixOp )
+    {
+      switch ( op )
+      {
+        case QgsRasterCalcNode::opSQRT: matrixOp = QgsRasterMatrix::opSQRT; return true;
+        case QgsRasterCalcNode::opSIN: matrixOp = QgsRasterMatrix::opSIN; return true;
+        case QgsRasterCalcNode::opCOS: matrixOp = QgsRasterMatrix::opCOS; return true;
+        case QgsRasterCalcNode::opTAN: matrixOp = QgsRasterMatrix::opTAN; return true;
+        case QgsRasterCalcNode::opASIN: matrixOp = QgsRasterMatrix::opASIN; return true;
+        case QgsRasterCalcNode::opACOS: matrixOp = QgsRasterMatrix::opACOS; return true;
+        case QgsRasterCalcNode::opATAN: matrixOp = QgsRasterMatrix::opATAN; return true;
+        case QgsRasterCalcNode::opSIGN: matrixOp = QgsRasterMatrix::opSIGN; return true;
+        default: return false;
+      }
+    }
+
+    static bool twoArgOperator( QgsRasterCalcNode::Operator op, QgsRasterMatrix::TwoArgOperator& matrixOp )
+    {
+      switch ( op )
+      {
+        case QgsRasterCalcNode::opPLUS: matrixOp = QgsRasterMatrix::opPLUS; return true;
+        case QgsRasterCalcNode::opMINUS: matrixOp = QgsRasterMatrix::opMINUS; return true;
+        case QgsRasterCalcNode::opMUL: matrixOp = QgsRasterMatrix::opMUL; return true;
+        case QgsRasterCalcNode::opDIV: matrixOp = QgsRasterMatrix::opDIV; return true;
+        case QgsRasterCalcNode::opPOW: matrixOp = QgsRasterMatrix::opPOW; return true;
+        case QgsRasterCalcNode::opEQ: matrixOp = QgsRasterMatrix::opEQ; return true;
+        case QgsRasterCalcNode::opNE: matrixOp = QgsRasterMatrix::opNE; return true;
+        case QgsRasterCalcNode::opGT: matrixOp = QgsRasterMatrix::opGT; return true;
+        case QgsRasterCalcNode::opLT: matrixOp = QgsRasterMatrix::opLT; return true;
+        case QgsRasterCalcNode::opGE: matrixOp = QgsRasterMatrix::opGE; return true;
+        case QgsRasterCalcNode::opLE: matrixOp = QgsRasterMatrix::opLE; return true;
+        case QgsRasterCalcNode::opAND: matrixOp = QgsRasterMatrix::opAND; return true;
+        case QgsRasterCalcNode::opOR: matrixOp = QgsRasterMatrix::opOR; return true;
+        default: return false;
+      }
+    }
+
+    bool compileNode( const QgsRasterCalcNode* node, const QStringList& inputs, const QVector<double>& inputNodataValues, Operand& result, int& depth )
+    {
+      if ( !node )
+      {
+        return false;
+      }
+
+      //numbers are calculated like before, with 1x1 matrices
+      if ( !hasRasterReference( node ) )
+      {
+        QMap<QString, QgsRasterMatrix*> noRasters;
+        QgsRasterMatrix matrix;
+        if ( !node->calculate( noRasters, matrix ) )
+        {
+          return false;
+        }
+        result.isNumber = true;
+        result.number = matrix.number();
+        result.nodataValue = matrix.nodataValue();
+        return true;
+      }
+
+      Instruction instruction;
+      instruction.oneArgOperator = QgsRasterMatrix::opSQRT;
+      instruction.twoArgOperator = QgsRasterMatrix::opPLUS;
+      instruction.input = -1;
+      instruction.number = 0;
+      instruction.otherNodataValue = 0;
+
+      if ( node->type() == QgsRasterCalcNode::tRasterRef )
+      {
+        instruction.type = Instruction::RasterValue;
+        instruction.input = inputs.indexOf( node->rasterName() );
+        if ( instruction.input < 0 )
+        {
+          return false;
+        }
+        instruction.nodataValue = inputNodataValues[instruction.input];
+        mInstructions << instruction;
+        mStackSize = qMax( mStackSize, ++depth );
+
+        result.isNumber = false;
+        result.number = 0;
+        result.nodataValue = instruction.nodataValue;
+        return true;
+      }
+
+      Operand left, right;
+      if ( node->type() != QgsRasterCalcNode::tOperator || !compileNode( node->left(), inputs, inputNodataValues, left, depth ) )
+      {
+        return false;
+      }
+
+      if ( oneArgOperator( node->op(), instruction.oneArgOperator ) )
+      {
+        instruction.type = Instruction::OneArgument;
+        instruction.nodataValue = left.nodataValue;
+      }
+      else if ( twoArgOperator( node->op(), instruction.twoArgOperator ) )
+      {
+        if ( !compileNode( node->right(), inputs, inputNodataValues, right, depth ) )
+        {
+          return false;
+        }
+
+        if ( right.isNumber )
+        {
+          instruction.type = Instruction::MatrixNumber;
+          instruction.number = right.number;
+          instruction.nodataValue = left.nodataValue;
+          instruction.otherNodataValue = right.nodataValue;
+        }
+        else if ( left.isNumber )
+        {
+          //the result gets the nodata value of the matrix
+          instruction.type = Instruction::NumberMatrix;
+          instruction.number = left.number;
+          instruction.nodataValue = right.nodataValue;
+        }
+        else
+        {
+          instruction.type = Instruction::MatrixMatrix;
+          instruction.nodataValue = left.nodataValue;
+          instruction.otherNodataValue = right.nodataValue;
+          --depth;
+        }
+      }
+      else
+      {
+        return false;
+      }
+
+      mInstructions << instruction;
+      result.isNumber = false;
+      result.number = 0;
+      result.nodataValue = instruction.nodataValue;
+      return true;
+    }
+
+    QVector<Instruction> mInstructions;
+    int mStackSize;
+    bool mIsNumber;
+    double mNumber;
+    double mNodataValue;
+};
+
+//rows of the output raster with the input values they are calculated from
+struct QgsRasterCalcBlock
+{
+  const QgsRasterCalcProgram* program;
+  int firstRow;
+  int nRows; //0 if the block is not used
+  int nColumns;
+  float outputNodataValue;
+  QVector<float*> inputs;
+  float* output;
+};
+
+static void calculateRasterCalcBlock( QgsRasterCalcBlock& block )
+{
+  block.program->calculate( block.inputs.data(), block.output, block.nRows * block.nColumns, block.outputNodataValue );
+}
+
+static void writeRasterCalcBlocks( GDALRasterBandH band, QVector<QgsRasterCalcBlock>* blocks )
+{
+  for ( int i = 0; i < blocks->size(); ++i )
+  {
+    const QgsRasterCalcBlock& block = blocks->at( i );
+    if ( block.nRows > 0 && GDALRasterIO( band, GF_Write, 0, block.firstRow, block.nColumns, block.nRows, block.output,
+         block.nColumns, block.nRows, GDT_Float32, 0, 0 ) != CE_None )
+    {
+      qWarning( "RasterIO error!" );
+    }
+  }
+}
+
 QgsRasterCalculator::QgsRasterCalculator( const QString& formulaString, const QString& outputFile, const QString& outputFormat,
     const QgsRectangle& outputExtent, int nOutputColumns, int nOutputRows, const QVector<QgsRasterCalculatorEntry>& rasterEntries ): mFormulaString( formulaString ), mOutputFile( outputFile ), mOutputFormat( outputFormat ),
     mOutputRectangle( outputExtent ), mNumOutputColumns( nOutputColumns ), mNumOutputRows( nOutputRows ), mRasterEntries( rasterEntries )
@@ -55,8 +348,9 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
   outputGeoTransform( targetGeoTransform );
 
   //open all input rasters for reading
-  QMap< QString, GDALRasterBandH > mInputRasterBands; //raster references and corresponding scanline data
-  QMap< QString, QgsRasterMatrix* > inputScanLineData; //stores raster references and corresponding scanline data
+  QStringList inputRefs; //raster references
+  QVector< GDALRasterBandH > inputRasterBands; //bands of the references
+  QVector< double > inputNodataValues; //nodata values of the bands
   QVector< GDALDatasetH > mInputDatasets; //raster references and corresponding dataset
 
   QVector<QgsRasterCalculatorEntry>::const_iterator it = mRasterEntries.constBegin();
@@ -100,17 +394,39 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
     int nodataSuccess;
     double nodataValue = GDALGetRasterNoDataValue( inputRasterBand, &nodataSuccess );
 
-    mInputRasterBands.insert( it->ref, inputRasterBand );
-    inputScanLineData.insert( it->ref, new QgsRasterMatrix( mNumOutputColumns, 1, new float[mNumOutputColumns], nodataValue ) );
+    //a reference that is used twice refers to the last entry
+    int index = inputRefs.indexOf( it->ref );
+    if ( index < 0 )
+    {
+      inputRefs << it->ref;
+      inputRasterBands << inputRasterBand;
+      inputNodataValues << nodataValue;
+    }
+    else
+    {
+      inputRasterBands[index] = inputRasterBand;
+      inputNodataValues[index] = nodataValue;
+    }
   }
 
+  //the formula is calculated for each cell in a single pass, without matrices for the nodes.
+  //A formula that cannot be parsed or refers to an unknown raster does not create an output file
+  QgsRasterCalcProgram program;
+  bool compiled = program.compile( calcNode, inputRefs, inputNodataValues );
+  delete calcNode;
+
   //open output dataset for writing
-  GDALDriverH outputDriver = openOutputDriver();
-  if ( outputDriver == NULL )
+  GDALDriverH outputDriver = compiled ? openOutputDriver() : NULL;
+  GDALDatasetH outputDataset = outputDriver ? openOutputFile( outputDriver ) : NULL;
+  if ( outputDataset == NULL )
   {
-    return 1;
+    QVector< GDALDatasetH >::iterator datasetIt = mInputDatasets.begin();
+    for ( ; datasetIt != mInputDatasets.end(); ++ datasetIt )
+    {
+      GDALClose( *datasetIt );
+    }
+    return compiled ? 1 : 4;
   }
-  GDALDatasetH outputDataset = openOutputFile( outputDriver );
 
   //copy the projection info from the first input raster
   if ( mRasterEntries.size() > 0 )
@@ -140,21 +456,56 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
   float outputNodataValue = -FLT_MAX;
   GDALSetRasterNoDataValue( outputRasterBand, outputNodataValue );
 
-  float* resultScanLine = ( float * ) CPLMalloc( sizeof( float ) * mNumOutputColumns );
+  QVector< double > sourceTransformations( 6 * inputRasterBands.size() );
+  for ( int i = 0; i < inputRasterBands.size(); ++i )
+  {
+    GDALGetGeoTransform( GDALGetBandDataset( inputRasterBands[i] ), sourceTransformations.data() + 6 * i );
+  }
+
+  //the output is calculated in blocks of at most BLOCK_CELLS cells (but at least one row), one block per
+  //thread. The blocks are aligned to whole block rows of the output if they can hold some, otherwise a
+  //block covers part of a block row. The next blocks are read and calculated while the last ones are written
+  int blockXSize, blockYSize;
+  GDALGetBlockSize( outputRasterBand, &blockXSize, &blockYSize );
+  int blockRows = qMax( 1, BLOCK_CELLS / mNumOutputColumns );
+  if ( blockYSize > 0 && blockRows >= blockYSize )
+  {
+    blockRows = blockRows / blockYSize * blockYSize;
+  }
+  int nThreads = qMax( 1, QThread::idealThreadCount() );
+
+  QVector<QgsRasterCalcBlock> blocks[2];
+  for ( int i = 0; i < 2; ++i )
+  {
+    blocks[i].resize( nThreads );
+    for ( int j = 0; j < nThreads; ++j )
+    {
+      QgsRasterCalcBlock& block = blocks[i][j];
+      block.program = &program;
+      block.firstRow = 0;
+      block.nRows = 0;
+      block.nColumns = mNumOutputColumns;
+      block.outputNodataValue = outputNodataValue;
+      for ( int k = 0; k < inputRasterBands.size(); ++k )
+      {
+        block.inputs << ( float * ) CPLMalloc( sizeof( float ) * mNumOutputColumns * blockRows );
+      }
+      block.output = ( float * ) CPLMalloc( sizeof( float ) * mNumOutputColumns * blockRows );
+    }
+  }
 
   if ( p )
   {
     p->setMaximum( mNumOutputRows );
   }
 
-  QgsRasterMatrix resultMatrix;
-
-  //read / write line by line
-  for ( int i = 0; i < mNumOutputRows; ++i )
+  QFuture<void> writing;
+  int row = 0;
+  for ( int batch = 0; row < mNumOutputRows; ++batch )
   {
     if ( p )
     {
-      p->setValue( i );
+      p->setValue( row );
     }
 
     if ( p && p->wasCanceled() )
@@ -163,56 +514,27 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
     }
 
     //fill buffers
-    QMap< QString, QgsRasterMatrix* >::iterator bufferIt = inputScanLineData.begin();
-    for ( ; bufferIt != inputScanLineData.end(); ++bufferIt )
+    QVector<QgsRasterCalcBlock>& batchBlocks = blocks[batch % 2];
+    for ( int i = 0; i < nThreads; ++i )
     {
-      double sourceTransformation[6];
-      GDALRasterBandH sourceRasterBand = mInputRasterBands[bufferIt.key()];
-      GDALGetGeoTransform( GDALGetBandDataset( sourceRasterBand ), sourceTransformation );
-      //the function readRasterPart calls GDALRasterIO (and ev. does some conversion if raster transformations are not the same)
-      readRasterPart( targetGeoTransform, 0, i, mNumOutputColumns, 1, sourceTransformation, sourceRasterBand, bufferIt.value()->data() );
-    }
-
-    if ( calcNode->calculate( inputScanLineData, resultMatrix ) )
-    {
-      bool resultIsNumber = resultMatrix.isNumber();
-      float* calcData;
-
-      if ( resultIsNumber ) //scalar result. Insert number for every pixel
-      {
-        calcData = new float[mNumOutputColumns];
-        for ( int j = 0; j < mNumOutputColumns; ++j )
-        {
-          calcData[j] = resultMatrix.number();
-        }
-      }
-      else //result is real matrix
-      {
-        calcData = resultMatrix.data();
-      }
-
-      //replace all matrix nodata values with output nodatas
-      for ( int j = 0; j < mNumOutputColumns; ++j )
+      QgsRasterCalcBlock& block = batchBlocks[i];
+      block.firstRow = row;
+      block.nRows = qMin( blockRows, mNumOutputRows - row );
+      row += block.nRows;
+      for ( int k = 0; block.nRows > 0 && k < inputRasterBands.size(); ++k )
       {
-        if ( calcData[j] == resultMatrix.nodataValue() )
-        {
-          calcData[j] = outputNodataValue;
-        }
-      }
-
-      //write scanline to the dataset
-      if ( GDALRasterIO( outputRasterBand, GF_Write, 0, i, mNumOutputColumns, 1, calcData, mNumOutputColumns, 1, GDT_Float32, 0, 0 ) != CE_None )
-      {
-        qWarning( "RasterIO error!" );
-      }
-
-      if ( resultIsNumber )
-      {
-        delete[] calcData;
+        //the function readRasterPart calls GDALRasterIO (and ev. does some conversion if raster transformations are not the same)
+        readRasterPart( targetGeoTransform, 0, block.firstRow, mNumOutputColumns, block.nRows, sourceTransformations.data() + 6 * k, inputRasterBands[k], block.inputs[k] );
       }
     }
 
+    QtConcurrent::blockingMap( batchBlocks, calculateRasterCalcBlock );
+
+    //the blocks of the last batch have to be written before the ones of this batch
+    writing.waitForFinished();
+    writing = QtConcurrent::run( writeRasterCalcBlocks, outputRasterBand, &batchBlocks );
   }
+  writing.waitForFinished();
 
   if ( p )
   {
@@ -220,14 +542,17 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
   }
 
   //close datasets and release memory
-  delete calcNode;
-  QMap< QString, QgsRasterMatrix* >::iterator bufferIt = inputScanLineData.begin();
-  for ( ; bufferIt != inputScanLineData.end(); ++bufferIt )
+  for ( int i = 0; i < 2; ++i )
   {
-    delete bufferIt.value();
+    for ( int j = 0; j < nThreads; ++j )
+    {
+      foreach( float* input, blocks[i][j].inputs )
+      {
+        CPLFree( input );
+      }
+      CPLFree( blocks[i][j].output );
+    }
   }
-  inputScanLineData.clear();
-
   QVector< GDALDatasetH >::iterator datasetIt = mInputDatasets.begin();
   for ( ; datasetIt != mInputDatasets.end(); ++ datasetIt )
   {
@@ -241,7 +566,6 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
     return 3;
   }
   GDALClose( outputDataset );
-  CPLFree( resultScanLine );
   return 0;
 }
 
@@ -348,11 +672,11 @@ void QgsRasterCalculator::readRasterPart( double* targetGeotransform, int xOffse
       if ( sourceIndexX >= 0 && sourceIndexX < nSourcePixelsX
            && sourceIndexY >= 0 && sourceIndexY < nSourcePixelsY )
       {
-        rasterBuffer[j + i*nRows] = sourceRaster[ sourceIndexX  + nSourcePixelsX * sourceIndexY ];
+        rasterBuffer[j + i*nCols] = sourceRaster[ sourceIndexX  + nSourcePixelsX * sourceIndexY ];
       }
       else
       {
-        rasterBuffer[j + i*j] = nodataValue;
+        rasterBuffer[j + i*nCols] = nodataValue;
       }
       targetPixelX += targetGeotransform[1];
     }
@@ -45,7 +45,9 @@ class ANALYSIS_EXPORT QgsRasterCalculator
 
     /**Starts the calculation and writes new raster
       @param p progress bar (or 0 if called from non-gui code)
-      @return 0 in case of success*/
+      @return 0 in case of success, 1 if the output file cannot be created, 2 if an input raster
+      cannot be read, 3 if the calculation was canceled and 4 if the formula cannot be parsed
+      or refers to an unknown raster*/
     int processCalculation( QProgressDialog* p = 0 );
 
   private:
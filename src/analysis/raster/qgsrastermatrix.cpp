@@ -180,46 +180,9 @@ bool QgsRasterMatrix::oneArgumentOperation( OneArgOperator op )
   }
 
   int nEntries = mColumns * mRows;
-  double value;
   for ( int i = 0; i < nEntries; ++i )
   {
-    value = mData[i];
-    if ( value != mNodataValue )
-    {
-      switch ( op )
-      {
-        case opSQRT:
-          if ( value < 0 ) //no complex numbers
-          {
-            mData[i] = static_cast<float>( mNodataValue );
-          }
-          else
-          {
-            mData[i] = static_cast<float>( sqrt( value ) );
-          }
-          break;
-        case opSIN:
-          mData[i] = static_cast<float>( sin( value ) );
-          break;
-        case opCOS:
-          mData[i] = static_cast<float>( cos( value ) );
-          break;
-        case opTAN:
-          mData[i] = static_cast<float>( tan( value ) );
-          break;
-        case opASIN:
-          mData[i] = static_cast<float>( asin( value ) );
-          break;
-        case opACOS:
-          mData[i] = static_cast<float>( acos( value ) );
-          break;
-        case opATAN:
-          mData[i] = static_cast<float>( atan( value ) );
-          break;
-        case opSIGN:
-          mData[i] = static_cast<float>( -value );
-      }
-    }
+    mData[i] = oneArgumentValue( op, mData[i], mNodataValue );
   }
   return true;
 }
@@ -298,74 +261,9 @@ bool QgsRasterMatrix::twoArgumentOperation( TwoArgOperator op, const QgsRasterMa
   {
     float* matrix = other.mData;
     int nEntries = mColumns * mRows;
-    double value1, value2;
-
     for ( int i = 0; i < nEntries; ++i )
     {
-      value1 = mData[i]; value2 = matrix[i];
-      if ( value1 == mNodataValue || value2 == other.mNodataValue )
-      {
-        mData[i] = static_cast<float>( mNodataValue );
-      }
-      else
-      {
-        switch ( op )
-        {
-          case opPLUS:
-            mData[i] = static_cast<float>( value1 + value2 );
-            break;
-          case opMINUS:
-            mData[i] = static_cast<float>( value1 - value2 );
-            break;
-          case opMUL:
-            mData[i] = static_cast<float>( value1 * value2 );
-            break;
-          case opDIV:
-            if ( value2 == 0 )
-            {
-              mData[i] = static_cast<float>( mNodataValue );
-            }
-            else
-            {
-              mData[i] = static_cast<float>( value1 / value2 );
-            }
-            break;
-          case opPOW:
-            if ( !testPowerValidity( value1, value2 ) )
-            {
-              mData[i] = static_cast<float>( mNodataValue );
-            }
-            else
-            {
-              mData[i] = static_cast<float>( pow( value1, value2 ) );
-            }
-            break;
-          case opEQ:
-            mData[i] = value1 == value2 ? 1.0f : 0.0f;
-            break;
-          case opNE:
-            mData[i] = value1 == value2 ? 0.0f : 1.0f;
-            break;
-          case opGT:
-            mData[i] = value1 > value2 ? 1.0f : 0.0f;
-            break;
-          case opLT:
-            mData[i] = value1 < value2 ? 1.0f : 0.0f;
-            break;
-          case opGE:
-            mData[i] = value1 >= value2 ? 1.0f : 0.0f;
-            break;
-          case opLE:
-            mData[i] = value1 <= value2 ? 1.0f : 0.0f;
-            break;
-          case opAND:
-            mData[i] = value1 && value2 ? 1.0f : 0.0f;
-            break;
-          case opOR:
-            mData[i] = value1 || value2 ? 1.0f : 0.0f;
-            break;
-        }
-      }
+      mData[i] = matrixMatrixValue( op, mData[i], mNodataValue, matrix[i], other.mNodataValue );
     }
     return true;
   }
@@ -380,162 +278,203 @@ bool QgsRasterMatrix::twoArgumentOperation( TwoArgOperator op, const QgsRasterMa
     mData = new float[nEntries]; mColumns = other.nColumns(); mRows = other.nRows();
     mNodataValue = other.nodataValue();
 
-    if ( value == mNodataValue )
+    for ( int i = 0; i < nEntries; ++i )
     {
-      for ( int i = 0; i < nEntries; ++i )
-      {
-        mData[i] = static_cast<float>( mNodataValue );
-      }
-      return true;
+      mData[i] = numberMatrixValue( op, value, matrix[i], mNodataValue );
     }
-
+    return true;
+  }
+  else //this matrix is a real matrix and the other a number
+  {
+    double value = other.number();
+    int nEntries = mColumns * mRows;
     for ( int i = 0; i < nEntries; ++i )
     {
-      if ( matrix[i] == other.mNodataValue )
+      mData[i] = matrixNumberValue( op, mData[i], mNodataValue, value, other.mNodataValue );
+    }
+    return true;
+  }
+}
+
+float QgsRasterMatrix::oneArgumentValue( OneArgOperator op, float value, double nodataValue )
+{
+  double v = value;
+  if ( v == nodataValue )
+  {
+    return value;
+  }
+
+  switch ( op )
+  {
+    case opSQRT:
+      if ( v < 0 ) //no complex numbers
       {
-        mData[i] = static_cast<float>( mNodataValue );
-        continue;
+        return static_cast<float>( nodataValue );
       }
+      return static_cast<float>( sqrt( v ) );
+    case opSIN:
+      return static_cast<float>( sin( v ) );
+    case opCOS:
+      return static_cast<float>( cos( v ) );
+    case opTAN:
+      return static_cast<float>( tan( v ) );
+    case opASIN:
+      return static_cast<float>( asin( v ) );
+    case opACOS:
+      return static_cast<float>( acos( v ) );
+    case opATAN:
+      return static_cast<float>( atan( v ) );
+    case opSIGN:
+      return static_cast<float>( -v );
+  }
+  return value;
+}
+
+float QgsRasterMatrix::matrixMatrixValue( TwoArgOperator op, float value1, double nodataValue1, float value2, double nodataValue2 )
+{
+  double v1 = value1;
+  double v2 = value2;
+  if ( v1 == nodataValue1 || v2 == nodataValue2 )
+  {
+    return static_cast<float>( nodataValue1 );
+  }
 
-      switch ( op )
+  switch ( op )
+  {
+    case opPLUS:
+      return static_cast<float>( v1 + v2 );
+    case opMINUS:
+      return static_cast<float>( v1 - v2 );
+    case opMUL:
+      return static_cast<float>( v1 * v2 );
+    case opDIV:
+      if ( v2 == 0 )
       {
-        case opPLUS:
-          mData[i] = static_cast<float>( value + matrix[i] );
-          break;
-        case opMINUS:
-          mData[i] = static_cast<float>( value - matrix[i] );
-          break;
-        case opMUL:
-          mData[i] = static_cast<float>( value * matrix[i] );
-          break;
-        case opDIV:
-          if ( matrix[i] == 0 )
-          {
-            mData[i] = static_cast<float>( mNodataValue );
-          }
-          else
-          {
-            mData[i] = static_cast<float>( value / matrix[i] );
-          }
-          break;
-        case opPOW:
-          if ( !testPowerValidity( value, matrix[i] ) )
-          {
-            mData[i] = static_cast<float>( mNodataValue );
-          }
-          else
-          {
-            mData[i] = pow( static_cast<float>( value ), matrix[i] );
-          }
-          break;
-        case opEQ:
-          mData[i] = value == matrix[i] ? 1.0f : 0.0f;
-          break;
-        case opNE:
-          mData[i] = value == matrix[i] ? 0.0f : 1.0f;
-          break;
-        case opGT:
-          mData[i] = value > matrix[i] ? 1.0f : 0.0f;
-          break;
-        case opLT:
-          mData[i] = value < matrix[i] ? 1.0f : 0.0f;
-          break;
-        case opGE:
-          mData[i] = value >= matrix[i] ? 1.0f : 0.0f;
-          break;
-        case opLE:
-          mData[i] = value <= matrix[i] ? 1.0f : 0.0f;
-          break;
-        case opAND:
-          mData[i] = value && matrix[i] ? 1.0f : 0.0f;
-          break;
-        case opOR:
-          mData[i] = value || matrix[i] ? 1.0f : 0.0f;
-          break;
+        return static_cast<float>( nodataValue1 );
       }
-    }
-    return true;
+      return static_cast<float>( v1 / v2 );
+    case opPOW:
+      if ( !testPowerValidity( v1, v2 ) )
+      {
+        return static_cast<float>( nodataValue1 );
+      }
+      return static_cast<float>( pow( v1, v2 ) );
+    case opEQ:
+      return v1 == v2 ? 1.0f : 0.0f;
+    case opNE:
+      return v1 == v2 ? 0.0f : 1.0f;
+    case opGT:
+      return v1 > v2 ? 1.0f : 0.0f;
+    case opLT:
+      return v1 < v2 ? 1.0f : 0.0f;
+    case opGE:
+      return v1 >= v2 ? 1.0f : 0.0f;
+    case opLE:
+      return v1 <= v2 ? 1.0f : 0.0f;
+    case opAND:
+      return v1 && v2 ? 1.0f : 0.0f;
+    case opOR:
+      return v1 || v2 ? 1.0f : 0.0f;
   }
-  else //this matrix is a real matrix and the other a number
+  return value1;
+}
+
+float QgsRasterMatrix::numberMatrixValue( TwoArgOperator op, double number, float value, double nodataValue )
+{
+  if ( number == nodataValue || value == nodataValue )
   {
-    double value = other.number();
-    int nEntries = mColumns * mRows;
+    return static_cast<float>( nodataValue );
+  }
 
-    if ( other.number() == other.mNodataValue )
-    {
-      for ( int i = 0; i < nEntries; ++i )
+  switch ( op )
+  {
+    case opPLUS:
+      return static_cast<float>( number + value );
+    case opMINUS:
+      return static_cast<float>( number - value );
+    case opMUL:
+      return static_cast<float>( number * value );
+    case opDIV:
+      if ( value == 0 )
       {
-        mData[i] = static_cast<float>( mNodataValue );
+        return static_cast<float>( nodataValue );
       }
-      return true;
-    }
-
-    for ( int i = 0; i < nEntries; ++i )
-    {
-      if ( mData[i] == mNodataValue )
+      return static_cast<float>( number / value );
+    case opPOW:
+      if ( !testPowerValidity( number, value ) )
       {
-        continue;
+        return static_cast<float>( nodataValue );
       }
+      return pow( static_cast<float>( number ), value );
+    case opEQ:
+      return number == value ? 1.0f : 0.0f;
+    case opNE:
+      return number == value ? 0.0f : 1.0f;
+    case opGT:
+      return number > value ? 1.0f : 0.0f;
+    case opLT:
+      return number < value ? 1.0f : 0.0f;
+    case opGE:
+      return number >= value ? 1.0f : 0.0f;
+    case opLE:
+      return number <= value ? 1.0f : 0.0f;
+    case opAND:
+      return number && value ? 1.0f : 0.0f;
+    case opOR:
+      return number || value ? 1.0f : 0.0f;
+  }
+  return value;
+}
 
-      switch ( op )
+float QgsRasterMatrix::matrixNumberValue( TwoArgOperator op, float value, double nodataValue, double number, double numberNodataValue )
+{
+  if ( number == numberNodataValue )
+  {
+    return static_cast<float>( nodataValue );
+  }
+  if ( value == nodataValue )
+  {
+    return value;
+  }
+
+  switch ( op )
+  {
+    case opPLUS:
+      return static_cast<float>( value + number );
+    case opMINUS:
+      return static_cast<float>( value - number );
+    case opMUL:
+      return static_cast<float>( value * number );
+    case opDIV:
+      if ( number == 0 )
       {
-        case opPLUS:
-          mData[i] = static_cast<float>( mData[i] + value );
-          break;
-        case opMINUS:
-          mData[i] = static_cast<float>( mData[i] - value );
-          break;
-        case opMUL:
-          mData[i] = static_cast<float>( mData[i] * value );
-          break;
-        case opDIV:
-          if ( value == 0 )
-          {
-            mData[i] = static_cast<float>( mNodataValue );
-          }
-          else
-          {
-            mData[i] = static_cast<float>( mData[i] / value );
-          }
-          break;
-        case opPOW:
-          if ( !testPowerValidity( mData[i], value ) )
-          {
-            mData[i] = static_cast<float>( mNodataValue );
-          }
-          else
-          {
-            mData[i] = pow( mData[i], ( float ) value );
-          }
-          break;
-        case opEQ:
-          mData[i] = mData[i] == value ? 1.0f : 0.0f;
-          break;
-        case opNE:
-          mData[i] = mData[i] == value ? 0.0f : 1.0f;
-          break;
-        case opGT:
-          mData[i] = mData[i] > value ? 1.0f : 0.0f;
-          break;
-        case opLT:
-          mData[i] = mData[i] < value ? 1.0f : 0.0f;
-          break;
-        case opGE:
-          mData[i] = mData[i] >= value ? 1.0f : 0.0f;
-          break;
-        case opLE:
-          mData[i] = mData[i] <= value ? 1.0f : 0.0f;
-          break;
-        case opAND:
-          mData[i] = mData[i] && value ? 1.0f : 0.0f;
-          break;
-        case opOR:
-          mData[i] = mData[i] || value ? 1.0f : 0.0f;
-          break;
+        return static_cast<float>( nodataValue );
       }
-    }
-    return true;
+      return static_cast<float>( value / number );
+    case opPOW:
+      if ( !testPowerValidity( value, number ) )
+      {
+        return static_cast<float>( nodataValue );
+      }
+      return pow( value, ( float ) number );
+    case opEQ:
+      return value == number ? 1.0f : 0.0f;
+    case opNE:
+      return value == number ? 0.0f : 1.0f;
+    case opGT:
+      return value > number ? 1.0f : 0.0f;
+    case opLT:
+      return value < number ? 1.0f : 0.0f;
+    case opGE:
+      return value >= number ? 1.0f : 0.0f;
+    case opLE:
+      return value <= number ? 1.0f : 0.0f;
+    case opAND:
+      return value && number ? 1.0f : 0.0f;
+    case opOR:
+      return value || number ? 1.0f : 0.0f;
   }
+  return value;
 }
 
 bool QgsRasterMatrix::testPowerValidity( double base, double power )
@@ -100,6 +100,19 @@ class ANALYSIS_EXPORT QgsRasterMatrix
     bool atangens();
     bool changeSign();
 
+    /**Calculates an operation for a single cell of a matrix, nodata cells stay unchanged
+      @note added in 1.9*/
+    static float oneArgumentValue( OneArgOperator op, float value, double nodataValue );
+    /**Calculates an operation for a cell of two matrices. The result is nodata (nodataValue1) if one of the cells is nodata
+      @note added in 1.9*/
+    static float matrixMatrixValue( TwoArgOperator op, float value1, double nodataValue1, float value2, double nodataValue2 );
+    /**Calculates an operation for a number (left operand) and a cell of a matrix (with the nodata value of the matrix)
+      @note added in 1.9*/
+    static float numberMatrixValue( TwoArgOperator op, double number, float value, double nodataValue );
+    /**Calculates an operation for a cell of a matrix (with the nodata value of the matrix) and a number (right operand)
+      @note added in 1.9*/
+    static float matrixNumberValue( TwoArgOperator op, float value, double nodataValue, double number, double numberNodataValue );
+
   private:
     int mColumns;
     int mRows;
@@ -110,7 +123,7 @@ class ANALYSIS_EXPORT QgsRasterMatrix
     bool twoArgumentOperation( TwoArgOperator op, const QgsRasterMatrix& other );
     /*sqrt, sin, cos, tan, asin, acos, atan*/
     bool oneArgumentOperation( OneArgOperator op );
-    bool testPowerValidity( double base, double power );
+    static bool testPowerValidity( double base, double power );
 };
 
 #endif // QGSRASTERMATRIX_H
@@ -92,3 +92,7 @@ float QgsRuggednessFilter::processNineCellWindow( float* x11, float* x21, float*
   return sqrt( sum );
 }
 
+void QgsRuggednessFilter::processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells )
+{
+  processNineCellRowWith( this, rowAbove, row, rowBelow, result, nCells );
+}
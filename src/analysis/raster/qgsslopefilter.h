@@ -32,6 +32,9 @@ class ANALYSIS_EXPORT QgsSlopeFilter: public QgsDerivativeFilter
     float processNineCellWindow( float* x11, float* x21, float* x31,
                                  float* x12, float* x22, float* x32,
                                  float* x13, float* x23, float* x33 );
+
+    /**Calculates a row with processNineCellWindow of this class*/
+    void processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells );
 };
 
 #endif // QGSSLOPEFILTER_H
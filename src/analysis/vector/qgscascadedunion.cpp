@@ -0,0 +1,188 @@
+/***************************************************************************
+                          qgscascadedunion.cpp  -  description
+                          ------------------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgscascadedunion.h"
+#include "qgsgeometry.h"
+#include "qgslogger.h"
+#include <cmath>
+
+QgsCascadedUnion::QgsCascadedUnion( const QgsRectangle& extent, int gridSize ): mExtent( extent ), mGridSize( gridSize ), mFailed( false )
+{
+  if ( mGridSize < 1 || mExtent.isEmpty() )
+  {
+    mGridSize = 1;
+  }
+}
+
+QgsCascadedUnion::~QgsCascadedUnion()
+{
+  QMap<int, QList<QgsGeometry*> >::iterator cellIt = mCells.begin();
+  for ( ; cellIt != mCells.end(); ++cellIt )
+  {
+    qDeleteAll( cellIt.value() );
+  }
+}
+
+void QgsCascadedUnion::addGeometry( QgsGeometry* geometry )
+{
+  if ( !geometry )
+  {
+    return;
+  }
+  if ( mFailed )
+  {
+    //the result is discarded anyway
+    delete geometry;
+    return;
+  }
+
+  int cell = 0;
+  if ( mGridSize > 1 )
+  {
+    cell = cellIndex( geometry->boundingBox() );
+  }
+  if ( !addToLevels( mCells[cell], geometry ) )
+  {
+    mFailed = true;
+  }
+}
+
+QgsGeometry* QgsCascadedUnion::takeResult()
+{
+  //merge the cells in a balanced tree too
+  QList<QgsGeometry*> levels;
+  QMap<int, QList<QgsGeometry*> >::iterator cellIt = mCells.begin();
+  for ( ; cellIt != mCells.end(); ++cellIt )
+  {
+    if ( mFailed )
+    {
+      qDeleteAll( cellIt.value() );
+      continue;
+    }
+    QgsGeometry* cellUnion = mergeLevels( cellIt.value() );
+    if ( !cellUnion || !addToLevels( levels, cellUnion ) )
+    {
+      mFailed = true;
+    }
+  }
+  mCells.clear();
+
+  QgsGeometry* result = 0;
+  if ( mFailed )
+  {
+    qDeleteAll( levels );
+  }
+  else
+  {
+    result = mergeLevels( levels );
+  }
+  mFailed = false;
+  return result;
+}
+
+int QgsCascadedUnion::gridSizeForFeatureCount( long featureCount )
+{
+  //aim at some hundred geometries per cell, but avoid a huge number of cells
+  if ( featureCount <= 0 )
+  {
+    return 1;
+  }
+  int gridSize = ( int ) ceil( sqrt( featureCount / 256.0 ) );
+  return qBound( 1, gridSize, 64 );
+}
+
+bool QgsCascadedUnion::addToLevels( QList<QgsGeometry*>& levels, QgsGeometry* geometry )
+{
+  //like incrementing a binary counter: merge with the partial union of equal size as long as there is one
+  int level = 0;
+  while ( level < levels.size() && levels[level] )
+  {
+    QgsGeometry* merged = levels[level]->combine( geometry );
+    delete geometry;
+    if ( !merged )
+    {
+      QgsDebugMsg( "union of two geometries failed" );
+      return false;
+    }
+    delete levels[level];
+    levels[level] = 0;
+    geometry = merged;
+    ++level;
+  }
+
+  if ( level < levels.size() )
+  {
+    levels[level] = geometry;
+  }
+  else
+  {
+    levels.append( geometry );
+  }
+  return true;
+}
+
+QgsGeometry* QgsCascadedUnion::mergeLevels( QList<QgsGeometry*>& levels )
+{
+  QgsGeometry* result = 0;
+  QList<QgsGeometry*>::iterator levelIt = levels.begin();
+  for ( ; levelIt != levels.end(); ++levelIt )
+  {
+    QgsGeometry* geometry = *levelIt;
+    if ( !geometry )
+    {
+      continue;
+    }
+
+    if ( !result )
+    {
+      result = geometry;
+      continue;
+    }
+
+    QgsGeometry* merged = result->combine( geometry );
+    delete result;
+    delete geometry;
+    result = merged;
+    if ( !result )
+    {
+      QgsDebugMsg( "union of two geometries failed" );
+      //delete the remaining levels
+      for ( ++levelIt; levelIt != levels.end(); ++levelIt )
+      {
+        delete *levelIt;
+      }
+      break;
+    }
+  }
+  levels.clear();
+  return result;
+}
+
+int QgsCascadedUnion::cellIndex( const QgsRectangle& bbox ) const
+{
+  QgsPoint center = bbox.center();
+  int column = ( int )(( center.x() - mExtent.xMinimum() ) / mExtent.width() * mGridSize );
+  int row = ( int )(( center.y() - mExtent.yMinimum() ) / mExtent.height() * mGridSize );
+  column = qBound( 0, column, mGridSize - 1 );
+  row = qBound( 0, row, mGridSize - 1 );
+
+  //serpentine order: consecutive cell indices are always neighbours
+  if ( row % 2 == 1 )
+  {
+    column = mGridSize - 1 - column;
+  }
+  return row * mGridSize + column;
+}
@@ -0,0 +1,72 @@
+/***************************************************************************
+                          qgscascadedunion.h  -  description
+                          ----------------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSCASCADEDUNION_H
+#define QGSCASCADEDUNION_H
+
+#include "qgsrectangle.h"
+#include <QList>
+#include <QMap>
+
+class QgsGeometry;
+
+/**Computes the union of a stream of geometries. Instead of merging every geometry into one ever-growing
+  result, geometries are merged pairwise in a balanced tree. Only one partial union per tree level is kept,
+  so the memory needed stays logarithmic in the number of input geometries.
+  If an extent is given, the geometries are additionally grouped by the cells of a regular grid, so that
+  neighbouring geometries are merged first.
+  @note added in 1.9*/
+class ANALYSIS_EXPORT QgsCascadedUnion
+{
+  public:
+    /**@param extent extent of the input geometries (empty rectangle: no spatial grouping)
+      @param gridSize number of grid cells in x- and y-direction used for spatial grouping*/
+    QgsCascadedUnion( const QgsRectangle& extent = QgsRectangle(), int gridSize = 1 );
+    ~QgsCascadedUnion();
+
+    /**Adds a geometry to the union. Takes ownership of the geometry*/
+    void addGeometry( QgsGeometry* geometry );
+
+    /**Returns the union of all added geometries and resets the object. Returns 0 if no geometry was added
+      or if the union of two geometries failed (check isEmpty() before to tell them apart).
+      The caller takes ownership of the returned geometry*/
+    QgsGeometry* takeResult();
+
+    /**Returns true if no geometry has been added since the last call of takeResult()*/
+    bool isEmpty() const { return mCells.isEmpty(); }
+
+    /**Suggests a grid size for a number of input geometries*/
+    static int gridSizeForFeatureCount( long featureCount );
+
+  private:
+    /**Merges a geometry into the partial unions of a binary tree (one partial union per level)
+      @return false if a union failed. The geometry is deleted in this case*/
+    static bool addToLevels( QList<QgsGeometry*>& levels, QgsGeometry* geometry );
+    /**Merges the partial unions of all levels into one geometry. Deletes the partial unions and
+      returns 0 if a union failed*/
+    static QgsGeometry* mergeLevels( QList<QgsGeometry*>& levels );
+    /**Returns the index of the grid cell containing the center of a bounding box*/
+    int cellIndex( const QgsRectangle& bbox ) const;
+
+    QgsRectangle mExtent;
+    int mGridSize;
+    /**Partial unions per grid cell. Ordered by cell index, so that neighbouring cells are merged first*/
+    QMap<int, QList<QgsGeometry*> > mCells;
+    /**A union failed since the last call of takeResult(). Geometries added afterwards are discarded*/
+    bool mFailed;
+};
+
+#endif // QGSCASCADEDUNION_H
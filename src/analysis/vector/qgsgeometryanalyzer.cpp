@@ -16,6 +16,7 @@
  ***************************************************************************/
 
 #include "qgsgeometryanalyzer.h"
+#include "qgscascadedunion.h"
 
 #include "qgsapplication.h"
 #include "qgsfield.h"
@@ -89,8 +90,7 @@ bool QgsGeometryAnalyzer::simplify( QgsVectorLayer* layer,
   //take all features
   else
   {
-    layer->select( layer->pendingAllAttributesList(), QgsRectangle(), true, false );
-
+    QgsFeatureIterator fit = layer->getFeatures();
 
     int featureCount = layer->featureCount();
     if ( p )
@@ -99,7 +99,7 @@ bool QgsGeometryAnalyzer::simplify( QgsVectorLayer* layer,
     }
     int processedFeatures = 0;
 
-    while ( layer->nextFeature( currentFeature ) )
+    while ( fit.nextFeature( currentFeature ) )
     {
       if ( p )
       {
@@ -135,7 +135,7 @@ void QgsGeometryAnalyzer::simplifyFeature( QgsFeature& f, QgsVectorFileWriter* v
 
   QgsFeature newFeature;
   newFeature.setGeometry( tmpGeometry );
-  newFeature.setAttributeMap( f.attributeMap() );
+  newFeature.copyAttributes( f );
 
   //add it to vector file writer
   if ( vfw )
@@ -251,7 +251,7 @@ void QgsGeometryAnalyzer::centroidFeature( QgsFeature& f, QgsVectorFileWriter* v
 
   QgsFeature newFeature;
   newFeature.setGeometry( tmpGeometry );
-  newFeature.setAttributeMap( f.attributeMap() );
+  newFeature.copyAttributes( f );
 
   //add it to vector file writer
   if ( vfw )
@@ -620,134 +620,123 @@ bool QgsGeometryAnalyzer::dissolve( QgsVectorLayer* layer, const QString& shapef
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), dp->fields(), outputType, &crs );
   QgsFeature currentFeature;
-  QMultiMap<QString, QgsFeatureId> map;
+
+  //one streaming union per dissolve value. The attributes of the first feature are written to the output
+  QMap<QString, QgsCascadedUnion*> unions;
+  QMap<QString, QgsAttributeMap> attributes;
+
+  QgsRectangle extent = layer->extent();
+  int gridSize = 1;
+  int processedFeatures = 0;
 
   if ( onlySelectedFeatures )
   {
     //use QgsVectorLayer::featureAtId
     const QgsFeatureIds selection = layer->selectedFeaturesIds();
+    if ( p )
+    {
+      p->setMaximum( selection.size() );
+    }
+    gridSize = QgsCascadedUnion::gridSizeForFeatureCount( selection.size() );
+
     QgsFeatureIds::const_iterator it = selection.constBegin();
     for ( ; it != selection.constEnd(); ++it )
     {
+      if ( p )
+      {
+        p->setValue( processedFeatures );
+      }
+      if ( p && p->wasCanceled() )
+      {
+        break;
+      }
       if ( !layer->featureAtId( *it, currentFeature, true, true ) )
       {
         continue;
       }
-      map.insert( currentFeature.attributeMap()[ uniqueIdField ].toString(), currentFeature.id() );
+      dissolveFeature( currentFeature, useField, uniqueIdField, extent, gridSize, unions, attributes );
+      ++processedFeatures;
     }
   }
+  //take all features
   else
   {
-    layer->select( layer->pendingAllAttributesList(), QgsRectangle(), true, false );
-    while ( layer->nextFeature( currentFeature ) )
+    int featureCount = layer->featureCount();
+    if ( p )
     {
-      map.insert( currentFeature.attributeMap()[ uniqueIdField ].toString(), currentFeature.id() );
+      p->setMaximum( featureCount );
     }
-  }
+    gridSize = QgsCascadedUnion::gridSizeForFeatureCount( featureCount );
 
-  QgsGeometry *dissolveGeometry = 0; //dissolve geometry
-  QMultiMap<QString, QgsFeatureId>::const_iterator jt = map.constBegin();
-  QgsFeature outputFeature;
-  while ( jt != map.constEnd() )
-  {
-    QString currentKey = jt.key();
-    int processedFeatures = 0;
-    bool first = true;
-    //take only selection
-    if ( onlySelectedFeatures )
+    QgsFeatureIterator fit = layer->getFeatures();
+    while ( fit.nextFeature( currentFeature ) )
     {
-      //use QgsVectorLayer::featureAtId
-      const QgsFeatureIds selection = layer->selectedFeaturesIds();
       if ( p )
       {
-        p->setMaximum( selection.size() );
+        p->setValue( processedFeatures );
       }
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
+      if ( p && p->wasCanceled() )
       {
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( selection.contains( jt.value() ) )
-        {
-          if ( p )
-          {
-            p->setValue( processedFeatures );
-          }
-          if ( !layer->featureAtId( jt.value(), currentFeature, true, true ) )
-          {
-            continue;
-          }
-          if ( first )
-          {
-            outputFeature.setAttributeMap( currentFeature.attributeMap() );
-            first = false;
-          }
-          dissolveFeature( currentFeature, processedFeatures, &dissolveGeometry );
-          ++processedFeatures;
-        }
-        ++jt;
+        break;
       }
+      dissolveFeature( currentFeature, useField, uniqueIdField, extent, gridSize, unions, attributes );
+      ++processedFeatures;
     }
-    //take all features
-    else
-    {
-      int featureCount = layer->featureCount();
-      if ( p )
-      {
-        p->setMaximum( featureCount );
-      }
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p )
-        {
-          p->setValue( processedFeatures );
-        }
+  }
 
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( !layer->featureAtId( jt.value(), currentFeature, true, true ) )
-        {
-          continue;
-        }
-        {
-          outputFeature.setAttributeMap( currentFeature.attributeMap() );
-          first = false;
-        }
-        dissolveFeature( currentFeature, processedFeatures, &dissolveGeometry );
-        ++processedFeatures;
-        ++jt;
-      }
+  bool unionFailed = false;
+  QMap<QString, QgsCascadedUnion*>::iterator unionIt = unions.begin();
+  for ( ; unionIt != unions.end(); ++unionIt )
+  {
+    bool empty = unionIt.value()->isEmpty();
+    QgsGeometry* dissolveGeometry = unionIt.value()->takeResult();
+    delete unionIt.value();
+    if ( !dissolveGeometry )
+    {
+      unionFailed = unionFailed || !empty;
+      continue;
     }
+
+    QgsFeature outputFeature;
+    outputFeature.setAttributeMap( attributes.value( unionIt.key() ) );
     outputFeature.setGeometry( dissolveGeometry );
     vWriter.addFeature( outputFeature );
   }
+
+  if ( p )
+  {
+    p->setValue( p->maximum() );
+  }
+  if ( unionFailed )
+  {
+    QgsDebugMsg( "the union of the geometries of a dissolve value failed" );
+    return false;
+  }
   return true;
 }
 
-void QgsGeometryAnalyzer::dissolveFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry )
+void QgsGeometryAnalyzer::dissolveFeature( QgsFeature& f, bool useField, int uniqueIdField, const QgsRectangle& extent, int gridSize,
+    QMap<QString, QgsCascadedUnion*>& unions, QMap<QString, QgsAttributeMap>& attributes )
 {
-  QgsGeometry* featureGeometry = f.geometry();
-
-  if ( !featureGeometry )
+  if ( !f.geometry() )
   {
     return;
   }
 
-  if ( nProcessedFeatures == 0 )
+  QString key;
+  if ( useField )
   {
-    int geomSize = featureGeometry->wkbSize();
-    *dissolveGeometry = new QgsGeometry();
-    unsigned char* wkb = new unsigned char[geomSize];
-    memcpy( wkb, featureGeometry->asWkb(), geomSize );
-    ( *dissolveGeometry )->fromWkb( wkb, geomSize );
+    key = f.attributeMap()[ uniqueIdField ].toString();
   }
-  else
+
+  QgsCascadedUnion* dissolveUnion = unions.value( key );
+  if ( !dissolveUnion )
   {
-    *dissolveGeometry = ( *dissolveGeometry )->combine( featureGeometry );
+    dissolveUnion = new QgsCascadedUnion( extent, gridSize );
+    unions.insert( key, dissolveUnion );
+    attributes.insert( key, f.attributeMap() );
   }
+  dissolveUnion->addGeometry( f.geometryAndOwnership() );
 }
 
 bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefileName, double bufferDistance,
@@ -773,7 +762,10 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), dp->fields(), outputType, &crs );
   QgsFeature currentFeature;
-  QgsGeometry *dissolveGeometry = 0; //dissolve geometry (if dissolve enabled)
+
+  //dissolve geometry (if dissolve enabled)
+  int dissolveGridSize = QgsCascadedUnion::gridSizeForFeatureCount( onlySelectedFeatures ? layer->selectedFeatureCount() : layer->featureCount() );
+  QgsCascadedUnion dissolveUnion( layer->extent(), dissolveGridSize );
 
   //take only selection
   if ( onlySelectedFeatures )
@@ -802,7 +794,7 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
       {
         continue;
       }
-      bufferFeature( currentFeature, processedFeatures, &vWriter, dissolve, &dissolveGeometry, bufferDistance, bufferDistanceField );
+      bufferFeature( currentFeature, &vWriter, dissolve, &dissolveUnion, bufferDistance, bufferDistanceField );
       ++processedFeatures;
     }
 
@@ -814,8 +806,7 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
   //take all features
   else
   {
-    layer->select( layer->pendingAllAttributesList(), QgsRectangle(), true, false );
-
+    QgsFeatureIterator fit = layer->getFeatures();
 
     int featureCount = layer->featureCount();
     if ( p )
@@ -824,7 +815,7 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
     }
     int processedFeatures = 0;
 
-    while ( layer->nextFeature( currentFeature ) )
+    while ( fit.nextFeature( currentFeature ) )
     {
       if ( p )
       {
@@ -834,7 +825,7 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
       {
         break;
       }
-      bufferFeature( currentFeature, processedFeatures, &vWriter, dissolve, &dissolveGeometry, bufferDistance, bufferDistanceField );
+      bufferFeature( currentFeature, &vWriter, dissolve, &dissolveUnion, bufferDistance, bufferDistanceField );
       ++processedFeatures;
     }
     if ( p )
@@ -846,9 +837,11 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
   if ( dissolve )
   {
     QgsFeature dissolveFeature;
+    bool empty = dissolveUnion.isEmpty();
+    QgsGeometry* dissolveGeometry = dissolveUnion.takeResult();
     if ( !dissolveGeometry )
     {
-      QgsDebugMsg( "no dissolved geometry - should not happen" );
+      QgsDebugMsg( empty ? "no dissolved geometry - should not happen" : "the union of the buffers failed" );
       return false;
     }
     dissolveFeature.setGeometry( dissolveGeometry );
@@ -857,12 +850,11 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
   return true;
 }
 
-void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, int nProcessedFeatures, QgsVectorFileWriter* vfw, bool dissolve,
-    QgsGeometry** dissolveGeometry, double bufferDistance, int bufferDistanceField )
+void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, QgsVectorFileWriter* vfw, bool dissolve,
+    QgsCascadedUnion* dissolveUnion, double bufferDistance, int bufferDistanceField )
 {
   double currentBufferDistance;
   QgsGeometry* featureGeometry = f.geometry();
-  QgsGeometry* tmpGeometry = 0;
   QgsGeometry* bufferGeometry = 0;
 
   if ( !featureGeometry )
@@ -883,23 +875,13 @@ void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, int nProcessedFeatures,
 
   if ( dissolve )
   {
-    if ( nProcessedFeatures == 0 )
-    {
-      *dissolveGeometry = bufferGeometry;
-    }
-    else
-    {
-      tmpGeometry = *dissolveGeometry;
-      *dissolveGeometry = ( *dissolveGeometry )->combine( bufferGeometry );
-      delete tmpGeometry;
-      delete bufferGeometry;
-    }
+    dissolveUnion->addGeometry( bufferGeometry );
   }
   else //dissolve
   {
     QgsFeature newFeature;
     newFeature.setGeometry( bufferGeometry );
-    newFeature.setAttributeMap( f.attributeMap() );
+    newFeature.copyAttributes( f );
 
     //add it to vector file writer
     if ( vfw )
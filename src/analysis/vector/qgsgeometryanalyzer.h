@@ -25,6 +25,7 @@
 #include "qgsfield.h"
 #include "qgsdistancearea.h"
 
+class QgsCascadedUnion;
 class QgsVectorFileWriter;
 class QProgressDialog;
 
@@ -132,12 +133,13 @@ class ANALYSIS_EXPORT QgsGeometryAnalyzer
     /**Helper function to get the cetroid of an individual feature*/
     void centroidFeature( QgsFeature& f, QgsVectorFileWriter* vfw );
     /**Helper function to buffer an individual feature*/
-    void bufferFeature( QgsFeature& f, int nProcessedFeatures, QgsVectorFileWriter* vfw, bool dissolve, QgsGeometry** dissolveGeometry,
+    void bufferFeature( QgsFeature& f, QgsVectorFileWriter* vfw, bool dissolve, QgsCascadedUnion* dissolveUnion,
                         double bufferDistance, int bufferDistanceField );
     /**Helper function to get the convex hull of feature(s)*/
     void convexFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry );
-    /**Helper function to dissolve feature(s)*/
-    void dissolveFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry );
+    /**Helper function to dissolve feature(s): adds the geometry to the union of its dissolve value*/
+    void dissolveFeature( QgsFeature& f, bool useField, int uniqueIdField, const QgsRectangle& extent, int gridSize,
+                          QMap<QString, QgsCascadedUnion*>& unions, QMap<QString, QgsAttributeMap>& attributes );
 
     //helper functions for event layer
 
@@ -546,8 +546,14 @@ void QgsAttributeTableDialog::doSearch( QString searchString )
     QMessageBox::critical( this, tr( "Evaluation error" ), search.evalErrorString() );
   }
 
-  // TODO: fetch only necessary columns
-  //QStringList columns = search.referencedColumns();
+  // fetch only the referenced columns, the expression is evaluated for blocks of features
+  QgsAttributeList attributes;
+  foreach( QString column, search.referencedColumns() )
+  {
+    int idx = mLayer->fieldNameIndex( column );
+    if ( idx >= 0 )
+      attributes << idx;
+  }
   bool fetchGeom = search.needsGeometry();
 
   QApplication::setOverrideCursor( Qt::WaitCursor );
@@ -556,30 +562,39 @@ void QgsAttributeTableDialog::doSearch( QString searchString )
   if ( cbxSearchSelectedOnly->isChecked() )
   {
     QgsFeatureList selectedFeatures = mLayer->selectedFeatures();
-    for ( QgsFeatureList::Iterator it = selectedFeatures.begin(); it != selectedFeatures.end(); ++it )
+    QgsExpressionColumn values = search.evaluate( QgsExpressionBlock( selectedFeatures, attributes ) );
+    for ( int row = 0; row < selectedFeatures.count(); ++row )
     {
-      QgsFeature& feat = *it;
-      if ( search.evaluate( &feat ).toInt() != 0 )
-        mSelectedFeatures << feat.id();
-
-      // check if there were errors during evaluating
-      if ( search.hasEvalError() )
-        break;
+      if ( values.value( row ).toInt() != 0 )
+        mSelectedFeatures << selectedFeatures[row].id();
     }
   }
   else
   {
-    mLayer->select( mLayer->pendingAllAttributesList(), QgsRectangle(), fetchGeom );
+    const int blockSize = 1000;
+    QgsFeatureList features;
     QgsFeature f;
+    bool atEnd = false;
 
-    while ( mLayer->nextFeature( f ) )
+    mLayer->select( attributes, QgsRectangle(), fetchGeom );
+    while ( !atEnd )
     {
-      if ( search.evaluate( &f ).toInt() != 0 )
-        mSelectedFeatures << f.id();
+      features.clear();
+      while ( features.count() < blockSize && mLayer->nextFeature( f ) )
+        features << f;
+      atEnd = features.count() < blockSize;
+
+      QgsExpressionColumn values = search.evaluate( QgsExpressionBlock( features, attributes ) );
 
       // check if there were errors during evaluating
       if ( search.hasEvalError() )
         break;
+
+      for ( int row = 0; row < features.count(); ++row )
+      {
+        if ( values.value( row ).toInt() != 0 )
+          mSelectedFeatures << features[row].id();
+      }
     }
   }
 
@@ -22,6 +22,7 @@
 #include "qgis.h" //<--magick numbers
 #include "qgisapp.h" //<--theme icons
 #include "qgsapplication.h"
+#include "qgscrscatalogue.h"
 #include "qgslogger.h"
 
 //qt includes
@@ -133,6 +134,7 @@ void QgsCustomProjectionDialog::on_pbnDelete_clicked()
   // close the sqlite3 statement
   sqlite3_finalize( myPreparedStatement );
   sqlite3_close( myDatabase );
+  QgsCRSCatalogue::instance()->invalidate();
   //move to an appropriate rec now this one is gone
   --mRecordCountLong;
   if ( mRecordCountLong < 1 )
@@ -772,6 +774,7 @@ void QgsCustomProjectionDialog::on_pbnSave_clicked()
   }
   myResult = sqlite3_prepare( myDatabase, mySql.toUtf8(), mySql.toUtf8().length(), &myPreparedStatement, &myTail );
   sqlite3_step( myPreparedStatement );
+  QgsCRSCatalogue::instance()->invalidate();
   // XXX Need to free memory from the error msg if one is set
   if ( myResult != SQLITE_OK )
   {
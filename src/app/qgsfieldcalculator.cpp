@@ -137,20 +137,39 @@ void QgsFieldCalculator::accept()
   bool useGeometry = exp.needsGeometry();
   int rownum = 1;
 
-  mVectorLayer->select( mVectorLayer->pendingAllAttributesList(), QgsRectangle(), useGeometry, false );
-  while ( mVectorLayer->nextFeature( feature ) )
+  // only the referenced attributes are fetched, the expression is evaluated for blocks of features
+  QgsAttributeList attributes;
+  foreach( QString column, exp.referencedColumns() )
   {
-    if ( onlySelected )
+    int idx = mVectorLayer->fieldNameIndex( column );
+    if ( idx >= 0 )
+      attributes << idx;
+  }
+
+  const int blockSize = 1000;
+  QgsFeatureList features;
+  bool atEnd = false;
+
+  mVectorLayer->select( attributes, QgsRectangle(), useGeometry, false );
+  while ( !atEnd )
+  {
+    features.clear();
+    while ( features.count() < blockSize && mVectorLayer->nextFeature( feature ) )
     {
-      if ( !selectedIds.contains( feature.id() ) )
+      if ( onlySelected )
       {
-        continue;
+        if ( !selectedIds.contains( feature.id() ) )
+        {
+          continue;
+        }
       }
+      features << feature;
     }
+    atEnd = features.count() < blockSize;
 
     exp.setCurrentRowNumber( rownum );
 
-    QVariant value = exp.evaluate( &feature );
+    QgsExpressionColumn values = exp.evaluate( QgsExpressionBlock( features, attributes ) );
     if ( exp.hasEvalError() )
     {
       calculationSuccess = false;
@@ -159,10 +178,13 @@ void QgsFieldCalculator::accept()
     }
     else
     {
-      mVectorLayer->changeAttributeValue( feature.id(), mAttributeId, value, false );
+      for ( int row = 0; row < features.count(); ++row )
+      {
+        mVectorLayer->changeAttributeValue( features[row].id(), mAttributeId, values.value( row ), false );
+      }
     }
 
-    rownum++;
+    rownum += features.count();
   }
 
   // stop blocking layerModified signals and make sure that one layerModified signal is emitted
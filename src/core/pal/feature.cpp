@@ -62,7 +62,7 @@
 namespace pal
 {
   Feature::Feature( Layer* l, const char* geom_id, PalGeometry* userG, double lx, double ly )
-      : layer( l ), userGeom( userG ), label_x( lx ), label_y( ly ), distlabel( 0 ), labelInfo( NULL ), fixedPos( false ), fixedRotation( false )
+      : layer( l ), userGeom( userG ), label_x( lx ), label_y( ly ), distlabel( 0 ), labelInfo( NULL ), fixedPos( false ), fixedRotation( false ), candidatesCache( NULL )
   {
     uid = new char[strlen( geom_id ) +1];
     strcpy( uid, geom_id );
@@ -1234,14 +1234,30 @@ namespace pal
 #endif
                               )
   {
-    int nbp = 0;
-    int i;
-    double bbox[4];
-
 #ifdef _EXPORT_MAP_
     int dpi = layer->pal->getDpi();
 #endif
 
+    LabelPosition **indexOrder = NULL;
+    int rnbp = createCandidates( scale, lPos, bbox_min, bbox_max, mapShape, &indexOrder );
+
+    for ( int i = 0; i < rnbp; i++ )
+    {
+      indexOrder[i]->insertIntoIndex( candidates );
+    }
+    delete[] indexOrder;
+
+    return rnbp;
+  }
+
+  int FeaturePart::createCandidates( double scale, LabelPosition ***lPos,
+                                     double bbox_min[2], double bbox_max[2],
+                                     PointSet *mapShape, LabelPosition ***indexOrder )
+  {
+    int nbp = 0;
+    int i;
+    double bbox[4];
+
     bbox[0] = bbox_min[0];
     bbox[1] = bbox_min[1];
     bbox[2] = bbox_max[0];
@@ -1249,7 +1265,18 @@ namespace pal
 
     double delta = bbox_max[0] - bbox_min[0];
 
-    if ( f->fixedPosition() )
+    if ( f->candidatesCache && !f->candidatesCache->empty() )
+    {
+      // candidates generated by a previous labeling
+      nbp = f->candidatesCache->size();
+      *lPos = new LabelPosition *[nbp];
+      for ( i = 0; i < nbp; i++ )
+      {
+        ( *lPos )[i] = new LabelPosition( *( *f->candidatesCache )[i] );
+        ( *lPos )[i]->setFeaturePart( this );
+      }
+    }
+    else if ( f->fixedPosition() )
     {
       nbp = 1;
       *lPos = new LabelPosition *[nbp];
@@ -1299,19 +1326,25 @@ namespace pal
       }
     }
 
-    int rnbp = nbp;
+    if ( f->candidatesCache && f->candidatesCache->empty() )
+    {
+      for ( i = 0; i < nbp; i++ )
+        f->candidatesCache->push_back( new LabelPosition( *( *lPos )[i] ) );
+    }
+
+    int rnbp = 0;
+    *indexOrder = new LabelPosition*[nbp];
 
     // purge candidates that are outside the bbox
     for ( i = 0; i < nbp; i++ )
     {
       if ( !( *lPos )[i]->isIn( bbox ) )
       {
-        rnbp--;
         ( *lPos )[i]->setCost( DBL_MAX ); // infinite cost => do not use
       }
       else   // this one is OK
       {
-        ( *lPos )[i]->insertIntoIndex( candidates );
+        ( *indexOrder )[rnbp++] = ( *lPos )[i];
       }
     }
 
@@ -37,6 +37,7 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <vector>
 
 #include <geos_c.h>
 
@@ -91,6 +92,14 @@ namespace pal
       bool fixedPosition() const { return fixedPos; }
       //Set label rotation to fixed value
       void setFixedAngle( double a ) { fixedRotation = true; fixedAngle = a; }
+      /**
+       * \brief Set the candidates kept by the caller for the feature between labelings
+       * If the cache holds candidates, they are copied instead of generating new ones,
+       * an empty cache gets copies of the generated candidates. The caller owns the cache
+       * and has to make sure it was built for the same geometry, label size and map scale.
+       * Only for features with a single part.
+       */
+      void setCandidatesCache( std::vector<LabelPosition*>* cache ) { candidatesCache = cache; }
 
     protected:
       Layer *layer;
@@ -109,6 +118,8 @@ namespace pal
       bool fixedRotation;
       double fixedAngle; //fixed angle value (in rad)
 
+      std::vector<LabelPosition*>* candidatesCache; // optional
+
       // array of parts - possibly not necessary
       //int nPart;
       //FeaturePart** parts;
@@ -244,6 +255,20 @@ namespace pal
 #endif
                      );
 
+      /**
+       * \brief generate candidates without adding them to an index
+       * Does the work of setPosition() except inserting into the candidates index,
+       * so that it can run for several features at the same time.
+       * \param scale the map scale is 1:scale
+       * \param lPos pointer to candidates array in which candidates will be put, sorted by cost
+       * \param bbox_min min values of the map extent
+       * \param bbox_max max values of the map extent
+       * \param mapShape generate candidates for this spatial entites
+       * \param indexOrder receives the candidates of *lPos in the order setPosition() inserts them into the index
+       * \return the number of candidates in *lPos
+       */
+      int createCandidates( double scale, LabelPosition ***lPos, double bbox_min[2], double bbox_max[2], PointSet *mapShape, LabelPosition ***indexOrder );
+
       /**
        * \brief get the unique id of the feature
        * \return the feature unique identifier
@@ -55,7 +55,7 @@
 namespace pal
 {
   LabelPosition::LabelPosition( int id, double x1, double y1, double w, double h, double alpha, double cost, FeaturePart *feature, bool isReversed )
-      : id( id ), cost( cost ), feature( feature ), nbOverlap( 0 ), alpha( alpha ), w( w ), h( h ), nextPart( NULL ), partId( -1 ), reversed( isReversed ), upsideDown( false )
+      : id( id ), cost( cost ), feature( feature ), nbOverlap( 0 ), alpha( alpha ), w( w ), h( h ), nextPart( NULL ), partId( -1 ), reversed( isReversed ), upsideDown( false ), preferred( false )
   {
 
     // alpha take his value bw 0 and 2*pi rad
@@ -139,7 +139,9 @@ namespace pal
     else
       nextPart = NULL;
     partId = other.partId;
+    reversed = other.reversed;
     upsideDown = other.upsideDown;
+    preferred = other.preferred;
   }
 
   bool LabelPosition::isIn( double *bbox )
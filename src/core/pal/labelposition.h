@@ -81,6 +81,9 @@ namespace pal
 
       bool upsideDown;
 
+      // placed in a previous labeling, see Problem::init_sol_falp()
+      bool preferred;
+
       bool isInConflictSinglePart( LabelPosition* lp );
       bool isInConflictMultiPart( LabelPosition* lp );
 
@@ -203,6 +206,13 @@ namespace pal
       void print();
 
       LabelPosition* getNextPart() const { return nextPart; }
+
+      /** set the feature part of the label and of its next parts, used for copies of cached candidates */
+      void setFeaturePart( FeaturePart* part ) { feature = part; if ( nextPart ) nextPart->setFeaturePart( part ); }
+
+      /** whether the candidate is placed before any other of its feature when building the initial solution */
+      bool isPreferred() const { return preferred; }
+      void setPreferred( bool isPreferred ) { preferred = isPreferred; }
       void setNextPart( LabelPosition* next ) { nextPart = next; }
 
       // -1 if not multi-part
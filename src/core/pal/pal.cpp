@@ -34,6 +34,7 @@
 //#define _VERBOSE_
 //#define _EXPORT_MAP_
 #include <QTime>
+#include <QtConcurrentMap>
 
 #define _CRT_SECURE_NO_DEPRECATE
 
@@ -43,6 +44,7 @@
 #include <cstring>
 #include <cfloat>
 #include <list>
+#include <vector>
 //#include <geos/geom/Geometry.h>
 #include <geos_c.h>
 
@@ -93,6 +95,8 @@ namespace pal
     tenure = 10;
     candListSize = 0.2;
 
+    multiThreaded = false;
+
     tabuMinIt = 3;
     tabuMaxIt = 4;
     searchMethod = POPMUSIC_CHAIN;
@@ -196,13 +200,30 @@ namespace pal
   }
 
 
+  struct _featCbackCtx;
+
+  /*
+   * Candidates to generate for a feature part, the candidates of all
+   * extracted parts are generated at once (on several threads if wanted)
+   */
+  typedef struct _candidatesJob
+  {
+    FeaturePart *feature;
+    struct _featCbackCtx *context;
+    double priority;
+    int layer; // index of the layer in extract()
+    int nblp;
+    LabelPosition **lPos;
+    LabelPosition **indexOrder;
+  } CandidatesJob;
+
   typedef struct _featCbackCtx
   {
     Layer *layer;
+    int layerIndex;
     double scale;
-    LinkedList<Feats*> *fFeats;
+    std::vector<CandidatesJob> *jobs;
     RTree<PointSet*, double, 2, double> *obstacles;
-    RTree<LabelPosition*, double, 2, double> *candidates;
     double priority;
     double bbox_min[2];
     double bbox_max[2];
@@ -269,34 +290,28 @@ namespace pal
       }
     }
 
-    // generate candidates for the feature part
-    LabelPosition** lPos = NULL;
-    int nblp = ft_ptr->setPosition( context->scale, &lPos, context->bbox_min, context->bbox_max, ft_ptr, context->candidates
-#ifdef _EXPORT_MAP_
-                                    , *context->svgmap
-#endif
-                                  );
-
-    if ( nblp > 0 )
-    {
-      // valid features are added to fFeats
-      Feats *ft = new Feats();
-      ft->feature = ft_ptr;
-      ft->shape = NULL;
-      ft->nblp = nblp;
-      ft->lPos = lPos;
-      ft->priority = context->priority;
-      context->fFeats->push_back( ft );
-    }
-    else
-    {
-      // Others are deleted
-      delete[] lPos;
-    }
+    // candidates for the feature part are generated later on
+    CandidatesJob job;
+    job.feature = ft_ptr;
+    job.context = context;
+    job.priority = context->priority;
+    job.layer = context->layerIndex;
+    job.nblp = 0;
+    job.lPos = NULL;
+    job.indexOrder = NULL;
+    context->jobs->push_back( job );
 
     return true;
   }
 
+  /*
+   * Generates the candidates of a feature part, without touching anything shared
+   */
+  void createCandidatesJob( CandidatesJob &job )
+  {
+    job.nblp = job.feature->createCandidates( job.context->scale, &job.lPos, job.context->bbox_min, job.context->bbox_max, job.feature, &job.indexOrder );
+  }
+
 
 
 
@@ -372,11 +387,13 @@ namespace pal
 
     LinkedList<Feats*> *fFeats = new LinkedList<Feats*> ( ptrFeatsCompare );
 
+    std::vector<CandidatesJob> jobs;
+    std::vector<Layer*> extractedLayers;
+
     FeatCallBackCtx *context = new FeatCallBackCtx();
-    context->fFeats = fFeats;
+    context->jobs = &jobs;
     context->scale = scale;
     context->obstacles = obstacles;
-    context->candidates = prob->candidates;
 
     context->bbox_min[0] = amin[0];
     context->bbox_min[1] = amin[1];
@@ -398,7 +415,6 @@ namespace pal
     /* First step : extract feature from layers
      *
      * */
-    int oldNbft = 0;
     Layer *layer;
 
     std::list<char*> *labLayers = new std::list<char*>();
@@ -422,6 +438,7 @@ namespace pal
               layer->joinConnectedFeatures();
 
             context->layer = layer;
+            context->layerIndex = extractedLayers.size();
             context->priority = layersFactor[i];
             // lookup for feature (and generates candidates list)
 
@@ -431,9 +448,10 @@ namespace pal
             <<  "    id=\"" << layer->name << "\">" << std::endl << std::endl;
 #endif
 
+            // the layer stays locked until its candidates are generated
             context->layer->modMutex->lock();
             context->layer->rtree->Search( amin, amax, extractFeatCallback, ( void* ) context );
-            context->layer->modMutex->unlock();
+            extractedLayers.push_back( layer );
 
 #ifdef _EXPORT_MAP_
             *svgmap  << "</g>" << std::endl << std::endl;
@@ -446,22 +464,68 @@ namespace pal
             std::cout << "     obstacle:" << layer->isObstacle() << std::endl;
             std::cout << "     toLabel:" << layer->isToLabel() << std::endl;
             std::cout << "     # features: " << layer->getNbFeatures() << std::endl;
-            std::cout << "     # extracted features: " << context->fFeats->size() - oldNbft << std::endl;
 #endif
-            if ( context->fFeats->size() - oldNbft > 0 )
-            {
-              char *name = new char[strlen( layer->getName() ) +1];
-              strcpy( name, layer->getName() );
-              labLayers->push_back( name );
-            }
-            oldNbft = context->fFeats->size();
-
 
             break;
           }
         }
       }
     }
+
+    // generate the candidates, the result does not depend on the threads as
+    // the candidates are added to the index in the order of the features
+    if ( multiThreaded )
+    {
+      QtConcurrent::blockingMap( jobs, createCandidatesJob );
+    }
+    else
+    {
+      for ( unsigned int k = 0; k < jobs.size(); k++ )
+        createCandidatesJob( jobs[k] );
+    }
+
+    std::vector<int> layerNbft( extractedLayers.size(), 0 );
+    for ( unsigned int k = 0; k < jobs.size(); k++ )
+    {
+      CandidatesJob &job = jobs[k];
+      for ( j = 0; j < job.nblp; j++ )
+        job.indexOrder[j]->insertIntoIndex( prob->candidates );
+      delete[] job.indexOrder;
+
+      if ( job.nblp > 0 )
+      {
+        // valid features are added to fFeats
+        Feats *ft = new Feats();
+        ft->feature = job.feature;
+        ft->shape = NULL;
+        ft->nblp = job.nblp;
+        ft->lPos = job.lPos;
+        ft->priority = job.priority;
+        fFeats->push_back( ft );
+        layerNbft[job.layer]++;
+      }
+      else
+      {
+        // Others are deleted
+        delete[] job.lPos;
+      }
+    }
+
+    for ( unsigned int k = 0; k < extractedLayers.size(); k++ )
+    {
+      layer = extractedLayers[k];
+#ifdef _VERBOSE_
+      std::cout << "Layer's name: " << layer->getName() << " # extracted features: " << layerNbft[k] << std::endl;
+#endif
+      if ( layerNbft[k] > 0 )
+      {
+        char *name = new char[strlen( layer->getName() ) +1];
+        strcpy( name, layer->getName() );
+        labLayers->push_back( name );
+      }
+      layer->modMutex->unlock();
+    }
+
     delete context;
     lyrsMutex->unlock();
 
@@ -754,12 +818,7 @@ namespace pal
 #endif
 
     // search a solution
-    if ( searchMethod == FALP )
-      prob->init_sol_falp();
-    else if ( searchMethod == CHAIN )
-      prob->chain_search();
-    else
-      prob->popmusic();
+    solve( prob );
 
     std::cout << "PAL SEARCH (" << searchMethod << "): " << t.elapsed() / 1000.0 << " s" << std::endl;
     t.restart();
@@ -830,14 +889,55 @@ namespace pal
 
     prob->reduce();
 
-    if ( searchMethod == FALP )
+    solve( prob );
+
+    return prob->getSolution( displayAll );
+  }
+
+  void Pal::solve( Problem* prob )
+  {
+    // features that can't get into conflict with each other are solved apart,
+    // the components are always split up so that the solution is the same with
+    // and without threads
+    std::vector<Problem*> components = prob->splitIntoComponents();
+    if ( components.empty() )
+    {
+      solveComponent( prob );
+      return;
+    }
+
+    if ( multiThreaded )
+    {
+      QtConcurrent::blockingMap( components, solveComponent );
+    }
+    else
+    {
+      for ( unsigned int i = 0; i < components.size(); i++ )
+        solveComponent( components[i] );
+    }
+
+    prob->mergeComponents( components );
+  }
+
+  void Pal::solveComponent( Problem* prob )
+  {
+    SearchMethod method = prob->pal->searchMethod;
+    if ( method == FALP )
       prob->init_sol_falp();
-    else if ( searchMethod == CHAIN )
+    else if ( method == CHAIN )
       prob->chain_search();
     else
       prob->popmusic();
+  }
 
-    return prob->getSolution( displayAll );
+  void Pal::setMultiThreaded( bool enabled )
+  {
+    multiThreaded = enabled;
+  }
+
+  bool Pal::isMultiThreaded()
+  {
+    return multiThreaded;
   }
 
 
@@ -167,6 +167,23 @@ namespace pal
       int tenure;
       double candListSize;
 
+      /**
+       * \brief generate candidates and solve problems on a thread pool
+       */
+      bool multiThreaded;
+
+      /**
+       * \brief search a solution of a reduced problem
+       * The problem is split into independent components which are solved one by one
+       * or at the same time if multi threaded, the solution is the same in both cases.
+       */
+      void solve( Problem* prob );
+
+      /**
+       * \brief search a solution of a (sub) problem with the search method in use
+       */
+      static void solveComponent( Problem* prob );
+
       /**
        * \brief Problem factory
        * Extract features to label and generates candidates for them,
@@ -419,6 +436,20 @@ namespace pal
        * @return the search method
        */
       SearchMethod getSearch();
+
+      /**
+       * \brief Generate candidates and solve the problem on the global thread pool
+       *
+       * Independent parts of the problem are solved at the same time. The
+       * labels are the same as with a single thread.
+       * @param enabled whether to use several threads
+       */
+      void setMultiThreaded( bool enabled );
+
+      /**
+       * \brief whether candidates are generated and problems solved on several threads
+       */
+      bool isMultiThreaded();
   };
 } // end namespace pal
 #endif
@@ -73,7 +73,7 @@ namespace pal
     }
   }
 
-  Problem::Problem() : nblp( 0 ), all_nblp( 0 ), nbft( 0 ), displayAll( 0 ), labelpositions( NULL ), featStartId( NULL ), featNbLp( NULL ), inactiveCost( NULL ), sol( NULL )
+  Problem::Problem() : nbLabelledLayers( 0 ), labelledLayersName( NULL ), nblp( 0 ), all_nblp( 0 ), nbft( 0 ), displayAll( 0 ), labelpositions( NULL ), featStartId( NULL ), featNbLp( NULL ), inactiveCost( NULL ), sol( NULL ), nbActive( 0 ), parentFeat( NULL )
   {
     bbox[0] = 0;
     bbox[1] = 0;
@@ -109,8 +109,13 @@ namespace pal
 
     delete[] labelledLayersName;
 
-    for ( i = 0; i < all_nblp; i++ )
-      delete labelpositions[i];
+    // sub problems share the label positions with their parent
+    if ( !parentFeat )
+    {
+      for ( i = 0; i < all_nblp; i++ )
+        delete labelpositions[i];
+    }
+    delete[] parentFeat;
 
     if ( labelpositions )
       delete[] labelpositions;
@@ -347,9 +352,28 @@ namespace pal
         list->insert( label, ( double ) labelpositions[label]->getNumOverlaps() );
       }
 
+    // labels placed by a previous labeling are placed first, so that they stay in place
+    int preferredFeat = 0;
+
     while ( list->getSize() > 0 ) // O (log size)
     {
-      label = list->getBest();   // O (log size)
+      label = -1;
+      for ( ; label == -1 && preferredFeat < nbft; preferredFeat++ )
+      {
+        for ( j = 0; j < featNbLp[preferredFeat]; j++ )
+        {
+          lp = labelpositions[featStartId[preferredFeat] + j];
+          if ( lp->isPreferred() && list->isIn( lp->getId() ) )
+          {
+            label = lp->getId();
+            list->remove( label );
+            break;
+          }
+        }
+      }
+
+      if ( label == -1 )
+        label = list->getBest();   // O (log size)
 
 
       lp = labelpositions[label];
@@ -2939,6 +2963,184 @@ namespace pal
 //#undef _DEBUG_FULL_
 #endif
 
+  typedef struct
+  {
+    LabelPosition *lp;
+    int *component;
+  } ComponentContext;
+
+  inline int findComponent( int *component, int fid )
+  {
+    while ( component[fid] != fid )
+    {
+      component[fid] = component[component[fid]];
+      fid = component[fid];
+    }
+    return fid;
+  }
+
+  bool componentCallback( LabelPosition *lp, void *ctx )
+  {
+    LabelPosition *lp2 = (( ComponentContext* ) ctx )->lp;
+    int *component = (( ComponentContext* ) ctx )->component;
+
+    int c1 = findComponent( component, lp->getProblemFeatureId() );
+    int c2 = findComponent( component, lp2->getProblemFeatureId() );
+
+    // the conflict test is only needed to join two components
+    if ( c1 != c2 && lp->isInConflict( lp2 ) )
+    {
+      // the lower feature id is the root => components are numbered in feature order
+      if ( c1 < c2 )
+        component[c2] = c1;
+      else
+        component[c1] = c2;
+    }
+    return true;
+  }
+
+  std::vector<Problem*> Problem::splitIntoComponents()
+  {
+    std::vector<Problem*> components;
+
+    int i, j;
+    double amin[2];
+    double amax[2];
+    LabelPosition *lp;
+
+    int *component = new int[nbft];
+    for ( i = 0; i < nbft; i++ )
+      component[i] = i;
+
+    ComponentContext context;
+    context.component = component;
+
+    for ( i = 0; i < nbft; i++ )
+    {
+      for ( j = 0; j < featNbLp[i]; j++ )
+      {
+        lp = labelpositions[featStartId[i] + j];
+        lp->getBoundingBox( amin, amax );
+        context.lp = lp;
+        candidates->Search( amin, amax, componentCallback, ( void* ) &context );
+      }
+    }
+
+    // group features by component, features without overlaps go to the first group
+    std::vector< std::vector<int> > groups( 1 );
+    int *group = new int[nbft];
+    int *size = new int[nbft];
+    for ( i = 0; i < nbft; i++ )
+      size[i] = 0;
+    for ( i = 0; i < nbft; i++ )
+      size[findComponent( component, i )]++;
+
+    for ( i = 0; i < nbft; i++ )
+    {
+      int c = findComponent( component, i );
+      if ( size[c] == 1 )
+      {
+        groups[0].push_back( i );
+        continue;
+      }
+      if ( c == i )
+      {
+        group[i] = groups.size();
+        groups.push_back( std::vector<int>() );
+      }
+      groups[group[c]].push_back( i );
+    }
+
+    delete[] size;
+    delete[] group;
+    delete[] component;
+
+    if ( groups[0].empty() )
+      groups.erase( groups.begin() );
+
+    if ( groups.size() < 2 )
+      return components;
+
+    for ( unsigned int g = 0; g < groups.size(); g++ )
+    {
+      std::vector<int> &feats = groups[g];
+
+      Problem *sub = new Problem();
+      sub->pal = pal;
+      sub->scale = scale;
+      sub->displayAll = displayAll;
+      for ( i = 0; i < 4; i++ )
+        sub->bbox[i] = bbox[i];
+
+      sub->nbft = feats.size();
+      sub->parentFeat = new int[sub->nbft];
+      sub->featStartId = new int[sub->nbft];
+      sub->featNbLp = new int[sub->nbft];
+      sub->inactiveCost = new double[sub->nbft];
+
+      int nblp = 0;
+      for ( i = 0; i < sub->nbft; i++ )
+        nblp += featNbLp[feats[i]];
+      sub->labelpositions = new LabelPosition*[nblp];
+
+      int idlp = 0;
+      int nbOverlaps = 0;
+      for ( i = 0; i < sub->nbft; i++ )
+      {
+        int fid = feats[i];
+        sub->parentFeat[i] = fid;
+        sub->featStartId[i] = idlp;
+        sub->featNbLp[i] = featNbLp[fid];
+        sub->inactiveCost[i] = inactiveCost[fid];
+
+        for ( j = 0; j < featNbLp[fid]; j++, idlp++ )
+        {
+          // ids are those of the sub problem until mergeComponents()
+          lp = labelpositions[featStartId[fid] + j];
+          lp->setProblemIds( i, idlp );
+          lp->insertIntoIndex( sub->candidates );
+          sub->labelpositions[idlp] = lp;
+          nbOverlaps += lp->getNumOverlaps();
+        }
+      }
+
+      sub->nblp = sub->all_nblp = nblp;
+      sub->nbOverlap = nbOverlaps / 2;
+      components.push_back( sub );
+    }
+
+    return components;
+  }
+
+  void Problem::mergeComponents( std::vector<Problem*> &components )
+  {
+    int i, j;
+
+    init_sol_empty();
+    sol->cost = 0.0;
+    nbActive = 0;
+
+    for ( unsigned int c = 0; c < components.size(); c++ )
+    {
+      Problem *sub = components[c];
+      for ( i = 0; i < sub->nbft; i++ )
+      {
+        int fid = sub->parentFeat[i];
+        for ( j = 0; j < featNbLp[fid]; j++ )
+          labelpositions[featStartId[fid] + j]->setProblemIds( fid, featStartId[fid] + j );
+
+        if ( sub->sol && sub->sol->s[i] != -1 )
+          sol->s[fid] = featStartId[fid] + sub->sol->s[i] - sub->featStartId[i];
+      }
+
+      if ( sub->sol )
+        sol->cost += sub->sol->cost;
+      nbActive += sub->nbActive;
+      delete sub;
+    }
+    components.clear();
+  }
+
   std::list<LabelPosition*> * Problem::getSolution( bool returnInactive )
   {
 
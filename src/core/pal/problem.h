@@ -35,6 +35,7 @@
 #define _PROBLEM_H
 
 #include <list>
+#include <vector>
 #include <pal/pal.h>
 #include "rtree.hpp"
 
@@ -161,6 +162,12 @@ namespace pal
 
       int *featWrap;
 
+      /**
+       * features of the problem this one was split from (only for sub problems
+       * of splitIntoComponents(), which don't own their label positions)
+       */
+      int *parentFeat; // [nbft]
+
       Chain *chain( SubPart *part, int seed );
 
       Chain *chain( int seed );
@@ -203,6 +210,23 @@ namespace pal
        */
       void chain_search();
 
+      /**
+       * \brief Splits the problem into independent sub problems
+       * Features whose candidates overlap end up in the same sub problem, the features
+       * without any overlap are put together in one sub problem. Sub problems share
+       * the label positions with this problem, they can be solved at the same time
+       * and have to be handed back to mergeComponents() afterwards.
+       * Call it after reduce().
+       * \return the sub problems, empty if the problem can't be split
+       */
+      std::vector<Problem*> splitIntoComponents();
+
+      /**
+       * \brief Builds the solution from the solved sub problems of splitIntoComponents()
+       * The sub problems are deleted.
+       */
+      void mergeComponents( std::vector<Problem*> &components );
+
       std::list<LabelPosition*> * getSolution( bool returnInactive );
 
       PalStat * getStats();
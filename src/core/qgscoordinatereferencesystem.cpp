@@ -28,6 +28,7 @@
 
 #include "qgsapplication.h"
 #include "qgscrscache.h"
+#include "qgscrscatalogue.h"
 #include "qgslogger.h"
 #include "qgsmessagelog.h"
 #include "qgis.h" //const vals declared here
@@ -138,9 +139,13 @@ bool QgsCoordinateReferenceSystem::createFromOgcWmsCrs( QString theCrs )
     return true;
   }
 
-  if ( loadFromDb( QgsApplication::srsDbFilePath(), "lower(auth_name||':'||auth_id)", theCrs.toLower() ) )
+  QgsCRSCatalogue::Record myRecord;
+  if ( QgsCRSCatalogue::instance()->recordByAuthId( theCrs, myRecord ) && loadFromRecord( myRecord ) )
     return true;
 
+  mIsValidFlag = false;
+  mWkt.clear();
+
   if ( theCrs.compare( "CRS:84", Qt::CaseInsensitive ) == 0 )
   {
     createFromSrsId( GEOCRS_ID );
@@ -200,7 +205,14 @@ void QgsCoordinateReferenceSystem::validate()
 
 bool QgsCoordinateReferenceSystem::createFromSrid( long id )
 {
-  return loadFromDb( QgsApplication::srsDbFilePath(), "srid", QString::number( id ) );
+  QgsCRSCatalogue::Record myRecord;
+  if ( QgsCRSCatalogue::instance()->recordBySrid( id, myRecord ) )
+    return loadFromRecord( myRecord );
+
+  QgsDebugMsg( QString( "failed : srid %1 not found" ).arg( id ) );
+  mIsValidFlag = false;
+  mWkt.clear();
+  return mIsValidFlag;
 }
 
 bool QgsCoordinateReferenceSystem::createFromEpsg( long id )
@@ -210,84 +222,47 @@ bool QgsCoordinateReferenceSystem::createFromEpsg( long id )
 
 bool QgsCoordinateReferenceSystem::createFromSrsId( long id )
 {
-  return loadFromDb( id < USER_CRS_START_ID ? QgsApplication::srsDbFilePath() : QgsApplication::qgisUserDbFilePath(),
-                     "srs_id", QString::number( id ) );
+  QgsCRSCatalogue::Record myRecord;
+  if ( QgsCRSCatalogue::instance()->recordBySrsId( id, myRecord ) )
+    return loadFromRecord( myRecord );
+
+  QgsDebugMsg( QString( "failed : srs id %1 not found" ).arg( id ) );
+  mIsValidFlag = false;
+  mWkt.clear();
+  return mIsValidFlag;
 }
 
-bool QgsCoordinateReferenceSystem::loadFromDb( QString db, QString expression, QString value )
+bool QgsCoordinateReferenceSystem::loadFromRecord( const QgsCRSCatalogue::Record& record )
 {
-  QgsDebugMsgLevel( "load CRS from " + db + " where " + expression + " is " + value, 3 );
+  QgsDebugMsgLevel( "load CRS " + QString::number( record.srsId ) + " from catalogue", 3 );
   mIsValidFlag = false;
   mWkt.clear();
 
-  QFileInfo myInfo( db );
-  if ( !myInfo.exists() )
-  {
-    QgsDebugMsg( "failed : " + db + " does not exist!" );
-    return mIsValidFlag;
-  }
+  mSrsId = record.srsId;
+  mDescription = record.description;
+  mProjectionAcronym = record.projectionAcronym;
+  mEllipsoidAcronym = record.ellipsoidAcronym;
+  mSRID = record.srid;
+  mAuthId = record.authId;
+  mGeoFlag = record.isGeo;
 
-  sqlite3      *myDatabase;
-  const char   *myTail;
-  sqlite3_stmt *myPreparedStatement;
-  int           myResult;
-  //check the db is available
-  myResult = openDb( db, &myDatabase );
-  if ( myResult != SQLITE_OK )
+  if ( mSrsId >= USER_CRS_START_ID && mAuthId.isEmpty() )
   {
-    QgsDebugMsg( "failed : " + db + " could not be opened!" );
-    return mIsValidFlag;
+    mAuthId = QString( "USER:%1" ).arg( mSrsId );
   }
-
-  /*
-    srs_id INTEGER PRIMARY KEY,
-    description text NOT NULL,
-    projection_acronym text NOT NULL,
-    ellipsoid_acronym NOT NULL,
-    parameters text NOT NULL,
-    srid integer NOT NULL,
-    auth_name varchar NOT NULL,
-    auth_id integer NOT NULL,
-    is_geo integer NOT NULL);
-  */
-
-  QString mySql = "select srs_id,description,projection_acronym,ellipsoid_acronym,parameters,srid,auth_name||':'||auth_id,is_geo from tbl_srs where " + expression + "=" + quotedValue( value );
-  myResult = sqlite3_prepare( myDatabase, mySql.toUtf8(), mySql.toUtf8().length(), &myPreparedStatement, &myTail );
-  // XXX Need to free memory from the error msg if one is set
-  if ( myResult == SQLITE_OK && sqlite3_step( myPreparedStatement ) == SQLITE_ROW )
+  else if ( mAuthId.startsWith( "EPSG:", Qt::CaseInsensitive ) )
   {
-    mSrsId = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 0 ) ).toLong();
-    mDescription = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 1 ) );
-    mProjectionAcronym = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 2 ) );
-    mEllipsoidAcronym = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 3 ) );
-    QString toProj4 = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 4 ) );
-    mSRID = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 5 ) ).toLong();
-    mAuthId = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 6 ) );
-    mGeoFlag = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 7 ) ).toInt() != 0;
-
-    if ( mSrsId >= USER_CRS_START_ID && mAuthId.isEmpty() )
-    {
-      mAuthId = QString( "USER:%1" ).arg( mSrsId );
-    }
-    else if ( mAuthId.startsWith( "EPSG:", Qt::CaseInsensitive ) )
-    {
-      OSRDestroySpatialReference( mCRS );
-      mCRS = OSRNewSpatialReference( NULL );
-      mIsValidFlag = OSRSetFromUserInput( mCRS, mAuthId.toLower().toAscii() ) == OGRERR_NONE;
-      setMapUnits();
-    }
-
-    if ( !mIsValidFlag )
-    {
-      setProj4String( toProj4 );
-    }
+    OSRDestroySpatialReference( mCRS );
+    mCRS = OSRNewSpatialReference( NULL );
+    mIsValidFlag = OSRSetFromUserInput( mCRS, mAuthId.toLower().toAscii() ) == OGRERR_NONE;
+    setMapUnits();
   }
-  else
+
+  if ( !mIsValidFlag )
   {
-    QgsDebugMsg( "failed : " + mySql );
+    setProj4String( record.parameters );
   }
-  sqlite3_finalize( myPreparedStatement );
-  sqlite3_close( myDatabase );
+
   return mIsValidFlag;
 }
 
@@ -412,14 +387,15 @@ bool QgsCoordinateReferenceSystem::createFromProj4( const QString theProj4String
    * as its quicker than methods below..
    */
   long mySrsId = 0;
-  QgsCoordinateReferenceSystem::RecordMap myRecord;
+  QgsCRSCatalogue* myCatalogue = QgsCRSCatalogue::instance();
+  QgsCRSCatalogue::Record myRecord;
 
   /*
    * - if the above does not match perform a whole text search on proj4 string (if not null)
    */
   // QgsDebugMsg( "wholetext match on name failed, trying proj4string match" );
-  myRecord = getRecord( "select * from tbl_srs where parameters=" + quotedValue( theProj4String.trimmed() ) );
-  if ( myRecord.empty() )
+  bool myFound = myCatalogue->recordByParameters( theProj4String.trimmed(), myRecord );
+  if ( !myFound )
   {
     // Ticket #722 - aaronr
     // Check if we can swap the lat_1 and lat_2 params (if they exist) to see if we match...
@@ -453,52 +429,46 @@ bool QgsCoordinateReferenceSystem::createFromProj4( const QString theProj4String
       myStart2 = myLat2RegExp.indexIn( theProj4String, myStart2 );
       theProj4StringModified.replace( myStart2 + LAT_PREFIX_LEN, myLength2 - LAT_PREFIX_LEN, lat1Str );
       QgsDebugMsg( "trying proj4string match with swapped lat_1,lat_2" );
-      myRecord = getRecord( "select * from tbl_srs where parameters=" + quotedValue( theProj4StringModified.trimmed() ) );
+      myFound = myCatalogue->recordByParameters( theProj4StringModified.trimmed(), myRecord );
     }
   }
 
-  if ( myRecord.empty() )
+  if ( !myFound )
   {
     // match all parameters individually:
     // - order of parameters doesn't matter
     // - found definition may have more parameters (like +towgs84 in GDAL)
     // - retry without datum, if no match is found (looks like +datum<>WGS84 was dropped in GDAL)
 
-    QString sql = "SELECT * FROM tbl_srs WHERE ";
-    QString delim = "";
+    QStringList myParameters;
     QString datum;
-
-    // split on spaces followed by a plus sign (+) to deal
-    // also with parameters containing spaces (e.g. +nadgrids)
-    foreach( QString param, theProj4String.split( QRegExp( "\\s+(?=\\+)" ), QString::SkipEmptyParts ) )
+    foreach( QString param, QgsCRSCatalogue::splitParameters( theProj4String ) )
     {
-      QString arg = QString( "' '||parameters||' ' LIKE %1" ).arg( quotedValue( QString( "% %1 %" ).arg( param ) ) );
       if ( param.startsWith( "+datum=" ) )
       {
-        datum = arg;
+        datum = param;
       }
       else
       {
-        sql += delim + arg;
-        delim = " AND ";
+        myParameters << param;
       }
     }
 
     if ( !datum.isEmpty() )
     {
-      myRecord = getRecord( sql + delim + datum );
+      myFound = myCatalogue->recordWithParameters( myParameters + ( QStringList() << datum ), myRecord );
     }
 
-    if ( myRecord.empty() )
+    if ( !myFound )
     {
       // datum might have disappeared in definition - retry without it
-      myRecord = getRecord( sql );
+      myFound = myCatalogue->recordWithParameters( myParameters, myRecord );
     }
   }
 
-  if ( !myRecord.empty() )
+  if ( myFound )
   {
-    mySrsId = myRecord["srs_id"].toLong();
+    mySrsId = myRecord.srsId;
     QgsDebugMsg( "proj4string param match search for srsid returned srsid: " + QString::number( mySrsId ) );
     if ( mySrsId > 0 )
     {
@@ -532,8 +502,8 @@ bool QgsCoordinateReferenceSystem::createFromProj4( const QString theProj4String
     if ( mIsValidFlag )
     {
       // but the proj.4 parsed string might already be in our database
-      myRecord = getRecord( "select * from tbl_srs where parameters=" + quotedValue( toProj4() ) );
-      if ( myRecord.empty() )
+      myFound = myCatalogue->recordByParameters( toProj4(), myRecord );
+      if ( !myFound )
       {
         // It's not, so try to add it
         QgsDebugMsg( "Projection appears to be valid. Save to database!" );
@@ -542,14 +512,14 @@ bool QgsCoordinateReferenceSystem::createFromProj4( const QString theProj4String
         if ( mIsValidFlag )
         {
           // but validate that it's there afterwards
-          myRecord = getRecord( "select * from tbl_srs where parameters=" + quotedValue( toProj4() ) );
+          myFound = myCatalogue->recordByParameters( toProj4(), myRecord );
         }
       }
 
-      if ( !myRecord.empty() )
+      if ( myFound )
       {
         // take the srid from the record
-        mySrsId = myRecord["srs_id"].toLong();
+        mySrsId = myRecord.srsId;
         QgsDebugMsg( "proj4string match search for srsid returned srsid: " + QString::number( mySrsId ) );
         if ( mySrsId > 0 )
         {
@@ -890,92 +860,18 @@ long QgsCoordinateReferenceSystem::findMatchingProj()
     return 0;
   }
 
-  sqlite3      *myDatabase;
-  const char   *myTail;
-  sqlite3_stmt *myPreparedStatement;
-  int           myResult;
-
-  // Set up the query to retrieve the projection information needed to populate the list
-  QString mySql = QString( "select srs_id,parameters from tbl_srs where projection_acronym=%1 and ellipsoid_acronym=%2" )
-                  .arg( quotedValue( mProjectionAcronym ) )
-                  .arg( quotedValue( mEllipsoidAcronym ) );
-  // Get the full path name to the sqlite3 spatial reference database.
-  QString myDatabaseFileName = QgsApplication::srsDbFilePath();
-
-  //check the db is available
-  myResult = openDb( myDatabaseFileName, &myDatabase );
-  if ( myResult != SQLITE_OK )
-  {
-    return 0;
-  }
-
-  myResult = sqlite3_prepare( myDatabase, mySql.toUtf8(), mySql.toUtf8().length(), &myPreparedStatement, &myTail );
-// XXX Need to free memory from the error msg if one is set
-  if ( myResult == SQLITE_OK )
-  {
-
-    while ( sqlite3_step( myPreparedStatement ) == SQLITE_ROW )
-    {
-      QString mySrsId = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 0 ) );
-      QString myProj4String = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 1 ) );
-      if ( equals( myProj4String ) )
-      {
-        QgsDebugMsg( "-------> MATCH FOUND in srs.db srsid: " + mySrsId );
-        // close the sqlite3 statement
-        sqlite3_finalize( myPreparedStatement );
-        sqlite3_close( myDatabase );
-        return mySrsId.toLong();
-      }
-      else
-      {
-// QgsDebugMsg(QString(" Not matched : %1").arg(myProj4String));
-      }
-    }
-  }
-  QgsDebugMsg( "no match found in srs.db, trying user db now!" );
-  // close the sqlite3 statement
-  sqlite3_finalize( myPreparedStatement );
-  sqlite3_close( myDatabase );
-  //
-  // Try the users db now
-  //
-
-  myDatabaseFileName = QgsApplication::qgisUserDbFilePath();
-  //check the db is available
-  myResult = openDb( myDatabaseFileName, &myDatabase );
-  if ( myResult != SQLITE_OK )
-  {
-    return 0;
-  }
-
-  myResult = sqlite3_prepare( myDatabase, mySql.toUtf8(), mySql.toUtf8().length(), &myPreparedStatement, &myTail );
-// XXX Need to free memory from the error msg if one is set
-  if ( myResult == SQLITE_OK )
+  // candidates with the same projection and ellipsoid, the ones of srs.db first
+  QList<QgsCRSCatalogue::Record> myRecords = QgsCRSCatalogue::instance()->recordsByAcronyms( mProjectionAcronym, mEllipsoidAcronym );
+  foreach( const QgsCRSCatalogue::Record& myRecord, myRecords )
   {
-
-    while ( sqlite3_step( myPreparedStatement ) == SQLITE_ROW )
+    if ( equals( myRecord.parameters ) )
     {
-      QString mySrsId = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 0 ) );
-      QString myProj4String = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 1 ) );
-      if ( equals( myProj4String ) )
-      {
-        QgsDebugMsg( "-------> MATCH FOUND in user qgis.db srsid: " + mySrsId );
-        // close the sqlite3 statement
-        sqlite3_finalize( myPreparedStatement );
-        sqlite3_close( myDatabase );
-        return mySrsId.toLong();
-      }
-      else
-      {
-// QgsDebugMsg(QString(" Not matched : %1").arg(myProj4String));
-      }
+      QgsDebugMsg( "-------> MATCH FOUND srsid: " + QString::number( myRecord.srsId ) );
+      return myRecord.srsId;
     }
   }
-  QgsDebugMsg( "no match found in user db" );
 
-  // close the sqlite3 statement
-  sqlite3_finalize( myPreparedStatement );
-  sqlite3_close( myDatabase );
+  QgsDebugMsg( "no match found in srs.db and user db" );
   return 0;
 }
 
@@ -1343,6 +1239,11 @@ bool QgsCoordinateReferenceSystem::saveAsUserCRS()
   QgsDebugMsg( QString( "Update or insert sql \n%1" ).arg( mySql ) );
   myResult = sqlite3_prepare( myDatabase, mySql.toUtf8(), mySql.toUtf8().length(), &myPreparedStatement, &myTail );
   sqlite3_step( myPreparedStatement );
+  sqlite3_finalize( myPreparedStatement );
+  sqlite3_close( myDatabase );
+
+  // the new CRS has to show up in the lookups
+  QgsCRSCatalogue::instance()->invalidate();
 
   QgsMessageLog::logMessage( QObject::tr( "Saved user CRS [%1]" ).arg( toProj4() ), QObject::tr( "CRS" ) );
 
@@ -1518,6 +1419,9 @@ int QgsCoordinateReferenceSystem::syncDb()
   sqlite3_finalize( select );
   sqlite3_close( database );
 
+  if ( updated > 0 )
+    QgsCRSCatalogue::instance()->invalidate();
+
   if ( errors > 0 )
     return -errors;
   else
@@ -32,6 +32,7 @@ typedef struct sqlite3 sqlite3;
 
 //qgis includes
 #include "qgis.h"
+#include "qgscrscatalogue.h"
 
 class QgsCoordinateReferenceSystem;
 typedef void ( *CUSTOM_CRS_VALIDATION )( QgsCoordinateReferenceSystem* );
@@ -429,7 +430,8 @@ class CORE_EXPORT QgsCoordinateReferenceSystem
 
     void *mCRS;
 
-    bool loadFromDb( QString db, QString expression, QString value );
+    //! Initializes the CRS from a record of the CRS catalogue
+    bool loadFromRecord( const QgsCRSCatalogue::Record& record );
 
     QString mValidationHint;
     mutable QString mWkt;
@@ -18,9 +18,12 @@
 #include "qgscrscache.h"
 
 QgsCRSCache* QgsCRSCache::mInstance = 0;
+//! protects the creation of the instance, which may be requested from several threads at once
+static QMutex sInstanceMutex;
 
 QgsCRSCache* QgsCRSCache::instance()
 {
+  QMutexLocker locker( &sInstanceMutex );
   if ( !mInstance )
   {
     mInstance = new QgsCRSCache();
@@ -37,8 +40,9 @@ QgsCRSCache::~QgsCRSCache()
   delete mInstance;
 }
 
-const QgsCoordinateReferenceSystem& QgsCRSCache::crsByAuthId( const QString& authid )
+QgsCoordinateReferenceSystem QgsCRSCache::crsByAuthId( const QString& authid )
 {
+  QMutexLocker locker( &mMutex );
   QHash< QString, QgsCoordinateReferenceSystem >::const_iterator crsIt = mCRS.find( authid );
   if ( crsIt == mCRS.constEnd() )
   {
@@ -55,7 +59,7 @@ const QgsCoordinateReferenceSystem& QgsCRSCache::crsByAuthId( const QString& aut
   }
 }
 
-const QgsCoordinateReferenceSystem& QgsCRSCache::crsByEpsgId( long epsg )
+QgsCoordinateReferenceSystem QgsCRSCache::crsByEpsgId( long epsg )
 {
   return crsByAuthId( "EPSG:" + QString::number( epsg ) );
 }
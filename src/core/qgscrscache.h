@@ -20,15 +20,17 @@
 
 #include "qgscoordinatereferencesystem.h"
 #include <QHash>
+#include <QMutex>
 
 class CORE_EXPORT QgsCRSCache
 {
   public:
     static QgsCRSCache* instance();
     ~QgsCRSCache();
-    /**Returns the CRS for authid, e.g. 'EPSG:4326' (or an invalid CRS in case of error)*/
-    const QgsCoordinateReferenceSystem& crsByAuthId( const QString& authid );
-    const QgsCoordinateReferenceSystem& crsByEpsgId( long epgs );
+    /**Returns the CRS for authid, e.g. 'EPSG:4326' (or an invalid CRS in case of error).
+      The CRS is returned by value because the cache may change as soon as the lock is released*/
+    QgsCoordinateReferenceSystem crsByAuthId( const QString& authid );
+    QgsCoordinateReferenceSystem crsByEpsgId( long epgs );
 
   protected:
     QgsCRSCache();
@@ -36,6 +38,8 @@ class CORE_EXPORT QgsCRSCache
   private:
     static QgsCRSCache* mInstance;
     QHash< QString, QgsCoordinateReferenceSystem > mCRS;
+    /**Protects mCRS if the cache is used from several threads (e.g. by the threaded map server)*/
+    QMutex mMutex;
     /**CRS that is not initialised (returned in case of error)*/
     QgsCoordinateReferenceSystem mInvalidCRS;
 };
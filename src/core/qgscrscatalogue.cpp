@@ -0,0 +1,254 @@
+/***************************************************************************
+    qgscrscatalogue.cpp - in-memory index of the CRS definitions
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgscrscatalogue.h"
+
+#include "qgsapplication.h"
+#include "qgslogger.h"
+#include "qgis.h"
+
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRegExp>
+
+#include <sqlite3.h>
+
+QgsCRSCatalogue* QgsCRSCatalogue::mInstance = 0;
+//! protects the creation of the instance, CRS are created on several threads (e.g. by the threaded map server)
+static QMutex sInstanceMutex;
+
+QgsCRSCatalogue* QgsCRSCatalogue::instance()
+{
+  QMutexLocker locker( &sInstanceMutex );
+  if ( !mInstance )
+  {
+    mInstance = new QgsCRSCatalogue();
+  }
+  return mInstance;
+}
+
+QgsCRSCatalogue::QgsCRSCatalogue()
+    : mBuilt( false )
+{
+}
+
+bool QgsCRSCatalogue::recordBySrsId( long srsId, Record& record )
+{
+  QMutexLocker locker( &mMutex );
+  build();
+  QHash<long, int>::const_iterator it = mSrsIds.constFind( srsId );
+  if ( it == mSrsIds.constEnd() )
+    return false;
+  record = mRecords[ it.value()];
+  return true;
+}
+
+bool QgsCRSCatalogue::recordBySrid( long srid, Record& record )
+{
+  QMutexLocker locker( &mMutex );
+  build();
+  QHash<long, int>::const_iterator it = mSrids.constFind( srid );
+  if ( it == mSrids.constEnd() )
+    return false;
+  record = mRecords[ it.value()];
+  return true;
+}
+
+bool QgsCRSCatalogue::recordByAuthId( const QString& authId, Record& record )
+{
+  QMutexLocker locker( &mMutex );
+  build();
+  QHash<QString, int>::const_iterator it = mAuthIds.constFind( authId.toLower() );
+  if ( it == mAuthIds.constEnd() )
+    return false;
+  record = mRecords[ it.value()];
+  return true;
+}
+
+bool QgsCRSCatalogue::recordByParameters( const QString& parameters, Record& record )
+{
+  QMutexLocker locker( &mMutex );
+  build();
+  QHash<QString, int>::const_iterator it = mParameters.constFind( parameters );
+  if ( it == mParameters.constEnd() )
+    return false;
+  record = mRecords[ it.value()];
+  return true;
+}
+
+bool QgsCRSCatalogue::recordWithParameters( const QStringList& parameters, Record& record )
+{
+  if ( parameters.isEmpty() )
+    return false;
+
+  QMutexLocker locker( &mMutex );
+  build();
+
+  QHash<QString, int>::const_iterator it = mNormalizedParameters.constFind( normalizedParameters( parameters ) );
+  if ( it != mNormalizedParameters.constEnd() )
+  {
+    record = mRecords[ it.value()];
+    return true;
+  }
+
+  QStringList lowerParameters;
+  foreach( QString parameter, parameters )
+  {
+    lowerParameters << parameter.toLower();
+  }
+
+  for ( int i = 0; i < mRecords.size(); ++i )
+  {
+    const QSet<QString>& recordParameters = mParameterSets[i];
+    bool found = true;
+    for ( int j = 0; found && j < lowerParameters.size(); ++j )
+    {
+      found = recordParameters.contains( lowerParameters[j] );
+    }
+    if ( found )
+    {
+      record = mRecords[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+QList<QgsCRSCatalogue::Record> QgsCRSCatalogue::recordsByAcronyms( const QString& projectionAcronym, const QString& ellipsoidAcronym )
+{
+  QMutexLocker locker( &mMutex );
+  build();
+
+  QList<Record> records;
+  foreach( int i, mAcronyms.value( projectionAcronym + "\n" + ellipsoidAcronym ) )
+  {
+    records << mRecords[i];
+  }
+  return records;
+}
+
+void QgsCRSCatalogue::invalidate()
+{
+  QMutexLocker locker( &mMutex );
+  mBuilt = false;
+  mRecords.clear();
+  mParameterSets.clear();
+  mSrsIds.clear();
+  mSrids.clear();
+  mAuthIds.clear();
+  mParameters.clear();
+  mNormalizedParameters.clear();
+  mAcronyms.clear();
+}
+
+QStringList QgsCRSCatalogue::splitParameters( const QString& parameters )
+{
+  // split on spaces followed by a plus sign (+) to deal
+  // also with parameters containing spaces (e.g. +nadgrids)
+  return parameters.trimmed().split( QRegExp( "\\s+(?=\\+)" ), QString::SkipEmptyParts );
+}
+
+QString QgsCRSCatalogue::normalizedParameters( const QStringList& parameters )
+{
+  QStringList lowerParameters;
+  foreach( QString parameter, parameters )
+  {
+    lowerParameters << parameter.toLower();
+  }
+  lowerParameters.sort();
+  return lowerParameters.join( " " );
+}
+
+void QgsCRSCatalogue::build()
+{
+  if ( mBuilt )
+    return;
+
+  readDb( QgsApplication::srsDbFilePath(), false );
+  readDb( QgsApplication::qgisUserDbFilePath(), true );
+  mBuilt = true;
+
+  QgsDebugMsg( QString( "%1 CRS definitions read" ).arg( mRecords.size() ) );
+}
+
+void QgsCRSCatalogue::readDb( const QString& path, bool userDb )
+{
+  if ( !QFileInfo( path ).exists() )
+  {
+    QgsDebugMsg( "failed : " + path + " does not exist!" );
+    return;
+  }
+
+  sqlite3 *database;
+  if ( sqlite3_open_v2( path.toUtf8().constData(), &database, SQLITE_OPEN_READONLY, NULL ) != SQLITE_OK )
+  {
+    QgsDebugMsg( QString( "Can't open database %1: %2" ).arg( path ).arg( sqlite3_errmsg( database ) ) );
+    sqlite3_close( database );
+    return;
+  }
+
+  QString sql = "select srs_id,description,projection_acronym,ellipsoid_acronym,parameters,srid,auth_name||':'||auth_id,is_geo from tbl_srs order by srs_id";
+  sqlite3_stmt *statement;
+  if ( sqlite3_prepare_v2( database, sql.toUtf8().constData(), -1, &statement, NULL ) != SQLITE_OK )
+  {
+    QgsDebugMsg( QString( "failed : %1 [%2]" ).arg( sql ).arg( sqlite3_errmsg( database ) ) );
+    sqlite3_close( database );
+    return;
+  }
+
+  while ( sqlite3_step( statement ) == SQLITE_ROW )
+  {
+    Record record;
+    record.srsId = ( long ) sqlite3_column_int64( statement, 0 );
+    record.description = QString::fromUtf8(( const char * ) sqlite3_column_text( statement, 1 ) );
+    record.projectionAcronym = QString::fromUtf8(( const char * ) sqlite3_column_text( statement, 2 ) );
+    record.ellipsoidAcronym = QString::fromUtf8(( const char * ) sqlite3_column_text( statement, 3 ) );
+    record.parameters = QString::fromUtf8(( const char * ) sqlite3_column_text( statement, 4 ) );
+    record.srid = ( long ) sqlite3_column_int64( statement, 5 );
+    record.authId = QString::fromUtf8(( const char * ) sqlite3_column_text( statement, 6 ) );
+    record.isGeo = sqlite3_column_int( statement, 7 ) != 0;
+
+    int index = mRecords.size();
+    mRecords << record;
+
+    QStringList parameters = splitParameters( record.parameters );
+    QSet<QString> parameterSet;
+    foreach( QString parameter, parameters )
+    {
+      parameterSet << parameter.toLower();
+    }
+    mParameterSets << parameterSet;
+
+    // system and user CRS are told apart by their id
+    if ( userDb == ( record.srsId >= USER_CRS_START_ID ) )
+      mSrsIds.insert( record.srsId, index );
+
+    // the first record wins, like in a query of the databases
+    if ( !userDb && !mSrids.contains( record.srid ) )
+      mSrids.insert( record.srid, index );
+    if ( !userDb && !record.authId.isEmpty() && !mAuthIds.contains( record.authId.toLower() ) )
+      mAuthIds.insert( record.authId.toLower(), index );
+    if ( !mParameters.contains( record.parameters ) )
+      mParameters.insert( record.parameters, index );
+
+    QString normalized = normalizedParameters( parameters );
+    if ( !normalized.isEmpty() && !mNormalizedParameters.contains( normalized ) )
+      mNormalizedParameters.insert( normalized, index );
+
+    mAcronyms[ record.projectionAcronym + "\n" + record.ellipsoidAcronym ] << index;
+  }
+
+  sqlite3_finalize( statement );
+  sqlite3_close( database );
+}
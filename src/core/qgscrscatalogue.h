@@ -0,0 +1,106 @@
+/***************************************************************************
+    qgscrscatalogue.h - in-memory index of the CRS definitions
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSCRSCATALOGUE_H
+#define QGSCRSCATALOGUE_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/** \ingroup core
+ * Process wide copy of the CRS definitions of the system srs.db and the user qgis.db,
+ * indexed for the lookups of QgsCoordinateReferenceSystem, so that they don't need
+ * to open the databases and query them on every call.
+ * The catalogue is read on first use and read again after invalidate(), which has
+ * to be called whenever one of the databases was changed. It can be used from
+ * several threads.
+ * @note added in 1.9
+ */
+class CORE_EXPORT QgsCRSCatalogue
+{
+  public:
+    //! CRS definition of a row of tbl_srs
+    struct Record
+    {
+      long srsId;
+      QString description;
+      QString projectionAcronym;
+      QString ellipsoidAcronym;
+      //! proj4 parameters
+      QString parameters;
+      long srid;
+      //! auth_name:auth_id or empty if the record has no authority
+      QString authId;
+      bool isGeo;
+    };
+
+    static QgsCRSCatalogue* instance();
+
+    //! Finds the record of an internal srs id. Ids below USER_CRS_START_ID are looked up in srs.db, the others in qgis.db
+    bool recordBySrsId( long srsId, Record& record );
+    //! Finds the record of a PostGIS srid in srs.db
+    bool recordBySrid( long srid, Record& record );
+    //! Finds the record of an authority id like "EPSG:4326" (case insensitive) in srs.db
+    bool recordByAuthId( const QString& authId, Record& record );
+    //! Finds the first record with exactly these proj4 parameters, in srs.db first, then in qgis.db
+    bool recordByParameters( const QString& parameters, Record& record );
+    /** Finds a record that has all of the given proj4 parameters (case insensitive, in any order).
+     * A record without other parameters is preferred, otherwise the first record with
+     * additional parameters is used (in srs.db first, then in qgis.db).
+     */
+    bool recordWithParameters( const QStringList& parameters, Record& record );
+    //! Returns the records with the given projection and ellipsoid acronyms, the ones of srs.db first
+    QList<Record> recordsByAcronyms( const QString& projectionAcronym, const QString& ellipsoidAcronym );
+
+    //! Drops the catalogue, it is read again from the databases on the next lookup
+    void invalidate();
+
+    //! Splits proj4 parameters, parameters that contain spaces (e.g. +nadgrids) are kept together
+    static QStringList splitParameters( const QString& parameters );
+
+  protected:
+    QgsCRSCatalogue();
+
+  private:
+    static QgsCRSCatalogue* mInstance;
+
+    //! Reads the catalogue if it is not there. Has to be called with the mutex locked
+    void build();
+    //! Appends the records of tbl_srs of a database
+    void readDb( const QString& path, bool userDb );
+    static QString normalizedParameters( const QStringList& parameters );
+
+    QMutex mMutex;
+    bool mBuilt;
+
+    //! records of srs.db and then of qgis.db, in srs_id order
+    QVector<Record> mRecords;
+    //! lowercase parameters of each record
+    QVector< QSet<QString> > mParameterSets;
+
+    //! indexes into mRecords
+    QHash<long, int> mSrsIds;
+    QHash<long, int> mSrids;
+    QHash<QString, int> mAuthIds;
+    QHash<QString, int> mParameters;
+    QHash<QString, int> mNormalizedParameters;
+    QHash<QString, QList<int> > mAcronyms;
+};
+
+#endif // QGSCRSCATALOGUE_H
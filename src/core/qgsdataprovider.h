@@ -290,6 +290,12 @@ class CORE_EXPORT QgsDataProvider : public QObject
     /** Current time stamp of data source */
     virtual QDateTime dataTimestamp() const { return QDateTime(); }
 
+    /**Returns true if the provider may be read on a worker thread while other providers are
+      used on other threads. Providers that share connections or network access between
+      instances, or that depend on the event loop of the main thread, return false.
+      @note added in 1.9 */
+    virtual bool isThreadSafe() const { return false; }
+
   signals:
 
     /**
@@ -17,7 +17,9 @@
 
 #include <QtDebug>
 #include <QDomDocument>
+#include <QRegExp>
 #include <QSettings>
+#include <QVector>
 
 #include <math.h>
 #include <limits>
@@ -447,8 +449,148 @@ int QgsExpression::functionCount()
 }
 
 
+///////////////////////////////////////////////
+// compiled program
+
+/** Value on the stack of a compiled program. Integers and doubles are kept unboxed,
+  other values (strings, typed nulls, ...) are kept in a QVariant */
+struct QgsExpressionValue
+{
+  enum Type
+  {
+    Null,
+    Int,
+    Double,
+    Variant
+  };
+
+  QgsExpressionValue() : type( Null ), i( 0 ), d( 0 ) {}
+
+  void setNull() { type = Null; v = QVariant(); }
+  void setInt( int x ) { type = Int; i = x; }
+  void setDouble( double x ) { type = Double; d = x; }
+  void setBool( bool b ) { type = Int; i = b ? 1 : 0; }
+  void setVariant( const QVariant& value )
+  {
+    if ( value.isNull() )
+    {
+      type = Null;
+      v = value;
+    }
+    else if ( value.type() == QVariant::Int )
+      setInt( value.toInt() );
+    else if ( value.type() == QVariant::Double )
+      setDouble( value.toDouble() );
+    else
+    {
+      type = Variant;
+      v = value;
+    }
+  }
+
+  QVariant variant() const
+  {
+    switch ( type )
+    {
+      case Int: return QVariant( i );
+      case Double: return QVariant( d );
+      default: return v;
+    }
+  }
+
+  bool isNumeric() const { return type == Int || type == Double; }
+  double number() const { return type == Int ? i : d; }
+
+  Type type;
+  int i;
+  double d;
+  QVariant v;
+};
+
+/** Expression compiled to a flat list of instructions for a value stack machine.
+  Column indexes are resolved, constant subexpressions are folded and regular
+  expressions of LIKE, ILIKE and ~ with a constant pattern are built once.
+  Integer and double values are processed without QVariant conversions, other
+  values are handled by the same code as the node tree, so the results are identical. */
+class QgsExpressionProgram : public QgsExpression::Visitor
+{
+  public:
+    QgsExpressionProgram( QgsExpression* parent );
+
+    //! compile a prepared node tree
+    void compile( QgsExpression::Node* root );
+
+    //! evaluate the program for a feature
+    QVariant run( QgsFeature* f );
+
+    //! evaluate the program for all rows of a block, an instruction at a time
+    QgsExpressionColumn run( const QgsExpressionBlock& block );
+
+    // compiler
+    void visit( QgsExpression::NodeUnaryOperator* n );
+    void visit( QgsExpression::NodeBinaryOperator* n );
+    void visit( QgsExpression::NodeInOperator* n );
+    void visit( QgsExpression::NodeFunction* n );
+    void visit( QgsExpression::NodeLiteral* n );
+    void visit( QgsExpression::NodeColumnRef* n );
+    void visit( QgsExpression::NodeCondition* n );
+
+  private:
+    enum OpCode
+    {
+      PushConstant,  // push constant a
+      LoadColumn,    // push attribute a of the feature
+      Unary,         // apply unary operator a to the top value
+      Binary,        // apply binary operator a to the two top values
+      MatchRegExp,   // match the top value with regular expression a (operator b)
+      CheckArgument, // null argument a of a function call: drop the arguments, push null, jump to b
+      Call,          // call function a with b arguments
+      InBegin,       // IN: null tested value gives null and jumps to a, else push the "list has null" flag
+      InItem,        // IN: compare the top value with the tested value, on match set the result and jump to a (b: NOT IN)
+      InEnd,         // IN: no match, set the result (b: NOT IN)
+      JumpIfNotTrue, // pop the top value and jump to a unless it is true
+      Jump           // jump to a
+    };
+
+    struct Instruction
+    {
+      OpCode code;
+      int a;
+      int b;
+      int depth; // stack size before the instruction
+    };
+
+    //! compile a node and fold it to a constant if possible
+    void compileNode( QgsExpression::Node* node );
+    //! append an instruction changing the stack size by depthChange
+    int addInstruction( OpCode code, int a, int b, int depthChange );
+    int addConstant( const QVariant& value );
+
+    //! remove a row from the evaluation of a block after an error
+    void failRow( int row );
+
+    QgsExpression* mParent;
+
+    QVector<Instruction> mCode;
+    QVector<QgsExpressionValue> mConstants;
+    QVector<QRegExp> mRegExps;
+    QVector<QgsExpression::FcnEval> mFunctions;
+    QVector<QgsExpressionValue> mStack;
+
+    // compiler state
+    int mDepth;
+    int mMaxDepth;
+    bool mConstant;
+
+    // block evaluation state
+    QList<int> mFailedRows;
+    int mErrorRow;
+    QString mErrorString;
+};
+
+
 QgsExpression::QgsExpression( const QString& expr )
-    : mExpression( expr ), mRowNumber( 0 ), mCalc( NULL )
+    : mExpression( expr ), mRowNumber( 0 ), mCalc( NULL ), mProgram( NULL ), mCompilationEnabled( true )
 {
   mRootNode = ::parseExpression( mExpression, mParserErrorString );
 
@@ -462,6 +604,7 @@ QgsExpression::~QgsExpression()
 {
   delete mRootNode;
   delete mCalc;
+  delete mProgram;
 }
 
 QStringList QgsExpression::referencedColumns()
@@ -505,6 +648,9 @@ void QgsExpression::initGeomCalculator()
 
 bool QgsExpression::prepare( const QgsFieldMap& fields )
 {
+  delete mProgram;
+  mProgram = NULL;
+
   mEvalErrorString = QString();
   if ( !mRootNode )
   {
@@ -512,7 +658,25 @@ bool QgsExpression::prepare( const QgsFieldMap& fields )
     return false;
   }
 
-  return mRootNode->prepare( this, fields );
+  if ( !mRootNode->prepare( this, fields ) )
+    return false;
+
+  if ( mCompilationEnabled )
+  {
+    mProgram = new QgsExpressionProgram( this );
+    mProgram->compile( mRootNode );
+  }
+  return true;
+}
+
+void QgsExpression::setCompilationEnabled( bool enabled )
+{
+  mCompilationEnabled = enabled;
+  if ( !enabled )
+  {
+    delete mProgram;
+    mProgram = NULL;
+  }
 }
 
 QVariant QgsExpression::evaluate( QgsFeature* f )
@@ -524,13 +688,19 @@ QVariant QgsExpression::evaluate( QgsFeature* f )
     return QVariant();
   }
 
+  if ( mProgram )
+    return mProgram->run( f );
+
   return mRootNode->eval( this, f );
 }
 
 QVariant QgsExpression::evaluate( QgsFeature* f, const QgsFieldMap& fields )
 {
-  // first prepare
+  // first prepare - compiling does not pay off for a single evaluation
+  bool compilationEnabled = mCompilationEnabled;
+  mCompilationEnabled = false;
   bool res = prepare( fields );
+  mCompilationEnabled = compilationEnabled;
   if ( !res )
     return QVariant();
 
@@ -538,6 +708,60 @@ QVariant QgsExpression::evaluate( QgsFeature* f, const QgsFieldMap& fields )
   return evaluate( f );
 }
 
+QgsExpressionColumn QgsExpression::evaluate( const QgsExpressionBlock& block )
+{
+  mEvalErrorString = QString();
+  if ( !mRootNode )
+  {
+    mEvalErrorString = QObject::tr( "No root node! Parsing failed?" );
+    return QgsExpressionColumn( QgsExpressionColumn::Variant, block.count() );
+  }
+
+  if ( mProgram )
+    return mProgram->run( block );
+
+  // no program - evaluate the node tree a row at a time
+  QgsExpressionColumn result( QgsExpressionColumn::Variant, block.count() );
+  QList<int> attributes = block.attributes();
+  QList<QgsExpressionColumn> columns;
+  foreach( int attr, attributes )
+  {
+    columns << block.column( attr );
+  }
+
+  int firstRowNumber = mRowNumber;
+  QString error;
+  QgsFeature rowFeature;
+  for ( int row = 0; row < block.count(); ++row )
+  {
+    QgsFeature* f = block.feature( row );
+    if ( !f )
+    {
+      for ( int i = 0; i < attributes.count(); ++i )
+      {
+        rowFeature.changeAttribute( attributes[i], columns[i].value( row ) );
+      }
+      f = &rowFeature;
+    }
+
+    mRowNumber = firstRowNumber + row;
+    mEvalErrorString = QString();
+    QVariant value = mRootNode->eval( this, f );
+    if ( hasEvalError() )
+    {
+      // report the error of the first row, the row stays null
+      if ( error.isNull() )
+        error = mEvalErrorString;
+      continue;
+    }
+    result.setValue( row, value );
+  }
+
+  mRowNumber = firstRowNumber;
+  mEvalErrorString = error;
+  return result;
+}
+
 QString QgsExpression::dump() const
 {
   if ( !mRootNode )
@@ -569,21 +793,20 @@ QString QgsExpression::NodeList::dump() const
 
 //
 
-QVariant QgsExpression::NodeUnaryOperator::eval( QgsExpression* parent, QgsFeature* f )
+// evaluation of an unary operator with already evaluated operand,
+// shared by the node tree and the compiled program
+static QVariant evalUnaryOperator( QgsExpression::UnaryOperator op, const QVariant& val, QgsExpression* parent )
 {
-  QVariant val = mOperand->eval( parent, f );
-  ENSURE_NO_EVAL_ERROR;
-
-  switch ( mOp )
+  switch ( op )
   {
-    case uoNot:
+    case QgsExpression::uoNot:
     {
       TVL tvl = getTVLValue( val, parent );
       ENSURE_NO_EVAL_ERROR;
       return tvl2variant( NOT[tvl] );
     }
 
-    case uoMinus:
+    case QgsExpression::uoMinus:
       if ( isIntSafe( val ) )
         return QVariant( - getIntValue( val, parent ) );
       else if ( isDoubleSafe( val ) )
@@ -597,6 +820,14 @@ QVariant QgsExpression::NodeUnaryOperator::eval( QgsExpression* parent, QgsFeatu
   return QVariant();
 }
 
+QVariant QgsExpression::NodeUnaryOperator::eval( QgsExpression* parent, QgsFeature* f )
+{
+  QVariant val = mOperand->eval( parent, f );
+  ENSURE_NO_EVAL_ERROR;
+
+  return evalUnaryOperator( mOp, val, parent );
+}
+
 bool QgsExpression::NodeUnaryOperator::prepare( QgsExpression* parent, const QgsFieldMap& fields )
 {
   return mOperand->prepare( parent, fields );
@@ -609,20 +840,57 @@ QString QgsExpression::NodeUnaryOperator::dump() const
 
 //
 
-QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeature* f )
+static bool compareOp( QgsExpression::BinaryOperator op, double diff )
 {
-  QVariant vL = mOpLeft->eval( parent, f );
-  ENSURE_NO_EVAL_ERROR;
-  QVariant vR = mOpRight->eval( parent, f );
-  ENSURE_NO_EVAL_ERROR;
+  switch ( op )
+  {
+    case QgsExpression::boEQ: return diff == 0;
+    case QgsExpression::boNE: return diff != 0;
+    case QgsExpression::boLT: return diff < 0;
+    case QgsExpression::boGT: return diff > 0;
+    case QgsExpression::boLE: return diff <= 0;
+    case QgsExpression::boGE: return diff >= 0;
+    default: Q_ASSERT( false ); return false;
+  }
+}
+
+static int computeIntOp( QgsExpression::BinaryOperator op, int x, int y )
+{
+  switch ( op )
+  {
+    case QgsExpression::boPlus: return x+y;
+    case QgsExpression::boMinus: return x-y;
+    case QgsExpression::boMul: return x*y;
+    case QgsExpression::boDiv: return x/y;
+    case QgsExpression::boMod: return x%y;
+    default: Q_ASSERT( false ); return 0;
+  }
+}
+
+static double computeDoubleOp( QgsExpression::BinaryOperator op, double x, double y )
+{
+  switch ( op )
+  {
+    case QgsExpression::boPlus: return x+y;
+    case QgsExpression::boMinus: return x-y;
+    case QgsExpression::boMul: return x*y;
+    case QgsExpression::boDiv: return x/y;
+    case QgsExpression::boMod: return fmod( x,y );
+    default: Q_ASSERT( false ); return 0;
+  }
+}
 
-  switch ( mOp )
+// evaluation of a binary operator with already evaluated operands,
+// shared by the node tree and the compiled program
+static QVariant evalBinaryOperator( QgsExpression::BinaryOperator op, const QVariant& vL, const QVariant& vR, QgsExpression* parent )
+{
+  switch ( op )
   {
-    case boPlus:
-    case boMinus:
-    case boMul:
-    case boDiv:
-    case boMod:
+    case QgsExpression::boPlus:
+    case QgsExpression::boMinus:
+    case QgsExpression::boMul:
+    case QgsExpression::boDiv:
+    case QgsExpression::boMod:
       if ( isNull( vL ) || isNull( vR ) )
         return QVariant();
       else if ( isIntSafe( vL ) && isIntSafe( vR ) )
@@ -630,20 +898,20 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeat
         // both are integers - let's use integer arithmetics
         int iL = getIntValue( vL, parent ); ENSURE_NO_EVAL_ERROR;
         int iR = getIntValue( vR, parent ); ENSURE_NO_EVAL_ERROR;
-        if ( mOp == boDiv && iR == 0 ) return QVariant(); // silently handle division by zero and return NULL
-        return QVariant( computeInt( iL, iR ) );
+        if (( op == QgsExpression::boDiv || op == QgsExpression::boMod ) && iR == 0 ) return QVariant(); // silently handle division by zero and return NULL
+        return QVariant( computeIntOp( op, iL, iR ) );
       }
       else
       {
         // general floating point arithmetic
         double fL = getDoubleValue( vL, parent ); ENSURE_NO_EVAL_ERROR;
         double fR = getDoubleValue( vR, parent ); ENSURE_NO_EVAL_ERROR;
-        if ( mOp == boDiv && fR == 0 )
+        if ( op == QgsExpression::boDiv && fR == 0 )
           return QVariant(); // silently handle division by zero and return NULL
-        return QVariant( computeDouble( fL, fR ) );
+        return QVariant( computeDoubleOp( op, fL, fR ) );
       }
 
-    case boPow:
+    case QgsExpression::boPow:
       if ( isNull( vL ) || isNull( vR ) )
         return QVariant();
       else
@@ -653,26 +921,26 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeat
         return QVariant( pow( fL, fR ) );
       }
 
-    case boAnd:
+    case QgsExpression::boAnd:
     {
       TVL tvlL = getTVLValue( vL, parent ), tvlR = getTVLValue( vR, parent );
       ENSURE_NO_EVAL_ERROR;
       return tvl2variant( AND[tvlL][tvlR] );
     }
 
-    case boOr:
+    case QgsExpression::boOr:
     {
       TVL tvlL = getTVLValue( vL, parent ), tvlR = getTVLValue( vR, parent );
       ENSURE_NO_EVAL_ERROR;
       return tvl2variant( OR[tvlL][tvlR] );
     }
 
-    case boEQ:
-    case boNE:
-    case boLT:
-    case boGT:
-    case boLE:
-    case boGE:
+    case QgsExpression::boEQ:
+    case QgsExpression::boNE:
+    case QgsExpression::boLT:
+    case QgsExpression::boGT:
+    case QgsExpression::boLE:
+    case QgsExpression::boGE:
       if ( isNull( vL ) || isNull( vR ) )
       {
         return TVL_Unknown;
@@ -682,7 +950,7 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeat
         // do numeric comparison if both operators can be converted to numbers
         double fL = getDoubleValue( vL, parent ); ENSURE_NO_EVAL_ERROR;
         double fR = getDoubleValue( vR, parent ); ENSURE_NO_EVAL_ERROR;
-        return compare( fL - fR ) ? TVL_True : TVL_False;
+        return compareOp( op, fL - fR ) ? TVL_True : TVL_False;
       }
       else
       {
@@ -690,15 +958,15 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeat
         QString sL = getStringValue( vL, parent ); ENSURE_NO_EVAL_ERROR;
         QString sR = getStringValue( vR, parent ); ENSURE_NO_EVAL_ERROR;
         int diff = QString::compare( sL, sR );
-        return compare( diff ) ? TVL_True : TVL_False;
+        return compareOp( op, diff ) ? TVL_True : TVL_False;
       }
 
-    case boIs:
-    case boIsNot:
+    case QgsExpression::boIs:
+    case QgsExpression::boIsNot:
       if ( isNull( vL ) && isNull( vR ) ) // both operators null
-        return ( mOp == boIs ? TVL_True : TVL_False );
+        return ( op == QgsExpression::boIs ? TVL_True : TVL_False );
       else if ( isNull( vL ) || isNull( vR ) ) // one operator null
-        return ( mOp == boIs ? TVL_False : TVL_True );
+        return ( op == QgsExpression::boIs ? TVL_False : TVL_True );
       else // both operators non-null
       {
         bool equal = false;
@@ -715,14 +983,14 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeat
           equal = QString::compare( sL, sR ) == 0;
         }
         if ( equal )
-          return mOp == boIs ? TVL_True : TVL_False;
+          return op == QgsExpression::boIs ? TVL_True : TVL_False;
         else
-          return mOp == boIs ? TVL_False : TVL_True;
+          return op == QgsExpression::boIs ? TVL_False : TVL_True;
       }
 
-    case boRegexp:
-    case boLike:
-    case boILike:
+    case QgsExpression::boRegexp:
+    case QgsExpression::boLike:
+    case QgsExpression::boILike:
       if ( isNull( vL ) || isNull( vR ) )
         return TVL_Unknown;
       else
@@ -731,12 +999,12 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeat
         QString regexp = getStringValue( vR, parent ); ENSURE_NO_EVAL_ERROR;
         // TODO: cache QRegExp in case that regexp is a literal string (i.e. it will stay constant)
         bool matches;
-        if ( mOp == boLike || mOp == boILike ) // change from LIKE syntax to regexp
+        if ( op == QgsExpression::boLike || op == QgsExpression::boILike ) // change from LIKE syntax to regexp
         {
           // XXX escape % and _  ???
           regexp.replace( "%", ".*" );
           regexp.replace( "_", "." );
-          matches = QRegExp( regexp, mOp == boLike ? Qt::CaseSensitive : Qt::CaseInsensitive ).exactMatch( str );
+          matches = QRegExp( regexp, op == QgsExpression::boLike ? Qt::CaseSensitive : Qt::CaseInsensitive ).exactMatch( str );
         }
         else
         {
@@ -745,7 +1013,7 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeat
         return matches ? TVL_True : TVL_False;
       }
 
-    case boConcat:
+    case QgsExpression::boConcat:
       if ( isNull( vL ) || isNull( vR ) )
         return QVariant();
       else
@@ -761,44 +1029,14 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeat
   return QVariant();
 }
 
-bool QgsExpression::NodeBinaryOperator::compare( double diff )
-{
-  switch ( mOp )
-  {
-    case boEQ: return diff == 0;
-    case boNE: return diff != 0;
-    case boLT: return diff < 0;
-    case boGT: return diff > 0;
-    case boLE: return diff <= 0;
-    case boGE: return diff >= 0;
-    default: Q_ASSERT( false ); return false;
-  }
-}
-
-int QgsExpression::NodeBinaryOperator::computeInt( int x, int y )
+QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeature* f )
 {
-  switch ( mOp )
-  {
-    case boPlus: return x+y;
-    case boMinus: return x-y;
-    case boMul: return x*y;
-    case boDiv: return x/y;
-    case boMod: return x%y;
-    default: Q_ASSERT( false ); return 0;
-  }
-}
+  QVariant vL = mOpLeft->eval( parent, f );
+  ENSURE_NO_EVAL_ERROR;
+  QVariant vR = mOpRight->eval( parent, f );
+  ENSURE_NO_EVAL_ERROR;
 
-double QgsExpression::NodeBinaryOperator::computeDouble( double x, double y )
-{
-  switch ( mOp )
-  {
-    case boPlus: return x+y;
-    case boMinus: return x-y;
-    case boMul: return x*y;
-    case boDiv: return x/y;
-    case boMod: return fmod( x,y );
-    default: Q_ASSERT( false ); return 0;
-  }
+  return evalBinaryOperator( mOp, vL, vR, parent );
 }
 
 
@@ -816,6 +1054,24 @@ QString QgsExpression::NodeBinaryOperator::dump() const
 
 //
 
+// equality of a value and a non-null item of the list of an IN operator
+static bool inListEqual( const QVariant& v1, const QVariant& v2, QgsExpression* parent )
+{
+  // check whether they are equal
+  if ( isDoubleSafe( v1 ) && isDoubleSafe( v2 ) )
+  {
+    double f1 = getDoubleValue( v1, parent );
+    double f2 = getDoubleValue( v2, parent );
+    return !parent->hasEvalError() && f1 == f2;
+  }
+  else
+  {
+    QString s1 = getStringValue( v1, parent );
+    QString s2 = getStringValue( v2, parent );
+    return QString::compare( s1, s2 ) == 0;
+  }
+}
+
 QVariant QgsExpression::NodeInOperator::eval( QgsExpression* parent, QgsFeature* f )
 {
   if ( mList->count() == 0 )
@@ -835,20 +1091,8 @@ QVariant QgsExpression::NodeInOperator::eval( QgsExpression* parent, QgsFeature*
       listHasNull = true;
     else
     {
-      bool equal = false;
-      // check whether they are equal
-      if ( isDoubleSafe( v1 ) && isDoubleSafe( v2 ) )
-      {
-        double f1 = getDoubleValue( v1, parent ); ENSURE_NO_EVAL_ERROR;
-        double f2 = getDoubleValue( v2, parent ); ENSURE_NO_EVAL_ERROR;
-        equal = f1 == f2;
-      }
-      else
-      {
-        QString s1 = getStringValue( v1, parent ); ENSURE_NO_EVAL_ERROR;
-        QString s2 = getStringValue( v2, parent ); ENSURE_NO_EVAL_ERROR;
-        equal = QString::compare( s1, s2 ) == 0;
-      }
+      bool equal = inListEqual( v1, v2, parent );
+      ENSURE_NO_EVAL_ERROR;
 
       if ( equal ) // we know the result
         return mNotIn ? TVL_False : TVL_True;
@@ -958,7 +1202,7 @@ QString QgsExpression::NodeLiteral::dump() const
 
 QVariant QgsExpression::NodeColumnRef::eval( QgsExpression* /*parent*/, QgsFeature* f )
 {
-  return f->attributeMap()[mIndex];
+  return f->attribute( mIndex );
 }
 
 bool QgsExpression::NodeColumnRef::prepare( QgsExpression* parent, const QgsFieldMap& fields )
@@ -1065,3 +1309,1154 @@ bool QgsExpression::NodeCondition::needsGeometry() const
 
   return false;
 }
+
+///////////////////////////////////////////////
+// compiled program
+
+// fast paths for integer, double and null operands, return false for other values
+static bool evalUnaryFast( QgsExpression::UnaryOperator op, QgsExpressionValue& v )
+{
+  switch ( op )
+  {
+    case QgsExpression::uoNot:
+      if ( v.type == QgsExpressionValue::Null )
+        v.setNull();
+      else if ( v.isNumeric() )
+        v.setBool( v.number() == 0 );
+      else
+        return false;
+      return true;
+
+    case QgsExpression::uoMinus:
+      if ( v.type == QgsExpressionValue::Int )
+        v.setInt( -v.i );
+      else if ( v.type == QgsExpressionValue::Double )
+        v.setDouble( -v.d );
+      else
+        return false;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+static bool tvlFast( const QgsExpressionValue& v, TVL& tvl )
+{
+  if ( v.type == QgsExpressionValue::Null )
+    tvl = Unknown;
+  else if ( v.isNumeric() )
+    tvl = v.number() != 0 ? True : False;
+  else
+    return false;
+  return true;
+}
+
+static void setTVL( QgsExpressionValue& v, TVL tvl )
+{
+  if ( tvl == Unknown )
+    v.setNull();
+  else
+    v.setBool( tvl == True );
+}
+
+static bool evalBinaryFast( QgsExpression::BinaryOperator op, QgsExpressionValue& l, const QgsExpressionValue& r )
+{
+  bool lNull = l.type == QgsExpressionValue::Null;
+  bool rNull = r.type == QgsExpressionValue::Null;
+  bool numeric = l.isNumeric() && r.isNumeric();
+
+  switch ( op )
+  {
+    case QgsExpression::boPlus:
+    case QgsExpression::boMinus:
+    case QgsExpression::boMul:
+    case QgsExpression::boDiv:
+    case QgsExpression::boMod:
+      if ( lNull || rNull )
+        l.setNull();
+      else if ( l.type == QgsExpressionValue::Int && r.type == QgsExpressionValue::Int )
+      {
+        if (( op == QgsExpression::boDiv || op == QgsExpression::boMod ) && r.i == 0 )
+          l.setNull(); // silently handle division by zero and return NULL
+        else
+          l.setInt( computeIntOp( op, l.i, r.i ) );
+      }
+      else if ( numeric )
+      {
+        double fR = r.number();
+        if ( op == QgsExpression::boDiv && fR == 0 )
+          l.setNull();
+        else
+          l.setDouble( computeDoubleOp( op, l.number(), fR ) );
+      }
+      else
+        return false;
+      return true;
+
+    case QgsExpression::boPow:
+      if ( lNull || rNull )
+        l.setNull();
+      else if ( numeric )
+        l.setDouble( pow( l.number(), r.number() ) );
+      else
+        return false;
+      return true;
+
+    case QgsExpression::boAnd:
+    case QgsExpression::boOr:
+    {
+      TVL tvlL, tvlR;
+      if ( !tvlFast( l, tvlL ) || !tvlFast( r, tvlR ) )
+        return false;
+      setTVL( l, op == QgsExpression::boAnd ? AND[tvlL][tvlR] : OR[tvlL][tvlR] );
+      return true;
+    }
+
+    case QgsExpression::boEQ:
+    case QgsExpression::boNE:
+    case QgsExpression::boLT:
+    case QgsExpression::boGT:
+    case QgsExpression::boLE:
+    case QgsExpression::boGE:
+      if ( lNull || rNull )
+        l.setNull();
+      else if ( numeric )
+        l.setBool( compareOp( op, l.number() - r.number() ) );
+      else
+        return false;
+      return true;
+
+    case QgsExpression::boIs:
+    case QgsExpression::boIsNot:
+      if ( lNull || rNull )
+        l.setBool(( lNull && rNull ) == ( op == QgsExpression::boIs ) );
+      else if ( numeric )
+        l.setBool(( l.number() == r.number() ) == ( op == QgsExpression::boIs ) );
+      else
+        return false;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+QgsExpressionProgram::QgsExpressionProgram( QgsExpression* parent )
+    : mParent( parent ), mDepth( 0 ), mMaxDepth( 0 ), mConstant( false ), mErrorRow( -1 )
+{
+}
+
+void QgsExpressionProgram::compile( QgsExpression::Node* root )
+{
+  mCode.clear();
+  mConstants.clear();
+  mRegExps.clear();
+  mFunctions.clear();
+  mDepth = 0;
+  mMaxDepth = 0;
+
+  compileNode( root );
+
+  mStack.resize( mMaxDepth );
+}
+
+int QgsExpressionProgram::addInstruction( OpCode code, int a, int b, int depthChange )
+{
+  Instruction instruction = { code, a, b, mDepth };
+  mCode.append( instruction );
+  mDepth += depthChange;
+  mMaxDepth = qMax( mMaxDepth, mDepth );
+  return mCode.count() - 1;
+}
+
+int QgsExpressionProgram::addConstant( const QVariant& value )
+{
+  QgsExpressionValue constant;
+  constant.setVariant( value );
+  mConstants.append( constant );
+  return mConstants.count() - 1;
+}
+
+void QgsExpressionProgram::compileNode( QgsExpression::Node* node )
+{
+  int start = mCode.count();
+  int depth = mDepth;
+
+  node->accept( *this );
+
+  if ( !mConstant || ( mCode.count() == start + 1 && mCode[start].code == PushConstant ) )
+    return;
+
+  // evaluate constant subexpressions once, unless they fail - the error is reported on evaluation then
+  QVariant value = node->eval( mParent, NULL );
+  if ( mParent->hasEvalError() )
+  {
+    mParent->setEvalErrorString( QString() );
+    return;
+  }
+
+  mCode.resize( start );
+  mDepth = depth;
+  addInstruction( PushConstant, addConstant( value ), 0, 1 );
+}
+
+void QgsExpressionProgram::visit( QgsExpression::NodeLiteral* n )
+{
+  addInstruction( PushConstant, addConstant( n->value() ), 0, 1 );
+  mConstant = true;
+}
+
+void QgsExpressionProgram::visit( QgsExpression::NodeColumnRef* n )
+{
+  addInstruction( LoadColumn, n->index(), 0, 1 );
+  mConstant = false;
+}
+
+void QgsExpressionProgram::visit( QgsExpression::NodeUnaryOperator* n )
+{
+  compileNode( n->operand() );
+  bool constant = mConstant;
+  addInstruction( Unary, n->op(), 0, 0 );
+  mConstant = constant;
+}
+
+void QgsExpressionProgram::visit( QgsExpression::NodeBinaryOperator* n )
+{
+  compileNode( n->opLeft() );
+  bool constant = mConstant;
+  int start = mCode.count();
+  compileNode( n->opRight() );
+  constant = constant && mConstant;
+
+  QgsExpression::BinaryOperator op = n->op();
+  bool match = op == QgsExpression::boRegexp || op == QgsExpression::boLike || op == QgsExpression::boILike;
+  if ( match && mCode.count() == start + 1 && mCode[start].code == PushConstant &&
+       mConstants[mCode[start].a].type != QgsExpressionValue::Null )
+  {
+    // constant pattern: build the regular expression only once
+    QString regexp = mConstants[mCode[start].a].variant().toString();
+    mCode.resize( start );
+    mDepth--;
+    if ( op == QgsExpression::boLike || op == QgsExpression::boILike ) // change from LIKE syntax to regexp
+    {
+      regexp.replace( "%", ".*" );
+      regexp.replace( "_", "." );
+      mRegExps.append( QRegExp( regexp, op == QgsExpression::boLike ? Qt::CaseSensitive : Qt::CaseInsensitive ) );
+    }
+    else
+    {
+      mRegExps.append( QRegExp( regexp ) );
+    }
+    addInstruction( MatchRegExp, mRegExps.count() - 1, op, 0 );
+  }
+  else
+  {
+    addInstruction( Binary, op, 0, -1 );
+  }
+  mConstant = constant;
+}
+
+void QgsExpressionProgram::visit( QgsExpression::NodeInOperator* n )
+{
+  QList<QgsExpression::Node*> items = n->list()->list();
+  if ( items.isEmpty() )
+  {
+    addInstruction( PushConstant, addConstant( n->isNotIn() ? TVL_True : TVL_False ), 0, 1 );
+    mConstant = true;
+    return;
+  }
+
+  compileNode( n->node() );
+  bool constant = mConstant;
+
+  QList<int> jumps;
+  jumps << addInstruction( InBegin, 0, 0, 1 );
+  foreach( QgsExpression::Node* item, items )
+  {
+    compileNode( item );
+    constant = constant && mConstant;
+    jumps << addInstruction( InItem, 0, n->isNotIn(), -1 );
+  }
+  addInstruction( InEnd, 0, n->isNotIn(), -1 );
+
+  foreach( int jump, jumps )
+    mCode[jump].a = mCode.count();
+  mConstant = constant;
+}
+
+void QgsExpressionProgram::visit( QgsExpression::NodeFunction* n )
+{
+  const QgsExpression::FunctionDef& fd = QgsExpression::BuiltinFunctions()[n->fnIndex()];
+
+  // functions without parameters give values of the current feature or row,
+  // the others (except geometry functions) only depend on their arguments
+  bool constant = fd.mParams != 0 && !fd.mUsesGeometry;
+
+  QList<int> jumps;
+  int argCount = 0;
+  if ( n->args() )
+  {
+    foreach( QgsExpression::Node* arg, n->args()->list() )
+    {
+      compileNode( arg );
+      constant = constant && mConstant;
+      jumps << addInstruction( CheckArgument, ++argCount, 0, 0 );
+    }
+  }
+
+  mFunctions.append( fd.mFcn );
+  addInstruction( Call, mFunctions.count() - 1, argCount, 1 - argCount );
+
+  foreach( int jump, jumps )
+    mCode[jump].b = mCode.count();
+  mConstant = constant;
+}
+
+void QgsExpressionProgram::visit( QgsExpression::NodeCondition* n )
+{
+  bool constant = true;
+  QList<int> jumps;
+  foreach( QgsExpression::WhenThen* cond, n->conditions() )
+  {
+    compileNode( cond->mWhenExp );
+    constant = constant && mConstant;
+    int next = addInstruction( JumpIfNotTrue, 0, 0, -1 );
+
+    compileNode( cond->mThenExp );
+    constant = constant && mConstant;
+    jumps << addInstruction( Jump, 0, 0, 0 );
+    mDepth--; // the next condition starts without the result
+
+    mCode[next].a = mCode.count();
+  }
+
+  if ( n->elseExp() )
+  {
+    compileNode( n->elseExp() );
+    constant = constant && mConstant;
+  }
+  else
+  {
+    // return NULL if no condition is matching
+    addInstruction( PushConstant, addConstant( QVariant() ), 0, 1 );
+  }
+
+  foreach( int jump, jumps )
+    mCode[jump].a = mCode.count();
+  mConstant = constant;
+}
+
+QVariant QgsExpressionProgram::run( QgsFeature* f )
+{
+  QgsExpressionValue* stack = mStack.data();
+  int top = -1;
+
+  const Instruction* code = mCode.constData();
+  int count = mCode.count();
+  int pc = 0;
+  while ( pc < count )
+  {
+    const Instruction& ins = code[pc++];
+    switch ( ins.code )
+    {
+      case PushConstant:
+        stack[++top] = mConstants[ins.a];
+        break;
+
+      case LoadColumn:
+        if ( f )
+          stack[++top].setVariant( f->attribute( ins.a ) );
+        else
+          stack[++top].setNull();
+        break;
+
+      case Unary:
+        if ( !evalUnaryFast(( QgsExpression::UnaryOperator ) ins.a, stack[top] ) )
+        {
+          QVariant res = evalUnaryOperator(( QgsExpression::UnaryOperator ) ins.a, stack[top].variant(), mParent );
+          if ( mParent->hasEvalError() )
+            return QVariant();
+          stack[top].setVariant( res );
+        }
+        break;
+
+      case Binary:
+        if ( !evalBinaryFast(( QgsExpression::BinaryOperator ) ins.a, stack[top - 1], stack[top] ) )
+        {
+          QVariant res = evalBinaryOperator(( QgsExpression::BinaryOperator ) ins.a, stack[top - 1].variant(), stack[top].variant(), mParent );
+          if ( mParent->hasEvalError() )
+            return QVariant();
+          stack[top - 1].setVariant( res );
+        }
+        --top;
+        break;
+
+      case MatchRegExp:
+        if ( stack[top].type == QgsExpressionValue::Null )
+        {
+          stack[top].setNull();
+        }
+        else
+        {
+          QString str = stack[top].variant().toString();
+          QRegExp& regexp = mRegExps[ins.a];
+          if ( ins.b == QgsExpression::boRegexp )
+            stack[top].setBool( regexp.indexIn( str ) != -1 );
+          else
+            stack[top].setBool( regexp.exactMatch( str ) );
+        }
+        break;
+
+      case CheckArgument:
+        if ( stack[top].type == QgsExpressionValue::Null )
+        {
+          // all "normal" functions return NULL when any parameter is NULL
+          top -= ins.a;
+          stack[++top].setNull();
+          pc = ins.b;
+        }
+        break;
+
+      case Call:
+      {
+        QVariantList args;
+        for ( int i = top - ins.b + 1; i <= top; ++i )
+          args.append( stack[i].variant() );
+        top -= ins.b;
+
+        QVariant res = mFunctions[ins.a]( args, f, mParent );
+        if ( mParent->hasEvalError() )
+          return QVariant();
+        stack[++top].setVariant( res );
+        break;
+      }
+
+      case InBegin:
+        if ( stack[top].type == QgsExpressionValue::Null )
+        {
+          stack[top].setNull();
+          pc = ins.a;
+        }
+        else
+        {
+          stack[++top].setInt( 0 );
+        }
+        break;
+
+      case InItem:
+      {
+        const QgsExpressionValue& item = stack[top];
+        const QgsExpressionValue& value = stack[top - 2];
+        if ( item.type == QgsExpressionValue::Null )
+        {
+          stack[top - 1].setInt( 1 );
+          --top;
+          break;
+        }
+
+        bool equal;
+        if ( item.isNumeric() && value.isNumeric() )
+        {
+          equal = value.number() == item.number();
+        }
+        else
+        {
+          equal = inListEqual( value.variant(), item.variant(), mParent );
+          if ( mParent->hasEvalError() )
+            return QVariant();
+        }
+
+        if ( equal )
+        {
+          top -= 2;
+          stack[top].setBool( !ins.b );
+          pc = ins.a;
+        }
+        else
+        {
+          --top;
+        }
+        break;
+      }
+
+      case InEnd:
+      {
+        bool listHasNull = stack[top--].i != 0;
+        if ( listHasNull )
+          stack[top].setNull();
+        else
+          stack[top].setBool( ins.b );
+        break;
+      }
+
+      case JumpIfNotTrue:
+      {
+        const QgsExpressionValue& value = stack[top--];
+        TVL tvl;
+        if ( !tvlFast( value, tvl ) )
+        {
+          tvl = getTVLValue( value.variant(), mParent );
+          if ( mParent->hasEvalError() )
+            return QVariant();
+        }
+        if ( tvl != True )
+          pc = ins.a;
+        break;
+      }
+
+      case Jump:
+        pc = ins.a;
+        break;
+    }
+  }
+
+  Q_ASSERT( top == 0 );
+  return stack[0].variant();
+}
+
+///////////////////////////////////////////////
+// column evaluation of compiled programs
+
+static void columnValue( const QgsExpressionColumn& column, int row, QgsExpressionValue& value )
+{
+  if ( column.isNull( row ) || column.type() == QgsExpressionColumn::Variant )
+    value.setVariant( column.value( row ) );
+  else if ( column.type() == QgsExpressionColumn::Int )
+    value.setInt( column.intData()[row] );
+  else
+    value.setDouble( column.doubleData()[row] );
+}
+
+static void setColumnValue( QgsExpressionColumn& column, int row, const QgsExpressionValue& value )
+{
+  switch ( value.type )
+  {
+    case QgsExpressionValue::Int:
+      column.setInt( row, value.i );
+      break;
+    case QgsExpressionValue::Double:
+      column.setDouble( row, value.d );
+      break;
+    default:
+      column.setValue( row, value.v );
+      break;
+  }
+}
+
+static QgsExpressionColumn constantColumn( const QgsExpressionValue& value, int count )
+{
+  QgsExpressionColumn::Type type = QgsExpressionColumn::Variant;
+  if ( value.type == QgsExpressionValue::Int )
+    type = QgsExpressionColumn::Int;
+  else if ( value.type == QgsExpressionValue::Double )
+    type = QgsExpressionColumn::Double;
+
+  QgsExpressionColumn column( type, count );
+  for ( int row = 0; row < count; ++row )
+  {
+    setColumnValue( column, row, value );
+  }
+  return column;
+}
+
+// The kernels below process whole integer or double columns in plain loops
+// without branches on the values where possible, so that the compiler can vectorize them.
+
+static bool isNumericColumn( const QgsExpressionColumn& column )
+{
+  return column.type() == QgsExpressionColumn::Int || column.type() == QgsExpressionColumn::Double;
+}
+
+// values of a numeric column as doubles, integers are converted into the buffer
+static const double* doubleValues( const QgsExpressionColumn& column, QVector<double>& buffer )
+{
+  if ( column.type() == QgsExpressionColumn::Double )
+    return column.doubleData();
+
+  int count = column.count();
+  const int* x = column.intData();
+  buffer.resize( count );
+  double* out = buffer.data();
+  for ( int i = 0; i < count; ++i )
+    out[i] = x[i];
+  return buffer.constData();
+}
+
+// results are null (invalid QVariant) where any operand is null
+static void mergeNulls( const char* x, const char* y, char* out, int count )
+{
+  for ( int i = 0; i < count; ++i )
+    out[i] = ( x[i] | y[i] ) != 0;
+}
+
+// keep the values of null rows at zero
+template <typename T>
+static void clearNullValues( T* values, const char* nulls, int count )
+{
+  for ( int i = 0; i < count; ++i )
+    values[i] = nulls[i] ? 0 : values[i];
+}
+
+template <typename T>
+static void compareColumns( QgsExpression::BinaryOperator op, const T* x, const T* y, int* out, int count )
+{
+  // same as compareOp() on the difference
+  switch ( op )
+  {
+    case QgsExpression::boEQ:
+      for ( int i = 0; i < count; ++i ) out[i] = x[i] - y[i] == 0;
+      break;
+    case QgsExpression::boNE:
+      for ( int i = 0; i < count; ++i ) out[i] = x[i] - y[i] != 0;
+      break;
+    case QgsExpression::boLT:
+      for ( int i = 0; i < count; ++i ) out[i] = x[i] - y[i] < 0;
+      break;
+    case QgsExpression::boGT:
+      for ( int i = 0; i < count; ++i ) out[i] = x[i] - y[i] > 0;
+      break;
+    case QgsExpression::boLE:
+      for ( int i = 0; i < count; ++i ) out[i] = x[i] - y[i] <= 0;
+      break;
+    case QgsExpression::boGE:
+      for ( int i = 0; i < count; ++i ) out[i] = x[i] - y[i] >= 0;
+      break;
+    default:
+      Q_ASSERT( false );
+  }
+}
+
+static bool evalUnaryColumn( QgsExpression::UnaryOperator op, QgsExpressionColumn& column )
+{
+  if ( !isNumericColumn( column ) )
+    return false;
+
+  int count = column.count();
+  const QgsExpressionColumn in = column;
+  const char* nulls = in.nullMask();
+
+  switch ( op )
+  {
+    case QgsExpression::uoNot:
+    {
+      QgsExpressionColumn result( QgsExpressionColumn::Int, count );
+      int* out = result.intData();
+      char* outNulls = result.nullMask();
+      QVector<double> buffer;
+      const double* x = doubleValues( in, buffer );
+      for ( int i = 0; i < count; ++i )
+      {
+        out[i] = x[i] == 0 && !nulls[i];
+        outNulls[i] = nulls[i] != 0;
+      }
+      column = result;
+      return true;
+    }
+
+    case QgsExpression::uoMinus:
+    {
+      // null operands are left to evalUnaryOperator()
+      for ( int i = 0; i < count; ++i )
+      {
+        if ( nulls[i] )
+          return false;
+      }
+      if ( column.type() == QgsExpressionColumn::Int )
+      {
+        int* x = column.intData();
+        for ( int i = 0; i < count; ++i )
+          x[i] = -x[i];
+      }
+      else
+      {
+        double* x = column.doubleData();
+        for ( int i = 0; i < count; ++i )
+          x[i] = -x[i];
+      }
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+static bool evalBinaryColumn( QgsExpression::BinaryOperator op, QgsExpressionColumn& left, const QgsExpressionColumn& right )
+{
+  if ( !isNumericColumn( left ) || !isNumericColumn( right ) )
+    return false;
+
+  int count = left.count();
+  const QgsExpressionColumn l = left;
+  const QgsExpressionColumn& r = right;
+  const char* lNulls = l.nullMask();
+  const char* rNulls = r.nullMask();
+  bool ints = l.type() == QgsExpressionColumn::Int && r.type() == QgsExpressionColumn::Int;
+  QVector<double> lBuffer, rBuffer;
+
+  switch ( op )
+  {
+    case QgsExpression::boPlus:
+    case QgsExpression::boMinus:
+    case QgsExpression::boMul:
+    case QgsExpression::boDiv:
+    case QgsExpression::boMod:
+      if ( ints )
+      {
+        QgsExpressionColumn result( QgsExpressionColumn::Int, count );
+        int* out = result.intData();
+        char* outNulls = result.nullMask();
+        const int* x = l.intData();
+        const int* y = r.intData();
+        mergeNulls( lNulls, rNulls, outNulls, count );
+        switch ( op )
+        {
+          case QgsExpression::boPlus:
+            for ( int i = 0; i < count; ++i ) out[i] = x[i] + y[i];
+            break;
+          case QgsExpression::boMinus:
+            for ( int i = 0; i < count; ++i ) out[i] = x[i] - y[i];
+            break;
+          case QgsExpression::boMul:
+            for ( int i = 0; i < count; ++i ) out[i] = x[i] * y[i];
+            break;
+          default:
+            // division by zero gives NULL like in evalBinaryOperator() (null rows hold zero, so they get here too)
+            for ( int i = 0; i < count; ++i )
+            {
+              if ( y[i] == 0 )
+                outNulls[i] = 1;
+              else
+                out[i] = op == QgsExpression::boDiv ? x[i] / y[i] : x[i] % y[i];
+            }
+            break;
+        }
+        clearNullValues( out, outNulls, count );
+        left = result;
+      }
+      else
+      {
+        QgsExpressionColumn result( QgsExpressionColumn::Double, count );
+        double* out = result.doubleData();
+        char* outNulls = result.nullMask();
+        const double* x = doubleValues( l, lBuffer );
+        const double* y = doubleValues( r, rBuffer );
+        mergeNulls( lNulls, rNulls, outNulls, count );
+        switch ( op )
+        {
+          case QgsExpression::boPlus:
+            for ( int i = 0; i < count; ++i ) out[i] = x[i] + y[i];
+            break;
+          case QgsExpression::boMinus:
+            for ( int i = 0; i < count; ++i ) out[i] = x[i] - y[i];
+            break;
+          case QgsExpression::boMul:
+            for ( int i = 0; i < count; ++i ) out[i] = x[i] * y[i];
+            break;
+          case QgsExpression::boDiv:
+            for ( int i = 0; i < count; ++i )
+            {
+              outNulls[i] |= y[i] == 0;
+              out[i] = x[i] / y[i];
+            }
+            break;
+          default:
+            for ( int i = 0; i < count; ++i ) out[i] = fmod( x[i], y[i] );
+            break;
+        }
+        clearNullValues( out, outNulls, count );
+        left = result;
+      }
+      return true;
+
+    case QgsExpression::boPow:
+    {
+      QgsExpressionColumn result( QgsExpressionColumn::Double, count );
+      double* out = result.doubleData();
+      char* outNulls = result.nullMask();
+      const double* x = doubleValues( l, lBuffer );
+      const double* y = doubleValues( r, rBuffer );
+      mergeNulls( lNulls, rNulls, outNulls, count );
+      for ( int i = 0; i < count; ++i )
+        out[i] = pow( x[i], y[i] );
+      clearNullValues( out, outNulls, count );
+      left = result;
+      return true;
+    }
+
+    case QgsExpression::boAnd:
+    case QgsExpression::boOr:
+    {
+      QgsExpressionColumn result( QgsExpressionColumn::Int, count );
+      int* out = result.intData();
+      char* outNulls = result.nullMask();
+      const double* x = doubleValues( l, lBuffer );
+      const double* y = doubleValues( r, rBuffer );
+      TVL( *table )[3] = op == QgsExpression::boAnd ? AND : OR;
+      for ( int i = 0; i < count; ++i )
+      {
+        TVL tvlL = lNulls[i] ? Unknown : ( x[i] != 0 ? True : False );
+        TVL tvlR = rNulls[i] ? Unknown : ( y[i] != 0 ? True : False );
+        TVL tvl = table[tvlL][tvlR];
+        out[i] = tvl == True;
+        outNulls[i] = tvl == Unknown;
+      }
+      left = result;
+      return true;
+    }
+
+    case QgsExpression::boEQ:
+    case QgsExpression::boNE:
+    case QgsExpression::boLT:
+    case QgsExpression::boGT:
+    case QgsExpression::boLE:
+    case QgsExpression::boGE:
+    {
+      QgsExpressionColumn result( QgsExpressionColumn::Int, count );
+      int* out = result.intData();
+      char* outNulls = result.nullMask();
+      if ( ints )
+      {
+        // the difference of two integers is exact as double, compare them directly
+        QVector<qint64> xBuffer( count ), yBuffer( count );
+        const int* x = l.intData();
+        const int* y = r.intData();
+        for ( int i = 0; i < count; ++i )
+        {
+          xBuffer[i] = x[i];
+          yBuffer[i] = y[i];
+        }
+        compareColumns( op, xBuffer.constData(), yBuffer.constData(), out, count );
+      }
+      else
+      {
+        compareColumns( op, doubleValues( l, lBuffer ), doubleValues( r, rBuffer ), out, count );
+      }
+      mergeNulls( lNulls, rNulls, outNulls, count );
+      clearNullValues( out, outNulls, count );
+      left = result;
+      return true;
+    }
+
+    case QgsExpression::boIs:
+    case QgsExpression::boIsNot:
+    {
+      QgsExpressionColumn result( QgsExpressionColumn::Int, count );
+      int* out = result.intData();
+      char* outNulls = result.nullMask();
+      const double* x = doubleValues( l, lBuffer );
+      const double* y = doubleValues( r, rBuffer );
+      int is = op == QgsExpression::boIs;
+      for ( int i = 0; i < count; ++i )
+      {
+        bool lNull = lNulls[i] != 0;
+        bool rNull = rNulls[i] != 0;
+        bool equal = ( lNull || rNull ) ? lNull && rNull : x[i] == y[i];
+        out[i] = equal == is;
+        outNulls[i] = 0;
+      }
+      left = result;
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+void QgsExpressionProgram::failRow( int row )
+{
+  // report the error of the first row, as evaluating the rows one by one would
+  if ( mErrorRow == -1 || row < mErrorRow )
+  {
+    mErrorRow = row;
+    mErrorString = mParent->evalErrorString();
+  }
+  mFailedRows.append( row );
+  mParent->setEvalErrorString( QString() );
+}
+
+QgsExpressionColumn QgsExpressionProgram::run( const QgsExpressionBlock& block )
+{
+  int count = block.count();
+  int firstRowNumber = mParent->currentRowNumber();
+  mFailedRows.clear();
+  mErrorRow = -1;
+  mErrorString = QString();
+
+  QVector<QgsExpressionColumn> stack( mMaxDepth, QgsExpressionColumn( QgsExpressionColumn::Variant, count ) );
+
+  // rows evaluated by the current instruction - rows taking a jump wait for its target.
+  // As jumps only go forward and the stack size at a target does not depend on the
+  // path, each stack position can keep the values of all rows in one column.
+  QVector<int> rows( count );
+  for ( int row = 0; row < count; ++row )
+    rows[row] = row;
+  QMap<int, QVector<int> > waiting;
+
+  QgsExpressionValue l, r;
+  QVariantList args;
+
+  for ( int pc = 0; pc < mCode.count(); ++pc )
+  {
+    QMap<int, QVector<int> >::iterator it = waiting.find( pc );
+    if ( it != waiting.end() )
+    {
+      rows += it.value();
+      qSort( rows );
+      waiting.erase( it );
+    }
+    if ( rows.isEmpty() )
+      continue;
+
+    const Instruction& ins = mCode[pc];
+    int top = ins.depth - 1;
+    // with all rows present the kernels process whole columns
+    bool dense = rows.count() == count;
+    // rows continuing with the next instruction
+    int kept = 0;
+
+    switch ( ins.code )
+    {
+      case PushConstant:
+        if ( dense )
+        {
+          stack[top + 1] = constantColumn( mConstants[ins.a], count );
+        }
+        else
+        {
+          foreach( int row, rows )
+            setColumnValue( stack[top + 1], row, mConstants[ins.a] );
+        }
+        kept = rows.count();
+        break;
+
+      case LoadColumn:
+        if ( dense )
+        {
+          stack[top + 1] = block.column( ins.a );
+        }
+        else
+        {
+          QgsExpressionColumn column = block.column( ins.a );
+          foreach( int row, rows )
+          {
+            columnValue( column, row, l );
+            setColumnValue( stack[top + 1], row, l );
+          }
+        }
+        kept = rows.count();
+        break;
+
+      case Unary:
+      {
+        QgsExpression::UnaryOperator op = ( QgsExpression::UnaryOperator ) ins.a;
+        if ( dense && evalUnaryColumn( op, stack[top] ) )
+        {
+          kept = rows.count();
+          break;
+        }
+        foreach( int row, rows )
+        {
+          columnValue( stack[top], row, l );
+          if ( !evalUnaryFast( op, l ) )
+          {
+            QVariant res = evalUnaryOperator( op, l.variant(), mParent );
+            if ( mParent->hasEvalError() )
+            {
+              failRow( row );
+              continue;
+            }
+            l.setVariant( res );
+          }
+          setColumnValue( stack[top], row, l );
+          rows[kept++] = row;
+        }
+        break;
+      }
+
+      case Binary:
+      {
+        QgsExpression::BinaryOperator op = ( QgsExpression::BinaryOperator ) ins.a;
+        if ( dense && evalBinaryColumn( op, stack[top - 1], stack[top] ) )
+        {
+          kept = rows.count();
+          break;
+        }
+        foreach( int row, rows )
+        {
+          columnValue( stack[top - 1], row, l );
+          columnValue( stack[top], row, r );
+          if ( !evalBinaryFast( op, l, r ) )
+          {
+            QVariant res = evalBinaryOperator( op, l.variant(), r.variant(), mParent );
+            if ( mParent->hasEvalError() )
+            {
+              failRow( row );
+              continue;
+            }
+            l.setVariant( res );
+          }
+          setColumnValue( stack[top - 1], row, l );
+          rows[kept++] = row;
+        }
+        break;
+      }
+
+      case MatchRegExp:
+      {
+        QRegExp& regexp = mRegExps[ins.a];
+        foreach( int row, rows )
+        {
+          if ( stack[top].isNull( row ) )
+          {
+            stack[top].setNull( row );
+          }
+          else
+          {
+            QString str = stack[top].value( row ).toString();
+            if ( ins.b == QgsExpression::boRegexp )
+              stack[top].setInt( row, regexp.indexIn( str ) != -1 );
+            else
+              stack[top].setInt( row, regexp.exactMatch( str ) );
+          }
+        }
+        kept = rows.count();
+        break;
+      }
+
+      case CheckArgument:
+        foreach( int row, rows )
+        {
+          if ( stack[top].isNull( row ) )
+          {
+            stack[top - ins.a + 1].setNull( row );
+            waiting[ins.b].append( row );
+            continue;
+          }
+          rows[kept++] = row;
+        }
+        break;
+
+      case Call:
+        foreach( int row, rows )
+        {
+          args.clear();
+          for ( int i = top - ins.b + 1; i <= top; ++i )
+            args.append( stack[i].value( row ) );
+
+          mParent->setCurrentRowNumber( firstRowNumber + row );
+          QVariant res = mFunctions[ins.a]( args, block.feature( row ), mParent );
+          if ( mParent->hasEvalError() )
+          {
+            failRow( row );
+            continue;
+          }
+          stack[top - ins.b + 1].setValue( row, res );
+          rows[kept++] = row;
+        }
+        break;
+
+      case InBegin:
+        foreach( int row, rows )
+        {
+          if ( stack[top].isNull( row ) )
+          {
+            stack[top].setNull( row );
+            waiting[ins.a].append( row );
+            continue;
+          }
+          stack[top + 1].setInt( row, 0 );
+          rows[kept++] = row;
+        }
+        break;
+
+      case InItem:
+        foreach( int row, rows )
+        {
+          columnValue( stack[top], row, r );
+          if ( r.type == QgsExpressionValue::Null )
+          {
+            stack[top - 1].setInt( row, 1 );
+            rows[kept++] = row;
+            continue;
+          }
+
+          columnValue( stack[top - 2], row, l );
+          bool equal;
+          if ( r.isNumeric() && l.isNumeric() )
+          {
+            equal = l.number() == r.number();
+          }
+          else
+          {
+            equal = inListEqual( l.variant(), r.variant(), mParent );
+            if ( mParent->hasEvalError() )
+            {
+              failRow( row );
+              continue;
+            }
+          }
+
+          if ( equal )
+          {
+            stack[top - 2].setInt( row, !ins.b );
+            waiting[ins.a].append( row );
+            continue;
+          }
+          rows[kept++] = row;
+        }
+        break;
+
+      case InEnd:
+        foreach( int row, rows )
+        {
+          bool listHasNull = stack[top].value( row ).toInt() != 0;
+          if ( listHasNull )
+            stack[top - 1].setNull( row );
+          else
+            stack[top - 1].setInt( row, ins.b ? 1 : 0 );
+        }
+        kept = rows.count();
+        break;
+
+      case JumpIfNotTrue:
+        foreach( int row, rows )
+        {
+          columnValue( stack[top], row, l );
+          TVL tvl;
+          if ( !tvlFast( l, tvl ) )
+          {
+            tvl = getTVLValue( l.variant(), mParent );
+            if ( mParent->hasEvalError() )
+            {
+              failRow( row );
+              continue;
+            }
+          }
+          if ( tvl != True )
+          {
+            waiting[ins.a].append( row );
+            continue;
+          }
+          rows[kept++] = row;
+        }
+        break;
+
+      case Jump:
+        waiting[ins.a] += rows;
+        break;
+    }
+
+    rows.resize( kept );
+  }
+
+  mParent->setCurrentRowNumber( firstRowNumber );
+
+  QgsExpressionColumn result = stack[0];
+  foreach( int row, mFailedRows )
+    result.setNull( row );
+  mParent->setEvalErrorString( mErrorString );
+  return result;
+}
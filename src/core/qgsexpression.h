@@ -22,10 +22,12 @@
 #include <QDomDocument>
 
 #include "qgsfield.h"
+#include "qgsexpressionblock.h"
 
 class QgsDistanceArea;
 class QgsFeature;
 class QDomElement;
+class QgsExpressionProgram;
 
 /**
 Class for parsing and evaluation of expressions (formerly called "search strings").
@@ -91,8 +93,19 @@ class CORE_EXPORT QgsExpression
     QString parserErrorString() const { return mParserErrorString; }
 
     //! Get the expression ready for evaluation - find out column indexes.
+    //! The expression is also compiled to a flat program with resolved columns and
+    //! folded constants, which evaluate() runs instead of walking the node tree.
     bool prepare( const QgsFieldMap& fields );
 
+    //! Returns true if the last call of prepare() compiled the expression
+    //! @note added in 1.9
+    bool isCompiled() const { return mProgram != NULL; }
+
+    //! Enable or disable compilation of the expression in prepare() (enabled by default).
+    //! Without compilation the node tree is evaluated, which is useful for comparisons.
+    //! @note added in 1.9
+    void setCompilationEnabled( bool enabled );
+
     //! Get list of columns referenced by the expression
     QStringList referencedColumns();
     //! Returns true if the expression uses feature geometry for some computation
@@ -108,6 +121,15 @@ class CORE_EXPORT QgsExpression
     //! @note this method does not expect that prepare() has been called on this instance
     QVariant evaluate( QgsFeature* f, const QgsFieldMap& fields );
 
+    //! Evaluate all rows of a block and return the column of results. Compiled expressions
+    //! are evaluated an operator at a time for all rows, with kernels for whole integer and
+    //! double columns, functions are called a row at a time. The rows are numbered for $rownum
+    //! from currentRowNumber(). Rows which fail are null and evalErrorString() returns the
+    //! error of the first of them.
+    //! @note prepare() should be called before calling this method
+    //! @note added in 1.9
+    QgsExpressionColumn evaluate( const QgsExpressionBlock& block );
+
     //! Returns true if an error occurred when evaluating last input
     bool hasEvalError() const { return !mEvalErrorString.isNull(); }
     //! Returns evaluation error
@@ -284,10 +306,6 @@ class CORE_EXPORT QgsExpression
         virtual void accept( Visitor& v ) { v.visit( this ); }
 
       protected:
-        bool compare( double diff );
-        int computeInt( int x, int y );
-        double computeDouble( double x, double y );
-
         BinaryOperator mOp;
         Node* mOpLeft;
         Node* mOpRight;
@@ -363,6 +381,9 @@ class CORE_EXPORT QgsExpression
         NodeColumnRef( QString name ) : mName( name ), mIndex( -1 ) {}
 
         QString name() { return mName; }
+        //! index of the column, found by prepare()
+        //! @note added in 1.9
+        int index() { return mIndex; }
 
         virtual bool prepare( QgsExpression* parent, const QgsFieldMap& fields );
         virtual QVariant eval( QgsExpression* parent, QgsFeature* f );
@@ -394,6 +415,9 @@ class CORE_EXPORT QgsExpression
         NodeCondition( WhenThenList* conditions, Node* elseExp = NULL ) : mConditions( *conditions ), mElseExp( elseExp ) { delete conditions; }
         ~NodeCondition() { delete mElseExp; foreach( WhenThen* cond, mConditions ) delete cond; }
 
+        WhenThenList conditions() { return mConditions; }
+        Node* elseExp() { return mElseExp; }
+
         virtual QVariant eval( QgsExpression* parent, QgsFeature* f );
         virtual bool prepare( QgsExpression* parent, const QgsFieldMap& fields );
         virtual QString dump() const;
@@ -438,6 +462,9 @@ class CORE_EXPORT QgsExpression
 
     void initGeomCalculator();
     QgsDistanceArea* mCalc;
+
+    QgsExpressionProgram* mProgram;
+    bool mCompilationEnabled;
 };
 
 #endif // QGSEXPRESSION_H
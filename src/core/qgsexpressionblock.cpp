@@ -0,0 +1,203 @@
+/***************************************************************************
+    qgsexpressionblock.cpp - column oriented input and output of expressions
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionblock.h"
+
+QgsExpressionColumn::QgsExpressionColumn( Type type, int count )
+    : mType( type )
+    , mNulls( count, 1 )
+{
+  switch ( type )
+  {
+    case Int:
+      mInts.fill( 0, count );
+      break;
+    case Double:
+      mDoubles.fill( 0, count );
+      break;
+    case Variant:
+      mVariants.resize( count );
+      break;
+  }
+}
+
+QgsExpressionColumn QgsExpressionColumn::fromValues( const QVector<QVariant>& values )
+{
+  // use the narrowest type that keeps the values and the types of the nulls
+  bool isInt = true;
+  bool isDouble = true;
+  foreach( const QVariant& value, values )
+  {
+    if ( value.type() == QVariant::Invalid )
+      continue;
+    isInt = isInt && value.type() == QVariant::Int;
+    isDouble = isDouble && value.type() == QVariant::Double;
+    if ( !isInt && !isDouble )
+      break;
+  }
+
+  QgsExpressionColumn column( isInt ? Int : ( isDouble ? Double : Variant ), values.count() );
+  for ( int row = 0; row < values.count(); ++row )
+  {
+    column.setValue( row, values[row] );
+  }
+  return column;
+}
+
+QVariant QgsExpressionColumn::value( int row ) const
+{
+  switch ( mType )
+  {
+    case Int:
+      if ( mNulls[row] )
+        return mNulls[row] == 2 ? QVariant( QVariant::Int ) : QVariant();
+      return QVariant( mInts[row] );
+
+    case Double:
+      if ( mNulls[row] )
+        return mNulls[row] == 2 ? QVariant( QVariant::Double ) : QVariant();
+      return QVariant( mDoubles[row] );
+
+    default:
+      return mVariants[row];
+  }
+}
+
+void QgsExpressionColumn::setValue( int row, const QVariant& value )
+{
+  if ( mType == Int || mType == Double )
+  {
+    QVariant::Type type = mType == Int ? QVariant::Int : QVariant::Double;
+    if ( value.type() == QVariant::Invalid )
+    {
+      setNull( row );
+      return;
+    }
+    else if ( value.type() == type )
+    {
+      if ( value.isNull() )
+      {
+        setNull( row );
+        mNulls[row] = 2;
+      }
+      else if ( mType == Int )
+      {
+        setInt( row, value.toInt() );
+      }
+      else
+      {
+        setDouble( row, value.toDouble() );
+      }
+      return;
+    }
+    convertToVariant();
+  }
+
+  mVariants[row] = value;
+  mNulls[row] = value.isNull() ? 1 : 0;
+}
+
+void QgsExpressionColumn::setInt( int row, int value )
+{
+  if ( mType != Int )
+  {
+    setValue( row, QVariant( value ) );
+    return;
+  }
+  mInts[row] = value;
+  mNulls[row] = 0;
+}
+
+void QgsExpressionColumn::setDouble( int row, double value )
+{
+  if ( mType != Double )
+  {
+    setValue( row, QVariant( value ) );
+    return;
+  }
+  mDoubles[row] = value;
+  mNulls[row] = 0;
+}
+
+void QgsExpressionColumn::setNull( int row )
+{
+  switch ( mType )
+  {
+    case Int:
+      mInts[row] = 0;
+      break;
+    case Double:
+      mDoubles[row] = 0;
+      break;
+    case Variant:
+      mVariants[row] = QVariant();
+      break;
+  }
+  mNulls[row] = 1;
+}
+
+void QgsExpressionColumn::convertToVariant()
+{
+  if ( mType == Variant )
+    return;
+
+  mVariants.resize( count() );
+  for ( int row = 0; row < count(); ++row )
+  {
+    mVariants[row] = value( row );
+  }
+  mType = Variant;
+  mInts.clear();
+  mDoubles.clear();
+}
+
+
+QgsExpressionBlock::QgsExpressionBlock( int count )
+    : mCount( count )
+{
+}
+
+QgsExpressionBlock::QgsExpressionBlock( QgsFeatureList& features, const QgsAttributeList& attributes )
+    : mCount( features.count() )
+{
+  mFeatures.reserve( mCount );
+  for ( QgsFeatureList::iterator it = features.begin(); it != features.end(); ++it )
+  {
+    mFeatures.append( &( *it ) );
+  }
+
+  QVector<QVariant> values( mCount );
+  foreach( int attr, attributes )
+  {
+    for ( int row = 0; row < mCount; ++row )
+    {
+      values[row] = mFeatures[row]->attribute( attr );
+    }
+    mColumns.insert( attr, QgsExpressionColumn::fromValues( values ) );
+  }
+}
+
+void QgsExpressionBlock::setColumn( int attr, const QgsExpressionColumn& column )
+{
+  Q_ASSERT( column.count() == mCount );
+  mColumns.insert( attr, column );
+}
+
+QgsExpressionColumn QgsExpressionBlock::column( int attr ) const
+{
+  QMap<int, QgsExpressionColumn>::const_iterator it = mColumns.constFind( attr );
+  if ( it == mColumns.constEnd() )
+    return QgsExpressionColumn( QgsExpressionColumn::Variant, mCount );
+  return it.value();
+}
@@ -0,0 +1,122 @@
+/***************************************************************************
+    qgsexpressionblock.h - column oriented input and output of expressions
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONBLOCK_H
+#define QGSEXPRESSIONBLOCK_H
+
+#include <QList>
+#include <QMap>
+#include <QVariant>
+#include <QVector>
+
+#include "qgsfeature.h"
+
+typedef QList<int> QgsAttributeList;
+
+/** \ingroup core
+ * Column of values used as input and result of QgsExpression::evaluate( const QgsExpressionBlock& ).
+ * Integer and double columns keep their values in plain arrays, other columns keep QVariants.
+ * A null mask tells which rows are null, the value of a null row in an integer or double
+ * column is 0.
+ * @note added in 1.9
+ */
+class CORE_EXPORT QgsExpressionColumn
+{
+  public:
+    enum Type
+    {
+      Int,
+      Double,
+      Variant
+    };
+
+    //! Constructs a column of count null values
+    QgsExpressionColumn( Type type = Variant, int count = 0 );
+
+    //! Constructs a column from values, using an integer or double column if all values allow it
+    static QgsExpressionColumn fromValues( const QVector<QVariant>& values );
+
+    Type type() const { return mType; }
+    int count() const { return mNulls.count(); }
+
+    bool isNull( int row ) const { return mNulls[row] != 0; }
+    //! Returns the value of a row as QVariant
+    QVariant value( int row ) const;
+
+    //! Sets the value of a row, the column is converted to a variant column if the type does not match
+    void setValue( int row, const QVariant& value );
+    void setInt( int row, int value );
+    void setDouble( int row, double value );
+    void setNull( int row );
+
+    //! Converts an integer or double column to a variant column
+    void convertToVariant();
+
+    //! Values of an integer column
+    const int* intData() const { return mInts.constData(); }
+    int* intData() { return mInts.data(); }
+    //! Values of a double column
+    const double* doubleData() const { return mDoubles.constData(); }
+    double* doubleData() { return mDoubles.data(); }
+    //! Values of a variant column
+    const QVariant* variantData() const { return mVariants.constData(); }
+    //! Null mask: 0 for values, 1 for invalid QVariant nulls, 2 for nulls of the column type
+    const char* nullMask() const { return mNulls.constData(); }
+    char* nullMask() { return mNulls.data(); }
+
+  private:
+    Type mType;
+    QVector<int> mInts;
+    QVector<double> mDoubles;
+    QVector<QVariant> mVariants;
+    QVector<char> mNulls;
+};
+
+/** \ingroup core
+ * Block of rows for column oriented evaluation of expressions with
+ * QgsExpression::evaluate( const QgsExpressionBlock& ). The block holds a column
+ * for every attribute the expression references and optionally the features of the rows,
+ * which are needed for functions using the feature id or geometry.
+ * @note added in 1.9
+ */
+class CORE_EXPORT QgsExpressionBlock
+{
+  public:
+    //! Constructs an empty block of count rows, columns are added with setColumn()
+    QgsExpressionBlock( int count = 0 );
+
+    //! Constructs a block of the given attributes of features. The features
+    //! are referenced by the block and have to be kept alive while it is used
+    QgsExpressionBlock( QgsFeatureList& features, const QgsAttributeList& attributes );
+
+    int count() const { return mCount; }
+
+    //! Sets the column of an attribute, it needs to have count() rows
+    void setColumn( int attr, const QgsExpressionColumn& column );
+    bool hasColumn( int attr ) const { return mColumns.contains( attr ); }
+    //! Returns the column of an attribute or a column of nulls if there is none
+    QgsExpressionColumn column( int attr ) const;
+    //! Returns the attributes which have a column
+    QgsAttributeList attributes() const { return mColumns.keys(); }
+
+    //! Returns the feature of a row or NULL if the block was not constructed from features
+    QgsFeature* feature( int row ) const { return mFeatures.isEmpty() ? NULL : mFeatures[row]; }
+
+  private:
+    int mCount;
+    QMap<int, QgsExpressionColumn> mColumns;
+    QVector<QgsFeature*> mFeatures;
+};
+
+#endif // QGSEXPRESSIONBLOCK_H
@@ -16,6 +16,7 @@ email                : sherman at mrcc.com
 #include "qgsfeature.h"
 #include "qgsgeometry.h"
 #include "qgsrectangle.h"
+#include "qgslogger.h"
 
 /** \class QgsFeature
  * \brief Encapsulates a spatial feature with attributes
@@ -23,6 +24,8 @@ email                : sherman at mrcc.com
 
 QgsFeature::QgsFeature( QgsFeatureId id, QString typeName )
     : mFid( id )
+    , mAttributeMapValid( true )
+    , mAttributeMapUsed( false )
     , mGeometry( 0 )
     , mOwnsGeometry( 0 )
     , mValid( false )
@@ -35,6 +38,10 @@ QgsFeature::QgsFeature( QgsFeatureId id, QString typeName )
 QgsFeature::QgsFeature( QgsFeature const & rhs )
     : mFid( rhs.mFid )
     , mAttributes( rhs.mAttributes )
+    , mAttributeSet( rhs.mAttributeSet )
+    , mAttributeMap( rhs.mAttributeMap )
+    , mAttributeMapValid( rhs.mAttributeMapValid )
+    , mAttributeMapUsed( false )
     , mGeometry( 0 )
     , mOwnsGeometry( false )
     , mValid( rhs.mValid )
@@ -58,6 +65,9 @@ QgsFeature & QgsFeature::operator=( QgsFeature const & rhs )
   mFid =  rhs.mFid;
   mDirty =  rhs.mDirty;
   mAttributes =  rhs.mAttributes;
+  mAttributeSet = rhs.mAttributeSet;
+  mAttributeMap = rhs.mAttributeMap;
+  mAttributeMapValid = rhs.mAttributeMapValid;
   mValid =  rhs.mValid;
   mTypeName = rhs.mTypeName;
 
@@ -99,19 +109,84 @@ QgsFeatureId QgsFeature::id() const
  */
 const QgsAttributeMap& QgsFeature::attributeMap() const
 {
-  return mAttributes;
+  if ( !mAttributeMapValid )
+  {
+    mAttributeMap.clear();
+    for ( int i = 0; i < mAttributes.size(); ++i )
+    {
+      if ( mAttributeSet.testBit( i ) )
+        mAttributeMap.insert( i, mAttributes[i] );
+    }
+    mAttributeMapValid = true;
+  }
+  mAttributeMapUsed = true;
+  return mAttributeMap;
 }
 
 /**Sets the attributes for this feature*/
 void QgsFeature::setAttributeMap( const QgsAttributeMap& attributes )
 {
-  mAttributes = attributes;
+  QgsAttributeMap::const_iterator last = attributes.constEnd();
+  initAttributes( attributes.isEmpty() ? 0 : ( --last ).key() + 1 );
+  for ( QgsAttributeMap::const_iterator it = attributes.constBegin(); it != attributes.constEnd(); ++it )
+  {
+    if ( it.key() < 0 )
+    {
+      QgsDebugMsg( QString( "negative field index %1 ignored" ).arg( it.key() ) );
+      continue;
+    }
+    mAttributes[it.key()] = it.value();
+    mAttributeSet.setBit( it.key() );
+  }
+  // the map is known already
+  mAttributeMap = attributes;
 }
 
 /**Clear attribute map for this feature*/
 void QgsFeature::clearAttributeMap()
 {
-  mAttributes.clear();
+  initAttributes( mAttributes.size() );
+}
+
+void QgsFeature::initAttributes( int fieldCount )
+{
+  // QVector::fill() keeps the storage if the size does not change and it is not shared
+  mAttributes.fill( QVariant(), fieldCount );
+  mAttributeSet.fill( false, fieldCount );
+  mAttributeMap.clear();
+  mAttributeMapValid = true;
+  mAttributeMapUsed = false;
+}
+
+void QgsFeature::copyAttributes( const QgsFeature& other )
+{
+  mAttributes = other.mAttributes;
+  mAttributeSet = other.mAttributeSet;
+  mAttributeMap = other.mAttributeMap;
+  mAttributeMapValid = other.mAttributeMapValid;
+}
+
+void QgsFeature::setAttribute( int field, const QVariant& attr )
+{
+  if ( field < 0 )
+  {
+    QgsDebugMsg( QString( "negative field index %1 ignored" ).arg( field ) );
+    return;
+  }
+
+  if ( field >= mAttributes.size() )
+  {
+    mAttributes.resize( field + 1 );
+    mAttributeSet.resize( field + 1 );
+  }
+  mAttributes[field] = attr;
+  mAttributeSet.setBit( field );
+
+  // keep a map that was handed out up to date, otherwise it is built on demand
+  if ( mAttributeMapValid && mAttributeMapUsed )
+    mAttributeMap.insert( field, attr );
+  else
+    mAttributeMapValid = false;
 }
 
 /**
@@ -119,19 +194,27 @@ void QgsFeature::clearAttributeMap()
  */
 void QgsFeature::addAttribute( int field, QVariant attr )
 {
-  mAttributes.insert( field, attr );
+  setAttribute( field, attr );
 }
 
 /**Deletes an attribute and its value*/
 void QgsFeature::deleteAttribute( int field )
 {
-  mAttributes.remove( field );
+  if ( !hasAttribute( field ) )
+    return;
+
+  mAttributes[field] = QVariant();
+  mAttributeSet.clearBit( field );
+  if ( mAttributeMapValid && mAttributeMapUsed )
+    mAttributeMap.remove( field );
+  else
+    mAttributeMapValid = false;
 }
 
 
 void QgsFeature::changeAttribute( int field, QVariant attr )
 {
-  mAttributes[field] = attr;
+  setAttribute( field, attr );
 }
 
 QgsGeometry *QgsFeature::geometry()
@@ -21,6 +21,8 @@ email                : sherman at mrcc.com
 #include <QVariant>
 #include <QList>
 #include <QHash>
+#include <QVector>
+#include <QBitArray>
 
 class QgsGeometry;
 class QgsRectangle;
@@ -94,6 +96,9 @@ typedef int QgsFeatureId;
 // key = field index, value = field value
 typedef QMap<int, QVariant> QgsAttributeMap;
 
+// index = field index, value = field value
+typedef QVector<QVariant> QgsAttributes;
+
 
 /** \ingroup core
  * The feature class encapsulates a single feature including its id,
@@ -140,6 +145,8 @@ class CORE_EXPORT QgsFeature
 
     /**
      * Get the attributes for this feature.
+     * The map is built from the attribute vector when it is first used after a change,
+     * use attribute() or attributes() in performance critical code.
      * @return A std::map containing the field name/value mapping
      */
     const QgsAttributeMap& attributeMap() const;
@@ -148,10 +155,44 @@ class CORE_EXPORT QgsFeature
     void setAttributeMap( const QgsAttributeMap& attributeMap );
 
     /** Clear attribute map
+     * The storage of the attributes is kept, so that the attributes of the next
+     * feature read into this one are set without allocations.
      * added in 1.5
      */
     void clearAttributeMap();
 
+    /**
+     * Get the attribute values addressed by field index. Attributes which are not
+     * set are invalid QVariants, hasAttribute() tells them from NULL values.
+     * @note added in 1.9
+     */
+    const QgsAttributes& attributes() const { return mAttributes; }
+
+    /**
+     * Get the value of an attribute or an invalid QVariant if it is not set
+     * @note added in 1.9
+     */
+    QVariant attribute( int field ) const { return field >= 0 && field < mAttributes.size() ? mAttributes[field] : QVariant(); }
+
+    /**
+     * Returns true if the attribute is set
+     * @note added in 1.9
+     */
+    bool hasAttribute( int field ) const { return field >= 0 && field < mAttributeSet.size() && mAttributeSet.testBit( field ); }
+
+    /**
+     * Removes all attributes and prepares the storage for fieldCount fields,
+     * so that providers can set the attributes in place.
+     * @note added in 1.9
+     */
+    void initAttributes( int fieldCount );
+
+    /**
+     * Copies the attributes of another feature, sharing their storage
+     * @note added in 1.9
+     */
+    void copyAttributes( const QgsFeature& other );
+
     /**
      * Add an attribute to the map
      */
@@ -220,8 +261,20 @@ class CORE_EXPORT QgsFeature
     //! feature id
     QgsFeatureId mFid;
 
-    /** map of attributes accessed by field index */
-    QgsAttributeMap mAttributes;
+    //! store the value of an attribute in the vector and the map, if it is built
+    void setAttribute( int field, const QVariant& attr );
+
+    /** attribute values accessed by field index */
+    QgsAttributes mAttributes;
+
+    /** tells which attributes are set */
+    QBitArray mAttributeSet;
+
+    /** map of the attributes for attributeMap(), built on demand */
+    mutable QgsAttributeMap mAttributeMap;
+    mutable bool mAttributeMapValid;
+    //! the map was handed out by attributeMap() and is kept up to date
+    mutable bool mAttributeMapUsed;
 
     /** pointer to geometry in binary WKB format
 
@@ -261,4 +314,7 @@ typedef QMap<int, QString> QgsFieldNameMap;
 
 typedef QList<QgsFeature> QgsFeatureList;
 
+// key = feature id, value = feature
+typedef QMap<QgsFeatureId, QgsFeature> QgsFeatureMap;
+
 #endif
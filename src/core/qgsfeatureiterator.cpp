@@ -0,0 +1,52 @@
+/***************************************************************************
+    qgsfeatureiterator.cpp
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsfeatureiterator.h"
+
+QgsAbstractFeatureIterator::QgsAbstractFeatureIterator( const QgsFeatureRequest& request )
+    : mRequest( request )
+    , mClosed( false )
+    , refs( 0 )
+{
+}
+
+QgsAbstractFeatureIterator::~QgsAbstractFeatureIterator()
+{
+}
+
+void QgsAbstractFeatureIterator::ref()
+{
+  refs++;
+}
+
+void QgsAbstractFeatureIterator::deref()
+{
+  refs--;
+  if ( !refs )
+    delete this;
+}
+
+///////
+
+QgsFeatureIterator& QgsFeatureIterator::operator=( const QgsFeatureIterator & other )
+{
+  if ( this != &other )
+  {
+    if ( other.mIter )
+      other.mIter->ref();
+    if ( mIter )
+      mIter->deref();
+    mIter = other.mIter;
+  }
+  return *this;
+}
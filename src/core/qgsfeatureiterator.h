@@ -0,0 +1,150 @@
+/***************************************************************************
+    qgsfeatureiterator.h
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSFEATUREITERATOR_H
+#define QGSFEATUREITERATOR_H
+
+#include "qgsfeaturerequest.h"
+
+class QgsFeature;
+
+/** \ingroup core
+ * Internal feature iterator to be implemented within data providers.
+ * Every iterator keeps its own cursor, so any number of iterators may be
+ * used on the same source at the same time.
+ * @note added in 1.9
+ */
+class CORE_EXPORT QgsAbstractFeatureIterator
+{
+  public:
+    //! base class constructor - stores the iteration parameters
+    QgsAbstractFeatureIterator( const QgsFeatureRequest& request );
+
+    //! destructor. Implementations have to call close() from their own destructor
+    virtual ~QgsAbstractFeatureIterator();
+
+    //! fetch next feature, return true on success
+    virtual bool nextFeature( QgsFeature& f ) = 0;
+    //! reset the iterator to the starting position
+    virtual bool rewind() = 0;
+    //! end of iterating: free the resources / lock
+    virtual bool close() = 0;
+
+    //! the request this iterator was created for
+    const QgsFeatureRequest& request() const { return mRequest; }
+
+  protected:
+    QgsFeatureRequest mRequest;
+
+    //! set to true when the iterator has been closed
+    bool mClosed;
+
+    // reference counting (to allow seamless copying of QgsFeatureIterator instances)
+    int refs;
+    void ref(); //!< add reference
+    void deref(); //!< remove reference, delete if refs == 0
+    friend class QgsFeatureIterator;
+};
+
+
+/** \ingroup core
+ * Wrapper for iterator of features from vector data provider or vector layer.
+ * The wrapper is cheap to copy: all copies share the same underlying cursor.
+ * @note added in 1.9
+ */
+class CORE_EXPORT QgsFeatureIterator
+{
+  public:
+    //! construct invalid iterator
+    QgsFeatureIterator();
+    //! construct a valid iterator, takes ownership of the iterator
+    QgsFeatureIterator( QgsAbstractFeatureIterator* iter );
+    //! copy constructor copies the iterator, increases ref.count
+    QgsFeatureIterator( const QgsFeatureIterator& fi );
+    //! destructor deletes the iterator if it has no more references
+    ~QgsFeatureIterator();
+
+    QgsFeatureIterator& operator=( const QgsFeatureIterator& other );
+
+    bool nextFeature( QgsFeature& f );
+    bool rewind();
+    bool close();
+
+    //! find out whether the iterator is still valid or closed already
+    bool isClosed() const;
+
+    friend bool operator== ( const QgsFeatureIterator &fi1, const QgsFeatureIterator &fi2 );
+    friend bool operator!= ( const QgsFeatureIterator &fi1, const QgsFeatureIterator &fi2 );
+
+  protected:
+    QgsAbstractFeatureIterator* mIter;
+};
+
+////////
+
+inline QgsFeatureIterator::QgsFeatureIterator()
+    : mIter( NULL )
+{
+}
+
+inline QgsFeatureIterator::QgsFeatureIterator( QgsAbstractFeatureIterator* iter )
+    : mIter( iter )
+{
+  if ( iter )
+    iter->ref();
+}
+
+inline QgsFeatureIterator::QgsFeatureIterator( const QgsFeatureIterator& fi )
+    : mIter( fi.mIter )
+{
+  if ( mIter )
+    mIter->ref();
+}
+
+inline QgsFeatureIterator::~QgsFeatureIterator()
+{
+  if ( mIter )
+    mIter->deref();
+}
+
+inline bool QgsFeatureIterator::nextFeature( QgsFeature& f )
+{
+  return mIter ? mIter->nextFeature( f ) : false;
+}
+
+inline bool QgsFeatureIterator::rewind()
+{
+  return mIter ? mIter->rewind() : false;
+}
+
+inline bool QgsFeatureIterator::close()
+{
+  return mIter ? mIter->close() : false;
+}
+
+inline bool QgsFeatureIterator::isClosed() const
+{
+  return mIter ? mIter->mClosed : true;
+}
+
+inline bool operator== ( const QgsFeatureIterator &fi1, const QgsFeatureIterator &fi2 )
+{
+  return ( fi1.mIter == fi2.mIter );
+}
+
+inline bool operator!= ( const QgsFeatureIterator &fi1, const QgsFeatureIterator &fi2 )
+{
+  return !( fi1 == fi2 );
+}
+
+#endif // QGSFEATUREITERATOR_H
@@ -0,0 +1,51 @@
+/***************************************************************************
+    qgsfeaturerequest.cpp
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsfeaturerequest.h"
+
+QgsFeatureRequest::QgsFeatureRequest()
+    : mFlags( NoFlags )
+{
+}
+
+QgsFeatureRequest::QgsFeatureRequest( const QgsRectangle& rect )
+    : mFilterRect( rect )
+    , mFlags( NoFlags )
+{
+}
+
+QgsFeatureRequest& QgsFeatureRequest::setFilterRect( const QgsRectangle& rect )
+{
+  mFilterRect = rect;
+  return *this;
+}
+
+QgsFeatureRequest& QgsFeatureRequest::setFlags( QgsFeatureRequest::Flags flags )
+{
+  mFlags = flags;
+  return *this;
+}
+
+QgsFeatureRequest& QgsFeatureRequest::setSubsetOfAttributes( const QgsAttributeList& attrs )
+{
+  mFlags |= SubsetOfAttributes;
+  mAttrs = attrs;
+  return *this;
+}
+
+QgsAttributeList QgsFeatureRequest::attributesToFetch( const QgsAttributeList& allAttributes ) const
+{
+  if ( mFlags & SubsetOfAttributes )
+    return mAttrs;
+  return allAttributes;
+}
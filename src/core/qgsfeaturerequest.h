@@ -0,0 +1,83 @@
+/***************************************************************************
+    qgsfeaturerequest.h
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSFEATUREREQUEST_H
+#define QGSFEATUREREQUEST_H
+
+#include <QFlags>
+#include <QList>
+
+#include "qgsrectangle.h"
+
+typedef QList<int> QgsAttributeList;
+
+/** \ingroup core
+ * This class wraps a request for features to a vector layer (or directly its vector data provider).
+ * The request may apply a filter rectangle, restrict the attributes that are fetched
+ * and tell whether geometries are needed at all.
+ *
+ * Examples:
+ * - QgsFeatureRequest() fetches all features with geometry and all attributes
+ * - QgsFeatureRequest().setFilterRect( rect ) fetches features that intersect the rectangle
+ * - QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ).setSubsetOfAttributes( attrs )
+ *   fetches only the given attributes without geometries
+ *
+ * @note added in 1.9
+ */
+class CORE_EXPORT QgsFeatureRequest
+{
+  public:
+    enum Flag
+    {
+      NoFlags            = 0,
+      NoGeometry         = 1,  //!< Geometry is not required. It may still be returned if e.g. required for a filter condition.
+      SubsetOfAttributes = 2,  //!< Fetch only a subset of attributes (setSubsetOfAttributes sets this flag)
+      ExactIntersect     = 4   //!< Use exact geometry intersection (slower) instead of bounding boxes
+    };
+    Q_DECLARE_FLAGS( Flags, Flag )
+
+    //! construct a default request: all features with geometry and all attributes
+    QgsFeatureRequest();
+    //! construct a request with a filter rectangle
+    explicit QgsFeatureRequest( const QgsRectangle& rect );
+
+    //! Set rectangle from which features will be taken. Empty rectangle removes the filter.
+    QgsFeatureRequest& setFilterRect( const QgsRectangle& rect );
+    const QgsRectangle& filterRect() const { return mFilterRect; }
+
+    //! Set flags that affect how features will be fetched
+    QgsFeatureRequest& setFlags( Flags flags );
+    const Flags& flags() const { return mFlags; }
+
+    //! Set a subset of attributes that will be fetched. Empty list means that no attributes are fetched.
+    //! To disable fetching attributes, reset the SubsetOfAttributes flag.
+    QgsFeatureRequest& setSubsetOfAttributes( const QgsAttributeList& attrs );
+    //! Return the subset of attributes which at least need to be fetched
+    //! @return A list of attributes to be fetched
+    const QgsAttributeList& subsetOfAttributes() const { return mAttrs; }
+
+    //! Convenience: whether geometries are wanted
+    bool fetchGeometry() const { return !( mFlags & NoGeometry ); }
+
+    //! Convenience: list of attributes to fetch given the complete list of attributes of the source
+    QgsAttributeList attributesToFetch( const QgsAttributeList& allAttributes ) const;
+
+  protected:
+    QgsRectangle mFilterRect;
+    Flags mFlags;
+    QgsAttributeList mAttrs;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS( QgsFeatureRequest::Flags )
+
+#endif // QGSFEATUREREQUEST_H
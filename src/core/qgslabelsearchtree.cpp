@@ -37,6 +37,15 @@ void QgsLabelSearchTree::label( const QgsPoint& p, QList<QgsLabelPosition*>& pos
   }
 }
 
+void QgsLabelSearchTree::labelsInRect( const QgsRectangle& r, QList<QgsLabelPosition*>& posList )
+{
+  double c_min[2]; c_min[0] = r.xMinimum(); c_min[1] = r.yMinimum();
+  double c_max[2]; c_max[0] = r.xMaximum(); c_max[1] = r.yMaximum();
+
+  posList.clear();
+  mSpatialIndex.Search( c_min, c_max, searchCallback, &posList );
+}
+
 bool QgsLabelSearchTree::insertLabel( LabelPosition* labelPos, int featureId, const QString& layerName, bool diagram )
 {
   if ( !labelPos )
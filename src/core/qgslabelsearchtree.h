@@ -42,6 +42,10 @@ class CORE_EXPORT QgsLabelSearchTree
     /**Returns label position(s) at a given point. QgsLabelSearchTree keeps ownership, don't delete the LabelPositions*/
     void label( const QgsPoint& p, QList<QgsLabelPosition*>& posList );
 
+    /**Returns the label positions whose bounding box intersects a rectangle. QgsLabelSearchTree keeps ownership, don't delete the LabelPositions
+      @note added in 1.9*/
+    void labelsInRect( const QgsRectangle& r, QList<QgsLabelPosition*>& posList );
+
     /**Inserts label position. Does not take ownership of labelPos
       @return true in case of success*/
     bool insertLabel( LabelPosition* labelPos, int featureId, const QString& layerName, bool diagram = false );
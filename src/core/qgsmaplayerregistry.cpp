@@ -19,12 +19,27 @@
 #include "qgsmaplayer.h"
 #include "qgslogger.h"
 
+#include <QThreadStorage>
+
 //
 // Static calls to enforce singleton behaviour
 //
 QgsMapLayerRegistry *QgsMapLayerRegistry::mInstance = 0;
+bool QgsMapLayerRegistry::mThreadLocalInstances = false;
+
+static QThreadStorage<QgsMapLayerRegistry*> threadInstances;
+
 QgsMapLayerRegistry *QgsMapLayerRegistry::instance()
 {
+  if ( mThreadLocalInstances )
+  {
+    if ( !threadInstances.hasLocalData() )
+    {
+      threadInstances.setLocalData( new QgsMapLayerRegistry() );
+    }
+    return threadInstances.localData();
+  }
+
   if ( mInstance == 0 )
   {
     mInstance = new QgsMapLayerRegistry();
@@ -32,6 +47,11 @@ QgsMapLayerRegistry *QgsMapLayerRegistry::instance()
   return mInstance;
 }
 
+void QgsMapLayerRegistry::setThreadLocalInstances( bool threadLocal )
+{
+  mThreadLocalInstances = threadLocal;
+}
+
 //
 // Main class begins now...
 //
@@ -39,6 +39,14 @@ class CORE_EXPORT QgsMapLayerRegistry : public QObject
 
 //! Returns the instance pointer, creating the object on the first call
     static QgsMapLayerRegistry * instance();
+
+    /** Makes instance() return a separate registry for every thread. This is used by the threaded
+       mode of the map server, where each worker thread registers its own instances of the project
+       layers under the same layer ids. Needs to be set before instance() is called the first time.
+       @note added in 1.9
+    */
+    static void setThreadLocalInstances( bool threadLocal );
+
     /*! Return the number of registered layers.
      *
      * */
@@ -123,6 +131,7 @@ class CORE_EXPORT QgsMapLayerRegistry : public QObject
   private:
 
     static QgsMapLayerRegistry* mInstance;
+    static bool mThreadLocalInstances;
 
     QMap<QString, QgsMapLayer*> mMapLayers;
 
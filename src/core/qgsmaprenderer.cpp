@@ -24,6 +24,9 @@
 #include "qgsmaptopixel.h"
 #include "qgsmaplayer.h"
 #include "qgsmaplayerregistry.h"
+#include "qgsrasterlayer.h"
+#include "qgsrasterdataprovider.h"
+#include "qgsvectordataprovider.h"
 #include "qgsdistancearea.h"
 #include "qgscentralpointpositionmanager.h"
 #include "qgsoverlayobjectpositionmanager.h"
@@ -36,10 +39,68 @@
 #include <QDomNode>
 #include <QMutexLocker>
 #include <QPainter>
+#include <QPicture>
 #include <QListIterator>
 #include <QSettings>
 #include <QTime>
 #include <QCoreApplication>
+#include <QtConcurrentRun>
+#include <QFuture>
+
+/** Layer of a parallel rendering. Layers that can be drawn on a worker thread record
+  their paint commands into a picture, the other layers are drawn onto the paint device. */
+struct QgsMapRendererLayerJob
+{
+  QgsMapLayer* layer;
+  //! true if the layer is drawn on the calling thread
+  bool drawHere;
+  QPicture picture;
+  QPainter::RenderHints renderHints;
+  QgsRenderContext context;
+  //! second extent if the layer extent was split at the 180 degree line
+  bool split;
+  QgsRectangle extent2;
+  //! raster scale factor (1.0 if the raster does not need scaling)
+  double rasterScaleFactor;
+  double outputHeight;
+  bool drawOk;
+  QFuture<void> future;
+};
+
+static void drawLayerJob( QgsMapRendererLayerJob* job, QgsRenderContext& context, QPainter* painter )
+{
+  QgsMapToPixel mapToPixel = context.mapToPixel();
+  painter->save();
+  context.setPainter( painter );
+
+  if ( job->rasterScaleFactor != 1.0 )
+  {
+    QgsMapToPixel rasterMapToPixel = mapToPixel;
+    rasterMapToPixel.setMapUnitsPerPixel( rasterMapToPixel.mapUnitsPerPixel() / job->rasterScaleFactor );
+    rasterMapToPixel.setYMaximum( job->outputHeight * job->rasterScaleFactor );
+    context.setMapToPixel( rasterMapToPixel );
+    painter->scale( 1.0 / job->rasterScaleFactor, 1.0 / job->rasterScaleFactor );
+  }
+
+  job->drawOk = job->layer->draw( context );
+  if ( job->split )
+  {
+    context.setExtent( job->extent2 );
+    job->drawOk = job->layer->draw( context ) && job->drawOk;
+  }
+
+  context.setMapToPixel( mapToPixel );
+  painter->restore();
+}
+
+static void recordLayerJob( QgsMapRendererLayerJob* job )
+{
+  QPainter painter( &job->picture );
+  painter.setRenderHints( job->renderHints );
+  drawLayerJob( job, job->context, &painter );
+  painter.end();
+  job->context.setPainter( 0 );
+}
 
 QgsMapRenderer::QgsMapRenderer()
 {
@@ -62,6 +123,8 @@ QgsMapRenderer::QgsMapRenderer()
   mOutputUnits = QgsMapRenderer::Millimeters;
 
   mLabelingEngine = NULL;
+
+  mParallelRendering = false;
 }
 
 QgsMapRenderer::~QgsMapRenderer()
@@ -337,6 +400,21 @@ void QgsMapRenderer::render( QPainter* painter, double* forceWidthScale )
   QgsOverlayObjectPositionManager* overlayManager = overlayManagerFromSettings();
   QList<QgsVectorOverlay*> allOverlayList; //list of all overlays, used to draw them after layers have been rendered
 
+  // In parallel mode the layers that can be read on a worker thread are recorded into
+  // pictures concurrently, which are replayed in stacking order afterwards. Replaying
+  // the paint commands gives the same pixels as drawing directly, but the paint engines
+  // of printers and vector formats merge them differently, so only raster devices are
+  // drawn in parallel. Render caching already draws each layer into an image and takes
+  // precedence.
+  QSettings renderSettings;
+  int deviceType = thePaintDevice->devType();
+  bool parallel = mParallelRendering
+                  && ( deviceType == QInternal::Image || deviceType == QInternal::Pixmap )
+                  && !mRenderContext.forceVectorOutput()
+                  && painter->transform().isIdentity()
+                  && !renderSettings.value( "/qgis/enable_render_caching", false ).toBool();
+  QList<QgsMapRendererLayerJob*> layerJobs;
+
   // render all layers in the stack, starting at the base
   QListIterator<QString> li( mLayerSet );
   li.toBack();
@@ -461,6 +539,58 @@ void QgsMapRenderer::render( QPainter* painter, double* forceWidthScale )
         }
       }
 
+      if ( parallel )
+      {
+        // the layer is drawn later, the progress is connected again then
+        disconnect( ml, SIGNAL( drawingProgress( int, int ) ), this, SLOT( onDrawingProgress( int, int ) ) );
+
+        QgsMapRendererLayerJob* job = new QgsMapRendererLayerJob;
+        job->layer = ml;
+        job->renderHints = painter->renderHints();
+        job->split = split;
+        job->extent2 = r2;
+        job->rasterScaleFactor = scaleRaster ? rasterScaleFactor : 1.0;
+        job->outputHeight = mSize.height();
+        job->drawOk = false;
+
+        QgsRenderContext& ctx = job->context;
+        ctx.setMapToPixel( mRenderContext.mapToPixel() );
+        ctx.setExtent( mRenderContext.extent() );
+        ctx.setDrawEditingInformation( mRenderContext.drawEditingInformation() );
+        ctx.setForceVectorOutput( mRenderContext.forceVectorOutput() );
+        ctx.setScaleFactor( mRenderContext.scaleFactor() );
+        ctx.setRasterScaleFactor( mRenderContext.rasterScaleFactor() );
+        ctx.setRendererScale( mRenderContext.rendererScale() );
+        ctx.setCoordinateTransform( ct ? new QgsCoordinateTransform( ml->crs(), *mDestCRS ) : 0 );
+
+        // Only layers whose provider may be read on a worker thread are drawn there.
+        // The labeling engine is not thread safe and the order in which features are
+        // registered determines the label placement, layers in editing mode update
+        // their geometry cache while drawing and joined layers change the subset of the
+        // shared join layer, so these layers are drawn on this thread.
+        job->drawHere = true;
+        QgsVectorLayer* vl = qobject_cast<QgsVectorLayer *>( ml );
+        QgsRasterLayer* rl = qobject_cast<QgsRasterLayer *>( ml );
+        if ( vl )
+        {
+          job->drawHere = !vl->dataProvider() || !vl->dataProvider()->isThreadSafe()
+                          || vl->isEditable() || !vl->vectorJoins().isEmpty() || vl->diagramRenderer()
+                          || ( mRenderContext.labelingEngine() && mRenderContext.labelingEngine()->willUseLayer( vl ) );
+        }
+        else if ( rl )
+        {
+          job->drawHere = !rl->dataProvider() || !rl->dataProvider()->isThreadSafe();
+        }
+
+        if ( !job->drawHere )
+        {
+          job->future = QtConcurrent::run( recordLayerJob, job );
+        }
+
+        layerJobs << job;
+        continue;
+      }
+
       QSettings mySettings;
       if ( ! split )//render caching does not yet cater for split extents
       {
@@ -551,6 +681,40 @@ void QgsMapRenderer::render( QPainter* painter, double* forceWidthScale )
 
   } // while (li.hasPrevious())
 
+  // Wait for the worker threads before anything else is drawn. Events are not processed
+  // while the workers use their layers, so the layers cannot be removed or rendered again
+  // meanwhile. Then the pictures are replayed and the other layers are drawn in stacking
+  // order, which gives the same output as serial rendering.
+  foreach( QgsMapRendererLayerJob* job, layerJobs )
+  {
+    job->future.waitForFinished();
+  }
+  foreach( QgsMapRendererLayerJob* job, layerJobs )
+  {
+    if ( !mRenderContext.renderingStopped() )
+    {
+      if ( job->drawHere )
+      {
+        // drawn with the renderer context, whose stop flag is set while the layer processes events
+        mRenderContext.setExtent( job->context.extent() );
+        mRenderContext.setCoordinateTransform( job->context.coordinateTransform() ? new QgsCoordinateTransform( job->layer->crs(), *mDestCRS ) : 0 );
+        connect( job->layer, SIGNAL( drawingProgress( int, int ) ), this, SLOT( onDrawingProgress( int, int ) ) );
+        drawLayerJob( job, mRenderContext, painter );
+        disconnect( job->layer, SIGNAL( drawingProgress( int, int ) ), this, SLOT( onDrawingProgress( int, int ) ) );
+      }
+      else
+      {
+        painter->drawPicture( 0, 0, job->picture );
+      }
+      if ( !job->drawOk )
+      {
+        emit drawError( job->layer );
+      }
+    }
+    delete job;
+  }
+  layerJobs.clear();
+
   QgsDebugMsg( "Done rendering map layers" );
 
   if ( !mOverview )
@@ -231,6 +231,15 @@ class CORE_EXPORT QgsMapRenderer : public QObject
     //! Added in QGIS v1.4
     void setLabelingEngine( QgsLabelingEngineInterface* iface );
 
+    /**Enables drawing of the layers on a thread pool when rendering onto an image or pixmap.
+      Each layer is recorded into a picture, and the pictures are replayed in stacking order
+      once all layers are drawn, so the output is the same as with serial rendering. Layers
+      whose data provider is not thread safe, layers with joins, layers that are being edited
+      and layers that feed the labeling engine are drawn on the calling thread.
+      @note added in 1.9 */
+    void setParallelRenderingEnabled( bool enabled ) { mParallelRendering = enabled; }
+    bool isParallelRenderingEnabled() const { return mParallelRendering; }
+
   signals:
 
     void drawingProgress( int current, int total );
@@ -328,6 +337,9 @@ class CORE_EXPORT QgsMapRenderer : public QObject
     //! Locks rendering loop for concurrent draws
     QMutex mRenderMutex;
 
+    //! Render layers concurrently into separate images (false by default)
+    bool mParallelRendering;
+
   private:
     QgsCoordinateTransform *tr( QgsMapLayer *layer );
     QgsCoordinateTransform *mCachedTr;
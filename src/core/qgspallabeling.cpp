@@ -18,6 +18,7 @@
 #include "qgspallabeling.h"
 
 #include <list>
+#include <vector>
 
 #include <pal/pal.h>
 #include <pal/feature.h>
@@ -53,6 +54,149 @@
 using namespace pal;
 
 
+// label metrics and candidates of a feature, kept between labelings
+class QgsPalCachedLabel
+{
+  public:
+    QgsPalCachedLabel()
+        : fontSize( -1 ), width( 0 ), height( 0 ), geometryHash( 0 ), labelX( 0 ), labelY( 0 ), distance( 0 ), used( true )
+    {
+    }
+
+    ~QgsPalCachedLabel()
+    {
+      clearCandidates();
+    }
+
+    void clearCandidates()
+    {
+      for ( std::vector<LabelPosition*>::iterator it = candidates.begin(); it != candidates.end(); ++it )
+        delete *it;
+      candidates.clear();
+    }
+
+    // makes the candidate at the position of the placed label the preferred one of the next labeling
+    void setPlaced( const LabelPosition* placed )
+    {
+      for ( std::vector<LabelPosition*>::iterator it = candidates.begin(); it != candidates.end(); ++it )
+      {
+        LabelPosition* lp = *it;
+        lp->setPreferred( placed && lp->getX() == placed->getX() && lp->getY() == placed->getY()
+                          && lp->getAlpha() == placed->getAlpha() && lp->getReversed() == placed->getReversed() );
+      }
+    }
+
+    // text and font pixel size (-1 for the font of the layer) the size was measured for
+    QString text;
+    int fontSize;
+    // label size in pixels
+    double width, height;
+
+    // geometry (in map coordinates) and label size in map units the candidates were generated for
+    uint geometryHash;
+    double labelX, labelY, distance;
+    std::vector<LabelPosition*> candidates;
+
+    bool used; // registered since the last labeling
+};
+
+// labels of the features of the last labeling
+class QgsPalLabelCache
+{
+  public:
+    QgsPalLabelCache(): mSizeHits( 0 ), mCandidateHits( 0 ) {}
+
+    ~QgsPalLabelCache()
+    {
+      clear();
+    }
+
+    // drops the candidates if they were generated for other map settings
+    void startLabeling( const QString& mapKey )
+    {
+      mSizeHits = 0;
+      mCandidateHits = 0;
+      if ( mapKey == mMapKey )
+        return;
+
+      mMapKey = mapKey;
+      QHash<QString, QHash<QgsFeatureId, QgsPalCachedLabel*> >::iterator lit = mLabels.begin();
+      for ( ; lit != mLabels.end(); ++lit )
+      {
+        foreach( QgsPalCachedLabel* label, lit.value() )
+        {
+          label->clearCandidates();
+        }
+      }
+    }
+
+    // drops the labels of a layer if they were made with other label settings
+    void prepareLayer( const QString& layerId, const QString& settingsKey )
+    {
+      if ( mLayerKeys.value( layerId ) == settingsKey )
+        return;
+
+      qDeleteAll( mLabels.value( layerId ) );
+      mLabels.remove( layerId );
+      mLayerKeys.insert( layerId, settingsKey );
+    }
+
+    QgsPalCachedLabel* label( const QString& layerId, QgsFeatureId fid )
+    {
+      QgsPalCachedLabel*& label = mLabels[layerId][fid];
+      if ( !label )
+        label = new QgsPalCachedLabel();
+      label->used = true;
+      return label;
+    }
+
+    // forgets the features which were not registered since the last labeling and the placements
+    void finishLabeling()
+    {
+      QHash<QString, QHash<QgsFeatureId, QgsPalCachedLabel*> >::iterator lit = mLabels.begin();
+      for ( ; lit != mLabels.end(); ++lit )
+      {
+        QHash<QgsFeatureId, QgsPalCachedLabel*>::iterator it = lit.value().begin();
+        while ( it != lit.value().end() )
+        {
+          if ( !it.value()->used )
+          {
+            delete it.value();
+            it = lit.value().erase( it );
+            continue;
+          }
+          it.value()->used = false;
+          it.value()->setPlaced( NULL );
+          ++it;
+        }
+      }
+    }
+
+    void clear()
+    {
+      QHash<QString, QHash<QgsFeatureId, QgsPalCachedLabel*> >::iterator lit = mLabels.begin();
+      for ( ; lit != mLabels.end(); ++lit )
+        qDeleteAll( lit.value() );
+      mLabels.clear();
+      mLayerKeys.clear();
+      mMapKey.clear();
+    }
+
+    // features of the current labeling which reused the label size / the candidates
+    void addSizeHit() { ++mSizeHits; }
+    void addCandidateHit() { ++mCandidateHits; }
+    int sizeHits() const { return mSizeHits; }
+    int candidateHits() const { return mCandidateHits; }
+
+  private:
+    QString mMapKey;
+    QHash<QString, QString> mLayerKeys;
+    QHash<QString, QHash<QgsFeatureId, QgsPalCachedLabel*> > mLabels;
+    int mSizeHits;
+    int mCandidateHits;
+};
+
+
 class QgsPalGeometry : public PalGeometry
 {
   public:
@@ -62,6 +206,7 @@ class QgsPalGeometry : public PalGeometry
         , mId( id )
         , mInfo( NULL )
         , mIsDiagram( false )
+        , mCachedLabel( NULL )
     {
       mStrId = FID_TO_STRING( id ).toAscii();
     }
@@ -112,6 +257,9 @@ class QgsPalGeometry : public PalGeometry
     void setIsDiagram( bool d ) { mIsDiagram = d; }
     bool isDiagram() const { return mIsDiagram; }
 
+    void setCachedLabel( QgsPalCachedLabel* label ) { mCachedLabel = label; }
+    QgsPalCachedLabel* cachedLabel() const { return mCachedLabel; }
+
     void addDiagramAttribute( int index, QVariant value ) { mDiagramAttributes.insert( index, value ); }
     const QgsAttributeMap& diagramAttributes() { return mDiagramAttributes; }
 
@@ -122,6 +270,7 @@ class QgsPalGeometry : public PalGeometry
     QgsFeatureId mId;
     LabelInfo* mInfo;
     bool mIsDiagram;
+    QgsPalCachedLabel* mCachedLabel;
     /**Stores attribute values for data defined properties*/
     QMap< QgsPalLayerSettings::DataDefinedProperties, QVariant > mDataDefinedValues;
 
@@ -132,7 +281,7 @@ class QgsPalGeometry : public PalGeometry
 // -------------
 
 QgsPalLayerSettings::QgsPalLayerSettings()
-    : palLayer( NULL ), fontMetrics( NULL ), ct( NULL ), extentGeom( NULL ), expression( NULL )
+    : palLayer( NULL ), fontMetrics( NULL ), ct( NULL ), extentGeom( NULL ), labelCache( NULL ), expression( NULL )
 {
   placement = AroundPoint;
   placementFlags = 0;
@@ -194,6 +343,7 @@ QgsPalLayerSettings::QgsPalLayerSettings( const QgsPalLayerSettings& s )
   fontMetrics = NULL;
   ct = NULL;
   extentGeom = NULL;
+  labelCache = NULL;
   expression = NULL;
 }
 
@@ -429,6 +579,13 @@ void QgsPalLayerSettings::calculateLabelSize( const QFontMetricsF* fm, QString t
     return;
   }
 
+  double w, h;
+  labelSizeInPixels( fm, text, w, h );
+  labelSizeToMapUnits( w, h, labelX, labelY );
+}
+
+void QgsPalLayerSettings::labelSizeInPixels( const QFontMetricsF* fm, QString text, double& width, double& height ) const
+{
   //consider the space needed for the direction symbol
   if ( addDirectionSymbol && placement == QgsPalLayerSettings::Line )
   {
@@ -446,14 +603,19 @@ void QgsPalLayerSettings::calculateLabelSize( const QFontMetricsF* fm, QString t
   w = 0;
   for ( int i = 0; i < multiLineSplit.size(); ++i )
   {
-    double width = fm->width( multiLineSplit.at( i ) );
-    if ( width > w )
+    double lineWidth = fm->width( multiLineSplit.at( i ) );
+    if ( lineWidth > w )
     {
-      w = width;
+      w = lineWidth;
     }
   }
-  w /= rasterCompressFactor;
-  QgsPoint ptSize = xform->toMapCoordinatesF( w, h );
+  width = w / rasterCompressFactor;
+  height = h;
+}
+
+void QgsPalLayerSettings::labelSizeToMapUnits( double width, double height, double& labelX, double& labelY ) const
+{
+  QgsPoint ptSize = xform->toMapCoordinatesF( width, height );
 
   labelX = qAbs( ptSize.x() - ptZero.x() );
   labelY = qAbs( ptSize.y() - ptZero.y() );
@@ -471,7 +633,8 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
       QgsDebugMsg( "Expression parser error:" + exp->parserErrorString() );
       return;
     }
-    QVariant result = exp->evaluate( &f, layer->pendingFields() );
+    // the expression has been prepared in QgsPalLabeling::prepareLayer()
+    QVariant result = exp->evaluate( &f );
     if ( exp->hasEvalError() )
     {
       QgsDebugMsg( "Expression parser eval error:" + exp->evalErrorString() );
@@ -479,11 +642,11 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
     }
     labelText  = result.toString();
   }
-  else if ( formatNumbers == true && ( f.attributeMap()[fieldIndex].type() == QVariant::Int ||
-                                       f.attributeMap()[fieldIndex].type() == QVariant::Double ) )
+  else if ( formatNumbers == true && ( f.attribute( fieldIndex ).type() == QVariant::Int ||
+                                       f.attribute( fieldIndex ).type() == QVariant::Double ) )
   {
     QString numberFormat;
-    double d = f.attributeMap()[fieldIndex].toDouble();
+    double d = f.attribute( fieldIndex ).toDouble();
     if ( d > 0 && plusSign == true )
     {
       numberFormat.append( "+" );
@@ -493,18 +656,19 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
   }
   else
   {
-    labelText = f.attributeMap()[fieldIndex].toString();
+    labelText = f.attribute( fieldIndex ).toString();
   }
 
   double labelX, labelY; // will receive label size
   QFont labelFont = textFont;
+  int fontSize = -1; // pixel size of a data defined font
 
   //data defined label size?
   QMap< DataDefinedProperties, int >::const_iterator it = dataDefinedProperties.find( QgsPalLayerSettings::Size );
   if ( it != dataDefinedProperties.constEnd() )
   {
     //find out size
-    QVariant size = f.attributeMap().value( *it );
+    QVariant size = f.attribute( *it );
     if ( size.isValid() )
     {
       double sizeDouble = size.toDouble();
@@ -514,12 +678,40 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
       }
       labelFont.setPixelSize( sizeToPixel( sizeDouble, context ) );
     }
-    QFontMetricsF labelFontMetrics( labelFont );
-    calculateLabelSize( &labelFontMetrics, labelText, labelX, labelY );
+    fontSize = labelFont.pixelSize();
+  }
+
+  // the text is measured again only if it changed since the last labeling
+  QgsPalCachedLabel* cachedLabel = labelCache ? labelCache->label( layer->id(), f.id() ) : NULL;
+  if ( cachedLabel && cachedLabel->text == labelText && cachedLabel->fontSize == fontSize )
+  {
+    labelSizeToMapUnits( cachedLabel->width, cachedLabel->height, labelX, labelY );
+    labelCache->addSizeHit();
   }
   else
   {
-    calculateLabelSize( fontMetrics, labelText, labelX, labelY );
+    double width, height;
+    if ( fontSize == -1 )
+    {
+      if ( !fontMetrics )
+        return;
+      labelSizeInPixels( fontMetrics, labelText, width, height );
+    }
+    else
+    {
+      QFontMetricsF labelFontMetrics( labelFont );
+      labelSizeInPixels( &labelFontMetrics, labelText, width, height );
+    }
+    labelSizeToMapUnits( width, height, labelX, labelY );
+
+    if ( cachedLabel )
+    {
+      cachedLabel->text = labelText;
+      cachedLabel->fontSize = fontSize;
+      cachedLabel->width = width;
+      cachedLabel->height = height;
+      cachedLabel->clearCandidates();
+    }
   }
 
   QgsGeometry* geom = f.geometry();
@@ -540,6 +732,13 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
   QgsGeometry* geomClipped = NULL;
   GEOSGeometry* geos_geom;
   bool do_clip = !extentGeom->contains( geom );
+
+  // candidates are kept for features with a single part that don't need to be clipped,
+  // their geometry stays the same while the map is panned
+  uint geometryHash = 0;
+  bool cacheCandidates = cachedLabel && !do_clip && !mergeLines && !geom->isMultipart();
+  if ( cacheCandidates )
+    geometryHash = qHash( QByteArray::fromRawData(( const char * ) geom->asWkb(), geom->wkbSize() ) );
   if ( do_clip )
   {
     geomClipped = geom->intersection( extentGeom ); // creates new geometry
@@ -573,8 +772,8 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
     if ( dPosYIt != dataDefinedProperties.constEnd() )
     {
       //data defined position. But field values could be NULL -> positions will be generated by PAL
-      xPos = f.attributeMap().value( *dPosXIt ).toDouble( &ddXPos );
-      yPos = f.attributeMap().value( *dPosYIt ).toDouble( &ddYPos );
+      xPos = f.attribute( *dPosXIt ).toDouble( &ddXPos );
+      yPos = f.attribute( *dPosYIt ).toDouble( &ddYPos );
 
       if ( ddXPos && ddYPos )
       {
@@ -587,7 +786,7 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
         QMap< DataDefinedProperties, int >::const_iterator haliIt = dataDefinedProperties.find( QgsPalLayerSettings::Hali );
         if ( haliIt != dataDefinedProperties.end() )
         {
-          QString haliString = f.attributeMap().value( *haliIt ).toString();
+          QString haliString = f.attribute( *haliIt ).toString();
           if ( haliString.compare( "Center", Qt::CaseInsensitive ) == 0 )
           {
             xdiff -= labelX / 2.0;
@@ -602,7 +801,7 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
         QMap< DataDefinedProperties, int >::const_iterator valiIt = dataDefinedProperties.find( QgsPalLayerSettings::Vali );
         if ( valiIt != dataDefinedProperties.constEnd() )
         {
-          QString valiString = f.attributeMap().value( *valiIt ).toString();
+          QString valiString = f.attribute( *valiIt ).toString();
           if ( valiString.compare( "Bottom", Qt::CaseInsensitive ) != 0 )
           {
             if ( valiString.compare( "Top", Qt::CaseInsensitive ) == 0 || valiString.compare( "Cap", Qt::CaseInsensitive ) == 0 )
@@ -632,7 +831,7 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
         if ( rotIt != dataDefinedProperties.constEnd() )
         {
           dataDefinedRotation = true;
-          angle = f.attributeMap().value( *rotIt ).toDouble() * M_PI / 180;
+          angle = f.attribute( *rotIt ).toDouble() * M_PI / 180;
           //adjust xdiff and ydiff because the hali/vali point needs to be the rotation center
           double xd = xdiff * cos( angle ) - ydiff * sin( angle );
           double yd = xdiff * sin( angle ) + ydiff * cos( angle );
@@ -655,6 +854,7 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
   }
 
   QgsPalGeometry* lbl = new QgsPalGeometry( f.id(), labelText, geos_geom_clone );
+  lbl->setCachedLabel( cachedLabel );
 
   // record the created geometry - it will be deleted at the end.
   geometries.append( lbl );
@@ -673,9 +873,10 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
     return;
   }
 
-  // TODO: only for placement which needs character info
+  // character info is only needed for curved labels
   pal::Feature* feat = palLayer->getFeature( lbl->strId() );
-  feat->setLabelInfo( lbl->info( fontMetrics, xform, rasterCompressFactor ) );
+  if ( placement == QgsPalLayerSettings::Curved )
+    feat->setLabelInfo( lbl->info( fontMetrics, xform, rasterCompressFactor ) );
 
   // TODO: allow layer-wide feature dist in PAL...?
 
@@ -684,7 +885,7 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
   QMap< DataDefinedProperties, int >::const_iterator dDistIt = dataDefinedProperties.find( QgsPalLayerSettings::LabelDistance );
   if ( dDistIt != dataDefinedProperties.constEnd() )
   {
-    distance = f.attributeMap().value( *dDistIt ).toDouble();
+    distance = f.attribute( *dDistIt ).toDouble();
   }
 
   if ( distance != 0 )
@@ -697,14 +898,37 @@ void QgsPalLayerSettings::registerFeature( QgsVectorLayer* layer,  QgsFeature& f
     {
       distance *= vectorScaleFactor;
     }
-    feat->setDistLabel( qAbs( ptOne.x() - ptZero.x() )* distance );
+    distance *= qAbs( ptOne.x() - ptZero.x() );
+    feat->setDistLabel( distance );
+  }
+
+  if ( cacheCandidates && !dataDefinedPosition )
+  {
+    if ( cachedLabel->geometryHash != geometryHash || cachedLabel->labelX != labelX
+         || cachedLabel->labelY != labelY || cachedLabel->distance != distance )
+    {
+      cachedLabel->clearCandidates();
+      cachedLabel->geometryHash = geometryHash;
+      cachedLabel->labelX = labelX;
+      cachedLabel->labelY = labelY;
+      cachedLabel->distance = distance;
+    }
+    else if ( !cachedLabel->candidates.empty() )
+    {
+      labelCache->addCandidateHit();
+    }
+    feat->setCandidatesCache( &cachedLabel->candidates );
+  }
+  else if ( cachedLabel )
+  {
+    cachedLabel->clearCandidates();
   }
 
   //add parameters for data defined labeling to QgsPalGeometry
   QMap< DataDefinedProperties, int >::const_iterator dIt = dataDefinedProperties.constBegin();
   for ( ; dIt != dataDefinedProperties.constEnd(); ++dIt )
   {
-    lbl->addDataDefinedValue( dIt.key(), f.attributeMap()[dIt.value()] );
+    lbl->addDataDefinedValue( dIt.key(), f.attribute( dIt.value() ) );
   }
 }
 
@@ -747,8 +971,10 @@ QgsPalLabeling::QgsPalLabeling()
 
   mShowingCandidates = false;
   mShowingAllLabels = false;
+  mParallelLabeling = false;
 
   mLabelSearchTree = new QgsLabelSearchTree();
+  mLabelCache = new QgsPalLabelCache();
 }
 
 
@@ -758,6 +984,7 @@ QgsPalLabeling::~QgsPalLabeling()
   exit();
   delete mLabelSearchTree;
   mLabelSearchTree = NULL;
+  delete mLabelCache;
 }
 
 
@@ -793,6 +1020,9 @@ int QgsPalLabeling::prepareLayer( QgsVectorLayer* layer, QSet<int>& attrIndices,
       fldIndex =  layer->fieldNameIndex( name );
       attrIndices.insert( fldIndex );
     }
+    // an expression referencing unknown columns would not give any label
+    if ( !exp.prepare( layer->pendingFields() ) )
+      return 0;
 
   }
   else
@@ -816,6 +1046,10 @@ int QgsPalLabeling::prepareLayer( QgsVectorLayer* layer, QSet<int>& attrIndices,
   // start using the reference to the layer in hashtable instead of local instance
   QgsPalLayerSettings& lyr = mActiveLayers[layer];
 
+  // prepare (and compile) the label expression once, registerFeature() only evaluates it
+  if ( lyr.isExpression )
+    lyr.getLabelExpression()->prepare( layer->pendingFields() );
+
   // how to place the labels
   Arrangement arrangement;
   switch ( lyr.placement )
@@ -873,6 +1107,14 @@ int QgsPalLabeling::prepareLayer( QgsVectorLayer* layer, QSet<int>& attrIndices,
   // rect for clipping
   lyr.extentGeom = QgsGeometry::fromRect( mMapRenderer->extent() );
 
+  // cached labels are dropped if a setting changed which affects the size or the candidates
+  QString settingsKey = QString( "%1|%2|%3|%4|%5|%6|%7|%8|%9" )
+                        .arg( lyr.textFont.key() ).arg( lyr.placement ).arg( lyr.placementFlags )
+                        .arg( lyr.wrapChar ).arg( lyr.addDirectionSymbol ).arg( lyr.labelPerPart )
+                        .arg( lyr.rasterCompressFactor, 0, 'g', 17 ).arg( lyr.dist, 0, 'g', 17 ).arg( lyr.distInMapUnits );
+  mLabelCache->prepareLayer( layer->id(), settingsKey );
+  lyr.labelCache = mLabelCache;
+
   return 1; // init successful
 }
 
@@ -944,7 +1186,7 @@ void QgsPalLabeling::registerDiagramFeature( QgsVectorLayer* layer, QgsFeature&
     QList<int>::const_iterator diagAttIt = diagramAttrib.constBegin();
     for ( ; diagAttIt != diagramAttrib.constEnd(); ++diagAttIt )
     {
-      lbl->addDiagramAttribute( *diagAttIt, feat.attributeMap()[*diagAttIt] );
+      lbl->addDiagramAttribute( *diagAttIt, feat.attribute( *diagAttIt ) );
     }
   }
 
@@ -958,8 +1200,8 @@ void QgsPalLabeling::registerDiagramFeature( QgsVectorLayer* layer, QgsFeature&
   {
     bool posXOk, posYOk;
     //data defined diagram position is always centered
-    ddPosX = feat.attributeMap()[ddColX].toDouble( &posXOk ) - diagramWidth / 2.0;
-    ddPosY = feat.attributeMap()[ddColY].toDouble( &posYOk ) - diagramHeight / 2.0;
+    ddPosX = feat.attribute( ddColX ).toDouble( &posXOk ) - diagramWidth / 2.0;
+    ddPosY = feat.attribute( ddColY ).toDouble( &posYOk ) - diagramHeight / 2.0;
     if ( !posXOk || !posYOk )
     {
       ddPos = false;
@@ -1023,6 +1265,14 @@ void QgsPalLabeling::init( QgsMapRenderer* mr )
   mPal->setLineP( mCandLine );
   mPal->setPolyP( mCandPolygon );
 
+  mPal->setMultiThreaded( mParallelLabeling );
+
+  // candidates of the last labeling can be reused at the same scale and map size
+  mLabelCache->startLabeling( QString( "%1|%2|%3|%4|%5|%6" )
+                              .arg( mr->mapUnitsPerPixel(), 0, 'g', 17 )
+                              .arg( mr->extent().width(), 0, 'g', 17 ).arg( mr->extent().height(), 0, 'g', 17 )
+                              .arg( mCandPoint ).arg( mCandLine ).arg( mCandPolygon ) );
+
   mActiveLayers.clear();
   mActiveDiagramLayers.clear();
 }
@@ -1230,6 +1480,15 @@ void QgsPalLabeling::drawLabeling( QgsRenderContext& context )
 
   QgsDebugMsg( QString( "LABELING draw:  %1 ms" ).arg( t.elapsed() ) );
 
+  // the placed labels are kept where they are by the next labeling if possible
+  mLabelCache->finishLabeling();
+  for ( it = labels->begin(); it != labels->end(); ++it )
+  {
+    QgsPalGeometry* palGeometry = dynamic_cast< QgsPalGeometry* >(( *it )->getFeaturePart()->getUserGeometry() );
+    if ( palGeometry && palGeometry->cachedLabel() )
+      palGeometry->cachedLabel()->setPlaced( *it );
+  }
+
   delete problem;
   delete labels;
 
@@ -1274,6 +1533,30 @@ QList<QgsLabelPosition> QgsPalLabeling::labelsAtPosition( const QgsPoint& p )
   return positions;
 }
 
+void QgsPalLabeling::labelCacheStatistics( int& sizeHits, int& candidateHits ) const
+{
+  sizeHits = mLabelCache->sizeHits();
+  candidateHits = mLabelCache->candidateHits();
+}
+
+QList<QgsLabelPosition> QgsPalLabeling::labelsWithinRect( const QgsRectangle& r )
+{
+  QList<QgsLabelPosition> positions;
+
+  QList<QgsLabelPosition*> positionPointers;
+  if ( mLabelSearchTree )
+  {
+    mLabelSearchTree->labelsInRect( r, positionPointers );
+    QList<QgsLabelPosition*>::const_iterator pointerIt = positionPointers.constBegin();
+    for ( ; pointerIt != positionPointers.constEnd(); ++pointerIt )
+    {
+      positions.push_back( QgsLabelPosition( **pointerIt ) );
+    }
+  }
+
+  return positions;
+}
+
 void QgsPalLabeling::numCandidatePositions( int& candPoint, int& candLine, int& candPolygon )
 {
   candPoint = mCandPoint;
@@ -1402,5 +1685,6 @@ QgsLabelingEngineInterface* QgsPalLabeling::clone()
   QgsPalLabeling* lbl = new QgsPalLabeling();
   lbl->mShowingAllLabels = mShowingAllLabels;
   lbl->mShowingCandidates = mShowingCandidates;
+  lbl->mParallelLabeling = mParallelLabeling;
   return lbl;
 }
@@ -28,6 +28,7 @@ class QgsMapRenderer;
 class QgsRectangle;
 class QgsCoordinateTransform;
 class QgsLabelSearchTree;
+class QgsPalLabelCache;
 struct QgsDiagramLayerSettings;
 
 #include <QString>
@@ -156,6 +157,7 @@ class CORE_EXPORT QgsPalLayerSettings
     QgsPoint ptZero, ptOne;
     QList<QgsPalGeometry*> geometries;
     QgsGeometry* extentGeom;
+    QgsPalLabelCache* labelCache; // label sizes and candidates of the previous labeling
 
     /**Stores field indices for data defined layer properties*/
     QMap< DataDefinedProperties, int > dataDefinedProperties;
@@ -170,6 +172,10 @@ class CORE_EXPORT QgsPalLayerSettings
     /**Checks if a feature is larger than a minimum size (in mm)
     @return true if above size, false if below*/
     bool checkMinimumSizeMM( const QgsRenderContext& ct, QgsGeometry* geom, double minSize ) const;
+    /**Measures the text of a label in pixels*/
+    void labelSizeInPixels( const QFontMetricsF* fm, QString text, double& width, double& height ) const;
+    /**Converts a label size in pixels to map units*/
+    void labelSizeToMapUnits( double width, double height, double& labelX, double& labelY ) const;
     QgsExpression* expression;
 };
 
@@ -205,6 +211,17 @@ class CORE_EXPORT QgsPalLabeling : public QgsLabelingEngineInterface
     bool isShowingAllLabels() const { return mShowingAllLabels; }
     void setShowingAllLabels( bool showing ) { mShowingAllLabels = showing; }
 
+    /**Enables generation of label candidates and placement of the labels on the global
+      thread pool. Labels are placed the same way as without threads.
+      @note added in 1.9 */
+    void setParallelLabelingEnabled( bool enabled ) { mParallelLabeling = enabled; }
+    bool isParallelLabelingEnabled() const { return mParallelLabeling; }
+
+    /**Returns how many features of the current or last labeling reused the label size
+      and the candidates of the labeling before.
+      @note added in 1.9 */
+    void labelCacheStatistics( int& sizeHits, int& candidateHits ) const;
+
     // implemented methods from labeling engine interface
 
     //! called when we're going to start with rendering
@@ -224,6 +241,9 @@ class CORE_EXPORT QgsPalLabeling : public QgsLabelingEngineInterface
     virtual void exit();
     //! return infos about labels at a given (map) position
     virtual QList<QgsLabelPosition> labelsAtPosition( const QgsPoint& p );
+    //! return infos about the labels of the last labeling within a rectangle (map coordinates)
+    //! @note added in 1.9
+    QList<QgsLabelPosition> labelsWithinRect( const QgsRectangle& r );
 
     //! called when passing engine among map renderers
     virtual QgsLabelingEngineInterface* clone();
@@ -257,7 +277,12 @@ class CORE_EXPORT QgsPalLabeling : public QgsLabelingEngineInterface
 
     bool mShowingAllLabels; // whether to avoid collisions or not
 
+    bool mParallelLabeling;
+
     QgsLabelSearchTree* mLabelSearchTree;
+
+    // label sizes and candidates of the features of the last labeling
+    QgsPalLabelCache* mLabelCache;
 };
 
 #endif // QGSPALLABELING_H
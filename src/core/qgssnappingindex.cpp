@@ -0,0 +1,404 @@
+/***************************************************************************
+    qgssnappingindex.cpp  - R-tree of vertices and segments for snapping
+    ----------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgssnappingindex.h"
+
+#include "qgsgeometry.h"
+#include "qgslogger.h"
+
+#include "SpatialIndex.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace SpatialIndex;
+
+
+// visitor collecting the ids of the items found
+class QgsSnappingIndexVisitor : public SpatialIndex::IVisitor
+{
+  public:
+    QgsSnappingIndexVisitor( QList<qint64> & list )
+        : mList( list ) {}
+
+    void visitNode( const INode& n )
+    { Q_UNUSED( n ); }
+
+    void visitData( const IData& d )
+    {
+      mList.append( d.getIdentifier() );
+    }
+
+    void visitData( std::vector<const IData*>& v )
+    { Q_UNUSED( v ); }
+
+  private:
+    QList<qint64>& mList;
+};
+
+static Region segmentRegion( const QgsPoint& p1, const QgsPoint& p2 )
+{
+  double pt1[2], pt2[2];
+  pt1[0] = qMin( p1.x(), p2.x() );
+  pt1[1] = qMin( p1.y(), p2.y() );
+  pt2[0] = qMax( p1.x(), p2.x() );
+  pt2[1] = qMax( p1.y(), p2.y() );
+  return Region( pt1, pt2, 2 );
+}
+
+
+QgsSnappingIndex::QgsSnappingIndex( const QgsVectorLayer* layer )
+    : mLayer( layer )
+    , mNextItemId( 0 )
+    , mStorageManager( 0 )
+    , mStorage( 0 )
+    , mRTree( 0 )
+{
+  createTree();
+}
+
+QgsSnappingIndex::~QgsSnappingIndex()
+{
+  delete mRTree;
+  delete mStorage;
+  delete mStorageManager;
+}
+
+void QgsSnappingIndex::createTree()
+{
+  // same setup as QgsSpatialIndex
+  mStorageManager = StorageManager::createNewMemoryStorageManager();
+
+  unsigned int capacity = 10;
+  bool writeThrough = false;
+  mStorage = StorageManager::createNewRandomEvictionsBuffer( *mStorageManager, capacity, writeThrough );
+
+  double fillFactor = 0.7;
+  unsigned long indexCapacity = 10;
+  unsigned long leafCapacity = 10;
+  unsigned long dimension = 2;
+  RTree::RTreeVariant variant = RTree::RV_RSTAR;
+
+  SpatialIndex::id_type indexId;
+  mRTree = RTree::createNewRTree( *mStorage, fillFactor, indexCapacity,
+                                  leafCapacity, dimension, variant, indexId );
+}
+
+void QgsSnappingIndex::clear()
+{
+  delete mRTree;
+  delete mStorage;
+  delete mStorageManager;
+  mFeatures.clear();
+  mItems.clear();
+  mNextItemId = 0;
+  createTree();
+}
+
+void QgsSnappingIndex::insertItem( QgsFeatureId featureId, FeatureVertices& fv, int vertex, bool segment )
+{
+  Item item;
+  item.featureId = featureId;
+  item.vertex = vertex;
+  item.segment = segment;
+
+  qint64 id = mNextItemId++;
+  Region r = segmentRegion( fv.points[vertex], fv.points[ segment ? vertex + 1 : vertex ] );
+  try
+  {
+    mRTree->insertData( 0, 0, r, id );
+  }
+  catch ( Tools::Exception &e )
+  {
+    Q_UNUSED( e );
+    QgsDebugMsg( QString( "Tools::Exception caught: %1" ).arg( e.what().c_str() ) );
+    return;
+  }
+  catch ( ... )
+  {
+    QgsDebugMsg( "unknown spatial index exception caught" );
+    return;
+  }
+  mItems.insert( id, item );
+  fv.items.append( id );
+}
+
+void QgsSnappingIndex::addLine( FeatureVertices& fv, const QVector<QgsPoint>& line, bool ring )
+{
+  // vertex numbering and neighbours as in QgsGeometry::closestVertex
+  int first = fv.points.size();
+  int n = line.size();
+  for ( int i = 0; i < n; ++i )
+  {
+    int before, after;
+    if ( ring )
+    {
+      if ( i == 0 )
+      {
+        before = first + n - 2;
+        after = first + 1;
+      }
+      else if ( i == n - 1 )
+      {
+        before = first + i - 1;
+        after = first + i - ( n - 2 );
+      }
+      else
+      {
+        before = first + i - 1;
+        after = first + i + 1;
+      }
+    }
+    else
+    {
+      before = i == 0 ? -1 : first + i - 1;
+      after = i == n - 1 ? -1 : first + i + 1;
+    }
+    fv.points.append( line[i] );
+    fv.beforeVertex.append( before );
+    fv.afterVertex.append( after );
+  }
+}
+
+void QgsSnappingIndex::addGeometry( QgsFeatureId featureId, QgsGeometry* geom )
+{
+  removeGeometry( featureId );
+  if ( !geom )
+    return;
+
+  FeatureVertices fv;
+  QList<int> partStarts;
+  bool lines = true;
+
+  switch ( geom->type() )
+  {
+    case QGis::Point:
+    {
+      lines = false;
+      QgsMultiPoint points;
+      if ( geom->isMultipart() )
+        points = geom->asMultiPoint();
+      else
+        points.append( geom->asPoint() );
+      for ( int i = 0; i < points.size(); ++i )
+      {
+        fv.points.append( points[i] );
+        fv.beforeVertex.append( -1 );
+        fv.afterVertex.append( -1 );
+      }
+      break;
+    }
+
+    case QGis::Line:
+    {
+      QgsMultiPolyline multiLine;
+      if ( geom->isMultipart() )
+        multiLine = geom->asMultiPolyline();
+      else
+        multiLine.append( geom->asPolyline() );
+      for ( int i = 0; i < multiLine.size(); ++i )
+      {
+        partStarts.append( fv.points.size() );
+        addLine( fv, multiLine[i], false );
+      }
+      break;
+    }
+
+    case QGis::Polygon:
+    {
+      QgsMultiPolygon multiPolygon;
+      if ( geom->isMultipart() )
+        multiPolygon = geom->asMultiPolygon();
+      else
+        multiPolygon.append( geom->asPolygon() );
+      for ( int i = 0; i < multiPolygon.size(); ++i )
+      {
+        for ( int j = 0; j < multiPolygon[i].size(); ++j )
+        {
+          partStarts.append( fv.points.size() );
+          addLine( fv, multiPolygon[i][j], true );
+        }
+      }
+      break;
+    }
+
+    default:
+      return;
+  }
+
+  if ( fv.points.isEmpty() )
+    return;
+
+  if ( !lines )
+  {
+    for ( int i = 0; i < fv.points.size(); ++i )
+      insertItem( featureId, fv, i, false );
+  }
+  else
+  {
+    partStarts.append( fv.points.size() );
+    for ( int p = 0; p < partStarts.size() - 1; ++p )
+    {
+      int start = partStarts[p];
+      int end = partStarts[p + 1];
+      if ( end - start == 1 )
+      {
+        insertItem( featureId, fv, start, false );
+        continue;
+      }
+      for ( int i = start; i < end - 1; ++i )
+        insertItem( featureId, fv, i, true );
+    }
+  }
+
+  mFeatures.insert( featureId, fv );
+}
+
+void QgsSnappingIndex::removeGeometry( QgsFeatureId featureId )
+{
+  QHash<QgsFeatureId, FeatureVertices>::iterator fIt = mFeatures.find( featureId );
+  if ( fIt == mFeatures.end() )
+    return;
+
+  const FeatureVertices& fv = fIt.value();
+  foreach( qint64 id, fv.items )
+  {
+    const Item& item = mItems[id];
+    Region r = segmentRegion( fv.points[item.vertex], fv.points[ item.segment ? item.vertex + 1 : item.vertex ] );
+    try
+    {
+      mRTree->deleteData( r, id );
+    }
+    catch ( ... )
+    {
+      QgsDebugMsg( "unknown spatial index exception caught" );
+    }
+    mItems.remove( id );
+  }
+  mFeatures.erase( fIt );
+}
+
+int QgsSnappingIndex::snap( const QgsPoint& startPoint, double snappingTolerance,
+                            QMultiMap < double, QgsSnappingResult > & snappingResults,
+                            QgsSnapper::SnappingType snap_to ) const
+{
+  double pt1[2], pt2[2];
+  pt1[0] = startPoint.x() - snappingTolerance;
+  pt1[1] = startPoint.y() - snappingTolerance;
+  pt2[0] = startPoint.x() + snappingTolerance;
+  pt2[1] = startPoint.y() + snappingTolerance;
+  Region searchRegion( pt1, pt2, 2 );
+
+  QList<qint64> found;
+  QgsSnappingIndexVisitor visitor( found );
+  mRTree->intersectsWithQuery( searchRegion, visitor );
+
+  if ( found.isEmpty() )
+    return 0;
+
+  // closest vertex and closest segment of every feature near the start point
+  QHash<QgsFeatureId, Candidate> candidates;
+
+  bool toVertex = snap_to == QgsSnapper::SnapToVertex || snap_to == QgsSnapper::SnapToVertexAndSegment;
+  bool toSegment = snap_to == QgsSnapper::SnapToSegment || snap_to == QgsSnapper::SnapToVertexAndSegment;
+  double maxDist = std::numeric_limits<double>::max();
+
+  foreach( qint64 id, found )
+  {
+    const Item& item = *mItems.constFind( id );
+    const FeatureVertices& fv = *mFeatures.constFind( item.featureId );
+
+    QHash<QgsFeatureId, Candidate>::iterator cIt = candidates.find( item.featureId );
+    if ( cIt == candidates.end() )
+    {
+      Candidate c;
+      c.vertexDist = maxDist;
+      c.vertex = -1;
+      c.segmentDist = maxDist;
+      c.segment = -1;
+      cIt = candidates.insert( item.featureId, c );
+    }
+    Candidate& c = cIt.value();
+
+    if ( toVertex )
+    {
+      int last = item.segment ? item.vertex + 1 : item.vertex;
+      for ( int v = item.vertex; v <= last; ++v )
+      {
+        double d = startPoint.sqrDist( fv.points[v] );
+        if ( d < c.vertexDist || ( d == c.vertexDist && v < c.vertex ) )
+        {
+          c.vertexDist = d;
+          c.vertex = v;
+        }
+      }
+    }
+
+    if ( toSegment && item.segment )
+    {
+      QgsPoint p1 = fv.points[item.vertex];
+      QgsPoint p2 = fv.points[item.vertex + 1];
+      QgsPoint distPoint;
+      double d = startPoint.sqrDistToSegment( p1.x(), p1.y(), p2.x(), p2.y(), distPoint );
+      if ( d < c.segmentDist || ( d == c.segmentDist && item.vertex < c.segment ) )
+      {
+        c.segmentDist = d;
+        c.segment = item.vertex;
+        c.segmentPoint = distPoint;
+      }
+    }
+  }
+
+  double sqrSnappingTolerance = snappingTolerance * snappingTolerance;
+
+  QHash<QgsFeatureId, Candidate>::const_iterator cIt = candidates.constBegin();
+  for ( ; cIt != candidates.constEnd(); ++cIt )
+  {
+    const Candidate& c = cIt.value();
+    const FeatureVertices& fv = *mFeatures.constFind( cIt.key() );
+
+    QgsSnappingResult result;
+    result.snappedAtGeometry = cIt.key();
+    result.layer = mLayer;
+
+    if ( c.vertex != -1 && c.vertexDist < sqrSnappingTolerance )
+    {
+      result.snappedVertex = fv.points[c.vertex];
+      result.snappedVertexNr = c.vertex;
+      result.beforeVertexNr = fv.beforeVertex[c.vertex];
+      if ( result.beforeVertexNr != -1 )
+      {
+        result.beforeVertex = fv.points[result.beforeVertexNr];
+      }
+      result.afterVertexNr = fv.afterVertex[c.vertex];
+      if ( result.afterVertexNr != -1 )
+      {
+        result.afterVertex = fv.points[result.afterVertexNr];
+      }
+      snappingResults.insert( sqrt( c.vertexDist ), result );
+    }
+    else if ( c.segment != -1 && c.segmentDist < sqrSnappingTolerance )
+    {
+      result.snappedVertex = c.segmentPoint;
+      result.snappedVertexNr = -1;
+      result.beforeVertexNr = c.segment;
+      result.afterVertexNr = c.segment + 1;
+      result.beforeVertex = fv.points[c.segment];
+      result.afterVertex = fv.points[c.segment + 1];
+      snappingResults.insert( sqrt( c.segmentDist ), result );
+    }
+  }
+
+  return candidates.size();
+}
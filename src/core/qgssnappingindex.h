@@ -0,0 +1,122 @@
+/***************************************************************************
+    qgssnappingindex.h  - R-tree of vertices and segments for snapping
+    ----------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSSNAPPINGINDEX_H
+#define QGSSNAPPINGINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QMultiMap>
+#include <QVector>
+
+#include "qgsfeature.h"
+#include "qgspoint.h"
+#include "qgssnapper.h"
+
+namespace SpatialIndex
+{
+  class IStorageManager;
+  class ISpatialIndex;
+
+  namespace StorageManager
+  {
+    class IBuffer;
+  }
+}
+
+class QgsGeometry;
+class QgsVectorLayer;
+
+/** \ingroup core
+ * Spatial index of the segments (and isolated vertices) of a set of geometries.
+ * Used by QgsVectorLayer to answer snapping queries without walking all vertices
+ * of all cached geometries. Vertex numbers are the ones used by QgsGeometry.
+ * @note added in 1.9
+ */
+class CORE_EXPORT QgsSnappingIndex
+{
+  public:
+    /** constructor. Snapping results will reference the given layer */
+    QgsSnappingIndex( const QgsVectorLayer* layer = 0 );
+    ~QgsSnappingIndex();
+
+    /** add geometry of a feature to the index, replacing any previous geometry of this feature */
+    void addGeometry( QgsFeatureId featureId, QgsGeometry* geom );
+
+    /** remove geometry of a feature from the index */
+    void removeGeometry( QgsFeatureId featureId );
+
+    /** remove all geometries */
+    void clear();
+
+    /** returns true if the index contains a geometry for the feature */
+    bool contains( QgsFeatureId featureId ) const { return mFeatures.contains( featureId ); }
+
+    /** number of indexed geometries */
+    int featureCount() const { return mFeatures.size(); }
+
+    /**Snaps to the indexed geometries with the same semantics as QgsVectorLayer::snapWithContext:
+     at most one result per feature, vertex results taking precedence over segment results.
+     @return number of features close to the start point*/
+    int snap( const QgsPoint& startPoint, double snappingTolerance,
+              QMultiMap < double, QgsSnappingResult > & snappingResults,
+              QgsSnapper::SnappingType snap_to ) const;
+
+  private:
+    /** vertices of an indexed geometry */
+    struct FeatureVertices
+    {
+      QVector<QgsPoint> points;
+      QVector<int> beforeVertex;
+      QVector<int> afterVertex;
+      QList<qint64> items;
+    };
+
+    /** index entry: the segment vertex -> vertex + 1 or a single vertex if segment is false */
+    struct Item
+    {
+      QgsFeatureId featureId;
+      int vertex;
+      bool segment;
+    };
+
+    /** closest vertex and segment of a feature found by a query */
+    struct Candidate
+    {
+      double vertexDist;
+      int vertex;
+      double segmentDist;
+      int segment;
+      QgsPoint segmentPoint;
+    };
+
+    QgsSnappingIndex( const QgsSnappingIndex& );
+    QgsSnappingIndex& operator=( const QgsSnappingIndex& );
+
+    void createTree();
+    void addLine( FeatureVertices& fv, const QVector<QgsPoint>& line, bool ring );
+    void insertItem( QgsFeatureId featureId, FeatureVertices& fv, int vertex, bool segment );
+
+    const QgsVectorLayer* mLayer;
+
+    QHash<QgsFeatureId, FeatureVertices> mFeatures;
+    QHash<qint64, Item> mItems;
+    qint64 mNextItemId;
+
+    SpatialIndex::IStorageManager* mStorageManager;
+    SpatialIndex::StorageManager::IBuffer* mStorage;
+    SpatialIndex::ISpatialIndex* mRTree;
+};
+
+#endif
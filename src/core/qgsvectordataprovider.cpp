@@ -25,6 +25,51 @@
 #include "qgslogger.h"
 #include "qgsmessagelog.h"
 
+/** Iterator over the single select() / nextFeature() cursor of a provider.
+  Used for providers that do not implement their own iterators. */
+class QgsVectorDataProviderSelectIterator : public QgsAbstractFeatureIterator
+{
+  public:
+    QgsVectorDataProviderSelectIterator( QgsVectorDataProvider* provider, const QgsFeatureRequest& request )
+        : QgsAbstractFeatureIterator( request ), P( provider )
+    {
+      P->select( mRequest.attributesToFetch( P->attributeIndexes() ),
+                 mRequest.filterRect(),
+                 mRequest.fetchGeometry(),
+                 mRequest.flags() & QgsFeatureRequest::ExactIntersect );
+    }
+
+    ~QgsVectorDataProviderSelectIterator()
+    {
+      close();
+    }
+
+    bool nextFeature( QgsFeature& f )
+    {
+      if ( mClosed )
+        return false;
+      return P->nextFeature( f );
+    }
+
+    bool rewind()
+    {
+      if ( mClosed )
+        return false;
+      P->rewind();
+      return true;
+    }
+
+    bool close()
+    {
+      mClosed = true;
+      return true;
+    }
+
+  private:
+    QgsVectorDataProvider* P;
+};
+
+
 QgsVectorDataProvider::QgsVectorDataProvider( QString uri )
     : QgsDataProvider( uri )
     , mCacheMinMaxDirty( true )
@@ -44,6 +89,23 @@ QString QgsVectorDataProvider::storageType() const
   return "Generic vector file";
 }
 
+QgsFeatureIterator QgsVectorDataProvider::getFeatures( const QgsFeatureRequest& request )
+{
+  return QgsFeatureIterator( new QgsVectorDataProviderSelectIterator( this, request ) );
+}
+
+QgsFeatureRequest QgsVectorDataProvider::selectRequest( const QgsAttributeList& fetchAttributes, const QgsRectangle& rect,
+    bool fetchGeometry, bool useIntersect )
+{
+  QgsFeatureRequest::Flags flags = QgsFeatureRequest::NoFlags;
+  if ( !fetchGeometry )
+    flags |= QgsFeatureRequest::NoGeometry;
+  if ( useIntersect )
+    flags |= QgsFeatureRequest::ExactIntersect;
+
+  return QgsFeatureRequest( rect ).setFlags( flags ).setSubsetOfAttributes( fetchAttributes );
+}
+
 long QgsVectorDataProvider::updateFeatureCount()
 {
   return -1;
@@ -54,9 +116,10 @@ bool QgsVectorDataProvider::featureAtId( QgsFeatureId featureId,
     bool fetchGeometry,
     QgsAttributeList fetchAttributes )
 {
-  select( fetchAttributes, QgsRectangle(), fetchGeometry );
+  QgsFeatureRequest request = selectRequest( fetchAttributes, QgsRectangle(), fetchGeometry, false );
+  QgsFeatureIterator fi = getFeatures( request );
 
-  while ( nextFeature( feature ) )
+  while ( fi.nextFeature( feature ) )
   {
     if ( feature.id() == featureId )
       return true;
@@ -357,17 +420,17 @@ void QgsVectorDataProvider::uniqueValues( int index, QList<QVariant> &values, in
   QgsFeature f;
   QgsAttributeList keys;
   keys.append( index );
-  select( keys, QgsRectangle(), false );
+  QgsFeatureIterator fi = getFeatures( selectRequest( keys, QgsRectangle(), false, false ) );
 
   QSet<QString> set;
   values.clear();
 
-  while ( nextFeature( f ) )
+  while ( fi.nextFeature( f ) )
   {
-    if ( !set.contains( f.attributeMap()[index].toString() ) )
+    if ( !set.contains( f.attribute( index ).toString() ) )
     {
-      values.append( f.attributeMap()[index] );
-      set.insert( f.attributeMap()[index].toString() );
+      values.append( f.attribute( index ) );
+      set.insert( f.attribute( index ).toString() );
     }
 
     if ( limit >= 0 && values.size() >= limit )
@@ -407,9 +470,9 @@ void QgsVectorDataProvider::fillMinMaxCache()
 
   QgsFeature f;
   QgsAttributeList keys = mCacheMinValues.keys();
-  select( keys, QgsRectangle(), false );
+  QgsFeatureIterator fi = getFeatures( selectRequest( keys, QgsRectangle(), false, false ) );
 
-  while ( nextFeature( f ) )
+  while ( fi.nextFeature( f ) )
   {
     QgsAttributeMap attrMap = f.attributeMap();
     for ( QgsAttributeList::const_iterator it = keys.begin(); it != keys.end(); ++it )
@@ -25,6 +25,7 @@ class QTextCodec;
 #include "qgis.h"
 #include "qgsdataprovider.h"
 #include "qgsfeature.h"
+#include "qgsfeatureiterator.h"
 #include "qgsfield.h"
 #include "qgsrectangle.h"
 
@@ -114,6 +115,18 @@ class CORE_EXPORT QgsVectorDataProvider : public QgsDataProvider
                          bool fetchGeometry = true,
                          bool useIntersect = false ) = 0;
 
+    /**
+     * Query the provider for features specified in request.
+     * Each returned iterator keeps its own cursor, so it is not affected by
+     * select() / nextFeature() or by other iterators of the same provider.
+     *
+     * Default implementation wraps the cursor of select() / nextFeature(),
+     * so only one iterator may be in use at a time. Providers that can keep
+     * several cursors open should override this function.
+     * @note added in 1.9
+     */
+    virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest& request = QgsFeatureRequest() );
+
     /**
      * This function does nothing useful, it's kept only for compatibility.
      * @todo to be removed
@@ -381,6 +394,17 @@ class CORE_EXPORT QgsVectorDataProvider : public QgsDataProvider
   protected:
     QVariant convertValue( QVariant::Type type, QString value );
 
+    /** Translate the arguments of select() to a feature request.
+      Used by providers that implement select() / nextFeature() on top of getFeatures()
+      @note added in 1.9 */
+    static QgsFeatureRequest selectRequest( const QgsAttributeList& fetchAttributes, const QgsRectangle& rect,
+                                            bool fetchGeometry, bool useIntersect );
+
+    /** Iterator behind select() / nextFeature() / rewind() in providers that implement
+      them on top of getFeatures()
+      @note added in 1.9 */
+    QgsFeatureIterator mSelectIterator;
+
     void clearMinMaxCache();
     void fillMinMaxCache();
 
@@ -56,8 +56,10 @@
 #include "qgsproviderregistry.h"
 #include "qgsrectangle.h"
 #include "qgsrendercontext.h"
+#include "qgssnappingindex.h"
 #include "qgscoordinatereferencesystem.h"
 #include "qgsvectordataprovider.h"
+#include "qgsvectorlayerfeatureiterator.h"
 #include "qgsvectorlayerjoinbuffer.h"
 #include "qgsvectorlayerundocommand.h"
 #include "qgsvectoroverlay.h"
@@ -92,6 +94,7 @@ QgsVectorLayer::QgsVectorLayer( QString vectorLayerPath,
     , mEditable( false )
     , mReadOnly( false )
     , mModified( false )
+    , mSnappingIndex( 0 )
     , mMaxUpdatedIndex( -1 )
     , mActiveCommand( NULL )
     , mRenderer( 0 )
@@ -100,7 +103,6 @@ QgsVectorLayer::QgsVectorLayer( QString vectorLayerPath,
     , mLabel( 0 )
     , mLabelOn( false )
     , mVertexMarkerOnlyForSelection( false )
-    , mFetching( false )
     , mJoinBuffer( 0 )
     , mDiagramRenderer( 0 )
     , mDiagramLayerSettings( 0 )
@@ -174,6 +176,8 @@ QgsVectorLayer::~QgsVectorLayer()
 
   mValid = false;
 
+  mSelectIterator.close();
+
   delete mRenderer;
   delete mDataProvider;
   delete mJoinBuffer;
@@ -958,8 +962,7 @@ bool QgsVectorLayer::draw( QgsRenderContext& rendererContext )
     if ( mEditable )
     {
       // Destroy all cached geometries and clear the references to them
-      deleteCachedGeometries();
-      mCachedGeometriesRect = rendererContext.extent();
+      refreshCachedGeometries( rendererContext.extent() );
 
       // set editing vertex markers style
       mRendererV2->setVertexMarkerAppearance( currentVertexMarkerType(), currentVertexMarkerSize() );
@@ -1010,8 +1013,7 @@ bool QgsVectorLayer::draw( QgsRenderContext& rendererContext )
     if ( mEditable )
     {
       // Destroy all cached geometries and clear the references to them
-      deleteCachedGeometries();
-      mCachedGeometriesRect = rendererContext.extent();
+      refreshCachedGeometries( rendererContext.extent() );
       vertexMarker = currentVertexMarkerType();
       vertexMarkerSize = currentVertexMarkerSize();
       mVertexMarkerOnlyForSelection = settings.value( "/qgis/digitizing/marker_only_for_selected", false ).toBool();
@@ -1131,6 +1133,31 @@ void QgsVectorLayer::deleteCachedGeometries()
   // Destroy any cached geometries
   mCachedGeometries.clear();
   mCachedGeometriesRect = QgsRectangle();
+
+  delete mSnappingIndex;
+  mSnappingIndex = 0;
+}
+
+void QgsVectorLayer::invalidateSnappingIndex()
+{
+  // snap against the provider until the next redraw rebuilds the cache
+  delete mSnappingIndex;
+  mSnappingIndex = 0;
+  mCachedGeometriesRect = QgsRectangle();
+}
+
+void QgsVectorLayer::refreshCachedGeometries( const QgsRectangle& extent )
+{
+  if ( mCachedGeometriesRect == extent )
+  {
+    // same features are going to be cached again. The snapping index
+    // has been kept up to date by the editing methods and stays valid
+    mCachedGeometries.clear();
+    return;
+  }
+
+  deleteCachedGeometries();
+  mCachedGeometriesRect = extent;
 }
 
 void QgsVectorLayer::drawVertexMarker( double x, double y, QPainter& p, QgsVectorLayer::VertexMarkerType type, int m )
@@ -1475,7 +1502,7 @@ void QgsVectorLayer::updateExtents()
       mLayerExtent.combineExtentWith( &r );
     }
 
-    for ( QgsFeatureList::iterator it = mAddedFeatures.begin(); it != mAddedFeatures.end(); it++ )
+    for ( QgsFeatureMap::iterator it = mAddedFeatures.begin(); it != mAddedFeatures.end(); it++ )
     {
       QgsRectangle r = it->geometry()->boundingBox();
       mLayerExtent.combineExtentWith( &r );
@@ -1531,21 +1558,39 @@ bool QgsVectorLayer::setSubsetString( QString subset )
   updateExtents();
 
   if ( res )
+  {
     setCacheImage( 0 );
+    emit subsetStringChanged();
+  }
 
   return res;
 }
 
-void QgsVectorLayer::updateFeatureAttributes( QgsFeature &f, bool all )
+void QgsVectorLayer::updateFeatureAttributes( QgsFeature &f )
 {
-  if ( mDataProvider && ( all || ( mFetchAttributes.size() > 0 && mJoinBuffer->containsFetchJoins() ) ) )
+  if ( mDataProvider )
   {
     int index = 0;
     QgsVectorLayerJoinBuffer::maximumIndex( mDataProvider->fields(), index );
-    mJoinBuffer->updateFeatureAttributes( f, index, all );
+    mJoinBuffer->updateFeatureAttributes( f, index, true );
   }
 
+  updateChangedAttributes( f, QgsAttributeList(), true );
+}
 
+void QgsVectorLayer::updateFeatureAttributes( QgsFeature &f, const QgsAttributeList& fetchAttributes,
+    const QMap<QgsVectorLayer*, QgsFetchJoinInfo>& fetchJoinInfos )
+{
+  if ( mDataProvider && fetchAttributes.size() > 0 && fetchJoinInfos.size() > 0 )
+  {
+    mJoinBuffer->updateFeatureAttributes( f, fetchJoinInfos );
+  }
+
+  updateChangedAttributes( f, fetchAttributes, false );
+}
+
+void QgsVectorLayer::updateChangedAttributes( QgsFeature &f, const QgsAttributeList& fetchAttributes, bool all )
+{
   // do not update when we aren't in editing mode
   if ( !mEditable )
     return;
@@ -1565,7 +1610,7 @@ void QgsVectorLayer::updateFeatureAttributes( QgsFeature &f, bool all )
 
   // null/add all attributes that were added, but don't exist in the feature yet
   for ( QgsFieldMap::const_iterator it = mUpdatedFields.begin(); it != mUpdatedFields.end(); it++ )
-    if ( !map.contains( it.key() ) && ( all || mFetchAttributes.contains( it.key() ) ) )
+    if ( !map.contains( it.key() ) && ( all || fetchAttributes.contains( it.key() ) ) )
       f.changeAttribute( it.key(), QVariant( QString::null ) );
 }
 
@@ -1643,189 +1688,33 @@ void QgsVectorLayer::updateFeatureGeometry( QgsFeature &f )
 }
 
 
-void QgsVectorLayer::select( QgsAttributeList attributes, QgsRectangle rect, bool fetchGeometries, bool useIntersect )
+QgsFeatureIterator QgsVectorLayer::getFeatures( const QgsFeatureRequest& request )
 {
   if ( !mDataProvider )
-    return;
-
-  mFetching        = true;
-  mFetchRect       = rect;
-  mFetchAttributes = attributes;
-  mFetchGeometry   = fetchGeometries;
-  mFetchConsidered = mDeletedFeatureIds;
-  QgsAttributeList targetJoinFieldList;
-
-  if ( mEditable )
-  {
-    mFetchAddedFeaturesIt = mAddedFeatures.begin();
-    mFetchChangedGeomIt = mChangedGeometries.begin();
-  }
+    return QgsFeatureIterator();
 
-  //look in the normal features of the provider
-  if ( mFetchAttributes.size() > 0 )
-  {
-    if ( mEditable || mJoinBuffer->containsJoins() )
-    {
-      QgsAttributeList joinFields;
-
-      int maxProviderIndex = 0;
-      if ( mDataProvider )
-      {
-        QgsVectorLayerJoinBuffer::maximumIndex( mDataProvider->fields(), maxProviderIndex );
-      }
+  return QgsFeatureIterator( new QgsVectorLayerFeatureIterator( this, request ) );
+}
 
-      mJoinBuffer->select( mFetchAttributes, joinFields, maxProviderIndex );
-      QgsAttributeList::const_iterator joinFieldIt = joinFields.constBegin();
-      for ( ; joinFieldIt != joinFields.constEnd(); ++joinFieldIt )
-      {
-        if ( !mFetchAttributes.contains( *joinFieldIt ) )
-        {
-          mFetchAttributes.append( *joinFieldIt );
-        }
-      }
+void QgsVectorLayer::select( QgsAttributeList attributes, QgsRectangle rect, bool fetchGeometries, bool useIntersect )
+{
+  if ( !mDataProvider )
+    return;
 
-      //detect which fields are from the provider
-      mFetchProvAttributes.clear();
-      for ( QgsAttributeList::iterator it = mFetchAttributes.begin(); it != mFetchAttributes.end(); it++ )
-      {
-        if ( mDataProvider->fields().contains( *it ) )
-        {
-          mFetchProvAttributes << *it;
-        }
-      }
+  QgsFeatureRequest::Flags flags = QgsFeatureRequest::NoFlags;
+  if ( !fetchGeometries )
+    flags |= QgsFeatureRequest::NoGeometry;
+  if ( useIntersect )
+    flags |= QgsFeatureRequest::ExactIntersect;
 
-      mDataProvider->select( mFetchProvAttributes, rect, fetchGeometries, useIntersect );
-    }
-    else
-    {
-      mDataProvider->select( mFetchAttributes, rect, fetchGeometries, useIntersect );
-    }
-  }
-  else //we don't need any attributes at all
-  {
-    mDataProvider->select( QgsAttributeList(), rect, fetchGeometries, useIntersect );
-  }
+  // close the previous iterator first, providers may not allow another one meanwhile
+  mSelectIterator.close();
+  mSelectIterator = getFeatures( QgsFeatureRequest( rect ).setFlags( flags ).setSubsetOfAttributes( attributes ) );
 }
 
 bool QgsVectorLayer::nextFeature( QgsFeature &f )
 {
-  if ( !mFetching )
-    return false;
-
-  if ( mEditable )
-  {
-    if ( !mFetchRect.isEmpty() )
-    {
-      // check if changed geometries are in rectangle
-      for ( ; mFetchChangedGeomIt != mChangedGeometries.end(); mFetchChangedGeomIt++ )
-      {
-        QgsFeatureId fid = mFetchChangedGeomIt.key();
-
-        if ( mFetchConsidered.contains( fid ) )
-          // skip deleted features
-          continue;
-
-        mFetchConsidered << fid;
-
-        if ( !mFetchChangedGeomIt->intersects( mFetchRect ) )
-          // skip changed geometries not in rectangle and don't check again
-          continue;
-
-        f.setFeatureId( fid );
-        f.setValid( true );
-
-        if ( mFetchGeometry )
-          f.setGeometry( mFetchChangedGeomIt.value() );
-
-        if ( mFetchAttributes.size() > 0 )
-        {
-          if ( fid < 0 )
-          {
-            // fid<0 => in mAddedFeatures
-            bool found = false;
-
-            for ( QgsFeatureList::iterator it = mAddedFeatures.begin(); it != mAddedFeatures.end(); it++ )
-            {
-              if ( fid == it->id() )
-              {
-                found = true;
-                f.setAttributeMap( it->attributeMap() );
-                updateFeatureAttributes( f );
-                break;
-              }
-            }
-
-            if ( !found )
-            {
-              QgsDebugMsg( QString( "No attributes for the added feature %1 found" ).arg( f.id() ) );
-            }
-          }
-          else
-          {
-            // retrieve attributes from provider
-            QgsFeature tmp;
-            mDataProvider->featureAtId( fid, tmp, false, mFetchProvAttributes );
-            updateFeatureAttributes( tmp );
-            f.setAttributeMap( tmp.attributeMap() );
-          }
-        }
-
-        // return complete feature
-        mFetchChangedGeomIt++;
-        return true;
-      }
-
-      // no more changed geometries
-    }
-
-    for ( ; mFetchAddedFeaturesIt != mAddedFeatures.end(); mFetchAddedFeaturesIt++ )
-    {
-      QgsFeatureId fid = mFetchAddedFeaturesIt->id();
-
-      if ( mFetchConsidered.contains( fid ) )
-        // must have changed geometry outside rectangle
-        continue;
-
-      if ( !mFetchRect.isEmpty() &&
-           mFetchAddedFeaturesIt->geometry() &&
-           !mFetchAddedFeaturesIt->geometry()->intersects( mFetchRect ) )
-        // skip added features not in rectangle
-        continue;
-
-      f.setFeatureId( fid );
-      f.setValid( true );
-
-      if ( mFetchGeometry )
-        f.setGeometry( *mFetchAddedFeaturesIt->geometry() );
-
-      if ( mFetchAttributes.size() > 0 )
-      {
-        f.setAttributeMap( mFetchAddedFeaturesIt->attributeMap() );
-        updateFeatureAttributes( f );
-      }
-
-      mFetchAddedFeaturesIt++;
-      return true;
-    }
-
-    // no more added features
-  }
-
-  while ( dataProvider()->nextFeature( f ) )
-  {
-    if ( mFetchConsidered.contains( f.id() ) )
-    {
-      continue;
-    }
-    if ( mFetchAttributes.size() > 0 )
-    {
-      updateFeatureAttributes( f ); //check joined attributes / changed attributes
-    }
-    return true;
-  }
-
-  mFetching = false;
-  return false;
+  return mSelectIterator.nextFeature( f );
 }
 
 bool QgsVectorLayer::featureAtId( QgsFeatureId featureId, QgsFeature& f, bool fetchGeometries, bool fetchAttributes )
@@ -1847,19 +1736,12 @@ bool QgsVectorLayer::featureAtId( QgsFeatureId featureId, QgsFeature& f, bool fe
       if ( featureId < 0 )
       {
         // featureId<0 => in mAddedFeatures
-        bool found = false;
-
-        for ( QgsFeatureList::iterator it = mAddedFeatures.begin(); it != mAddedFeatures.end(); it++ )
+        QgsFeatureMap::const_iterator it = mAddedFeatures.constFind( featureId );
+        if ( it != mAddedFeatures.constEnd() )
         {
-          if ( featureId != it->id() )
-          {
-            found = true;
-            f.setAttributeMap( it->attributeMap() );
-            break;
-          }
+          f.copyAttributes( *it );
         }
-
-        if ( !found )
+        else
         {
           QgsDebugMsg( QString( "No attributes for the added feature %1 found" ).arg( f.id() ) );
         }
@@ -1869,28 +1751,26 @@ bool QgsVectorLayer::featureAtId( QgsFeatureId featureId, QgsFeature& f, bool fe
         // retrieve attributes from provider
         QgsFeature tmp;
         mDataProvider->featureAtId( featureId, tmp, false, mDataProvider->attributeIndexes() );
-        f.setAttributeMap( tmp.attributeMap() );
+        f.copyAttributes( tmp );
       }
-      updateFeatureAttributes( f, true );
+      updateFeatureAttributes( f );
     }
     return true;
   }
 
   //added features
-  for ( QgsFeatureList::iterator iter = mAddedFeatures.begin(); iter != mAddedFeatures.end(); ++iter )
+  QgsFeatureMap::const_iterator addedIt = mAddedFeatures.constFind( featureId );
+  if ( addedIt != mAddedFeatures.constEnd() )
   {
-    if ( iter->id() == featureId )
-    {
-      f.setFeatureId( iter->id() );
-      f.setValid( true );
-      if ( fetchGeometries )
-        f.setGeometry( *iter->geometry() );
+    f.setFeatureId( addedIt->id() );
+    f.setValid( true );
+    if ( fetchGeometries )
+      f.setGeometry( *addedIt->geometry() );
 
-      if ( fetchAttributes )
-        f.setAttributeMap( iter->attributeMap() );
+    if ( fetchAttributes )
+      f.copyAttributes( *addedIt );
 
-      return true;
-    }
+    return true;
   }
 
   // regular features
@@ -1898,7 +1778,7 @@ bool QgsVectorLayer::featureAtId( QgsFeatureId featureId, QgsFeature& f, bool fe
   {
     if ( mDataProvider->featureAtId( featureId, f, fetchGeometries, mDataProvider->attributeIndexes() ) )
     {
-      updateFeatureAttributes( f, true );
+      updateFeatureAttributes( f );
       return true;
     }
   }
@@ -2217,7 +2097,7 @@ int QgsVectorLayer::addPart( const QList<QgsPoint> &points )
 
   //look if id of selected feature belongs to an added feature
 #if 0
-  for ( QgsFeatureList::iterator addedIt = mAddedFeatures.begin(); addedIt != mAddedFeatures.end(); ++addedIt )
+  for ( QgsFeatureMap::iterator addedIt = mAddedFeatures.begin(); addedIt != mAddedFeatures.end(); ++addedIt )
   {
     if ( addedIt->id() == selectedFeatureId )
     {
@@ -2278,7 +2158,7 @@ int QgsVectorLayer::translateFeature( QgsFeatureId featureId, double dx, double
 
   //look if id of selected feature belongs to an added feature
 #if 0
-  for ( QgsFeatureList::iterator addedIt = mAddedFeatures.begin(); addedIt != mAddedFeatures.end(); ++addedIt )
+  for ( QgsFeatureMap::iterator addedIt = mAddedFeatures.begin(); addedIt != mAddedFeatures.end(); ++addedIt )
   {
     if ( addedIt->id() == featureId )
     {
@@ -2396,7 +2276,7 @@ int QgsVectorLayer::splitFeatures( const QList<QgsPoint>& splitLine, bool topolo
         newGeometry = newGeometries.at( i );
         QgsFeature newFeature;
         newFeature.setGeometry( newGeometry );
-        newFeature.setAttributeMap( select_it->attributeMap() );
+        newFeature.copyAttributes( *select_it );
         newFeatures.append( newFeature );
       }
 
@@ -3714,7 +3594,7 @@ bool QgsVectorLayer::commitChanges()
     }
 
     // remap attributes of added features
-    for ( QgsFeatureList::iterator fit = mAddedFeatures.begin(); fit != mAddedFeatures.end(); fit++ )
+    for ( QgsFeatureMap::iterator fit = mAddedFeatures.begin(); fit != mAddedFeatures.end(); fit++ )
     {
       const QgsAttributeMap &src = fit->attributeMap();
       QgsAttributeMap dst;
@@ -3762,48 +3642,56 @@ bool QgsVectorLayer::commitChanges()
     //
     if ( mAddedFeatures.size() > 0 )
     {
-      for ( int i = 0; i < mAddedFeatures.size(); i++ )
+      // drop added features that were deleted again and merge changed geometries
+      QgsFeatureMap::iterator fit = mAddedFeatures.begin();
+      while ( fit != mAddedFeatures.end() )
       {
-        QgsFeature &f = mAddedFeatures[i];
+        QgsFeatureId fid = fit.key();
 
-        if ( mDeletedFeatureIds.contains( f.id() ) )
+        if ( mDeletedFeatureIds.remove( fid ) )
         {
-          mDeletedFeatureIds.remove( f.id() );
-
-          if ( mChangedGeometries.contains( f.id() ) )
-            mChangedGeometries.remove( f.id() );
-
-          mAddedFeatures.removeAt( i-- );
+          mChangedGeometries.remove( fid );
+          fit = mAddedFeatures.erase( fit );
           continue;
         }
 
-        if ( mChangedGeometries.contains( f.id() ) )
+        QgsGeometryMap::iterator geomIt = mChangedGeometries.find( fid );
+        if ( geomIt != mChangedGeometries.end() )
         {
-          f.setGeometry( mChangedGeometries.take( f.id() ) );
+          fit->setGeometry( *geomIt );
+          mChangedGeometries.erase( geomIt );
         }
+        ++fit;
       }
 
       if ( cap & QgsVectorDataProvider::AddFeatures )
       {
+        // temporary ids count down, so add the features in the order they were digitized
+        QgsFeatureList features;
+        features.reserve( mAddedFeatures.size() );
         QList<QgsFeatureId> ids;
-        foreach( const QgsFeature &f, mAddedFeatures )
+        ids.reserve( mAddedFeatures.size() );
+        fit = mAddedFeatures.end();
+        while ( fit != mAddedFeatures.begin() )
         {
-          ids << f.id();
+          --fit;
+          features << *fit;
+          ids << fit.key();
         }
 
-        if ( mDataProvider->addFeatures( mAddedFeatures ) )
+        if ( mDataProvider->addFeatures( features ) )
         {
-          mCommitErrors << tr( "SUCCESS: %n feature(s) added.", "added features count", mAddedFeatures.size() );
+          mCommitErrors << tr( "SUCCESS: %n feature(s) added.", "added features count", features.size() );
 
-          emit committedFeaturesAdded( id(), mAddedFeatures );
+          emit committedFeaturesAdded( id(), features );
 
           // notify everyone that the features with temporary ids were updated with permanent ids
-          for ( int i = 0; i < mAddedFeatures.size(); i++ )
+          for ( int i = 0; i < features.size(); i++ )
           {
-            if ( mAddedFeatures[i].id() != ids[i] )
+            if ( features[i].id() != ids[i] )
             {
               emit featureDeleted( ids[i] );
-              emit featureAdded( mAddedFeatures[i].id() );
+              emit featureAdded( features[i].id() );
             }
           }
 
@@ -3811,7 +3699,7 @@ bool QgsVectorLayer::commitChanges()
         }
         else
         {
-          mCommitErrors << tr( "ERROR: %n feature(s) not added.", "not added features count", mAddedFeatures.size() );
+          mCommitErrors << tr( "ERROR: %n feature(s) not added.", "not added features count", features.size() );
           success = false;
         }
       }
@@ -4121,7 +4009,6 @@ int QgsVectorLayer::snapWithContext( const QgsPoint& startPoint, double snapping
     return 1;
   }
 
-  QList<QgsFeature> featureList;
   QgsRectangle searchRect( startPoint.x() - snappingTolerance, startPoint.y() - snappingTolerance,
                            startPoint.x() + snappingTolerance, startPoint.y() + snappingTolerance );
   double sqrSnappingTolerance = snappingTolerance * snappingTolerance;
@@ -4131,24 +4018,25 @@ int QgsVectorLayer::snapWithContext( const QgsPoint& startPoint, double snapping
 
   if ( mCachedGeometriesRect.contains( searchRect ) )
   {
-    QgsGeometryMap::iterator it = mCachedGeometries.begin();
-    for ( ; it != mCachedGeometries.end() ; ++it )
+    if ( !mSnappingIndex )
     {
-      QgsGeometry* g = &( it.value() );
-      if ( g->boundingBox().intersects( searchRect ) )
+      mSnappingIndex = new QgsSnappingIndex( this );
+      QgsGeometryMap::iterator it = mCachedGeometries.begin();
+      for ( ; it != mCachedGeometries.end() ; ++it )
       {
-        snapToGeometry( startPoint, it.key(), g, sqrSnappingTolerance, snappingResults, snap_to );
-        ++n;
+        mSnappingIndex->addGeometry( it.key(), &( it.value() ) );
       }
     }
+    n = mSnappingIndex->snap( startPoint, snappingTolerance, snappingResults, snap_to );
   }
   else
   {
     // snapping outside cached area
-
-    select( QgsAttributeList(), searchRect, true, true );
-
-    while ( nextFeature( f ) )
+    // use an own iterator, the caller might be in the middle of a select()
+    QgsFeatureIterator fit = getFeatures( QgsFeatureRequest( searchRect )
+                                          .setFlags( QgsFeatureRequest::ExactIntersect )
+                                          .setSubsetOfAttributes( QgsAttributeList() ) );
+    while ( fit.nextFeature( f ) )
     {
       snapToGeometry( startPoint, f.id(), f.geometry(), sqrSnappingTolerance, snappingResults, snap_to );
       ++n;
@@ -4668,6 +4556,12 @@ void QgsVectorLayer::editGeometryChange( QgsFeatureId featureId, QgsGeometry& ge
     mActiveCommand->storeGeometryChange( featureId, mChangedGeometries[ featureId ], geometry );
   }
   mChangedGeometries[ featureId ] = geometry;
+
+  if ( mSnappingIndex )
+  {
+    mSnappingIndex->addGeometry( featureId, &geometry );
+  }
+
   emit geometryChanged( featureId, geometry );
 }
 
@@ -4678,7 +4572,12 @@ void QgsVectorLayer::editFeatureAdd( QgsFeature& feature )
   {
     mActiveCommand->storeFeatureAdd( feature );
   }
-  mAddedFeatures.append( feature );
+  mAddedFeatures.insert( feature.id(), feature );
+
+  if ( mSnappingIndex )
+  {
+    mSnappingIndex->addGeometry( feature.id(), feature.geometry() );
+  }
 }
 
 void QgsVectorLayer::editFeatureDelete( QgsFeatureId featureId )
@@ -4688,6 +4587,11 @@ void QgsVectorLayer::editFeatureDelete( QgsFeatureId featureId )
     mActiveCommand->storeFeatureDelete( featureId );
   }
   mDeletedFeatureIds.insert( featureId );
+
+  if ( mSnappingIndex )
+  {
+    mSnappingIndex->removeGeometry( featureId );
+  }
 }
 
 void QgsVectorLayer::editAttributeChange( QgsFeatureId featureId, int field, QVariant value )
@@ -4699,14 +4603,11 @@ void QgsVectorLayer::editAttributeChange( QgsFeatureId featureId, int field, QVa
     if ( featureId < 0 )
     {
       // work with added feature
-      for ( int i = 0; i < mAddedFeatures.size(); i++ )
+      QgsFeatureMap::const_iterator it = mAddedFeatures.constFind( featureId );
+      if ( it != mAddedFeatures.constEnd() && it->attributeMap().contains( field ) )
       {
-        if ( mAddedFeatures[i].id() == featureId && mAddedFeatures[i].attributeMap().contains( field ) )
-        {
-          original = mAddedFeatures[i].attributeMap()[field];
-          isFirstChange = false;
-          break;
-        }
+        original = it->attributeMap()[field];
+        isFirstChange = false;
       }
     }
     else
@@ -4733,13 +4634,10 @@ void QgsVectorLayer::editAttributeChange( QgsFeatureId featureId, int field, QVa
   else
   {
     // updated added feature
-    for ( int i = 0; i < mAddedFeatures.size(); i++ )
+    QgsFeatureMap::iterator it = mAddedFeatures.find( featureId );
+    if ( it != mAddedFeatures.end() )
     {
-      if ( mAddedFeatures[i].id() == featureId )
-      {
-        mAddedFeatures[i].changeAttribute( field, value );
-        break;
-      }
+      it->changeAttribute( field, value );
     }
   }
 }
@@ -4775,6 +4673,8 @@ void QgsVectorLayer::destroyEditCommand()
 
 void QgsVectorLayer::redoEditCommand( QgsUndoCommand* cmd )
 {
+  invalidateSnappingIndex();
+
   QMap<QgsFeatureId, QgsUndoCommand::GeometryChangeEntry>& geometryChange = cmd->mGeometryChange;
   QgsFeatureIds& deletedFeatureIdChange = cmd->mDeletedFeatureIdChange;
   QgsFeatureList& addedFeatures = cmd->mAddedFeatures;
@@ -4816,7 +4716,7 @@ void QgsVectorLayer::redoEditCommand( QgsUndoCommand* cmd )
   QgsFeatureList::iterator addIt = addedFeatures.begin();
   for ( ; addIt != addedFeatures.end(); ++addIt )
   {
-    mAddedFeatures.append( *addIt );
+    mAddedFeatures.insert( addIt->id(), *addIt );
     emit featureAdded( addIt->id() );
   }
 
@@ -4846,13 +4746,10 @@ void QgsVectorLayer::redoEditCommand( QgsUndoCommand* cmd )
       else
       {
         // added feature
-        for ( int i = 0; i < mAddedFeatures.size(); i++ )
+        QgsFeatureMap::iterator it = mAddedFeatures.find( fid );
+        if ( it != mAddedFeatures.end() )
         {
-          if ( mAddedFeatures[i].id() == fid )
-          {
-            mAddedFeatures[i].changeAttribute( attrChIt.key(), attrChIt.value().target );
-            break;
-          }
+          it->changeAttribute( attrChIt.key(), attrChIt.value().target );
         }
       }
       emit attributeValueChanged( fid, attrChIt.key(), attrChIt.value().target );
@@ -4886,6 +4783,8 @@ void QgsVectorLayer::redoEditCommand( QgsUndoCommand* cmd )
 
 void QgsVectorLayer::undoEditCommand( QgsUndoCommand* cmd )
 {
+  invalidateSnappingIndex();
+
   QMap<QgsFeatureId, QgsUndoCommand::GeometryChangeEntry>& geometryChange = cmd->mGeometryChange;
   QgsFeatureIds& deletedFeatureIdChange = cmd->mDeletedFeatureIdChange;
   QgsFeatureList& addedFeatures = cmd->mAddedFeatures;
@@ -4946,15 +4845,9 @@ void QgsVectorLayer::undoEditCommand( QgsUndoCommand* cmd )
   QgsFeatureList::iterator addIt = addedFeatures.begin();
   for ( ; addIt != addedFeatures.end(); ++addIt )
   {
-    QgsFeatureList::iterator addedIt = mAddedFeatures.begin();
-    for ( ; addedIt != mAddedFeatures.end(); ++addedIt )
+    if ( mAddedFeatures.remove( addIt->id() ) > 0 )
     {
-      if ( addedIt->id() == addIt->id() )
-      {
-        mAddedFeatures.erase( addedIt );
-        emit featureDeleted( addIt->id() );
-        break; // feature was found so move to next one
-      }
+      emit featureDeleted( addIt->id() );
     }
   }
 
@@ -4982,13 +4875,10 @@ void QgsVectorLayer::undoEditCommand( QgsUndoCommand* cmd )
       else
       {
         // added feature TODO:
-        for ( int i = 0; i < mAddedFeatures.size(); i++ )
+        QgsFeatureMap::iterator it = mAddedFeatures.find( fid );
+        if ( it != mAddedFeatures.end() )
         {
-          if ( mAddedFeatures[i].id() == fid )
-          {
-            mAddedFeatures[i].changeAttribute( attrChIt.key(), attrChIt.value().original );
-            break;
-          }
+          it->changeAttribute( attrChIt.key(), attrChIt.value().original );
         }
       }
       QVariant original = attrChIt.value().original;
@@ -5059,6 +4949,21 @@ const QList< QgsVectorJoinInfo >& QgsVectorLayer::vectorJoins() const
   return mJoinBuffer->vectorJoins();
 }
 
+int QgsVectorLayer::joinFetchCount() const
+{
+  return mJoinBuffer->fetchCount();
+}
+
+int QgsVectorLayer::joinCacheHits() const
+{
+  return mJoinBuffer->cacheHits();
+}
+
+void QgsVectorLayer::resetJoinStatistics()
+{
+  mJoinBuffer->resetStatistics();
+}
+
 void QgsVectorLayer::updateFieldMap()
 {
   //first backup mAddedAttributes
@@ -5105,7 +5010,7 @@ void QgsVectorLayer::updateFieldMap()
     }
 
     //go through added features and adapt attribute maps
-    QgsFeatureList::iterator featureIt = mAddedFeatures.begin();
+    QgsFeatureMap::iterator featureIt = mAddedFeatures.begin();
     for ( ; featureIt != mAddedFeatures.end(); ++featureIt )
     {
       QgsAttributeMap attMap = featureIt->attributeMap();
@@ -26,6 +26,7 @@
 #include "qgis.h"
 #include "qgsmaplayer.h"
 #include "qgsfeature.h"
+#include "qgsfeatureiterator.h"
 #include "qgssnapper.h"
 #include "qgsfield.h"
 
@@ -44,10 +45,12 @@ class QgsUndoCommand;
 class QgsVectorDataProvider;
 class QgsVectorOverlay;
 class QgsSingleSymbolRendererV2;
+class QgsSnappingIndex;
 class QgsRectangle;
 class QgsVectorLayerJoinBuffer;
 class QgsFeatureRendererV2;
 class QgsDiagramRendererV2;
+class QgsVectorLayerFeatureIterator;
 struct QgsDiagramLayerSettings;
 
 typedef QList<int> QgsAttributeList;
@@ -178,6 +181,19 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     /** @note added in 1.7 */
     const QList< QgsVectorJoinInfo >& vectorJoins() const;
 
+    /** Number of requests sent to the join layers of joins without memory cache
+      since the last call to resetJoinStatistics()
+      @note added in 1.9 */
+    int joinFetchCount() const;
+
+    /** Number of joined rows taken from the join row cache (joins without memory cache)
+      since the last call to resetJoinStatistics()
+      @note added in 1.9 */
+    int joinCacheHits() const;
+
+    /** @note added in 1.9 */
+    void resetJoinStatistics();
+
     /** Get the label object associated with this layer */
     QgsLabel *label();
 
@@ -322,6 +338,15 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
      */
     virtual QString subsetString();
 
+    /**
+     * Query the layer for features specified in request. The features of the
+     * provider are merged with the edit buffer and joined attributes.
+     * Each returned iterator keeps its own position, so several readers
+     * may iterate over the layer at the same time.
+     * @note added in 1.9
+     */
+    QgsFeatureIterator getFeatures( const QgsFeatureRequest& request = QgsFeatureRequest() );
+
     /**
      * Select features with or without attributes in a given window.
      * @param fetchAttributes indizes of attributes to fetch
@@ -733,6 +758,10 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     void attributeValueChanged( QgsFeatureId fid, int idx, const QVariant & );
     void geometryChanged( QgsFeatureId fid, QgsGeometry &geom ); // added in 1.9
 
+    /** This signal is emitted when setSubsetString() changed the subset of the layer
+      \note added in 1.9 */
+    void subsetStringChanged();
+
     /** Signals emitted after committing changes
       \note added in v1.6 */
     void committedAttributesDeleted( const QString& layerId, const QgsAttributeIds& deletedAttributeIds );
@@ -781,9 +810,19 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     /** Goes through all features and finds a free id (e.g. to give it temporarily to a not-commited feature) */
     QgsFeatureId findFreeId();
 
-    /**Deletes the geometries in mCachedGeometries*/
+    /**Deletes the geometries in mCachedGeometries and the snapping index*/
     void deleteCachedGeometries();
 
+    /**Prepares the geometry cache to be filled for the given extent.
+     The snapping index is kept if the extent did not change
+     @note added in 1.9*/
+    void refreshCachedGeometries( const QgsRectangle& extent );
+
+    /**Drops the snapping index after geometries changed without going
+     through editGeometryChange / editFeatureAdd / editFeatureDelete
+     @note added in 1.9*/
+    void invalidateSnappingIndex();
+
     /**Snaps to a geometry and adds the result to the multimap if it is within the snapping result
      @param startPoint start point of the snap
      @param featureId id of feature
@@ -809,8 +848,20 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     /**Reads vertex marker size from settings*/
     static int currentVertexMarkerSize();
 
-    /**Update feature with uncommited attribute updates and joined attributes*/
-    void updateFeatureAttributes( QgsFeature &f, bool all = false );
+    /**Update feature with uncommited attribute updates and all joined attributes*/
+    void updateFeatureAttributes( QgsFeature &f );
+
+    /**Update feature with uncommited attribute updates and joined attributes
+      @param f the feature to update
+      @param fetchAttributes attributes requested by the reader
+      @param fetchJoinInfos joins of the requested attributes
+      @note added in 1.9 */
+    void updateFeatureAttributes( QgsFeature &f, const QgsAttributeList& fetchAttributes,
+                                  const QMap<QgsVectorLayer*, QgsFetchJoinInfo>& fetchJoinInfos );
+
+    /**Apply uncommited attribute updates to a feature
+      @param all true if all attributes are wanted, otherwise only fetchAttributes are added */
+    void updateChangedAttributes( QgsFeature &f, const QgsAttributeList& fetchAttributes, bool all );
 
     /**Adds joined attributes to a feature
       @param f the feature to add the attributes
@@ -883,6 +934,11 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     /** extent for which there are cached geometries */
     QgsRectangle mCachedGeometriesRect;
 
+    /** vertex and segment index of the cached geometries used for snapping.
+     * Built on demand, kept up to date by the editing methods and dropped
+     * together with the cached geometries */
+    QgsSnappingIndex* mSnappingIndex;
+
     /** Set holding the feature IDs that are activated.  Note that if a feature
         subsequently gets deleted (i.e. by its addition to mDeletedFeatureIds),
         it always needs to be removed from mSelectedFeatureIds as well.
@@ -895,10 +951,11 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
      */
     QgsFeatureIds mDeletedFeatureIds;
 
-    /** New features which are not commited.  Note a feature can be added and then changed,
-        therefore the details here can be overridden by mChangedAttributeValues and mChangedGeometries.
+    /** New features which are not commited, by their (negative) temporary id.  Note a feature
+        can be added and then changed, therefore the details here can be overridden by
+        mChangedAttributeValues and mChangedGeometries.
      */
-    QgsFeatureList mAddedFeatures;
+    QgsFeatureMap mAddedFeatures;
 
     /** Changed attributes values which are not commited */
     QgsChangedAttributesMap mChangedAttributeValues;
@@ -965,15 +1022,8 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     //annotation form for this layer
     QString mAnnotationForm;
 
-    bool mFetching;
-    QgsRectangle mFetchRect;
-    QgsAttributeList mFetchAttributes;
-    QgsAttributeList mFetchProvAttributes;
-    bool mFetchGeometry;
-
-    QSet<QgsFeatureId> mFetchConsidered;
-    QgsGeometryMap::iterator mFetchChangedGeomIt;
-    QgsFeatureList::iterator mFetchAddedFeaturesIt;
+    //! iterator behind select() / nextFeature()
+    QgsFeatureIterator mSelectIterator;
 
     //stores information about joined layers
     QgsVectorLayerJoinBuffer* mJoinBuffer;
@@ -983,6 +1033,8 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
 
     //stores infos about diagram placement (placement type, priority, position distance)
     QgsDiagramLayerSettings *mDiagramLayerSettings;
+
+    friend class QgsVectorLayerFeatureIterator;
 };
 
 #endif
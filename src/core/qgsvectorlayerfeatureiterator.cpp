@@ -0,0 +1,269 @@
+/***************************************************************************
+    qgsvectorlayerfeatureiterator.cpp
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsvectorlayerfeatureiterator.h"
+
+#include "qgsgeometry.h"
+#include "qgslogger.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayerjoinbuffer.h"
+
+QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayer* layer, const QgsFeatureRequest& request )
+    : QgsAbstractFeatureIterator( request )
+    , L( layer )
+    , mPrefetchJoins( false )
+    , mJoinBlockPos( 0 )
+{
+  QgsVectorDataProvider* provider = L->dataProvider();
+
+  mFetchConsidered = L->mDeletedFeatureIds;
+  mFetchAttributes = mRequest.attributesToFetch( L->pendingAllAttributesList() );
+
+  if ( L->mEditable )
+  {
+    mFetchAddedFeaturesIt = L->mAddedFeatures.begin();
+    mFetchChangedGeomIt = L->mChangedGeometries.begin();
+  }
+
+  //look in the normal features of the provider
+  if ( mFetchAttributes.size() > 0 && ( L->mEditable || L->mJoinBuffer->containsJoins() ) )
+  {
+    QgsAttributeList joinFields;
+
+    int maxProviderIndex = 0;
+    QgsVectorLayerJoinBuffer::maximumIndex( provider->fields(), maxProviderIndex );
+
+    L->mJoinBuffer->prepareFetchJoins( mFetchAttributes, joinFields, maxProviderIndex, mFetchJoinInfos );
+    mPrefetchJoins = QgsVectorLayerJoinBuffer::containsQueriedJoins( mFetchJoinInfos );
+    QgsAttributeList::const_iterator joinFieldIt = joinFields.constBegin();
+    for ( ; joinFieldIt != joinFields.constEnd(); ++joinFieldIt )
+    {
+      if ( !mFetchAttributes.contains( *joinFieldIt ) )
+      {
+        mFetchAttributes.append( *joinFieldIt );
+      }
+    }
+
+    //detect which fields are from the provider
+    for ( QgsAttributeList::const_iterator it = mFetchAttributes.constBegin(); it != mFetchAttributes.constEnd(); it++ )
+    {
+      if ( provider->fields().contains( *it ) )
+      {
+        mFetchProvAttributes << *it;
+      }
+    }
+  }
+  else
+  {
+    mFetchProvAttributes = mFetchAttributes;
+  }
+
+  QgsFeatureRequest providerRequest( mRequest );
+  providerRequest.setSubsetOfAttributes( mFetchProvAttributes );
+  mProviderIterator = provider->getFeatures( providerRequest );
+}
+
+QgsVectorLayerFeatureIterator::~QgsVectorLayerFeatureIterator()
+{
+  close();
+}
+
+bool QgsVectorLayerFeatureIterator::nextFeature( QgsFeature& f )
+{
+  f.setValid( false );
+
+  if ( mClosed )
+    return false;
+
+  if ( L->mEditable )
+  {
+    if ( !mRequest.filterRect().isEmpty() && fetchNextChangedGeomFeature( f ) )
+      return true;
+
+    // no more changed geometries
+
+    if ( fetchNextAddedFeature( f ) )
+      return true;
+
+    // no more added features
+  }
+
+  while ( fetchNextProviderFeature( f ) )
+  {
+    if ( mFetchConsidered.contains( f.id() ) )
+    {
+      continue;
+    }
+    if ( mFetchAttributes.size() > 0 )
+    {
+      L->updateFeatureAttributes( f, mFetchAttributes, mFetchJoinInfos ); //check joined attributes / changed attributes
+    }
+    return true;
+  }
+
+  return false;
+}
+
+bool QgsVectorLayerFeatureIterator::fetchNextProviderFeature( QgsFeature& f )
+{
+  if ( !mPrefetchJoins )
+    return mProviderIterator.nextFeature( f );
+
+  if ( mJoinBlockPos >= mJoinBlock.size() )
+  {
+    // read a block of features, so that the join layers are queried once for all of them
+    mJoinBlock.clear();
+    mJoinBlockPos = 0;
+
+    QgsFeature fet;
+    while ( mJoinBlock.size() < 1000 && mProviderIterator.nextFeature( fet ) )
+    {
+      mJoinBlock << fet;
+    }
+    if ( mJoinBlock.isEmpty() )
+      return false;
+
+    L->mJoinBuffer->prefetchJoinedAttributes( mJoinBlock, mFetchJoinInfos );
+  }
+
+  f = mJoinBlock.at( mJoinBlockPos++ );
+  return true;
+}
+
+bool QgsVectorLayerFeatureIterator::fetchNextChangedGeomFeature( QgsFeature& f )
+{
+  const QgsRectangle& rect = mRequest.filterRect();
+
+  // check if changed geometries are in rectangle
+  for ( ; mFetchChangedGeomIt != L->mChangedGeometries.end(); mFetchChangedGeomIt++ )
+  {
+    QgsFeatureId fid = mFetchChangedGeomIt.key();
+
+    if ( mFetchConsidered.contains( fid ) )
+      // skip deleted features
+      continue;
+
+    mFetchConsidered << fid;
+
+    if ( !mFetchChangedGeomIt->intersects( rect ) )
+      // skip changed geometries not in rectangle and don't check again
+      continue;
+
+    f.setFeatureId( fid );
+    f.setValid( true );
+
+    if ( mRequest.fetchGeometry() )
+      f.setGeometry( mFetchChangedGeomIt.value() );
+
+    if ( mFetchAttributes.size() > 0 )
+    {
+      if ( fid < 0 )
+      {
+        // fid<0 => in mAddedFeatures
+        QgsFeatureMap::const_iterator it = L->mAddedFeatures.constFind( fid );
+        if ( it != L->mAddedFeatures.constEnd() )
+        {
+          f.copyAttributes( *it );
+          L->updateFeatureAttributes( f, mFetchAttributes, mFetchJoinInfos );
+        }
+        else
+        {
+          QgsDebugMsg( QString( "No attributes for the added feature %1 found" ).arg( f.id() ) );
+        }
+      }
+      else
+      {
+        // retrieve attributes from provider
+        QgsFeature tmp;
+        L->dataProvider()->featureAtId( fid, tmp, false, mFetchProvAttributes );
+        L->updateFeatureAttributes( tmp, mFetchAttributes, mFetchJoinInfos );
+        f.copyAttributes( tmp );
+      }
+    }
+
+    // return complete feature
+    mFetchChangedGeomIt++;
+    return true;
+  }
+
+  return false;
+}
+
+bool QgsVectorLayerFeatureIterator::fetchNextAddedFeature( QgsFeature& f )
+{
+  const QgsRectangle& rect = mRequest.filterRect();
+
+  for ( ; mFetchAddedFeaturesIt != L->mAddedFeatures.end(); mFetchAddedFeaturesIt++ )
+  {
+    QgsFeatureId fid = mFetchAddedFeaturesIt->id();
+
+    if ( mFetchConsidered.contains( fid ) )
+      // must have changed geometry outside rectangle
+      continue;
+
+    if ( !rect.isEmpty() &&
+         mFetchAddedFeaturesIt->geometry() &&
+         !mFetchAddedFeaturesIt->geometry()->intersects( rect ) )
+      // skip added features not in rectangle
+      continue;
+
+    f.setFeatureId( fid );
+    f.setValid( true );
+
+    if ( mRequest.fetchGeometry() )
+      f.setGeometry( *mFetchAddedFeaturesIt->geometry() );
+
+    if ( mFetchAttributes.size() > 0 )
+    {
+      f.copyAttributes( *mFetchAddedFeaturesIt );
+      L->updateFeatureAttributes( f, mFetchAttributes, mFetchJoinInfos );
+    }
+
+    mFetchAddedFeaturesIt++;
+    return true;
+  }
+
+  return false;
+}
+
+bool QgsVectorLayerFeatureIterator::rewind()
+{
+  if ( mClosed )
+    return false;
+
+  mFetchConsidered = L->mDeletedFeatureIds;
+
+  if ( L->mEditable )
+  {
+    mFetchAddedFeaturesIt = L->mAddedFeatures.begin();
+    mFetchChangedGeomIt = L->mChangedGeometries.begin();
+  }
+
+  mJoinBlock.clear();
+  mJoinBlockPos = 0;
+
+  return mProviderIterator.rewind();
+}
+
+bool QgsVectorLayerFeatureIterator::close()
+{
+  if ( mClosed )
+    return false;
+
+  mProviderIterator.close();
+  mJoinBlock.clear();
+  mJoinBlockPos = 0;
+
+  mClosed = true;
+  return true;
+}
@@ -0,0 +1,79 @@
+/***************************************************************************
+    qgsvectorlayerfeatureiterator.h
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSVECTORLAYERFEATUREITERATOR_H
+#define QGSVECTORLAYERFEATUREITERATOR_H
+
+#include "qgsfeatureiterator.h"
+#include "qgsvectorlayer.h"
+
+#include <QMap>
+#include <QSet>
+
+/** \ingroup core
+ * Iterator over the features of a vector layer. Features of the data provider
+ * are merged with the uncommited changes of the edit buffer and with joined attributes.
+ * Every iterator keeps its own position in the edit buffer and its own provider iterator.
+ * @note added in 1.9
+ */
+class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureIterator
+{
+  public:
+    QgsVectorLayerFeatureIterator( QgsVectorLayer* layer, const QgsFeatureRequest& request );
+
+    ~QgsVectorLayerFeatureIterator();
+
+    //! fetch next feature, return true on success
+    virtual bool nextFeature( QgsFeature& feature );
+
+    //! reset the iterator to the starting position
+    virtual bool rewind();
+
+    //! end of iterating: free the resources / lock
+    virtual bool close();
+
+  protected:
+    //! fetch the next feature with changed geometry within the filter rectangle
+    bool fetchNextChangedGeomFeature( QgsFeature& f );
+
+    //! fetch the next added feature within the filter rectangle
+    bool fetchNextAddedFeature( QgsFeature& f );
+
+    //! fetch the next feature of the data provider, reading ahead a block of
+    //! features if the joined attributes are queried from join layers
+    bool fetchNextProviderFeature( QgsFeature& f );
+
+    QgsVectorLayer* L;
+
+    //! iterator over the features of the data provider
+    QgsFeatureIterator mProviderIterator;
+
+    //! layer attributes to fetch (including the target fields of joins)
+    QgsAttributeList mFetchAttributes;
+    //! attributes to fetch from the provider
+    QgsAttributeList mFetchProvAttributes;
+    //! joins of the fetched attributes
+    QMap<QgsVectorLayer*, QgsFetchJoinInfo> mFetchJoinInfos;
+    //! whether the joined attributes of blocks of provider features are fetched at once
+    bool mPrefetchJoins;
+    //! provider features read ahead and position of the next one to return
+    QgsFeatureList mJoinBlock;
+    int mJoinBlockPos;
+
+    //! features that have already been returned (or are deleted)
+    QSet<QgsFeatureId> mFetchConsidered;
+    QgsGeometryMap::iterator mFetchChangedGeomIt;
+    QgsFeatureMap::iterator mFetchAddedFeaturesIt;
+};
+
+#endif // QGSVECTORLAYERFEATUREITERATOR_H
@@ -25,7 +25,10 @@
 #include "qgsvectorlayerimport.h"
 #include "qgsproviderregistry.h"
 
-#define FEATURE_BUFFER_SIZE 200
+#include <QProgressDialog>
+
+// features handed to the provider at once; providers with a bulk path load a block in one go
+#define FEATURE_BUFFER_SIZE 1000
 
 typedef QgsVectorLayerImport::ImportError createEmptyLayer_t(
   const QString &uri,
@@ -177,7 +180,8 @@ QgsVectorLayerImport::importLayer( QgsVectorLayer* layer,
                                    bool onlySelected,
                                    QString *errorMessage,
                                    bool skipAttributeCreation,
-                                   QMap<QString, QVariant> *options )
+                                   QMap<QString, QVariant> *options,
+                                   QProgressDialog *progress )
 {
   const QgsCoordinateReferenceSystem* outputCRS;
   QgsCoordinateTransform* ct = 0;
@@ -254,12 +258,29 @@ QgsVectorLayerImport::importLayer( QgsVectorLayer* layer,
     *errorMessage = QObject::tr( "Feature write errors:" );
   }
 
+  if ( progress )
+  {
+    progress->setRange( 0, onlySelected ? ids.size() : layer->featureCount() );
+  }
+
+  bool cancelled = false;
+
   // write all features
   while ( layer->nextFeature( fet ) )
   {
     if ( onlySelected && !ids.contains( fet.id() ) )
       continue;
 
+    if ( progress && n % 100 == 0 )
+    {
+      progress->setValue( n );
+      if ( progress->wasCanceled() )
+      {
+        cancelled = true;
+        break;
+      }
+    }
+
     if ( shallTransform )
     {
       try
@@ -325,6 +346,20 @@ QgsVectorLayerImport::importLayer( QgsVectorLayer* layer,
     delete ct;
   }
 
+  if ( progress )
+  {
+    progress->setValue( progress->maximum() );
+  }
+
+  if ( cancelled )
+  {
+    if ( errorMessage )
+    {
+      *errorMessage = QObject::tr( "Import was canceled after %1 features." ).arg( n );
+    }
+    return ErrUserCancelled;
+  }
+
   if ( errorMessage )
   {
     if ( n > 0 && errors > 0 )
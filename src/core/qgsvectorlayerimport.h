@@ -22,6 +22,8 @@
 #include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
 
+class QProgressDialog;
+
 /** \ingroup core
   * A convenience class for writing vector files to disk.
  There are two possibilities how to use this class:
@@ -48,11 +50,16 @@ class CORE_EXPORT QgsVectorLayerImport
       ErrInvalidLayer,
       ErrInvalidProvider,
       ErrProviderUnsupportedFeature,
-      ErrConnectionFailed
+      ErrConnectionFailed,
+      ErrUserCancelled /*!< added in 1.9 */
     };
 
 
-    /** Write contents of vector layer to a different datasource */
+    /** Write contents of vector layer to a different datasource.
+      The features are handed to the provider in blocks, which providers
+      like PostGIS load in bulk (with COPY) in one transaction per block.
+      @param progress optional dialog that shows the number of written
+      features and allows to cancel the import (added in 1.9) */
     static ImportError importLayer( QgsVectorLayer* layer,
                                     const QString& uri,
                                     const QString& providerKey,
@@ -60,7 +67,8 @@ class CORE_EXPORT QgsVectorLayerImport
                                     bool onlySelected = false,
                                     QString *errorMessage = 0,
                                     bool skipAttributeCreation = false,
-                                    QMap<QString, QVariant> *options = 0
+                                    QMap<QString, QVariant> *options = 0,
+                                    QProgressDialog *progress = 0
                                   );
 
     /** create a empty layer and add fields to it */
@@ -16,12 +16,20 @@
  ***************************************************************************/
 
 #include "qgsvectorlayerjoinbuffer.h"
+#include "qgsexpression.h"
+#include "qgslogger.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsvectordataprovider.h"
 
 #include <QDomElement>
+#include <QSet>
+#include <QStringList>
 
 QgsVectorLayerJoinBuffer::QgsVectorLayerJoinBuffer()
+    : mJoinRowCache( 10000 )
+    , mFetchCount( 0 )
+    , mCacheHits( 0 )
+    , mCacheMisses( 0 )
 {
 }
 
@@ -42,6 +50,8 @@ void QgsVectorLayerJoinBuffer::addJoin( QgsVectorJoinInfo joinInfo )
 
 void QgsVectorLayerJoinBuffer::removeJoin( const QString& joinLayerId )
 {
+  clearJoinRowCache( joinLayerId );
+
   for ( int i = 0; i < mVectorJoins.size(); ++i )
   {
     if ( mVectorJoins.at( i ).joinLayerId == joinLayerId )
@@ -52,6 +62,7 @@ void QgsVectorLayerJoinBuffer::removeJoin( const QString& joinLayerId )
       if ( joinLayer )
       {
         mFetchJoinInfos.remove( joinLayer );
+        disconnect( joinLayer, 0, this, 0 );
       }
     }
   }
@@ -69,9 +80,9 @@ void QgsVectorLayerJoinBuffer::cacheJoinLayer( QgsVectorJoinInfo& joinInfo )
   if ( cacheLayer )
   {
     joinInfo.cachedAttributes.clear();
-    cacheLayer->select( cacheLayer->pendingAllAttributesList(), QgsRectangle(), false, false );
+    QgsFeatureIterator fi = cacheLayer->getFeatures( QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ) );
     QgsFeature f;
-    while ( cacheLayer->nextFeature( f ) )
+    while ( fi.nextFeature( f ) )
     {
       const QgsAttributeMap& map = f.attributeMap();
       joinInfo.cachedAttributes.insert( map.value( joinInfo.joinField ).toString(), map );
@@ -122,7 +133,13 @@ void QgsVectorLayerJoinBuffer::createJoinCaches()
 void QgsVectorLayerJoinBuffer::select( const QgsAttributeList& fetchAttributes,
                                        QgsAttributeList& sourceJoinFields, int maxProviderIndex )
 {
-  mFetchJoinInfos.clear();
+  prepareFetchJoins( fetchAttributes, sourceJoinFields, maxProviderIndex, mFetchJoinInfos );
+}
+
+void QgsVectorLayerJoinBuffer::prepareFetchJoins( const QgsAttributeList& fetchAttributes, QgsAttributeList& sourceJoinFields,
+    int maxProviderIndex, QMap<QgsVectorLayer*, QgsFetchJoinInfo>& fetchJoinInfos ) const
+{
+  fetchJoinInfos.clear();
   sourceJoinFields.clear();
 
   QgsAttributeList::const_iterator attIt = fetchAttributes.constBegin();
@@ -135,9 +152,9 @@ void QgsVectorLayerJoinBuffer::select( const QgsAttributeList& fetchAttributes,
       QgsVectorLayer* joinLayer = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( joinInfo->joinLayerId ) );
       if ( joinLayer )
       {
-        mFetchJoinInfos[ joinLayer ].joinInfo = joinInfo;
-        mFetchJoinInfos[ joinLayer].attributes.push_back( *attIt - indexOffset ); //store provider index
-        mFetchJoinInfos[ joinLayer ].indexOffset = indexOffset;
+        fetchJoinInfos[ joinLayer ].joinInfo = joinInfo;
+        fetchJoinInfos[ joinLayer].attributes.push_back( *attIt - indexOffset ); //store provider index
+        fetchJoinInfos[ joinLayer ].indexOffset = indexOffset;
         //for joined fields, we always need to request the targetField from the provider too
         if ( !fetchAttributes.contains( joinInfo->targetField ) )
         {
@@ -170,13 +187,13 @@ void QgsVectorLayerJoinBuffer::updateFeatureAttributes( QgsFeature &f, int maxPr
         continue;
       }
 
-      QVariant targetFieldValue = f.attributeMap().value( joinIt->targetField );
+      QVariant targetFieldValue = f.attribute( joinIt->targetField );
       if ( !targetFieldValue.isValid() )
       {
         continue;
       }
 
-      addJoinedFeatureAttributes( f, *joinIt, joinFieldName, targetFieldValue, joinLayer->pendingAllAttributesList(), index );
+      addJoinedFeatureAttributes( f, *joinIt, targetFieldValue, joinLayer->pendingAllAttributesList(), index );
 
       maximumIndex( joinLayer->pendingFields(), currentMaxIndex );
       index += ( currentMaxIndex + 1 );
@@ -184,33 +201,38 @@ void QgsVectorLayerJoinBuffer::updateFeatureAttributes( QgsFeature &f, int maxPr
   }
   else
   {
-    QMap<QgsVectorLayer*, QgsFetchJoinInfo>::const_iterator joinIt = mFetchJoinInfos.constBegin();
-    for ( ; joinIt != mFetchJoinInfos.constEnd(); ++joinIt )
-    {
-      QgsVectorLayer* joinLayer = joinIt.key();
-      if ( !joinLayer )
-      {
-        continue;
-      }
+    updateFeatureAttributes( f, mFetchJoinInfos );
+  }
+}
 
-      QString joinFieldName = joinLayer->pendingFields().value( joinIt.value().joinInfo->joinField ).name();
-      if ( joinFieldName.isEmpty() )
-      {
-        continue;
-      }
+void QgsVectorLayerJoinBuffer::updateFeatureAttributes( QgsFeature &f, const QMap<QgsVectorLayer*, QgsFetchJoinInfo>& fetchJoinInfos )
+{
+  QMap<QgsVectorLayer*, QgsFetchJoinInfo>::const_iterator joinIt = fetchJoinInfos.constBegin();
+  for ( ; joinIt != fetchJoinInfos.constEnd(); ++joinIt )
+  {
+    QgsVectorLayer* joinLayer = joinIt.key();
+    if ( !joinLayer )
+    {
+      continue;
+    }
 
-      QVariant targetFieldValue = f.attributeMap().value( joinIt->joinInfo->targetField );
-      if ( !targetFieldValue.isValid() )
-      {
-        continue;
-      }
+    QString joinFieldName = joinLayer->pendingFields().value( joinIt.value().joinInfo->joinField ).name();
+    if ( joinFieldName.isEmpty() )
+    {
+      continue;
+    }
 
-      addJoinedFeatureAttributes( f, *( joinIt.value().joinInfo ), joinFieldName, targetFieldValue, joinIt.value().attributes, joinIt.value().indexOffset );
+    QVariant targetFieldValue = f.attribute( joinIt->joinInfo->targetField );
+    if ( !targetFieldValue.isValid() )
+    {
+      continue;
     }
+
+    addJoinedFeatureAttributes( f, *( joinIt.value().joinInfo ), targetFieldValue, joinIt.value().attributes, joinIt.value().indexOffset );
   }
 }
 
-void QgsVectorLayerJoinBuffer::addJoinedFeatureAttributes( QgsFeature& f, const QgsVectorJoinInfo& joinInfo, const QString& joinFieldName,
+void QgsVectorLayerJoinBuffer::addJoinedFeatureAttributes( QgsFeature& f, const QgsVectorJoinInfo& joinInfo,
     const QVariant& joinValue, const QgsAttributeList& attributes, int attributeIndexOffset )
 {
   const QHash< QString, QgsAttributeMap>& memoryCache = joinInfo.cachedAttributes;
@@ -237,7 +259,7 @@ void QgsVectorLayerJoinBuffer::addJoinedFeatureAttributes( QgsFeature& f, const
       }
     }
   }
-  else //work with subset string
+  else //query the join layer, unless the row is in the join row cache
   {
     QgsVectorLayer* joinLayer = dynamic_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( joinInfo.joinLayerId ) );
     if ( !joinLayer )
@@ -245,41 +267,223 @@ void QgsVectorLayerJoinBuffer::addJoinedFeatureAttributes( QgsFeature& f, const
       return;
     }
 
-    //no memory cache, query the joined values by setting substring
-    QString subsetString = joinLayer->dataProvider()->subsetString(); //provider might already have a subset string
-    QString bkSubsetString = subsetString;
-    if ( !subsetString.isEmpty() )
+    QString key = joinRowCacheKey( joinInfo, joinValue.toString() );
+    QgsAttributeMap* row = mJoinRowCache.object( key );
+    if ( row )
+    {
+      ++mCacheHits;
+    }
+    else
     {
-      subsetString.append( " AND " );
+      ++mCacheMisses;
+      fetchJoinRows( joinLayer, joinInfo, QList<QVariant>() << joinValue );
+      row = mJoinRowCache.object( key );
     }
 
-    subsetString.append( "\"" + joinFieldName + "\"" + " = " + "\"" + joinValue.toString() + "\"" );
-    joinLayer->dataProvider()->setSubsetString( subsetString, false );
+    bool found = row && !row->isEmpty();
+    QgsAttributeList::const_iterator attIt = attributes.constBegin();
+    for ( ; attIt != attributes.constEnd(); ++attIt )
+    {
+      //skip the join field to avoid double field names (fields often have the same name)
+      if ( *attIt == joinInfo.joinField )
+      {
+        continue;
+      }
 
-    //select (no geometry)
-    joinLayer->select( attributes, QgsRectangle(), false, false );
+      f.addAttribute( *attIt + attributeIndexOffset, found ? row->value( *attIt ) : QVariant() );
+    }
+  }
+}
 
-    //get first feature
-    QgsFeature fet;
-    if ( joinLayer->nextFeature( fet ) )
+void QgsVectorLayerJoinBuffer::prefetchJoinedAttributes( const QgsFeatureList& features, const QMap<QgsVectorLayer*, QgsFetchJoinInfo>& fetchJoinInfos )
+{
+  QMap<QgsVectorLayer*, QgsFetchJoinInfo>::const_iterator joinIt = fetchJoinInfos.constBegin();
+  for ( ; joinIt != fetchJoinInfos.constEnd(); ++joinIt )
+  {
+    const QgsVectorJoinInfo* joinInfo = joinIt.value().joinInfo;
+    if ( !joinIt.key() || !joinInfo->cachedAttributes.isEmpty() )
+    {
+      continue;
+    }
+
+    //collect the join values that are not in the join row cache yet
+    QList<QVariant> joinValues;
+    QSet<QString> keys;
+    QgsFeatureList::const_iterator featureIt = features.constBegin();
+    for ( ; featureIt != features.constEnd(); ++featureIt )
+    {
+      QVariant targetFieldValue = featureIt->attribute( joinInfo->targetField );
+      if ( !targetFieldValue.isValid() )
+      {
+        continue;
+      }
+
+      QString key = joinRowCacheKey( *joinInfo, targetFieldValue.toString() );
+      if ( keys.contains( key ) || mJoinRowCache.object( key ) )
+      {
+        continue;
+      }
+      keys.insert( key );
+      joinValues << targetFieldValue;
+    }
+
+    if ( !joinValues.isEmpty() )
+    {
+      fetchJoinRows( joinIt.key(), *joinInfo, joinValues );
+    }
+  }
+}
+
+bool QgsVectorLayerJoinBuffer::containsQueriedJoins( const QMap<QgsVectorLayer*, QgsFetchJoinInfo>& fetchJoinInfos )
+{
+  QMap<QgsVectorLayer*, QgsFetchJoinInfo>::const_iterator joinIt = fetchJoinInfos.constBegin();
+  for ( ; joinIt != fetchJoinInfos.constEnd(); ++joinIt )
+  {
+    if ( joinIt.value().joinInfo->cachedAttributes.isEmpty() )
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void QgsVectorLayerJoinBuffer::setJoinRowCacheSize( int rows )
+{
+  //a fetched row has to fit into the cache until it is used
+  mJoinRowCache.setMaxCost( qMax( rows, 1 ) );
+}
+
+void QgsVectorLayerJoinBuffer::resetStatistics()
+{
+  mFetchCount = 0;
+  mCacheHits = 0;
+  mCacheMisses = 0;
+}
+
+QString QgsVectorLayerJoinBuffer::joinRowCacheKey( const QgsVectorJoinInfo& joinInfo, const QString& joinValue )
+{
+  return joinInfo.joinLayerId + QChar( 0 ) + QString::number( joinInfo.joinField ) + QChar( 0 ) + joinValue;
+}
+
+void QgsVectorLayerJoinBuffer::clearJoinRowCache( const QString& joinLayerId )
+{
+  QString prefix = joinLayerId + QChar( 0 );
+  foreach( QString key, mJoinRowCache.keys() )
+  {
+    if ( key.startsWith( prefix ) )
+    {
+      mJoinRowCache.remove( key );
+    }
+  }
+}
+
+void QgsVectorLayerJoinBuffer::connectJoinLayer( QgsVectorLayer* joinLayer )
+{
+  //edits, undo/redo, commit and rollback all end up in layerModified()
+  connect( joinLayer, SIGNAL( layerModified( bool ) ), this, SLOT( joinLayerModified( bool ) ), Qt::UniqueConnection );
+  connect( joinLayer, SIGNAL( subsetStringChanged() ), this, SLOT( joinLayerSubsetChanged() ), Qt::UniqueConnection );
+}
+
+void QgsVectorLayerJoinBuffer::joinLayerModified( bool onlyGeometry )
+{
+  //the cached rows contain attributes only
+  if ( onlyGeometry )
+  {
+    return;
+  }
+
+  joinLayerSubsetChanged();
+}
+
+void QgsVectorLayerJoinBuffer::joinLayerSubsetChanged()
+{
+  QgsVectorLayer* joinLayer = qobject_cast<QgsVectorLayer*>( sender() );
+  if ( joinLayer )
+  {
+    clearJoinRowCache( joinLayer->id() );
+  }
+}
+
+void QgsVectorLayerJoinBuffer::fetchJoinRows( QgsVectorLayer* joinLayer, const QgsVectorJoinInfo& joinInfo, const QList<QVariant>& joinValues )
+{
+  connectJoinLayer( joinLayer );
+
+  const QgsField joinField = joinLayer->pendingFields().value( joinInfo.joinField );
+  if ( joinField.name().isEmpty() )
+  {
+    return;
+  }
+
+  bool numericJoinField = joinField.type() == QVariant::Int || joinField.type() == QVariant::UInt ||
+                          joinField.type() == QVariant::LongLong || joinField.type() == QVariant::ULongLong ||
+                          joinField.type() == QVariant::Double;
+
+  //values without join row are cached as empty rows, so that they are not queried again
+  QHash<QString, QgsAttributeMap> rows;
+  QStringList quotedValues;
+  QList<QVariant>::const_iterator valueIt = joinValues.constBegin();
+  for ( ; valueIt != joinValues.constEnd(); ++valueIt )
+  {
+    QString value = valueIt->toString();
+    if ( rows.contains( value ) )
     {
-      QgsAttributeMap attMap = fet.attributeMap();
-      QgsAttributeMap::const_iterator attIt = attMap.constBegin();
-      for ( ; attIt != attMap.constEnd(); ++attIt )
+      continue;
+    }
+    rows.insert( value, QgsAttributeMap() );
+
+    if ( numericJoinField )
+    {
+      //values that are no numbers cannot match and must not end up in the query
+      bool ok;
+      value.toDouble( &ok );
+      if ( ok )
       {
-        f.addAttribute( attIt.key() + attributeIndexOffset, attIt.value() );
+        quotedValues << value;
       }
     }
-    else //no suitable join feature found, insert invalid variants
+    else
     {
-      QgsAttributeList::const_iterator attIt = attributes.constBegin();
-      for ( ; attIt != attributes.constEnd(); ++attIt )
+      quotedValues << "'" + QString( value ).replace( "'", "''" ) + "'";
+    }
+  }
+
+  if ( !quotedValues.isEmpty() )
+  {
+    //query the joined values of all join values at once by setting a subset string
+    QString subsetString = joinLayer->dataProvider()->subsetString(); //provider might already have a subset string
+    QString bkSubsetString = subsetString;
+    if ( !subsetString.isEmpty() )
+    {
+      subsetString = "(" + subsetString + ") AND ";
+    }
+    subsetString.append( QgsExpression::quotedColumnRef( joinField.name() ) + " IN (" + quotedValues.join( "," ) + ")" );
+    joinLayer->dataProvider()->setSubsetString( subsetString, false );
+    ++mFetchCount;
+
+    //select (no geometry)
+    QgsFeatureIterator fi = joinLayer->getFeatures( QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ) );
+    QgsFeature fet;
+    int rowCount = 0;
+    while ( fi.nextFeature( fet ) )
+    {
+      //like the lookup in the memory cache, the first row of a join value is used
+      QHash<QString, QgsAttributeMap>::iterator rowIt = rows.find( fet.attribute( joinInfo.joinField ).toString() );
+      if ( rowIt != rows.end() && rowIt->isEmpty() )
       {
-        f.addAttribute( *attIt + attributeIndexOffset, QVariant() );
+        *rowIt = fet.attributeMap();
+        ++rowCount;
       }
     }
+    fi.close();
 
     joinLayer->dataProvider()->setSubsetString( bkSubsetString, false );
+    QgsDebugMsgLevel( QString( "fetched %1 join rows for %2 join values from %3" ).arg( rowCount ).arg( quotedValues.size() ).arg( joinInfo.joinLayerId ), 3 );
+  }
+
+  QHash<QString, QgsAttributeMap>::const_iterator rowIt = rows.constBegin();
+  for ( ; rowIt != rows.constEnd(); ++rowIt )
+  {
+    mJoinRowCache.insert( joinRowCacheKey( joinInfo, rowIt.key() ), new QgsAttributeMap( rowIt.value() ) );
   }
 }
 
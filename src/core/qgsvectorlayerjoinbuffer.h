@@ -21,12 +21,15 @@
 #include "qgsfeature.h"
 #include "qgsvectorlayer.h"
 
+#include <QCache>
 #include <QHash>
 #include <QString>
 
 /**Manages joined fields for a vector layer*/
-class CORE_EXPORT QgsVectorLayerJoinBuffer
+class CORE_EXPORT QgsVectorLayerJoinBuffer : public QObject
 {
+    Q_OBJECT
+
   public:
     QgsVectorLayerJoinBuffer();
     ~QgsVectorLayerJoinBuffer();
@@ -42,6 +45,13 @@ class CORE_EXPORT QgsVectorLayerJoinBuffer
     void select( const QgsAttributeList& fetchAttributes,
                  QgsAttributeList& sourceJoinFields, int maxProviderIndex );
 
+    /**Prepares the join informations for the joins containing attributes to fetch.
+      Unlike select(), the informations are returned to the caller, so that several readers
+      can fetch joined attributes at the same time.
+      @note added in 1.9 */
+    void prepareFetchJoins( const QgsAttributeList& fetchAttributes, QgsAttributeList& sourceJoinFields,
+                            int maxProviderIndex, QMap<QgsVectorLayer*, QgsFetchJoinInfo>& fetchJoinInfos ) const;
+
     /**Updates field map with joined attributes
       @param fields map to append joined attributes
       @param maxIndex in/out: maximum attribute index*/
@@ -50,6 +60,42 @@ class CORE_EXPORT QgsVectorLayerJoinBuffer
     /**Update feature with uncommited attribute updates and joined attributes*/
     void updateFeatureAttributes( QgsFeature &f, int maxProviderIndex, bool all = false );
 
+    /**Update feature with the joined attributes described by fetchJoinInfos (see prepareFetchJoins())
+      @note added in 1.9 */
+    void updateFeatureAttributes( QgsFeature &f, const QMap<QgsVectorLayer*, QgsFetchJoinInfo>& fetchJoinInfos );
+
+    /**Fetches the join layer rows for the target values of a block of features with one request per join
+      and keeps them in the join row cache, so that updateFeatureAttributes() does not query the join layer
+      for every feature. Joins with memory cache are skipped.
+      @note added in 1.9 */
+    void prefetchJoinedAttributes( const QgsFeatureList& features, const QMap<QgsVectorLayer*, QgsFetchJoinInfo>& fetchJoinInfos );
+
+    /**Returns true if one of the joins has no memory cache and is queried from the join layer
+      @note added in 1.9 */
+    static bool containsQueriedJoins( const QMap<QgsVectorLayer*, QgsFetchJoinInfo>& fetchJoinInfos );
+
+    /**Sets the maximum number of join layer rows kept in the join row cache. The rows that were
+      used least recently are removed first
+      @note added in 1.9 */
+    void setJoinRowCacheSize( int rows );
+    /**@note added in 1.9 */
+    int joinRowCacheSize() const { return mJoinRowCache.maxCost(); }
+    /**Removes all rows from the join row cache, e.g. after the join layers were edited
+      @note added in 1.9 */
+    void clearJoinRowCache() { mJoinRowCache.clear(); }
+
+    /**Number of requests sent to join layers since the last call to resetStatistics()
+      @note added in 1.9 */
+    int fetchCount() const { return mFetchCount; }
+    /**Number of join lookups answered by the join row cache since the last call to resetStatistics()
+      @note added in 1.9 */
+    int cacheHits() const { return mCacheHits; }
+    /**Number of join lookups that needed a request since the last call to resetStatistics()
+      @note added in 1.9 */
+    int cacheMisses() const { return mCacheMisses; }
+    /**@note added in 1.9 */
+    void resetStatistics();
+
     /**Calls cacheJoinLayer() for all vector joins*/
     void createJoinCaches();
 
@@ -77,6 +123,12 @@ class CORE_EXPORT QgsVectorLayerJoinBuffer
         @return true in case of success, otherwise false (e.g. empty map)*/
     static bool maximumIndex( const QgsFieldMap& fMap, int& index );
 
+  private slots:
+    /**Removes the cached rows of the join layer that sent the signal if its attributes were edited*/
+    void joinLayerModified( bool onlyGeometry );
+    /**Removes the cached rows of the join layer that sent the signal*/
+    void joinLayerSubsetChanged();
+
   private:
 
     /**Joined vector layers*/
@@ -86,17 +138,36 @@ class CORE_EXPORT QgsVectorLayerJoinBuffer
       Allows faster mapping of attribute ids compared to mVectorJoins*/
     QMap<QgsVectorLayer*, QgsFetchJoinInfo> mFetchJoinInfos;
 
+    /**Rows of join layers without memory cache, keyed by join layer, join field and join value.
+      Join values without row are kept as empty maps*/
+    QCache<QString, QgsAttributeMap> mJoinRowCache;
+
+    int mFetchCount;
+    int mCacheHits;
+    int mCacheMisses;
+
+    /**Key of a join value in mJoinRowCache*/
+    static QString joinRowCacheKey( const QgsVectorJoinInfo& joinInfo, const QString& joinValue );
+
+    /**Removes the rows of a join layer from mJoinRowCache*/
+    void clearJoinRowCache( const QString& joinLayerId );
+
+    /**Connects the signals of a join layer that invalidate its cached rows (once per layer)*/
+    void connectJoinLayer( QgsVectorLayer* joinLayer );
+
+    /**Queries the rows of join values from the join layer with one request and inserts them into the join row cache*/
+    void fetchJoinRows( QgsVectorLayer* joinLayer, const QgsVectorJoinInfo& joinInfo, const QList<QVariant>& joinValues );
+
     /**Caches attributes of join layer in memory if QgsVectorJoinInfo.memoryCache is true (and the cache is not already there)*/
     void cacheJoinLayer( QgsVectorJoinInfo& joinInfo );
 
     /**Adds joined attributes to a feature
       @param f the feature to add the attributes
       @param joinInfo vector join
-      @param joinFieldName name of the (source) join Field
       @param joinValue lookup value for join
       @param attributes (join layer) attribute indices to add
       @param attributeIndexOffset index offset to get from join layer attribute index to layer index*/
-    void addJoinedFeatureAttributes( QgsFeature& f, const QgsVectorJoinInfo& joinInfo, const QString& joinFieldName, const QVariant& joinValue,
+    void addJoinedFeatureAttributes( QgsFeature& f, const QgsVectorJoinInfo& joinInfo, const QVariant& joinValue,
                                      const QgsAttributeList& attributes, int attributeIndexOffset );
 };
 
@@ -0,0 +1,146 @@
+/***************************************************************************
+    qgsrasterblockcache.cpp - LRU cache of decoded raster blocks
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrasterblockcache.h"
+
+#include <QMutexLocker>
+#include <QSettings>
+
+#include <limits>
+
+QgsRasterBlockCache* QgsRasterBlockCache::mInstance = 0;
+//! protects the creation of the instance, raster providers use the cache from several threads
+static QMutex sInstanceMutex;
+
+QgsRasterBlockCache* QgsRasterBlockCache::instance()
+{
+  QMutexLocker locker( &sInstanceMutex );
+  if ( !mInstance )
+  {
+    mInstance = new QgsRasterBlockCache();
+  }
+  return mInstance;
+}
+
+QgsRasterBlockCache::QgsRasterBlockCache()
+    : mMaxSize( 0 )
+    , mCostUnit( 1 )
+    , mHits( 0 )
+    , mMisses( 0 )
+{
+  QSettings settings;
+  qint64 sizeMB = settings.value( "/Raster/blockCacheSize", 64 ).toLongLong();
+  setMaxSizeLocked( sizeMB * 1024 * 1024 );
+}
+
+QgsRasterBlockCache::~QgsRasterBlockCache()
+{
+}
+
+QString QgsRasterBlockCache::key( const QString& dataset, int band, int level, int xBlock, int yBlock )
+{
+  return QString( "%1\n%2:%3:%4:%5" ).arg( dataset ).arg( band ).arg( level ).arg( xBlock ).arg( yBlock );
+}
+
+bool QgsRasterBlockCache::block( const QString& dataset, int band, int level, int xBlock, int yBlock, QByteArray& data )
+{
+  QMutexLocker locker( &mMutex );
+  QByteArray* cached = mCache.object( key( dataset, band, level, xBlock, yBlock ) );
+  if ( !cached )
+  {
+    ++mMisses;
+    return false;
+  }
+  ++mHits;
+  data = *cached;
+  return true;
+}
+
+void QgsRasterBlockCache::insertBlock( const QString& dataset, int band, int level, int xBlock, int yBlock, const QByteArray& data )
+{
+  QMutexLocker locker( &mMutex );
+  //QCache deletes the object right away if it is larger than the cache
+  int cost = static_cast<int>(( data.size() + mCostUnit - 1 ) / mCostUnit );
+  mCache.insert( key( dataset, band, level, xBlock, yBlock ), new QByteArray( data ), cost );
+}
+
+void QgsRasterBlockCache::removeDataset( const QString& dataset )
+{
+  QMutexLocker locker( &mMutex );
+  QString prefix = dataset + "\n";
+  foreach( const QString& k, mCache.keys() )
+  {
+    if ( k.startsWith( prefix ) )
+    {
+      mCache.remove( k );
+    }
+  }
+}
+
+void QgsRasterBlockCache::clear()
+{
+  QMutexLocker locker( &mMutex );
+  mCache.clear();
+}
+
+void QgsRasterBlockCache::setMaxSize( qint64 bytes )
+{
+  QMutexLocker locker( &mMutex );
+  setMaxSizeLocked( bytes );
+}
+
+void QgsRasterBlockCache::setMaxSizeLocked( qint64 bytes )
+{
+  const qint64 maxCost = std::numeric_limits<int>::max();
+  mMaxSize = qMax( Q_INT64_C( 0 ), bytes );
+  qint64 costUnit = qMax( Q_INT64_C( 1 ), ( mMaxSize + maxCost - 1 ) / maxCost );
+  if ( costUnit != mCostUnit )
+  {
+    // the cached blocks were counted in the old unit
+    mCache.clear();
+    mCostUnit = costUnit;
+  }
+  mCache.setMaxCost( static_cast<int>( mMaxSize / mCostUnit ) );
+}
+
+qint64 QgsRasterBlockCache::maxSize() const
+{
+  QMutexLocker locker( &mMutex );
+  return mMaxSize;
+}
+
+qint64 QgsRasterBlockCache::size() const
+{
+  QMutexLocker locker( &mMutex );
+  return mCache.totalCost() * mCostUnit;
+}
+
+int QgsRasterBlockCache::hits() const
+{
+  QMutexLocker locker( &mMutex );
+  return mHits;
+}
+
+int QgsRasterBlockCache::misses() const
+{
+  QMutexLocker locker( &mMutex );
+  return mMisses;
+}
+
+void QgsRasterBlockCache::resetStatistics()
+{
+  QMutexLocker locker( &mMutex );
+  mHits = 0;
+  mMisses = 0;
+}
@@ -0,0 +1,91 @@
+/***************************************************************************
+    qgsrasterblockcache.h - LRU cache of decoded raster blocks
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRASTERBLOCKCACHE_H
+#define QGSRASTERBLOCKCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QString>
+
+/** \ingroup core
+ * Process wide, size bounded LRU cache of decoded raster blocks. Raster providers store
+ * the native blocks (tiles or strips) they read, keyed by dataset, band, overview level
+ * and block position, so that redraws of the same area do not read and decompress the
+ * data again. The cache is thread safe.
+ *
+ * The maximum size is read from the setting /Raster/blockCacheSize (in MB, default 64).
+ * @note added in 1.9
+ */
+class CORE_EXPORT QgsRasterBlockCache
+{
+  public:
+    static QgsRasterBlockCache* instance();
+    ~QgsRasterBlockCache();
+
+    /** Looks up a block.
+     * @param dataset dataset identifier, usually the data source uri
+     * @param band band number
+     * @param level overview level (0 is full resolution)
+     * @param xBlock block column
+     * @param yBlock block row
+     * @param data out: block data
+     * @return true if the block is in the cache */
+    bool block( const QString& dataset, int band, int level, int xBlock, int yBlock, QByteArray& data );
+
+    /** Stores a block. The least recently used blocks are removed if the cache is full */
+    void insertBlock( const QString& dataset, int band, int level, int xBlock, int yBlock, const QByteArray& data );
+
+    /** Removes all blocks of a dataset, e.g. if it is closed or its overviews are rebuilt */
+    void removeDataset( const QString& dataset );
+
+    /** Removes all blocks */
+    void clear();
+
+    /** Sets the maximum size of the cache in bytes. Caches larger than 2 GB count the
+     * block sizes in coarser units, changing the unit clears the cache */
+    void setMaxSize( qint64 bytes );
+    /** Maximum size of the cache in bytes */
+    qint64 maxSize() const;
+    /** Size of the cached blocks in bytes */
+    qint64 size() const;
+
+    /** Number of successful lookups since the last call to resetStatistics() */
+    int hits() const;
+    /** Number of failed lookups since the last call to resetStatistics() */
+    int misses() const;
+    void resetStatistics();
+
+  protected:
+    QgsRasterBlockCache();
+
+  private:
+    static QString key( const QString& dataset, int band, int level, int xBlock, int yBlock );
+
+    static QgsRasterBlockCache* mInstance;
+
+    /** Sets the cost unit and maximum cost of mCache, the mutex must be locked */
+    void setMaxSizeLocked( qint64 bytes );
+
+    /** QCache counts the costs as int, so the block sizes are divided by mCostUnit */
+    QCache<QString, QByteArray> mCache;
+    qint64 mMaxSize;
+    qint64 mCostUnit;
+    mutable QMutex mMutex;
+    int mHits;
+    int mMisses;
+};
+
+#endif // QGSRASTERBLOCKCACHE_H
@@ -80,6 +80,89 @@ typedef bool isvalidrasterfilename_t( QString const & theFileNameQString, QStrin
 // doubles can take for the current system.  (Yes, 20 was arbitrary.)
 #define TINY_VALUE  std::numeric_limits<double>::epsilon() * 20
 
+// Scanline kernels of the draw methods. They process a whole row at a time, so that
+// the inner loops contain neither data type switches nor virtual calls.
+
+/** Converts a scanline of raw values to doubles */
+template <class T> static void convertScanLine( const void* data, int count, double* values )
+{
+  const T* src = static_cast<const T*>( data );
+  for ( int i = 0; i < count; ++i )
+  {
+    values[i] = static_cast<double>( src[i] );
+  }
+}
+
+/** Maps a scanline of integer values through a table indexed by value - minimum */
+template <class T, class V> static void lookupScanLine( const void* data, int count, const V* table, int minimum, V* out )
+{
+  const T* src = static_cast<const T*>( data );
+  for ( int i = 0; i < count; ++i )
+  {
+    out[i] = table[ static_cast<int>( src[i] ) - minimum ];
+  }
+}
+
+template <class V> static void lookupScanLine( const void* data, int type, int count, const QVector<V>& table, int minimum, V* out )
+{
+  switch ( type )
+  {
+    case QgsRasterDataProvider::Byte:
+      lookupScanLine<GByte, V>( data, count, table.constData(), minimum, out );
+      break;
+    case QgsRasterDataProvider::UInt16:
+      lookupScanLine<GUInt16, V>( data, count, table.constData(), minimum, out );
+      break;
+    case QgsRasterDataProvider::Int16:
+      lookupScanLine<GInt16, V>( data, count, table.constData(), minimum, out );
+      break;
+    default:
+      break;
+  }
+}
+
+/** Returns the value range of a data type small enough to precompute a lookup table of
+ * all its values, i.e. of 8 and 16 bit integer data. Fails for other types. */
+static bool lookupTableRange( int type, int& minimum, int& size )
+{
+  switch ( type )
+  {
+    case QgsRasterDataProvider::Byte:
+      minimum = 0;
+      size = 256;
+      return true;
+    case QgsRasterDataProvider::UInt16:
+      minimum = 0;
+      size = 65536;
+      return true;
+    case QgsRasterDataProvider::Int16:
+      minimum = -32768;
+      size = 65536;
+      return true;
+    default:
+      return false;
+  }
+}
+
+/** Applies a scanline of transparency band values: 0 is transparent, other values scale the alpha */
+static void applyTransparencyBand( const double* transparency, int count, QRgb defaultColor, QRgb* scanLine )
+{
+  for ( int i = 0; i < count; ++i )
+  {
+    int myTransparencyValue = static_cast<int>( transparency[i] );
+    if ( 0 == myTransparencyValue )
+    {
+      scanLine[i] = defaultColor;
+    }
+    else
+    {
+      QRgb myColor = scanLine[i];
+      scanLine[i] = qRgba( qRed( myColor ), qGreen( myColor ), qBlue( myColor ),
+                           static_cast<int>( qAlpha( myColor ) * ( myTransparencyValue / 255.0 ) ) );
+    }
+  }
+}
+
 
 QgsRasterLayer::QgsRasterLayer(
   QString const & path,
@@ -3771,15 +3854,6 @@ void QgsRasterLayer::drawMultiBandColor( QPainter * theQPainter, QgsRasterViewPo
   }
 
   //Read and display pixels
-  double myRedValue = 0.0;
-  double myGreenValue = 0.0;
-  double myBlueValue = 0.0;
-  int myTransparencyValue = 0;
-
-  int myStretchedRedValue   = 0;
-  int myStretchedGreenValue = 0;
-  int myStretchedBlueValue  = 0;
-  int myAlphaValue = 0;
   QgsContrastEnhancement* myRedContrastEnhancement = contrastEnhancement( myRedBandNo );
   QgsContrastEnhancement* myGreenContrastEnhancement = contrastEnhancement( myGreenBandNo );
   QgsContrastEnhancement* myBlueContrastEnhancement = contrastEnhancement( myBlueBandNo );
@@ -3801,79 +3875,93 @@ void QgsRasterLayer::drawMultiBandColor( QPainter * theQPainter, QgsRasterViewPo
     transparencyImageBuffer->reset();
   }
 
+  // The bands are processed a scanline at a time: every band is mapped to display values
+  // (-1 for pixels not drawn), which are then combined into the image scanline
+  int myWidth = theRasterViewPort->drawableAreaXDim;
+  int myPixelCount = theRasterViewPort->drawableAreaXDim * theRasterViewPort->drawableAreaYDim;
+  bool myStretch = QgsContrastEnhancement::NoEnhancement != contrastEnhancementAlgorithm();
+  //without transparent pixel values, all drawn pixels have the same alpha
+  bool myConstantAlpha = mRasterTransparency.transparentThreeValuePixelList().isEmpty();
+
+  int myTypes[3] = { myRedType, myGreenType, myBlueType };
+  QgsContrastEnhancement* myContrastEnhancements[3] = { myRedContrastEnhancement, myGreenContrastEnhancement, myBlueContrastEnhancement };
+  QVector<double> myValues[3];
+  QVector<int> myComponents[3];
+  QVector<int> myTables[3];
+  int myTableMinimums[3] = { 0, 0, 0 };
+  for ( int myBand = 0; myBand < 3; ++myBand )
+  {
+    myValues[myBand].resize( myWidth );
+    myComponents[myBand].resize( myWidth );
+
+    //for 8 and 16 bit data the display values of all possible values are computed once
+    int myTableSize = 0;
+    if ( lookupTableRange( myTypes[myBand], myTableMinimums[myBand], myTableSize ) && myTableSize <= myPixelCount )
+    {
+      myTables[myBand].resize( myTableSize );
+      for ( int myValue = 0; myValue < myTableSize; ++myValue )
+      {
+        myTables[myBand][myValue] = colorComponent( myTableMinimums[myBand] + myValue, myContrastEnhancements[myBand], myStretch );
+      }
+    }
+  }
+  QVector<double> myTransparencyValues( hasTransparencyBand ? myWidth : 0 );
+
   while ( redImageBuffer.nextScanLine( &redImageScanLine, &redRasterScanLine )
           && greenImageBuffer.nextScanLine( &greenImageScanLine, &greenRasterScanLine )
           && blueImageBuffer.nextScanLine( &blueImageScanLine, &blueRasterScanLine )
           && ( !transparencyImageBuffer || transparencyImageBuffer->nextScanLine( &transparencyImageScanLine, &transparencyRasterScanLine ) ) )
   {
-    for ( int i = 0; i < theRasterViewPort->drawableAreaXDim; ++i )
+    void* myRasterScanLines[3] = { redRasterScanLine, greenRasterScanLine, blueRasterScanLine };
+    for ( int myBand = 0; myBand < 3; ++myBand )
     {
-      if ( transparencyImageBuffer )
+      bool myUseTable = !myTables[myBand].isEmpty() && myRasterScanLines[myBand];
+      if ( !myUseTable || !myConstantAlpha )
       {
-        myTransparencyValue = readValue( transparencyRasterScanLine, myTransparencyType, i );
-        if ( 0 == myTransparencyValue )
-        {
-          redImageScanLine[ i ] = myDefaultColor;
-          continue;
-        }
+        readScanLine( myRasterScanLines[myBand], myTypes[myBand], myWidth, myValues[myBand].data() );
       }
 
-      myRedValue   = readValue( redRasterScanLine, myRedType, i );
-      myGreenValue = readValue( greenRasterScanLine, myGreenType, i );
-      myBlueValue  = readValue( blueRasterScanLine, myBlueType, i );
-
-      if ( mValidNoDataValue &&
-           (
-             ( qAbs( myRedValue - mNoDataValue ) <= TINY_VALUE || myRedValue != myRedValue ) ||
-             ( qAbs( myGreenValue - mNoDataValue ) <= TINY_VALUE || myGreenValue != myGreenValue ) ||
-             ( qAbs( myBlueValue - mNoDataValue ) <= TINY_VALUE || myBlueValue != myBlueValue )
-           )
-         )
+      int* myComponent = myComponents[myBand].data();
+      if ( myUseTable )
       {
-        redImageScanLine[ i ] = myDefaultColor;
-        continue;
+        lookupScanLine( myRasterScanLines[myBand], myTypes[myBand], myWidth, myTables[myBand], myTableMinimums[myBand], myComponent );
+      }
+      else
+      {
+        const double* myValue = myValues[myBand].constData();
+        for ( int i = 0; i < myWidth; ++i )
+        {
+          myComponent[i] = colorComponent( myValue[i], myContrastEnhancements[myBand], myStretch );
+        }
       }
+    }
 
-      if ( QgsContrastEnhancement::NoEnhancement != contrastEnhancementAlgorithm() &&
-           ( !myRedContrastEnhancement->isValueInDisplayableRange( myRedValue ) ||
-             !myGreenContrastEnhancement->isValueInDisplayableRange( myGreenValue ) ||
-             !myBlueContrastEnhancement->isValueInDisplayableRange( myBlueValue ) ) )
+    const int* myRed = myComponents[0].constData();
+    const int* myGreen = myComponents[1].constData();
+    const int* myBlue = myComponents[2].constData();
+    for ( int i = 0; i < myWidth; ++i )
+    {
+      if ( myRed[i] < 0 || myGreen[i] < 0 || myBlue[i] < 0 )
       {
         redImageScanLine[ i ] = myDefaultColor;
         continue;
       }
 
-      myAlphaValue = mRasterTransparency.alphaValue( myRedValue, myGreenValue, myBlueValue, mTransparencyLevel );
+      int myAlphaValue = myConstantAlpha ? mTransparencyLevel
+                         : mRasterTransparency.alphaValue( myValues[0][i], myValues[1][i], myValues[2][i], mTransparencyLevel );
       if ( 0 == myAlphaValue )
       {
         redImageScanLine[ i ] = myDefaultColor;
         continue;
       }
 
-      if ( QgsContrastEnhancement::NoEnhancement == contrastEnhancementAlgorithm() )
-      {
-        myStretchedRedValue = myRedValue;
-        myStretchedGreenValue = myGreenValue;
-        myStretchedBlueValue = myBlueValue;
-      }
-      else
-      {
-        myStretchedRedValue = myRedContrastEnhancement->enhanceContrast( myRedValue );
-        myStretchedGreenValue = myGreenContrastEnhancement->enhanceContrast( myGreenValue );
-        myStretchedBlueValue = myBlueContrastEnhancement->enhanceContrast( myBlueValue );
-      }
-
-      if ( mInvertColor )
-      {
-        myStretchedRedValue = 255 - myStretchedRedValue;
-        myStretchedGreenValue = 255 - myStretchedGreenValue;
-        myStretchedBlueValue = 255 - myStretchedBlueValue;
-      }
-
-      if ( myTransparencyValue )
-        myAlphaValue *= myTransparencyValue / 255.0;
+      redImageScanLine[ i ] = qRgba( myRed[i], myGreen[i], myBlue[i], myAlphaValue );
+    }
 
-      redImageScanLine[ i ] = qRgba( myStretchedRedValue, myStretchedGreenValue, myStretchedBlueValue, myAlphaValue );
+    if ( transparencyImageBuffer )
+    {
+      readScanLine( transparencyRasterScanLine, myTransparencyType, myWidth, myTransparencyValues.data() );
+      applyTransparencyBand( myTransparencyValues.constData(), myWidth, myDefaultColor, redImageScanLine );
     }
   }
 
@@ -4300,10 +4388,6 @@ void QgsRasterLayer::drawSingleBandGray( QPainter * theQPainter, QgsRasterViewPo
   void* transparencyRasterScanLine = 0;
 
   QRgb myDefaultColor = qRgba( 255, 255, 255, 0 );
-  double myGrayValue = 0.0;
-  int myGrayVal = 0;
-  int myTransparencyValue = 0;
-  int myAlphaValue = 0;
   QgsContrastEnhancement* myContrastEnhancement = contrastEnhancement( theBandNo );
 
   QgsRasterBandStats myGrayBandStats;
@@ -4324,61 +4408,45 @@ void QgsRasterLayer::drawSingleBandGray( QPainter * theQPainter, QgsRasterViewPo
     setMinimumValue( theBandNo, mDataProvider->minimumValue( theBandNo ) );
   }
 
+  int myWidth = theRasterViewPort->drawableAreaXDim;
+  QVector<double> myValues( myWidth );
+  QVector<double> myTransparencyValues( hasTransparencyBand ? myWidth : 0 );
+
+  //for 8 and 16 bit data the colors of all possible values are computed once
+  int myTableMinimum = 0;
+  int myTableSize = 0;
+  QVector<QRgb> myColorTable;
+  if ( lookupTableRange( myDataType, myTableMinimum, myTableSize ) &&
+       myTableSize <= theRasterViewPort->drawableAreaXDim * theRasterViewPort->drawableAreaYDim )
+  {
+    myColorTable.resize( myTableSize );
+    for ( int myValue = 0; myValue < myTableSize; ++myValue )
+    {
+      myColorTable[myValue] = grayColor( myTableMinimum + myValue, myContrastEnhancement );
+    }
+  }
+
   QgsDebugMsg( " -> imageBuffer.nextScanLine" );
   while ( imageBuffer.nextScanLine( &imageScanLine, &rasterScanLine )
           && ( !transparencyImageBuffer || transparencyImageBuffer->nextScanLine( &transparencyImageScanLine, &transparencyRasterScanLine ) ) )
   {
-    //QgsDebugMsg( " rendering line");
-    for ( int i = 0; i < theRasterViewPort->drawableAreaXDim; ++i )
+    if ( !myColorTable.isEmpty() && rasterScanLine )
     {
-      if ( transparencyImageBuffer )
-      {
-        myTransparencyValue = readValue( transparencyRasterScanLine, myTransparencyType, i );
-        if ( 0 == myTransparencyValue )
-        {
-          imageScanLine[ i ] = myDefaultColor;
-          continue;
-        }
-      }
-
-      myGrayValue = readValue( rasterScanLine, myDataType, i );
-      //QgsDebugMsg( QString( "i = %1 myGrayValue = %2 ").arg(i).arg( myGrayValue ) );
-      //if ( myGrayValue != -2147483647 ) {
-      //QgsDebugMsg( "myGrayValue = " + QString::number( myGrayValue ) );
-      //}
-
-      if ( mValidNoDataValue && ( qAbs( myGrayValue - mNoDataValue ) <= TINY_VALUE || myGrayValue != myGrayValue ) )
-      {
-        imageScanLine[ i ] = myDefaultColor;
-        continue;
-      }
-
-      if ( !myContrastEnhancement->isValueInDisplayableRange( myGrayValue ) )
-      {
-        imageScanLine[ i ] = myDefaultColor;
-        continue;
-      }
-
-      myAlphaValue = mRasterTransparency.alphaValue( myGrayValue, mTransparencyLevel );
-      if ( 0 == myAlphaValue )
-      {
-        imageScanLine[ i ] = myDefaultColor;
-        continue;
-      }
-
-
-      myGrayVal = myContrastEnhancement->enhanceContrast( myGrayValue );
-
-      if ( mInvertColor )
+      lookupScanLine( rasterScanLine, myDataType, myWidth, myColorTable, myTableMinimum, imageScanLine );
+    }
+    else
+    {
+      readScanLine( rasterScanLine, myDataType, myWidth, myValues.data() );
+      for ( int i = 0; i < myWidth; ++i )
       {
-        myGrayVal = 255 - myGrayVal;
+        imageScanLine[ i ] = grayColor( myValues[i], myContrastEnhancement );
       }
+    }
 
-      if ( myTransparencyValue )
-        myAlphaValue *= myTransparencyValue / 255.0;
-
-      //QgsDebugMsg( QString( "i = %1 myGrayValue = %2 myGrayVal = %3 myAlphaValue = %4").arg(i).arg( myGrayValue ).arg(myGrayVal).arg(myAlphaValue) );
-      imageScanLine[ i ] = qRgba( myGrayVal, myGrayVal, myGrayVal, myAlphaValue );
+    if ( transparencyImageBuffer )
+    {
+      readScanLine( transparencyRasterScanLine, myTransparencyType, myWidth, myTransparencyValues.data() );
+      applyTransparencyBand( myTransparencyValues.constData(), myWidth, myDefaultColor, imageScanLine );
     }
   }
 
@@ -4443,64 +4511,44 @@ void QgsRasterLayer::drawSingleBandPseudoColor( QPainter * theQPainter, QgsRaste
   mRasterShader->setMinimumValue( myMinimumValue );
   mRasterShader->setMaximumValue( myMaximumValue );
 
-  int myRedValue = 255;
-  int myGreenValue = 255;
-  int myBlueValue = 255;
-  int myTransparencyValue = 0;
+  int myWidth = theRasterViewPort->drawableAreaXDim;
+  QVector<double> myValues( myWidth );
+  QVector<double> myTransparencyValues( hasTransparencyBand ? myWidth : 0 );
 
-  double myPixelValue = 0.0;
-  int myAlphaValue = 0;
+  //for 8 and 16 bit data the colors of all possible values are computed once
+  int myTableMinimum = 0;
+  int myTableSize = 0;
+  QVector<QRgb> myColorTable;
+  if ( lookupTableRange( myDataType, myTableMinimum, myTableSize ) &&
+       myTableSize <= theRasterViewPort->drawableAreaXDim * theRasterViewPort->drawableAreaYDim )
+  {
+    myColorTable.resize( myTableSize );
+    for ( int myValue = 0; myValue < myTableSize; ++myValue )
+    {
+      myColorTable[myValue] = pseudoColor( myTableMinimum + myValue );
+    }
+  }
 
   while ( imageBuffer.nextScanLine( &imageScanLine, &rasterScanLine )
           && ( !transparencyImageBuffer || transparencyImageBuffer->nextScanLine( &transparencyImageScanLine, &transparencyRasterScanLine ) ) )
   {
-    for ( int i = 0; i < theRasterViewPort->drawableAreaXDim; ++i )
+    if ( !myColorTable.isEmpty() && rasterScanLine )
     {
-      if ( transparencyImageBuffer )
-      {
-        myTransparencyValue = readValue( transparencyRasterScanLine, myTransparencyType, i );
-        if ( 0 == myTransparencyValue )
-        {
-          imageScanLine[ i ] = myDefaultColor;
-          continue;
-        }
-      }
-
-      myPixelValue = readValue( rasterScanLine, myDataType, i );
-
-      if ( mValidNoDataValue && ( qAbs( myPixelValue - mNoDataValue ) <= TINY_VALUE || myPixelValue != myPixelValue ) )
-      {
-        imageScanLine[ i ] = myDefaultColor;
-        continue;
-      }
-
-      myAlphaValue = mRasterTransparency.alphaValue( myPixelValue, mTransparencyLevel );
-      if ( 0 == myAlphaValue )
-      {
-        imageScanLine[ i ] = myDefaultColor;
-        continue;
-      }
-
-      if ( !mRasterShader->shade( myPixelValue, &myRedValue, &myGreenValue, &myBlueValue ) )
+      lookupScanLine( rasterScanLine, myDataType, myWidth, myColorTable, myTableMinimum, imageScanLine );
+    }
+    else
+    {
+      readScanLine( rasterScanLine, myDataType, myWidth, myValues.data() );
+      for ( int i = 0; i < myWidth; ++i )
       {
-        imageScanLine[ i ] = myDefaultColor;
-        continue;
+        imageScanLine[ i ] = pseudoColor( myValues[i] );
       }
+    }
 
-      if ( myTransparencyValue )
-        myAlphaValue *= myTransparencyValue / 255.0;
-
-      if ( mInvertColor )
-      {
-        //Invert flag, flip blue and red
-        imageScanLine[ i ] = qRgba( myBlueValue, myGreenValue, myRedValue, myAlphaValue );
-      }
-      else
-      {
-        //Normal
-        imageScanLine[ i ] = qRgba( myRedValue, myGreenValue, myBlueValue, myAlphaValue );
-        //QgsDebugMsg ( QString ( "%1 value :  %2 rgba : %3 %4 %5 %6" ).arg (i).arg( myPixelValue ).arg(myRedValue).arg(myGreenValue).arg(myBlueValue).arg(myAlphaValue) );
-      }
+    if ( transparencyImageBuffer )
+    {
+      readScanLine( transparencyRasterScanLine, myTransparencyType, myWidth, myTransparencyValues.data() );
+      applyTransparencyBand( myTransparencyValues.constData(), myWidth, myDefaultColor, imageScanLine );
     }
   }
 
@@ -4637,6 +4685,125 @@ double QgsRasterLayer::readValue( void *data, int type, int index )
   return mValidNoDataValue ? mNoDataValue : 0.0;
 }
 
+void QgsRasterLayer::readScanLine( void *data, int type, int count, double *values )
+{
+  if ( data )
+  {
+    switch ( type )
+    {
+      case QgsRasterDataProvider::Byte:
+        convertScanLine<GByte>( data, count, values );
+        return;
+      case QgsRasterDataProvider::UInt16:
+        convertScanLine<GUInt16>( data, count, values );
+        return;
+      case QgsRasterDataProvider::Int16:
+        convertScanLine<GInt16>( data, count, values );
+        return;
+      case QgsRasterDataProvider::UInt32:
+        convertScanLine<GUInt32>( data, count, values );
+        return;
+      case QgsRasterDataProvider::Int32:
+        convertScanLine<GInt32>( data, count, values );
+        return;
+      case QgsRasterDataProvider::Float32:
+        convertScanLine<float>( data, count, values );
+        return;
+      case QgsRasterDataProvider::Float64:
+        convertScanLine<double>( data, count, values );
+        return;
+      default:
+        QgsMessageLog::logMessage( tr( "GDAL data type %1 is not supported" ).arg( type ), tr( "Raster" ) );
+        break;
+    }
+  }
+
+  double myFallbackValue = mValidNoDataValue ? mNoDataValue : 0.0;
+  for ( int i = 0; i < count; ++i )
+  {
+    values[i] = myFallbackValue;
+  }
+}
+
+QRgb QgsRasterLayer::grayColor( double value, QgsContrastEnhancement *contrastEnhancement ) const
+{
+  QRgb myDefaultColor = qRgba( 255, 255, 255, 0 );
+  if ( mValidNoDataValue && ( qAbs( value - mNoDataValue ) <= TINY_VALUE || value != value ) )
+  {
+    return myDefaultColor;
+  }
+
+  if ( !contrastEnhancement->isValueInDisplayableRange( value ) )
+  {
+    return myDefaultColor;
+  }
+
+  int myAlphaValue = mRasterTransparency.alphaValue( value, mTransparencyLevel );
+  if ( 0 == myAlphaValue )
+  {
+    return myDefaultColor;
+  }
+
+  int myGrayVal = contrastEnhancement->enhanceContrast( value );
+  if ( mInvertColor )
+  {
+    myGrayVal = 255 - myGrayVal;
+  }
+  return qRgba( myGrayVal, myGrayVal, myGrayVal, myAlphaValue );
+}
+
+QRgb QgsRasterLayer::pseudoColor( double value ) const
+{
+  QRgb myDefaultColor = qRgba( 255, 255, 255, 0 );
+  if ( mValidNoDataValue && ( qAbs( value - mNoDataValue ) <= TINY_VALUE || value != value ) )
+  {
+    return myDefaultColor;
+  }
+
+  int myAlphaValue = mRasterTransparency.alphaValue( value, mTransparencyLevel );
+  if ( 0 == myAlphaValue )
+  {
+    return myDefaultColor;
+  }
+
+  int myRedValue = 255;
+  int myGreenValue = 255;
+  int myBlueValue = 255;
+  if ( !mRasterShader->shade( value, &myRedValue, &myGreenValue, &myBlueValue ) )
+  {
+    return myDefaultColor;
+  }
+
+  if ( mInvertColor )
+  {
+    //Invert flag, flip blue and red
+    return qRgba( myBlueValue, myGreenValue, myRedValue, myAlphaValue );
+  }
+  return qRgba( myRedValue, myGreenValue, myBlueValue, myAlphaValue );
+}
+
+int QgsRasterLayer::colorComponent( double value, QgsContrastEnhancement *contrastEnhancement, bool stretch ) const
+{
+  //NaN is never drawn, QgsRasterTransparency::alphaValue() makes it transparent
+  if ( value != value || ( mValidNoDataValue && qAbs( value - mNoDataValue ) <= TINY_VALUE ) )
+  {
+    return -1;
+  }
+
+  if ( stretch && !contrastEnhancement->isValueInDisplayableRange( value ) )
+  {
+    return -1;
+  }
+
+  int myComponent = stretch ? contrastEnhancement->enhanceContrast( value ) : static_cast<int>( value );
+  if ( mInvertColor )
+  {
+    myComponent = 255 - myComponent;
+  }
+  //qRgba() uses the lowest 8 bits only
+  return myComponent & 0xff;
+}
+
 bool QgsRasterLayer::update()
 {
   QgsDebugMsg( "entered." );
@@ -796,6 +796,18 @@ class CORE_EXPORT QgsRasterLayer : public QgsMapLayer
     //inline double readValue( void *data, GDALDataType type, int index );
     inline double readValue( void *data, int type, int index );
 
+    /** \brief Read a whole scanline from a memory block created by readData() into a buffer of doubles */
+    void readScanLine( void *data, int type, int count, double *values );
+
+    /** \brief Color of a pixel value of a single band gray image, transparent if the pixel is not drawn */
+    QRgb grayColor( double value, QgsContrastEnhancement *contrastEnhancement ) const;
+
+    /** \brief Color of a pixel value of a single band pseudocolor image, transparent if the pixel is not drawn */
+    QRgb pseudoColor( double value ) const;
+
+    /** \brief Display value (0-255) of a band of a multiband color image, -1 if the pixel is not drawn */
+    int colorComponent( double value, QgsContrastEnhancement *contrastEnhancement, bool stretch ) const;
+
     /** \brief Update the layer if it is outdated */
     bool update();
 
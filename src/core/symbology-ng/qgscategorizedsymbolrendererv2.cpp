@@ -13,6 +13,8 @@
 #include <QDomElement>
 #include <QSettings> // for legend
 
+#include <cstring> // for memcpy
+
 QgsRendererCategoryV2::QgsRendererCategoryV2( QVariant value, QgsSymbolV2* symbol, QString label )
     : mValue( value ), mSymbol( symbol ), mLabel( label )
 {
@@ -98,32 +100,82 @@ QgsCategorizedSymbolRendererV2::~QgsCategorizedSymbolRendererV2()
   delete mSourceColorRamp;
 }
 
+// bits of a double, used as hash key as there is no qHash( double )
+static quint64 doubleBits( double value )
+{
+  quint64 bits;
+  memcpy( &bits, &value, sizeof( bits ) );
+  return bits;
+}
+
 void QgsCategorizedSymbolRendererV2::rebuildHash()
 {
   mSymbolHash.clear();
+  mIntSymbolHash.clear();
+  mDoubleSymbolHash.clear();
 
   for ( int i = 0; i < mCategories.count(); ++i )
   {
     QgsRendererCategoryV2& cat = mCategories[i];
     mSymbolHash.insert( cat.value().toString(), cat.symbol() );
   }
+
+  // the typed hashes have to give the same symbol as looking up the string of a value:
+  // every string of an integer goes to the integer hash
+  QHash<QString, QgsSymbolV2*>::const_iterator it = mSymbolHash.constBegin();
+  for ( ; it != mSymbolHash.constEnd(); ++it )
+  {
+    bool ok;
+    qlonglong intValue = it.key().toLongLong( &ok );
+    if ( ok && QString::number( intValue ) == it.key() )
+      mIntSymbolHash.insert( intValue, it.value() );
+  }
+
+  for ( int i = 0; i < mCategories.count(); ++i )
+  {
+    const QVariant& value = mCategories[i].value();
+    if ( value.type() == QVariant::Double && !value.isNull() )
+      mDoubleSymbolHash.insert( doubleBits( value.toDouble() ), mSymbolHash.value( value.toString() ) );
+  }
 }
 
 QgsSymbolV2* QgsCategorizedSymbolRendererV2::symbolForValue( QVariant value )
 {
-  // TODO: special case for int, double
+  if ( mSymbolHash.count() == 0 )
+  {
+    QgsDebugMsg( "there are no hashed symbols!!!" );
+    return NULL;
+  }
 
-  QHash<QString, QgsSymbolV2*>::iterator it = mSymbolHash.find( value.toString() );
-  if ( it == mSymbolHash.end() )
+  // look up integers and doubles without converting them to strings
+  if ( !value.isNull() )
   {
-    if ( mSymbolHash.count() == 0 )
-    {
-      QgsDebugMsg( "there are no hashed symbols!!!" );
-    }
-    else
+    switch ( value.type() )
     {
-      //QgsDebugMsg( "attribute value not found: " + value.toString() );
+      case QVariant::Int:
+      case QVariant::UInt:
+      case QVariant::LongLong:
+        // all categories matching an integer are in the integer hash
+        return mIntSymbolHash.value( value.toLongLong() );
+
+      case QVariant::Double:
+      {
+        QHash<quint64, QgsSymbolV2*>::const_iterator it = mDoubleSymbolHash.constFind( doubleBits( value.toDouble() ) );
+        if ( it != mDoubleSymbolHash.constEnd() )
+          return it.value();
+        // categories with other types may still match the string of the double
+        break;
+      }
+
+      default:
+        break;
     }
+  }
+
+  QHash<QString, QgsSymbolV2*>::const_iterator it = mSymbolHash.constFind( value.toString() );
+  if ( it == mSymbolHash.constEnd() )
+  {
+    //QgsDebugMsg( "attribute value not found: " + value.toString() );
     return NULL;
   }
 
@@ -132,16 +184,16 @@ QgsSymbolV2* QgsCategorizedSymbolRendererV2::symbolForValue( QVariant value )
 
 QgsSymbolV2* QgsCategorizedSymbolRendererV2::symbolForFeature( QgsFeature& feature )
 {
-  const QgsAttributeMap& attrMap = feature.attributeMap();
-  QgsAttributeMap::const_iterator ita = attrMap.find( mAttrNum );
-  if ( ita == attrMap.end() )
+  if ( !feature.hasAttribute( mAttrNum ) )
   {
     QgsDebugMsg( "attribute '" + mAttrName + "' (index " + QString::number( mAttrNum ) + ") required by renderer not found" );
     return NULL;
   }
+  const QgsAttributes& attrs = feature.attributes();
+  const QVariant& value = attrs[mAttrNum];
 
   // find the right symbol for the category
-  QgsSymbolV2* symbol = symbolForValue( *ita );
+  QgsSymbolV2* symbol = symbolForValue( value );
   if ( symbol == NULL )
   {
     // if no symbol found use default one
@@ -155,12 +207,12 @@ QgsSymbolV2* QgsCategorizedSymbolRendererV2::symbolForFeature( QgsFeature& featu
   double rotation = 0;
   double sizeScale = 1;
   if ( mRotationFieldIdx != -1 )
-    rotation = attrMap[mRotationFieldIdx].toDouble();
+    rotation = feature.attribute( mRotationFieldIdx ).toDouble();
   if ( mSizeScaleFieldIdx != -1 )
-    sizeScale = attrMap[mSizeScaleFieldIdx].toDouble();
+    sizeScale = feature.attribute( mSizeScaleFieldIdx ).toDouble();
 
-  // take a temporary symbol (or create it if doesn't exist)
-  QgsSymbolV2* tempSymbol = mTempSymbols[ita->toString()];
+  // take the temporary symbol of the category
+  QgsSymbolV2* tempSymbol = mTempSymbols.value( symbol );
 
   // modify the temporary symbol and return it
   if ( tempSymbol->type() == QgsSymbolV2::Marker )
@@ -263,7 +315,7 @@ void QgsCategorizedSymbolRendererV2::startRender( QgsRenderContext& context, con
       tempSymbol->setRenderHints(( mRotationFieldIdx != -1 ? QgsSymbolV2::DataDefinedRotation : 0 ) |
                                  ( mSizeScaleFieldIdx != -1 ? QgsSymbolV2::DataDefinedSizeScale : 0 ) );
       tempSymbol->startRender( context, vlayer );
-      mTempSymbols[ it->value().toString()] = tempSymbol;
+      mTempSymbols[ it->symbol()] = tempSymbol;
     }
   }
 
@@ -276,7 +328,11 @@ void QgsCategorizedSymbolRendererV2::stopRender( QgsRenderContext& context )
     it->symbol()->stopRender( context );
 
   // cleanup mTempSymbols
-  QHash<QString, QgsSymbolV2*>::iterator it2 = mTempSymbols.begin();
+#if QT_VERSION < 0x40600
+  QMap<QgsSymbolV2*, QgsSymbolV2*>::iterator it2 = mTempSymbols.begin();
+#else
+  QHash<QgsSymbolV2*, QgsSymbolV2*>::iterator it2 = mTempSymbols.begin();
+#endif
   for ( ; it2 != mTempSymbols.end(); ++it2 )
   {
     it2.value()->stopRender( context );
@@ -125,9 +125,17 @@ class CORE_EXPORT QgsCategorizedSymbolRendererV2 : public QgsFeatureRendererV2
 
     //! hashtable for faster access to symbols
     QHash<QString, QgsSymbolV2*> mSymbolHash;
+    //! symbols of the categories with integer values, avoids converting integer attributes to strings
+    QHash<qlonglong, QgsSymbolV2*> mIntSymbolHash;
+    //! symbols of the categories with double values, keyed by the bits of the value
+    QHash<quint64, QgsSymbolV2*> mDoubleSymbolHash;
 
     //! temporary symbols, used for data-defined rotation and scaling
-    QHash<QString, QgsSymbolV2*> mTempSymbols;
+#if QT_VERSION < 0x40600
+    QMap<QgsSymbolV2*, QgsSymbolV2*> mTempSymbols;
+#else
+    QHash<QgsSymbolV2*, QgsSymbolV2*> mTempSymbols;
+#endif
 
     void rebuildHash();
 
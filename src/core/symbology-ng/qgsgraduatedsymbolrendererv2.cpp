@@ -24,6 +24,8 @@ qgsgraduatedsymbolrendererv2.cpp - Graduated Symbol Renderer Version 2
 
 #include <QDomDocument>
 #include <QDomElement>
+#include <QPair>
+#include <QtAlgorithms>
 #include <QSettings> // for legend
 #include <limits> // for jenks classification
 #include <cmath> // for pretty classification
@@ -108,7 +110,8 @@ QgsGraduatedSymbolRendererV2::QgsGraduatedSymbolRendererV2( QString attrName, Qg
     mSourceSymbol( NULL ),
     mSourceColorRamp( NULL ),
     mRotationFieldIdx( -1 ),
-    mSizeScaleFieldIdx( -1 )
+    mSizeScaleFieldIdx( -1 ),
+    mSortedRangesValid( false )
 {
   // TODO: check ranges for sanity (NULL symbols, invalid ranges)
 }
@@ -120,8 +123,55 @@ QgsGraduatedSymbolRendererV2::~QgsGraduatedSymbolRendererV2()
   delete mSourceColorRamp;
 }
 
+void QgsGraduatedSymbolRendererV2::rebuildSortedRanges()
+{
+  QList< QPair<double, int> > lowerValues;
+  for ( int i = 0; i < mRanges.count(); ++i )
+  {
+    const QgsRendererRangeV2& range = mRanges.at( i );
+    // ranges with the lower value above the upper value never match
+    if ( range.lowerValue() <= range.upperValue() )
+      lowerValues.append( qMakePair( range.lowerValue(), i ) );
+  }
+  qSort( lowerValues );
+
+  int count = lowerValues.count();
+  mSortedLowerValues.resize( count );
+  mSortedUpperValues.resize( count );
+  mSortedRangeIndexes.resize( count );
+  mSortedRangesValid = true;
+  for ( int i = 0; i < count; ++i )
+  {
+    const QgsRendererRangeV2& range = mRanges.at( lowerValues[i].second );
+    mSortedLowerValues[i] = range.lowerValue();
+    mSortedUpperValues[i] = range.upperValue();
+    mSortedRangeIndexes[i] = lowerValues[i].second;
+
+    // neighbouring ranges may share a bound, but must not overlap
+    if ( i > 0 && mSortedUpperValues[i - 1] > mSortedLowerValues[i] )
+      mSortedRangesValid = false;
+  }
+}
+
 QgsSymbolV2* QgsGraduatedSymbolRendererV2::symbolForValue( double value )
 {
+  if ( mSortedRangesValid )
+  {
+    // last range with the lower value not above the value
+    const double* lowerValues = mSortedLowerValues.constData();
+    int pos = qUpperBound( lowerValues, lowerValues + mSortedLowerValues.count(), value ) - lowerValues - 1;
+
+    // ranges before it can only match if they end at the value. Like the
+    // linear search below, pick the matching range that comes first in the list
+    int rangeIndex = -1;
+    for ( ; pos >= 0 && mSortedUpperValues[pos] >= value; --pos )
+    {
+      if ( rangeIndex == -1 || mSortedRangeIndexes[pos] < rangeIndex )
+        rangeIndex = mSortedRangeIndexes[pos];
+    }
+    return rangeIndex == -1 ? NULL : mRanges.at( rangeIndex ).symbol();
+  }
+
   for ( QgsRangeList::iterator it = mRanges.begin(); it != mRanges.end(); ++it )
   {
     if ( it->lowerValue() <= value && it->upperValue() >= value )
@@ -133,16 +183,14 @@ QgsSymbolV2* QgsGraduatedSymbolRendererV2::symbolForValue( double value )
 
 QgsSymbolV2* QgsGraduatedSymbolRendererV2::symbolForFeature( QgsFeature& feature )
 {
-  const QgsAttributeMap& attrMap = feature.attributeMap();
-  QgsAttributeMap::const_iterator ita = attrMap.find( mAttrNum );
-  if ( ita == attrMap.end() )
+  if ( !feature.hasAttribute( mAttrNum ) )
   {
     QgsDebugMsg( "attribute required by renderer not found: " + mAttrName + "(index " + QString::number( mAttrNum ) + ")" );
     return NULL;
   }
 
   // find the right category
-  QgsSymbolV2* symbol = symbolForValue( ita->toDouble() );
+  QgsSymbolV2* symbol = symbolForValue( feature.attributes()[mAttrNum].toDouble() );
   if ( symbol == NULL )
     return NULL;
 
@@ -153,9 +201,9 @@ QgsSymbolV2* QgsGraduatedSymbolRendererV2::symbolForFeature( QgsFeature& feature
   double rotation = 0;
   double sizeScale = 1;
   if ( mRotationFieldIdx != -1 )
-    rotation = attrMap[mRotationFieldIdx].toDouble();
+    rotation = feature.attribute( mRotationFieldIdx ).toDouble();
   if ( mSizeScaleFieldIdx != -1 )
-    sizeScale = attrMap[mSizeScaleFieldIdx].toDouble();
+    sizeScale = feature.attribute( mSizeScaleFieldIdx ).toDouble();
 
   // take a temporary symbol (or create it if doesn't exist)
   QgsSymbolV2* tempSymbol = mTempSymbols[symbol];
@@ -186,6 +234,8 @@ void QgsGraduatedSymbolRendererV2::startRender( QgsRenderContext& context, const
   mRotationFieldIdx  = ( mRotationField.isEmpty()  ? -1 : vlayer->fieldNameIndex( mRotationField ) );
   mSizeScaleFieldIdx = ( mSizeScaleField.isEmpty() ? -1 : vlayer->fieldNameIndex( mSizeScaleField ) );
 
+  rebuildSortedRanges();
+
   QgsRangeList::iterator it = mRanges.begin();
   for ( ; it != mRanges.end(); ++it )
   {
@@ -220,6 +270,9 @@ void QgsGraduatedSymbolRendererV2::stopRender( QgsRenderContext& context )
     delete it2.value();
   }
   mTempSymbols.clear();
+
+  // ranges may change until the next startRender
+  mSortedRangesValid = false;
 }
 
 QList<QString> QgsGraduatedSymbolRendererV2::usedAttributes()
@@ -728,7 +781,7 @@ QgsGraduatedSymbolRendererV2* QgsGraduatedSymbolRendererV2::createRenderer(
     lst.append( attrNum );
     vlayer->select( lst, QgsRectangle(), false );
     while ( vlayer->nextFeature( f ) )
-      values.append( f.attributeMap()[attrNum].toDouble() );
+      values.append( f.attribute( attrNum ).toDouble() );
     // calculate the breaks
     if ( mode == Quantile )
     {
@@ -3,6 +3,8 @@
 
 #include "qgsrendererv2.h"
 
+#include <QVector>
+
 class CORE_EXPORT QgsRendererRangeV2
 {
   public:
@@ -144,6 +146,17 @@ class CORE_EXPORT QgsGraduatedSymbolRendererV2 : public QgsFeatureRendererV2
     QHash<QgsSymbolV2*, QgsSymbolV2*> mTempSymbols;
 #endif
 
+    //! lower and upper bounds of the valid ranges sorted by lower bound,
+    //! built in startRender for binary search of the range of a value
+    QVector<double> mSortedLowerValues;
+    QVector<double> mSortedUpperValues;
+    //! indexes of the sorted ranges in mRanges
+    QVector<int> mSortedRangeIndexes;
+    //! whether the sorted ranges do not overlap and can be binary searched
+    bool mSortedRangesValid;
+
+    void rebuildSortedRanges();
+
     QgsSymbolV2* symbolForValue( double value );
 };
 
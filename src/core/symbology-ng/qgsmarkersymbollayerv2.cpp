@@ -568,8 +568,8 @@ void QgsSvgMarkerSymbolLayerV2::renderPoint( const QPointF& point, QgsSymbolV2Re
 
   if ( drawOnScreen && !rotated )
   {
-    const QImage& img = QgsSvgCache::instance()->svgAsImage( mPath, size, mFillColor, mOutlineColor, mOutlineWidth,
-                        context.renderContext().scaleFactor(), context.renderContext().rasterScaleFactor() );
+    QImage img = QgsSvgCache::instance()->svgAsImage( mPath, size, mFillColor, mOutlineColor, mOutlineWidth,
+                 context.renderContext().scaleFactor(), context.renderContext().rasterScaleFactor() );
     //consider transparency
     if ( !doubleNear( context.alpha(), 1.0 ) )
     {
@@ -585,8 +585,8 @@ void QgsSvgMarkerSymbolLayerV2::renderPoint( const QPointF& point, QgsSymbolV2Re
   else
   {
     p->setOpacity( context.alpha( ) );
-    const QPicture& pct = QgsSvgCache::instance()->svgAsPicture( mPath, size, mFillColor, mOutlineColor, mOutlineWidth,
-                          context.renderContext().scaleFactor(), context.renderContext().rasterScaleFactor() );
+    QPicture pct = QgsSvgCache::instance()->svgAsPicture( mPath, size, mFillColor, mOutlineColor, mOutlineWidth,
+                   context.renderContext().scaleFactor(), context.renderContext().rasterScaleFactor() );
     p->drawPicture( 0, 0, pct );
   }
 
@@ -21,6 +21,7 @@
 #include <QDomElement>
 #include <QFile>
 #include <QImage>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QPicture>
 #include <QSvgRenderer>
@@ -72,8 +73,12 @@ QColor outline;
 
 QgsSvgCache* QgsSvgCache::mInstance = 0;
 
+//the cache is used by the map renderer and map server threads
+static QMutex instanceMutex;
+
 QgsSvgCache* QgsSvgCache::instance()
 {
+  QMutexLocker locker( &instanceMutex );
   if ( !mInstance )
   {
     mInstance = new QgsSvgCache();
@@ -95,9 +100,10 @@ QgsSvgCache::~QgsSvgCache()
 }
 
 
-const QImage& QgsSvgCache::svgAsImage( const QString& file, int size, const QColor& fill, const QColor& outline, double outlineWidth,
-                                       double widthScaleFactor, double rasterScaleFactor )
+QImage QgsSvgCache::svgAsImage( const QString& file, int size, const QColor& fill, const QColor& outline, double outlineWidth,
+                                double widthScaleFactor, double rasterScaleFactor )
 {
+  QMutexLocker locker( &mMutex );
   QgsSvgCacheEntry* currentEntry = cacheEntry( file, size, fill, outline, outlineWidth, widthScaleFactor, rasterScaleFactor );
 
   //if current entry image is 0: cache image for entry
@@ -105,15 +111,18 @@ const QImage& QgsSvgCache::svgAsImage( const QString& file, int size, const QCol
   if ( !currentEntry->image )
   {
     cacheImage( currentEntry );
-    trimToMaximumSize();
   }
 
-  return *( currentEntry->image );
+  //the copy shares the data with the cache entry and stays valid when the entry is trimmed
+  QImage image = *( currentEntry->image );
+  trimToMaximumSize();
+  return image;
 }
 
-const QPicture& QgsSvgCache::svgAsPicture( const QString& file, int size, const QColor& fill, const QColor& outline, double outlineWidth,
-    double widthScaleFactor, double rasterScaleFactor )
+QPicture QgsSvgCache::svgAsPicture( const QString& file, int size, const QColor& fill, const QColor& outline, double outlineWidth,
+                                    double widthScaleFactor, double rasterScaleFactor )
 {
+  QMutexLocker locker( &mMutex );
   QgsSvgCacheEntry* currentEntry = cacheEntry( file, size, fill, outline, outlineWidth, widthScaleFactor, rasterScaleFactor );
 
   //if current entry image is 0: cache image for entry
@@ -121,10 +130,11 @@ const QPicture& QgsSvgCache::svgAsPicture( const QString& file, int size, const
   if ( !currentEntry->picture )
   {
     cachePicture( currentEntry );
-    trimToMaximumSize();
   }
 
-  return *( currentEntry->picture );
+  QPicture picture = *( currentEntry->picture );
+  trimToMaximumSize();
+  return picture;
 }
 
 QgsSvgCacheEntry* QgsSvgCache::insertSVG( const QString& file, int size, const QColor& fill, const QColor& outline, double outlineWidth,
@@ -152,7 +162,7 @@ QgsSvgCacheEntry* QgsSvgCache::insertSVG( const QString& file, int size, const Q
     mMostRecentEntry = entry;
   }
 
-  trimToMaximumSize();
+  //the cache is trimmed after the image / picture of the entry has been taken
   return entry;
 }
 
@@ -21,11 +21,12 @@
 #include <QColor>
 #include <QMap>
 #include <QMultiHash>
+#include <QMutex>
 #include <QString>
+#include <QImage>
+#include <QPicture>
 
 class QDomElement;
-class QImage;
-class QPicture;
 
 struct CORE_EXPORT QgsSvgCacheEntry
 {
@@ -57,7 +58,8 @@ struct CORE_EXPORT QgsSvgCacheEntry
 
 /**A cache for images / pictures derived from svg files. This class supports parameter replacement in svg files
 according to the svg params specification (http://www.w3.org/TR/2009/WD-SVGParamPrimer-20090616/). Supported are
-the parameters 'fill-color', 'pen-color', 'outline-width', 'stroke-width'. E.g. <circle fill="param(fill-color red)" stroke="param(pen-color black)" stroke-width="param(outline-width 1)"*/
+the parameters 'fill-color', 'pen-color', 'outline-width', 'stroke-width'. E.g. <circle fill="param(fill-color red)" stroke="param(pen-color black)" stroke-width="param(outline-width 1)"
+The cache can be used from several threads at the same time.*/
 class CORE_EXPORT QgsSvgCache
 {
   public:
@@ -65,10 +67,14 @@ class CORE_EXPORT QgsSvgCache
     static QgsSvgCache* instance();
     ~QgsSvgCache();
 
-    const QImage& svgAsImage( const QString& file, int size, const QColor& fill, const QColor& outline, double outlineWidth,
-                              double widthScaleFactor, double rasterScaleFactor );
-    const QPicture& svgAsPicture( const QString& file, int size, const QColor& fill, const QColor& outline, double outlineWidth,
-                                  double widthScaleFactor, double rasterScaleFactor );
+    /**Returns the rendered svg. The image shares its data with the cache entry and stays valid when the entry is removed
+      @note the return type changed from a const reference in 1.9*/
+    QImage svgAsImage( const QString& file, int size, const QColor& fill, const QColor& outline, double outlineWidth,
+                       double widthScaleFactor, double rasterScaleFactor );
+    /**Returns the svg as picture. The picture shares its data with the cache entry and stays valid when the entry is removed
+      @note the return type changed from a const reference in 1.9*/
+    QPicture svgAsPicture( const QString& file, int size, const QColor& fill, const QColor& outline, double outlineWidth,
+                           double widthScaleFactor, double rasterScaleFactor );
 
     /**Tests if an svg file contains parameters for fill, outline color, outline width. If yes, possible default values are returned. If there are several
       default values in the svg file, only the first one is considered*/
@@ -111,6 +117,9 @@ class CORE_EXPORT QgsSvgCache
     //Maximum cache size
     static const long mMaximumSize = 20000000;
 
+    /**Guards the entries and the entry list*/
+    QMutex mMutex;
+
     /**Replaces parameters in elements of a dom node and calls method for all child nodes*/
     void replaceElemParams( QDomElement& elem, const QColor& fill, const QColor& outline, double outlineWidth );
 
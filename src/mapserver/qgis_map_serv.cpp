@@ -20,20 +20,32 @@ map service syntax for SOAP/HTTP POST
 #include "qgsapplication.h"
 #include "qgscapabilitiescache.h"
 #include "qgsconfigcache.h"
+#include "qgscrscache.h"
 #include "qgsgetrequesthandler.h"
 #include "qgspostrequesthandler.h"
 #include "qgssoaprequesthandler.h"
 #include "qgsproviderregistry.h"
 #include "qgslogger.h"
 #include "qgswmsserver.h"
+#include "qgsmaplayerregistry.h"
 #include "qgsmaprenderer.h"
 #include "qgsmapserviceexception.h"
+#include "qgsmarkercatalogue.h"
+#include "qgsmslayercache.h"
+#include "qgsmsutils.h"
 #include "qgsprojectparser.h"
+#include "qgsrendererv2registry.h"
 #include "qgssldparser.h"
+#include "qgssvgcache.h"
+#include "qgssymbollayerv2registry.h"
+#include "qgstilecache.h"
+#include <QDir>
 #include <QDomDocument>
 #include <QImage>
+#include <QMutex>
 #include <QSettings>
 #include <QDateTime>
+#include <QThread>
 
 //for CMAKE_INSTALL_PREFIX
 #include "qgsconfig.h"
@@ -79,33 +91,33 @@ void printRequestInfos()
   QgsDebugMsg( "************************new request**********************" );
   QgsDebugMsg( QDateTime::currentDateTime().toString( "yyyy-MM-dd hh:mm:ss" ) );
 
-  if ( getenv( "REMOTE_ADDR" ) != NULL )
+  if ( QgsMSUtils::getEnv( "REMOTE_ADDR" ) != NULL )
   {
-    QgsDebugMsg( "remote ip: " + QString( getenv( "REMOTE_ADDR" ) ) );
+    QgsDebugMsg( "remote ip: " + QString( QgsMSUtils::getEnv( "REMOTE_ADDR" ) ) );
   }
-  if ( getenv( "REMOTE_HOST" ) != NULL )
+  if ( QgsMSUtils::getEnv( "REMOTE_HOST" ) != NULL )
   {
-    QgsDebugMsg( "remote host: " + QString( getenv( "REMOTE_HOST" ) ) );
+    QgsDebugMsg( "remote host: " + QString( QgsMSUtils::getEnv( "REMOTE_HOST" ) ) );
   }
-  if ( getenv( "REMOTE_USER" ) != NULL )
+  if ( QgsMSUtils::getEnv( "REMOTE_USER" ) != NULL )
   {
-    QgsDebugMsg( "remote user: " + QString( getenv( "REMOTE_USER" ) ) );
+    QgsDebugMsg( "remote user: " + QString( QgsMSUtils::getEnv( "REMOTE_USER" ) ) );
   }
-  if ( getenv( "REMOTE_IDENT" ) != NULL )
+  if ( QgsMSUtils::getEnv( "REMOTE_IDENT" ) != NULL )
   {
-    QgsDebugMsg( "REMOTE_IDENT: " + QString( getenv( "REMOTE_IDENT" ) ) );
+    QgsDebugMsg( "REMOTE_IDENT: " + QString( QgsMSUtils::getEnv( "REMOTE_IDENT" ) ) );
   }
-  if ( getenv( "CONTENT_TYPE" ) != NULL )
+  if ( QgsMSUtils::getEnv( "CONTENT_TYPE" ) != NULL )
   {
-    QgsDebugMsg( "CONTENT_TYPE: " + QString( getenv( "CONTENT_TYPE" ) ) );
+    QgsDebugMsg( "CONTENT_TYPE: " + QString( QgsMSUtils::getEnv( "CONTENT_TYPE" ) ) );
   }
-  if ( getenv( "AUTH_TYPE" ) != NULL )
+  if ( QgsMSUtils::getEnv( "AUTH_TYPE" ) != NULL )
   {
-    QgsDebugMsg( "AUTH_TYPE: " + QString( getenv( "AUTH_TYPE" ) ) );
+    QgsDebugMsg( "AUTH_TYPE: " + QString( QgsMSUtils::getEnv( "AUTH_TYPE" ) ) );
   }
-  if ( getenv( "HTTP_USER_AGENT" ) != NULL )
+  if ( QgsMSUtils::getEnv( "HTTP_USER_AGENT" ) != NULL )
   {
-    QgsDebugMsg( "HTTP_USER_AGENT: " + QString( getenv( "HTTP_USER_AGENT" ) ) );
+    QgsDebugMsg( "HTTP_USER_AGENT: " + QString( QgsMSUtils::getEnv( "HTTP_USER_AGENT" ) ) );
   }
 #endif //QGSMSDEBUG
 }
@@ -142,338 +154,504 @@ int fcgi_accept()
 #endif
 }
 
-int main( int argc, char * argv[] )
+/**Reads, processes and answers one request. The request streams are the fcgi_stdio ones or, in threaded mode,
+  the ones set with QgsMSUtils::setCurrentRequest*/
+void processRequest( const QString& defaultConfigFilePath, QgsCapabilitiesCache& capabilitiesCache, QgsTileCache& tileCache,
+                     QgsMapRenderer* theMapRenderer )
 {
-#ifndef _MSC_VER
-  qInstallMsgHandler( dummyMessageHandler );
-#endif
+  printRequestInfos(); //print request infos if in debug mode
 
-  QgsApplication qgsapp( argc, argv, getenv( "DISPLAY" ) );
+  //use QgsGetRequestHandler in case of HTTP GET and QgsSOAPRequestHandler in case of HTTP POST
+  QgsRequestHandler* theRequestHandler = 0;
+  const char* requestMethod = QgsMSUtils::getEnv( "REQUEST_METHOD" );
+  if ( requestMethod != NULL )
+  {
+    if ( strcmp( requestMethod, "POST" ) == 0 )
+    {
+      //QgsDebugMsg( "Creating QgsSOAPRequestHandler" );
+      //theRequestHandler = new QgsSOAPRequestHandler();
+      theRequestHandler = new QgsPostRequestHandler();
+    }
+    else
+    {
+      QgsDebugMsg( "Creating QgsGetRequestHandler" );
+      theRequestHandler = new QgsGetRequestHandler();
+    }
+  }
+  else
+  {
+    QgsDebugMsg( "Creating QgsGetRequestHandler" );
+    theRequestHandler = new QgsGetRequestHandler();
+  }
 
-  //Default prefix path may be altered by environment variable
-  char* prefixPath = getenv( "QGIS_PREFIX_PATH" );
-  if ( prefixPath )
+  QMap<QString, QString> parameterMap;
+
+  try
   {
-    QgsApplication::setPrefixPath( prefixPath, TRUE );
+    parameterMap = theRequestHandler->parseInput();
+  }
+  catch ( QgsMapServiceException& e )
+  {
+    QgsDebugMsg( "An exception was thrown during input parsing" );
+    theRequestHandler->sendServiceException( e );
+    return;
+  }
+
+  QMap<QString, QString>::const_iterator paramIt;
+
+  //set admin config file to wms server object
+  QString configFilePath( defaultConfigFilePath );
+
+  paramIt = parameterMap.find( "MAP" );
+  if ( paramIt == parameterMap.constEnd() )
+  {
+    QgsDebugMsg( QString( "Using default configuration file path: %1" ).arg( defaultConfigFilePath ) );
   }
-#if !defined(Q_OS_WIN)
   else
   {
-    // init QGIS's paths - true means that all path will be inited from prefix
-    QgsApplication::setPrefixPath( CMAKE_INSTALL_PREFIX, TRUE );
+    configFilePath = paramIt.value();
   }
-#endif
 
-  // Instantiate the plugin directory so that providers are loaded
-  QgsProviderRegistry::instance( QgsApplication::pluginPath() );
-  QgsDebugMsg( "Prefix  PATH: " + QgsApplication::prefixPath() );
-  QgsDebugMsg( "Plugin  PATH: " + QgsApplication::pluginPath() );
-  QgsDebugMsg( "PkgData PATH: " + QgsApplication::pkgDataPath() );
-  QgsDebugMsg( "User DB PATH: " + QgsApplication::qgisUserDbFilePath() );
+  QgsConfigParser* adminConfigParser = QgsConfigCache::instance()->searchConfiguration( configFilePath );
+  if ( !adminConfigParser )
+  {
+    QgsDebugMsg( "parse error on config file " + configFilePath );
+    theRequestHandler->sendServiceException( QgsMapServiceException( "", "Configuration file problem : perhaps you left off the .qgs extension?" ) );
+    return;
+  }
 
-  QgsDebugMsg( qgsapp.applicationDirPath() + "/qgis_wms_server.log" );
+  //sld parser might need information about request parameters
+  adminConfigParser->setParameterMap( parameterMap );
 
-  //create config cache and search for config files in the current directory.
-  //These configurations are used if no mapfile parameter is present in the request
-  QString defaultConfigFilePath;
-  QFileInfo projectFileInfo = defaultProjectFile(); //try to find a .qgs file in the server directory
-  if ( projectFileInfo.exists() )
+  //request to WMS?
+  QString serviceString;
+#ifndef QGISDEBUG
+  serviceString = parameterMap.value( "SERVICE", "WMS" );
+#else
+  paramIt = parameterMap.find( "SERVICE" );
+  if ( paramIt == parameterMap.constEnd() )
   {
-    defaultConfigFilePath = projectFileInfo.absoluteFilePath();
+    QgsDebugMsg( "unable to find 'SERVICE' parameter, exiting..." );
+    theRequestHandler->sendServiceException( QgsMapServiceException( "ServiceNotSpecified", "Service not specified. The SERVICE parameter is mandatory" ) );
+    delete theRequestHandler;
+    return;
   }
   else
   {
-    QFileInfo adminSLDFileInfo = defaultAdminSLD();
-    if ( adminSLDFileInfo.exists() )
-    {
-      defaultConfigFilePath = adminSLDFileInfo.absoluteFilePath();
-    }
+    serviceString = paramIt.value();
   }
+#endif
 
-  //create cache for capabilities XML
-  QgsCapabilitiesCache capabilitiesCache;
+  QgsWMSServer* theServer = 0;
+  try
+  {
+    theServer = new QgsWMSServer( parameterMap, theMapRenderer );
+  }
+  catch ( QgsMapServiceException e ) //admin.sld may be invalid
+  {
+    theRequestHandler->sendServiceException( e );
+    return;
+  }
 
-  //creating QgsMapRenderer is expensive (access to srs.db), so we do it here before the fcgi loop
-  QgsMapRenderer* theMapRenderer = new QgsMapRenderer();
+  theServer->setAdminConfigParser( adminConfigParser );
 
-  while ( fcgi_accept() >= 0 )
+
+  //request type
+  QString request = parameterMap.value( "REQUEST" );
+  if ( request.isEmpty() )
   {
-    printRequestInfos(); //print request infos if in debug mode
+    //do some error handling
+    QgsDebugMsg( "unable to find 'REQUEST' parameter, exiting..." );
+    theRequestHandler->sendServiceException( QgsMapServiceException( "OperationNotSupported", "Please check the value of the REQUEST parameter" ) );
+    delete theRequestHandler;
+    delete theServer;
+    return;
+  }
 
-    //use QgsGetRequestHandler in case of HTTP GET and QgsSOAPRequestHandler in case of HTTP POST
-    QgsRequestHandler* theRequestHandler = 0;
-    char* requestMethod = getenv( "REQUEST_METHOD" );
-    if ( requestMethod != NULL )
+  QString version = parameterMap.value( "VERSION", "1.3.0" );
+
+  if ( request == "GetCapabilities" )
+  {
+    const QDomDocument* capabilitiesDocument = capabilitiesCache.searchCapabilitiesDocument( configFilePath, version );
+    if ( !capabilitiesDocument ) //capabilities xml not in cache. Create a new one
     {
-      if ( strcmp( requestMethod, "POST" ) == 0 )
+      QgsDebugMsg( "Capabilities document not found in cache" );
+      QDomDocument doc;
+      try
       {
-        //QgsDebugMsg( "Creating QgsSOAPRequestHandler" );
-        //theRequestHandler = new QgsSOAPRequestHandler();
-        theRequestHandler = new QgsPostRequestHandler();
+        doc = theServer->getCapabilities( version );
       }
-      else
+      catch ( QgsMapServiceException& ex )
       {
-        QgsDebugMsg( "Creating QgsGetRequestHandler" );
-        theRequestHandler = new QgsGetRequestHandler();
+        theRequestHandler->sendServiceException( ex );
+        delete theRequestHandler;
+        delete theServer;
+        return;
       }
+      capabilitiesCache.insertCapabilitiesDocument( configFilePath, version, &doc );
+      capabilitiesDocument = capabilitiesCache.searchCapabilitiesDocument( configFilePath, version );
     }
     else
     {
-      QgsDebugMsg( "Creating QgsGetRequestHandler" );
-      theRequestHandler = new QgsGetRequestHandler();
+      QgsDebugMsg( "Found capabilities document in cache" );
     }
 
-    QMap<QString, QString> parameterMap;
-
+    if ( capabilitiesDocument )
+    {
+      theRequestHandler->sendGetCapabilitiesResponse( *capabilitiesDocument );
+    }
+    delete theRequestHandler;
+    delete theServer;
+    return;
+  }
+  else if ( request == "GetMap" )
+  {
+    QImage* result = 0;
     try
     {
-      parameterMap = theRequestHandler->parseInput();
+      result = theServer->getMap();
     }
-    catch ( QgsMapServiceException& e )
+    catch ( QgsMapServiceException& ex )
     {
-      QgsDebugMsg( "An exception was thrown during input parsing" );
-      theRequestHandler->sendServiceException( e );
-      continue;
+      QgsDebugMsg( "Caught exception during GetMap request" );
+      theRequestHandler->sendServiceException( ex );
+      delete theRequestHandler;
+      delete theServer;
+      return;
     }
 
-    QMap<QString, QString>::const_iterator paramIt;
-
-    //set admin config file to wms server object
-    QString configFilePath( defaultConfigFilePath );
-
-    paramIt = parameterMap.find( "MAP" );
-    if ( paramIt == parameterMap.constEnd() )
+    if ( result )
     {
-      QgsDebugMsg( QString( "Using default configuration file path: %1" ).arg( defaultConfigFilePath ) );
+      QgsDebugMsg( "Sending GetMap response" );
+      theRequestHandler->sendGetMapResponse( serviceString, result );
+      QgsDebugMsg( "Response sent" );
     }
     else
     {
-      configFilePath = paramIt.value();
+      //do some error handling
+      QgsDebugMsg( "result image is 0" );
     }
-
-    QgsConfigParser* adminConfigParser = QgsConfigCache::instance()->searchConfiguration( configFilePath );
-    if ( !adminConfigParser )
+    delete result;
+    delete theRequestHandler;
+    delete theServer;
+    return;
+  }
+  else if ( request == "GetTile" )
+  {
+    QByteArray* tile = 0;
+    QString mimeType;
+    try
     {
-      QgsDebugMsg( "parse error on config file " + configFilePath );
-      theRequestHandler->sendServiceException( QgsMapServiceException( "", "Configuration file problem : perhaps you left off the .qgs extension?" ) );
-      continue;
+      tile = tileCache.getTile( parameterMap, configFilePath, theMapRenderer, adminConfigParser, mimeType );
+    }
+    catch ( QgsMapServiceException& ex )
+    {
+      QgsDebugMsg( "Caught exception during GetTile request" );
+      theRequestHandler->sendServiceException( ex );
     }
 
-    //sld parser might need information about request parameters
-    adminConfigParser->setParameterMap( parameterMap );
-
-    //request to WMS?
-    QString serviceString;
-#ifndef QGISDEBUG
-    serviceString = parameterMap.value( "SERVICE", "WMS" );
-#else
-    paramIt = parameterMap.find( "SERVICE" );
-    if ( paramIt == parameterMap.constEnd() )
+    if ( tile )
     {
-      QgsDebugMsg( "unable to find 'SERVICE' parameter, exiting..." );
-      theRequestHandler->sendServiceException( QgsMapServiceException( "ServiceNotSpecified", "Service not specified. The SERVICE parameter is mandatory" ) );
-      delete theRequestHandler;
-      continue;
+      theRequestHandler->sendGetTileResponse( tile, mimeType );
     }
-    else
+    delete tile;
+    delete theRequestHandler;
+    delete theServer;
+    return;
+  }
+  else if ( request == "GetFeatureInfo" )
+  {
+    QDomDocument featureInfoDoc;
+    try
     {
-      serviceString = paramIt.value();
+      if ( theServer->getFeatureInfo( featureInfoDoc, version ) != 0 )
+      {
+        delete theRequestHandler;
+        delete theServer;
+        return;
+      }
+    }
+    catch ( QgsMapServiceException& ex )
+    {
+      theRequestHandler->sendServiceException( ex );
+      delete theRequestHandler;
+      delete theServer;
+      return;
     }
-#endif
 
-    QgsWMSServer* theServer = 0;
+    //info format for GetFeatureInfo
+    theRequestHandler->sendGetFeatureInfoResponse( featureInfoDoc, parameterMap.value( "INFO_FORMAT" ) );
+    delete theRequestHandler;
+    delete theServer;
+    return;
+  }
+  else if ( request == "GetStyles" || request == "GetStyle" ) // GetStyle for compatibility with earlier QGIS versions
+  {
     try
     {
-      theServer = new QgsWMSServer( parameterMap, theMapRenderer );
+      QDomDocument doc = theServer->getStyle();
+      theRequestHandler->sendGetStyleResponse( doc );
     }
-    catch ( QgsMapServiceException e ) //admin.sld may be invalid
+    catch ( QgsMapServiceException& ex )
     {
-      theRequestHandler->sendServiceException( e );
-      continue;
+      theRequestHandler->sendServiceException( ex );
     }
 
-    theServer->setAdminConfigParser( adminConfigParser );
-
+    delete theRequestHandler;
+    delete theServer;
+    return;
+  }
+  else if ( request == "GetLegendGraphic" || request == "GetLegendGraphics" ) // GetLegendGraphics for compatibility with earlier QGIS versions
+  {
+    QImage* result = 0;
+    try
+    {
+      result = theServer->getLegendGraphics();
+    }
+    catch ( QgsMapServiceException& ex )
+    {
+      theRequestHandler->sendServiceException( ex );
+    }
 
-    //request type
-    QString request = parameterMap.value( "REQUEST" );
-    if ( request.isEmpty() )
+    if ( result )
+    {
+      QgsDebugMsg( "Sending GetLegendGraphic response" );
+      //sending is the same for GetMap and GetLegendGraphic
+      theRequestHandler->sendGetMapResponse( serviceString, result );
+    }
+    else
     {
       //do some error handling
-      QgsDebugMsg( "unable to find 'REQUEST' parameter, exiting..." );
-      theRequestHandler->sendServiceException( QgsMapServiceException( "OperationNotSupported", "Please check the value of the REQUEST parameter" ) );
-      delete theRequestHandler;
-      delete theServer;
-      continue;
+      QgsDebugMsg( "result image is 0" );
     }
+    delete result;
+    delete theRequestHandler;
+    delete theServer;
+    return;
 
-    QString version = parameterMap.value( "VERSION", "1.3.0" );
-
-    if ( request == "GetCapabilities" )
+  }
+  else if ( request == "GetPrint" )
+  {
+    QByteArray* printOutput = 0;
+    try
     {
-      const QDomDocument* capabilitiesDocument = capabilitiesCache.searchCapabilitiesDocument( configFilePath, version );
-      if ( !capabilitiesDocument ) //capabilities xml not in cache. Create a new one
-      {
-        QgsDebugMsg( "Capabilities document not found in cache" );
-        QDomDocument doc;
-        try
-        {
-          doc = theServer->getCapabilities( version );
-        }
-        catch ( QgsMapServiceException& ex )
-        {
-          theRequestHandler->sendServiceException( ex );
-          delete theRequestHandler;
-          delete theServer;
-          continue;
-        }
-        capabilitiesCache.insertCapabilitiesDocument( configFilePath, version, &doc );
-        capabilitiesDocument = capabilitiesCache.searchCapabilitiesDocument( configFilePath, version );
-      }
-      else
-      {
-        QgsDebugMsg( "Found capabilities document in cache" );
-      }
-
-      if ( capabilitiesDocument )
-      {
-        theRequestHandler->sendGetCapabilitiesResponse( *capabilitiesDocument );
-      }
-      delete theRequestHandler;
-      delete theServer;
-      continue;
+      printOutput = theServer->getPrint( theRequestHandler->format() );
     }
-    else if ( request == "GetMap" )
+    catch ( QgsMapServiceException& ex )
     {
-      QImage* result = 0;
-      try
-      {
-        result = theServer->getMap();
-      }
-      catch ( QgsMapServiceException& ex )
-      {
-        QgsDebugMsg( "Caught exception during GetMap request" );
-        theRequestHandler->sendServiceException( ex );
-        delete theRequestHandler;
-        delete theServer;
-        continue;
-      }
+      theRequestHandler->sendServiceException( ex );
+    }
 
-      if ( result )
-      {
-        QgsDebugMsg( "Sending GetMap response" );
-        theRequestHandler->sendGetMapResponse( serviceString, result );
-        QgsDebugMsg( "Response sent" );
-      }
-      else
-      {
-        //do some error handling
-        QgsDebugMsg( "result image is 0" );
-      }
-      delete result;
-      delete theRequestHandler;
-      delete theServer;
-      continue;
+    if ( printOutput )
+    {
+      theRequestHandler->sendGetPrintResponse( printOutput );
     }
-    else if ( request == "GetFeatureInfo" )
+    delete printOutput;
+    delete theRequestHandler;
+    delete theServer;
+    return;
+  }
+  else//unknown request
+  {
+    QgsMapServiceException e( "OperationNotSupported", "Operation " + request + " not supported" );
+    theRequestHandler->sendServiceException( e );
+    delete theRequestHandler;
+    delete theServer;
+  }
+}
+
+/**Worker of the threaded server mode. Accepts requests with FCGX_Accept_r and processes them with its own
+  map renderer and caches. Layers are not shared with other workers (see QgsMSLayerCache)*/
+class QgsServerWorkerThread: public QThread
+{
+  public:
+    QgsServerWorkerThread( const QString& defaultConfigFilePath, const QString& tileCacheDir, int metaTileSize,
+                           qint64 tileCacheMaxSize, int tileCacheMaxAge, QMutex* acceptMutex )
+        : mDefaultConfigFilePath( defaultConfigFilePath )
+        , mTileCacheDir( tileCacheDir )
+        , mMetaTileSize( metaTileSize )
+        , mTileCacheMaxSize( tileCacheMaxSize )
+        , mTileCacheMaxAge( tileCacheMaxAge )
+        , mAcceptMutex( acceptMutex )
+    {}
+
+  protected:
+    void run()
     {
-      QDomDocument featureInfoDoc;
-      try
+      FCGX_Request request;
+      FCGX_InitRequest( &request, 0, 0 );
+      QgsMSUtils::setCurrentRequest( &request );
+
+      QgsCapabilitiesCache capabilitiesCache;
+      QgsTileCache tileCache( mTileCacheDir, mMetaTileSize );
+      tileCache.setMaxSize( mTileCacheMaxSize );
+      tileCache.setMaxAge( mTileCacheMaxAge );
+      QgsMapRenderer* theMapRenderer = new QgsMapRenderer();
+
+      while ( true )
       {
-        if ( theServer->getFeatureInfo( featureInfoDoc, version ) != 0 )
+        int rc;
         {
-          delete theRequestHandler;
-          delete theServer;
-          continue;
+          //some platforms do not allow concurrent accept() on the same socket
+          QMutexLocker locker( mAcceptMutex );
+          rc = FCGX_Accept_r( &request );
         }
-      }
-      catch ( QgsMapServiceException& ex )
-      {
-        theRequestHandler->sendServiceException( ex );
-        delete theRequestHandler;
-        delete theServer;
-        continue;
+        if ( rc < 0 )
+        {
+          break;
+        }
+        processRequest( mDefaultConfigFilePath, capabilitiesCache, tileCache, theMapRenderer );
+        FCGX_Finish_r( &request );
       }
 
-      //info format for GetFeatureInfo
-      theRequestHandler->sendGetFeatureInfoResponse( featureInfoDoc, parameterMap.value( "INFO_FORMAT" ) );
-      delete theRequestHandler;
-      delete theServer;
-      continue;
+      //the registered layers are owned by the layer cache
+      QgsMapLayerRegistry::instance()->mapLayers().clear();
+      delete theMapRenderer;
+      QgsMSUtils::setCurrentRequest( 0 );
     }
-    else if ( request == "GetStyles" || request == "GetStyle" ) // GetStyle for compatibility with earlier QGIS versions
-    {
-      try
-      {
-        QDomDocument doc = theServer->getStyle();
-        theRequestHandler->sendGetStyleResponse( doc );
-      }
-      catch ( QgsMapServiceException& ex )
-      {
-        theRequestHandler->sendServiceException( ex );
-      }
 
-      delete theRequestHandler;
-      delete theServer;
-      continue;
-    }
-    else if ( request == "GetLegendGraphic" || request == "GetLegendGraphics" ) // GetLegendGraphics for compatibility with earlier QGIS versions
-    {
-      QImage* result = 0;
-      try
-      {
-        result = theServer->getLegendGraphics();
-      }
-      catch ( QgsMapServiceException& ex )
-      {
-        theRequestHandler->sendServiceException( ex );
-      }
+  private:
+    QString mDefaultConfigFilePath;
+    QString mTileCacheDir;
+    int mMetaTileSize;
+    qint64 mTileCacheMaxSize;
+    int mTileCacheMaxAge;
+    QMutex* mAcceptMutex;
+};
 
-      if ( result )
-      {
-        QgsDebugMsg( "Sending GetLegendGraphic response" );
-        //sending is the same for GetMap and GetLegendGraphic
-        theRequestHandler->sendGetMapResponse( serviceString, result );
-      }
-      else
-      {
-        //do some error handling
-        QgsDebugMsg( "result image is 0" );
-      }
-      delete result;
-      delete theRequestHandler;
-      delete theServer;
-      continue;
+int main( int argc, char * argv[] )
+{
+#ifndef _MSC_VER
+  qInstallMsgHandler( dummyMessageHandler );
+#endif
 
-    }
-    else if ( request == "GetPrint" )
+  QgsApplication qgsapp( argc, argv, getenv( "DISPLAY" ) );
+
+  //Default prefix path may be altered by environment variable
+  char* prefixPath = getenv( "QGIS_PREFIX_PATH" );
+  if ( prefixPath )
+  {
+    QgsApplication::setPrefixPath( prefixPath, TRUE );
+  }
+#if !defined(Q_OS_WIN)
+  else
+  {
+    // init QGIS's paths - true means that all path will be inited from prefix
+    QgsApplication::setPrefixPath( CMAKE_INSTALL_PREFIX, TRUE );
+  }
+#endif
+
+  // Instantiate the plugin directory so that providers are loaded
+  QgsProviderRegistry::instance( QgsApplication::pluginPath() );
+  QgsDebugMsg( "Prefix  PATH: " + QgsApplication::prefixPath() );
+  QgsDebugMsg( "Plugin  PATH: " + QgsApplication::pluginPath() );
+  QgsDebugMsg( "PkgData PATH: " + QgsApplication::pkgDataPath() );
+  QgsDebugMsg( "User DB PATH: " + QgsApplication::qgisUserDbFilePath() );
+
+  QgsDebugMsg( qgsapp.applicationDirPath() + "/qgis_wms_server.log" );
+
+  //create config cache and search for config files in the current directory.
+  //These configurations are used if no mapfile parameter is present in the request
+  QString defaultConfigFilePath;
+  QFileInfo projectFileInfo = defaultProjectFile(); //try to find a .qgs file in the server directory
+  if ( projectFileInfo.exists() )
+  {
+    defaultConfigFilePath = projectFileInfo.absoluteFilePath();
+  }
+  else
+  {
+    QFileInfo adminSLDFileInfo = defaultAdminSLD();
+    if ( adminSLDFileInfo.exists() )
     {
-      QByteArray* printOutput = 0;
-      try
-      {
-        printOutput = theServer->getPrint( theRequestHandler->format() );
-      }
-      catch ( QgsMapServiceException& ex )
-      {
-        theRequestHandler->sendServiceException( ex );
-      }
+      defaultConfigFilePath = adminSLDFileInfo.absoluteFilePath();
+    }
+  }
 
-      if ( printOutput )
-      {
-        theRequestHandler->sendGetPrintResponse( printOutput );
-      }
-      delete printOutput;
-      delete theRequestHandler;
-      delete theServer;
-      continue;
+  //create cache for capabilities XML
+  QgsCapabilitiesCache capabilitiesCache;
+
+  //create disk cache for GetTile requests. Location, metatile size, size limit (MB) and tile age limit (seconds)
+  //may be altered by environment variables
+  QString tileCacheDir = QDir::tempPath() + "/qgis_mapserv_tiles";
+  char* tileCacheDirEnv = getenv( "QGIS_TILECACHE_DIR" );
+  if ( tileCacheDirEnv )
+  {
+    tileCacheDir = tileCacheDirEnv;
+  }
+  int metaTileSize = 4;
+  char* metaTileSizeEnv = getenv( "QGIS_TILECACHE_METATILE" );
+  if ( metaTileSizeEnv )
+  {
+    metaTileSize = QString( metaTileSizeEnv ).toInt();
+  }
+  qint64 tileCacheMaxSize = Q_INT64_C( 1024 ) * 1024 * 1024;
+  char* tileCacheMaxSizeEnv = getenv( "QGIS_TILECACHE_MAXSIZE" );
+  if ( tileCacheMaxSizeEnv )
+  {
+    tileCacheMaxSize = QString( tileCacheMaxSizeEnv ).toLongLong() * 1024 * 1024;
+  }
+  int tileCacheMaxAge = 0;
+  char* tileCacheMaxAgeEnv = getenv( "QGIS_TILECACHE_MAXAGE" );
+  if ( tileCacheMaxAgeEnv )
+  {
+    tileCacheMaxAge = QString( tileCacheMaxAgeEnv ).toInt();
+  }
+
+  //number of worker threads. With more than one, requests are processed concurrently inside this process
+  int nThreads = 1;
+  char* threadsEnv = getenv( "QGIS_SERVER_THREADS" );
+  if ( threadsEnv )
+  {
+    nThreads = qMax( 1, QString( threadsEnv ).toInt() );
+  }
+  if ( FCGX_IsCGI() )
+  {
+    nThreads = 1;
+  }
+
+  if ( nThreads > 1 )
+  {
+    QgsDebugMsg( QString( "Starting %1 worker threads" ).arg( nThreads ) );
+    //every worker registers its own layer instances under the project layer ids
+    QgsMapLayerRegistry::setThreadLocalInstances( true );
+    //create the shared singletons before the workers start. The caches among them are thread safe,
+    //the registries and the marker catalogue are only read by the workers
+    QgsMSLayerCache::instance();
+    QgsCRSCache::instance();
+    QgsSvgCache::instance();
+    QgsMarkerCatalogue::instance();
+    QgsSymbolLayerV2Registry::instance();
+    QgsRendererV2Registry::instance();
+
+    FCGX_Init();
+    QMutex acceptMutex;
+    QList<QgsServerWorkerThread*> workers;
+    for ( int i = 0; i < nThreads; ++i )
+    {
+      QgsServerWorkerThread* worker = new QgsServerWorkerThread( defaultConfigFilePath, tileCacheDir, metaTileSize,
+          tileCacheMaxSize, tileCacheMaxAge, &acceptMutex );
+      worker->start();
+      workers.append( worker );
     }
-    else//unknown request
+    foreach( QgsServerWorkerThread* worker, workers )
     {
-      QgsMapServiceException e( "OperationNotSupported", "Operation " + request + " not supported" );
-      theRequestHandler->sendServiceException( e );
-      delete theRequestHandler;
-      delete theServer;
+      worker->wait();
     }
+    qDeleteAll( workers );
+    QgsDebugMsg( "************* all done ***************" );
+    return 0;
+  }
+
+  QgsTileCache tileCache( tileCacheDir, metaTileSize );
+  tileCache.setMaxSize( tileCacheMaxSize );
+  tileCache.setMaxAge( tileCacheMaxAge );
+
+  //creating QgsMapRenderer is expensive (access to srs.db), so we do it here before the fcgi loop
+  QgsMapRenderer* theMapRenderer = new QgsMapRenderer();
+
+  while ( fcgi_accept() >= 0 )
+  {
+    processRequest( defaultConfigFilePath, capabilitiesCache, tileCache, theMapRenderer );
   }
 
   delete theMapRenderer;
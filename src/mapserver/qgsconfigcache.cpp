@@ -21,16 +21,18 @@
 #include "qgsprojectparser.h"
 #include "qgssldparser.h"
 #include <QCoreApplication>
+#include <QThreadStorage>
 
-QgsConfigCache* QgsConfigCache::mInstance = 0;
+//config parsers keep request state (parameter map, scale, external GML), so every thread has its own cache
+static QThreadStorage<QgsConfigCache*> threadInstances;
 
 QgsConfigCache* QgsConfigCache::instance()
 {
-  if ( !mInstance )
+  if ( !threadInstances.hasLocalData() )
   {
-    mInstance = new QgsConfigCache();
+    threadInstances.setLocalData( new QgsConfigCache() );
   }
-  return mInstance;
+  return threadInstances.localData();
 }
 
 QgsConfigCache::QgsConfigCache()
@@ -25,7 +25,7 @@
 
 class QgsConfigParser;
 
-/**A cache for configuration XML (useful because of the mapfile parameter)*/
+/**A cache for configuration XML (useful because of the mapfile parameter). There is one instance per thread*/
 class QgsConfigCache: public QObject
 {
     Q_OBJECT
@@ -40,8 +40,6 @@ class QgsConfigCache: public QObject
     QgsConfigCache();
 
   private:
-    static QgsConfigCache* mInstance;
-
     /**Creates configuration parser depending on the file type and, if successfull, inserts it to the cached configuration map
         @param filePath path of the configuration file
         @return the inserted config parser or 0 in case of error*/
@@ -1,5 +1,6 @@
 #include "qgsgetrequesthandler.h"
 #include "qgslogger.h"
+#include "qgsmsutils.h"
 #include "qgsremotedatasourcebuilder.h"
 #include <QStringList>
 #include <QUrl>
@@ -15,7 +16,7 @@ QMap<QString, QString> QgsGetRequestHandler::parseInput()
   QString queryString;
   QMap<QString, QString> parameters;
 
-  const char* qs = getenv( "QUERY_STRING" );
+  const char* qs = QgsMSUtils::getEnv( "QUERY_STRING" );
   if ( qs )
   {
     queryString = QString( qs );
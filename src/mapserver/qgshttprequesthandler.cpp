@@ -20,6 +20,7 @@
 #include "qgshttptransaction.h"
 #include "qgslogger.h"
 #include "qgsmapserviceexception.h"
+#include "qgsmsutils.h"
 #include <QBuffer>
 #include <QByteArray>
 #include <QDomDocument>
@@ -57,17 +58,12 @@ void QgsHttpRequestHandler::sendHttpResponse( QByteArray* ba, const QString& for
   QgsDebugMsg( "Byte array looks good, returning response..." );
   QgsDebugMsg( QString( "Content size: %1" ).arg( ba->size() ) );
   QgsDebugMsg( QString( "Content format: %1" ).arg( format ) );
-  printf( "Content-Type: " );
-  printf( format.toLocal8Bit() );
-  printf( "\n" );
-  printf( "Content-Length: %d\n", ba->size() );
-  printf( "\n" );
-  int result = fwrite( ba->data(), ba->size(), 1, FCGI_stdout );
-#ifdef QGISDEBUG
-  QgsDebugMsg( QString( "Sent %1 bytes" ).arg( result ) );
-#else
-  Q_UNUSED( result );
-#endif
+  QByteArray header = "Content-Type: " + format.toLocal8Bit() + "\n";
+  header += "Content-Length: " + QByteArray::number( ba->size() ) + "\n";
+  header += "\n";
+  QgsMSUtils::writeOutput( header.constData(), header.size() );
+  QgsMSUtils::writeOutput( ba->constData(), ba->size() );
+  QgsDebugMsg( QString( "Sent %1 bytes" ).arg( ba->size() ) );
 }
 
 QString QgsHttpRequestHandler::formatToMimeType( const QString& format ) const
@@ -277,6 +273,11 @@ void QgsHttpRequestHandler::sendGetPrintResponse( QByteArray* ba ) const
   sendHttpResponse( ba, formatToMimeType( mFormat ) );
 }
 
+void QgsHttpRequestHandler::sendGetTileResponse( QByteArray* ba, const QString& mimeType ) const
+{
+  sendHttpResponse( ba, mimeType );
+}
+
 void QgsHttpRequestHandler::requestStringToParameterMap( const QString& request, QMap<QString, QString>& parameters )
 {
   parameters.clear();
@@ -370,13 +371,13 @@ void QgsHttpRequestHandler::requestStringToParameterMap( const QString& request,
 
 QString QgsHttpRequestHandler::readPostBody() const
 {
-  char* lengthString = NULL;
+  const char* lengthString = NULL;
   int length = 0;
   char* input = NULL;
   QString inputString;
   QString lengthQString;
 
-  lengthString = getenv( "CONTENT_LENGTH" );
+  lengthString = QgsMSUtils::getEnv( "CONTENT_LENGTH" );
   if ( lengthString != NULL )
   {
     bool conversionSuccess = false;
@@ -389,7 +390,7 @@ QString QgsHttpRequestHandler::readPostBody() const
       memset( input, 0, length + 1 );
       for ( int i = 0; i < length; ++i )
       {
-        input[i] = getchar();
+        input[i] = QgsMSUtils::readInputChar();
       }
       //fgets(input, length+1, stdin);
       if ( input != NULL )
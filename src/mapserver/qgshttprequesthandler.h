@@ -34,6 +34,7 @@ class QgsHttpRequestHandler: public QgsRequestHandler
     virtual void sendServiceException( const QgsMapServiceException& ex ) const;
     virtual void sendGetStyleResponse( const QDomDocument& doc ) const;
     virtual void sendGetPrintResponse( QByteArray* ba ) const;
+    virtual void sendGetTileResponse( QByteArray* ba, const QString& mimeType ) const;
 
   protected:
     void sendHttpResponse( QByteArray* ba, const QString& format ) const;
@@ -19,6 +19,7 @@
 #include "qgsvectorlayer.h"
 #include "qgslogger.h"
 #include <QFile>
+#include <QThread>
 
 //maximum number of layers in the cache
 #define DEFAULT_MAX_N_LAYERS 100
@@ -51,13 +52,14 @@ QgsMSLayerCache::~QgsMSLayerCache()
 void QgsMSLayerCache::insertLayer( const QString& url, const QString& layerName, QgsMapLayer* layer, const QList<QString>& tempFiles )
 {
   QgsDebugMsg( "inserting layer" );
+  QMutexLocker locker( &mMutex );
   if ( mEntries.size() > std::max( DEFAULT_MAX_N_LAYERS, mProjectMaxLayers ) ) //force cache layer examination after 10 inserted layers
   {
     updateEntries();
   }
 
-  QPair<QString, QString> urlLayerPair = qMakePair( url, layerName );
-  QHash<QPair<QString, QString>, QgsMSLayerCacheEntry>::iterator it = mEntries.find( urlLayerPair );
+  QgsMSLayerCacheKey urlLayerPair = qMakePair( qMakePair( url, layerName ), QThread::currentThread() );
+  QHash<QgsMSLayerCacheKey, QgsMSLayerCacheEntry>::iterator it = mEntries.find( urlLayerPair );
   if ( it != mEntries.end() )
   {
     delete it.value().layerPointer;
@@ -69,13 +71,15 @@ void QgsMSLayerCache::insertLayer( const QString& url, const QString& layerName,
   newEntry.creationTime = time( NULL );
   newEntry.lastUsedTime = time( NULL );
   newEntry.temporaryFiles = tempFiles;
+  newEntry.thread = QThread::currentThread();
 
   mEntries.insert( urlLayerPair, newEntry );
 }
 
 QgsMapLayer* QgsMSLayerCache::searchLayer( const QString& url, const QString& layerName )
 {
-  QPair<QString, QString> urlNamePair = qMakePair( url, layerName );
+  QgsMSLayerCacheKey urlNamePair = qMakePair( qMakePair( url, layerName ), QThread::currentThread() );
+  QMutexLocker locker( &mMutex );
   if ( !mEntries.contains( urlNamePair ) )
   {
     QgsDebugMsg( "Layer not found in cache" );
@@ -121,19 +125,26 @@ void QgsMSLayerCache::removeLeastUsedEntry()
     return;
   }
   QgsDebugMsg( "removeLeastUsedEntry" );
-  QHash<QPair<QString, QString>, QgsMSLayerCacheEntry>::iterator it = mEntries.begin();
-  QHash<QPair<QString, QString>, QgsMSLayerCacheEntry>::iterator lowest_it = it;
-  time_t lowest_time = it->lastUsedTime;
+  //layers of other threads may be in use
+  QThread* currentThread = QThread::currentThread();
+  QHash<QgsMSLayerCacheKey, QgsMSLayerCacheEntry>::iterator it = mEntries.begin();
+  QHash<QgsMSLayerCacheKey, QgsMSLayerCacheEntry>::iterator lowest_it = mEntries.end();
+  time_t lowest_time = 0;
 
   for ( ; it != mEntries.end(); ++it )
   {
-    if ( it->lastUsedTime < lowest_time )
+    if ( it->thread == currentThread && ( lowest_it == mEntries.end() || it->lastUsedTime < lowest_time ) )
     {
       lowest_it = it;
       lowest_time = it->lastUsedTime;
     }
   }
 
+  if ( lowest_it == mEntries.end() )
+  {
+    return;
+  }
+
   freeEntryRessources( *lowest_it );
   mEntries.erase( lowest_it );
 }
@@ -20,10 +20,12 @@
 
 #include <time.h>
 #include <QHash>
+#include <QMutex>
 #include <QPair>
 #include <QString>
 
 class QgsMapLayer;
+class QThread;
 
 struct QgsMSLayerCacheEntry
 {
@@ -32,10 +34,15 @@ struct QgsMSLayerCacheEntry
   QString url; //datasource url
   QgsMapLayer* layerPointer;
   QList<QString> temporaryFiles; //path to the temporary files written for the layer
+  QThread* thread; //thread which created and uses the layer
 };
 
+/**Cache key: datasource url, layer name and the thread using the layer*/
+typedef QPair< QPair<QString, QString>, QThread* > QgsMSLayerCacheKey;
+
 /**A singleton class that caches layer objects for the
-QGIS mapserver*/
+QGIS mapserver. The cache is thread safe. Layers (and their provider connections) are never
+shared between threads: in the threaded server mode, every worker thread gets its own layer instances*/
 class QgsMSLayerCache
 {
   public:
@@ -47,7 +54,7 @@ class QgsMSLayerCache
     @param layerName the layer name (to distinguish between different layers in a request using the same datasource
     @param tempFiles some layers have temporary files. The cash makes sure they are removed when removing the layer from the cash*/
     void insertLayer( const QString& url, const QString& layerName, QgsMapLayer* layer, const QList<QString>& tempFiles = QList<QString>() );
-    /**Searches for the layer with the given url.
+    /**Searches for the layer with the given url created by the calling thread.
      @return a pointer to the layer or 0 if no such layer*/
     QgsMapLayer* searchLayer( const QString& url, const QString& layerName );
 
@@ -62,7 +69,7 @@ class QgsMSLayerCache
      depending on their time stamps and the number of other
     layers*/
     void updateEntries();
-    /**Removes the cash entry with the lowest 'lastUsedTime'*/
+    /**Removes the cash entry of the calling thread with the lowest 'lastUsedTime'*/
     void removeLeastUsedEntry();
     /**Frees memory and removes temporary files of an entry*/
     void freeEntryRessources( QgsMSLayerCacheEntry& entry );
@@ -73,7 +80,8 @@ class QgsMSLayerCache
     /**Cash entries with pair url/layer name as a key. The layer name is necessary for cases where the same
       url is used several time in a request. It ensures that different layer instances are created for different
       layer names*/
-    QHash<QPair<QString, QString>, QgsMSLayerCacheEntry> mEntries;
+    QHash<QgsMSLayerCacheKey, QgsMSLayerCacheEntry> mEntries;
+    QMutex mMutex;
 
     /**Maximum number of layers in the cache, overrides DEFAULT_MAX_N_LAYERS if larger*/
     int mProjectMaxLayers;
@@ -5,6 +5,26 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QTextStream>
+#include <QThreadStorage>
+
+#include <fcgi_stdio.h>
+
+namespace
+{
+  /**Holder for the request of a worker thread (QThreadStorage deletes its data when the thread ends,
+    the request itself is owned by the worker)*/
+  struct QgsMSRequestHolder
+  {
+    FCGX_Request* request;
+  };
+
+  QThreadStorage<QgsMSRequestHolder*> currentRequestStorage;
+
+  FCGX_Request* currentRequest()
+  {
+    return currentRequestStorage.hasLocalData() ? currentRequestStorage.localData()->request : 0;
+  }
+}
 
 QString QgsMSUtils::createTempFilePath()
 {
@@ -68,3 +88,45 @@ int QgsMSUtils::createTextFile( QString filePath, const QString& text )
     return 1;
   }
 }
+
+void QgsMSUtils::setCurrentRequest( FCGX_Request* request )
+{
+  if ( !currentRequestStorage.hasLocalData() )
+  {
+    currentRequestStorage.setLocalData( new QgsMSRequestHolder );
+  }
+  currentRequestStorage.localData()->request = request;
+}
+
+const char* QgsMSUtils::getEnv( const char* name )
+{
+  FCGX_Request* request = currentRequest();
+  if ( request )
+  {
+    return FCGX_GetParam( name, request->envp );
+  }
+  return getenv( name );
+}
+
+void QgsMSUtils::writeOutput( const char* data, int length )
+{
+  FCGX_Request* request = currentRequest();
+  if ( request )
+  {
+    FCGX_PutStr( data, length, request->out );
+  }
+  else
+  {
+    fwrite( data, length, 1, FCGI_stdout );
+  }
+}
+
+int QgsMSUtils::readInputChar()
+{
+  FCGX_Request* request = currentRequest();
+  if ( request )
+  {
+    return FCGX_GetChar( request->in );
+  }
+  return getchar();
+}
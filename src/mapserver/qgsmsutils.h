@@ -3,6 +3,8 @@
 
 #include <QString>
 
+struct FCGX_Request;
+
 /**Some utility functions that may be included from everywhere in the code*/
 namespace QgsMSUtils
 {
@@ -12,6 +14,17 @@ namespace QgsMSUtils
   QString createTempFilePath();
   /**Stores the specified text in a temporary file. Returns 0 in case of success*/
   int createTextFile( QString filePath, const QString& text );
+
+  /**Sets the FastCGI request processed by the calling thread. Used by the threaded server mode, where every worker
+    thread accepts its own requests with FCGX_Accept_r. If no request is set (0), the process wide fcgi_stdio
+    streams and environment are used*/
+  void setCurrentRequest( FCGX_Request* request );
+  /**Returns the value of a CGI environment variable of the current request or 0 if it is not set*/
+  const char* getEnv( const char* name );
+  /**Writes data to the output stream of the current request*/
+  void writeOutput( const char* data, int length );
+  /**Reads one character from the input stream of the current request. Returns EOF at the end of the stream*/
+  int readInputChar();
 }
 
 #endif
@@ -1452,7 +1452,7 @@ void QgsProjectParser::setSelectionColor()
   QgsRenderer::setSelectionColor( QColor( red, green, blue, alpha ) );
 }
 
-const QgsCoordinateReferenceSystem& QgsProjectParser::projectCRS() const
+QgsCoordinateReferenceSystem QgsProjectParser::projectCRS() const
 {
   //mapcanvas->destinationsrs->spatialrefsys->authid
   if ( mXMLDoc )
@@ -158,7 +158,7 @@ class QgsProjectParser: public QgsConfigParser
     void setSelectionColor();
 
     /**Returns mapcanvas output CRS from project file*/
-    const QgsCoordinateReferenceSystem& projectCRS() const;
+    QgsCoordinateReferenceSystem projectCRS() const;
 
     /**Returns bbox of layer in project CRS (or empty rectangle in case of error)*/
     QgsRectangle layerBoundingBoxInProjectCRS( const QDomElement& layerElem ) const;
@@ -41,6 +41,8 @@ class QgsRequestHandler
     virtual void sendServiceException( const QgsMapServiceException& ex ) const = 0;
     virtual void sendGetStyleResponse( const QDomDocument& doc ) const = 0;
     virtual void sendGetPrintResponse( QByteArray* ba ) const = 0;
+    /**Sends an encoded tile of a GetTile request back to the client*/
+    virtual void sendGetTileResponse( QByteArray* ba, const QString& mimeType ) const = 0;
     QString format() const { return mFormat; }
   protected:
     /**This is set by the parseInput methods of the subclasses (parameter FORMAT, e.g. 'FORMAT=PNG')*/
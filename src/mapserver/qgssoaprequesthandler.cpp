@@ -18,6 +18,7 @@
 #include "qgssoaprequesthandler.h"
 #include "qgslogger.h"
 #include "qgsmapserviceexception.h"
+#include "qgsmsutils.h"
 #include <QBuffer>
 #include <QDir>
 #include <QDomDocument>
@@ -680,32 +681,34 @@ int QgsSOAPRequestHandler::sendSOAPWithAttachments( QImage* img ) const
   img->save( &buffer, mFormat.toLocal8Bit().data(), -1 ); // writes image into ba
 
   QByteArray xmlByteArray = xmlResponse.toString().toLocal8Bit();
-  printf( "MIME-Version: 1.0\n" );
-  printf( "Content-Type: Multipart/Related; boundary=\"MIME_boundary\"; type=\"text/xml\"; start=\"<xml@mapservice>\"\n" );
-  printf( "\n" );
-  printf( "--MIME_boundary\r\n" );
-  printf( "Content-Type: text/xml\n" );
-  printf( "Content-ID: <xml@mapservice>\n" );
-  printf( "\n" );
-  printf( "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" );
-  fwrite( xmlByteArray.data(), xmlByteArray.size(), 1, FCGI_stdout );
-  printf( "\n" );
-  printf( "\r\n" );
-  printf( "--MIME_boundary\r\n" );
+  QByteArray response;
+  response += "MIME-Version: 1.0\n";
+  response += "Content-Type: Multipart/Related; boundary=\"MIME_boundary\"; type=\"text/xml\"; start=\"<xml@mapservice>\"\n";
+  response += "\n";
+  response += "--MIME_boundary\r\n";
+  response += "Content-Type: text/xml\n";
+  response += "Content-ID: <xml@mapservice>\n";
+  response += "\n";
+  response += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+  response += xmlByteArray;
+  response += "\n";
+  response += "\r\n";
+  response += "--MIME_boundary\r\n";
   if ( mFormat == "JPG" )
   {
-    printf( "Content-Type: image/jpg\n" );
+    response += "Content-Type: image/jpg\n";
   }
   else if ( mFormat == "PNG" )
   {
-    printf( "Content-Type: image/png\n" );
+    response += "Content-Type: image/png\n";
   }
-  printf( "Content-Transfer-Encoding: binary\n" );
-  printf( "Content-ID: <image@mapservice>\n" );
-  printf( "\n" );
-  fwrite( ba.data(), ba.size(), 1, FCGI_stdout );
-  printf( "\r\n" );
-  printf( "--MIME_boundary\r\n" );
+  response += "Content-Transfer-Encoding: binary\n";
+  response += "Content-ID: <image@mapservice>\n";
+  response += "\n";
+  response += ba;
+  response += "\r\n";
+  response += "--MIME_boundary\r\n";
+  QgsMSUtils::writeOutput( response.constData(), response.size() );
 
   return 0;
 }
@@ -0,0 +1,457 @@
+/***************************************************************************
+                              qgstilecache.cpp
+                              ----------------
+  begin                : March 2012
+  copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstilecache.h"
+#include "qgsconfigparser.h"
+#include "qgslogger.h"
+#include "qgsmapserviceexception.h"
+#include "qgswmsserver.h"
+#include <QBuffer>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QTemporaryFile>
+
+//the cache is pruned after this many seconds at most if a maximum age is set
+#define MAX_PRUNE_INTERVAL 3600
+
+/**A file in the tile cache directory. Sorts by modification time*/
+struct QgsTileCacheFile
+{
+  uint modified;
+  qint64 size;
+  QString path;
+  bool operator<( const QgsTileCacheFile& other ) const { return modified < other.modified; }
+};
+
+/**Prune state of a cache directory. The worker threads of the server each have their own
+  QgsTileCache, but the directory is pruned by one of them at a time*/
+struct QgsTileCachePruneState
+{
+  QgsTileCachePruneState(): bytesSincePrune( 0 ), pruning( false ) {}
+  /**Time of the last prune*/
+  QDateTime lastPrune;
+  /**Bytes written to the directory since the last prune*/
+  qint64 bytesSincePrune;
+  /**A thread is pruning the directory*/
+  bool pruning;
+};
+
+static QMutex sPruneMutex;
+/**Key: cache directory*/
+static QHash<QString, QgsTileCachePruneState> sPruneStates;
+
+QgsTileCache::QgsTileCache( const QString& cacheDirectory, int metaTileSize, int gutter )
+    : mCacheDirectory( cacheDirectory )
+    , mMetaTileSize( qMax( 1, metaTileSize ) )
+    , mGutter( qMax( 0, gutter ) )
+    , mMaxSize( 0 )
+    , mMaxAge( 0 )
+    , mCacheHits( 0 )
+    , mCacheMisses( 0 )
+{
+  QDir().mkpath( mCacheDirectory );
+}
+
+QgsTileCache::~QgsTileCache()
+{
+  QgsDebugMsg( QString( "Tile cache hits: %1 misses: %2" ).arg( mCacheHits ).arg( mCacheMisses ) );
+}
+
+bool QgsTileCache::tileGrid( const QString& name, QgsTileGrid& grid )
+{
+  if ( name.compare( "EPSG:3857", Qt::CaseInsensitive ) == 0
+       || name.compare( "EPSG:900913", Qt::CaseInsensitive ) == 0
+       || name.compare( "GoogleMapsCompatible", Qt::CaseInsensitive ) == 0 )
+  {
+    grid.name = "EPSG:3857";
+    grid.crs = "EPSG:3857";
+    grid.originX = -20037508.342789244;
+    grid.originY = 20037508.342789244;
+    grid.resolution = 2 * 20037508.342789244 / 256;
+    grid.matrixWidth = 1;
+    grid.matrixHeight = 1;
+    grid.tileSize = 256;
+    grid.maxZoom = 20;
+    return true;
+  }
+  else if ( name.compare( "EPSG:4326", Qt::CaseInsensitive ) == 0 )
+  {
+    grid.name = "EPSG:4326";
+    grid.crs = "EPSG:4326";
+    grid.originX = -180.0;
+    grid.originY = 90.0;
+    grid.resolution = 180.0 / 256;
+    grid.matrixWidth = 2;
+    grid.matrixHeight = 1;
+    grid.tileSize = 256;
+    grid.maxZoom = 20;
+    return true;
+  }
+  return false;
+}
+
+QByteArray* QgsTileCache::getTile( const QMap<QString, QString>& parameters, const QString& configFilePath, QgsMapRenderer* renderer,
+                                   QgsConfigParser* adminConfigParser, QString& mimeType )
+{
+  QgsTileGrid grid;
+  QString gridName = parameters.value( "TILEMATRIXSET", "EPSG:3857" );
+  if ( !tileGrid( gridName, grid ) )
+  {
+    throw QgsMapServiceException( "InvalidParameterValue", "Tile matrix set " + gridName + " is not supported" );
+  }
+
+  //TILEMATRIX may be given as 'zoom' or as '<tile matrix set>:zoom'
+  bool zoomOk, rowOk, colOk;
+  int zoom = parameters.value( "TILEMATRIX" ).section( ":", -1 ).toInt( &zoomOk );
+  int row = parameters.value( "TILEROW" ).toInt( &rowOk );
+  int col = parameters.value( "TILECOL" ).toInt( &colOk );
+  if ( !zoomOk || !rowOk || !colOk )
+  {
+    throw QgsMapServiceException( "MissingParameterValue", "TILEMATRIX, TILEROW and TILECOL are mandatory for GetTile" );
+  }
+  if ( zoom < 0 || zoom > grid.maxZoom || row < 0 || col < 0
+       || row >= ( grid.matrixHeight << zoom ) || col >= ( grid.matrixWidth << zoom ) )
+  {
+    throw QgsMapServiceException( "TileOutOfRange", "The requested tile is outside of the tile matrix set" );
+  }
+
+  QString layers = parameters.value( "LAYERS", parameters.value( "LAYER" ) );
+  if ( layers.isEmpty() )
+  {
+    throw QgsMapServiceException( "MissingParameterValue", "LAYERS parameter is mandatory for GetTile" );
+  }
+  QString styles = parameters.value( "STYLES", parameters.value( "STYLE" ) );
+
+  QString format = parameters.value( "FORMAT", "image/png" );
+  QString imageFormat, suffix;
+  if ( format.contains( "jpg", Qt::CaseInsensitive ) || format.contains( "jpeg", Qt::CaseInsensitive ) )
+  {
+    imageFormat = "JPG";
+    suffix = "jpg";
+    mimeType = "image/jpeg";
+  }
+  else
+  {
+    imageFormat = "PNG";
+    suffix = "png";
+    mimeType = "image/png";
+  }
+
+  QMap<QString, QString> mapParameters = parameters;
+  mapParameters.insert( "LAYERS", layers );
+  mapParameters.insert( "STYLES", styles );
+
+  //client side styles, filters and selections are arbitrary. Caching them would fill the disk with tiles that are never requested again
+  if ( !parameters.value( "SLD" ).isEmpty() || !parameters.value( "FILTER" ).isEmpty() || !parameters.value( "SELECTION" ).isEmpty() )
+  {
+    ++mCacheMisses;
+    return new QByteArray( renderMetaTile( mapParameters, grid, zoom, row, col, QString(), imageFormat, suffix, renderer, adminConfigParser ) );
+  }
+
+  //everything besides the tile position that changes the rendered image goes into the cache key
+  QStringList keyParts;
+  keyParts << layers << styles << imageFormat
+  << parameters.value( "TRANSPARENT" ).toLower()
+  << parameters.value( "DPI" );
+  QString zoomDirectory = projectDirectory( configFilePath ) + "/" + hash( keyParts.join( "|" ) )
+                          + "/" + QString( grid.name ).replace( ":", "_" ) + "/" + QString::number( zoom );
+
+  QString tilePath = zoomDirectory + "/" + QString::number( row ) + "/" + QString::number( col ) + "." + suffix;
+  QFileInfo tileInfo( tilePath );
+  if ( mMaxAge > 0 && tileInfo.exists() && tileInfo.lastModified().secsTo( QDateTime::currentDateTime() ) > mMaxAge )
+  {
+    //expired. Removed so that the new tile can take its place
+    QFile::remove( tilePath );
+  }
+
+  QFile tileFile( tilePath );
+  if ( tileFile.open( QIODevice::ReadOnly ) )
+  {
+    ++mCacheHits;
+    return new QByteArray( tileFile.readAll() );
+  }
+
+  ++mCacheMisses;
+  QByteArray* tile = new QByteArray( renderMetaTile( mapParameters, grid, zoom, row, col, zoomDirectory, imageFormat, suffix, renderer, adminConfigParser ) );
+
+  if ( beginPrune() )
+  {
+    pruneCache();
+    endPrune();
+  }
+  return tile;
+}
+
+QByteArray QgsTileCache::renderMetaTile( const QMap<QString, QString>& parameters, const QgsTileGrid& grid, int zoom, int row, int col,
+    const QString& tileDirectory, const QString& imageFormat, const QString& suffix,
+    QgsMapRenderer* renderer, QgsConfigParser* adminConfigParser )
+{
+  //tiles which are not stored are rendered on their own
+  bool storeTiles = !tileDirectory.isEmpty();
+  int metaTileSize = storeTiles ? mMetaTileSize : 1;
+
+  int tilesX = grid.matrixWidth << zoom;
+  int tilesY = grid.matrixHeight << zoom;
+  int metaRow = row - row % metaTileSize;
+  int metaCol = col - col % metaTileSize;
+  int rows = qMin( metaTileSize, tilesY - metaRow );
+  int cols = qMin( metaTileSize, tilesX - metaCol );
+
+  double resolution = grid.resolution / ( 1 << zoom );
+  double tileExtent = resolution * grid.tileSize;
+  double gutterExtent = resolution * mGutter;
+  double minx = grid.originX + metaCol * tileExtent - gutterExtent;
+  double maxx = grid.originX + ( metaCol + cols ) * tileExtent + gutterExtent;
+  double miny = grid.originY - ( metaRow + rows ) * tileExtent - gutterExtent;
+  double maxy = grid.originY - metaRow * tileExtent + gutterExtent;
+
+  //render the metatile as WMS 1.1.1 GetMap (x/y axis order for all crs)
+  QMap<QString, QString> mapParameters = parameters;
+  mapParameters.insert( "SERVICE", "WMS" );
+  mapParameters.insert( "REQUEST", "GetMap" );
+  mapParameters.insert( "VERSION", "1.1.1" );
+  mapParameters.insert( "CRS", grid.crs );
+  mapParameters.insert( "SRS", grid.crs );
+  mapParameters.insert( "BBOX", QString( "%1,%2,%3,%4" ).arg( minx, 0, 'f', 10 ).arg( miny, 0, 'f', 10 ).arg( maxx, 0, 'f', 10 ).arg( maxy, 0, 'f', 10 ) );
+  mapParameters.insert( "WIDTH", QString::number( cols * grid.tileSize + 2 * mGutter ) );
+  mapParameters.insert( "HEIGHT", QString::number( rows * grid.tileSize + 2 * mGutter ) );
+  mapParameters.insert( "FORMAT", imageFormat );
+
+  adminConfigParser->setParameterMap( mapParameters );
+  QgsWMSServer server( mapParameters, renderer );
+  server.setAdminConfigParser( adminConfigParser );
+  QImage* metaTile = server.getMap();
+  adminConfigParser->setParameterMap( parameters );
+  if ( !metaTile )
+  {
+    throw QgsMapServiceException( "RenderingError", "Could not render the requested tile" );
+  }
+
+  QByteArray requestedTile;
+  for ( int r = 0; r < rows; ++r )
+  {
+    QString rowDirectory = tileDirectory + "/" + QString::number( metaRow + r );
+    if ( storeTiles && !QDir().mkpath( rowDirectory ) )
+    {
+      QgsDebugMsg( "Could not create tile cache directory " + rowDirectory );
+    }
+
+    for ( int c = 0; c < cols; ++c )
+    {
+      QImage tile = metaTile->copy( mGutter + c * grid.tileSize, mGutter + r * grid.tileSize, grid.tileSize, grid.tileSize );
+      QByteArray ba;
+      QBuffer buffer( &ba );
+      buffer.open( QIODevice::WriteOnly );
+      tile.save( &buffer, imageFormat.toLocal8Bit().data(), -1 );
+
+      if ( storeTiles )
+      {
+        if ( writeFileAtomically( rowDirectory + "/" + QString::number( metaCol + c ) + "." + suffix, ba ) )
+        {
+          addBytesWritten( ba.size() );
+        }
+        else
+        {
+          QgsDebugMsg( "Could not write tile to " + rowDirectory );
+        }
+      }
+      if ( metaRow + r == row && metaCol + c == col )
+      {
+        requestedTile = ba;
+      }
+    }
+  }
+
+  delete metaTile;
+  return requestedTile;
+}
+
+QString QgsTileCache::projectDirectory( const QString& configFilePath )
+{
+  QFileInfo projectFileInfo( configFilePath );
+  QString directory = mCacheDirectory + "/" + hash( projectFileInfo.absoluteFilePath() );
+  uint modified = projectFileInfo.lastModified().toTime_t();
+
+  QHash<QString, uint>::const_iterator stampIt = mProjectTimestamps.constFind( directory );
+  if ( stampIt != mProjectTimestamps.constEnd() && stampIt.value() == modified )
+  {
+    return directory;
+  }
+
+  //the stamp on disk may have been written by another server process
+  bool stampOk = false;
+  uint stamp = 0;
+  QFile stampFile( directory + "/timestamp" );
+  if ( stampFile.open( QIODevice::ReadOnly ) )
+  {
+    stamp = QString( stampFile.readAll() ).trimmed().toUInt( &stampOk );
+    stampFile.close();
+  }
+
+  if ( !stampOk || stamp != modified )
+  {
+    QgsDebugMsg( "Project file changed, clearing tile cache directory " + directory );
+    removeDirectory( directory );
+    QDir().mkpath( directory );
+    writeFileAtomically( directory + "/timestamp", QByteArray::number( modified ) );
+  }
+  mProjectTimestamps.insert( directory, modified );
+  return directory;
+}
+
+bool QgsTileCache::writeFileAtomically( const QString& filePath, const QByteArray& data )
+{
+  QTemporaryFile tmpFile( filePath + ".XXXXXX" );
+  tmpFile.setAutoRemove( false );
+  if ( !tmpFile.open() )
+  {
+    return false;
+  }
+  if ( tmpFile.write( data ) != data.size() )
+  {
+    tmpFile.remove();
+    return false;
+  }
+  tmpFile.close();
+
+  //QFile::rename does not overwrite. If another process was faster, its file is as good as ours
+  if ( !QFile::rename( tmpFile.fileName(), filePath ) )
+  {
+    QFile::remove( tmpFile.fileName() );
+  }
+  return true;
+}
+
+void QgsTileCache::addBytesWritten( qint64 bytes )
+{
+  QMutexLocker locker( &sPruneMutex );
+  sPruneStates[mCacheDirectory].bytesSincePrune += bytes;
+}
+
+bool QgsTileCache::beginPrune()
+{
+  QMutexLocker locker( &sPruneMutex );
+  QgsTileCachePruneState& state = sPruneStates[mCacheDirectory];
+  if ( state.pruning )
+  {
+    return false;
+  }
+  if ( state.lastPrune.isValid()
+       && ( mMaxSize <= 0 || state.bytesSincePrune <= mMaxSize / 10 )
+       && ( mMaxAge <= 0 || state.lastPrune.secsTo( QDateTime::currentDateTime() ) <= qMin( mMaxAge, MAX_PRUNE_INTERVAL ) ) )
+  {
+    return false;
+  }
+  state.pruning = true;
+  state.lastPrune = QDateTime::currentDateTime();
+  state.bytesSincePrune = 0;
+  return true;
+}
+
+void QgsTileCache::endPrune()
+{
+  QMutexLocker locker( &sPruneMutex );
+  sPruneStates[mCacheDirectory].pruning = false;
+}
+
+void QgsTileCache::pruneCache()
+{
+  if ( mMaxSize <= 0 && mMaxAge <= 0 )
+  {
+    return;
+  }
+
+  uint now = QDateTime::currentDateTime().toTime_t();
+  qint64 totalSize = 0;
+  QList<QgsTileCacheFile> files;
+  QDirIterator it( mCacheDirectory, QDir::Files, QDirIterator::Subdirectories );
+  while ( it.hasNext() )
+  {
+    it.next();
+    QFileInfo fileInfo = it.fileInfo();
+    if ( fileInfo.fileName() == "timestamp" )
+    {
+      continue;
+    }
+
+    QgsTileCacheFile file;
+    file.modified = fileInfo.lastModified().toTime_t();
+    file.size = fileInfo.size();
+    file.path = fileInfo.absoluteFilePath();
+    if ( mMaxAge > 0 && now > file.modified && now - file.modified > ( uint )mMaxAge )
+    {
+      QFile::remove( file.path );
+      continue;
+    }
+    totalSize += file.size;
+    files << file;
+  }
+
+  if ( mMaxSize <= 0 || totalSize <= mMaxSize )
+  {
+    return;
+  }
+
+  //remove the oldest tiles down to 90% of the limit, so that the next prune is not due right away
+  QgsDebugMsg( QString( "Tile cache size %1 exceeds the limit of %2 bytes" ).arg( totalSize ).arg( mMaxSize ) );
+  qSort( files );
+  QList<QgsTileCacheFile>::const_iterator fileIt = files.constBegin();
+  for ( ; fileIt != files.constEnd() && totalSize > mMaxSize / 10 * 9; ++fileIt )
+  {
+    if ( QFile::remove( fileIt->path ) )
+    {
+      totalSize -= fileIt->size;
+    }
+  }
+}
+
+void QgsTileCache::removeDirectory( const QString& path )
+{
+  QDir dir( path );
+  if ( !dir.exists() )
+  {
+    return;
+  }
+
+  QFileInfoList entries = dir.entryInfoList( QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden | QDir::System );
+  QFileInfoList::const_iterator entryIt = entries.constBegin();
+  for ( ; entryIt != entries.constEnd(); ++entryIt )
+  {
+    if ( entryIt->isDir() && !entryIt->isSymLink() )
+    {
+      removeDirectory( entryIt->absoluteFilePath() );
+    }
+    else
+    {
+      QFile::remove( entryIt->absoluteFilePath() );
+    }
+  }
+  dir.rmdir( path );
+}
+
+QString QgsTileCache::hash( const QString& s )
+{
+  return QString( QCryptographicHash::hash( s.toUtf8(), QCryptographicHash::Md5 ).toHex() );
+}
@@ -0,0 +1,124 @@
+/***************************************************************************
+                              qgstilecache.h
+                              --------------
+  begin                : March 2012
+  copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSTILECACHE_H
+#define QGSTILECACHE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QString>
+
+class QgsConfigParser;
+class QgsMapRenderer;
+class QByteArray;
+class QImage;
+
+/**Fixed tile grid used by the GetTile request (WMTS tile matrix set)*/
+struct QgsTileGrid
+{
+  /**Name as used in the TILEMATRIXSET parameter*/
+  QString name;
+  /**Authority id of the grid crs*/
+  QString crs;
+  /**Upper left corner of the grid*/
+  double originX;
+  double originY;
+  /**Map units per pixel at tile matrix 0*/
+  double resolution;
+  /**Number of tiles in x- and y-direction at tile matrix 0*/
+  int matrixWidth;
+  int matrixHeight;
+  int tileSize;
+  int maxZoom;
+};
+
+/**Serves GetTile requests from a disk cache. Missing tiles are rendered as metatiles (a block of
+  metaTileSize x metaTileSize tiles plus a gutter to avoid cut labels and symbols at tile borders),
+  sliced and stored on disk. The cache directory of a project is discarded if the modification
+  time of the project file changes. Tiles older than the maximum age are rendered again and the
+  oldest tiles are removed if the cache directory grows beyond the maximum size. Requests with
+  client side styling or selections (SLD, FILTER, SELECTION) are rendered but not cached*/
+class QgsTileCache
+{
+  public:
+    /**Constructor
+      @param cacheDirectory root directory of the tile cache
+      @param metaTileSize number of tiles per metatile side
+      @param gutter pixel buffer rendered around a metatile*/
+    QgsTileCache( const QString& cacheDirectory, int metaTileSize = 4, int gutter = 64 );
+    ~QgsTileCache();
+
+    /**Sets the size limit of the cache directory in bytes. 0 means no limit*/
+    void setMaxSize( qint64 bytes ) { mMaxSize = qMax( qint64( 0 ), bytes ); }
+    qint64 maxSize() const { return mMaxSize; }
+
+    /**Sets the age in seconds after which tiles are rendered again. 0 means no limit*/
+    void setMaxAge( int seconds ) { mMaxAge = qMax( 0, seconds ); }
+    int maxAge() const { return mMaxAge; }
+
+    /**Returns the encoded tile for the GetTile request in parameters or throws a QgsMapServiceException.
+      The caller takes ownership of the byte array
+      @param parameters request parameters (LAYERS, STYLES, FORMAT, TILEMATRIXSET, TILEMATRIX, TILEROW, TILECOL)
+      @param configFilePath project file of the request. Used for the cache key and invalidation
+      @param renderer map renderer used to render metatiles
+      @param adminConfigParser configuration of the project
+      @param mimeType out: mime type of the tile*/
+    QByteArray* getTile( const QMap<QString, QString>& parameters, const QString& configFilePath, QgsMapRenderer* renderer,
+                         QgsConfigParser* adminConfigParser, QString& mimeType );
+
+    /**Looks up a predefined tile grid (EPSG:3857 / GoogleMapsCompatible or EPSG:4326)
+      @return true if a grid with this name exists*/
+    static bool tileGrid( const QString& name, QgsTileGrid& grid );
+
+    int cacheHits() const { return mCacheHits; }
+    int cacheMisses() const { return mCacheMisses; }
+
+  private:
+    /**Returns the cache directory of a project. Clears it if the project file has been modified since the tiles were written*/
+    QString projectDirectory( const QString& configFilePath );
+    /**Renders the metatile containing tile row/col and writes all its tiles to tileDirectory.
+      If tileDirectory is empty, only the tile row/col is rendered and nothing is written
+      @return the encoded tile row/col*/
+    QByteArray renderMetaTile( const QMap<QString, QString>& parameters, const QgsTileGrid& grid, int zoom, int row, int col,
+                               const QString& tileDirectory, const QString& imageFormat, const QString& suffix,
+                               QgsMapRenderer* renderer, QgsConfigParser* adminConfigParser );
+    /**Writes data to filePath via a temporary file, so concurrent readers never see partial tiles*/
+    static bool writeFileAtomically( const QString& filePath, const QByteArray& data );
+    /**Adds to the bytes written into the cache directory since it was last pruned*/
+    void addBytesWritten( qint64 bytes );
+    /**Returns true if the cache directory is due for pruning and no other thread prunes it.
+      The prune state is shared by the caches of all worker threads on the same directory,
+      endPrune() has to be called after a successful call*/
+    bool beginPrune();
+    void endPrune();
+    /**Removes the tiles older than the maximum age and then the oldest tiles until the cache is below the maximum size*/
+    void pruneCache();
+    static void removeDirectory( const QString& path );
+    static QString hash( const QString& s );
+
+    QString mCacheDirectory;
+    int mMetaTileSize;
+    int mGutter;
+    qint64 mMaxSize;
+    int mMaxAge;
+    /**Project file modification times the cache directories are valid for. Key: project cache directory*/
+    QHash<QString, uint> mProjectTimestamps;
+    int mCacheHits;
+    int mCacheMisses;
+};
+
+#endif // QGSTILECACHE_H
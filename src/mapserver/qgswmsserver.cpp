@@ -24,7 +24,6 @@
 #include "qgsmaprenderer.h"
 #include "qgsmaptopixel.h"
 #include "qgspallabeling.h"
-#include "qgsproject.h"
 #include "qgsrasterlayer.h"
 #include "qgsscalecalculator.h"
 #include "qgscoordinatereferencesystem.h"
@@ -32,6 +31,7 @@
 #include "qgsvectorlayer.h"
 #include "qgslogger.h"
 #include "qgsmapserviceexception.h"
+#include "qgsmsutils.h"
 #include "qgssldparser.h"
 #include "qgssymbol.h"
 #include "qgssymbolv2.h"
@@ -127,12 +127,12 @@ QDomDocument QgsWMSServer::getCapabilities( QString version )
   //Prepare url
   //Some client requests already have http://<SERVER_NAME> in the REQUEST_URI variable
   QString hrefString;
-  QString requestUrl = getenv( "REQUEST_URI" );
+  QString requestUrl = QgsMSUtils::getEnv( "REQUEST_URI" );
   QUrl mapUrl( requestUrl );
-  mapUrl.setHost( getenv( "SERVER_NAME" ) );
+  mapUrl.setHost( QgsMSUtils::getEnv( "SERVER_NAME" ) );
 
   //Add non-default ports to url
-  QString portString = getenv( "SERVER_PORT" );
+  QString portString = QgsMSUtils::getEnv( "SERVER_PORT" );
   if ( !portString.isEmpty() )
   {
     bool portOk;
@@ -146,7 +146,7 @@ QDomDocument QgsWMSServer::getCapabilities( QString version )
     }
   }
 
-  if ( QString( getenv( "HTTPS" ) ).compare( "on", Qt::CaseInsensitive ) == 0 )
+  if ( QString( QgsMSUtils::getEnv( "HTTPS" ) ).compare( "on", Qt::CaseInsensitive ) == 0 )
   {
     mapUrl.setScheme( "https" );
   }
@@ -210,7 +210,7 @@ QDomDocument QgsWMSServer::getCapabilities( QString version )
   QDomElement postResourceElement = doc.createElement( "OnlineResource"/*wms:OnlineResource*/ );
   postResourceElement.setAttribute( "xmlns:xlink", "http://www.w3.org/1999/xlink" );
   postResourceElement.setAttribute( "xlink:type", "simple" );
-  postResourceElement.setAttribute( "xlink:href", "http://" + QString( getenv( "SERVER_NAME" ) ) + QString( getenv( "REQUEST_URI" ) ) );
+  postResourceElement.setAttribute( "xlink:href", "http://" + QString( QgsMSUtils::getEnv( "SERVER_NAME" ) ) + QString( QgsMSUtils::getEnv( "REQUEST_URI" ) ) );
   postElement.appendChild( postResourceElement );
   dcpTypeElement.appendChild( postElement );
 #endif
@@ -1081,14 +1081,13 @@ int QgsWMSServer::configureMapRender( const QPaintDevice* paintDevice ) const
   //we don't rejeict the request if it is not there but disable reprojection on the fly
   if ( crs.isEmpty() )
   {
-    //disable on the fly projection
-    QgsProject::instance()->writeEntry( "SpatialRefSys", "/ProjectionsEnabled", 0 );
+    //disable on the fly projection. The renderer keeps the setting of the previous request otherwise
+    mMapRenderer->setProjectionsEnabled( false );
   }
   else
   {
     //enable on the fly projection
     QgsDebugMsg( "enable on the fly projection" );
-    QgsProject::instance()->writeEntry( "SpatialRefSys", "/ProjectionsEnabled", 1 );
 
     //destination SRS
     outputCRS = QgsCRSCache::instance()->crsByAuthId( crs );
@@ -15,5 +15,7 @@ QgsInterpolator* QgsIDWInterpolatorDialog::createInterpolator() const
 {
   QgsIDWInterpolator* theInterpolator = new QgsIDWInterpolator( mInputData );
   theInterpolator->setDistanceCoefficient( mPSpinBox->value() );
+  theInterpolator->setMaxPoints( mMaxPointsSpinBox->value() );
+  theInterpolator->setSearchRadius( mSearchRadiusSpinBox->value() );
   return theInterpolator;
 }
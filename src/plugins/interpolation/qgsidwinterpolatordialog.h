@@ -30,7 +30,7 @@ class QgsIDWInterpolatorDialog: public QgsInterpolatorDialog, private Ui::QgsIDW
 
     ~QgsIDWInterpolatorDialog();
 
-    /**Creates an IDW interpolator with the specified distance coefficient
+    /**Creates an IDW interpolator with the specified distance coefficient, maximum number of points and search radius
      @return 0 in case of error*/
     QgsInterpolator* createInterpolator() const;
 };
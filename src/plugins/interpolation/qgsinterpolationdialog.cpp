@@ -61,6 +61,11 @@ QgsInterpolationDialog::QgsInterpolationDialog( QWidget* parent, QgisInterface*
   mInterpolationMethodComboBox->insertItem( 1, tr( "Inverse Distance Weighting (IDW)" ) );
   mInterpolationMethodComboBox->setCurrentIndex( settings.value( "/Interpolation/lastMethod", 0 ).toInt() );
 
+  //the item data is the GDAL driver name passed to the grid file writer, empty for an ascii grid
+  mOutputFormatComboBox->addItem( tr( "ASCII grid" ), "" );
+  mOutputFormatComboBox->addItem( tr( "GeoTIFF" ), "GTiff" );
+  mOutputFormatComboBox->setCurrentIndex( settings.value( "/Interpolation/lastOutputFormat", 0 ).toInt() );
+
   enableOrDisableOkButton();
 }
 
@@ -69,6 +74,7 @@ QgsInterpolationDialog::~QgsInterpolationDialog()
   QSettings settings;
   settings.setValue( "/Interpolation/geometry", saveGeometry() );
   settings.setValue( "/Interpolation/lastMethod", mInterpolationMethodComboBox->currentIndex() );
+  settings.setValue( "/Interpolation/lastOutputFormat", mOutputFormatComboBox->currentIndex() );
 }
 
 void QgsInterpolationDialog::enableOrDisableOkButton()
@@ -122,11 +128,12 @@ void QgsInterpolationDialog::on_buttonBox_accepted()
     return;
   }
 
-  //add .asc suffix if the user did not provider it already
+  //add .asc / .tif suffix if the user did not provider it already
+  QString outputFormat = mOutputFormatComboBox->itemData( mOutputFormatComboBox->currentIndex() ).toString();
   QString suffix = theFileInfo.suffix();
   if ( suffix.isEmpty() )
   {
-    fileName.append( ".asc" );
+    fileName.append( outputFormat.isEmpty() ? ".asc" : ".tif" );
   }
 
   int nLayers = mLayersTreeWidget->topLevelItemCount();
@@ -199,11 +206,17 @@ void QgsInterpolationDialog::on_buttonBox_accepted()
   //create grid file writer
   QgsGridFileWriter theWriter( theInterpolator, fileName, outputBBox, mNumberOfColumnsSpinBox->value(),
                                mNumberOfRowsSpinBox->value(), mCellsizeXSpinBox->value(), mCellSizeYSpinBox->value() );
-  if ( theWriter.writeFile( true ) == 0 )
+  theWriter.setOutputFormat( outputFormat );
+  int writeResult = theWriter.writeFile( true );
+  if ( writeResult == 0 )
   {
     mIface->addRasterLayer( fileName, QFileInfo( fileName ).baseName() );
     accept();
   }
+  else if ( writeResult == 4 )
+  {
+    QMessageBox::critical( 0, tr( "Output file not written" ), tr( "The interpolated grid could not be written to %1" ).arg( fileName ) );
+  }
 
   delete theInterpolator;
 }
@@ -322,7 +335,7 @@ void QgsInterpolationDialog::on_mOutputFileButton_clicked()
 
 void QgsInterpolationDialog::on_mOutputFileLineEdit_textChanged()
 {
-  if ( mOutputFileLineEdit->text().endsWith( ".asc" ) )
+  if ( mOutputFileLineEdit->text().endsWith( ".asc" ) || mOutputFileLineEdit->text().endsWith( ".tif" ) )
   {
     enableOrDisableOkButton();
   }
@@ -15,6 +15,9 @@
  * \brief implemetation UI for find shotest path
  */
 
+// C++ standard includes
+#include <limits>
+
 //qt includes
 #include <qcombobox.h>
 #include <qlayout.h>
@@ -42,6 +45,7 @@
 #include <qgsgraphbuilder.h>
 #include <qgsgraph.h>
 #include <qgsgraphanalyzer.h>
+#include <qgscompactgraph.h>
 
 // roadgraph plugin includes
 #include "roadgraphplugin.h"
@@ -287,16 +291,40 @@ QgsGraph* RgShortestPathWidget::getPath( QgsPoint& p1, QgsPoint& p2 )
   if ( mCriterionName->currentIndex() > 0 )
     criterionNum = 1;
 
-  QgsGraph* shortestpathTree = QgsGraphAnalyzer::shortestTree( graph, startVertexIdx, criterionNum );
+  int stopVertexIdx = graph->findVertex( p2 );
 
-  delete graph;
+  if ( startVertexIdx == -1 || stopVertexIdx == -1 )
+  {
+    delete graph;
+    QMessageBox::critical( this, tr( "Tie point failed" ), tr( "Start or stop point is not a vertex of the road graph!" ) );
+    return NULL;
+  }
+
+  QgsCompactGraph compactGraph( graph );
+  QList< int > pathArcs;
+  double pathCost = QgsGraphAnalyzer::shortestPath( &compactGraph, startVertexIdx, stopVertexIdx, criterionNum, &pathArcs );
 
-  if ( shortestpathTree->findVertex( p2 ) == -1 )
+  if ( pathCost == std::numeric_limits<double>::infinity() )
   {
+    delete graph;
     QMessageBox::critical( this, tr( "Path not found" ), tr( "Path not found" ) );
     return NULL;
   }
-  return shortestpathTree;
+
+  // graph containing the path arcs only
+  QgsGraph* shortestPath = new QgsGraph();
+  int prevVertexIdx = shortestPath->addVertex( p1 );
+  foreach( int arcId, pathArcs )
+  {
+    const QgsGraphArc& arc = graph->arc( arcId );
+    int vertexIdx = shortestPath->addVertex( graph->vertex( arc.inVertex() ).point() );
+    shortestPath->addArc( prevVertexIdx, vertexIdx, arc.properties() );
+    prevVertexIdx = vertexIdx;
+  }
+
+  delete graph;
+
+  return shortestPath;
 }
 
 void RgShortestPathWidget::findingPath()
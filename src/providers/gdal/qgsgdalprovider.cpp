@@ -27,6 +27,7 @@
 #include "qgsrectangle.h"
 #include "qgscoordinatereferencesystem.h"
 #include "qgsrasterbandstats.h"
+#include "qgsrasterblockcache.h"
 #include "qgsrasterlayer.h"
 #include "qgsrasterpyramid.h"
 
@@ -327,6 +328,7 @@ bool QgsGdalProvider::crsFromWkt( const char *wkt )
 QgsGdalProvider::~QgsGdalProvider()
 {
   QgsDebugMsg( "QgsGdalProvider: deconstructing." );
+  QgsRasterBlockCache::instance()->removeDataset( dataSourceUri() );
   if ( mGdalBaseDataset )
   {
     GDALDereferenceDataset( mGdalBaseDataset );
@@ -346,6 +348,7 @@ void QgsGdalProvider::closeDataset()
     return;
   }
   mValid = false;
+  QgsRasterBlockCache::instance()->removeDataset( dataSourceUri() );
 
   GDALDereferenceDataset( mGdalBaseDataset );
   mGdalBaseDataset = NULL;
@@ -657,31 +660,49 @@ void QgsGdalProvider::readBlock( int theBandNo, QgsRectangle  const & theExtent,
   double tmpYMax = mExtent.yMaximum() + srcTop * srcYRes;
   QgsDebugMsg( QString( "tmpXMin = %1 tmpYMax = %2 tmpWidth = %3 tmpHeight = %4" ).arg( tmpXMin ).arg( tmpYMax ).arg( tmpWidth ).arg( tmpHeight ) );
 
-  // Allocate temporary block
-  char *tmpBlock = ( char * )malloc( dataSize * tmpWidth * tmpHeight );
+  double tmpXRes, tmpYRes; // tmpYRes is negative
 
-  GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, theBandNo );
-  GDALDataType type = ( GDALDataType )mGdalDataType[theBandNo-1];
-  CPLErrorReset();
-  CPLErr err = GDALRasterIO( gdalBand, GF_Read,
-                             srcLeft, srcTop, srcWidth, srcHeight,
-                             ( void * )tmpBlock,
-                             tmpWidth, tmpHeight, type,
-                             0, 0 );
-
-  if ( err != CPLE_None )
+  // Pans and small zooms mostly need the same blocks again, so try to assemble the
+  // window from cached native blocks first
+  int winLeft, winTop, winWidth, winHeight;
+  char *tmpBlock = readCachedWindow( theBandNo, srcLeft, srcTop, srcWidth, srcHeight, tmpWidth, tmpHeight,
+                                     winLeft, winTop, winWidth, winHeight, tmpXRes, tmpYRes );
+  if ( tmpBlock )
   {
-    QgsLogger::warning( "RasterIO error: " + QString::fromUtf8( CPLGetLastErrorMsg() ) );
-    QgsDebugMsg( "RasterIO error: " + QString::fromUtf8( CPLGetLastErrorMsg() ) );
-    free( tmpBlock );
-    return;
+    tmpWidth = winWidth;
+    tmpHeight = winHeight;
+    tmpXMin = mExtent.xMinimum() + winLeft * tmpXRes;
+    tmpYMax = mExtent.yMaximum() + winTop * tmpYRes;
+    QgsDebugMsg( QString( "block cache read time (ms): %1" ).arg( time.elapsed() ) );
   }
+  else
+  {
+    // Allocate temporary block
+    tmpBlock = ( char * )malloc( dataSize * tmpWidth * tmpHeight );
 
-  QgsDebugMsg( QString( "GDALRasterIO time (ms): %1" ).arg( time.elapsed() ) );
-  time.start();
+    GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, theBandNo );
+    GDALDataType type = ( GDALDataType )mGdalDataType[theBandNo-1];
+    CPLErrorReset();
+    CPLErr err = GDALRasterIO( gdalBand, GF_Read,
+                               srcLeft, srcTop, srcWidth, srcHeight,
+                               ( void * )tmpBlock,
+                               tmpWidth, tmpHeight, type,
+                               0, 0 );
+
+    if ( err != CPLE_None )
+    {
+      QgsLogger::warning( "RasterIO error: " + QString::fromUtf8( CPLGetLastErrorMsg() ) );
+      QgsDebugMsg( "RasterIO error: " + QString::fromUtf8( CPLGetLastErrorMsg() ) );
+      free( tmpBlock );
+      return;
+    }
 
-  double tmpXRes = srcWidth * srcXRes / tmpWidth;
-  double tmpYRes = srcHeight * srcYRes / tmpHeight; // negative
+    QgsDebugMsg( QString( "GDALRasterIO time (ms): %1" ).arg( time.elapsed() ) );
+
+    tmpXRes = srcWidth * srcXRes / tmpWidth;
+    tmpYRes = srcHeight * srcYRes / tmpHeight;
+  }
+  time.start();
 
   for ( int row = 0; row < height; row++ )
   {
@@ -708,6 +729,113 @@ void QgsGdalProvider::readBlock( int theBandNo, QgsRectangle  const & theExtent,
   return;
 }
 
+char *QgsGdalProvider::readCachedWindow( int theBandNo, int theSrcLeft, int theSrcTop, int theSrcWidth, int theSrcHeight,
+    int theTargetWidth, int theTargetHeight,
+    int &theWinLeft, int &theWinTop, int &theWinWidth, int &theWinHeight,
+    double &theLevelXRes, double &theLevelYRes )
+{
+  QgsRasterBlockCache *cache = QgsRasterBlockCache::instance();
+  if ( cache->maxSize() <= 0 )
+  {
+    return 0;
+  }
+
+  GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, theBandNo );
+  int fullWidth = GDALGetRasterBandXSize( gdalBand );
+  int fullHeight = GDALGetRasterBandYSize( gdalBand );
+
+  // choose the overview GDAL would use: the coarsest one which is not coarser than the target
+  double factor = qMin( theSrcWidth / ( double ) theTargetWidth, theSrcHeight / ( double ) theTargetHeight );
+  int level = 0;
+  double levelFactor = 1.0;
+  GDALRasterBandH levelBand = gdalBand;
+  for ( int i = 0; i < GDALGetOverviewCount( gdalBand ); i++ )
+  {
+    GDALRasterBandH overview = GDALGetOverview( gdalBand, i );
+    double overviewFactor = fullWidth / ( double ) GDALGetRasterBandXSize( overview );
+    if ( overviewFactor > levelFactor && overviewFactor <= factor * 1.0001 )
+    {
+      level = i + 1;
+      levelFactor = overviewFactor;
+      levelBand = overview;
+    }
+  }
+
+  int levelWidth = GDALGetRasterBandXSize( levelBand );
+  int levelHeight = GDALGetRasterBandYSize( levelBand );
+  double xScale = levelWidth / ( double ) fullWidth;
+  double yScale = levelHeight / ( double ) fullHeight;
+
+  theWinLeft = static_cast<int>( floor( theSrcLeft * xScale ) );
+  theWinTop = static_cast<int>( floor( theSrcTop * yScale ) );
+  int winRight = qMin( levelWidth, static_cast<int>( ceil(( theSrcLeft + theSrcWidth ) * xScale ) ) );
+  int winBottom = qMin( levelHeight, static_cast<int>( ceil(( theSrcTop + theSrcHeight ) * yScale ) ) );
+  theWinWidth = winRight - theWinLeft;
+  theWinHeight = winBottom - theWinTop;
+  if ( theWinWidth <= 0 || theWinHeight <= 0 )
+  {
+    return 0;
+  }
+
+  // without a matching overview the full resolution window may be huge,
+  // GDALRasterIO downsamples it on the fly with much less memory
+  if (( double ) theWinWidth * theWinHeight > 4.0 * theTargetWidth * theTargetHeight )
+  {
+    return 0;
+  }
+
+  theLevelXRes = mGeoTransform[1] * fullWidth / ( double ) levelWidth;
+  theLevelYRes = mGeoTransform[5] * fullHeight / ( double ) levelHeight;
+
+  GDALDataType type = ( GDALDataType )mGdalDataType[theBandNo-1];
+  int dataSize = GDALGetDataTypeSize( type ) / 8;
+  GDALDataType nativeType = GDALGetRasterDataType( levelBand );
+  int nativeSize = GDALGetDataTypeSize( nativeType ) / 8;
+  int xBlockSize, yBlockSize;
+  GDALGetBlockSize( levelBand, &xBlockSize, &yBlockSize );
+
+  char *window = ( char * )malloc( dataSize * theWinWidth * theWinHeight );
+  QByteArray nativeBlock;
+
+  for ( int yBlock = theWinTop / yBlockSize; yBlock <= ( winBottom - 1 ) / yBlockSize; yBlock++ )
+  {
+    for ( int xBlock = theWinLeft / xBlockSize; xBlock <= ( winRight - 1 ) / xBlockSize; xBlock++ )
+    {
+      QByteArray block;
+      if ( !cache->block( dataSourceUri(), theBandNo, level, xBlock, yBlock, block ) )
+      {
+        nativeBlock.resize( xBlockSize * yBlockSize * nativeSize );
+        CPLErrorReset();
+        if ( GDALReadBlock( levelBand, xBlock, yBlock, nativeBlock.data() ) != CE_None )
+        {
+          QgsDebugMsg( "GDALReadBlock error: " + QString::fromUtf8( CPLGetLastErrorMsg() ) );
+          free( window );
+          return 0;
+        }
+        // store in the data type used by QGIS for this band
+        block.resize( xBlockSize * yBlockSize * dataSize );
+        GDALCopyWords( nativeBlock.data(), nativeType, nativeSize, block.data(), type, dataSize, xBlockSize * yBlockSize );
+        cache->insertBlock( dataSourceUri(), theBandNo, level, xBlock, yBlock, block );
+      }
+
+      // copy the part of the block inside the window
+      int left = qMax( theWinLeft, xBlock * xBlockSize );
+      int right = qMin( winRight, ( xBlock + 1 ) * xBlockSize );
+      int top = qMax( theWinTop, yBlock * yBlockSize );
+      int bottom = qMin( winBottom, ( yBlock + 1 ) * yBlockSize );
+      const char *blockData = block.constData();
+      for ( int row = top; row < bottom; row++ )
+      {
+        memcpy( window + dataSize * (( row - theWinTop ) * theWinWidth + left - theWinLeft ),
+                blockData + dataSize * (( row - yBlock * yBlockSize ) * xBlockSize + left - xBlock * xBlockSize ),
+                dataSize * ( right - left ) );
+      }
+    }
+  }
+
+  return window;
+}
+
 // this is old version which was using GDALWarpOperation, unfortunately
 // it may be very slow on large datasets
 #if 0
@@ -1328,6 +1456,9 @@ QString QgsGdalProvider::buildPyramids( QList<QgsRasterPyramid> const & theRaste
   //TODO: Consider making theRasterPyramidList modifyable by this method to indicate if the pyramid exists after build attempt
   //without requiring the user to rebuild the pyramid list to get the updated infomation
 
+  //cached overview blocks become invalid
+  QgsRasterBlockCache::instance()->removeDataset( dataSourceUri() );
+
   //
   // Note: Make sure the raster is not opened in write mode
   // in order to force overviews to be written to a separate file.
@@ -117,6 +117,10 @@ class QgsGdalProvider : public QgsRasterDataProvider
     */
     QString description() const;
 
+    /** each provider instance has its own data source handle
+        @note added in 1.9 */
+    bool isThreadSafe() const { return true; }
+
     /*! Get the QgsCoordinateReferenceSystem for this layer
      * @note Must be reimplemented by each provider.
      * If the provider isn't capable of returning
@@ -265,6 +269,19 @@ class QgsGdalProvider : public QgsRasterDataProvider
     // initialize CRS from wkt
     bool crsFromWkt( const char *wkt );
 
+    /** Assembles a source window from native blocks kept in QgsRasterBlockCache. The blocks are read
+     * from the overview level with the largest resolution not finer than needed for the target size.
+     * @param theSrcLeft, theSrcTop, theSrcWidth, theSrcHeight window in full resolution pixels
+     * @param theTargetWidth, theTargetHeight number of pixels the window is resampled to
+     * @param theWinLeft, theWinTop, theWinWidth, theWinHeight out: window in pixels of the chosen level
+     * @param theLevelXRes, theLevelYRes out: pixel size of the chosen level
+     * @return window data in the QGIS data type of the band (to be freed by the caller) or 0 if
+     * there is no overview close enough to the target resolution or reading failed */
+    char *readCachedWindow( int theBandNo, int theSrcLeft, int theSrcTop, int theSrcWidth, int theSrcHeight,
+                            int theTargetWidth, int theTargetHeight,
+                            int &theWinLeft, int &theWinTop, int &theWinWidth, int &theWinHeight,
+                            double &theLevelXRes, double &theLevelYRes );
+
     /**
     * Flag indicating if the layer data source is a valid layer
     */
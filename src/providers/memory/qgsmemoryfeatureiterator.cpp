@@ -0,0 +1,148 @@
+/***************************************************************************
+    qgsmemoryfeatureiterator.cpp
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsmemoryfeatureiterator.h"
+#include "qgsmemoryprovider.h"
+
+#include "qgsgeometry.h"
+#include "qgslogger.h"
+#include "qgsspatialindex.h"
+
+
+QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryProvider* p, const QgsFeatureRequest& request )
+    : QgsAbstractFeatureIterator( request )
+    , P( p )
+    , mSelectRectGeom( NULL )
+{
+  P->mActiveIterators << this;
+
+  if ( !mRequest.filterRect().isEmpty() && ( mRequest.flags() & QgsFeatureRequest::ExactIntersect ) )
+  {
+    mSelectRectGeom = QgsGeometry::fromRect( mRequest.filterRect() );
+  }
+
+  // if there's spatial index, use it!
+  // (but don't use it when selection rect is not specified)
+  if ( P->mSpatialIndex && !mRequest.filterRect().isEmpty() )
+  {
+    mUsingFeatureIdList = true;
+    mFeatureIdList = P->mSpatialIndex->intersects( mRequest.filterRect() );
+    QgsDebugMsg( "Features returned by spatial index: " + QString::number( mFeatureIdList.count() ) );
+  }
+  else
+  {
+    mUsingFeatureIdList = false;
+  }
+
+  rewind();
+}
+
+QgsMemoryFeatureIterator::~QgsMemoryFeatureIterator()
+{
+  close();
+}
+
+bool QgsMemoryFeatureIterator::nextFeature( QgsFeature& feature )
+{
+  feature.setValid( false );
+
+  if ( mClosed )
+    return false;
+
+  if ( mUsingFeatureIdList )
+    return nextFeatureUsingList( feature );
+  else
+    return nextFeatureTraverseAll( feature );
+}
+
+bool QgsMemoryFeatureIterator::nextFeatureUsingList( QgsFeature& feature )
+{
+  // option 1: we have a list of features to traverse
+  while ( mFeatureIdListIterator != mFeatureIdList.constEnd() )
+  {
+    QgsFeatureMap::const_iterator it = P->mFeatures.constFind( *mFeatureIdListIterator );
+    ++mFeatureIdListIterator;
+
+    if ( it == P->mFeatures.constEnd() )
+      continue; // deleted in the meantime
+
+    // do exact check in case we're doing intersection
+    if ( mSelectRectGeom && !it->geometry()->intersects( mSelectRectGeom ) )
+      continue;
+
+    feature = *it;
+    feature.setValid( true );
+    return true;
+  }
+
+  return false;
+}
+
+bool QgsMemoryFeatureIterator::nextFeatureTraverseAll( QgsFeature& feature )
+{
+  // option 2: traversing the whole layer
+  while ( mSelectIterator != P->mFeatures.constEnd() )
+  {
+    const QgsFeature& f = mSelectIterator.value();
+    ++mSelectIterator;
+
+    if ( !mRequest.filterRect().isEmpty() )
+    {
+      if ( mSelectRectGeom )
+      {
+        // using exact test when checking for intersection
+        if ( !f.geometry()->intersects( mSelectRectGeom ) )
+          continue;
+      }
+      else
+      {
+        // check just bounding box against rect when not using intersection
+        if ( !f.geometry()->boundingBox().intersects( mRequest.filterRect() ) )
+          continue;
+      }
+    }
+
+    feature = f;
+    feature.setValid( true );
+    return true;
+  }
+
+  return false;
+}
+
+bool QgsMemoryFeatureIterator::rewind()
+{
+  if ( mClosed )
+    return false;
+
+  if ( mUsingFeatureIdList )
+    mFeatureIdListIterator = mFeatureIdList.constBegin();
+  else
+    mSelectIterator = P->mFeatures.constBegin();
+
+  return true;
+}
+
+bool QgsMemoryFeatureIterator::close()
+{
+  if ( mClosed )
+    return false;
+
+  delete mSelectRectGeom;
+  mSelectRectGeom = NULL;
+
+  P->mActiveIterators.remove( this );
+
+  mClosed = true;
+  return true;
+}
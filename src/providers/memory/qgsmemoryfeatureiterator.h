@@ -0,0 +1,53 @@
+/***************************************************************************
+    qgsmemoryfeatureiterator.h
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSMEMORYFEATUREITERATOR_H
+#define QGSMEMORYFEATUREITERATOR_H
+
+#include "qgsfeatureiterator.h"
+
+#include <QMap>
+
+class QgsGeometry;
+class QgsMemoryProvider;
+
+class QgsMemoryFeatureIterator : public QgsAbstractFeatureIterator
+{
+  public:
+    QgsMemoryFeatureIterator( QgsMemoryProvider* p, const QgsFeatureRequest& request );
+
+    ~QgsMemoryFeatureIterator();
+
+    //! fetch next feature, return true on success
+    virtual bool nextFeature( QgsFeature& feature );
+
+    //! reset the iterator to the starting position
+    virtual bool rewind();
+
+    //! end of iterating: free the resources / lock
+    virtual bool close();
+
+  protected:
+    bool nextFeatureUsingList( QgsFeature& feature );
+    bool nextFeatureTraverseAll( QgsFeature& feature );
+
+    QgsMemoryProvider* P;
+
+    QgsGeometry* mSelectRectGeom;
+    QgsFeatureMap::const_iterator mSelectIterator;
+    bool mUsingFeatureIdList;
+    QList<QgsFeatureId> mFeatureIdList;
+    QList<QgsFeatureId>::const_iterator mFeatureIdListIterator;
+};
+
+#endif // QGSMEMORYFEATUREITERATOR_H
@@ -17,9 +17,8 @@
 #include "qgscoordinatereferencesystem.h"
 
 
-typedef QMap<QgsFeatureId, QgsFeature> QgsFeatureMap;
-
 class QgsSpatialIndex;
+class QgsMemoryFeatureIterator;
 
 class QgsMemoryProvider : public QgsVectorDataProvider
 {
@@ -43,6 +42,12 @@ class QgsMemoryProvider : public QgsVectorDataProvider
      */
     virtual QString storageType() const;
 
+    /**
+     * Query the provider for features specified in request.
+     * @note added in 1.9
+     */
+    virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest& request = QgsFeatureRequest() );
+
     /** Select features based on a bounding rectangle. Features can be retrieved with calls to nextFeature.
      *  @param fetchAttributes list of attributes which should be fetched
      *  @param rect spatial filter
@@ -174,6 +179,10 @@ class QgsMemoryProvider : public QgsVectorDataProvider
      */
     QString description() const;
 
+    /** the features are only read while drawing
+        @note added in 1.9 */
+    bool isThreadSafe() const { return true; }
+
     /**
      * Return the extent for this data layer
      */
@@ -204,17 +213,12 @@ class QgsMemoryProvider : public QgsVectorDataProvider
     QgsFeatureMap mFeatures;
     QgsFeatureId mNextFeatureId;
 
-    // selection
-    QgsAttributeList mSelectAttrs;
-    QgsRectangle mSelectRect;
-    QgsGeometry* mSelectRectGeom;
-    bool mSelectGeometry, mSelectUseIntersect;
-    QgsFeatureMap::iterator mSelectIterator;
-    bool mSelectUsingSpatialIndex;
-    QList<QgsFeatureId> mSelectSI_Features;
-    QList<QgsFeatureId>::iterator mSelectSI_Iterator;
-
     // indexing
     QgsSpatialIndex* mSpatialIndex;
 
+    // iterators that have not been closed yet
+    QSet<QgsMemoryFeatureIterator *> mActiveIterators;
+
+    friend class QgsMemoryFeatureIterator;
+
 };
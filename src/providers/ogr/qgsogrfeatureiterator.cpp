@@ -0,0 +1,197 @@
+/***************************************************************************
+    qgsogrfeatureiterator.cpp
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsogrfeatureiterator.h"
+
+#include "qgsogrprovider.h"
+
+#include "qgsapplication.h"
+#include "qgsgeometry.h"
+#include "qgslogger.h"
+
+#include <ogr_api.h>
+
+
+QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrProvider* p, const QgsFeatureRequest& request )
+    : QgsAbstractFeatureIterator( request )
+    , P( p )
+    , mUsingProviderHandle( false )
+    , ogrLayer( 0 )
+{
+  mHandle.dataSource = 0;
+  mHandle.layer = 0;
+  mHandle.subsetLayer = 0;
+
+  mFetchGeometry = mRequest.fetchGeometry() || ( mRequest.flags() & QgsFeatureRequest::ExactIntersect );
+  if ( P->geometryType() == QGis::WKBNoGeometry )
+  {
+    mFetchGeometry = false;
+  }
+  mAttributesToFetch = mRequest.attributesToFetch( P->attributeIndexes() );
+
+  if ( !P->acquireHandle( this, mHandle ) )
+  {
+    close();
+    return;
+  }
+
+  mUsingProviderHandle = !mHandle.dataSource;
+  ogrLayer = mUsingProviderHandle ? P->ogrLayer : mHandle.layer;
+
+  setRelevantFields();
+
+  // spatial query to select features
+  if ( mRequest.filterRect().isEmpty() )
+  {
+    OGR_L_SetSpatialFilter( ogrLayer, 0 );
+  }
+  else
+  {
+    OGRGeometryH filter = 0;
+    QString wktExtent = QString( "POLYGON((%1))" ).arg( mRequest.filterRect().asPolygon() );
+    QByteArray ba = wktExtent.toAscii();
+    const char *wktText = ba;
+
+    OGR_G_CreateFromWkt(( char ** )&wktText, NULL, &filter );
+    QgsDebugMsg( "Setting spatial filter using " + wktExtent );
+    OGR_L_SetSpatialFilter( ogrLayer, filter );
+    OGR_G_DestroyGeometry( filter );
+  }
+
+  //start with first feature
+  rewind();
+}
+
+QgsOgrFeatureIterator::~QgsOgrFeatureIterator()
+{
+  close();
+}
+
+void QgsOgrFeatureIterator::setRelevantFields()
+{
+  P->setRelevantFields( ogrLayer, mFetchGeometry || !mRequest.filterRect().isEmpty(), mAttributesToFetch );
+
+  if ( mUsingProviderHandle )
+  {
+    // the provider's relevant fields are now set up for this iterator
+    P->mRelevantFieldsForNextFeature = true;
+  }
+}
+
+bool QgsOgrFeatureIterator::nextFeature( QgsFeature& feature )
+{
+  feature.setValid( false );
+
+  if ( mClosed )
+    return false;
+
+  if ( mUsingProviderHandle )
+  {
+    // setSubsetString() replaces the provider's layer handle
+    ogrLayer = P->ogrLayer;
+
+    if ( !P->mRelevantFieldsForNextFeature )
+    {
+      // featureAtId() may have changed the fields on the shared handle
+      setRelevantFields();
+    }
+  }
+
+  OGRFeatureH fet;
+
+  while (( fet = OGR_L_GetNextFeature( ogrLayer ) ) )
+  {
+    // skip features without geometry
+    if ( !P->mFetchFeaturesWithoutGeom && !OGR_F_GetGeometryRef( fet ) )
+    {
+      OGR_F_Destroy( fet );
+      continue;
+    }
+
+    OGRFeatureDefnH featureDefinition = OGR_F_GetDefnRef( fet );
+    QString featureTypeName = featureDefinition ? QString( OGR_FD_GetName( featureDefinition ) ) : QString( "" );
+    feature.setFeatureId( OGR_F_GetFID( fet ) );
+    // set the attributes in place
+    feature.initAttributes( P->mAttributeFields.size() );
+    feature.setTypeName( featureTypeName );
+
+    /* fetch geometry */
+    if ( mFetchGeometry )
+    {
+      OGRGeometryH geom = OGR_F_GetGeometryRef( fet );
+
+      if ( geom == 0 )
+      {
+        OGR_F_Destroy( fet );
+        continue;
+      }
+
+      // get the wkb representation
+      unsigned char *wkb = new unsigned char[OGR_G_WkbSize( geom )];
+      OGR_G_ExportToWkb( geom, ( OGRwkbByteOrder ) QgsApplication::endian(), wkb );
+
+      feature.setGeometryAndOwnership( wkb, OGR_G_WkbSize( geom ) );
+
+      if (( mRequest.flags() & QgsFeatureRequest::ExactIntersect ) &&
+          !mRequest.filterRect().isEmpty() &&
+          !feature.geometry()->intersects( mRequest.filterRect() ) )
+      {
+        //precise test for intersection with search rectangle
+        OGR_F_Destroy( fet );
+        continue;
+      }
+    }
+
+    /* fetch attributes */
+    for ( QgsAttributeList::const_iterator it = mAttributesToFetch.constBegin(); it != mAttributesToFetch.constEnd(); ++it )
+    {
+      P->getFeatureAttribute( fet, feature, *it );
+    }
+
+    feature.setValid( OGR_F_GetGeometryRef( fet ) != NULL );
+    OGR_F_Destroy( fet );
+    return true;
+  }
+
+  QgsDebugMsg( "Feature is null" );
+  // probably should reset reading here
+  OGR_L_ResetReading( ogrLayer );
+  return false;
+}
+
+bool QgsOgrFeatureIterator::rewind()
+{
+  if ( mClosed )
+    return false;
+
+  if ( mUsingProviderHandle )
+    ogrLayer = P->ogrLayer;
+
+  OGR_L_ResetReading( ogrLayer );
+  return true;
+}
+
+bool QgsOgrFeatureIterator::close()
+{
+  if ( mClosed )
+    return false;
+
+  if ( mHandle.layer )
+  {
+    P->releaseHandle( this, mHandle );
+  }
+
+  ogrLayer = 0;
+  mClosed = true;
+  return true;
+}
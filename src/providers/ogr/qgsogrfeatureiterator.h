@@ -0,0 +1,64 @@
+/***************************************************************************
+    qgsogrfeatureiterator.h
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSOGRFEATUREITERATOR_H
+#define QGSOGRFEATUREITERATOR_H
+
+#include "qgsfeatureiterator.h"
+#include "qgsogrprovider.h"
+
+#include <ogr_api.h>
+
+/**
+  Iterator over the features of an OGR layer.
+
+  The iterator reads from the provider's own data source handle if no other
+  iterator uses it. Only iterators that overlap get a second handle, which is
+  taken from a small pool of the provider or opened, so that they do not
+  interfere with each other.
+  */
+class QgsOgrFeatureIterator : public QgsAbstractFeatureIterator
+{
+  public:
+    QgsOgrFeatureIterator( QgsOgrProvider* p, const QgsFeatureRequest& request );
+
+    ~QgsOgrFeatureIterator();
+
+    //! fetch next feature, return true on success
+    virtual bool nextFeature( QgsFeature& feature );
+
+    //! reset the iterator to the starting position
+    virtual bool rewind();
+
+    //! end of iterating: free the resources / lock
+    virtual bool close();
+
+  protected:
+    //! tell OGR which fields to fetch (ie. which not to ignore)
+    void setRelevantFields();
+
+    QgsOgrProvider* P;
+
+    //! handle acquired from the provider (given back in close())
+    QgsOgrProvider::OgrHandle mHandle;
+
+    //! true if the iterator works on the provider's data source handle
+    bool mUsingProviderHandle;
+
+    OGRLayerH ogrLayer;
+
+    bool mFetchGeometry;
+    QgsAttributeList mAttributesToFetch;
+};
+
+#endif // QGSOGRFEATUREITERATOR_H
@@ -16,6 +16,7 @@ email                : sherman at mrcc.com
  ***************************************************************************/
 
 #include "qgsogrprovider.h"
+#include "qgsogrfeatureiterator.h"
 #include "qgslogger.h"
 #include "qgsmessagelog.h"
 
@@ -28,6 +29,9 @@ email                : sherman at mrcc.com
 
 #include <limits>
 
+// maximum number of idle data source handles kept per provider for overlapping iterators
+#define MAX_POOLED_HANDLES 2
+
 #include <QtDebug>
 #include <QFile>
 #include <QDir>
@@ -199,13 +203,13 @@ QgsOgrProvider::QgsOgrProvider( QString const & uri )
     , ogrDriver( 0 )
     , valid( false )
     , featuresCounted( -1 )
+    , mProviderHandleInUse( false )
+    , mHandleGeneration( 0 )
 {
   QgsCPLErrorHandler handler;
 
   QgsApplication::registerOgrDrivers();
 
-  // set the selection rectangle pointer to 0
-  mSelectionRectangle = 0;
   // make connection to the data source
 
   QgsDebugMsg( "Data source uri is " + uri );
@@ -316,6 +320,15 @@ QgsOgrProvider::QgsOgrProvider( QString const & uri )
 
 QgsOgrProvider::~QgsOgrProvider()
 {
+  while ( !mActiveIterators.empty() )
+  {
+    QgsOgrFeatureIterator *it = *mActiveIterators.begin();
+    QgsDebugMsg( "closing active iterator" );
+    it->close();
+  }
+
+  invalidateHandles();
+
   if ( ogrLayer != ogrOrigLayer )
   {
     OGR_DS_ReleaseResultSet( ogrDataSource, ogrLayer );
@@ -329,12 +342,6 @@ QgsOgrProvider::~QgsOgrProvider()
     free( extent_ );
     extent_ = 0;
   }
-
-  if ( mSelectionRectangle )
-  {
-    OGR_G_DestroyGeometry( mSelectionRectangle );
-    mSelectionRectangle = 0;
-  }
 }
 
 bool QgsOgrProvider::setSubsetString( QString theSQL, bool updateFeatureCount )
@@ -374,6 +381,9 @@ bool QgsOgrProvider::setSubsetString( QString theSQL, bool updateFeatureCount )
     OGR_DS_ReleaseResultSet( ogrDataSource, prevLayer );
   }
 
+  // pooled handles still run the previous subset
+  invalidateHandles();
+
   QString uri = mFilePath;
   if ( !mLayerName.isNull() )
   {
@@ -559,7 +569,7 @@ QString QgsOgrProvider::storageType() const
   return ogrDriverName;
 }
 
-void QgsOgrProvider::setRelevantFields( bool fetchGeometry, const QgsAttributeList &fetchAttributes )
+void QgsOgrProvider::setRelevantFields( OGRLayerH ogrLayer, bool fetchGeometry, const QgsAttributeList &fetchAttributes )
 {
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
   if ( OGR_L_TestCapability( ogrLayer, OLCIgnoreFields ) )
@@ -584,9 +594,11 @@ void QgsOgrProvider::setRelevantFields( bool fetchGeometry, const QgsAttributeLi
   }
 
   // mark that relevant fields may not be set appropriately for nextFeature() calls
-  mRelevantFieldsForNextFeature = false;
+  if ( ogrLayer == this->ogrLayer )
+    mRelevantFieldsForNextFeature = false;
 
 #else
+  Q_UNUSED( ogrLayer );
   Q_UNUSED( fetchGeometry );
   Q_UNUSED( fetchAttributes );
 #endif
@@ -597,18 +609,30 @@ bool QgsOgrProvider::featureAtId( QgsFeatureId featureId,
                                   bool fetchGeometry,
                                   QgsAttributeList fetchAttributes )
 {
-  setRelevantFields( fetchGeometry, fetchAttributes );
+  // use another handle while an iterator reads from the provider's one,
+  // so that its position and relevant fields are not disturbed
+  OgrHandle handle;
+  if ( !acquireHandle( 0, handle ) )
+    return false;
 
-  OGRFeatureH fet = OGR_L_GetFeature( ogrLayer, FID_TO_NUMBER( featureId ) );
+  OGRLayerH layer = handle.dataSource ? handle.layer : ogrLayer;
+
+  setRelevantFields( layer, fetchGeometry, fetchAttributes );
+
+  OGRFeatureH fet = OGR_L_GetFeature( layer, FID_TO_NUMBER( featureId ) );
   if ( !fet )
+  {
+    releaseHandle( 0, handle );
     return false;
+  }
 
   feature.setFeatureId( OGR_F_GetFID( fet ) );
-  feature.clearAttributeMap();
+  feature.initAttributes( mAttributeFields.size() );
   // skip features without geometry
   if ( !OGR_F_GetGeometryRef( fet ) && !mFetchFeaturesWithoutGeom )
   {
     OGR_F_Destroy( fet );
+    releaseHandle( 0, handle );
     return false;
   }
 
@@ -640,163 +664,42 @@ bool QgsOgrProvider::featureAtId( QgsFeatureId featureId,
     feature.setValid( false );
   }
   OGR_F_Destroy( fet );
+  releaseHandle( 0, handle );
   return true;
 }
 
-bool QgsOgrProvider::nextFeature( QgsFeature& feature )
+QgsFeatureIterator QgsOgrProvider::getFeatures( const QgsFeatureRequest& request )
 {
-  feature.setValid( false );
-
   if ( !valid )
   {
     QgsMessageLog::logMessage( tr( "Read attempt on an invalid OGR data source" ), tr( "OGR" ) );
-    return false;
+    return QgsFeatureIterator();
   }
 
-  if ( !mRelevantFieldsForNextFeature )
-  {
-    // setting relevant fields has some overhead so set it only when necessary
-    setRelevantFields( mFetchGeom || mUseIntersect || !mFetchRect.isEmpty(),
-                       mAttributesToFetch );
-    mRelevantFieldsForNextFeature = true;
-  }
-
-  OGRFeatureH fet;
-  QgsRectangle selectionRect;
-
-  while (( fet = OGR_L_GetNextFeature( ogrLayer ) ) )
-  {
-    // skip features without geometry
-    if ( !mFetchFeaturesWithoutGeom && !OGR_F_GetGeometryRef( fet ) )
-    {
-      OGR_F_Destroy( fet );
-      continue;
-    }
-
-    OGRFeatureDefnH featureDefinition = OGR_F_GetDefnRef( fet );
-    QString featureTypeName = featureDefinition ? QString( OGR_FD_GetName( featureDefinition ) ) : QString( "" );
-    feature.setFeatureId( OGR_F_GetFID( fet ) );
-    feature.clearAttributeMap();
-    feature.setTypeName( featureTypeName );
-
-    /* fetch geometry */
-    if ( mFetchGeom || mUseIntersect )
-    {
-      OGRGeometryH geom = OGR_F_GetGeometryRef( fet );
-
-      if ( geom == 0 )
-      {
-        OGR_F_Destroy( fet );
-        continue;
-      }
-
-      // get the wkb representation
-      unsigned char *wkb = new unsigned char[OGR_G_WkbSize( geom )];
-      OGR_G_ExportToWkb( geom, ( OGRwkbByteOrder ) QgsApplication::endian(), wkb );
-
-      feature.setGeometryAndOwnership( wkb, OGR_G_WkbSize( geom ) );
-
-      if ( mUseIntersect )
-      {
-        //precise test for intersection with search rectangle
-        //first make QgsRectangle from OGRPolygon
-        OGREnvelope env;
-        memset( &env, 0, sizeof( env ) );
-        if ( mSelectionRectangle )
-          OGR_G_GetEnvelope( mSelectionRectangle, &env );
-        if ( env.MinX != 0 || env.MinY != 0 || env.MaxX != 0 || env.MaxY != 0 ) //if envelope is invalid, skip the precise intersection test
-        {
-          selectionRect.set( env.MinX, env.MinY, env.MaxX, env.MaxY );
-          if ( !feature.geometry()->intersects( selectionRect ) )
-          {
-            OGR_F_Destroy( fet );
-            continue;
-          }
-        }
-
-      }
-    }
-
-    /* fetch attributes */
-    for ( QgsAttributeList::iterator it = mAttributesToFetch.begin(); it != mAttributesToFetch.end(); ++it )
-    {
-      getFeatureAttribute( fet, feature, *it );
-    }
-
-    /* we have a feature, end this cycle */
-    break;
+  return QgsFeatureIterator( new QgsOgrFeatureIterator( this, request ) );
+}
 
-  } /* while */
+bool QgsOgrProvider::nextFeature( QgsFeature& feature )
+{
+  feature.setValid( false );
 
-  if ( fet )
-  {
-    if ( OGR_F_GetGeometryRef( fet ) != NULL )
-    {
-      feature.setValid( true );
-    }
-    else
-    {
-      feature.setValid( false );
-    }
-    OGR_F_Destroy( fet );
-    return true;
-  }
-  else
+  if ( !valid )
   {
-    QgsDebugMsg( "Feature is null" );
-    // probably should reset reading here
-    OGR_L_ResetReading( ogrLayer );
+    QgsMessageLog::logMessage( tr( "Read attempt on an invalid OGR data source" ), tr( "OGR" ) );
     return false;
   }
+
+  return mSelectIterator.nextFeature( feature );
 }
 
 void QgsOgrProvider::select( QgsAttributeList fetchAttributes, QgsRectangle rect, bool fetchGeometry, bool useIntersect )
 {
-  if ( geometryType() == QGis::WKBNoGeometry )
-  {
-    fetchGeometry = false;
-  }
-
-  mUseIntersect = useIntersect;
-  mAttributesToFetch = fetchAttributes;
-  mFetchGeom = fetchGeometry;
-  mFetchRect = rect;
-
-  setRelevantFields( mFetchGeom || mUseIntersect || !mFetchRect.isEmpty(),
-                     mAttributesToFetch );
-  mRelevantFieldsForNextFeature = true;
-
-  // spatial query to select features
-  if ( rect.isEmpty() )
-  {
-    OGR_L_SetSpatialFilter( ogrLayer, 0 );
-  }
-  else
-  {
-    OGRGeometryH filter = 0;
-    QString wktExtent = QString( "POLYGON((%1))" ).arg( rect.asPolygon() );
-    QByteArray ba = wktExtent.toAscii();
-    const char *wktText = ba;
-
-    if ( useIntersect )
-    {
-      // store the selection rectangle for use in filtering features during
-      // an identify and display attributes
-      if ( mSelectionRectangle )
-        OGR_G_DestroyGeometry( mSelectionRectangle );
-
-      OGR_G_CreateFromWkt(( char ** )&wktText, NULL, &mSelectionRectangle );
-      wktText = ba;
-    }
-
-    OGR_G_CreateFromWkt(( char ** )&wktText, NULL, &filter );
-    QgsDebugMsg( "Setting spatial filter using " + wktExtent );
-    OGR_L_SetSpatialFilter( ogrLayer, filter );
-    OGR_G_DestroyGeometry( filter );
-  }
+  if ( !valid )
+    return;
 
-  //start with first feature
-  OGR_L_ResetReading( ogrLayer );
+  // close the previous iterator first so that the new one can take over the provider's handle
+  mSelectIterator.close();
+  mSelectIterator = QgsFeatureIterator( new QgsOgrFeatureIterator( this, selectRequest( fetchAttributes, rect, fetchGeometry, useIntersect ) ) );
 }
 
 
@@ -947,7 +850,10 @@ const QgsFieldMap & QgsOgrProvider::fields() const
 
 void QgsOgrProvider::rewind()
 {
-  OGR_L_ResetReading( ogrLayer );
+  if ( !mSelectIterator.rewind() )
+  {
+    OGR_L_ResetReading( ogrLayer );
+  }
 }
 
 
@@ -1043,7 +949,7 @@ bool QgsOgrProvider::addFeature( QgsFeature& f )
 
 bool QgsOgrProvider::addFeatures( QgsFeatureList & flist )
 {
-  setRelevantFields( true, mAttributeFields.keys() );
+  setRelevantFields( ogrLayer, true, mAttributeFields.keys() );
 
   bool returnvalue = true;
   for ( QgsFeatureList::iterator it = flist.begin(); it != flist.end(); ++it )
@@ -1102,6 +1008,7 @@ bool QgsOgrProvider::addAttributes( const QList<QgsField> &attributes )
     }
     OGR_Fld_Destroy( fielddefn );
   }
+  invalidateHandles();
   loadFields();
   return returnvalue;
 }
@@ -1121,6 +1028,7 @@ bool QgsOgrProvider::deleteAttributes( const QgsAttributeIds &attributes )
       res = false;
     }
   }
+  invalidateHandles();
   loadFields();
   return res;
 #else
@@ -1138,7 +1046,7 @@ bool QgsOgrProvider::changeAttributeValues( const QgsChangedAttributesMap & attr
 
   clearMinMaxCache();
 
-  setRelevantFields( true, mAttributeFields.keys() );
+  setRelevantFields( ogrLayer, true, mAttributeFields.keys() );
 
   for ( QgsChangedAttributesMap::const_iterator it = attr_map.begin(); it != attr_map.end(); ++it )
   {
@@ -1205,6 +1113,7 @@ bool QgsOgrProvider::changeAttributeValues( const QgsChangedAttributesMap & attr
   }
 
   OGR_L_SyncToDisk( ogrLayer );
+  invalidateHandles();
   return true;
 }
 
@@ -1213,7 +1122,7 @@ bool QgsOgrProvider::changeGeometryValues( QgsGeometryMap & geometry_map )
   OGRFeatureH theOGRFeature = 0;
   OGRGeometryH theNewGeometry = 0;
 
-  setRelevantFields( true, mAttributeFields.keys() );
+  setRelevantFields( ogrLayer, true, mAttributeFields.keys() );
 
   for ( QgsGeometryMap::iterator it = geometry_map.begin(); it != geometry_map.end(); ++it )
   {
@@ -1325,6 +1234,7 @@ bool QgsOgrProvider::deleteFeatures( const QgsFeatureIds & id )
   QgsDebugMsg( QString( "SQL: %1" ).arg( sql ) );
   OGR_DS_ExecuteSQL( ogrDataSource, mEncoding->fromUnicode( sql ).constData(), NULL, NULL );
 
+  invalidateHandles();
   recalculateFeatureCount();
 
   clearMinMaxCache();
@@ -2264,6 +2174,9 @@ bool QgsOgrProvider::syncToDisc()
 {
   OGR_L_SyncToDisk( ogrLayer );
 
+  // handles opened before the changes may not see them
+  invalidateHandles();
+
   //for shapefiles: is there already a spatial index?
   if ( !mFilePath.isEmpty() )
   {
@@ -2288,6 +2201,119 @@ bool QgsOgrProvider::syncToDisc()
   return true;
 }
 
+bool QgsOgrProvider::acquireHandle( QgsOgrFeatureIterator* iterator, OgrHandle& handle )
+{
+  QMutexLocker locker( &mHandleMutex );
+
+  if ( !mProviderHandleInUse )
+  {
+    mProviderHandleInUse = true;
+    handle.dataSource = 0;
+    handle.layer = ogrLayer;
+    handle.subsetLayer = 0;
+    handle.generation = mHandleGeneration;
+  }
+  else if ( !mHandlePool.isEmpty() )
+  {
+    handle = mHandlePool.takeLast();
+  }
+  else
+  {
+    // readers overlap: open a second handle
+    handle.generation = mHandleGeneration;
+    handle.subsetLayer = 0;
+    handle.layer = 0;
+    handle.dataSource = OGROpen( TO8F( mFilePath ), false, NULL );
+    if ( !handle.dataSource )
+    {
+      QgsMessageLog::logMessage( tr( "Could not open data source for iterating (%1)" ).arg( QString::fromUtf8( CPLGetLastErrorMsg() ) ), tr( "OGR" ) );
+      return false;
+    }
+
+    // same layer selection as for the provider's handle: the layer name has precedence over the layer id
+    if ( mLayerName.isNull() )
+      handle.layer = OGR_DS_GetLayer( handle.dataSource, mLayerIndex );
+    else
+      handle.layer = OGR_DS_GetLayerByName( handle.dataSource, TO8( mLayerName ) );
+
+    if ( handle.layer && !mSubsetString.isEmpty() )
+    {
+      QString sql = QString( "SELECT * FROM %1 WHERE %2" )
+                    .arg( quotedIdentifier( FROM8( OGR_FD_GetName( OGR_L_GetLayerDefn( handle.layer ) ) ) ) )
+                    .arg( mSubsetString );
+      handle.subsetLayer = OGR_DS_ExecuteSQL( handle.dataSource, mEncoding->fromUnicode( sql ).constData(), NULL, NULL );
+      handle.layer = handle.subsetLayer;
+    }
+
+    if ( !handle.layer )
+    {
+      QgsMessageLog::logMessage( tr( "Could not open layer for iterating (%1)" ).arg( QString::fromUtf8( CPLGetLastErrorMsg() ) ), tr( "OGR" ) );
+      closeHandle( handle );
+      return false;
+    }
+  }
+
+  if ( iterator )
+    mActiveIterators << iterator;
+
+  return true;
+}
+
+void QgsOgrProvider::releaseHandle( QgsOgrFeatureIterator* iterator, OgrHandle& handle )
+{
+  QMutexLocker locker( &mHandleMutex );
+
+  if ( iterator )
+    mActiveIterators.remove( iterator );
+
+  if ( !handle.dataSource )
+  {
+    mProviderHandleInUse = false;
+  }
+  else if ( handle.generation == mHandleGeneration && mHandlePool.size() < MAX_POOLED_HANDLES )
+  {
+    mHandlePool << handle;
+  }
+  else
+  {
+    closeHandle( handle );
+  }
+
+  handle.dataSource = 0;
+  handle.layer = 0;
+  handle.subsetLayer = 0;
+}
+
+void QgsOgrProvider::invalidateHandles()
+{
+  QMutexLocker locker( &mHandleMutex );
+
+  ++mHandleGeneration;
+
+  for ( QList<OgrHandle>::iterator it = mHandlePool.begin(); it != mHandlePool.end(); ++it )
+  {
+    closeHandle( *it );
+  }
+  mHandlePool.clear();
+}
+
+void QgsOgrProvider::closeHandle( OgrHandle& handle )
+{
+  if ( handle.subsetLayer )
+  {
+    OGR_DS_ReleaseResultSet( handle.dataSource, handle.subsetLayer );
+    handle.subsetLayer = 0;
+  }
+
+  if ( handle.dataSource )
+  {
+    OGR_DS_Destroy( handle.dataSource );
+    handle.dataSource = 0;
+  }
+
+  handle.layer = 0;
+}
+
 void QgsOgrProvider::recalculateFeatureCount()
 {
   OGRGeometryH filter = OGR_L_GetSpatialFilter( ogrLayer );
@@ -15,6 +15,9 @@ email                : sherman at mrcc.com
  *                                                                         *
  ***************************************************************************/
 
+#ifndef QGSOGRPROVIDER_H
+#define QGSOGRPROVIDER_H
+
 #include "qgsrectangle.h"
 #include "qgsvectordataprovider.h"
 #include "qgsvectorfilewriter.h"
@@ -22,9 +25,12 @@ email                : sherman at mrcc.com
 
 class QgsField;
 class QgsVectorLayerImport;
+class QgsOgrFeatureIterator;
 
 #include <ogr_api.h>
 
+#include <QMutex>
+
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
 #define TO8(x)   (x).toUtf8().constData()
 #define TO8F(x)  (x).toUtf8().constData()
@@ -83,6 +89,13 @@ class QgsOgrProvider : public QgsVectorDataProvider
      */
     virtual QString storageType() const;
 
+    /**
+     * Query the provider for features specified in request.
+     * Every iterator opens its own handle of the data source.
+     * @note added in 1.9
+     */
+    virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest& request = QgsFeatureRequest() );
+
     /** Select features based on a bounding rectangle. Features can be retrieved with calls to nextFeature.
      *  @param fetchAttributes list of attributes which should be fetched
      *  @param rect spatial filter
@@ -275,6 +288,10 @@ class QgsOgrProvider : public QgsVectorDataProvider
      */
     QString description() const;
 
+    /** each provider instance has its own data source handle
+        @note added in 1.9 */
+    bool isThreadSafe() const { return true; }
+
     /** Returns true if the provider is strict about the type of inserted features
           (e.g. no multipolygon in a polygon layer)
           @note: added in version 1.4*/
@@ -294,7 +311,7 @@ class QgsOgrProvider : public QgsVectorDataProvider
     void recalculateFeatureCount();
 
     /** tell OGR, which fields to fetch in nextFeature/featureAtId (ie. which not to ignore) */
-    void setRelevantFields( bool fetchGeometry, const QgsAttributeList& fetchAttributes );
+    void setRelevantFields( OGRLayerH ogrLayer, bool fetchGeometry, const QgsAttributeList& fetchAttributes );
 
     /** convert a QgsField to work with OGR */
     static bool convertField( QgsField &field, const QTextCodec &encoding );
@@ -320,9 +337,6 @@ class QgsOgrProvider : public QgsVectorDataProvider
     //! layer index
     int mLayerIndex;
 
-    //! current spatial filter
-    QgsRectangle mFetchRect;
-
     //! String used to define a subset of the layer
     QString mSubsetString;
 
@@ -333,8 +347,6 @@ class QgsOgrProvider : public QgsVectorDataProvider
     QString ogrDriverName;
 
     bool valid;
-    //! Flag to indicate that spatial intersect should be used in selecting features
-    bool mUseIntersect;
     int geomType;
     long featuresCounted;
 
@@ -345,8 +357,51 @@ class QgsOgrProvider : public QgsVectorDataProvider
      */
     bool mRelevantFieldsForNextFeature;
 
-    //! Selection rectangle
-    OGRGeometryH mSelectionRectangle;
+    //! iterators that have not been closed yet
+    QSet<QgsOgrFeatureIterator *> mActiveIterators;
+
+    /** Data source handle used for reading: either the provider's own handle
+        (dataSource is 0 then) or a separately opened one */
+    struct OgrHandle
+    {
+      OGRDataSourceH dataSource;
+      OGRLayerH layer;
+      //! layer returned by OGR_DS_ExecuteSQL for the subset string, or 0
+      OGRLayerH subsetLayer;
+      //! value of mHandleGeneration when the handle was opened
+      int generation;
+    };
+
+    /** Hands out the provider's own handle if it is not in use, otherwise an idle
+        handle from the pool or a newly opened one.
+        @param iterator registered as active iterator if not 0
+        @return false if no data source could be opened */
+    bool acquireHandle( QgsOgrFeatureIterator* iterator, OgrHandle& handle );
+
+    /** Gives a handle from acquireHandle() back. Other handles than the provider's
+        own go to the pool unless it is full or the handle is outdated */
+    void releaseHandle( QgsOgrFeatureIterator* iterator, OgrHandle& handle );
+
+    /** Closes the pooled handles and marks the handles in use as outdated.
+        Needed whenever the subset or the data change, other handles would not see that */
+    void invalidateHandles();
+
+    /** Releases the subset layer and closes the data source of a separately opened handle */
+    static void closeHandle( OgrHandle& handle );
+
+    //! guards mActiveIterators, mProviderHandleInUse and the handle pool
+    QMutex mHandleMutex;
+
+    //! true while an iterator (or featureAtId()) reads from the provider's handle
+    bool mProviderHandleInUse;
+
+    //! idle handles that were opened because the provider's handle was in use
+    QList<OgrHandle> mHandlePool;
+
+    //! incremented by invalidateHandles()
+    int mHandleGeneration;
+
+    friend class QgsOgrFeatureIterator;
     /**Adds one feature*/
     bool addFeature( QgsFeature& f );
     /**Deletes one feature*/
@@ -357,3 +412,5 @@ class QgsOgrProvider : public QgsVectorDataProvider
     /**Calls OGR_L_SyncToDisk and recreates the spatial index if present*/
     bool syncToDisc();
 };
+
+#endif // QGSOGRPROVIDER_H
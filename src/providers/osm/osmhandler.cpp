@@ -20,29 +20,40 @@
 #include "qgsapplication.h"
 #include "qgsgeometry.h"
 
-#include <QtXml/QXmlSimpleReader>
-#include <QtXml/QXmlInputSource>
-#include <QtGui/QApplication>
-#include <QtGui/QLabel>
-#include <QtXml/QXmlAttributes>
 #include <QtCore/QFile>
 
 #define MAX_FEATURE_ID 99999999
 #define COMMIT_AFTER_TAGS 300000
 
 
+// helpers binding attribute values without going through QVariant or intermediate strings
+static void bindText( sqlite3_stmt *stmt, int col, const QStringRef &value )
+{
+  QByteArray utf8 = value.toString().toUtf8();
+  sqlite3_bind_text( stmt, col, utf8.constData(), utf8.size(), SQLITE_TRANSIENT );
+}
+
+static void bindText( sqlite3_stmt *stmt, int col, const QByteArray &value )
+{
+  sqlite3_bind_text( stmt, col, value.constData(), value.size(), SQLITE_STATIC );
+}
+
+
 // object construction
 OsmHandler::OsmHandler( QFile *f, sqlite3 *database )
 {
   Q_UNUSED( f );
   mDatabase = database;
+  mFinished = false;
   mCnt = 0;
   mPointCnt = mLineCnt = mPolygonCnt = 0;
   mPosId = 1;
   xMin = yMin = MAX_FEATURE_ID;
   xMax = yMax = -MAX_FEATURE_ID;
-  firstWayMemberId = "";
+  mHasWayMember = false;
+  firstWayMemberId = lastWayMemberId = 0;
   mFirstMemberAppeared = 0;
+  mObjectId = 0;
 
   char sqlInsertNode[] = "INSERT INTO node ( id, lat, lon, timestamp, user, usage ) VALUES (?,?,?,?,?,'0');";
   if ( sqlite3_prepare_v2( mDatabase, sqlInsertNode, sizeof( sqlInsertNode ), &mStmtInsertNode, 0 ) != SQLITE_OK )
@@ -98,6 +109,54 @@ OsmHandler::~OsmHandler()
   sqlite3_finalize( mStmtInsertVersion );
 }
 
+bool OsmHandler::parse( const QByteArray& data )
+{
+  mReader.addData( data );
+
+  while ( !mReader.atEnd() )
+  {
+    switch ( mReader.readNext() )
+    {
+      case QXmlStreamReader::StartDocument:
+        if ( !startDocument() )
+          return false;
+        break;
+
+      case QXmlStreamReader::StartElement:
+        if ( !startElement( mReader.name(), mReader.attributes() ) )
+          return false;
+        break;
+
+      case QXmlStreamReader::EndElement:
+        if ( !endElement( mReader.name() ) )
+          return false;
+        break;
+
+      case QXmlStreamReader::EndDocument:
+        if ( !endDocument() )
+          return false;
+        break;
+
+      case QXmlStreamReader::Invalid:
+        // the token continues in the next chunk of data
+        if ( mReader.error() == QXmlStreamReader::PrematureEndOfDocumentError )
+          return true;
+
+        mError = QString( "%1 (line %2, column %3)" ).arg( mReader.errorString() ).arg( mReader.lineNumber() ).arg( mReader.columnNumber() );
+        return false;
+
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+bool OsmHandler::isFinished() const
+{
+  return mFinished;
+}
+
 bool OsmHandler::startDocument()
 {
   sqlite3_exec( mDatabase, "BEGIN;", 0, 0, 0 );
@@ -109,43 +168,52 @@ QString OsmHandler::errorString() const
   return mError;
 }
 
-bool OsmHandler::startElement( const QString & pUri, const QString & pLocalName, const QString & pName, const QXmlAttributes & pAttrs )
+bool OsmHandler::insertVersion( const QStringRef & pVersion )
 {
-  Q_UNUSED( pUri );
-  Q_UNUSED( pName );
-  QString name = pLocalName;
+  // store version number of this object
+  sqlite3_bind_int64( mStmtInsertVersion, 1, mObjectId );
+  bindText( mStmtInsertVersion, 2, mObjectType );
+  sqlite3_bind_int( mStmtInsertVersion, 3, pVersion.toString().toInt() );
+
+  if ( sqlite3_step( mStmtInsertVersion ) != SQLITE_DONE )
+  {
+    QgsDebugMsg( "Storing version information into database failed." );
+    return false;
+  }
+  sqlite3_reset( mStmtInsertVersion ); // make ready for next insert
+  return true;
+}
 
-  if ( name == "osm" )
+bool OsmHandler::startElement( const QStringRef & pName, const QXmlStreamAttributes & pAttrs )
+{
+  if ( pName == QLatin1String( "osm" ) )
   {
-    if ( pAttrs.value( "version" ) != "0.6" )
+    if ( pAttrs.value( QLatin1String( "version" ) ) != QLatin1String( "0.6" ) )
     {
       mError = "Invalid OSM version. Only files of v0.6 are supported.";
       return false;
     }
   }
-  else if ( name == "node" )
+  else if ( pName == QLatin1String( "node" ) )
   {
-    //todo: test if pAttrs.value("visible").toUtf8() is "true" -> if not, node has to be ignored!
+    //todo: test if pAttrs.value("visible") is "true" -> if not, node has to be ignored!
 
-    mObjectId = pAttrs.value( "id" );
+    mObjectId = pAttrs.value( QLatin1String( "id" ) ).toString().toLongLong();
     mObjectType = "node";
 
-    double id = pAttrs.value( "id" ).toInt();
-    double lat = pAttrs.value( "lat" ).toDouble();
-    double lon = pAttrs.value( "lon" ).toDouble();
-    QString timestamp = pAttrs.value( "timestamp" );
-    QString user = pAttrs.value( "user" );
+    double lat = pAttrs.value( QLatin1String( "lat" ) ).toString().toDouble();
+    double lon = pAttrs.value( QLatin1String( "lon" ) ).toString().toDouble();
 
     if ( lat < yMin ) yMin = lat;
     if ( lat > yMax ) yMax = lat;
     if ( lon < xMin ) xMin = lon;
     if ( lon > xMax ) xMax = lon;
 
-    sqlite3_bind_int( mStmtInsertNode, 1, id );
+    sqlite3_bind_int64( mStmtInsertNode, 1, mObjectId );
     sqlite3_bind_double( mStmtInsertNode, 2, lat );
     sqlite3_bind_double( mStmtInsertNode, 3, lon );
-    sqlite3_bind_text( mStmtInsertNode, 4, timestamp.toUtf8(), -1, SQLITE_TRANSIENT ); // TODO: maybe static?
-    sqlite3_bind_text( mStmtInsertNode, 5, user.toUtf8(), -1, SQLITE_TRANSIENT ); // TODO: maybe static?
+    bindText( mStmtInsertNode, 4, pAttrs.value( QLatin1String( "timestamp" ) ) );
+    bindText( mStmtInsertNode, 5, pAttrs.value( QLatin1String( "user" ) ) );
 
     if ( sqlite3_step( mStmtInsertNode ) != SQLITE_DONE )
     {
@@ -155,63 +223,49 @@ bool OsmHandler::startElement( const QString & pUri, const QString & pLocalName,
 
     sqlite3_reset( mStmtInsertNode ); // make ready for next insert
 
-    // store version number of this object
-    sqlite3_bind_text( mStmtInsertVersion, 1, pAttrs.value( "id" ).toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertVersion, 2, mObjectType.toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertVersion, 3, pAttrs.value( "version" ).toUtf8(), -1, SQLITE_TRANSIENT );
-
-    if ( sqlite3_step( mStmtInsertVersion ) != SQLITE_DONE )
-    {
-      QgsDebugMsg( "Storing version information into database failed." );
+    if ( !insertVersion( pAttrs.value( QLatin1String( "version" ) ) ) )
       return false;
-    }
-    sqlite3_reset( mStmtInsertVersion ); // make ready for next insert
 
     // increase node counter
     mPointCnt++;
   }
-  else if ( name == "way" )
+  else if ( pName == QLatin1String( "way" ) )
   {
-    mObjectId = pAttrs.value( "id" );
+    mObjectId = pAttrs.value( QLatin1String( "id" ) ).toString().toLongLong();
     mObjectType = "way";
     mPosId = 1;
+    mHasWayMember = false;
     mFirstMemberAppeared = 0;
 
-    //todo: test if pAttrs.value("visible").toUtf8() is "true" -> if not, way has to be ignored!
+    //todo: test if pAttrs.value("visible") is "true" -> if not, way has to be ignored!
 
-    sqlite3_bind_text( mStmtInsertWay, 1, mObjectId.toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertWay, 2, pAttrs.value( "timestamp" ).toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertWay, 3, pAttrs.value( "user" ).toUtf8(), -1, SQLITE_TRANSIENT );
+    sqlite3_bind_int64( mStmtInsertWay, 1, mObjectId );
+    bindText( mStmtInsertWay, 2, pAttrs.value( QLatin1String( "timestamp" ) ) );
+    bindText( mStmtInsertWay, 3, pAttrs.value( QLatin1String( "user" ) ) );
 
-    // store version number of this object
-    sqlite3_bind_text( mStmtInsertVersion, 1, pAttrs.value( "id" ).toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertVersion, 2, mObjectType.toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertVersion, 3, pAttrs.value( "version" ).toUtf8(), -1, SQLITE_TRANSIENT );
-
-    if ( sqlite3_step( mStmtInsertVersion ) != SQLITE_DONE )
-    {
-      QgsDebugMsg( "Storing version information into database failed." );
+    if ( !insertVersion( pAttrs.value( QLatin1String( "version" ) ) ) )
       return false;
-    }
-    sqlite3_reset( mStmtInsertVersion ); // make ready for next insert
   }
-  else if ( name == "nd" )
+  else if ( pName == QLatin1String( "nd" ) )
   {
+    qint64 ref = pAttrs.value( QLatin1String( "ref" ) ).toString().toLongLong();
+
     // store id of the first and last way member to be able to decide if the way is closed (polygon) or not
-    if ( firstWayMemberId == "" )
+    if ( !mHasWayMember )
     {
-      firstWayMemberId = pAttrs.value( "ref" );
+      firstWayMemberId = ref;
+      mHasWayMember = true;
     }
-    lastWayMemberId = pAttrs.value( "ref" );
+    lastWayMemberId = ref;
 
     if ( firstWayMemberId == lastWayMemberId )
       mFirstMemberAppeared++;
 
     if (( firstWayMemberId != lastWayMemberId ) || ( mFirstMemberAppeared < 2 ) )
     {
-      sqlite3_bind_text( mStmtInsertWayMember, 1, mObjectId.toUtf8(), -1, SQLITE_TRANSIENT ); // TODO: maybe static?
+      sqlite3_bind_int64( mStmtInsertWayMember, 1, mObjectId );
       sqlite3_bind_int( mStmtInsertWayMember, 2, mPosId );
-      sqlite3_bind_text( mStmtInsertWayMember, 3, pAttrs.value( "ref" ).toUtf8(), -1, SQLITE_TRANSIENT );
+      sqlite3_bind_int64( mStmtInsertWayMember, 3, ref );
 
       if ( sqlite3_step( mStmtInsertWayMember ) != SQLITE_DONE )
       {
@@ -222,38 +276,29 @@ bool OsmHandler::startElement( const QString & pUri, const QString & pLocalName,
     }
     mPosId++;
   }
-  else if ( name == "relation" )
+  else if ( pName == QLatin1String( "relation" ) )
   {
-    mObjectId = pAttrs.value( "id" );
+    mObjectId = pAttrs.value( QLatin1String( "id" ) ).toString().toLongLong();
     mRelationType = "";
     mObjectType = "relation";
     mPosId = 1;
 
-    //todo: test if pAttrs.value("visible").toUtf8() is "true" -> if not, relation has to be ignored!
-
-    sqlite3_bind_text( mStmtInsertRelation, 1, mObjectId.toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertRelation, 2, pAttrs.value( "timestamp" ).toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertRelation, 3, pAttrs.value( "user" ).toUtf8(), -1, SQLITE_TRANSIENT );
+    //todo: test if pAttrs.value("visible") is "true" -> if not, relation has to be ignored!
 
-    // store version number of this object
-    sqlite3_bind_text( mStmtInsertVersion, 1, pAttrs.value( "id" ).toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertVersion, 2, mObjectType.toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertVersion, 3, pAttrs.value( "version" ).toUtf8(), -1, SQLITE_TRANSIENT );
+    sqlite3_bind_int64( mStmtInsertRelation, 1, mObjectId );
+    bindText( mStmtInsertRelation, 2, pAttrs.value( QLatin1String( "timestamp" ) ) );
+    bindText( mStmtInsertRelation, 3, pAttrs.value( QLatin1String( "user" ) ) );
 
-    if ( sqlite3_step( mStmtInsertVersion ) != SQLITE_DONE )
-    {
-      QgsDebugMsg( "Storing version information into database failed." );
+    if ( !insertVersion( pAttrs.value( QLatin1String( "version" ) ) ) )
       return false;
-    }
-    sqlite3_reset( mStmtInsertVersion ); // make ready for next insert
   }
-  else if ( name == "member" )
+  else if ( pName == QLatin1String( "member" ) )
   {
-    sqlite3_bind_text( mStmtInsertRelationMember, 1, mObjectId.toUtf8(), -1, SQLITE_TRANSIENT );
+    sqlite3_bind_int64( mStmtInsertRelationMember, 1, mObjectId );
     sqlite3_bind_int( mStmtInsertRelationMember, 2, mPosId );
-    sqlite3_bind_text( mStmtInsertRelationMember, 3, pAttrs.value( "ref" ).toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertRelationMember, 4, pAttrs.value( "type" ).toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertRelationMember, 5, pAttrs.value( "role" ).toUtf8(), -1, SQLITE_TRANSIENT );
+    sqlite3_bind_int64( mStmtInsertRelationMember, 3, pAttrs.value( QLatin1String( "ref" ) ).toString().toLongLong() );
+    bindText( mStmtInsertRelationMember, 4, pAttrs.value( QLatin1String( "type" ) ) );
+    bindText( mStmtInsertRelationMember, 5, pAttrs.value( QLatin1String( "role" ) ) );
 
     if ( sqlite3_step( mStmtInsertRelationMember ) != SQLITE_DONE )
     {
@@ -264,7 +309,7 @@ bool OsmHandler::startElement( const QString & pUri, const QString & pLocalName,
     sqlite3_reset( mStmtInsertRelationMember );
     mPosId++;
   }
-  else if ( name == "tag" )
+  else if ( pName == QLatin1String( "tag" ) )
   {
     if ( mCnt == COMMIT_AFTER_TAGS )
     {
@@ -274,26 +319,29 @@ bool OsmHandler::startElement( const QString & pUri, const QString & pLocalName,
     }
     mCnt++;
 
-    sqlite3_bind_text( mStmtInsertTag, 1, pAttrs.value( "k" ).toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertTag, 2, pAttrs.value( "v" ).toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertTag, 3, mObjectId.toUtf8(), -1, SQLITE_TRANSIENT );
-    sqlite3_bind_text( mStmtInsertTag, 4, mObjectType.toUtf8(), -1, SQLITE_TRANSIENT );
+    QStringRef key = pAttrs.value( QLatin1String( "k" ) );
+    QStringRef val = pAttrs.value( QLatin1String( "v" ) );
+
+    bindText( mStmtInsertTag, 1, key );
+    bindText( mStmtInsertTag, 2, val );
+    sqlite3_bind_int64( mStmtInsertTag, 3, mObjectId );
+    bindText( mStmtInsertTag, 4, mObjectType );
 
     // we've got node parameters -> let's create new database record
     if ( sqlite3_step( mStmtInsertTag ) != SQLITE_DONE )
     {
-      QgsDebugMsg( QString( "Storing tag into database failed. K:%1, V:%2." ).arg( pAttrs.value( "k" ) ).arg( pAttrs.value( "v" ) ) );
+      QgsDebugMsg( QString( "Storing tag into database failed. K:%1, V:%2." ).arg( key.toString() ).arg( val.toString() ) );
       return false;
     }
     sqlite3_reset( mStmtInsertTag );
 
     // if we are under xml tag <relation> and we reach xml tag <tag k="type" v="...">, lets insert prepared relation into DB
-    if (( mObjectType == "relation" ) && ( pAttrs.value( "k" ) == "type" ) )
+    if (( mObjectType == "relation" ) && ( key == QLatin1String( "type" ) ) )
     {
-      mRelationType = pAttrs.value( "v" );
+      mRelationType = val.toString();
     }
   }
-  else if ( name == "bounds" )
+  else if ( pName == QLatin1String( "bounds" ) )
   {
     // e.g. <bounds minlat="41.388625" minlon="2.15426" maxlat="41.391732" maxlon="2.158192"/>
 
@@ -306,12 +354,9 @@ bool OsmHandler::startElement( const QString & pUri, const QString & pLocalName,
 }
 
 
-bool OsmHandler::endElement( const QString & pURI, const QString & pLocalName, const QString & pName )
+bool OsmHandler::endElement( const QStringRef & pName )
 {
-  Q_UNUSED( pURI );
-  Q_UNUSED( pName );
-  QString name = pLocalName;
-  if ( name == "way" )
+  if ( pName == QLatin1String( "way" ) )
   {
     int isPolygon = false;
     int cntMembers = mPosId - 1;
@@ -350,11 +395,8 @@ bool OsmHandler::endElement( const QString & pURI, const QString & pLocalName, c
       mPolygonCnt++;
     else
       mLineCnt++;
-
-    // make variables ready for next way parsing
-    firstWayMemberId = "";
   }
-  else if ( name == "relation" )
+  else if ( pName == QLatin1String( "relation" ) )
   {
     sqlite3_bind_text( mStmtInsertRelation, 4, mRelationType.toUtf8(), -1, SQLITE_TRANSIENT );
 
@@ -373,6 +415,6 @@ bool OsmHandler::endDocument()
 {
   // first commit all database actions connected to xml parsing
   sqlite3_exec( mDatabase, "COMMIT;", 0, 0, 0 );
+  mFinished = true;
   return true;
 }
-
@@ -12,20 +12,22 @@
  *                                                                         *
  ***************************************************************************/
 
+#include <QByteArray>
 #include <QFile>
-#include <QProgressDialog>
 #include <QString>
-#include <QXmlDefaultHandler>
-#include <QXmlAttributes>
+#include <QStringRef>
+#include <QXmlStreamAttributes>
+#include <QXmlStreamReader>
 
 #include <sqlite3.h>
 
 
 /**
- * The SAX handler used for parsing input OSM XML file.
- * While processing XML file it stores data to specified sqlite database.
+ * The streaming handler used for parsing input OSM XML file.
+ * The file is fed to the handler in chunks, it pulls XML tokens from them and
+ * stores data to specified sqlite database with prepared statements while processing them.
  */
-class OsmHandler: public QXmlDefaultHandler
+class OsmHandler
 {
   public:
     /**
@@ -40,51 +42,62 @@ class OsmHandler: public QXmlDefaultHandler
      */
     ~OsmHandler();
 
+    /**
+     * Adds next chunk of the OSM file and processes all XML tokens that are complete.
+     * Tokens that continue in the next chunk are processed in next call.
+     * @param data next part of input OSM XML
+     * @return True if the data were processed without problems; False if XML is not correct or storing failed
+     */
+    bool parse( const QByteArray& data );
+
+    /**
+     * Tells if the end of OSM document was reached.
+     * @return True if the whole document was processed
+     */
+    bool isFinished() const;
+
+    /**
+     * Returns information on error that occures while parsing.
+     * @return info on error that occures while parsing
+     */
+    QString errorString() const;
+
+  private:
     // input OSM XML processing
 
     /**
      * Function is called after XML processing is started.
-     * @return True if start of document signal is processed without problems; False otherwise
+     * @return True if start of document is processed without problems; False otherwise
      */
     bool startDocument();
 
     /**
-     * The reader of OSM file calls this function when it has parsed a start element tag.
-     * If this function returns false the reader stops parsing and reports an error.
-     * The reader uses the function errorString() to get the error message.
-     *
-     * @param pUri namespace URI of element, or an empty string if the element has no namespace URI or if no namespace processing is done
-     * @param pLocalName local name of element (without prefix), or an empty string if no namespace processing is done
-     * @param pName qualified name of element (with prefix)
-     * @param pAttrs attributes attached to the element; if there are no attributes, atts is an empty attributes object.
-     * @return True if start of element signal is processed without problems; False otherwise
+     * Function is called when a start element tag was read.
+     * @param pName local name of element
+     * @param pAttrs attributes attached to the element
+     * @return True if start of element is processed without problems; False otherwise
      */
-    bool startElement( const QString & pUri, const QString & pLocalName, const QString & pName, const QXmlAttributes & pAttrs );
+    bool startElement( const QStringRef & pName, const QXmlStreamAttributes & pAttrs );
 
     /**
-     * The reader calls this function when it has parsed an end element tag with the qualified name pName,
-     * the local name pLocalName and the namespace URI pURI.
-     * If this function returns false the reader stops parsing and reports an error.
-     * The reader uses the function errorString() to get the error message.
-     *
-     * @param pUri namespace URI of element, or an empty string if the element has no namespace URI or if no namespace processing is done
-     * @param pLocalName local name of element (without prefix), or an empty string if no namespace processing is done
-     * @param pName qualified name of element (with prefix)
-     * @return True if end of element signal is processed without problems; False otherwise
+     * Function is called when an end element tag was read.
+     * @param pName local name of element
+     * @return True if end of element is processed without problems; False otherwise
      */
-    bool endElement( const QString & pURI, const QString & pLocalName, const QString & pName );
+    bool endElement( const QStringRef & pName );
 
     /**
      * Function is called after end of document is reached while XML processing.
-     * @return True if end of document signal is processed without problems; False otherwise
+     * @return True if end of document is processed without problems; False otherwise
      */
     bool endDocument();
 
     /**
-     * Returns information on error that occures while parsing.
-     * @return info on error that occures while parsing
+     * Stores version number of the object that is being parsed.
+     * @param pVersion value of version attribute
+     * @return True if version is stored without problems; False otherwise
      */
-    QString errorString() const;
+    bool insertVersion( const QStringRef & pVersion );
 
   public:
     int mPointCnt;
@@ -93,28 +106,26 @@ class OsmHandler: public QXmlDefaultHandler
     double xMin, xMax, yMin, yMax;
 
   private:
+    QXmlStreamReader mReader;
+    bool mFinished;
+
     sqlite3_stmt *mStmtInsertNode;
     sqlite3_stmt *mStmtInsertWay;
     sqlite3_stmt *mStmtInsertTag;
     sqlite3_stmt *mStmtInsertWayMember;
     sqlite3_stmt *mStmtInsertRelation;
     sqlite3_stmt *mStmtInsertRelationMember;
-    sqlite3_stmt *mStmtUpdateNode;
     sqlite3_stmt *mStmtInsertVersion;
 
     sqlite3 *mDatabase;
     int mPosId;
-    QString firstWayMemberId;
-    QString lastWayMemberId;
+    bool mHasWayMember;
+    qint64 firstWayMemberId;
+    qint64 lastWayMemberId;
     int mFirstMemberAppeared;
     int mCnt;
     QString mError;
-    QString mObjectId;         //last node, way or relation id while parsing file
-    QString mObjectType;       //one of "node", "way", "relation"
+    qint64 mObjectId;          //last node, way or relation id while parsing file
+    QByteArray mObjectType;    //one of "node", "way", "relation"
     QString mRelationType;
 };
-
-
-
-
-
@@ -27,11 +27,12 @@
 #include <QFileInfo>
 #include <QDateTime>
 #include <QByteArray>
+#include <QVector>
 
 static const QString TEXT_PROVIDER_KEY = "osm";
 static const QString TEXT_PROVIDER_DESCRIPTION = "Open Street Map data provider";
 static const QString DATE_TIME_FMT = "dd.MM.yyyy HH:mm:ss";
-static const QString PROVIDER_VERSION = "0.5.1";
+static const QString PROVIDER_VERSION = "0.5.2";
 
 // supported attributes
 const char* QgsOSMDataProvider::attr[] = { "timestamp", "user", "tags" };
@@ -44,6 +45,9 @@ QgsOSMDataProvider::QgsOSMDataProvider( QString uri )
   QgsDebugMsg( "Initializing provider: " + uri );
 
   mDatabaseStmt = NULL;
+  mWayMembersStmt = NULL;
+  mUpdateWayStmt = NULL;
+  mUseRTree = false;
   mValid = false;
 
   // set the selection rectangle to null
@@ -242,6 +246,9 @@ QgsOSMDataProvider::QgsOSMDataProvider( QString uri )
     sqlite3_finalize( stmtSelectBoundary );
   }
 
+  // selections from some boundary use R*Tree indexes if there are any
+  mUseRTree = hasSpatialIndexes();
+  QgsDebugMsg( QString( "R*Tree indexes %1" ).arg( mUseRTree ? "used" : "not available" ) );
 
   // prepare statement for tag retrieval
   char sqlSelectTags[] = "SELECT key, val FROM tag WHERE object_id=? AND object_type=?";
@@ -282,13 +289,21 @@ QgsOSMDataProvider::QgsOSMDataProvider( QString uri )
     char sqlSelectPoints[] = "SELECT id, lat, lon, timestamp, user FROM node WHERE usage=0 AND status<>'R' AND u=1";
     char sqlSelectPointsIn[] = "SELECT id, lat, lon, timestamp, user FROM node WHERE usage=0 AND status<>'R' AND u=1 \
                                 AND lat>=? AND lat<=? AND lon>=? AND lon<=?";
+    // R*Tree keeps float boundaries rounded outwards -> exact test follows
+    char sqlSelectPointsInRTree[] = "SELECT n.id, n.lat, n.lon, n.timestamp, n.user FROM node_rtree r CROSS JOIN node n \
+                                     WHERE n.i=r.id AND r.max_lat>=?1 AND r.min_lat<=?2 AND r.max_lon>=?3 AND r.min_lon<=?4 \
+                                     AND n.usage=0 AND n.status<>'R' AND n.u=1 AND n.lat>=?1 AND n.lat<=?2 AND n.lon>=?3 AND n.lon<=?4";
 
     if ( sqlite3_prepare_v2( mDatabase, sqlSelectPoints, sizeof( sqlSelectPoints ), &mSelectFeatsStmt, 0 ) != SQLITE_OK )
     {
       QgsDebugMsg( "sqlite3 statement for points retrieval - prepare failed." );
       return;
     }
-    if ( sqlite3_prepare_v2( mDatabase, sqlSelectPointsIn, sizeof( sqlSelectPointsIn ), &mSelectFeatsInStmt, 0 ) != SQLITE_OK )
+    if ( mUseRTree )
+      rc = sqlite3_prepare_v2( mDatabase, sqlSelectPointsInRTree, sizeof( sqlSelectPointsInRTree ), &mSelectFeatsInStmt, 0 );
+    else
+      rc = sqlite3_prepare_v2( mDatabase, sqlSelectPointsIn, sizeof( sqlSelectPointsIn ), &mSelectFeatsInStmt, 0 );
+    if ( rc != SQLITE_OK )
     {
       QgsDebugMsg( "sqlite3 statement for points in boundary retrieval - prepare failed." );
       return;
@@ -300,13 +315,20 @@ QgsOSMDataProvider::QgsOSMDataProvider( QString uri )
     char sqlSelectLinesIn[] = "SELECT w.id, w.wkb, w.timestamp, w.user FROM way w WHERE w.closed=0 AND w.status<>'R' AND w.u=1 \
                                AND (((w.max_lat between ? AND ?) OR (w.min_lat between ? AND ?) OR (w.min_lat<? AND w.max_lat>?)) \
                                AND ((w.max_lon between ? AND ?) OR (w.min_lon between ? AND ?) OR (w.min_lon<? AND w.max_lon>?)))";
+    char sqlSelectLinesInRTree[] = "SELECT w.id, w.wkb, w.timestamp, w.user FROM way_rtree r CROSS JOIN way w \
+                                    WHERE w.i=r.id AND r.max_lat>=?1 AND r.min_lat<=?2 AND r.max_lon>=?3 AND r.min_lon<=?4 \
+                                    AND w.closed=0 AND w.status<>'R' AND w.u=1";
 
     if ( sqlite3_prepare_v2( mDatabase, sqlSelectLines, sizeof( sqlSelectLines ), &mSelectFeatsStmt, 0 ) != SQLITE_OK )
     {
       QgsDebugMsg( "sqlite3 statement for lines retrieval - prepare failed." );
       return;
     }
-    if ( sqlite3_prepare_v2( mDatabase, sqlSelectLinesIn, sizeof( sqlSelectLinesIn ), &mSelectFeatsInStmt, 0 ) != SQLITE_OK )
+    if ( mUseRTree )
+      rc = sqlite3_prepare_v2( mDatabase, sqlSelectLinesInRTree, sizeof( sqlSelectLinesInRTree ), &mSelectFeatsInStmt, 0 );
+    else
+      rc = sqlite3_prepare_v2( mDatabase, sqlSelectLinesIn, sizeof( sqlSelectLinesIn ), &mSelectFeatsInStmt, 0 );
+    if ( rc != SQLITE_OK )
     {
       QgsDebugMsg( "sqlite3 statement for lines in boundary retrieval - prepare failed." );
       return;
@@ -318,13 +340,20 @@ QgsOSMDataProvider::QgsOSMDataProvider( QString uri )
     char sqlSelectPolysIn[] = "SELECT w.id, w.wkb, w.timestamp, w.user FROM way w WHERE w.closed=1 AND w.status<>'R' AND w.u=1 \
                                AND (((w.max_lat between ? AND ?) OR (w.min_lat between ? AND ?) OR (w.min_lat<? AND w.max_lat>?)) \
                                AND ((w.max_lon between ? AND ?) OR (w.min_lon between ? AND ?) OR (w.min_lon<? AND w.max_lon>?)))";
+    char sqlSelectPolysInRTree[] = "SELECT w.id, w.wkb, w.timestamp, w.user FROM way_rtree r CROSS JOIN way w \
+                                    WHERE w.i=r.id AND r.max_lat>=?1 AND r.min_lat<=?2 AND r.max_lon>=?3 AND r.min_lon<=?4 \
+                                    AND w.closed=1 AND w.status<>'R' AND w.u=1";
 
     if ( sqlite3_prepare_v2( mDatabase, sqlSelectPolys, sizeof( sqlSelectPolys ), &mSelectFeatsStmt, 0 ) != SQLITE_OK )
     {
       QgsDebugMsg( "sqlite3 statement for polygons retrieval - prepare failed." );
       return;
     }
-    if ( sqlite3_prepare_v2( mDatabase, sqlSelectPolysIn, sizeof( sqlSelectPolysIn ), &mSelectFeatsInStmt, 0 ) != SQLITE_OK )
+    if ( mUseRTree )
+      rc = sqlite3_prepare_v2( mDatabase, sqlSelectPolysInRTree, sizeof( sqlSelectPolysInRTree ), &mSelectFeatsInStmt, 0 );
+    else
+      rc = sqlite3_prepare_v2( mDatabase, sqlSelectPolysIn, sizeof( sqlSelectPolysIn ), &mSelectFeatsInStmt, 0 );
+    if ( rc != SQLITE_OK )
     {
       QgsDebugMsg( "sqlite3 statement for polygons in boundary retrieval - prepare failed." );
       return;
@@ -348,6 +377,8 @@ QgsOSMDataProvider::~QgsOSMDataProvider()
   sqlite3_finalize( mNodeStmt );
   sqlite3_finalize( mSelectFeatsStmt );
   sqlite3_finalize( mSelectFeatsInStmt );
+  sqlite3_finalize( mWayMembersStmt );
+  sqlite3_finalize( mUpdateWayStmt );
 
   // close opened sqlite3 database
   if ( mDatabase )
@@ -454,9 +485,9 @@ void QgsOSMDataProvider::select( QgsAttributeList fetchAttributes,
   // sqlite3 statement that is well prepared for this purpose
   mDatabaseStmt = mSelectFeatsInStmt;
 
-  if ( mFeatureType == PointType )
+  if ( mFeatureType == PointType || mUseRTree )
   {
-    // binding variables (boundary) for points selection!
+    // binding variables (boundary) for points selection or for R*Tree selection of ways!
     sqlite3_bind_double( mDatabaseStmt, 1, mSelectionRectangle.yMinimum() );
     sqlite3_bind_double( mDatabaseStmt, 2, mSelectionRectangle.yMaximum() );
     sqlite3_bind_double( mDatabaseStmt, 3, mSelectionRectangle.xMinimum() );
@@ -674,22 +705,24 @@ bool QgsOSMDataProvider::fetchWay( QgsFeature& feature, sqlite3_stmt* stmt, bool
 
     if ( fetchGeometry || mSelectUseIntersect || !mSelectionRectangle.isEmpty() )
     {
-      pnBlob = sqlite3_column_bytes( stmt, 1 );
-      pzBlob = new unsigned char[pnBlob];
-      memcpy( pzBlob, sqlite3_column_blob( stmt, 1 ), pnBlob );
-
       // create geometry
       theGeometry = new QgsGeometry();
-      theGeometry->fromWkb(( unsigned char * ) pzBlob, pnBlob );
-    }
+      pnBlob = sqlite3_column_bytes( stmt, 1 );
 
-    if ( theGeometry && ( theGeometry->type() == 3 ) && ( selId != 0 ) )
-    {
-      // line/polygon geometry is not cached!
-      char *geo;
-      int geolen;
-      updateWayWKB( selId, ( mFeatureType == LineType ) ? 0 : 1, &geo, &geolen );
-      theGeometry->fromWkb(( unsigned char * ) geo, ( size_t ) geolen );
+      if ( pnBlob > 0 )
+      {
+        pzBlob = new unsigned char[pnBlob];
+        memcpy( pzBlob, sqlite3_column_blob( stmt, 1 ), pnBlob );
+        theGeometry->fromWkb(( unsigned char * ) pzBlob, pnBlob );
+      }
+      else if ( selId != 0 )
+      {
+        // line/polygon geometry is not cached yet, compute and store it
+        char *geo;
+        int geolen;
+        if ( updateWayWKB( selId, ( mFeatureType == LineType ) ? 0 : 1, &geo, &geolen ) )
+          theGeometry->fromWkb(( unsigned char * ) geo, ( size_t ) geolen );
+      }
     }
 
     if ( mSelectUseIntersect )
@@ -1002,142 +1035,129 @@ int QgsOSMDataProvider::capabilities() const
 }
 
 
-bool QgsOSMDataProvider::updateWayWKB( int wayId, int isClosed, char **geo, int *geolen )
+bool QgsOSMDataProvider::updateWayWKB( int wayId, int isClosed, char **geo, int *geolen, bool *hasAllMembers )
 {
-  sqlite3_stmt *stmtSelectMembers;
-  char sqlSelectMembers[] = "SELECT n.lat, n.lon, n.id FROM way_member wm, node n WHERE wm.way_id=? AND wm.node_id=n.id AND n.u=1 AND wm.u=1 ORDER BY wm.pos_id ASC;";
-  if ( sqlite3_prepare_v2( mDatabase, sqlSelectMembers, sizeof( sqlSelectMembers ), &stmtSelectMembers, 0 ) != SQLITE_OK )
+  // statements are prepared once and reused for all the ways
+  if ( !mWayMembersStmt )
   {
-    QgsDebugMsg( "Failed to prepare sqlSelectMembers!!!" );
-    return false;
+    char sqlSelectMembers[] = "SELECT n.lat, n.lon, n.id FROM way_member wm LEFT JOIN node n ON wm.node_id=n.id AND n.u=1 WHERE wm.way_id=? AND wm.u=1 ORDER BY wm.pos_id ASC;";
+    if ( sqlite3_prepare_v2( mDatabase, sqlSelectMembers, sizeof( sqlSelectMembers ), &mWayMembersStmt, 0 ) != SQLITE_OK )
+    {
+      QgsDebugMsg( "Failed to prepare sqlSelectMembers!!!" );
+      sqlite3_finalize( mWayMembersStmt );
+      mWayMembersStmt = NULL;
+      return false;
+    }
   }
 
-  sqlite3_stmt *stmtUpdateWay;
-  char sqlUpdateWay[] = "UPDATE way SET wkb=?, membercnt=?, min_lat=?, min_lon=?, max_lat=?, max_lon=? WHERE id=? AND u=1";
-  if ( sqlite3_prepare_v2( mDatabase, sqlUpdateWay, sizeof( sqlUpdateWay ), &stmtUpdateWay, 0 ) != SQLITE_OK )
+  if ( !mUpdateWayStmt )
   {
-    QgsDebugMsg( "Failed to prepare sqlUpdateWay!!!" );
-    return false;
+    char sqlUpdateWay[] = "UPDATE way SET wkb=?, membercnt=?, min_lat=?, min_lon=?, max_lat=?, max_lon=? WHERE id=? AND u=1";
+    if ( sqlite3_prepare_v2( mDatabase, sqlUpdateWay, sizeof( sqlUpdateWay ), &mUpdateWayStmt, 0 ) != SQLITE_OK )
+    {
+      QgsDebugMsg( "Failed to prepare sqlUpdateWay!!!" );
+      sqlite3_finalize( mUpdateWayStmt );
+      mUpdateWayStmt = NULL;
+      return false;
+    }
   }
 
-  // create wkb for selected way (if way is closed then it's polygon and it's geometry is different)
-  int memberCnt = wayMemberCount( wayId );
-  if ( memberCnt == -1 )
-    return false;
+  // read coordinates of all the way members at once, no need to count them first
+  QVector<double> coords;
+  bool allMembers = true;
+  sqlite3_bind_int( mWayMembersStmt, 1, wayId );
+
+  int step_result;
+  while (( step_result = sqlite3_step( mWayMembersStmt ) ) != SQLITE_DONE )
+  {
+    if ( step_result != SQLITE_ROW )
+    {
+      QgsDebugMsg( QString( "Selecting members of way %1 failed." ).arg( wayId ) );
+      break;
+    }
+    if ( sqlite3_column_type( mWayMembersStmt, 2 ) == SQLITE_NULL )
+    {
+      // member node is not in the database
+      allMembers = false;
+      continue;
+    }
+    coords << sqlite3_column_double( mWayMembersStmt, 1 ); // lon
+    coords << sqlite3_column_double( mWayMembersStmt, 0 ); // lat
+  }
+  sqlite3_reset( mWayMembersStmt );
+
+  if ( hasAllMembers )
+  {
+    *hasAllMembers = allMembers;
+    if ( !allMembers )
+      return false;
+  }
+
+  int memberCnt = coords.size() / 2;
 
   double minLat = 1000.0, minLon = 1000.0;
   double maxLat = -1000.0, maxLon = -1000.0;
 
+  for ( int i = 0; i < memberCnt; i++ )
+  {
+    double selLon = coords[2 * i];
+    double selLat = coords[2 * i + 1];
+
+    if ( selLat < minLat ) minLat = selLat;
+    if ( selLon < minLon ) minLon = selLon;
+    if ( selLat > maxLat ) maxLat = selLat;
+    if ( selLon > maxLon ) maxLon = selLon;
+  }
+
+  // create wkb for selected way (if way is closed then it's polygon and it's geometry is different)
   if ( !isClosed )
   {
-    ( *geo ) = new char[9 + 16 * memberCnt];
     ( *geolen ) = 9 + 16 * memberCnt;
-
-    memset(( *geo ), 0, 9 + 16 * memberCnt );
+    ( *geo ) = new char[*geolen];
+    memset(( *geo ), 0, *geolen );
 
     ( *geo )[0] = QgsApplication::endian();
     ( *geo )[( *geo )[0] == QgsApplication::NDR ? 1 : 4] = QGis::WKBLineString;
     memcpy(( *geo ) + 5, &memberCnt, 4 );
-
-    sqlite3_bind_int( stmtSelectMembers, 1, wayId );
-
-    int step_result;
-    int i = 0;
-    while (( step_result = sqlite3_step( stmtSelectMembers ) ) != SQLITE_DONE )
-    {
-      if ( step_result != SQLITE_ROW )
-      {
-        QgsDebugMsg( QString( "Selecting members of way %1 failed." ).arg( wayId ) );
-        break;
-      }
-
-      double selLat = sqlite3_column_double( stmtSelectMembers, 0 );
-      double selLon = sqlite3_column_double( stmtSelectMembers, 1 );
-
-      if ( selLat < minLat ) minLat = selLat;
-      if ( selLon < minLon ) minLon = selLon;
-      if ( selLat > maxLat ) maxLat = selLat;
-      if ( selLon > maxLon ) maxLon = selLon;
-
-      memcpy(( *geo ) + 9 + 16 * i, &selLon, sizeof( double ) );
-      memcpy(( *geo ) + 9 + 16 * i + 8, &selLat, sizeof( double ) );
-      i++;
-    }
-
-    sqlite3_bind_blob( stmtUpdateWay, 1, ( *geo ), 9 + 16 * memberCnt, SQLITE_TRANSIENT );
+    if ( memberCnt > 0 )
+      memcpy(( *geo ) + 9, coords.constData(), 16 * memberCnt );
   }
   else
   {
-    // it's a polygon
+    // it's a polygon, its ring is closed with the first point
     int ringsCnt = 1;
+    double firstLon = memberCnt > 0 ? coords[0] : -1000.0;
+    double firstLat = memberCnt > 0 ? coords[1] : -1000.0;
+    coords << firstLon << firstLat;
     memberCnt++;
-    ( *geo ) = new char[13 + 16 * memberCnt];
+
     ( *geolen ) = 13 + 16 * memberCnt;
-    memset(( *geo ), 0, 13 + 16 * memberCnt );
+    ( *geo ) = new char[*geolen];
+    memset(( *geo ), 0, *geolen );
+
     ( *geo )[0] = QgsApplication::endian();
     ( *geo )[( *geo )[0] == QgsApplication::NDR ? 1 : 4] = QGis::WKBPolygon;
     memcpy(( *geo ) + 5, &ringsCnt, 4 );
     memcpy(( *geo ) + 9, &memberCnt, 4 );
-
-    sqlite3_bind_int( stmtSelectMembers, 1, wayId );
-
-    int step_result;
-    int i = 0;
-    double firstLat = -1000.0;
-    double firstLon = -1000.0;
-    while (( step_result = sqlite3_step( stmtSelectMembers ) ) != SQLITE_DONE )
-    {
-      if ( step_result != SQLITE_ROW )
-      {
-        QgsDebugMsg( QString( "Selecting members of polygon %1 failed." ).arg( wayId ) );
-        break;
-      }
-
-      double selLat = sqlite3_column_double( stmtSelectMembers, 0 );
-      double selLon = sqlite3_column_double( stmtSelectMembers, 1 );
-
-      if ( selLat < minLat ) minLat = selLat;
-      if ( selLon < minLon ) minLon = selLon;
-      if ( selLat > maxLat ) maxLat = selLat;
-      if ( selLon > maxLon ) maxLon = selLon;
-
-      memcpy(( *geo ) + 13 + 16 * i, &selLon, sizeof( double ) );
-      memcpy(( *geo ) + 13 + 16 * i + 8, &selLat, sizeof( double ) );
-
-      if ( firstLat == -1000.0 )
-        firstLat = selLat;
-      if ( firstLon == -1000.0 )
-        firstLon = selLon;
-      i++;
-    }
-    // add last polygon line
-    memcpy(( *geo ) + 13 + 16 * i, &firstLon, sizeof( double ) );
-    memcpy(( *geo ) + 13 + 16 * i + 8, &firstLat, sizeof( double ) );
-
-    sqlite3_bind_blob( stmtUpdateWay, 1, ( *geo ), 13 + 16 * memberCnt, SQLITE_TRANSIENT );
+    memcpy(( *geo ) + 13, coords.constData(), 16 * memberCnt );
   }
 
-  sqlite3_reset( stmtSelectMembers );
-
   // now update way record
-  sqlite3_bind_int( stmtUpdateWay, 2, memberCnt );
-  sqlite3_bind_double( stmtUpdateWay, 3, minLat );
-  sqlite3_bind_double( stmtUpdateWay, 4, minLon );
-  sqlite3_bind_double( stmtUpdateWay, 5, maxLat );
-  sqlite3_bind_double( stmtUpdateWay, 6, maxLon );
-  sqlite3_bind_int( stmtUpdateWay, 7, wayId );
+  sqlite3_bind_blob( mUpdateWayStmt, 1, ( *geo ), *geolen, SQLITE_TRANSIENT );
+  sqlite3_bind_int( mUpdateWayStmt, 2, memberCnt );
+  sqlite3_bind_double( mUpdateWayStmt, 3, minLat );
+  sqlite3_bind_double( mUpdateWayStmt, 4, minLon );
+  sqlite3_bind_double( mUpdateWayStmt, 5, maxLat );
+  sqlite3_bind_double( mUpdateWayStmt, 6, maxLon );
+  sqlite3_bind_int( mUpdateWayStmt, 7, wayId );
 
-  if ( sqlite3_step( stmtUpdateWay ) != SQLITE_DONE )
+  bool updated = sqlite3_step( mUpdateWayStmt ) == SQLITE_DONE;
+  if ( !updated )
   {
     QgsDebugMsg( QString( "Updating way with id=%1 failed." ).arg( wayId ) );
-    return false;
   }
-  sqlite3_reset( stmtUpdateWay );
-
-  // destroy database statements
-  sqlite3_finalize( stmtSelectMembers );
-  sqlite3_finalize( stmtUpdateWay );
-  return true;
+  sqlite3_reset( mUpdateWayStmt );
+  return updated;
 }
 
 
@@ -1153,10 +1173,10 @@ bool QgsOSMDataProvider::updateNodes()
 }
 
 
-bool QgsOSMDataProvider::removeIncorrectWays()
+bool QgsOSMDataProvider::removeIncorrectWays( const QList<int>& wayIds )
 {
-  sqlite3_exec( mDatabase, "BEGIN;", 0, 0, 0 );
-  int wayId;
+  if ( wayIds.isEmpty() )
+    return true;
 
   char sqlRemoveWay[] = "delete from way where id=?";
   sqlite3_stmt *stmtRemoveWay;
@@ -1179,19 +1199,10 @@ bool QgsOSMDataProvider::removeIncorrectWays()
     QgsDebugMsg( "failed to prepare stmtRemoveWayTags!!!" );
   }
 
-  char sqlSelectWays[] = "select distinct way_id wid from way_member wm where not exists(select 1 from node n where wm.node_id=n.id);";
-  sqlite3_stmt *stmtSelectWays;
-  if ( sqlite3_prepare_v2( mDatabase, sqlSelectWays, sizeof( sqlSelectWays ), &stmtSelectWays, 0 ) != SQLITE_OK )
-  {
-    QgsDebugMsg( "failed to prepare stmtSelectWays!!!" );
-  }
-
-  int i = 0;
-  while ( sqlite3_step( stmtSelectWays ) == SQLITE_ROW )
+  bool removed = true;
+  foreach( int wayId, wayIds )
   {
     // remove both way, tag records, way_member records
-    wayId = sqlite3_column_int( stmtSelectWays, 0 );
-
     sqlite3_bind_int( stmtRemoveWay, 1, wayId );
     sqlite3_bind_int( stmtRemoveWayMembers, 1, wayId );
     sqlite3_bind_int( stmtRemoveWayTags, 1, wayId );
@@ -1200,38 +1211,33 @@ bool QgsOSMDataProvider::removeIncorrectWays()
     if ( sqlite3_step( stmtRemoveWay ) != SQLITE_DONE )
     {
       QgsDebugMsg( "Removing way failed." );
-      sqlite3_exec( mDatabase, "ROLLBACK;", 0, 0, 0 );
-      return false;
+      removed = false;
+      break;
     }
     if ( sqlite3_step( stmtRemoveWayMembers ) != SQLITE_DONE )
     {
       QgsDebugMsg( "Removing way members failed." );
-      sqlite3_exec( mDatabase, "ROLLBACK;", 0, 0, 0 );
-      return false;
+      removed = false;
+      break;
     }
     if ( sqlite3_step( stmtRemoveWayTags ) != SQLITE_DONE )
     {
       QgsDebugMsg( "Removing way tags failed." );
-      sqlite3_exec( mDatabase, "ROLLBACK;", 0, 0, 0 );
-      return false;
+      removed = false;
+      break;
     }
 
     // make statements ready for the next run
     sqlite3_reset( stmtRemoveWay );
     sqlite3_reset( stmtRemoveWayMembers );
     sqlite3_reset( stmtRemoveWayTags );
-    i++;
   }
   // destroy database statements
   sqlite3_finalize( stmtRemoveWay );
   sqlite3_finalize( stmtRemoveWayMembers );
   sqlite3_finalize( stmtRemoveWayTags );
-  sqlite3_finalize( stmtSelectWays );
-
-  // commit actions
-  sqlite3_exec( mDatabase, "COMMIT;", 0, 0, 0 );
 
-  return true;
+  return removed;
 }
 
 
@@ -1241,30 +1247,24 @@ bool QgsOSMDataProvider::postparsing()
   if ( mInitObserver ) mInitObserver->setProperty( "osm_max", QVariant( 3 ) );
   if ( mInitObserver ) mInitObserver->setProperty( "osm_value", QVariant( 0 ) );
 
+  // all the post-parsing changes of nodes and ways are done in one transaction
+  sqlite3_exec( mDatabase, "BEGIN;", 0, 0, 0 );
+
   // update node table
   updateNodes();
 
-  if ( mInitObserver ) mInitObserver->setProperty( "osm_status", QVariant( "Post-parsing: Removing incorrect ways." ) );
-  if ( mInitObserver ) mInitObserver->setProperty( "osm_max", QVariant( 3 ) );
-  if ( mInitObserver ) mInitObserver->setProperty( "osm_value", QVariant( 1 ) );
-
-  removeIncorrectWays();
-
   if ( mInitObserver ) mInitObserver->setProperty( "osm_status", QVariant( "Post-parsing: Caching ways geometries." ) );
   if ( mInitObserver ) mInitObserver->setProperty( "osm_max", QVariant( 3 ) );
-  if ( mInitObserver ) mInitObserver->setProperty( "osm_value", QVariant( 2 ) );
-
-  // select ways, for each of them compute its wkb and store it into database
-  sqlite3_exec( mDatabase, "BEGIN;", 0, 0, 0 );
+  if ( mInitObserver ) mInitObserver->setProperty( "osm_value", QVariant( 1 ) );
 
+  // select ways, for each of them compute its wkb and store it into database;
+  // ways with members missing in loaded data are found in the same pass
   int wayId, isClosed;
-  // prepare select: get information about one specified point
-  QString cmd = QString( "SELECT id, closed FROM way;" );
-  QByteArray cmd_bytes = cmd.toAscii();
-  const char *ptr = cmd_bytes.data();
+  QList<int> incorrectWays;
+  char sqlSelectWays[] = "SELECT id, closed FROM way;";
 
   sqlite3_stmt *databaseStmt;
-  if ( sqlite3_prepare_v2( mDatabase, ptr, cmd_bytes.size(), &databaseStmt, 0 ) != SQLITE_OK )
+  if ( sqlite3_prepare_v2( mDatabase, sqlSelectWays, sizeof( sqlSelectWays ), &databaseStmt, 0 ) != SQLITE_OK )
   {
     QgsDebugMsg( QString( "Creating BLOBs in postprocessing failed." ) );
     sqlite3_exec( mDatabase, "ROLLBACK;", 0, 0, 0 );
@@ -1276,22 +1276,43 @@ bool QgsOSMDataProvider::postparsing()
     if (( mInitObserver ) && ( mInitObserver->property( "osm_stop_parsing" ).toInt() == 1 ) )
     {
       QgsDebugMsg( QString( "Loading the OSM data was stopped." ) );
+      sqlite3_finalize( databaseStmt );
       sqlite3_exec( mDatabase, "ROLLBACK;", 0, 0, 0 );
       return false;
     }
     wayId = sqlite3_column_int( databaseStmt, 0 );
     isClosed = sqlite3_column_int( databaseStmt, 1 );
-    char *geo;
+    char *geo = 0;
     int geolen;
-    updateWayWKB( wayId, isClosed, &geo, &geolen );   // todo: return value!
+    bool hasAllMembers = true;
+    bool updated = updateWayWKB( wayId, isClosed, &geo, &geolen, &hasAllMembers );
+    delete [] geo;
+    if ( !updated && !hasAllMembers )
+      incorrectWays << wayId;
   }
 
   // destroy database statements
   sqlite3_finalize( databaseStmt );
 
+  // ways are removed after the select is done
+  if ( !removeIncorrectWays( incorrectWays ) )
+  {
+    sqlite3_exec( mDatabase, "ROLLBACK;", 0, 0, 0 );
+    return false;
+  }
+  QgsDebugMsg( QString( "%1 incorrect ways removed." ).arg( incorrectWays.count() ) );
+
   // commit our actions
   sqlite3_exec( mDatabase, "COMMIT;", 0, 0, 0 );
 
+  if ( mInitObserver ) mInitObserver->setProperty( "osm_status", QVariant( "Post-parsing: Building spatial index." ) );
+  if ( mInitObserver ) mInitObserver->setProperty( "osm_max", QVariant( 3 ) );
+  if ( mInitObserver ) mInitObserver->setProperty( "osm_value", QVariant( 2 ) );
+
+  // triggers are created after parsing, index all the nodes and ways at once
+  if ( hasSpatialIndexes() && !createSpatialIndexes() )
+    QgsDebugMsg( "Building spatial index failed." );
+
   if ( mInitObserver ) mInitObserver->setProperty( "osm_max", QVariant( 3 ) );
   if ( mInitObserver ) mInitObserver->setProperty( "osm_value", QVariant( 3 ) );
 
@@ -1307,12 +1328,13 @@ bool QgsOSMDataProvider::loadOsmFile( QString osm_filename )
 
   if ( mInitObserver ) mInitObserver->setProperty( "osm_status", QVariant( "Parsing the OSM file." ) );
 
-  OsmHandler *handler = new OsmHandler( &f, mDatabase );
-  QXmlSimpleReader reader;
-  reader.setContentHandler( handler );
+  // database file is removed if the import fails -> no need for journal and syncing while importing
+  setImportMode( true );
+
+  OsmHandler handler( &f, mDatabase );
 
-  const int sectorSize = 8192;
-  int cntSectors = f.size() / sectorSize;
+  const int sectorSize = 262144;
+  int cntSectors = f.size() / sectorSize + 1;
   if ( mInitObserver ) mInitObserver->setProperty( "osm_max", QVariant( cntSectors ) );
 
   if ( !f.open( QIODevice::ReadOnly ) )
@@ -1321,12 +1343,8 @@ bool QgsOSMDataProvider::loadOsmFile( QString osm_filename )
     return false;
   }
 
-  QXmlInputSource source;
-  source.setData( f.read( sectorSize ) );
-  int sector = 1;
-
   QgsDebugMsg( QString( "Parsing file: %1" ).arg( osm_filename ) );
-  bool res = reader.parse( &source, true );
+  int sector = 0;
   while ( !f.atEnd() )
   {
     if (( mInitObserver ) && ( mInitObserver->property( "osm_stop_parsing" ).toInt() == 1 ) )
@@ -1335,20 +1353,24 @@ bool QgsOSMDataProvider::loadOsmFile( QString osm_filename )
       sqlite3_exec( mDatabase, "ROLLBACK;", 0, 0, 0 );
       return false;
     }
-    if (( !res ) && ( sector < cntSectors - 2 ) )
+    if ( !handler.parse( f.read( sectorSize ) ) )
     {
       // osm file parsing failed
-      if ( mInitObserver ) mInitObserver->setProperty( "osm_failure", QVariant( handler->errorString() ) );
+      QgsDebugMsg( "Parsing the OSM XML failed: " + handler.errorString() );
+      if ( mInitObserver ) mInitObserver->setProperty( "osm_failure", QVariant( handler.errorString() ) );
+      sqlite3_exec( mDatabase, "ROLLBACK;", 0, 0, 0 );
       return false;
     }
     // parsing process can continue
-    source.setData( f.read( sectorSize ) );
     if ( mInitObserver ) mInitObserver->setProperty( "osm_value", QVariant( ++sector ) );
-    res = reader.parseContinue();
   }
   f.close();
 
-  QgsDebugMsg( "Parsing complete. Result: " + QString::number( res ) );
+  // truncated file -> keep what was read so far
+  if ( !handler.isFinished() )
+    QgsDebugMsg( "OSM file ended before the end of document, using the data parsed so far." );
+
+  QgsDebugMsg( "Parsing complete." );
 
   QgsDebugMsg( "Creating indexes..." );
   if ( mInitObserver ) mInitObserver->setProperty( "osm_status", QVariant( "Creating indexes." ) );
@@ -1399,10 +1421,10 @@ bool QgsOSMDataProvider::loadOsmFile( QString osm_filename )
   }
 
   // store information got with handler into provider member variables
-  xMin = handler->xMin;    // boundaries defining the area of all features
-  xMax = handler->xMax;
-  yMin = handler->yMin;
-  yMax = handler->yMax;
+  xMin = handler.xMin;    // boundaries defining the area of all features
+  xMax = handler.xMax;
+  yMin = handler.yMin;
+  yMax = handler.yMax;
 
   // storing boundary information into database
   QString cmd3 = QString( "INSERT INTO meta ( key, val ) VALUES ('default-area-boundaries','%1:%2:%3:%4');" )
@@ -1425,10 +1447,44 @@ bool QgsOSMDataProvider::loadOsmFile( QString osm_filename )
     return false;
   }
   sqlite3_exec( mDatabase, "COMMIT;", 0, 0, 0 );
+
+  setImportMode( false );
   return true;
 }
 
 
+void QgsOSMDataProvider::setImportMode( bool enabled )
+{
+  const char* importPragmas[] =
+  {
+    "PRAGMA journal_mode=OFF;",
+    "PRAGMA synchronous=OFF;",
+    "PRAGMA cache_size=50000;",
+    "PRAGMA temp_store=MEMORY;"
+  };
+
+  // defaults of sqlite3
+  const char* defaultPragmas[] =
+  {
+    "PRAGMA journal_mode=DELETE;",
+    "PRAGMA synchronous=FULL;",
+    "PRAGMA cache_size=2000;",
+    "PRAGMA temp_store=DEFAULT;"
+  };
+
+  const char** pragmas = enabled ? importPragmas : defaultPragmas;
+  int count = sizeof( importPragmas ) / sizeof( const char* );
+
+  for ( int i = 0; i < count; i++ )
+  {
+    if ( sqlite3_exec( mDatabase, pragmas[i], 0, 0, 0 ) != SQLITE_OK )
+    {
+      QgsDebugMsg( QString( "Setting \"%1\" failed." ).arg( pragmas[i] ) );
+    }
+  }
+}
+
+
 bool QgsOSMDataProvider::createDatabaseSchema()
 {
   QgsDebugMsg( "Creating database schema for OSM..." );
@@ -1460,6 +1516,25 @@ bool QgsOSMDataProvider::createDatabaseSchema()
       return false;
     }
   }
+
+  // spatial indexes of node positions and way bounding boxes;
+  // sqlite3 may be built without R*Tree module -> not critical, selections will be slower
+  const char* createRTrees[] =
+  {
+    "CREATE VIRTUAL TABLE node_rtree USING rtree( id, min_lat, max_lat, min_lon, max_lon );",
+    "CREATE VIRTUAL TABLE way_rtree USING rtree( id, min_lat, max_lat, min_lon, max_lon );"
+  };
+
+  count = sizeof( createRTrees ) / sizeof( const char* );
+
+  for ( int i = 0; i < count; i++ )
+  {
+    if ( sqlite3_exec( mDatabase, createRTrees[i], 0, 0, &mError ) != SQLITE_OK )
+    {
+      QgsDebugMsg( QString( "Creating R*Tree \"%1\" failed." ).arg( QString::fromUtf8( createRTrees[i] ) ) );
+    }
+  }
+
   // database schema created successfully
   QgsDebugMsg( "Database schema for OSM was created successfully." );
   return true;
@@ -1599,10 +1674,84 @@ bool QgsOSMDataProvider::createTriggers()
     }
     if ( mInitObserver ) mInitObserver->setProperty( "osm_value", QVariant( i + 1 ) );
   }
+
+  if ( !hasSpatialIndexes() )
+    return true;
+
+  // keeping R*Tree indexes up to date with node positions and way bounding boxes
+  const char* rtreeTriggers[] =
+  {
+    "create trigger if not exists main.trg_node_rtree_insert after insert on node when new.usage=0 begin                                                       insert or replace into node_rtree values (new.i,new.lat,new.lat,new.lon,new.lon); end;",
+
+    "create trigger if not exists main.trg_node_rtree_update after update of lat,lon,usage on node begin                                                       delete from node_rtree where id=old.i;                                                                                                     insert into node_rtree select new.i,new.lat,new.lat,new.lon,new.lon where new.usage=0; end;",
+
+    "create trigger if not exists main.trg_way_rtree_insert after insert on way when new.min_lat is not null begin                                          insert or replace into way_rtree values (new.i,new.min_lat,new.max_lat,new.min_lon,new.max_lon); end;",
+
+    "create trigger if not exists main.trg_way_rtree_update after update of min_lat,min_lon,max_lat,max_lon on way when new.min_lat is not null begin      insert or replace into way_rtree values (new.i,new.min_lat,new.max_lat,new.min_lon,new.max_lon); end;"
+  };
+
+  count = sizeof( rtreeTriggers ) / sizeof( const char* );
+
+  for ( int i = 0; i < count; i++ )
+  {
+    if ( sqlite3_exec( mDatabase, rtreeTriggers[i], 0, 0, &mError ) != SQLITE_OK )
+    {
+      QgsDebugMsg( QString( "Creating trigger \"%1\" failed." ).arg( QString::fromUtf8( rtreeTriggers[i] ) ) );
+      return false;
+    }
+  }
   return true;
 }
 
 
+bool QgsOSMDataProvider::createSpatialIndexes()
+{
+  if ( !hasSpatialIndexes() )
+    return false;
+
+  // only standalone nodes are selected as points, ways need their bounding box computed
+  const char* fills[] =
+  {
+    "DELETE FROM node_rtree;",
+    "DELETE FROM way_rtree;",
+    "INSERT INTO node_rtree ( id, min_lat, max_lat, min_lon, max_lon ) SELECT i, lat, lat, lon, lon FROM node WHERE usage=0 AND u=1;",
+    "INSERT INTO way_rtree ( id, min_lat, max_lat, min_lon, max_lon ) SELECT i, min_lat, max_lat, min_lon, max_lon FROM way WHERE min_lat IS NOT NULL AND u=1;"
+  };
+
+  int count = sizeof( fills ) / sizeof( const char* );
+
+  sqlite3_exec( mDatabase, "BEGIN;", 0, 0, 0 );
+  for ( int i = 0; i < count; i++ )
+  {
+    if ( sqlite3_exec( mDatabase, fills[i], 0, 0, &mError ) != SQLITE_OK )
+    {
+      QgsDebugMsg( QString( "Filling R*Tree \"%1\" failed." ).arg( QString::fromUtf8( fills[i] ) ) );
+      sqlite3_exec( mDatabase, "ROLLBACK;", 0, 0, 0 );
+      return false;
+    }
+  }
+  sqlite3_exec( mDatabase, "COMMIT;", 0, 0, 0 );
+  return true;
+}
+
+
+bool QgsOSMDataProvider::hasSpatialIndexes()
+{
+  char sqlSelectRTrees[] = "SELECT count(*) FROM sqlite_master WHERE type='table' AND name IN ('node_rtree','way_rtree');";
+  sqlite3_stmt *stmtSelectRTrees;
+
+  bool found = false;
+  if ( sqlite3_prepare_v2( mDatabase, sqlSelectRTrees, sizeof( sqlSelectRTrees ), &stmtSelectRTrees, 0 ) == SQLITE_OK )
+  {
+    if ( sqlite3_step( stmtSelectRTrees ) == SQLITE_ROW )
+      found = sqlite3_column_int( stmtSelectRTrees, 0 ) == 2;
+  }
+  // destroy database statement
+  sqlite3_finalize( stmtSelectRTrees );
+  return found;
+}
+
+
 bool QgsOSMDataProvider::dropDatabaseSchema()
 {
   QgsDebugMsg( "Dropping database schema for OSM..." );
@@ -1633,7 +1782,11 @@ bool QgsOSMDataProvider::dropDatabaseSchema()
     "DROP TABLE meta;",
 
     "DROP TABLE version;",
-    "DROP TABLE change_step;"
+    "DROP TABLE change_step;",
+
+    // dropping spatial indexes
+    "DROP TABLE node_rtree;",
+    "DROP TABLE way_rtree;"
   };
   int count = sizeof( drops ) / sizeof( const char* );
 
@@ -93,6 +93,15 @@ class QgsOSMDataProvider: public QgsVectorDataProvider
     //! sqlite3 database statement for exact node selection
     sqlite3_stmt *mNodeStmt;
 
+    //! sqlite3 database statement selecting coordinates of way members; prepared on first use by updateWayWKB()
+    sqlite3_stmt *mWayMembersStmt;
+
+    //! sqlite3 database statement storing way geometry; prepared on first use by updateWayWKB()
+    sqlite3_stmt *mUpdateWayStmt;
+
+    //! determines if database has R*Tree indexes of node positions and way bounding boxes (sqlite3 may be built without R*Tree module)
+    bool mUseRTree;
+
     // variables used to select OSM data; used mainly in select(), nextFeature() functions:
 
     //! list of supported attribute fields
@@ -264,6 +273,19 @@ class QgsOSMDataProvider: public QgsVectorDataProvider
      */
     bool createTriggers();
 
+    /**
+     * Fills R*Tree indexes with positions of standalone nodes and with bounding boxes of ways.
+     * Called from postparsing(), afterwards triggers keep indexes up to date.
+     * @return true in case of success and false in case of failure
+     */
+    bool createSpatialIndexes();
+
+    /**
+     * Finds out if database contains R*Tree indexes of nodes and ways.
+     * @return answer to that question
+     */
+    bool hasSpatialIndexes();
+
     /**
      * Drops the whole OSM database schema, using c++ library for attempt to sqlite database.
      * @return true in case of success and false in case of failure
@@ -283,13 +305,20 @@ class QgsOSMDataProvider: public QgsVectorDataProvider
 
     /**
      * Processes Open Street Map file, parse it and store data in sqlite database.
-     * Function doesn't require much memory: uses simple SAX XML parser
+     * Function doesn't require much memory: uses streaming XML reader on chunks of the file
      * and stores data directly to database while processing OSM file.
      * @param osm_filename name of file with OSM data to parse into sqlite3 database
      * @return true in case of success and false in case of failure
      */
     bool loadOsmFile( QString osm_filename );
 
+    /**
+     * Switches sqlite3 settings for the import of OSM file: no journal, no syncing to disk
+     * and big page cache. Without import mode the defaults of sqlite3 are set back.
+     * @param enabled true before the import starts, false when it's done
+     */
+    void setImportMode( bool enabled );
+
     /**
      * Function computes WKB (well-known-binary) information on geometry of specified way
      * and store it into database. Later this enables faster displaying of features.
@@ -297,8 +326,10 @@ class QgsOSMDataProvider: public QgsVectorDataProvider
      * @param isClosed is this way closed? closed=polygon X notClosed=line
      * @param geo output; way geometry in wkb format
      * @param geolen output; len of wkb geometry
+     * @param hasAllMembers output; if given, it tells if all the member nodes are in database;
+     *        the way is not updated if some are missing
      */
-    bool updateWayWKB( int wayId, int isClosed, char **geo, int *geolen );
+    bool updateWayWKB( int wayId, int isClosed, char **geo, int *geolen, bool *hasAllMembers = 0 );
 
     /**
      * Function performs all necessary postparsing manipulations with node records.
@@ -306,10 +337,11 @@ class QgsOSMDataProvider: public QgsVectorDataProvider
     bool updateNodes();
 
     /**
-     * Function removes all ways that are not correct. This is called after parsing input file is completed.
-     * The main purpose is removing ways that contain nodes that are not included in loaded data.
+     * Function removes ways that are not correct. This is called from postparsing() for ways
+     * that contain nodes that are not included in loaded data.
+     * @param wayIds identifiers of ways to remove together with their members and tags
      */
-    bool removeIncorrectWays();
+    bool removeIncorrectWays( const QList<int>& wayIds );
 
     /**
      * This function performs postprocessing after OSM file parsing.
@@ -25,6 +25,8 @@
 
 #include <QSettings>
 
+#include <cstring>
+
 // for htonl
 #ifdef Q_OS_WIN
 #include <winsock.h>
@@ -249,6 +251,10 @@ QgsPostgresConn::QgsPostgresConn( QString conninfo, bool readOnly )
 QgsPostgresConn::~QgsPostgresConn()
 {
   Q_ASSERT( mRef == 0 );
+  foreach( PGresult *res, mFetchResults )
+  {
+    ::PQclear( res );
+  }
   if ( mConn )
     ::PQfinish( mConn );
   mConn = 0;
@@ -716,13 +722,15 @@ PGresult *QgsPostgresConn::PQexec( QString query, bool logError )
     return 0;
   }
 
+  collectPendingFetch();
+
   QgsDebugMsgLevel( QString( "Executing SQL: %1" ).arg( query ), 3 );
   PGresult *res = ::PQexec( mConn, query.toUtf8() );
 
   if ( res )
   {
     int errorStatus = PQresultStatus( res );
-    if ( errorStatus != PGRES_COMMAND_OK && errorStatus != PGRES_TUPLES_OK )
+    if ( errorStatus != PGRES_COMMAND_OK && errorStatus != PGRES_TUPLES_OK && errorStatus != PGRES_COPY_IN )
     {
       if ( logError )
       {
@@ -762,6 +770,11 @@ bool QgsPostgresConn::openCursor( QString cursorName, QString sql )
 
 bool QgsPostgresConn::closeCursor( QString cursorName )
 {
+  // drop a batch that was fetched ahead
+  collectPendingFetch();
+  if ( mFetchResults.contains( cursorName ) )
+    ::PQclear( mFetchResults.take( cursorName ) );
+
   if ( !PQexecNR( QString( "CLOSE %1" ).arg( cursorName ) ) )
     return false;
 
@@ -837,11 +850,14 @@ PGresult *QgsPostgresConn::PQgetResult()
 
 PGresult *QgsPostgresConn::PQprepare( QString stmtName, QString query, int nParams, const Oid *paramTypes )
 {
+  collectPendingFetch();
   return ::PQprepare( mConn, stmtName.toUtf8(), query.toUtf8(), nParams, paramTypes );
 }
 
 PGresult *QgsPostgresConn::PQexecPrepared( QString stmtName, const QStringList &params )
 {
+  collectPendingFetch();
+
   const char **param = new const char *[ params.size()];
   QList<QByteArray> qparam;
 
@@ -862,6 +878,18 @@ PGresult *QgsPostgresConn::PQexecPrepared( QString stmtName, const QStringList &
   return res;
 }
 
+int QgsPostgresConn::PQputCopyData( const QByteArray &data )
+{
+  Q_ASSERT( mConn );
+  return ::PQputCopyData( mConn, data.constData(), data.size() );
+}
+
+int QgsPostgresConn::PQputCopyEnd( const char *errormsg )
+{
+  Q_ASSERT( mConn );
+  return ::PQputCopyEnd( mConn, errormsg );
+}
+
 void QgsPostgresConn::PQfinish()
 {
   Q_ASSERT( mConn );
@@ -884,9 +912,65 @@ QString QgsPostgresConn::PQerrorMessage()
 int QgsPostgresConn::PQsendQuery( QString query )
 {
   Q_ASSERT( mConn );
+  collectPendingFetch();
   return ::PQsendQuery( mConn, query.toUtf8() );
 }
 
+bool QgsPostgresConn::sendFetch( QString cursorName, int count )
+{
+  if ( PQsendQuery( QString( "FETCH FORWARD %1 FROM %2" ).arg( count ).arg( cursorName ) ) == 0 )
+  {
+    QgsMessageLog::logMessage( tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( cursorName ).arg( PQerrorMessage() ), tr( "PostGIS" ) );
+    return false;
+  }
+
+  mPendingFetchCursor = cursorName;
+  return true;
+}
+
+PGresult *QgsPostgresConn::fetchResult( QString cursorName )
+{
+  if ( mPendingFetchCursor == cursorName )
+    collectPendingFetch();
+
+  return mFetchResults.take( cursorName );
+}
+
+void QgsPostgresConn::consumeInput()
+{
+  if ( !mPendingFetchCursor.isNull() )
+    ::PQconsumeInput( mConn );
+}
+
+void QgsPostgresConn::collectPendingFetch()
+{
+  if ( mPendingFetchCursor.isNull() )
+    return;
+
+  // a FETCH has a single result; keep the first one and read up to the end
+  PGresult *res = 0;
+  for ( ;; )
+  {
+    PGresult *next = ::PQgetResult( mConn );
+    if ( !next )
+      break;
+
+    if ( res )
+      ::PQclear( next );
+    else
+      res = next;
+  }
+
+  if ( res )
+  {
+    if ( mFetchResults.contains( mPendingFetchCursor ) )
+      ::PQclear( mFetchResults.take( mPendingFetchCursor ) );
+    mFetchResults.insert( mPendingFetchCursor, res );
+  }
+
+  mPendingFetchCursor = QString::null;
+}
+
 qint64 QgsPostgresConn::getBinaryInt( QgsPostgresResult &queryResult, int row, int col )
 {
   qint64 oid;
@@ -943,7 +1027,7 @@ qint64 QgsPostgresConn::getBinaryInt( QgsPostgresResult &queryResult, int row, i
       QgsDebugMsgLevel( QString( "oid:%1" ).arg( oid ), 4 );
       oid <<= 32;
       QgsDebugMsgLevel( QString( "oid:%1" ).arg( oid ), 4 );
-      oid  |= oid1;
+      oid  |= ( quint32 ) oid1;
       QgsDebugMsgLevel( QString( "oid:%1" ).arg( oid ), 4 );
     }
     break;
@@ -992,6 +1076,109 @@ QString QgsPostgresConn::fieldExpression( const QgsField &fld )
   }
 }
 
+double QgsPostgresConn::getBinaryDouble( QgsPostgresResult &queryResult, int row, int col )
+{
+  char *p = PQgetvalue( queryResult.result(), row, col );
+  size_t s = PQgetlength( queryResult.result(), row, col );
+
+  switch ( s )
+  {
+    case 4:
+    {
+      quint32 bits;
+      memcpy( &bits, p, sizeof( bits ) );
+      if ( mSwapEndian )
+        bits = ntohl( bits );
+
+      float value;
+      memcpy( &value, &bits, sizeof( value ) );
+      return value;
+    }
+
+    case 8:
+    {
+      quint64 bits;
+      if ( mSwapEndian )
+      {
+        quint32 bits0, bits1;
+        memcpy( &bits0, p, sizeof( bits0 ) );
+        memcpy( &bits1, p + sizeof( bits0 ), sizeof( bits1 ) );
+        bits = ( quint64 ) ntohl( bits0 ) << 32 | ntohl( bits1 );
+      }
+      else
+      {
+        memcpy( &bits, p, sizeof( bits ) );
+      }
+
+      double value;
+      memcpy( &value, &bits, sizeof( value ) );
+      return value;
+    }
+
+    default:
+      QgsDebugMsg( QString( "unexpected size %1" ).arg( s ) );
+      return 0.0;
+  }
+}
+
+bool QgsPostgresConn::isBinaryField( const QgsField &fld )
+{
+  const QString &type = fld.typeName();
+  return type == "int2" || type == "int4" || type == "int8" ||
+         type == "float4" || type == "float8";
+}
+
+QString QgsPostgresConn::cursorFieldExpression( const QgsField &fld )
+{
+  // integer and floating point values come in their binary form,
+  // everything else is converted to text on the server
+  if ( isBinaryField( fld ) )
+    return quotedIdentifier( fld.name() );
+  else
+    return fieldExpression( fld );
+}
+
+QVariant QgsPostgresConn::getBinaryValue( QgsPostgresResult &queryResult, int row, int col, const QgsField &fld )
+{
+  if ( !isBinaryField( fld ) || queryResult.PQgetisnull( row, col ) )
+  {
+    QVariant v( queryResult.PQgetvalue( row, col ) );
+    if ( !v.convert( fld.type() ) )
+      v = QVariant( QString::null );
+    return v;
+  }
+
+  if ( fld.typeName().startsWith( "float" ) )
+  {
+    QVariant v( getBinaryDouble( queryResult, row, col ) );
+    if ( fld.type() != QVariant::Double && !v.convert( fld.type() ) )
+      v = QVariant( QString::null );
+    return v;
+  }
+
+  // getBinaryInt() doesn't sign extend 2 and 4 byte values
+  qint64 value = getBinaryInt( queryResult, row, col );
+  if ( fld.typeName() == "int2" )
+    value = ( qint16 ) value;
+  else if ( fld.typeName() == "int4" )
+    value = ( qint32 ) value;
+
+  switch ( fld.type() )
+  {
+    case QVariant::Int:
+      return QVariant(( int ) value );
+    case QVariant::LongLong:
+      return QVariant(( qlonglong ) value );
+    default:
+    {
+      QVariant v(( qlonglong ) value );
+      if ( !v.convert( fld.type() ) )
+        v = QVariant( QString::null );
+      return v;
+    }
+  }
+}
+
 void QgsPostgresConn::deduceEndian()
 {
   // need to store the PostgreSQL endian format used in binary cursors
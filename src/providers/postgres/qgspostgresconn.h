@@ -132,6 +132,19 @@ class QgsPostgresConn : public QObject
     PGresult *PQgetResult();
     PGresult *PQprepare( QString stmtName, QString query, int nParams, const Oid *paramTypes );
     PGresult *PQexecPrepared( QString stmtName, const QStringList &params );
+    int PQputCopyData( const QByteArray &data );
+    int PQputCopyEnd( const char *errormsg = 0 );
+
+    /** Send a FETCH on a cursor without waiting for the result, so that the
+     * server can work on the next batch while the current one is processed.
+     * The result is picked up with fetchResult(); other queries on the
+     * connection first collect the result and keep it for fetchResult().
+     */
+    bool sendFetch( QString cursorName, int count );
+    //! result of a FETCH sent with sendFetch() or 0 if there is none
+    PGresult *fetchResult( QString cursorName );
+    //! read what already arrived of a pending fetch, without blocking
+    void consumeInput();
 
     /** Double quote a PostgreSQL identifier for placement in a SQL string.
      */
@@ -156,9 +169,17 @@ class QgsPostgresConn : public QObject
     QStringList pkCandidates( QString schemaName, QString viewName );
 
     qint64 getBinaryInt( QgsPostgresResult &queryResult, int row, int col );
+    double getBinaryDouble( QgsPostgresResult &queryResult, int row, int col );
 
     QString fieldExpression( const QgsField &fld );
 
+    //! true if binary cursors return the field in a binary form that getBinaryValue() decodes
+    static bool isBinaryField( const QgsField &fld );
+    //! expression to fetch a field with a binary cursor
+    QString cursorFieldExpression( const QgsField &fld );
+    //! decode a field of a binary cursor selected with cursorFieldExpression()
+    QVariant getBinaryValue( QgsPostgresResult &queryResult, int row, int col, const QgsField &fld );
+
     QString connInfo() const { return mConnInfo; }
 
     static const int sGeomTypeSelectLimit;
@@ -245,6 +266,13 @@ class QgsPostgresConn : public QObject
      */
     bool mSwapEndian;
     void deduceEndian();
+
+    //! cursor of the FETCH sent with sendFetch() that was not read yet
+    QString mPendingFetchCursor;
+    //! results of sent fetches that were collected before other queries
+    QMap<QString, PGresult *> mFetchResults;
+    //! wait for the pending fetch and keep its result for fetchResult()
+    void collectPendingFetch();
 };
 
 #endif
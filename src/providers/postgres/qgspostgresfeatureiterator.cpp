@@ -0,0 +1,202 @@
+/***************************************************************************
+    qgspostgresfeatureiterator.cpp
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgspostgresfeatureiterator.h"
+#include "qgspostgresprovider.h"
+
+#include "qgsgeometry.h"
+#include "qgslogger.h"
+#include "qgsmessagelog.h"
+
+#include <QTime>
+
+// size of the first fetch of a cursor, later fetches grow while they keep the iterator waiting
+static const int sInitialFetchSize = 100;
+
+int QgsPostgresFeatureIterator::sIteratorId = 0;
+
+QgsPostgresFeatureIterator::QgsPostgresFeatureIterator( QgsPostgresProvider* p, const QgsFeatureRequest& request )
+    : QgsAbstractFeatureIterator( request )
+    , P( p )
+    , mCursorOpen( false )
+    , mFetched( 0 )
+    , mFetchSize( 0 )
+    , mFetchPending( false )
+    , mFetchedAll( false )
+{
+  P->mActiveIterators << this;
+
+  mCursorName = QString( "qgisf%1_%2" ).arg( P->mProviderId ).arg( sIteratorId++ );
+  mWhereClause = P->filterWhereClause( mRequest.filterRect(), mRequest.flags() & QgsFeatureRequest::ExactIntersect );
+  mAttributesToFetch = mRequest.attributesToFetch( P->attributeIndexes() );
+
+  if ( !declareCursor() )
+  {
+    close();
+    return;
+  }
+}
+
+QgsPostgresFeatureIterator::~QgsPostgresFeatureIterator()
+{
+  close();
+}
+
+bool QgsPostgresFeatureIterator::declareCursor()
+{
+  mCursorOpen = P->declareCursor( mCursorName, mAttributesToFetch, mRequest.fetchGeometry(), mWhereClause );
+  mFetched = 0;
+  mFetchSize = qMin( sInitialFetchSize, P->mFeatureQueueSize );
+  mFetchPending = false;
+  mFetchedAll = false;
+  return mCursorOpen;
+}
+
+void QgsPostgresFeatureIterator::fetchFeatures()
+{
+  if ( mFetchedAll )
+    return;
+
+  // the batch was usually requested when the previous one arrived
+  if ( !mFetchPending )
+  {
+    QgsDebugMsgLevel( QString( "fetching %1 features." ).arg( mFetchSize ), 3 );
+    if ( !P->mConnectionRO->sendFetch( mCursorName, mFetchSize ) )
+      return;
+  }
+
+  QTime waitTime;
+  waitTime.start();
+
+  int requested = mFetchSize;
+  QgsPostgresResult queryResult = P->mConnectionRO->fetchResult( mCursorName );
+  mFetchPending = false;
+
+  if ( !queryResult.result() || queryResult.PQresultStatus() != PGRES_TUPLES_OK )
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName ).arg( P->mConnectionRO->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+    mFetchedAll = true;
+    return;
+  }
+
+  int rows = queryResult.PQntuples();
+  if ( rows < requested )
+  {
+    mFetchedAll = true;
+  }
+  else
+  {
+    // a full batch we had to wait for: fetch more rows per round trip
+    if ( waitTime.elapsed() > 0 && mFetchSize < P->mFeatureQueueSize )
+    {
+      mFetchSize = qMin( 2 * mFetchSize, P->mFeatureQueueSize );
+      QgsDebugMsgLevel( QString( "fetch size of %1 raised to %2" ).arg( mCursorName ).arg( mFetchSize ), 3 );
+    }
+
+    // let the server prepare the next batch while this one is processed
+    mFetchPending = P->mConnectionRO->sendFetch( mCursorName, mFetchSize );
+  }
+
+  for ( int row = 0; row < rows; row++ )
+  {
+    mFeatureQueue.enqueue( QgsFeature() );
+    P->getFeature( queryResult, row, mRequest.fetchGeometry(), mFeatureQueue.back(), mAttributesToFetch );
+  } // for each row in queue
+}
+
+bool QgsPostgresFeatureIterator::nextFeature( QgsFeature& feature )
+{
+  feature.setValid( false );
+
+  if ( mClosed )
+    return false;
+
+  if ( mFeatureQueue.empty() && mCursorOpen )
+  {
+    fetchFeatures();
+  }
+
+  if ( mFeatureQueue.empty() )
+  {
+    QgsDebugMsg( QString( "Finished after %1 features" ).arg( mFetched ) );
+    if ( mCursorOpen )
+    {
+      P->mConnectionRO->closeCursor( mCursorName );
+      mCursorOpen = false;
+    }
+    if ( P->mFeaturesCounted < mFetched )
+    {
+      QgsDebugMsg( QString( "feature count adjusted from %1 to %2" ).arg( P->mFeaturesCounted ).arg( mFetched ) );
+      P->mFeaturesCounted = mFetched;
+    }
+    return false;
+  }
+
+  // Now return the next feature from the queue
+  if ( mRequest.fetchGeometry() )
+  {
+    QgsGeometry* featureGeom = mFeatureQueue.front().geometryAndOwnership();
+    feature.setGeometry( featureGeom );
+  }
+  else
+  {
+    feature.setGeometryAndOwnership( 0, 0 );
+  }
+  feature.setFeatureId( mFeatureQueue.front().id() );
+  feature.copyAttributes( mFeatureQueue.front() );
+
+  mFeatureQueue.dequeue();
+  mFetched++;
+
+  // pull in what already arrived of the next batch
+  if ( mFetchPending && mFetched % 64 == 0 )
+    P->mConnectionRO->consumeInput();
+
+  feature.setValid( true );
+  return true;
+}
+
+bool QgsPostgresFeatureIterator::rewind()
+{
+  if ( mClosed )
+    return false;
+
+  // move cursor to first record: a forward-only cursor has to be declared again
+  if ( mCursorOpen )
+  {
+    P->mConnectionRO->closeCursor( mCursorName );
+    mCursorOpen = false;
+  }
+  mFeatureQueue.clear();
+
+  return declareCursor();
+}
+
+bool QgsPostgresFeatureIterator::close()
+{
+  if ( mClosed )
+    return false;
+
+  if ( mCursorOpen )
+  {
+    P->mConnectionRO->closeCursor( mCursorName );
+    mCursorOpen = false;
+  }
+
+  mFeatureQueue.clear();
+
+  P->mActiveIterators.remove( this );
+
+  mClosed = true;
+  return true;
+}
@@ -0,0 +1,83 @@
+/***************************************************************************
+    qgspostgresfeatureiterator.h
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSPOSTGRESFEATUREITERATOR_H
+#define QGSPOSTGRESFEATUREITERATOR_H
+
+#include "qgsfeatureiterator.h"
+
+#include <QQueue>
+
+class QgsPostgresProvider;
+
+/**
+  Iterator over the features of a PostgreSQL layer. Every iterator declares
+  its own cursor on the provider's read-only connection.
+  */
+class QgsPostgresFeatureIterator : public QgsAbstractFeatureIterator
+{
+  public:
+    QgsPostgresFeatureIterator( QgsPostgresProvider* p, const QgsFeatureRequest& request );
+
+    ~QgsPostgresFeatureIterator();
+
+    //! fetch next feature, return true on success
+    virtual bool nextFeature( QgsFeature& feature );
+
+    //! reset the iterator to the starting position
+    virtual bool rewind();
+
+    //! end of iterating: free the resources / lock
+    virtual bool close();
+
+  protected:
+    //! declare the cursor for the request
+    bool declareCursor();
+
+    //! fetch the next batch of features from the cursor into the queue
+    //! and send the fetch of the batch after it
+    void fetchFeatures();
+
+    QgsPostgresProvider* P;
+
+    QString mCursorName;
+
+    //! where clause for the request, including the provider's subset
+    QString mWhereClause;
+
+    QgsAttributeList mAttributesToFetch;
+
+    //! true if the cursor was declared and not closed yet
+    bool mCursorOpen;
+
+    //! Feature queue that nextFeature() will retrieve from
+    //! before the next fetch from PostgreSQL
+    QQueue<QgsFeature> mFeatureQueue;
+
+    //! number of retrieved features
+    int mFetched;
+
+    //! number of features of the next fetch, doubled up to the provider's
+    //! queue size while nextFeature() has to wait for the batches
+    int mFetchSize;
+
+    //! true if the fetch of the next batch was sent and not read yet
+    bool mFetchPending;
+
+    //! true if the cursor returned its last batch
+    bool mFetchedAll;
+
+    static int sIteratorId;
+};
+
+#endif // QGSPOSTGRESFEATUREITERATOR_H
@@ -29,6 +29,7 @@
 #include "qgsproviderextentcalcevent.h"
 #include "qgspostgresprovider.h"
 #include "qgspostgresconn.h"
+#include "qgspostgresfeatureiterator.h"
 #include "qgspgsourceselect.h"
 #include "qgspostgresdataitems.h"
 #include "qgslogger.h"
@@ -38,10 +39,10 @@ const QString POSTGRES_DESCRIPTION = "PostgreSQL/PostGIS data provider";
 
 int QgsPostgresProvider::sProviderIds = 0;
 const int QgsPostgresProvider::sFeatureQueueSize = 2000;
+const int QgsPostgresProvider::sCopyThreshold = 10;
 
 QgsPostgresProvider::QgsPostgresProvider( QString const & uri )
     : QgsVectorDataProvider( uri )
-    , mFetching( false )
     , mValid( false )
     , mPrimaryKeyType( pktUnknown )
     , mDetectedGeomType( QGis::UnknownGeometry )
@@ -212,10 +213,11 @@ QgsPostgresProvider::~QgsPostgresProvider()
 
 void QgsPostgresProvider::disconnectDb()
 {
-  if ( mFetching )
+  while ( !mActiveIterators.empty() )
   {
-    mConnectionRO->closeCursor( QString( "qgisf%1" ).arg( mProviderId ) );
-    mFetching = false;
+    QgsPostgresFeatureIterator *it = *mActiveIterators.begin();
+    QgsDebugMsg( "closing active iterator" );
+    it->close();
   }
 
   if ( mConnectionRO )
@@ -279,7 +281,7 @@ bool QgsPostgresProvider::declareCursor(
       case pktFidMap:
         foreach( int idx, mPrimaryKeyAttrs )
         {
-          query += delim + mConnectionRO->fieldExpression( field( idx ) );
+          query += delim + mConnectionRO->cursorFieldExpression( field( idx ) );
           delim = ",";
         }
         break;
@@ -295,7 +297,7 @@ bool QgsPostgresProvider::declareCursor(
       if ( mPrimaryKeyAttrs.contains( idx ) )
         continue;
 
-      query += delim + mConnectionRO->fieldExpression( field( idx ) );
+      query += delim + mConnectionRO->cursorFieldExpression( field( idx ) );
     }
 
     query += " FROM " + mQuery;
@@ -306,13 +308,13 @@ bool QgsPostgresProvider::declareCursor(
     if ( !mConnectionRO->openCursor( cursorName, query ) )
     {
       // reloading the fields might help next time around
-      rewind();
+      loadFields();
       return false;
     }
   }
   catch ( PGFieldNotFound )
   {
-    rewind();
+    loadFields();
     return false;
   }
 
@@ -417,7 +419,8 @@ bool QgsPostgresProvider::getFeature( QgsPostgresResult &queryResult, int row, b
 {
   try
   {
-    feature.clearAttributeMap();
+    // set the attributes in place
+    feature.initAttributes( mAttributeFields.size() );
 
     int col = 0;
 
@@ -460,7 +463,7 @@ bool QgsPostgresProvider::getFeature( QgsPostgresResult &queryResult, int row, b
         {
           const QgsField &fld = field( idx );
 
-          QVariant v = convertValue( fld.type(), queryResult.PQgetvalue( row, col ) );
+          QVariant v = mConnectionRO->getBinaryValue( queryResult, row, col, fld );
           primaryKeyVals << v;
 
           if ( fetchAttributes.contains( idx ) )
@@ -489,7 +492,7 @@ bool QgsPostgresProvider::getFeature( QgsPostgresResult &queryResult, int row, b
 
       const QgsField &fld = field( idx );
 
-      QVariant v = convertValue( fld.type(), queryResult.PQgetvalue( row, col ) );
+      QVariant v = mConnectionRO->getBinaryValue( queryResult, row, col, fld );
       feature.addAttribute( idx, v );
 
       col++;
@@ -503,21 +506,8 @@ bool QgsPostgresProvider::getFeature( QgsPostgresResult &queryResult, int row, b
   }
 }
 
-void QgsPostgresProvider::select( QgsAttributeList fetchAttributes, QgsRectangle rect, bool fetchGeometry, bool useIntersect )
+QString QgsPostgresProvider::filterWhereClause( QgsRectangle rect, bool useIntersect ) const
 {
-  QString cursorName = QString( "qgisf%1" ).arg( mProviderId );
-
-  if ( mFetching )
-  {
-    mConnectionRO->closeCursor( cursorName );
-    mFetching = false;
-
-    while ( !mFeatureQueue.empty() )
-    {
-      mFeatureQueue.dequeue();
-    }
-  }
-
   QString whereClause;
 
   if ( !rect.isEmpty() && !mGeometryColumn.isNull() )
@@ -582,97 +572,41 @@ void QgsPostgresProvider::select( QgsAttributeList fetchAttributes, QgsRectangle
     whereClause += "(" + mSqlWhereClause + ")";
   }
 
-  mFetchGeom = fetchGeometry;
-  mAttributesToFetch = fetchAttributes;
-  if ( !declareCursor( cursorName, fetchAttributes, fetchGeometry, whereClause ) )
-    return;
-
-  mFetching = true;
-  mFetched = 0;
+  return whereClause;
 }
 
-bool QgsPostgresProvider::nextFeature( QgsFeature& feature )
+QgsFeatureIterator QgsPostgresProvider::getFeatures( const QgsFeatureRequest& request )
 {
-  feature.setValid( false );
   if ( !mValid )
   {
     QgsMessageLog::logMessage( tr( "Read attempt on an invalid postgresql data source" ), tr( "PostGIS" ) );
-    return false;
-  }
-
-  if ( !mFetching )
-  {
-    QgsMessageLog::logMessage( tr( "nextFeature() without select()" ), tr( "PostGIS" ) );
-    return false;
+    return QgsFeatureIterator();
   }
 
-  QString cursorName = QString( "qgisf%1" ).arg( mProviderId );
-
-  if ( mFeatureQueue.empty() )
-  {
-    QString fetch = QString( "FETCH FORWARD %1 FROM %2" ).arg( mFeatureQueueSize ).arg( cursorName );
-    QgsDebugMsgLevel( QString( "fetching %1 features." ).arg( mFeatureQueueSize ), 3 );
-    if ( mConnectionRO->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
-    {
-      QgsMessageLog::logMessage( tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( cursorName ).arg( mConnectionRO->PQerrorMessage() ), tr( "PostGIS" ) );
-    }
-
-    QgsPostgresResult queryResult;
-    for ( ;; )
-    {
-      queryResult = mConnectionRO->PQgetResult();
-      if ( !queryResult.result() )
-        break;
-
-      if ( queryResult.PQresultStatus() != PGRES_TUPLES_OK )
-      {
-        QgsMessageLog::logMessage( tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( cursorName ).arg( mConnectionRO->PQerrorMessage() ), tr( "PostGIS" ) );
-        break;
-      }
-
-      int rows = queryResult.PQntuples();
-      if ( rows == 0 )
-        continue;
+  return QgsFeatureIterator( new QgsPostgresFeatureIterator( this, request ) );
+}
 
-      for ( int row = 0; row < rows; row++ )
-      {
-        mFeatureQueue.enqueue( QgsFeature() );
-        getFeature( queryResult, row, mFetchGeom, mFeatureQueue.back(), mAttributesToFetch );
-      } // for each row in queue
-    }
-  }
+void QgsPostgresProvider::select( QgsAttributeList fetchAttributes, QgsRectangle rect, bool fetchGeometry, bool useIntersect )
+{
+  mSelectIterator = getFeatures( selectRequest( fetchAttributes, rect, fetchGeometry, useIntersect ) );
+}
 
-  if ( mFeatureQueue.empty() )
+bool QgsPostgresProvider::nextFeature( QgsFeature& feature )
+{
+  feature.setValid( false );
+  if ( !mValid )
   {
-    QgsDebugMsg( QString( "Finished after %1 features" ).arg( mFetched ) );
-    mConnectionRO->closeCursor( cursorName );
-    mFetching = false;
-    if ( mFeaturesCounted < mFetched )
-    {
-      QgsDebugMsg( QString( "feature count adjusted from %1 to %2" ).arg( mFeaturesCounted ).arg( mFetched ) );
-      mFeaturesCounted = mFetched;
-    }
+    QgsMessageLog::logMessage( tr( "Read attempt on an invalid postgresql data source" ), tr( "PostGIS" ) );
     return false;
   }
 
-  // Now return the next feature from the queue
-  if ( mFetchGeom )
-  {
-    QgsGeometry* featureGeom = mFeatureQueue.front().geometryAndOwnership();
-    feature.setGeometry( featureGeom );
-  }
-  else
+  if ( mSelectIterator.isClosed() )
   {
-    feature.setGeometryAndOwnership( 0, 0 );
+    QgsMessageLog::logMessage( tr( "nextFeature() without select()" ), tr( "PostGIS" ) );
+    return false;
   }
-  feature.setFeatureId( mFeatureQueue.front().id() );
-  feature.setAttributeMap( mFeatureQueue.front().attributeMap() );
 
-  mFeatureQueue.dequeue();
-  mFetched++;
-
-  feature.setValid( true );
-  return true;
+  return mSelectIterator.nextFeature( feature );
 }
 
 QString QgsPostgresProvider::pkParamWhereClause( int offset ) const
@@ -944,12 +878,7 @@ QString QgsPostgresProvider::dataComment() const
 
 void QgsPostgresProvider::rewind()
 {
-  if ( mFetching )
-  {
-    //move cursor to first record
-    mConnectionRO->PQexecNR( QString( "move 0 in qgisf%1" ).arg( mProviderId ) );
-  }
-  mFeatureQueue.empty();
+  mSelectIterator.rewind();
   loadFields();
 }
 
@@ -1815,185 +1744,193 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
   {
     mConnectionRW->PQexecNR( "BEGIN" );
 
-    // Prepare the INSERT statement
-    QString insert = QString( "INSERT INTO %1(" ).arg( mQuery );
-    QString values = ") VALUES (";
-    QString delim = "";
-    int offset = 1;
-
-    QStringList defaultValues;
-    QList<int> fieldId;
+    // larger lists are streamed through COPY, if the table takes it
+    bool copied = false;
+    if ( flist.size() >= sCopyThreshold && mPrimaryKeyType != pktOid )
+      copied = copyFeatures( flist );
 
-    if ( !mGeometryColumn.isNull() )
+    if ( !copied )
     {
-      insert += quotedIdentifier( mGeometryColumn );
-      values += QString( "%1($%2%3,%4)" )
-                .arg( mConnectionRO->majorVersion() < 2 ? "geomfromwkb" : "st_geomfromwkb" )
-                .arg( offset++ )
-                .arg( mConnectionRW->useWkbHex() ? "" : "::bytea" )
-                .arg( mRequestedSrid.isEmpty() ? mDetectedSrid : mRequestedSrid );
-      delim = ",";
-    }
+      // Prepare the INSERT statement
+      QString insert = QString( "INSERT INTO %1(" ).arg( mQuery );
+      QString values = ") VALUES (";
+      QString delim = "";
+      int offset = 1;
 
-    if ( mPrimaryKeyType == pktInt || mPrimaryKeyType == pktFidMap )
-    {
-      foreach( int idx, mPrimaryKeyAttrs )
+      QStringList defaultValues;
+      QList<int> fieldId;
+
+      if ( !mGeometryColumn.isNull() )
       {
-        insert += delim + quotedIdentifier( field( idx ).name() );
-        values += delim + QString( "$%1" ).arg( defaultValues.size() + offset );
+        insert += quotedIdentifier( mGeometryColumn );
+        values += QString( "%1($%2%3,%4)" )
+                  .arg( mConnectionRO->majorVersion() < 2 ? "geomfromwkb" : "st_geomfromwkb" )
+                  .arg( offset++ )
+                  .arg( mConnectionRW->useWkbHex() ? "" : "::bytea" )
+                  .arg( mRequestedSrid.isEmpty() ? mDetectedSrid : mRequestedSrid );
         delim = ",";
-        fieldId << idx;
-        defaultValues << defaultValue( idx ).toString();
       }
-    }
 
-    const QgsAttributeMap &attributevec = flist[0].attributeMap();
+      if ( mPrimaryKeyType == pktInt || mPrimaryKeyType == pktFidMap )
+      {
+        foreach( int idx, mPrimaryKeyAttrs )
+        {
+          insert += delim + quotedIdentifier( field( idx ).name() );
+          values += delim + QString( "$%1" ).arg( defaultValues.size() + offset );
+          delim = ",";
+          fieldId << idx;
+          defaultValues << defaultValue( idx ).toString();
+        }
+      }
 
-    // look for unique attribute values to place in statement instead of passing as parameter
-    // e.g. for defaults
-    for ( QgsAttributeMap::const_iterator it = attributevec.begin(); it != attributevec.end(); it++ )
-    {
-      if ( fieldId.contains( it.key() ) )
-        continue;
+      const QgsAttributeMap &attributevec = flist[0].attributeMap();
 
-      QgsFieldMap::const_iterator fit = mAttributeFields.find( it.key() );
-      if ( fit == mAttributeFields.end() )
-        continue;
+      // look for unique attribute values to place in statement instead of passing as parameter
+      // e.g. for defaults
+      for ( QgsAttributeMap::const_iterator it = attributevec.begin(); it != attributevec.end(); it++ )
+      {
+        if ( fieldId.contains( it.key() ) )
+          continue;
 
-      QString fieldname = fit->name();
+        QgsFieldMap::const_iterator fit = mAttributeFields.find( it.key() );
+        if ( fit == mAttributeFields.end() )
+          continue;
 
-      QgsDebugMsg( "Checking field against: " + fieldname );
+        QString fieldname = fit->name();
 
-      if ( fieldname.isEmpty() || fieldname == mGeometryColumn )
-        continue;
+        QgsDebugMsg( "Checking field against: " + fieldname );
 
-      int i;
-      for ( i = 1; i < flist.size(); i++ )
-      {
-        const QgsAttributeMap &attributevec = flist[i].attributeMap();
+        if ( fieldname.isEmpty() || fieldname == mGeometryColumn )
+          continue;
 
-        QgsAttributeMap::const_iterator thisit = attributevec.find( it.key() );
-        if ( thisit == attributevec.end() )
-          break;
+        int i;
+        for ( i = 1; i < flist.size(); i++ )
+        {
+          const QgsAttributeMap &attributevec = flist[i].attributeMap();
 
-        if ( *thisit != *it )
-          break;
-      }
+          QgsAttributeMap::const_iterator thisit = attributevec.find( it.key() );
+          if ( thisit == attributevec.end() )
+            break;
 
-      insert += delim + quotedIdentifier( fieldname );
+          if ( *thisit != *it )
+            break;
+        }
 
-      QString defVal = defaultValue( it.key() ).toString();
+        insert += delim + quotedIdentifier( fieldname );
 
-      if ( i == flist.size() )
-      {
-        if ( *it == defVal )
+        QString defVal = defaultValue( it.key() ).toString();
+
+        if ( i == flist.size() )
         {
-          if ( defVal.isNull() )
+          if ( *it == defVal )
           {
-            values += delim + "NULL";
+            if ( defVal.isNull() )
+            {
+              values += delim + "NULL";
+            }
+            else
+            {
+              values += delim + defVal;
+            }
+          }
+          else if ( fit->typeName() == "geometry" )
+          {
+            values += QString( "%1%2(%3)" )
+                      .arg( delim )
+                      .arg( mConnectionRO->majorVersion() < 2 ? "geomfromewkt" : "st_geomfromewkt" )
+                      .arg( quotedValue( it->toString() ) );
+          }
+          else if ( fit->typeName() == "geography" )
+          {
+            values += QString( "%1st_geographyfromewkt(%2)" )
+                      .arg( delim )
+                      .arg( quotedValue( it->toString() ) );
           }
           else
           {
-            values += delim + defVal;
+            values += delim + quotedValue( it->toString() );
           }
         }
-        else if ( fit->typeName() == "geometry" )
-        {
-          values += QString( "%1%2(%3)" )
-                    .arg( delim )
-                    .arg( mConnectionRO->majorVersion() < 2 ? "geomfromewkt" : "st_geomfromewkt" )
-                    .arg( quotedValue( it->toString() ) );
-        }
-        else if ( fit->typeName() == "geography" )
-        {
-          values += QString( "%1st_geographyfromewkt(%2)" )
-                    .arg( delim )
-                    .arg( quotedValue( it->toString() ) );
-        }
         else
         {
-          values += delim + quotedValue( it->toString() );
-        }
-      }
-      else
-      {
-        // value is not unique => add parameter
-        if ( fit->typeName() == "geometry" )
-        {
-          values += QString( "%1%2($%3)" )
-                    .arg( delim )
-                    .arg( mConnectionRO->majorVersion() < 2 ? "geomfromewkt" : "st_geomfromewkt" )
-                    .arg( defaultValues.size() + offset );
-        }
-        else if ( fit->typeName() == "geography" )
-        {
-          values += QString( "%1st_geographyfromewkt($%2)" )
-                    .arg( delim )
-                    .arg( defaultValues.size() + offset );
-        }
-        else
-        {
-          values += QString( "%1$%2" )
-                    .arg( delim )
-                    .arg( defaultValues.size() + offset );
+          // value is not unique => add parameter
+          if ( fit->typeName() == "geometry" )
+          {
+            values += QString( "%1%2($%3)" )
+                      .arg( delim )
+                      .arg( mConnectionRO->majorVersion() < 2 ? "geomfromewkt" : "st_geomfromewkt" )
+                      .arg( defaultValues.size() + offset );
+          }
+          else if ( fit->typeName() == "geography" )
+          {
+            values += QString( "%1st_geographyfromewkt($%2)" )
+                      .arg( delim )
+                      .arg( defaultValues.size() + offset );
+          }
+          else
+          {
+            values += QString( "%1$%2" )
+                      .arg( delim )
+                      .arg( defaultValues.size() + offset );
+          }
+          defaultValues.append( defVal );
+          fieldId.append( it.key() );
         }
-        defaultValues.append( defVal );
-        fieldId.append( it.key() );
-      }
-
-      delim = ",";
-    }
-
-    insert += values + ")";
 
-    QgsDebugMsg( QString( "prepare addfeatures: %1" ).arg( insert ) );
-    QgsPostgresResult stmt = mConnectionRW->PQprepare( "addfeatures", insert, fieldId.size() + offset - 1, NULL );
-    if ( stmt.PQresultStatus() != PGRES_COMMAND_OK )
-      throw PGException( stmt );
+        delim = ",";
+      }
 
-    for ( QgsFeatureList::iterator features = flist.begin(); features != flist.end(); features++ )
-    {
-      const QgsAttributeMap &attributevec = features->attributeMap();
+      insert += values + ")";
 
-      QStringList params;
-      if ( !mGeometryColumn.isNull() )
-      {
-        appendGeomParam( features->geometry(), params );
-      }
+      QgsDebugMsg( QString( "prepare addfeatures: %1" ).arg( insert ) );
+      QgsPostgresResult stmt = mConnectionRW->PQprepare( "addfeatures", insert, fieldId.size() + offset - 1, NULL );
+      if ( stmt.PQresultStatus() != PGRES_COMMAND_OK )
+        throw PGException( stmt );
 
-      for ( int i = 0; i < fieldId.size(); i++ )
+      for ( QgsFeatureList::iterator features = flist.begin(); features != flist.end(); features++ )
       {
-        QgsAttributeMap::const_iterator attr = attributevec.find( fieldId[i] );
+        const QgsAttributeMap &attributevec = features->attributeMap();
 
-        QString v;
-        if ( attr == attributevec.end() )
+        QStringList params;
+        if ( !mGeometryColumn.isNull() )
         {
-          const QgsField &fld = field( fieldId[i] );
-          v = paramValue( defaultValues[i], defaultValues[i] );
-          features->addAttribute( fieldId[i], convertValue( fld.type(), v ) );
+          appendGeomParam( features->geometry(), params );
         }
-        else
+
+        for ( int i = 0; i < fieldId.size(); i++ )
         {
-          v = paramValue( attr.value().toString(), defaultValues[i] );
+          QgsAttributeMap::const_iterator attr = attributevec.find( fieldId[i] );
 
-          if ( v != attr.value().toString() )
+          QString v;
+          if ( attr == attributevec.end() )
           {
             const QgsField &fld = field( fieldId[i] );
-            features->changeAttribute( fieldId[i], convertValue( fld.type(), v ) );
+            v = paramValue( defaultValues[i], defaultValues[i] );
+            features->addAttribute( fieldId[i], convertValue( fld.type(), v ) );
           }
-        }
+          else
+          {
+            v = paramValue( attr.value().toString(), defaultValues[i] );
 
-        params << v;
-      }
+            if ( v != attr.value().toString() )
+            {
+              const QgsField &fld = field( fieldId[i] );
+              features->changeAttribute( fieldId[i], convertValue( fld.type(), v ) );
+            }
+          }
 
-      QgsPostgresResult result = mConnectionRW->PQexecPrepared( "addfeatures", params );
-      if ( result.PQresultStatus() != PGRES_COMMAND_OK )
-        throw PGException( result );
+          params << v;
+        }
 
-      if ( mPrimaryKeyType == pktOid )
-      {
-        features->setFeatureId( result.PQoidValue() );
-        QgsDebugMsgLevel( QString( "new fid=%1" ).arg( features->id() ), 4 );
+        QgsPostgresResult result = mConnectionRW->PQexecPrepared( "addfeatures", params );
+        if ( result.PQresultStatus() != PGRES_COMMAND_OK )
+          throw PGException( result );
+
+        if ( mPrimaryKeyType == pktOid )
+        {
+          features->setFeatureId( result.PQoidValue() );
+          QgsDebugMsgLevel( QString( "new fid=%1" ).arg( features->id() ), 4 );
+        }
       }
     }
 
@@ -2023,7 +1960,8 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
       }
     }
 
-    mConnectionRW->PQexecNR( "DEALLOCATE addfeatures" );
+    if ( !copied )
+      mConnectionRW->PQexecNR( "DEALLOCATE addfeatures" );
     mConnectionRW->PQexecNR( "COMMIT" );
 
     mFeaturesCounted += flist.size();
@@ -2040,6 +1978,241 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
   return returnvalue;
 }
 
+// escape a value for the text format of COPY
+static void appendCopyValue( QByteArray &buf, const QString &value )
+{
+  if ( value.isNull() )
+  {
+    buf += "\\N";
+    return;
+  }
+
+  QByteArray v = value.toUtf8();
+  for ( int i = 0; i < v.size(); i++ )
+  {
+    switch ( v[i] )
+    {
+      case '\\':
+        buf += "\\\\";
+        break;
+      case '\t':
+        buf += "\\t";
+        break;
+      case '\n':
+        buf += "\\n";
+        break;
+      case '\r':
+        buf += "\\r";
+        break;
+      default:
+        buf += v[i];
+        break;
+    }
+  }
+}
+
+static void appendHex( QByteArray &buf, const unsigned char *data, size_t size )
+{
+  static const char hex[] = "0123456789abcdef";
+
+  int pos = buf.size();
+  buf.resize( pos + 2 * size );
+  for ( size_t i = 0; i < size; i++ )
+  {
+    buf[pos++] = hex[ data[i] >> 4 ];
+    buf[pos++] = hex[ data[i] & 0xf ];
+  }
+}
+
+// hex encoded EWKB of a geometry, the form geometry_in and geography_in read
+static void appendEwkbHex( QByteArray &buf, QgsGeometry *geom, int srid )
+{
+  const unsigned char *wkb = geom->asWkb();
+  size_t size = geom->wkbSize();
+  if ( !wkb || size < 5 )
+  {
+    buf += "\\N";
+    return;
+  }
+
+  if ( srid <= 0 )
+  {
+    appendHex( buf, wkb, size );
+    return;
+  }
+
+  // set the SRID flag of the type and put the SRID after it, in the byte order of the WKB
+  bool ndr = wkb[0] == 1;
+  quint32 header[2];
+  header[0] = ndr
+              ? ( quint32 ) wkb[1] | wkb[2] << 8 | wkb[3] << 16 | ( quint32 ) wkb[4] << 24
+              : ( quint32 ) wkb[1] << 24 | wkb[2] << 16 | wkb[3] << 8 | ( quint32 ) wkb[4];
+  header[0] |= 0x20000000;
+  header[1] = srid;
+
+  unsigned char ewkbHeader[9];
+  ewkbHeader[0] = wkb[0];
+  for ( int j = 0; j < 2; j++ )
+  {
+    for ( int k = 0; k < 4; k++ )
+    {
+      ewkbHeader[ 1 + 4 * j + ( ndr ? k : 3 - k )] = ( header[j] >> ( 8 * k ) ) & 0xff;
+    }
+  }
+
+  appendHex( buf, ewkbHeader, sizeof( ewkbHeader ) );
+  appendHex( buf, wkb + 5, size - 5 );
+}
+
+bool QgsPostgresProvider::copyFeatures( QgsFeatureList &flist )
+{
+  // same columns as the INSERT: geometry, primary key and the attributes of the first feature
+  QStringList columns;
+  QList<int> fieldId;
+  QStringList defaultValues;
+
+  if ( !mGeometryColumn.isNull() )
+    columns << quotedIdentifier( mGeometryColumn );
+
+  if ( mPrimaryKeyType == pktInt || mPrimaryKeyType == pktFidMap )
+  {
+    foreach( int idx, mPrimaryKeyAttrs )
+    {
+      columns << quotedIdentifier( field( idx ).name() );
+      fieldId << idx;
+    }
+  }
+
+  const QgsAttributeMap &attributevec = flist[0].attributeMap();
+  for ( QgsAttributeMap::const_iterator it = attributevec.begin(); it != attributevec.end(); it++ )
+  {
+    if ( fieldId.contains( it.key() ) )
+      continue;
+
+    QgsFieldMap::const_iterator fit = mAttributeFields.find( it.key() );
+    if ( fit == mAttributeFields.end() )
+      continue;
+
+    if ( fit->name().isEmpty() || fit->name() == mGeometryColumn )
+      continue;
+
+    columns << quotedIdentifier( fit->name() );
+    fieldId << it.key();
+  }
+
+  foreach( int idx, fieldId )
+  {
+    defaultValues << defaultValue( idx ).toString();
+  }
+
+  // COPY doesn't evaluate expressions: evaluate the defaults the features ask for
+  // up front, with one query per column (e.g. a block of values of a sequence)
+  for ( int i = 0; i < fieldId.size(); i++ )
+  {
+    const QString &defVal = defaultValues[i];
+    const QgsField &fld = field( fieldId[i] );
+
+    QList<int> needDefault;
+    for ( int j = 0; j < flist.size(); j++ )
+    {
+      const QgsAttributeMap &attrs = flist[j].attributeMap();
+      QgsAttributeMap::const_iterator attr = attrs.find( fieldId[i] );
+      if ( attr == attrs.end() || ( !defVal.isNull() && attr->toString() == defVal ) )
+        needDefault << j;
+    }
+
+    if ( needDefault.isEmpty() )
+      continue;
+
+    if ( defVal.isNull() )
+    {
+      foreach( int j, needDefault )
+      {
+        flist[j].addAttribute( fieldId[i], convertValue( fld.type(), QString::null ) );
+      }
+      continue;
+    }
+
+    QgsPostgresResult result = mConnectionRW->PQexec( QString( "SELECT %1 FROM generate_series(1,%2)" ).arg( defVal ).arg( needDefault.size() ) );
+    if ( result.PQresultStatus() != PGRES_TUPLES_OK || result.PQntuples() != needDefault.size() )
+      throw PGException( result );
+
+    for ( int k = 0; k < needDefault.size(); k++ )
+    {
+      flist[ needDefault[k] ].addAttribute( fieldId[i], convertValue( fld.type(), result.PQgetvalue( k, 0 ) ) );
+    }
+  }
+
+  QString copy = QString( "COPY %1(%2) FROM STDIN" ).arg( mQuery ).arg( columns.join( "," ) );
+  QgsDebugMsg( QString( "copy addfeatures: %1" ).arg( copy ) );
+
+  QgsPostgresResult start = mConnectionRW->PQexec( copy, false );
+  if ( start.PQresultStatus() != PGRES_COPY_IN )
+  {
+    // e.g. a view that takes INSERTs through rules: start over and insert the features
+    QgsDebugMsg( QString( "COPY unavailable: %1" ).arg( start.PQresultErrorMessage() ) );
+    mConnectionRW->PQexecNR( "ROLLBACK" );
+    mConnectionRW->PQexecNR( "BEGIN" );
+    return false;
+  }
+
+  int srid = ( mRequestedSrid.isEmpty() ? mDetectedSrid : mRequestedSrid ).toInt();
+
+  QByteArray buf;
+  QString error;
+  for ( QgsFeatureList::iterator features = flist.begin(); features != flist.end() && error.isNull(); features++ )
+  {
+    const QgsAttributeMap &attrs = features->attributeMap();
+
+    const char *delim = "";
+    if ( !mGeometryColumn.isNull() )
+    {
+      if ( features->geometry() )
+        appendEwkbHex( buf, features->geometry(), srid );
+      else
+        buf += "\\N";
+      delim = "\t";
+    }
+
+    foreach( int idx, fieldId )
+    {
+      buf += delim;
+      appendCopyValue( buf, attrs.value( idx ).toString() );
+      delim = "\t";
+    }
+    buf += '\n';
+
+    if ( buf.size() >= 65536 )
+    {
+      if ( mConnectionRW->PQputCopyData( buf ) != 1 )
+        error = mConnectionRW->PQerrorMessage();
+      buf.clear();
+    }
+  }
+
+  if ( error.isNull() && !buf.isEmpty() && mConnectionRW->PQputCopyData( buf ) != 1 )
+    error = mConnectionRW->PQerrorMessage();
+
+  if ( mConnectionRW->PQputCopyEnd( error.isNull() ? 0 : "aborted" ) != 1 && error.isNull() )
+    error = mConnectionRW->PQerrorMessage();
+
+  // read the outcome of the COPY up to the end
+  for ( ;; )
+  {
+    QgsPostgresResult result = mConnectionRW->PQgetResult();
+    if ( !result.result() )
+      break;
+
+    if ( result.PQresultStatus() != PGRES_COMMAND_OK && error.isNull() )
+      error = result.PQresultErrorMessage();
+  }
+
+  if ( !error.isNull() )
+    throw PGException( error );
+
+  return true;
+}
+
 bool QgsPostgresProvider::deleteFeatures( const QgsFeatureIds & id )
 {
   bool returnvalue = true;
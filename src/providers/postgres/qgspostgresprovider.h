@@ -25,10 +25,12 @@
 
 #include <QVector>
 #include <QQueue>
+#include <QSet>
 
 class QgsFeature;
 class QgsField;
 class QgsGeometry;
+class QgsPostgresFeatureIterator;
 
 #include "qgsdatasourceuri.h"
 
@@ -81,6 +83,12 @@ class QgsPostgresProvider : public QgsVectorDataProvider
      */
     virtual QgsCoordinateReferenceSystem crs();
 
+    /** Query the provider for features matching the request.
+     *  Each returned iterator uses its own cursor.
+     * @note added in 1.9
+     */
+    virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest& request = QgsFeatureRequest() );
+
     /** Select features based on a bounding rectangle. Features can be retrieved with calls to nextFeature.
      *  @param fetchAttributes list of attributes which should be fetched
      *  @param rect spatial filter
@@ -323,6 +331,9 @@ class QgsPostgresProvider : public QgsVectorDataProvider
   private:
     int mProviderId; // id to append to provider specific identified (like cursors)
 
+    /** where clause restricting the features to a rectangle and the layer's subset */
+    QString filterWhereClause( QgsRectangle rect, bool useIntersect ) const;
+
     bool declareCursor( const QString &cursorName,
                         const QgsAttributeList &fetchAttributes,
                         bool fetchGeometry,
@@ -361,8 +372,6 @@ class QgsPostgresProvider : public QgsVectorDataProvider
     */
     bool parseDomainCheckConstraint( QStringList& enumValues, const QString& attributeName ) const;
 
-    bool mFetching; // true if a cursor was declared
-    int mFetched; // number of retrieved features
     QVector<QgsFeature> mFeatures;
     QgsFieldMap mAttributeFields;
     QString mDataComment;
@@ -426,13 +435,10 @@ class QgsPostgresProvider : public QgsVectorDataProvider
     QString mDetectedSrid;                 //! Spatial reference detected in the database
     QString mRequestedSrid;                //! Spatial reference requested in the uri
 
-    /**
-     * Feature queue that GetNextFeature will retrieve from
-     * before the next fetch from PostgreSQL
-     */
-    QQueue<QgsFeature> mFeatureQueue;
+    int mFeatureQueueSize;  //! Maximal size of the feature queue of the iterators
 
-    int mFeatureQueueSize;  //! Maximal size of the feature queue
+    //! iterators that have not been closed yet
+    QSet<QgsPostgresFeatureIterator *> mActiveIterators;
 
     bool getGeometryDetails();
 
@@ -449,6 +455,10 @@ class QgsPostgresProvider : public QgsVectorDataProvider
           : mWhat( r.PQresultErrorMessage() )
       {}
 
+      PGException( const QString &what )
+          : mWhat( what )
+      {}
+
       PGException( const PGException &e )
           : mWhat( e.errorMessage() )
       {}
@@ -476,6 +486,10 @@ class QgsPostgresProvider : public QgsVectorDataProvider
 
     QString paramValue( QString fieldvalue, const QString &defaultValue ) const;
 
+    /** Adds features with COPY ... FROM STDIN inside the transaction of addFeatures().
+      @return false if COPY could not be started and INSERT has to be used instead */
+    bool copyFeatures( QgsFeatureList &flist );
+
     QgsPostgresConn *mConnectionRO; //! read-only database connection (initially)
     QgsPostgresConn *mConnectionRW; //! read-write database connection (on update)
 
@@ -498,6 +512,11 @@ class QgsPostgresProvider : public QgsVectorDataProvider
     static int sProviderIds;
     static const int sFeatureQueueSize;
 
+    //! minimal number of features addFeatures() loads with COPY instead of INSERT
+    static const int sCopyThreshold;
+
+    friend class QgsPostgresFeatureIterator;
+
     QMap<QVariant, QgsFeatureId> mKeyToFid;  // map key values to feature id
     QMap<QgsFeatureId, QVariant> mFidToKey;  // map feature back to fea
     QgsFeatureId mFidCounter;       // next feature id if map is used
@@ -0,0 +1,109 @@
+/***************************************************************************
+    qgsspatialitefeatureiterator.cpp
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsspatialitefeatureiterator.h"
+#include "qgsspatialiteprovider.h"
+
+#include "qgslogger.h"
+
+QgsSpatiaLiteFeatureIterator::QgsSpatiaLiteFeatureIterator( QgsSpatiaLiteProvider* p, const QgsFeatureRequest& request )
+    : QgsAbstractFeatureIterator( request )
+    , P( p )
+    , sqliteStatement( NULL )
+{
+  P->mActiveIterators << this;
+
+  mAttributesToFetch = mRequest.attributesToFetch( P->attributeIndexes() );
+
+  QString whereClause = P->filterWhereClause( mRequest.filterRect(), mRequest.flags() & QgsFeatureRequest::ExactIntersect );
+
+  // preparing the SQL statement
+  if ( !P->prepareStatement( sqliteStatement, mAttributesToFetch, mRequest.fetchGeometry(), whereClause ) )
+  {
+    // some error occurred
+    sqliteStatement = NULL;
+    close();
+    return;
+  }
+}
+
+QgsSpatiaLiteFeatureIterator::~QgsSpatiaLiteFeatureIterator()
+{
+  close();
+}
+
+bool QgsSpatiaLiteFeatureIterator::nextFeature( QgsFeature& feature )
+{
+  feature.setValid( false );
+
+  if ( mClosed )
+    return false;
+
+  if ( sqliteStatement == NULL )
+  {
+    QgsDebugMsg( "Invalid current SQLite statement" );
+    return false;
+  }
+
+  if ( !P->getFeature( sqliteStatement, mRequest.fetchGeometry(), feature, mAttributesToFetch ) )
+  {
+    sqlite3_finalize( sqliteStatement );
+    sqliteStatement = NULL;
+    return false;
+  }
+
+  feature.setValid( true );
+  return true;
+}
+
+bool QgsSpatiaLiteFeatureIterator::rewind()
+{
+  if ( mClosed )
+    return false;
+
+  if ( sqliteStatement )
+  {
+    if ( sqlite3_reset( sqliteStatement ) == SQLITE_OK )
+      return true;
+
+    sqlite3_finalize( sqliteStatement );
+    sqliteStatement = NULL;
+  }
+
+  // the statement was finalized after the last feature: prepare it again
+  QString whereClause = P->filterWhereClause( mRequest.filterRect(), mRequest.flags() & QgsFeatureRequest::ExactIntersect );
+  if ( !P->prepareStatement( sqliteStatement, mAttributesToFetch, mRequest.fetchGeometry(), whereClause ) )
+  {
+    sqliteStatement = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+bool QgsSpatiaLiteFeatureIterator::close()
+{
+  if ( mClosed )
+    return false;
+
+  if ( sqliteStatement )
+  {
+    sqlite3_finalize( sqliteStatement );
+    sqliteStatement = NULL;
+  }
+
+  P->mActiveIterators.remove( this );
+
+  mClosed = true;
+  return true;
+}
@@ -0,0 +1,57 @@
+/***************************************************************************
+    qgsspatialitefeatureiterator.h
+    ---------------------
+    begin                : March 2012
+    copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSSPATIALITEFEATUREITERATOR_H
+#define QGSSPATIALITEFEATUREITERATOR_H
+
+#include "qgsfeatureiterator.h"
+
+extern "C"
+{
+#include <sqlite3.h>
+}
+
+class QgsSpatiaLiteProvider;
+
+/**
+  Iterator over the features of a SpatiaLite layer. Every iterator prepares
+  its own statement on the provider's database handle.
+  */
+class QgsSpatiaLiteFeatureIterator : public QgsAbstractFeatureIterator
+{
+  public:
+    QgsSpatiaLiteFeatureIterator( QgsSpatiaLiteProvider* p, const QgsFeatureRequest& request );
+
+    ~QgsSpatiaLiteFeatureIterator();
+
+    //! fetch next feature, return true on success
+    virtual bool nextFeature( QgsFeature& feature );
+
+    //! reset the iterator to the starting position
+    virtual bool rewind();
+
+    //! end of iterating: free the resources / lock
+    virtual bool close();
+
+  protected:
+    QgsSpatiaLiteProvider* P;
+
+    /**
+      * SQLite statement handle
+     */
+    sqlite3_stmt *sqliteStatement;
+
+    QgsAttributeList mAttributesToFetch;
+};
+
+#endif // QGSSPATIALITEFEATUREITERATOR_H
@@ -25,6 +25,7 @@ email                : a.furieri@lqt.it
 
 #include "qgsvectorlayerimport.h"
 #include "qgsspatialiteprovider.h"
+#include "qgsspatialitefeatureiterator.h"
 #include "qgslogger.h"
 #include "qgsmessagelog.h"
 
@@ -405,7 +406,6 @@ QgsSpatiaLiteProvider::QgsSpatiaLiteProvider( QString const &uri )
     : QgsVectorDataProvider( uri )
     , geomType( QGis::WKBUnknown )
     , sqliteHandle( NULL )
-    , sqliteStatement( NULL )
     , mSrid( -1 )
     , spatialIndexRTree( false )
     , spatialIndexMbrCache( false )
@@ -716,21 +716,7 @@ bool QgsSpatiaLiteProvider::nextFeature( QgsFeature & feature )
     return false;
   }
 
-  if ( sqliteStatement == NULL )
-  {
-    QgsDebugMsg( "Invalid current SQLite statement" );
-    return false;
-  }
-
-  if ( !getFeature( sqliteStatement, mFetchGeom, feature, mAttributesToFetch ) )
-  {
-    sqlite3_finalize( sqliteStatement );
-    sqliteStatement = NULL;
-    return false;
-  }
-
-  feature.setValid( true );
-  return true;
+  return mSelectIterator.nextFeature( feature );
 }
 
 bool QgsSpatiaLiteProvider::getFeature( sqlite3_stmt *stmt, bool fetchGeometry,
@@ -810,7 +796,8 @@ bool QgsSpatiaLiteProvider::getFeature( sqlite3_stmt *stmt, bool fetchGeometry,
         }
         if ( fetchGeometry )
         {
-          if ( ic == mGeomColIdx )
+          // the geometry is the column following the attributes
+          if ( ic == fetchAttributes.size() + 1 )
           {
             if ( sqlite3_column_type( stmt, ic ) == SQLITE_BLOB )
             {
@@ -3147,23 +3134,10 @@ bool QgsSpatiaLiteProvider::setSubsetString( QString theSQL, bool updateFeatureC
   return false;
 }
 
-void QgsSpatiaLiteProvider::select( QgsAttributeList fetchAttributes, QgsRectangle rect, bool fetchGeometry, bool useIntersect )
+QString QgsSpatiaLiteProvider::filterWhereClause( const QgsRectangle &rect, bool useIntersect ) const
 {
   QString primaryKey = !isQuery ? "ROWID" : quotedIdentifier( mPrimaryKey );
 
-  if ( !valid )
-  {
-    QgsDebugMsg( "Read attempt on an invalid SpatiaLite data source" );
-    return;
-  }
-
-  if ( sqliteStatement != NULL )
-  {
-    // finalizing the current SQLite statement
-    sqlite3_finalize( sqliteStatement );
-    sqliteStatement = NULL;
-  }
-
   QString whereClause;
 
   if ( !rect.isEmpty() && !mGeometryColumn.isNull() )
@@ -3236,15 +3210,29 @@ void QgsSpatiaLiteProvider::select( QgsAttributeList fetchAttributes, QgsRectang
     whereClause += "( " + mSubsetString + ")";
   }
 
-  mFetchGeom = fetchGeometry;
-  mAttributesToFetch = fetchAttributes;
-  // preparing the SQL statement
-  if ( !prepareStatement( sqliteStatement, fetchAttributes, fetchGeometry, whereClause ) )
+  return whereClause;
+}
+
+QgsFeatureIterator QgsSpatiaLiteProvider::getFeatures( const QgsFeatureRequest& request )
+{
+  if ( !valid )
   {
-    // some error occurred
-    sqliteStatement = NULL;
+    QgsDebugMsg( "Read attempt on an invalid SpatiaLite data source" );
+    return QgsFeatureIterator();
+  }
+
+  return QgsFeatureIterator( new QgsSpatiaLiteFeatureIterator( this, request ) );
+}
+
+void QgsSpatiaLiteProvider::select( QgsAttributeList fetchAttributes, QgsRectangle rect, bool fetchGeometry, bool useIntersect )
+{
+  if ( !valid )
+  {
+    QgsDebugMsg( "Read attempt on an invalid SpatiaLite data source" );
     return;
   }
+
+  mSelectIterator = getFeatures( selectRequest( fetchAttributes, rect, fetchGeometry, useIntersect ) );
 }
 
 bool QgsSpatiaLiteProvider::prepareStatement(
@@ -3261,7 +3249,6 @@ bool QgsSpatiaLiteProvider::prepareStatement(
   QString primaryKey = !isQuery ? "ROWID" : quotedIdentifier( mPrimaryKey );
 
   QString sql = QString( "SELECT %1" ).arg( primaryKey );
-  int colIdx = 1; // column 0 is primary key
   for ( QgsAttributeList::const_iterator it = fetchAttributes.constBegin(); it != fetchAttributes.constEnd(); ++it )
   {
     const QgsField & fld = field( *it );
@@ -3273,12 +3260,10 @@ bool QgsSpatiaLiteProvider::prepareStatement(
       fieldname = QString( "AsText(%1)" ).arg( fieldname );
     }
     sql += "," + fieldname;
-    colIdx++;
   }
   if ( fetchGeometry )
   {
     sql += QString( ", AsBinary(%1)" ).arg( quotedIdentifier( mGeometryColumn ) );
-    mGeomColIdx = colIdx;
   }
   sql += QString( " FROM %1" ).arg( mQuery );
 
@@ -3339,11 +3324,7 @@ uint QgsSpatiaLiteProvider::fieldCount() const
 
 void QgsSpatiaLiteProvider::rewind()
 {
-  if ( sqliteStatement )
-  {
-    sqlite3_finalize( sqliteStatement );
-    sqliteStatement = NULL;
-  }
+  mSelectIterator.rewind();
   loadFields();
 }
 
@@ -4077,10 +4058,11 @@ int QgsSpatiaLiteProvider::capabilities() const
 void QgsSpatiaLiteProvider::closeDb()
 {
 // trying to close the SQLite DB
-  if ( sqliteStatement )
+  while ( !mActiveIterators.empty() )
   {
-    sqlite3_finalize( sqliteStatement );
-    sqliteStatement = NULL;
+    QgsSpatiaLiteFeatureIterator *it = *mActiveIterators.begin();
+    QgsDebugMsg( "closing active iterator" );
+    it->close();
   }
   if ( handle )
   {
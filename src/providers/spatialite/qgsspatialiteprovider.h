@@ -30,8 +30,11 @@ extern "C"
 #include <fstream>
 #include <set>
 
+#include <QSet>
+
 class QgsFeature;
 class QgsField;
+class QgsSpatiaLiteFeatureIterator;
 
 #include "qgsdatasourceuri.h"
 
@@ -98,6 +101,12 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
 
     virtual bool supportsSubsetString() { return true; }
 
+    /** Query the provider for features matching the request.
+     *  Each returned iterator prepares its own statement.
+     * @note added in 1.9
+     */
+    virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest& request = QgsFeatureRequest() );
+
     /** Select features based on a bounding rectangle. Features can be retrieved with calls to nextFeature.
      *  @param fetchAttributes list of attributes which should be fetched
      *  @param rect spatial filter
@@ -348,9 +357,9 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
      */
     sqlite3 *sqliteHandle;
     /**
-      * SQLite statement handle
+     * iterators that have not been closed yet
      */
-    sqlite3_stmt *sqliteStatement;
+    QSet<QgsSpatiaLiteFeatureIterator *> mActiveIterators;
     /**
      * String used to define a subset of the layer
      */
@@ -393,9 +402,6 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
 
     const QgsField & field( int index ) const;
 
-    /** geometry column index used when fetching geometry */
-    int mGeomColIdx;
-
     /**
     * internal utility functions used to handle common SQLite tasks
     */
@@ -409,6 +415,7 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
     bool getQueryGeometryDetails();
     bool getSridDetails();
     bool getTableSummary();
+    QString filterWhereClause( const QgsRectangle &rect, bool useIntersect ) const;
     bool prepareStatement( sqlite3_stmt *&stmt,
                            const QgsAttributeList &fetchAttributes,
                            bool fetchGeometry,
@@ -519,4 +526,6 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
      * sqlite3 handles pointer
      */
     SqliteHandles *handle;
+
+    friend class QgsSpatiaLiteFeatureIterator;
 };
@@ -0,0 +1,253 @@
+/***************************************************************************
+  testqgsgraphanalyzer.cpp
+  --------------------------------------
+Date                 : March 2012
+Copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <limits>
+#include <cmath>
+
+//header for class being tested
+#include <qgsgraph.h>
+#include <qgscompactgraph.h>
+#include <qgsgraphanalyzer.h>
+
+class TestQgsGraphAnalyzer: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    /** Our tests proper begin here */
+    void compactGraph();
+    void dijkstra();
+    void shortestPath();
+    void shortestPathAStar();
+    void unreachable();
+    void benchmarkDijkstraLegacy();
+    void benchmarkDijkstraCompact();
+    void benchmarkShortestPath();
+    void benchmarkShortestPathAStar();
+  private:
+    /** build a size x size grid with arcs in both directions; costs are the arc
+     * length multiplied by a random factor between 1 and 2 */
+    static QgsGraph* gridGraph( int size );
+    double pathCost( const QList<int>& path, int start, int stop );
+
+    QgsGraph* mGraph;
+    QgsCompactGraph* mCompactGraph;
+};
+
+QgsGraph* TestQgsGraphAnalyzer::gridGraph( int size )
+{
+  qsrand( 1 );
+  QgsGraph* graph = new QgsGraph();
+  for ( int row = 0; row < size; ++row )
+  {
+    for ( int col = 0; col < size; ++col )
+    {
+      graph->addVertex( QgsPoint( col, row ) );
+    }
+  }
+
+  for ( int row = 0; row < size; ++row )
+  {
+    for ( int col = 0; col < size; ++col )
+    {
+      int v = row * size + col;
+      QList<int> neighbours;
+      if ( col + 1 < size )
+        neighbours << v + 1;
+      if ( row + 1 < size )
+        neighbours << v + size;
+
+      foreach ( int w, neighbours )
+      {
+        QVector<QVariant> props;
+        props << QVariant( 1.0 + ( double ) qrand() / RAND_MAX );
+        graph->addArc( v, w, props );
+        props[ 0 ] = QVariant( 1.0 + ( double ) qrand() / RAND_MAX );
+        graph->addArc( w, v, props );
+      }
+    }
+  }
+  return graph;
+}
+
+double TestQgsGraphAnalyzer::pathCost( const QList<int>& path, int start, int stop )
+{
+  double cost = 0.0;
+  int v = start;
+  foreach ( int arcId, path )
+  {
+    if ( mCompactGraph->arcOutVertex( arcId ) != v )
+      return -1.0;
+    cost += mCompactGraph->arcCost( 0, arcId );
+    v = mCompactGraph->arcInVertex( arcId );
+  }
+  return v == stop ? cost : -1.0;
+}
+
+void TestQgsGraphAnalyzer::initTestCase()
+{
+  mGraph = gridGraph( 100 );
+  mCompactGraph = new QgsCompactGraph( mGraph );
+}
+
+void TestQgsGraphAnalyzer::cleanupTestCase()
+{
+  delete mCompactGraph;
+  delete mGraph;
+}
+
+void TestQgsGraphAnalyzer::compactGraph()
+{
+  QCOMPARE( mCompactGraph->vertexCount(), mGraph->vertexCount() );
+  QCOMPARE( mCompactGraph->arcCount(), mGraph->arcCount() );
+  QCOMPARE( mCompactGraph->criterionCount(), 1 );
+
+  for ( int v = 0; v < mGraph->vertexCount(); ++v )
+  {
+    QCOMPARE( mCompactGraph->outEnd( v ) - mCompactGraph->outBegin( v ), mGraph->vertex( v ).outArc().size() );
+    QCOMPARE( mCompactGraph->inEnd( v ) - mCompactGraph->inBegin( v ), mGraph->vertex( v ).inArc().size() );
+    for ( int pos = mCompactGraph->outBegin( v ); pos < mCompactGraph->outEnd( v ); ++pos )
+    {
+      const QgsGraphArc& arc = mGraph->arc( mCompactGraph->outArcId( pos ) );
+      QCOMPARE( arc.outVertex(), v );
+      QCOMPARE( arc.inVertex(), mCompactGraph->outHead( pos ) );
+      QCOMPARE( mCompactGraph->outCost( 0, pos ), arc.property( 0 ).toDouble() );
+    }
+  }
+}
+
+void TestQgsGraphAnalyzer::dijkstra()
+{
+  QVector<int> legacyTree, tree;
+  QVector<double> legacyCost, cost;
+  QgsGraphAnalyzer::dijkstra( mGraph, 0, 0, &legacyTree, &legacyCost );
+  QgsGraphAnalyzer::dijkstra( mCompactGraph, 0, 0, &tree, &cost );
+
+  QCOMPARE( cost.size(), legacyCost.size() );
+  for ( int v = 0; v < cost.size(); ++v )
+  {
+    QVERIFY( qAbs( cost[ v ] - legacyCost[ v ] ) < 1e-9 );
+    if ( v == 0 )
+    {
+      QCOMPARE( tree[ v ], -1 );
+    }
+    else
+    {
+      QCOMPARE( mCompactGraph->arcInVertex( tree[ v ] ), v );
+      int u = mCompactGraph->arcOutVertex( tree[ v ] );
+      QVERIFY( qAbs( cost[ u ] + mCompactGraph->arcCost( 0, tree[ v ] ) - cost[ v ] ) < 1e-9 );
+    }
+  }
+}
+
+void TestQgsGraphAnalyzer::shortestPath()
+{
+  QVector<double> cost;
+  QgsGraphAnalyzer::dijkstra( mCompactGraph, 0, 0, NULL, &cost );
+
+  int stops[] = { 0, 1, 99, 5050, 9999 };
+  for ( unsigned int i = 0; i < sizeof( stops ) / sizeof( stops[0] ); ++i )
+  {
+    QList<int> path;
+    double c = QgsGraphAnalyzer::shortestPath( mCompactGraph, 0, stops[i], 0, &path );
+    QVERIFY( qAbs( c - cost[ stops[i] ] ) < 1e-9 );
+    QVERIFY( qAbs( pathCost( path, 0, stops[i] ) - c ) < 1e-9 );
+  }
+}
+
+void TestQgsGraphAnalyzer::shortestPathAStar()
+{
+  QVector<double> cost;
+  QgsGraphAnalyzer::dijkstra( mCompactGraph, 0, 0, NULL, &cost );
+
+  // every arc costs at least its length
+  int stops[] = { 0, 1, 99, 5050, 9999 };
+  for ( unsigned int i = 0; i < sizeof( stops ) / sizeof( stops[0] ); ++i )
+  {
+    QList<int> path;
+    double c = QgsGraphAnalyzer::shortestPathAStar( mCompactGraph, 0, stops[i], 0, 1.0, &path );
+    QVERIFY( qAbs( c - cost[ stops[i] ] ) < 1e-9 );
+    QVERIFY( qAbs( pathCost( path, 0, stops[i] ) - c ) < 1e-9 );
+  }
+}
+
+void TestQgsGraphAnalyzer::unreachable()
+{
+  QgsGraph graph;
+  graph.addVertex( QgsPoint( 0, 0 ) );
+  graph.addVertex( QgsPoint( 1, 0 ) );
+  graph.addVertex( QgsPoint( 2, 0 ) );
+  QVector<QVariant> props;
+  props << QVariant( 1.0 );
+  graph.addArc( 0, 1, props );
+  graph.addArc( 2, 1, props );
+  QgsCompactGraph compactGraph( &graph );
+
+  const double inf = std::numeric_limits<double>::infinity();
+  QList<int> path;
+  QVERIFY( QgsGraphAnalyzer::shortestPath( &compactGraph, 0, 2, 0, &path ) == inf );
+  QVERIFY( path.isEmpty() );
+  QVERIFY( QgsGraphAnalyzer::shortestPathAStar( &compactGraph, 0, 2, 0, 1.0, &path ) == inf );
+  QVERIFY( path.isEmpty() );
+  QCOMPARE( QgsGraphAnalyzer::shortestPath( &compactGraph, 0, 1, 0, &path ), 1.0 );
+  QCOMPARE( path.size(), 1 );
+
+  // a point that is not a vertex of the graph (findVertex returns -1)
+  QVERIFY( QgsGraphAnalyzer::shortestPath( &compactGraph, -1, 1, 0, &path ) == inf );
+  QVERIFY( path.isEmpty() );
+  QVERIFY( QgsGraphAnalyzer::shortestPath( &compactGraph, 0, 3, 0, &path ) == inf );
+  QVERIFY( QgsGraphAnalyzer::shortestPathAStar( &compactGraph, 0, -1, 0, 1.0, &path ) == inf );
+  QVERIFY( QgsGraphAnalyzer::shortestPathAStar( &compactGraph, 3, 1, 0, 1.0, &path ) == inf );
+  QVERIFY( path.isEmpty() );
+}
+
+void TestQgsGraphAnalyzer::benchmarkDijkstraLegacy()
+{
+  QVector<double> cost;
+  QBENCHMARK
+  {
+    QgsGraphAnalyzer::dijkstra( mGraph, 0, 0, NULL, &cost );
+  }
+}
+
+void TestQgsGraphAnalyzer::benchmarkDijkstraCompact()
+{
+  QVector<double> cost;
+  QBENCHMARK
+  {
+    QgsGraphAnalyzer::dijkstra( mCompactGraph, 0, 0, NULL, &cost );
+  }
+}
+
+void TestQgsGraphAnalyzer::benchmarkShortestPath()
+{
+  QList<int> path;
+  QBENCHMARK
+  {
+    QgsGraphAnalyzer::shortestPath( mCompactGraph, 0, 5050, 0, &path );
+  }
+}
+
+void TestQgsGraphAnalyzer::benchmarkShortestPathAStar()
+{
+  QList<int> path;
+  QBENCHMARK
+  {
+    QgsGraphAnalyzer::shortestPathAStar( mCompactGraph, 0, 5050, 0, 1.0, &path );
+  }
+}
+
+QTEST_MAIN( TestQgsGraphAnalyzer )
+#include "moc_testqgsgraphanalyzer.cxx"
@@ -0,0 +1,279 @@
+/***************************************************************************
+     testqgsidwinterpolator.cpp
+     --------------------------------------
+    Date                 : March 2012
+    Copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QString>
+#include <QDir>
+#include <QFile>
+#include <QPair>
+#include <QVector>
+
+#include <gdal.h>
+#include <math.h>
+
+#include <qgsapplication.h>
+#include <qgsgeometry.h>
+#include <qgsproviderregistry.h>
+#include <qgsvectordataprovider.h>
+#include <qgsvectorlayer.h>
+
+//header for class being tested
+#include <qgsgridfilewriter.h>
+#include <qgsidwinterpolator.h>
+
+/** \ingroup UnitTests
+ * Compares the nearest points and search radius variants of the IDW interpolator
+ * with a brute force search over random points and checks the GeoTIFF output
+ * of the grid file writer.
+ */
+class TestQgsIDWInterpolator: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void allPoints();
+    void nearestPoints();
+    void searchRadius();
+    void nearestPointsInRadius();
+    void geoTiffOutput();
+  private:
+    /** creates an interpolator on the random points */
+    QgsIDWInterpolator* createInterpolator( int maxPoints, double radius );
+    /** IDW value of a location from all points sorted by distance
+      @return 0 in case of success, 1 if no point is used */
+    int bruteForceValue( double x, double y, int maxPoints, double radius, double& result ) const;
+    /** compares the interpolator with the brute force search at random locations and at a point */
+    void checkInterpolator( int maxPoints, double radius );
+
+    static const int mPointCount = 500;
+    QVector<double> mX;
+    QVector<double> mY;
+    QVector<double> mZ;
+    QgsVectorLayer* mLayer;
+    QString mOutput;
+};
+
+void TestQgsIDWInterpolator::initTestCase()
+{
+  QgsApplication::setPrefixPath( INSTALL_PREFIX, true );
+  QgsProviderRegistry::instance( QgsApplication::pluginPath() );
+  GDALAllRegister();
+  mOutput = QDir::tempPath() + QDir::separator() + "qgis_test_idw_output.tif";
+
+  // random points in a 100 x 100 square
+  qsrand( 42 );
+  mLayer = new QgsVectorLayer( "Point?field=value:double", "points", "memory" );
+  QVERIFY( mLayer->isValid() );
+  QgsFeatureList features;
+  for ( int i = 0; i < mPointCount; ++i )
+  {
+    mX << 100.0 * qrand() / RAND_MAX;
+    mY << 100.0 * qrand() / RAND_MAX;
+    mZ << 1000.0 * qrand() / RAND_MAX;
+    QgsFeature f;
+    f.setGeometry( QgsGeometry::fromPoint( QgsPoint( mX.last(), mY.last() ) ) );
+    f.addAttribute( 0, mZ.last() );
+    features << f;
+  }
+  QVERIFY( mLayer->dataProvider()->addFeatures( features ) );
+}
+
+void TestQgsIDWInterpolator::cleanupTestCase()
+{
+  delete mLayer;
+  QFile::remove( mOutput );
+}
+
+QgsIDWInterpolator* TestQgsIDWInterpolator::createInterpolator( int maxPoints, double radius )
+{
+  QgsInterpolator::LayerData layerData;
+  layerData.vectorLayer = mLayer;
+  layerData.zCoordInterpolation = false;
+  layerData.interpolationAttribute = 0;
+  layerData.mInputType = QgsInterpolator::POINTS;
+
+  QgsIDWInterpolator* interpolator = new QgsIDWInterpolator( QList<QgsInterpolator::LayerData>() << layerData );
+  interpolator->setMaxPoints( maxPoints );
+  interpolator->setSearchRadius( radius );
+  return interpolator;
+}
+
+int TestQgsIDWInterpolator::bruteForceValue( double x, double y, int maxPoints, double radius, double& result ) const
+{
+  QList< QPair<double, int> > distances;
+  for ( int i = 0; i < mPointCount; ++i )
+  {
+    double squaredDistance = ( mX[i] - x ) * ( mX[i] - x ) + ( mY[i] - y ) * ( mY[i] - y );
+    if ( radius > 0 && squaredDistance > radius * radius )
+    {
+      continue;
+    }
+    distances << qMakePair( squaredDistance, i );
+  }
+  qSort( distances );
+  if ( maxPoints > 0 && distances.size() > maxPoints )
+  {
+    distances = distances.mid( 0, maxPoints );
+  }
+
+  if ( distances.isEmpty() )
+  {
+    return 1;
+  }
+  if ( distances[0].first == 0 )
+  {
+    result = mZ[distances[0].second];
+    return 0;
+  }
+
+  double sumCounter = 0;
+  double sumDenominator = 0;
+  for ( int i = 0; i < distances.size(); ++i )
+  {
+    double weight = 1 / pow( sqrt( distances[i].first ), 2.0 );
+    sumCounter += weight * mZ[distances[i].second];
+    sumDenominator += weight;
+  }
+  result = sumCounter / sumDenominator;
+  return 0;
+}
+
+void TestQgsIDWInterpolator::checkInterpolator( int maxPoints, double radius )
+{
+  QgsIDWInterpolator* interpolator = createInterpolator( maxPoints, radius );
+
+  // random locations, a bit beyond the points, and one on a point
+  QList< QPair<double, double> > locations;
+  for ( int i = 0; i < 300; ++i )
+  {
+    locations << qMakePair( -10.0 + 120.0 * qrand() / RAND_MAX, -10.0 + 120.0 * qrand() / RAND_MAX );
+  }
+  locations << qMakePair( mX[7], mY[7] );
+
+  int noValueCount = 0;
+  for ( int i = 0; i < locations.size(); ++i )
+  {
+    double x = locations[i].first;
+    double y = locations[i].second;
+    double expected = 0;
+    double value = 0;
+    int expectedResult = bruteForceValue( x, y, maxPoints, radius, expected );
+    QCOMPARE( interpolator->interpolatePoint( x, y, value ), expectedResult );
+    if ( expectedResult != 0 )
+    {
+      ++noValueCount;
+      continue;
+    }
+    if ( fabs( value - expected ) > 1e-9 * qMax( 1.0, fabs( expected ) ) )
+    {
+      QFAIL( QString( "location %1/%2: %3 instead of %4" ).arg( x ).arg( y ).arg( value, 0, 'g', 17 ).arg( expected, 0, 'g', 17 ).toLocal8Bit().constData() );
+    }
+  }
+
+  // only a search radius leaves locations without value
+  QVERIFY( radius > 0 || noValueCount == 0 );
+  delete interpolator;
+}
+
+void TestQgsIDWInterpolator::allPoints()
+{
+  checkInterpolator( 0, 0 );
+}
+
+void TestQgsIDWInterpolator::nearestPoints()
+{
+  checkInterpolator( 1, 0 );
+  checkInterpolator( 5, 0 );
+  checkInterpolator( 12, 0 );
+  checkInterpolator( mPointCount + 10, 0 );
+}
+
+void TestQgsIDWInterpolator::searchRadius()
+{
+  checkInterpolator( 0, 3 );
+  checkInterpolator( 0, 15 );
+  checkInterpolator( 0, 500 );
+}
+
+void TestQgsIDWInterpolator::nearestPointsInRadius()
+{
+  checkInterpolator( 8, 4 );
+  checkInterpolator( 8, 20 );
+}
+
+void TestQgsIDWInterpolator::geoTiffOutput()
+{
+  QFile::remove( mOutput );
+  const int nCols = 173;
+  const int nRows = 131;
+  const double cellSize = 110.0 / nCols;
+  QgsRectangle extent( -5, -5, -5 + nCols * cellSize, -5 + nRows * cellSize );
+
+  // the small radius leaves cells without value
+  QgsIDWInterpolator* interpolator = createInterpolator( 10, 3 );
+  QgsGridFileWriter writer( interpolator, mOutput, extent, nCols, nRows, cellSize, cellSize );
+  writer.setOutputFormat( "GTiff" );
+  QCOMPARE( writer.writeFile( false ), 0 );
+
+  GDALDatasetH dataset = GDALOpen( mOutput.toLocal8Bit().data(), GA_ReadOnly );
+  QVERIFY( dataset );
+  QCOMPARE( GDALGetRasterXSize( dataset ), nCols );
+  QCOMPARE( GDALGetRasterYSize( dataset ), nRows );
+  double geotransform[6];
+  GDALGetGeoTransform( dataset, geotransform );
+  QCOMPARE( geotransform[0], extent.xMinimum() );
+  QCOMPARE( geotransform[1], cellSize );
+  QCOMPARE( geotransform[3], extent.yMaximum() );
+  QCOMPARE( geotransform[5], -cellSize );
+
+  GDALRasterBandH band = GDALGetRasterBand( dataset, 1 );
+  QCOMPARE( GDALGetRasterDataType( band ), GDT_Float32 );
+  int hasNodata = 0;
+  double nodata = GDALGetRasterNoDataValue( band, &hasNodata );
+  QVERIFY( hasNodata );
+  QCOMPARE( nodata, -9999.0 );
+
+  QVector<float> values( nCols * nRows );
+  GDALRasterIO( band, GF_Read, 0, 0, nCols, nRows, values.data(), nCols, nRows, GDT_Float32, 0, 0 );
+  GDALClose( dataset );
+
+  // every cell holds the value at its center
+  int nodataCount = 0;
+  for ( int i = 0; i < nRows; ++i )
+  {
+    double y = extent.yMaximum() - ( i + 0.5 ) * cellSize;
+    for ( int j = 0; j < nCols; ++j )
+    {
+      double x = extent.xMinimum() + ( j + 0.5 ) * cellSize;
+      double expected;
+      if ( bruteForceValue( x, y, 10, 3, expected ) != 0 )
+      {
+        expected = nodata;
+        ++nodataCount;
+      }
+      float value = values[i * nCols + j];
+      if ( fabs( value - expected ) > 1e-4 * qMax( 1.0, fabs( expected ) ) )
+      {
+        QFAIL( QString( "cell %1/%2: %3 instead of %4" ).arg( i ).arg( j ).arg( value ).arg( expected ).toLocal8Bit().constData() );
+      }
+    }
+  }
+  QVERIFY( nodataCount > 0 );
+  QVERIFY( nodataCount < nCols * nRows );
+  delete interpolator;
+}
+
+QTEST_MAIN( TestQgsIDWInterpolator )
+#include "moc_testqgsidwinterpolator.cxx"
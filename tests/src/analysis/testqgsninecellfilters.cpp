@@ -0,0 +1,235 @@
+/***************************************************************************
+     testqgsninecellfilters.cpp
+     --------------------------------------
+    Date                 : March 2012
+    Copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QString>
+#include <QDir>
+#include <QFile>
+#include <QVector>
+
+#include <gdal.h>
+#include <cpl_string.h>
+
+//header for class being tested
+#include <qgsaspectfilter.h>
+#include <qgshillshadefilter.h>
+#include <qgsruggednessfilter.h>
+#include <qgsslopefilter.h>
+#include <qgstotalcurvaturefilter.h>
+
+/** \ingroup UnitTests
+ * Runs the terrain filters on a generated DEM and compares the output
+ * with the window function applied cell by cell.
+ */
+class TestQgsNineCellFilters: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void slope();
+    void aspect();
+    void hillshade();
+    void ruggedness();
+    void totalCurvature();
+    void tallBlocks();
+  private:
+    /** creates a DEM with some nodata cells, tiled if blockSize > 0 and with strips of
+      stripRows rows if stripRows > 0 */
+    void createDem( const QString& fileName, int blockSize, int xSize = mXSize, int ySize = mYSize, int stripRows = 0 );
+    /** runs the filter on both DEMs and compares every cell with the window function */
+    void checkFilter( QgsNineCellFilter& tiledFilter, QgsNineCellFilter& stripFilter );
+    void checkOutput( QgsNineCellFilter& filter, const QString& demFile, const QString& outputFile );
+    /** reads the band of a raster as floats */
+    QVector<float> readRaster( const QString& fileName );
+
+    static const int mXSize = 157;
+    static const int mYSize = 211;
+    QString mTiledDem;
+    QString mStripDem;
+    QString mOutput;
+};
+
+void TestQgsNineCellFilters::initTestCase()
+{
+  GDALAllRegister();
+  mTiledDem = QDir::tempPath() + QDir::separator() + "qgis_test_ninecell_tiled.tif";
+  mStripDem = QDir::tempPath() + QDir::separator() + "qgis_test_ninecell_strip.tif";
+  mOutput = QDir::tempPath() + QDir::separator() + "qgis_test_ninecell_output.tif";
+  createDem( mTiledDem, 32 );
+  createDem( mStripDem, 0 );
+}
+
+void TestQgsNineCellFilters::cleanupTestCase()
+{
+  QFile::remove( mTiledDem );
+  QFile::remove( mStripDem );
+  QFile::remove( mOutput );
+}
+
+void TestQgsNineCellFilters::createDem( const QString& fileName, int blockSize, int xSize, int ySize, int stripRows )
+{
+  QFile::remove( fileName );
+  char **options = NULL;
+  if ( blockSize > 0 )
+  {
+    options = CSLSetNameValue( options, "TILED", "YES" );
+    options = CSLSetNameValue( options, "BLOCKXSIZE", QString::number( blockSize ).toAscii().constData() );
+    options = CSLSetNameValue( options, "BLOCKYSIZE", QString::number( blockSize ).toAscii().constData() );
+  }
+  else if ( stripRows > 0 )
+  {
+    options = CSLSetNameValue( options, "BLOCKYSIZE", QString::number( stripRows ).toAscii().constData() );
+  }
+  GDALDriverH driver = GDALGetDriverByName( "GTiff" );
+  GDALDatasetH dataset = GDALCreate( driver, fileName.toLocal8Bit().data(), xSize, ySize, 1, GDT_Float32, options );
+  CSLDestroy( options );
+  QVERIFY( dataset );
+
+  double geotransform[6] = { 600000, 25, 0, 200000, 0, -25 };
+  GDALSetGeoTransform( dataset, geotransform );
+  GDALRasterBandH band = GDALGetRasterBand( dataset, 1 );
+  GDALSetRasterNoDataValue( band, -1 );
+
+  QVector<float> values( xSize * ySize );
+  for ( int i = 0; i < ySize; ++i )
+  {
+    for ( int j = 0; j < xSize; ++j )
+    {
+      // hills with some holes
+      float value = 400 + 80 * sin( j / 9.0 ) * cos( i / 13.0 ) + ( i * 31 + j * 17 ) % 7;
+      if (( i * xSize + j ) % 97 == 0 || ( i > 100 && i < 104 && j > 20 && j < 60 ) )
+      {
+        value = -1;
+      }
+      values[i * xSize + j] = value;
+    }
+  }
+  GDALRasterIO( band, GF_Write, 0, 0, xSize, ySize, values.data(), xSize, ySize, GDT_Float32, 0, 0 );
+  GDALClose( dataset );
+}
+
+QVector<float> TestQgsNineCellFilters::readRaster( const QString& fileName )
+{
+  QVector<float> values;
+  GDALDatasetH dataset = GDALOpen( fileName.toLocal8Bit().data(), GA_ReadOnly );
+  if ( !dataset )
+  {
+    return values;
+  }
+  int xSize = GDALGetRasterXSize( dataset );
+  int ySize = GDALGetRasterYSize( dataset );
+  values.resize( xSize * ySize );
+  GDALRasterIO( GDALGetRasterBand( dataset, 1 ), GF_Read, 0, 0, xSize, ySize, values.data(), xSize, ySize, GDT_Float32, 0, 0 );
+  GDALClose( dataset );
+  return values;
+}
+
+void TestQgsNineCellFilters::checkFilter( QgsNineCellFilter& tiledFilter, QgsNineCellFilter& stripFilter )
+{
+  QCOMPARE( tiledFilter.processRaster( 0 ), 0 );
+  checkOutput( tiledFilter, mStripDem, mOutput );
+  QCOMPARE( stripFilter.processRaster( 0 ), 0 );
+  checkOutput( stripFilter, mStripDem, mOutput );
+}
+
+void TestQgsNineCellFilters::checkOutput( QgsNineCellFilter& filter, const QString& demFile, const QString& outputFile )
+{
+  GDALDatasetH dataset = GDALOpen( demFile.toLocal8Bit().data(), GA_ReadOnly );
+  QVERIFY( dataset );
+  int xSize = GDALGetRasterXSize( dataset );
+  int ySize = GDALGetRasterYSize( dataset );
+  GDALClose( dataset );
+
+  QVector<float> dem = readRaster( demFile );
+  QVector<float> output = readRaster( outputFile );
+  QCOMPARE( output.size(), xSize * ySize );
+
+  // the DEM with a border of nodata cells
+  int lineSize = xSize + 2;
+  float nodata = filter.inputNodataValue();
+  QVector<float> padded( lineSize * ( ySize + 2 ), nodata );
+  for ( int i = 0; i < ySize; ++i )
+  {
+    for ( int j = 0; j < xSize; ++j )
+    {
+      padded[( i + 1 ) * lineSize + j + 1] = dem[i * xSize + j];
+    }
+  }
+
+  for ( int i = 0; i < ySize; ++i )
+  {
+    float* r1 = padded.data() + i * lineSize;
+    float* r2 = r1 + lineSize;
+    float* r3 = r2 + lineSize;
+    for ( int j = 0; j < xSize; ++j )
+    {
+      float expected = filter.processNineCellWindow( &r1[j], &r1[j+1], &r1[j+2], &r2[j], &r2[j+1], &r2[j+2], &r3[j], &r3[j+1], &r3[j+2] );
+      if ( output[i * xSize + j] != expected )
+      {
+        QFAIL( QString( "cell %1/%2: %3 instead of %4" ).arg( i ).arg( j ).arg( output[i * xSize + j] ).arg( expected ).toLocal8Bit().constData() );
+      }
+    }
+  }
+}
+
+void TestQgsNineCellFilters::slope()
+{
+  QgsSlopeFilter tiled( mTiledDem, mOutput, "GTiff" );
+  QgsSlopeFilter strip( mStripDem, mOutput, "GTiff" );
+  checkFilter( tiled, strip );
+}
+
+void TestQgsNineCellFilters::aspect()
+{
+  QgsAspectFilter tiled( mTiledDem, mOutput, "GTiff" );
+  QgsAspectFilter strip( mStripDem, mOutput, "GTiff" );
+  checkFilter( tiled, strip );
+}
+
+void TestQgsNineCellFilters::hillshade()
+{
+  QgsHillshadeFilter tiled( mTiledDem, mOutput, "GTiff", 315, 45 );
+  QgsHillshadeFilter strip( mStripDem, mOutput, "GTiff", 315, 45 );
+  checkFilter( tiled, strip );
+}
+
+void TestQgsNineCellFilters::ruggedness()
+{
+  QgsRuggednessFilter tiled( mTiledDem, mOutput, "GTiff" );
+  QgsRuggednessFilter strip( mStripDem, mOutput, "GTiff" );
+  checkFilter( tiled, strip );
+}
+
+void TestQgsNineCellFilters::totalCurvature()
+{
+  QgsTotalCurvatureFilter tiled( mTiledDem, mOutput, "GTiff" );
+  QgsTotalCurvatureFilter strip( mStripDem, mOutput, "GTiff" );
+  checkFilter( tiled, strip );
+}
+
+void TestQgsNineCellFilters::tallBlocks()
+{
+  // a wide DEM stored in a single strip, so that one block row holds more cells than a
+  // filter strip and the strips cover parts of it
+  QString tallBlockDem = QDir::tempPath() + QDir::separator() + "qgis_test_ninecell_tallblock.tif";
+  createDem( tallBlockDem, 0, 4000, 250, 250 );
+  QgsSlopeFilter filter( tallBlockDem, mOutput, "GTiff" );
+  QCOMPARE( filter.processRaster( 0 ), 0 );
+  checkOutput( filter, tallBlockDem, mOutput );
+  QFile::remove( tallBlockDem );
+}
+
+QTEST_MAIN( TestQgsNineCellFilters )
+#include "moc_testqgsninecellfilters.cxx"
@@ -0,0 +1,368 @@
+/***************************************************************************
+     testqgsrastercalculator.cpp
+     --------------------------------------
+    Date                 : March 2012
+    Copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QVector>
+
+#include <gdal.h>
+#include <cfloat>
+#include <math.h>
+
+#include <qgsapplication.h>
+#include <qgsproviderregistry.h>
+#include <qgsrasterlayer.h>
+
+//header for class being tested
+#include <qgsrastercalculator.h>
+#include <qgsrastercalcnode.h>
+#include <qgsrastermatrix.h>
+
+/** \ingroup UnitTests
+ * Runs the raster calculator on two generated rasters and compares the output
+ * with the formula calculated on whole raster matrices.
+ */
+class TestQgsRasterCalculator: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void operators();
+    void functions();
+    void comparisons();
+    void combinedFormulas();
+    void nodata();
+    void atanSign();
+    void invalidFormula();
+  private:
+    /** creates a raster with some nodata cells */
+    void createRaster( const QString& fileName, QVector<float>& values, float nodata, int valueStep, int nodataStep );
+    /** runs the raster calculator and reads the output */
+    QVector<float> calculate( const QString& formula );
+    /** calculates the formula with QgsRasterCalcNode on matrices of the inputs */
+    QVector<float> matrixResult( const QString& formula );
+    /** compares the raster calculator output with the matrix result */
+    void checkFormula( const QString& formula );
+    static bool valuesEqual( float value, float expected );
+
+    static const int mXSize = 301;
+    static const int mYSize = 250;
+    QString mRasterA;
+    QString mRasterB;
+    QString mOutput;
+    QVector<float> mA;
+    QVector<float> mB;
+    float mNodataA;
+    float mNodataB;
+    QgsRasterLayer* mLayerA;
+    QgsRasterLayer* mLayerB;
+};
+
+void TestQgsRasterCalculator::initTestCase()
+{
+  QgsApplication::setPrefixPath( INSTALL_PREFIX, true );
+  QgsProviderRegistry::instance( QgsApplication::pluginPath() );
+  GDALAllRegister();
+  mRasterA = QDir::tempPath() + QDir::separator() + "qgis_test_rastercalc_a.tif";
+  mRasterB = QDir::tempPath() + QDir::separator() + "qgis_test_rastercalc_b.tif";
+  mOutput = QDir::tempPath() + QDir::separator() + "qgis_test_rastercalc_output.tif";
+
+  // the inputs have different nodata values and some equal cells
+  mNodataA = -9999;
+  mNodataB = 100;
+  createRaster( mRasterA, mA, mNodataA, 7, 37 );
+  createRaster( mRasterB, mB, mNodataB, 11, 41 );
+  mLayerA = new QgsRasterLayer( mRasterA, "a" );
+  mLayerB = new QgsRasterLayer( mRasterB, "b" );
+  QVERIFY( mLayerA->isValid() );
+  QVERIFY( mLayerB->isValid() );
+}
+
+void TestQgsRasterCalculator::cleanupTestCase()
+{
+  delete mLayerA;
+  delete mLayerB;
+  QFile::remove( mRasterA );
+  QFile::remove( mRasterB );
+  QFile::remove( mOutput );
+}
+
+void TestQgsRasterCalculator::createRaster( const QString& fileName, QVector<float>& values, float nodata, int valueStep, int nodataStep )
+{
+  QFile::remove( fileName );
+  GDALDriverH driver = GDALGetDriverByName( "GTiff" );
+  GDALDatasetH dataset = GDALCreate( driver, fileName.toLocal8Bit().data(), mXSize, mYSize, 1, GDT_Float32, NULL );
+  QVERIFY( dataset );
+
+  double geotransform[6] = { 600000, 10, 0, 200000, 0, -10 };
+  GDALSetGeoTransform( dataset, geotransform );
+  GDALRasterBandH band = GDALGetRasterBand( dataset, 1 );
+  GDALSetRasterNoDataValue( band, nodata );
+
+  // steps of 0.5 between -3 and 3, so that there are zeros, negative values and equal cells in both rasters
+  values.resize( mXSize * mYSize );
+  for ( int i = 0; i < mYSize; ++i )
+  {
+    for ( int j = 0; j < mXSize; ++j )
+    {
+      int index = i * mXSize + j;
+      values[index] = index % nodataStep == 0 ? nodata : (( i * 3 + j * valueStep ) % 13 - 6 ) / 2.0;
+    }
+  }
+  GDALRasterIO( band, GF_Write, 0, 0, mXSize, mYSize, values.data(), mXSize, mYSize, GDT_Float32, 0, 0 );
+  GDALClose( dataset );
+}
+
+QVector<float> TestQgsRasterCalculator::calculate( const QString& formula )
+{
+  QVector<QgsRasterCalculatorEntry> entries;
+  QgsRasterCalculatorEntry entryA;
+  entryA.ref = "a@1";
+  entryA.raster = mLayerA;
+  entryA.bandNumber = 1;
+  entries << entryA;
+  QgsRasterCalculatorEntry entryB;
+  entryB.ref = "b@1";
+  entryB.raster = mLayerB;
+  entryB.bandNumber = 1;
+  entries << entryB;
+
+  QFile::remove( mOutput );
+  QgsRectangle extent( 600000, 200000 - mYSize * 10, 600000 + mXSize * 10, 200000 );
+  QgsRasterCalculator calculator( formula, mOutput, "GTiff", extent, mXSize, mYSize, entries );
+
+  QVector<float> values;
+  if ( calculator.processCalculation( 0 ) != 0 )
+  {
+    return values;
+  }
+
+  GDALDatasetH dataset = GDALOpen( mOutput.toLocal8Bit().data(), GA_ReadOnly );
+  if ( !dataset )
+  {
+    return values;
+  }
+  values.resize( mXSize * mYSize );
+  GDALRasterIO( GDALGetRasterBand( dataset, 1 ), GF_Read, 0, 0, mXSize, mYSize, values.data(), mXSize, mYSize, GDT_Float32, 0, 0 );
+  GDALClose( dataset );
+  return values;
+}
+
+QVector<float> TestQgsRasterCalculator::matrixResult( const QString& formula )
+{
+  QVector<float> values;
+  QString errorString;
+  QgsRasterCalcNode* node = QgsRasterCalcNode::parseRasterCalcString( formula, errorString );
+  if ( !node )
+  {
+    return values;
+  }
+
+  // the matrices take ownership of the data
+  float* dataA = new float[mA.size()];
+  memcpy( dataA, mA.constData(), mA.size() * sizeof( float ) );
+  float* dataB = new float[mB.size()];
+  memcpy( dataB, mB.constData(), mB.size() * sizeof( float ) );
+  QgsRasterMatrix matrixA( mXSize, mYSize, dataA, mNodataA );
+  QgsRasterMatrix matrixB( mXSize, mYSize, dataB, mNodataB );
+  QMap<QString, QgsRasterMatrix*> rasterData;
+  rasterData.insert( "a@1", &matrixA );
+  rasterData.insert( "b@1", &matrixB );
+
+  QgsRasterMatrix result;
+  bool ok = node->calculate( rasterData, result );
+  delete node;
+  if ( !ok )
+  {
+    return values;
+  }
+
+  // a scalar result is used for every cell, matrix nodata values become the output nodata value
+  values.resize( mXSize * mYSize );
+  for ( int i = 0; i < values.size(); ++i )
+  {
+    float value = result.isNumber() ? result.number() : result.data()[i];
+    values[i] = value == result.nodataValue() ? -FLT_MAX : value;
+  }
+  return values;
+}
+
+bool TestQgsRasterCalculator::valuesEqual( float value, float expected )
+{
+  if ( value == expected )
+  {
+    return true;
+  }
+  if ( value != value && expected != expected ) // both NaN
+  {
+    return true;
+  }
+  return fabs( value - expected ) <= 1e-6 * qMax( 1.0f, ( float )fabs( expected ) );
+}
+
+void TestQgsRasterCalculator::checkFormula( const QString& formula )
+{
+  QVector<float> expected = matrixResult( formula );
+  QVector<float> output = calculate( formula );
+  QCOMPARE( expected.size(), mXSize * mYSize );
+  QCOMPARE( output.size(), mXSize * mYSize );
+
+  for ( int i = 0; i < output.size(); ++i )
+  {
+    if ( !valuesEqual( output[i], expected[i] ) )
+    {
+      QFAIL( QString( "%1, cell %2/%3: %4 instead of %5" ).arg( formula ).arg( i / mXSize ).arg( i % mXSize )
+             .arg( output[i], 0, 'g', 9 ).arg( expected[i], 0, 'g', 9 ).toLocal8Bit().constData() );
+    }
+  }
+}
+
+void TestQgsRasterCalculator::operators()
+{
+  QStringList formulas;
+  formulas << "a@1 + b@1" << "a@1 - b@1" << "a@1 * b@1" << "a@1 / b@1" << "a@1 ^ b@1"
+  << "a@1 + 2.5" << "2.5 - a@1" << "a@1 * -3" << "10 / b@1" << "b@1 / 0.5" << "a@1 ^ 2" << "2 ^ b@1" << "a@1 ^ 0.5"
+  << "a@1 AND b@1" << "a@1 OR b@1" << "a@1 AND 0" << "1 OR b@1" << "-a@1" << "- (a@1 - b@1)";
+  foreach( QString formula, formulas )
+  {
+    checkFormula( formula );
+  }
+}
+
+void TestQgsRasterCalculator::functions()
+{
+  QStringList formulas;
+  formulas << "sqrt(a@1)" << "sin(a@1)" << "cos(b@1)" << "tan(a@1)"
+  << "asin(a@1 / 3)" << "acos(b@1 / 3)" << "asin(a@1)" << "acos(b@1)" << "atan(b@1)";
+  foreach( QString formula, formulas )
+  {
+    checkFormula( formula );
+  }
+}
+
+void TestQgsRasterCalculator::comparisons()
+{
+  QStringList formulas;
+  formulas << "a@1 = b@1" << "a@1 != b@1" << "a@1 > b@1" << "a@1 < b@1" << "a@1 >= b@1" << "a@1 <= b@1"
+  << "a@1 = 0" << "0 < b@1" << "a@1 >= 1.5" << "-1 <= b@1" << "a@1 > 0 AND b@1 < 0" << "a@1 = 0 OR b@1 = 0";
+  foreach( QString formula, formulas )
+  {
+    checkFormula( formula );
+  }
+
+  // comparisons give 1 or 0
+  QVector<float> output = calculate( "a@1 > b@1" );
+  QCOMPARE( output.size(), mXSize * mYSize );
+  for ( int i = 0; i < output.size(); ++i )
+  {
+    if ( mA[i] != mNodataA && mB[i] != mNodataB )
+    {
+      QCOMPARE( output[i], mA[i] > mB[i] ? 1.0f : 0.0f );
+    }
+  }
+}
+
+void TestQgsRasterCalculator::combinedFormulas()
+{
+  QStringList formulas;
+  formulas << "10 - a@1 * 2 + b@1 / 4" << "(a@1 + 1) * (b@1 - 1)" << "sqrt(a@1 * a@1 + b@1 * b@1)"
+  << "(a@1 > b@1) * a@1 + (a@1 <= b@1) * b@1" << "sin(a@1) ^ 2 + cos(a@1) ^ 2" << "atan(a@1 / b@1) * 2"
+  << "1 + 2 * 3" << "sqrt(16) * a@1" << "b@1 - (2 ^ 3 - 8)";
+  foreach( QString formula, formulas )
+  {
+    checkFormula( formula );
+  }
+}
+
+void TestQgsRasterCalculator::nodata()
+{
+  // a nodata cell in any input gives a nodata output cell
+  QVector<float> output = calculate( "a@1 + b@1" );
+  QCOMPARE( output.size(), mXSize * mYSize );
+
+  GDALDatasetH dataset = GDALOpen( mOutput.toLocal8Bit().data(), GA_ReadOnly );
+  QVERIFY( dataset );
+  int hasNodata = 0;
+  double outputNodata = GDALGetRasterNoDataValue( GDALGetRasterBand( dataset, 1 ), &hasNodata );
+  GDALClose( dataset );
+  QVERIFY( hasNodata );
+  QCOMPARE(( float )outputNodata, -FLT_MAX );
+
+  int nodataCount = 0;
+  for ( int i = 0; i < output.size(); ++i )
+  {
+    if ( mA[i] == mNodataA || mB[i] == mNodataB )
+    {
+      QCOMPARE( output[i], -FLT_MAX );
+      ++nodataCount;
+    }
+    else
+    {
+      QCOMPARE( output[i], mA[i] + mB[i] );
+    }
+  }
+  QVERIFY( nodataCount > 0 );
+
+  // also for functions and operations with numbers
+  output = calculate( "sin(a@1) * 2" );
+  QCOMPARE( output.size(), mXSize * mYSize );
+  for ( int i = 0; i < output.size(); ++i )
+  {
+    if ( mA[i] == mNodataA )
+    {
+      QCOMPARE( output[i], -FLT_MAX );
+    }
+  }
+}
+
+void TestQgsRasterCalculator::atanSign()
+{
+  checkFormula( "atan(a@1)" );
+
+  // atan used to change the sign of the result
+  QVector<float> output = calculate( "atan(a@1)" );
+  QCOMPARE( output.size(), mXSize * mYSize );
+  int positiveCount = 0;
+  for ( int i = 0; i < output.size(); ++i )
+  {
+    if ( mA[i] == mNodataA )
+    {
+      continue;
+    }
+    QVERIFY( valuesEqual( output[i], ::atan( mA[i] ) ) );
+    if ( mA[i] > 0 )
+    {
+      QVERIFY( output[i] > 0 );
+      ++positiveCount;
+    }
+  }
+  QVERIFY( positiveCount > 0 );
+}
+
+void TestQgsRasterCalculator::invalidFormula()
+{
+  // a formula that does not parse and one with an unknown raster reference fail without an output file
+  QVERIFY( calculate( "a@1 +" ).isEmpty() );
+  QVERIFY( !QFile::exists( mOutput ) );
+  QVERIFY( calculate( "a@1 + c@1" ).isEmpty() );
+  QVERIFY( !QFile::exists( mOutput ) );
+}
+
+QTEST_MAIN( TestQgsRasterCalculator )
+#include "moc_testqgsrastercalculator.cxx"
@@ -17,7 +17,10 @@ Email                : sherman at mrcc dot com
 //header for class being tested
 #include <qgsgeometryanalyzer.h>
 #include <qgsapplication.h>
+#include <qgsfeature.h>
+#include <qgsgeometry.h>
 #include <qgsproviderregistry.h>
+#include <qgsvectorlayer.h>
 
 class TestQgsVectorAnalyzer: public QObject
 {
@@ -36,7 +39,13 @@ class TestQgsVectorAnalyzer: public QObject
     void simplifyGeometry(  );
     void polygonCentroids(  );
     void layerExtent(  );
+    void dissolvePolygons(  );
+    void bufferDissolve(  );
   private:
+    /** unites the (buffered) geometries of a layer one after the other, without the cascaded union */
+    QgsGeometry* pairwiseUnion( QgsVectorLayer* layer, double bufferDistance );
+    /** checks that the output layer has a single feature that covers the same area as the pairwise union */
+    void checkDissolved( const QString& fileName, QgsGeometry* expected );
     QgsGeometryAnalyzer mAnalyzer;
     QgsVectorLayer * mpLineLayer;
     QgsVectorLayer * mpPolyLayer;
@@ -135,6 +144,79 @@ void TestQgsVectorAnalyzer::layerExtent(  )
   QVERIFY( mAnalyzer.extent( mpPointLayer, myFileName ) );
 }
 
+QgsGeometry* TestQgsVectorAnalyzer::pairwiseUnion( QgsVectorLayer* layer, double bufferDistance )
+{
+  QgsGeometry* result = 0;
+  QgsFeature feature;
+  QgsFeatureIterator fit = layer->getFeatures();
+  while ( fit.nextFeature( feature ) )
+  {
+    if ( !feature.geometry() )
+    {
+      continue;
+    }
+    QgsGeometry* geometry = bufferDistance > 0 ? feature.geometry()->buffer( bufferDistance, 5 ) : new QgsGeometry( *feature.geometry() );
+    if ( !result )
+    {
+      result = geometry;
+      continue;
+    }
+    QgsGeometry* merged = result->combine( geometry );
+    delete result;
+    delete geometry;
+    result = merged;
+    if ( !result )
+    {
+      return 0;
+    }
+  }
+  return result;
+}
+
+void TestQgsVectorAnalyzer::checkDissolved( const QString& fileName, QgsGeometry* expected )
+{
+  QVERIFY( expected );
+  QgsVectorLayer myLayer( fileName, QFileInfo( fileName ).completeBaseName(), "ogr" );
+  QVERIFY( myLayer.isValid() );
+  QCOMPARE( myLayer.featureCount(), 1L );
+
+  QgsFeature myFeature;
+  QgsFeatureIterator fit = myLayer.getFeatures();
+  QVERIFY( fit.nextFeature( myFeature ) );
+  QVERIFY( myFeature.geometry() );
+
+  // the merge order differs, so the vertices may differ slightly, but not the covered area
+  double myExpectedArea = expected->area();
+  QVERIFY( myExpectedArea > 0 );
+  QVERIFY( qAbs( myFeature.geometry()->area() - myExpectedArea ) <= 1e-6 * myExpectedArea );
+  QgsGeometry* myDifference = myFeature.geometry()->symDifference( expected );
+  QVERIFY( myDifference );
+  QVERIFY( myDifference->area() <= 1e-6 * myExpectedArea );
+  delete myDifference;
+}
+
+void TestQgsVectorAnalyzer::dissolvePolygons(  )
+{
+  QString myTmpDir = QDir::tempPath() + QDir::separator() ;
+  QString myFileName = myTmpDir +  "dissolve_layer.shp";
+  QVERIFY( mAnalyzer.dissolve( mpPolyLayer, myFileName ) );
+
+  QgsGeometry* myExpected = pairwiseUnion( mpPolyLayer, 0.0 );
+  checkDissolved( myFileName, myExpected );
+  delete myExpected;
+}
+
+void TestQgsVectorAnalyzer::bufferDissolve(  )
+{
+  QString myTmpDir = QDir::tempPath() + QDir::separator() ;
+  QString myFileName = myTmpDir +  "buffer_dissolve_layer.shp";
+  QVERIFY( mAnalyzer.buffer( mpPointLayer, myFileName, 1.0, false, true ) );
+
+  QgsGeometry* myExpected = pairwiseUnion( mpPointLayer, 1.0 );
+  checkDissolved( myFileName, myExpected );
+  delete myExpected;
+}
+
 QTEST_MAIN( TestQgsVectorAnalyzer )
 #include "moc_testqgsvectoranalyzer.cxx"
 
@@ -0,0 +1,137 @@
+/***************************************************************************
+     testqgsclassifiedrenderers.cpp
+     --------------------------------------
+    Date                 : March 2012
+    Copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+
+#include <limits>
+
+//header for class being tested
+#include <qgscategorizedsymbolrendererv2.h>
+#include <qgsgraduatedsymbolrendererv2.h>
+#include <qgssymbolv2.h>
+
+// expose the lookups of the renderers
+class TestCategorizedRenderer : public QgsCategorizedSymbolRendererV2
+{
+  public:
+    TestCategorizedRenderer( QgsCategoryList categories )
+        : QgsCategorizedSymbolRendererV2( "attr", categories ) { rebuildHash(); }
+    QgsSymbolV2* symbol( QVariant value ) { return symbolForValue( value ); }
+    QgsSymbolV2* category( int i ) { return mCategories[i].symbol(); }
+};
+
+class TestGraduatedRenderer : public QgsGraduatedSymbolRendererV2
+{
+  public:
+    TestGraduatedRenderer( QgsRangeList ranges )
+        : QgsGraduatedSymbolRendererV2( "attr", ranges ) { rebuildSortedRanges(); }
+    QgsSymbolV2* symbol( double value ) { return symbolForValue( value ); }
+    QgsSymbolV2* range( int i ) { return mRanges[i].symbol(); }
+    bool binarySearch() const { return mSortedRangesValid; }
+    void linearSearch() { mSortedRangesValid = false; }
+};
+
+class TestQgsClassifiedRenderers: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void categorizedTypedLookup();
+    void graduatedBinarySearch();
+    void graduatedSharedBounds();
+    void graduatedOverlappingRanges();
+
+  private:
+    QgsSymbolV2* marker() { return QgsMarkerSymbolV2::createSimple( QgsStringMap() ); }
+};
+
+void TestQgsClassifiedRenderers::categorizedTypedLookup()
+{
+  QgsCategoryList categories;
+  categories << QgsRendererCategoryV2( 5, marker(), "int" );
+  categories << QgsRendererCategoryV2( 2.5, marker(), "double" );
+  categories << QgsRendererCategoryV2( "7", marker(), "string of int" );
+  categories << QgsRendererCategoryV2( "abc", marker(), "string" );
+  categories << QgsRendererCategoryV2( "", marker(), "default" );
+  TestCategorizedRenderer r( categories );
+
+  QCOMPARE( r.symbol( 5 ), r.category( 0 ) );
+  QCOMPARE( r.symbol( QVariant( qlonglong( 5 ) ) ), r.category( 0 ) );
+  QCOMPARE( r.symbol( "5" ), r.category( 0 ) );
+  QCOMPARE( r.symbol( 5.0 ), r.category( 0 ) );
+  QCOMPARE( r.symbol( 2.5 ), r.category( 1 ) );
+  QCOMPARE( r.symbol( "2.5" ), r.category( 1 ) );
+  QCOMPARE( r.symbol( 7 ), r.category( 2 ) );
+  QCOMPARE( r.symbol( "abc" ), r.category( 3 ) );
+  QCOMPARE( r.symbol( QVariant() ), r.category( 4 ) );
+
+  QVERIFY( !r.symbol( 6 ) );
+  QVERIFY( !r.symbol( 2.75 ) );
+  QVERIFY( !r.symbol( "07" ) );
+}
+
+void TestQgsClassifiedRenderers::graduatedBinarySearch()
+{
+  // ranges not in order and with a gap and an invalid range
+  QgsRangeList ranges;
+  ranges << QgsRendererRangeV2( 20, 30, marker(), "c" );
+  ranges << QgsRendererRangeV2( 0, 10, marker(), "a" );
+  ranges << QgsRendererRangeV2( 12, 20, marker(), "b" );
+  ranges << QgsRendererRangeV2( 50, 40, marker(), "invalid" );
+  TestGraduatedRenderer r( ranges );
+  QVERIFY( r.binarySearch() );
+
+  QCOMPARE( r.symbol( 0 ), r.range( 1 ) );
+  QCOMPARE( r.symbol( 5 ), r.range( 1 ) );
+  QCOMPARE( r.symbol( 10 ), r.range( 1 ) );
+  QVERIFY( !r.symbol( 11 ) );
+  QCOMPARE( r.symbol( 15 ), r.range( 2 ) );
+  QCOMPARE( r.symbol( 30 ), r.range( 0 ) );
+  QVERIFY( !r.symbol( -1 ) );
+  QVERIFY( !r.symbol( 45 ) );
+  QVERIFY( !r.symbol( std::numeric_limits<double>::quiet_NaN() ) );
+}
+
+void TestQgsClassifiedRenderers::graduatedSharedBounds()
+{
+  // a value on a shared bound belongs to the range that comes first in the list
+  QgsRangeList ranges;
+  ranges << QgsRendererRangeV2( 20, 30, marker(), "c" );
+  ranges << QgsRendererRangeV2( 10, 20, marker(), "b" );
+  ranges << QgsRendererRangeV2( 0, 10, marker(), "a" );
+  ranges << QgsRendererRangeV2( 10, 10, marker(), "empty" );
+  TestGraduatedRenderer r( ranges );
+  QVERIFY( r.binarySearch() );
+
+  QCOMPARE( r.symbol( 20 ), r.range( 0 ) );
+  QCOMPARE( r.symbol( 10 ), r.range( 1 ) );
+
+  r.linearSearch();
+  QCOMPARE( r.symbol( 20 ), r.range( 0 ) );
+  QCOMPARE( r.symbol( 10 ), r.range( 1 ) );
+}
+
+void TestQgsClassifiedRenderers::graduatedOverlappingRanges()
+{
+  QgsRangeList ranges;
+  ranges << QgsRendererRangeV2( 0, 20, marker(), "a" );
+  ranges << QgsRendererRangeV2( 10, 30, marker(), "b" );
+  TestGraduatedRenderer r( ranges );
+  QVERIFY( !r.binarySearch() );
+
+  QCOMPARE( r.symbol( 15 ), r.range( 0 ) );
+  QCOMPARE( r.symbol( 25 ), r.range( 1 ) );
+}
+
+QTEST_MAIN( TestQgsClassifiedRenderers )
+#include "moc_testqgsclassifiedrenderers.cxx"
@@ -22,6 +22,7 @@ Email                : sherman at mrcc dot com
 
 //header for class being tested
 #include <qgscoordinatereferencesystem.h>
+#include <qgscrscatalogue.h>
 
 class TestQgsCoordinateReferenceSystem: public QObject
 {
@@ -38,6 +39,8 @@ class TestQgsCoordinateReferenceSystem: public QObject
     void createFromWkt();
     void createFromSrsId();
     void createFromProj4();
+    void createFromProj4Reordered();
+    void catalogueLookups();
     void isValid();
     void validate();
     void findMatchingProj();
@@ -139,6 +142,43 @@ void TestQgsCoordinateReferenceSystem::createFromProj4()
   QVERIFY( myCrs.createFromProj4( "+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs" ) );
   debugPrint( myCrs );
 }
+void TestQgsCoordinateReferenceSystem::createFromProj4Reordered()
+{
+  QgsCoordinateReferenceSystem myCrs;
+  QVERIFY( myCrs.createFromProj4( "+no_defs +towgs84=0,0,0 +datum=WGS84 +ellps=WGS84 +proj=longlat" ) );
+  QCOMPARE( myCrs.authid(), QString( "EPSG:4326" ) );
+  QCOMPARE( myCrs.srsid(), ( long ) GEOCRS_ID );
+}
+void TestQgsCoordinateReferenceSystem::catalogueLookups()
+{
+  QgsCRSCatalogue* myCatalogue = QgsCRSCatalogue::instance();
+  QgsCRSCatalogue::Record myRecord;
+
+  QVERIFY( myCatalogue->recordByAuthId( "epsg:4326", myRecord ) );
+  QCOMPARE( myRecord.srid, 4326L );
+  QCOMPARE( myRecord.srsId, ( long ) GEOCRS_ID );
+  QVERIFY( myRecord.isGeo );
+
+  QVERIFY( myCatalogue->recordBySrid( 4326, myRecord ) );
+  QCOMPARE( myRecord.authId, QString( "EPSG:4326" ) );
+
+  QVERIFY( myCatalogue->recordBySrsId( GEOCRS_ID, myRecord ) );
+  QCOMPARE( myRecord.srid, 4326L );
+  QVERIFY( !myCatalogue->recordBySrsId( -1, myRecord ) );
+
+  QList<QgsCRSCatalogue::Record> myRecords = myCatalogue->recordsByAcronyms( "longlat", "WGS84" );
+  bool myFound = false;
+  foreach( QgsCRSCatalogue::Record myAcronymRecord, myRecords )
+  {
+    myFound = myFound || myAcronymRecord.srsId == GEOCRS_ID;
+  }
+  QVERIFY( myFound );
+
+  // the catalogue is read again after an invalidation
+  myCatalogue->invalidate();
+  QVERIFY( myCatalogue->recordByAuthId( "EPSG:4326", myRecord ) );
+  QCOMPARE( myRecord.srsId, ( long ) GEOCRS_ID );
+}
 void TestQgsCoordinateReferenceSystem::isValid()
 {
   QgsCoordinateReferenceSystem myCrs;
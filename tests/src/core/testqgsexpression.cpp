@@ -145,6 +145,7 @@ class TestQgsExpression: public QObject
       QTest::newRow( "pow" ) << "2^8" << false << QVariant( 256. );
       QTest::newRow( "division by zero" ) << "1/0" << false << QVariant();
       QTest::newRow( "division by zero" ) << "1.0/0.0" << false << QVariant();
+      QTest::newRow( "int mod by zero" ) << "5%0" << false << QVariant();
 
       // comparison
       QTest::newRow( "eq int" ) << "1+1 = 2" << false << QVariant( 1 );
@@ -464,6 +465,326 @@ class TestQgsExpression: public QObject
       QVariant vPerimeter = exp3.evaluate( &fPolygon );
       QCOMPARE( vPerimeter.toDouble(), 20. );
     }
+
+    void evaluation_compiled_data()
+    {
+      evaluation_data();
+    }
+
+    void evaluation_compiled()
+    {
+      // the same results as with the node tree, the constant expressions are folded on prepare
+      QFETCH( QString, string );
+      QFETCH( bool, evalError );
+      QFETCH( QVariant, result );
+
+      QgsExpression exp( string );
+      QCOMPARE( exp.hasParserError(), false );
+      QCOMPARE( exp.prepare( QgsFieldMap() ), true );
+      QCOMPARE( exp.isCompiled(), true );
+
+      QVariant res = exp.evaluate();
+      QCOMPARE( exp.hasEvalError(), evalError );
+      QCOMPARE( res.type(), result.type() );
+      if ( res.type() == QVariant::Double )
+        QCOMPARE( res.toDouble(), result.toDouble() );
+      else
+        QCOMPARE( res, result );
+    }
+
+    void eval_compiled_columns_data()
+    {
+      QTest::addColumn<QString>( "string" );
+
+      QTest::newRow( "plus" ) << "i + 1";
+      QTest::newRow( "mixed mul" ) << "i * d";
+      QTest::newRow( "int div by zero" ) << "i / 0";
+      QTest::newRow( "double div by zero" ) << "d / 0";
+      QTest::newRow( "mod" ) << "i % 3";
+      QTest::newRow( "pow" ) << "i ^ 2";
+      QTest::newRow( "text arithmetics" ) << "n + 1";
+      QTest::newRow( "invalid arithmetics" ) << "i + s";
+      QTest::newRow( "null arithmetics" ) << "z + 1";
+      QTest::newRow( "constant subexpression" ) << "1 + 2 * i";
+      QTest::newRow( "minus int" ) << "-i";
+      QTest::newRow( "minus double" ) << "-d";
+      QTest::newRow( "minus text" ) << "-s";
+      QTest::newRow( "minus null" ) << "-z";
+      QTest::newRow( "not int" ) << "not i";
+      QTest::newRow( "not null" ) << "not z";
+      QTest::newRow( "not text" ) << "not s";
+      QTest::newRow( "eq" ) << "i = 5";
+      QTest::newRow( "gt mixed" ) << "i > d";
+      QTest::newRow( "eq text" ) << "s = 'abc'";
+      QTest::newRow( "eq numeric text" ) << "n = 12";
+      QTest::newRow( "lt text number" ) << "s < i";
+      QTest::newRow( "eq null" ) << "z = 1";
+      QTest::newRow( "is null" ) << "z is null";
+      QTest::newRow( "is not null" ) << "i is not null";
+      QTest::newRow( "is mixed" ) << "i is d";
+      QTest::newRow( "is text" ) << "s is 'abc'";
+      QTest::newRow( "and" ) << "i = 5 and d < 3";
+      QTest::newRow( "or unknown" ) << "z = 1 or i = 5";
+      QTest::newRow( "and unknown" ) << "z = 1 and i = 6";
+      QTest::newRow( "invalid and" ) << "s and 1";
+      QTest::newRow( "in" ) << "i in (1, 5, 7)";
+      QTest::newRow( "in with null" ) << "i in (1, z, 7)";
+      QTest::newRow( "in null" ) << "z in (1, 2)";
+      QTest::newRow( "in text" ) << "s in ('x', 'abc')";
+      QTest::newRow( "in numeric text" ) << "n in (11, 12)";
+      QTest::newRow( "not in" ) << "i not in (z, 5)";
+      QTest::newRow( "not in unknown" ) << "i not in (z, 6)";
+      QTest::newRow( "like" ) << "s like 'a%'";
+      QTest::newRow( "ilike" ) << "s ilike 'A_C'";
+      QTest::newRow( "regexp" ) << "s ~ 'b'";
+      QTest::newRow( "like number" ) << "i like '5'";
+      QTest::newRow( "like null pattern" ) << "s like z";
+      QTest::newRow( "like column pattern" ) << "'abcd' like s || '%'";
+      QTest::newRow( "like null" ) << "z like 'a%'";
+      QTest::newRow( "concat" ) << "s || i";
+      QTest::newRow( "concat null" ) << "s || z";
+      QTest::newRow( "function" ) << "length(s) + i";
+      QTest::newRow( "function double" ) << "sqrt(i - 1)";
+      QTest::newRow( "function null" ) << "sqrt(z)";
+      QTest::newRow( "function null first" ) << "substr(z, 1, sqrt('a'))";
+      QTest::newRow( "invalid function" ) << "sqrt(s)";
+      QTest::newRow( "conversion" ) << "toint(n) * 2";
+      QTest::newRow( "text functions" ) << "upper(s) || lower('X')";
+      QTest::newRow( "regexp_replace" ) << "regexp_replace(s, 'b', 'x')";
+      QTest::newRow( "condition" ) << "case when i > 3 then 'big' else 'small' end";
+      QTest::newRow( "condition null" ) << "case when z then 1 end";
+      QTest::newRow( "condition 2 when" ) << "case when i > 5 then 1 when d > 2 then 2 else 3 end";
+      QTest::newRow( "invalid condition" ) << "case when s then 1 end";
+      QTest::newRow( "feature id" ) << "$id + i";
+      QTest::newRow( "row number" ) << "$rownum + 1";
+    }
+
+    void eval_compiled_columns()
+    {
+      // the compiled program gives the same results as the node tree
+      QFETCH( QString, string );
+
+      QgsFieldMap fields;
+      fields[0] = QgsField( "i", QVariant::Int );
+      fields[1] = QgsField( "d", QVariant::Double );
+      fields[2] = QgsField( "s", QVariant::String );
+      fields[3] = QgsField( "n", QVariant::String );
+      fields[4] = QgsField( "z", QVariant::Int );
+
+      QgsFeature f( 100 );
+      f.addAttribute( 0, QVariant( 5 ) );
+      f.addAttribute( 1, QVariant( 2.5 ) );
+      f.addAttribute( 2, QVariant( "abc" ) );
+      f.addAttribute( 3, QVariant( "12" ) );
+      f.addAttribute( 4, QVariant( QVariant::Int ) );
+
+      QgsExpression interpreted( string );
+      interpreted.setCompilationEnabled( false );
+      QCOMPARE( interpreted.prepare( fields ), true );
+      QCOMPARE( interpreted.isCompiled(), false );
+      QVariant expected = interpreted.evaluate( &f );
+
+      QgsExpression compiled( string );
+      QCOMPARE( compiled.prepare( fields ), true );
+      QCOMPARE( compiled.isCompiled(), true );
+
+      // twice, the program reuses its stack
+      for ( int i = 0; i < 2; ++i )
+      {
+        QVariant res = compiled.evaluate( &f );
+        QCOMPARE( compiled.hasEvalError(), interpreted.hasEvalError() );
+        QCOMPARE( compiled.evalErrorString(), interpreted.evalErrorString() );
+        QCOMPARE( res.type(), expected.type() );
+        QCOMPARE( res.isNull(), expected.isNull() );
+        QCOMPARE( res, expected );
+      }
+    }
+
+    void eval_block_data()
+    {
+      eval_compiled_columns_data();
+      QTest::newRow( "mod by zero" ) << "z % i";
+      QTest::newRow( "double by null" ) << "d / z";
+      QTest::newRow( "int compare" ) << "i <= z";
+      QTest::newRow( "double compare" ) << "d >= i";
+      QTest::newRow( "is null double" ) << "d is null";
+      QTest::newRow( "not compare" ) << "not (i > 0)";
+      QTest::newRow( "column" ) << "z";
+      QTest::newRow( "constant" ) << "'x'";
+      QTest::newRow( "nested condition" ) << "case when i > 0 then i * 2 when z is null then sqrt(d) else i || s end";
+      QTest::newRow( "function in condition" ) << "case when s = '5' then toint(s) + i else length(s) end";
+      QTest::newRow( "in columns" ) << "i in (z, d, n)";
+      QTest::newRow( "invalid rows" ) << "toint(n) + i";
+    }
+
+    void eval_block()
+    {
+      // evaluating a block gives the same results as evaluating the rows one by one
+      QFETCH( QString, string );
+
+      QgsFieldMap fields;
+      fields[0] = QgsField( "i", QVariant::Int );
+      fields[1] = QgsField( "d", QVariant::Double );
+      fields[2] = QgsField( "s", QVariant::String );
+      fields[3] = QgsField( "n", QVariant::String );
+      fields[4] = QgsField( "z", QVariant::Int );
+
+      QVariantList i, d, s, n, z;
+      i << 5 << 0 << -7 << QVariant( QVariant::Int );
+      d << 2.5 << 0.0 << QVariant( QVariant::Double ) << 1e10;
+      s << "abc" << "5" << QVariant( QVariant::String ) << "";
+      n << "12" << "x" << "1.5" << "12";
+      z << QVariant( QVariant::Int ) << 3 << QVariant( QVariant::Int ) << 0;
+
+      QgsFeatureList features;
+      for ( int row = 0; row < i.count(); ++row )
+      {
+        QgsFeature f( 100 + row );
+        f.addAttribute( 0, i[row] );
+        f.addAttribute( 1, d[row] );
+        f.addAttribute( 2, s[row] );
+        f.addAttribute( 3, n[row] );
+        f.addAttribute( 4, z[row] );
+        features << f;
+      }
+
+      QgsExpression interpreted( string );
+      interpreted.setCompilationEnabled( false );
+      QVERIFY( interpreted.prepare( fields ) );
+
+      for ( int compiled = 0; compiled < 2; ++compiled )
+      {
+        QgsExpression exp( string );
+        exp.setCompilationEnabled( compiled );
+        QVERIFY( exp.prepare( fields ) );
+        exp.setCurrentRowNumber( 10 );
+
+        QgsExpressionColumn res = exp.evaluate( QgsExpressionBlock( features, fields.keys() ) );
+        QCOMPARE( res.count(), features.count() );
+        QCOMPARE( exp.currentRowNumber(), 10 );
+
+        QString error;
+        for ( int row = 0; row < features.count(); ++row )
+        {
+          interpreted.setCurrentRowNumber( 10 + row );
+          QVariant expected = interpreted.evaluate( &features[row] );
+          if ( interpreted.hasEvalError() )
+          {
+            if ( error.isNull() )
+              error = interpreted.evalErrorString();
+            QVERIFY( res.isNull( row ) );
+            continue;
+          }
+          QCOMPARE( res.value( row ).type(), expected.type() );
+          QCOMPARE( res.isNull( row ), expected.isNull() );
+          QCOMPARE( res.value( row ), expected );
+        }
+        QCOMPARE( exp.evalErrorString(), error );
+      }
+    }
+
+    void eval_block_columns()
+    {
+      // a block of columns without features
+      QgsFieldMap fields;
+      fields[0] = QgsField( "a", QVariant::Int );
+      fields[1] = QgsField( "b", QVariant::Double );
+
+      QVector<QVariant> a, b;
+      a << 1 << 2 << QVariant() << 4;
+      b << 0.5 << QVariant( QVariant::Double ) << 1.5 << 2.0;
+
+      QgsExpressionBlock block( 4 );
+      block.setColumn( 0, QgsExpressionColumn::fromValues( a ) );
+      block.setColumn( 1, QgsExpressionColumn::fromValues( b ) );
+      QCOMPARE( block.column( 0 ).type(), QgsExpressionColumn::Int );
+      QCOMPARE( block.column( 1 ).type(), QgsExpressionColumn::Double );
+      QCOMPARE( block.column( 1 ).value( 1 ), QVariant( QVariant::Double ) );
+      QVERIFY( !block.feature( 0 ) );
+
+      QgsExpression exp( "a * b + $rownum" );
+      QVERIFY( exp.prepare( fields ) );
+      exp.setCurrentRowNumber( 1 );
+      QgsExpressionColumn res = exp.evaluate( block );
+      QVERIFY( !exp.hasEvalError() );
+      QCOMPARE( res.value( 0 ), QVariant( 1.5 ) );
+      QVERIFY( res.isNull( 1 ) );
+      QVERIFY( res.isNull( 2 ) );
+      QCOMPARE( res.value( 3 ), QVariant( 12.0 ) );
+    }
+
+    void benchmark_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::addColumn<bool>( "compiled" );
+      QTest::addColumn<bool>( "block" );
+
+      // typical filters of rule-based renderers and expressions of the field calculator
+      QStringList expressions;
+      expressions << "population > 100000"
+      << "type = 'residential' and area >= 50.5"
+      << "type in ('residential', 'commercial', 'industrial')"
+      << "name like 'North%' or name ilike '%street'"
+      << "area * 2 + population / 3 - 1"
+      << "case when population > 100000 then 'city' when population > 1000 then 'town' else 'village' end"
+      << "upper(name) || ' (' || tostring(population) || ')'"
+      << "sqrt(area) > 10 and not (population is null)"
+      << "1 + 2 * 3 = 7 and population > 10 * 1000";
+
+      foreach( QString expression, expressions )
+      {
+        QTest::newRow(( expression + " [tree]" ).toAscii().constData() ) << expression << false << false;
+        QTest::newRow(( expression + " [compiled]" ).toAscii().constData() ) << expression << true << false;
+        QTest::newRow(( expression + " [block]" ).toAscii().constData() ) << expression << true << true;
+      }
+    }
+
+    void benchmark()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, compiled );
+      QFETCH( bool, block );
+
+      QgsFieldMap fields;
+      fields[0] = QgsField( "population", QVariant::Int );
+      fields[1] = QgsField( "area", QVariant::Double );
+      fields[2] = QgsField( "type", QVariant::String );
+      fields[3] = QgsField( "name", QVariant::String );
+
+      QList<QgsFeature> features;
+      for ( int i = 0; i < 1000; ++i )
+      {
+        QgsFeature f( i );
+        f.addAttribute( 0, QVariant( i * 397 ) );
+        f.addAttribute( 1, QVariant( i * 0.75 ) );
+        f.addAttribute( 2, QVariant( i % 3 == 0 ? "residential" : "park" ) );
+        f.addAttribute( 3, QVariant( QString( "North %1 street" ).arg( i ) ) );
+        features << f;
+      }
+
+      QgsExpression exp( string );
+      exp.setCompilationEnabled( compiled );
+      QVERIFY( exp.prepare( fields ) );
+
+      if ( block )
+      {
+        QBENCHMARK
+        {
+          exp.evaluate( QgsExpressionBlock( features, fields.keys() ) );
+        }
+      }
+      else
+      {
+        QBENCHMARK
+        {
+          for ( int i = 0; i < features.count(); ++i )
+          {
+            exp.evaluate( &features[i] );
+          }
+        }
+      }
+      QVERIFY( !exp.hasEvalError() );
+    }
 };
 
 QTEST_MAIN( TestQgsExpression )
@@ -0,0 +1,129 @@
+/***************************************************************************
+     testqgsfeature.cpp
+     --------------------------------------
+    Date                 : March 2012
+    Copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+
+//header for class being tested
+#include <qgsfeature.h>
+
+class TestQgsFeature: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void attributes();
+    void attributeMap();
+    void mapKeptUpToDate();
+    void initAttributes();
+    void copies();
+};
+
+void TestQgsFeature::attributes()
+{
+  QgsFeature f;
+  f.addAttribute( 0, QVariant( 5 ) );
+  f.addAttribute( 3, QVariant( "abc" ) );
+  f.addAttribute( 2, QVariant( QVariant::Int ) );
+
+  QCOMPARE( f.attributes().size(), 4 );
+  QCOMPARE( f.attribute( 0 ), QVariant( 5 ) );
+  QCOMPARE( f.attribute( 3 ), QVariant( "abc" ) );
+  QVERIFY( f.hasAttribute( 2 ) );
+  QVERIFY( f.attribute( 2 ).isNull() );
+
+  // not set
+  QVERIFY( !f.hasAttribute( 1 ) );
+  QVERIFY( !f.hasAttribute( 4 ) );
+  QVERIFY( !f.hasAttribute( -1 ) );
+  QVERIFY( !f.attribute( 1 ).isValid() );
+  QVERIFY( !f.attribute( 10 ).isValid() );
+
+  f.changeAttribute( 0, QVariant( 6 ) );
+  QCOMPARE( f.attribute( 0 ), QVariant( 6 ) );
+  f.deleteAttribute( 3 );
+  QVERIFY( !f.hasAttribute( 3 ) );
+  QVERIFY( !f.attribute( 3 ).isValid() );
+}
+
+void TestQgsFeature::attributeMap()
+{
+  QgsFeature f;
+  f.addAttribute( 4, QVariant( 1.5 ) );
+  f.addAttribute( 1, QVariant( "x" ) );
+
+  QgsAttributeMap map;
+  map[1] = QVariant( "x" );
+  map[4] = QVariant( 1.5 );
+  QCOMPARE( f.attributeMap(), map );
+
+  map[7] = QVariant();
+  f.setAttributeMap( map );
+  QCOMPARE( f.attributeMap(), map );
+  QVERIFY( f.hasAttribute( 7 ) );
+  QVERIFY( !f.hasAttribute( 6 ) );
+  QCOMPARE( f.attribute( 4 ), QVariant( 1.5 ) );
+}
+
+void TestQgsFeature::mapKeptUpToDate()
+{
+  QgsFeature f;
+  f.addAttribute( 0, QVariant( 1 ) );
+
+  // a reference to the map sees later changes
+  const QgsAttributeMap& map = f.attributeMap();
+  f.addAttribute( 2, QVariant( 3 ) );
+  f.deleteAttribute( 0 );
+  QCOMPARE( map.count(), 1 );
+  QCOMPARE( map.value( 2 ), QVariant( 3 ) );
+}
+
+void TestQgsFeature::initAttributes()
+{
+  QgsFeature f;
+  f.addAttribute( 1, QVariant( 1 ) );
+  f.initAttributes( 3 );
+  QCOMPARE( f.attributes().size(), 3 );
+  QVERIFY( !f.hasAttribute( 1 ) );
+  QVERIFY( f.attributeMap().isEmpty() );
+
+  f.addAttribute( 2, QVariant( "a" ) );
+  QCOMPARE( f.attributeMap().count(), 1 );
+
+  // clearing keeps the storage size
+  f.clearAttributeMap();
+  QCOMPARE( f.attributes().size(), 3 );
+  QVERIFY( f.attributeMap().isEmpty() );
+}
+
+void TestQgsFeature::copies()
+{
+  QgsFeature f( 1 );
+  f.addAttribute( 0, QVariant( 1 ) );
+  f.addAttribute( 1, QVariant( 2 ) );
+
+  QgsFeature copy( f );
+  QgsFeature other;
+  other.copyAttributes( f );
+
+  // changing the copies does not change the original
+  copy.changeAttribute( 0, QVariant( 10 ) );
+  other.deleteAttribute( 1 );
+  QCOMPARE( f.attribute( 0 ), QVariant( 1 ) );
+  QVERIFY( f.hasAttribute( 1 ) );
+  QCOMPARE( copy.attribute( 0 ), QVariant( 10 ) );
+  QCOMPARE( other.attributeMap().count(), 1 );
+  QCOMPARE( f.attributeMap().count(), 2 );
+}
+
+QTEST_MAIN( TestQgsFeature )
+#include "moc_testqgsfeature.cxx"
@@ -41,6 +41,8 @@
 #include <qgsapplication.h>
 #include <qgsproviderregistry.h>
 #include <qgsmaplayerregistry.h>
+#include <qgsrendererv2.h>
+#include <qgssymbolv2.h>
 
 //qgs unit test utility class
 #include "qgsrenderchecker.h"
@@ -61,6 +63,8 @@ class TestQgsMapRenderer: public QObject
 
     /** This method tests render perfomance */
     void performanceTest();
+    /** Compares serial and parallel rendering of several layers */
+    void parallelRendering();
 
   private:
     QString mEncoding;
@@ -206,6 +210,72 @@ void TestQgsMapRenderer::performanceTest()
 }
 
 
+void TestQgsMapRenderer::parallelRendering()
+{
+  QString myTestDataDir = QString( TEST_DATA_DIR ) + QDir::separator();
+  QStringList myLayers;
+  QList<QgsVectorLayer*> myVectorLayers;
+  foreach( QString myName, QStringList() << "points" << "lines" << "polys" )
+  {
+    QgsVectorLayer* myLayer = new QgsVectorLayer( myTestDataDir + myName + ".shp", myName, "ogr" );
+    QVERIFY( myLayer->isValid() );
+    QgsMapLayerRegistry::instance()->addMapLayer( myLayer );
+    myLayers << myLayer->id();
+    myVectorLayers << myLayer;
+  }
+  //semi-transparent symbols make antialiased edges and overlaps blend with the layers below
+  foreach( QgsVectorLayer* myLayer, myVectorLayers )
+  {
+    QVERIFY( myLayer->isUsingRendererV2() && myLayer->rendererV2() );
+    foreach( QgsSymbolV2* mySymbol, myLayer->rendererV2()->symbols() )
+    {
+      mySymbol->setAlpha( 0.6 );
+    }
+  }
+
+  QgsMapRenderer myRenderer;
+  myRenderer.setLayerSet( myLayers );
+  QgsRectangle myExtent = myVectorLayers[0]->extent();
+  for ( int i = 1; i < myVectorLayers.size(); ++i )
+  {
+    QgsRectangle myLayerExtent = myVectorLayers[i]->extent();
+    myExtent.combineExtentWith( &myLayerExtent );
+  }
+  myRenderer.setOutputSize( QSize( 400, 300 ), 96 );
+  myRenderer.setExtent( myExtent );
+
+  QImage myImages[2];
+  for ( int i = 0; i < 2; ++i )
+  {
+    myRenderer.setParallelRenderingEnabled( i == 1 );
+    myImages[i] = QImage( 400, 300, QImage::Format_ARGB32_Premultiplied );
+    myImages[i].fill( qRgb( 255, 255, 255 ) );
+    QPainter myPainter( &myImages[i] );
+    myPainter.setRenderHint( QPainter::Antialiasing );
+    myRenderer.render( &myPainter );
+    myPainter.end();
+  }
+
+  //the recorded layers are replayed in stacking order, which gives the same pixels
+  int myDifferentPixels = 0;
+  for ( int y = 0; y < 300; ++y )
+  {
+    for ( int x = 0; x < 400; ++x )
+    {
+      if ( myImages[0].pixel( x, y ) != myImages[1].pixel( x, y ) )
+        myDifferentPixels++;
+    }
+  }
+  mReport += QString( "<p>Parallel rendering: %1 pixels differ from serial rendering</p>\n" ).arg( myDifferentPixels );
+  QCOMPARE( myDifferentPixels, 0 );
+  QVERIFY( myImages[1] == myImages[0] );
+
+  foreach( QString myLayerId, myLayers )
+  {
+    QgsMapLayerRegistry::instance()->removeMapLayer( myLayerId );
+  }
+}
+
 QTEST_MAIN( TestQgsMapRenderer )
 #include "moc_testqgsmaprenderer.cxx"
 
@@ -0,0 +1,165 @@
+/***************************************************************************
+     testqgsosmimport.cpp
+     --------------------------------------
+    Date                 : March 2012
+    Copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QString>
+#include <QDir>
+#include <QFile>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgsproviderregistry.h>
+#include <qgsvectordataprovider.h>
+#include <qgsvectorlayer.h>
+
+/** \ingroup UnitTests
+ * Imports the sample OSM file with the osm provider and checks what was stored.
+ * The sample has a 20 x 20 grid of nodes, 20 streets along the grid rows,
+ * 100 buildings on grid cells and 50 standalone benches. One way references
+ * a node missing in the file and another one has a single node, both have
+ * to be dropped.
+ */
+class TestQgsOSMImport: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void featureCounts();
+    void selectRectangle();
+    void wayGeometries();
+    void benchmarkImport();
+  private:
+    /** removes the database of the copied sample so that the next layer imports it again */
+    void removeDatabase();
+    /** number of features of the provider within the rectangle */
+    int countFeatures( QgsVectorDataProvider* provider, const QgsRectangle& rect );
+
+    QString mOsmFileName;
+};
+
+void TestQgsOSMImport::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  // Instantiate the plugin directory so that providers are loaded
+  QgsProviderRegistry::instance( QgsApplication::pluginPath() );
+
+  // the database is created next to the OSM file -> work on a copy
+  mOsmFileName = QDir::tempPath() + QDir::separator() + "qgis_test_osm_sample.osm";
+  QFile::remove( mOsmFileName );
+  QVERIFY( QFile::copy( QString( TEST_DATA_DIR ) + QDir::separator() + "osm_sample.osm", mOsmFileName ) );
+  removeDatabase();
+}
+
+void TestQgsOSMImport::cleanupTestCase()
+{
+  removeDatabase();
+  QFile::remove( mOsmFileName );
+}
+
+void TestQgsOSMImport::removeDatabase()
+{
+  QFile::remove( mOsmFileName + ".db" );
+  QFile::remove( mOsmFileName + ".db-journal" );
+}
+
+int TestQgsOSMImport::countFeatures( QgsVectorDataProvider* provider, const QgsRectangle& rect )
+{
+  provider->select( QgsAttributeList(), rect, true, false );
+  int count = 0;
+  QgsFeature f;
+  while ( provider->nextFeature( f ) )
+    count++;
+  return count;
+}
+
+void TestQgsOSMImport::featureCounts()
+{
+  removeDatabase();
+
+  // polygon layer is the one that imports the file
+  QgsVectorLayer polygons( mOsmFileName + "?type=polygon", "polygons", "osm" );
+  QVERIFY( polygons.isValid() );
+  QCOMPARE(( int ) polygons.dataProvider()->featureCount(), 100 );
+
+  QgsVectorLayer lines( mOsmFileName + "?type=line", "lines", "osm" );
+  QVERIFY( lines.isValid() );
+  QCOMPARE(( int ) lines.dataProvider()->featureCount(), 20 );
+
+  QgsVectorLayer points( mOsmFileName + "?type=point", "points", "osm" );
+  QVERIFY( points.isValid() );
+  QCOMPARE(( int ) points.dataProvider()->featureCount(), 50 );
+
+  QCOMPARE( countFeatures( polygons.dataProvider(), QgsRectangle() ), 100 );
+  QCOMPARE( countFeatures( lines.dataProvider(), QgsRectangle() ), 20 );
+  QCOMPARE( countFeatures( points.dataProvider(), QgsRectangle() ), 50 );
+}
+
+void TestQgsOSMImport::selectRectangle()
+{
+  QgsVectorLayer polygons( mOsmFileName + "?type=polygon", "polygons", "osm" );
+  QgsVectorLayer lines( mOsmFileName + "?type=line", "lines", "osm" );
+  QgsVectorLayer points( mOsmFileName + "?type=point", "points", "osm" );
+  QVERIFY( polygons.isValid() && lines.isValid() && points.isValid() );
+
+  // benches in the two columns at 14.021 and 14.022
+  QCOMPARE( countFeatures( points.dataProvider(), QgsRectangle( 14.0205, 49.99, 14.0225, 50.03 ) ), 20 );
+
+  // streets of rows 0 to 4 cross the rectangle
+  QgsRectangle rect( 14.0025, 49.9995, 14.0045, 50.0045 );
+  QCOMPARE( countFeatures( lines.dataProvider(), rect ), 5 );
+  // buildings on cells 2 and 4 of rows 0, 2 and 4 touch it
+  QCOMPARE( countFeatures( polygons.dataProvider(), rect ), 6 );
+
+  // nothing out there
+  QCOMPARE( countFeatures( points.dataProvider(), QgsRectangle( 15, 51, 16, 52 ) ), 0 );
+  QCOMPARE( countFeatures( lines.dataProvider(), QgsRectangle( 15, 51, 16, 52 ) ), 0 );
+}
+
+void TestQgsOSMImport::wayGeometries()
+{
+  QgsVectorLayer lines( mOsmFileName + "?type=line", "lines", "osm" );
+  QVERIFY( lines.isValid() );
+
+  QgsFeature f;
+  QVERIFY( lines.dataProvider()->featureAtId( 1003, f, true, QgsAttributeList() ) );
+  QVERIFY( f.geometry() );
+  QgsPolyline line = f.geometry()->asPolyline();
+  QCOMPARE( line.count(), 20 );
+  QCOMPARE( line.first(), QgsPoint( 14.0, 50.002 ) );
+  QCOMPARE( line.last(), QgsPoint( 14.019, 50.002 ) );
+
+  QgsVectorLayer polygons( mOsmFileName + "?type=polygon", "polygons", "osm" );
+  QVERIFY( polygons.isValid() );
+  QVERIFY( polygons.dataProvider()->featureAtId( 2001, f, true, QgsAttributeList() ) );
+  QVERIFY( f.geometry() );
+  QgsPolygon polygon = f.geometry()->asPolygon();
+  QCOMPARE( polygon.count(), 1 );
+  QCOMPARE( polygon[0].count(), 5 );
+  QCOMPARE( polygon[0].first(), polygon[0].last() );
+}
+
+void TestQgsOSMImport::benchmarkImport()
+{
+  QBENCHMARK
+  {
+    removeDatabase();
+    QgsVectorLayer polygons( mOsmFileName + "?type=polygon", "polygons", "osm" );
+    QVERIFY( polygons.isValid() );
+  }
+}
+
+QTEST_MAIN( TestQgsOSMImport )
+#include "moc_testqgsosmimport.cxx"
@@ -0,0 +1,295 @@
+/***************************************************************************
+     testqgspallabeling.cpp
+     --------------------------------------
+    Date                 : March 2012
+    Copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QImage>
+#include <QPainter>
+
+#include <qgsapplication.h>
+#include <qgsgeometry.h>
+#include <qgsmaplayerregistry.h>
+#include <qgsmaprenderer.h>
+#include <qgsproviderregistry.h>
+#include <qgsvectordataprovider.h>
+#include <qgsvectorlayer.h>
+
+//header for class being tested
+#include <qgspallabeling.h>
+
+/** \ingroup UnitTests
+ * Labels dense point and line layers with QgsPalLabeling and compares
+ * the placed labels of different runs and of cached labelings.
+ */
+class TestQgsPalLabeling: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void parallelLabeling();
+    void labelCache();
+  private:
+    /** creates a map renderer for the test layers with a new labeling engine */
+    QgsMapRenderer* createRenderer( bool parallelLabeling, QgsPalLabeling::Search search );
+    /** renders the extent and returns the placed labels, sorted */
+    QStringList renderLabels( QgsMapRenderer* renderer, const QgsRectangle& extent );
+    /** writes the label settings of the test layers */
+    void setLabelSettings( double pointFontSize, double pointDistance );
+
+    static const int mPointCount = 1500;
+    static const int mLineCount = 200;
+    QgsVectorLayer* mPointsLayer;
+    QgsVectorLayer* mLinesLayer;
+};
+
+void TestQgsPalLabeling::initTestCase()
+{
+  QgsApplication::setPrefixPath( INSTALL_PREFIX, true );
+  QgsProviderRegistry::instance( QgsApplication::pluginPath() );
+
+  // random points and short lines in a 100 x 100 square
+  qsrand( 42 );
+  mPointsLayer = new QgsVectorLayer( "Point?field=name:string", "points", "memory" );
+  QVERIFY( mPointsLayer->isValid() );
+  QgsFeatureList points;
+  for ( int i = 0; i < mPointCount; ++i )
+  {
+    QgsFeature f;
+    f.setGeometry( QgsGeometry::fromPoint( QgsPoint( 100.0 * qrand() / RAND_MAX, 100.0 * qrand() / RAND_MAX ) ) );
+    f.addAttribute( 0, QString( "P%1" ).arg( i ) );
+    points << f;
+  }
+  QVERIFY( mPointsLayer->dataProvider()->addFeatures( points ) );
+
+  mLinesLayer = new QgsVectorLayer( "LineString?field=name:string", "lines", "memory" );
+  QVERIFY( mLinesLayer->isValid() );
+  QgsFeatureList lines;
+  for ( int i = 0; i < mLineCount; ++i )
+  {
+    QgsPolyline line;
+    QgsPoint p( 100.0 * qrand() / RAND_MAX, 100.0 * qrand() / RAND_MAX );
+    for ( int j = 0; j < 4; ++j )
+    {
+      line << p;
+      p = QgsPoint( p.x() + 8.0 * qrand() / RAND_MAX - 2, p.y() + 8.0 * qrand() / RAND_MAX - 4 );
+    }
+    QgsFeature f;
+    f.setGeometry( QgsGeometry::fromPolyline( line ) );
+    f.addAttribute( 0, QString( "Line %1" ).arg( i ) );
+    lines << f;
+  }
+  QVERIFY( mLinesLayer->dataProvider()->addFeatures( lines ) );
+
+  QgsMapLayerRegistry::instance()->addMapLayer( mPointsLayer );
+  QgsMapLayerRegistry::instance()->addMapLayer( mLinesLayer );
+  setLabelSettings( 8, 1 );
+}
+
+void TestQgsPalLabeling::cleanupTestCase()
+{
+  QgsMapLayerRegistry::instance()->removeMapLayer( mPointsLayer->id() );
+  QgsMapLayerRegistry::instance()->removeMapLayer( mLinesLayer->id() );
+}
+
+void TestQgsPalLabeling::setLabelSettings( double pointFontSize, double pointDistance )
+{
+  QgsPalLayerSettings pointSettings;
+  pointSettings.enabled = true;
+  pointSettings.fieldName = "name";
+  pointSettings.placement = QgsPalLayerSettings::AroundPoint;
+  pointSettings.textFont.setPointSizeF( pointFontSize );
+  pointSettings.dist = pointDistance;
+  pointSettings.writeToLayer( mPointsLayer );
+
+  QgsPalLayerSettings lineSettings;
+  lineSettings.enabled = true;
+  lineSettings.fieldName = "name";
+  lineSettings.placement = QgsPalLayerSettings::Line;
+  lineSettings.placementFlags = QgsPalLayerSettings::AboveLine | QgsPalLayerSettings::BelowLine;
+  lineSettings.textFont.setPointSizeF( 8 );
+  lineSettings.writeToLayer( mLinesLayer );
+}
+
+QgsMapRenderer* TestQgsPalLabeling::createRenderer( bool parallelLabeling, QgsPalLabeling::Search search )
+{
+  QgsPalLabeling* labeling = new QgsPalLabeling();
+  labeling->setParallelLabelingEnabled( parallelLabeling );
+  labeling->setSearchMethod( search );
+
+  QgsMapRenderer* renderer = new QgsMapRenderer();
+  renderer->setLabelingEngine( labeling );
+  renderer->setLayerSet( QStringList() << mPointsLayer->id() << mLinesLayer->id() );
+  renderer->setOutputSize( QSize( 800, 600 ), 96 );
+  return renderer;
+}
+
+QStringList TestQgsPalLabeling::renderLabels( QgsMapRenderer* renderer, const QgsRectangle& extent )
+{
+  renderer->setExtent( extent );
+  QImage image( 800, 600, QImage::Format_ARGB32_Premultiplied );
+  image.fill( qRgb( 255, 255, 255 ) );
+  QPainter painter( &image );
+  renderer->render( &painter );
+  painter.end();
+
+  // labels may stick out of the map extent
+  QgsRectangle searchRect = renderer->extent();
+  searchRect.scale( 2.0 );
+  QStringList labels;
+  QgsPalLabeling* labeling = dynamic_cast<QgsPalLabeling*>( renderer->labelingEngine() );
+  foreach( const QgsLabelPosition& pos, labeling->labelsWithinRect( searchRect ) )
+  {
+    labels << QString( "%1 %2: %3 %4 %5" ).arg( pos.layerID ).arg( pos.featureId )
+    .arg( pos.labelRect.xMinimum(), 0, 'g', 17 ).arg( pos.labelRect.yMinimum(), 0, 'g', 17 ).arg( pos.rotation, 0, 'g', 17 );
+  }
+  labels.sort();
+  return labels;
+}
+
+void TestQgsPalLabeling::parallelLabeling()
+{
+  QgsRectangle extent( 0, 0, 100, 100 );
+  QList<QgsPalLabeling::Search> searches;
+  searches << QgsPalLabeling::Chain << QgsPalLabeling::Popmusic_Tabu << QgsPalLabeling::Falp;
+  foreach( QgsPalLabeling::Search search, searches )
+  {
+    QgsMapRenderer* serialRenderer = createRenderer( false, search );
+    QStringList serial = renderLabels( serialRenderer, extent );
+    delete serialRenderer;
+
+    // the candidates are generated on several threads and the independent groups of labels are solved concurrently
+    QgsMapRenderer* parallelRenderer = createRenderer( true, search );
+    QStringList parallel = renderLabels( parallelRenderer, extent );
+    delete parallelRenderer;
+
+    // dense enough that not every feature gets a label
+    QVERIFY( serial.size() > 100 );
+    QVERIFY( serial.size() < mPointCount + mLineCount );
+    QCOMPARE( parallel, serial );
+
+    // the thread scheduling does not change the solution
+    parallelRenderer = createRenderer( true, search );
+    QCOMPARE( renderLabels( parallelRenderer, extent ), serial );
+    delete parallelRenderer;
+  }
+}
+
+void TestQgsPalLabeling::labelCache()
+{
+  // FALP places the labels of the last labeling first, so an unchanged map gets the same labels again
+  QgsMapRenderer* renderer = createRenderer( false, QgsPalLabeling::Falp );
+  QgsPalLabeling* labeling = dynamic_cast<QgsPalLabeling*>( renderer->labelingEngine() );
+  QgsRectangle extent( 0, 0, 100, 100 );
+  int sizeHits, candidateHits;
+
+  QStringList first = renderLabels( renderer, extent );
+  labeling->labelCacheStatistics( sizeHits, candidateHits );
+  QCOMPARE( sizeHits, 0 );
+  QCOMPARE( candidateHits, 0 );
+  QVERIFY( first.size() > 100 );
+
+  // unchanged settings and extent: every label size is reused, and the candidates of
+  // all features inside the map (at least all points)
+  QStringList second = renderLabels( renderer, extent );
+  labeling->labelCacheStatistics( sizeHits, candidateHits );
+  QCOMPARE( sizeHits, mPointCount + mLineCount );
+  QVERIFY( candidateHits >= mPointCount );
+  QVERIFY( candidateHits <= mPointCount + mLineCount );
+  QCOMPARE( second, first );
+
+  // other point label settings and another scale: the candidates and the point labels are dropped
+  setLabelSettings( 10, 2 );
+  QgsRectangle zoomedExtent( 10, 10, 60, 60 );
+  QStringList changed = renderLabels( renderer, zoomedExtent );
+  labeling->labelCacheStatistics( sizeHits, candidateHits );
+  QVERIFY( sizeHits <= mLineCount );
+  QCOMPARE( candidateHits, 0 );
+
+  // the rebuilt cache gives the labels of a labeling without cache
+  QgsMapRenderer* uncachedRenderer = createRenderer( false, QgsPalLabeling::Falp );
+  QStringList uncached = renderLabels( uncachedRenderer, zoomedExtent );
+  delete uncachedRenderer;
+  QVERIFY( !uncached.isEmpty() );
+  QVERIFY( uncached != first );
+  QCOMPARE( changed, uncached );
+
+  // and is used by the next labeling
+  QStringList again = renderLabels( renderer, zoomedExtent );
+  labeling->labelCacheStatistics( sizeHits, candidateHits );
+  QVERIFY( sizeHits > 0 );
+  QVERIFY( candidateHits > 0 );
+  QCOMPARE( again, changed );
+
+  // panning at the same scale: the candidates of the features inside both extents are reused,
+  // the features that come into view at the new edge get their size and candidates computed
+  QgsRectangle oldExtent = renderer->extent();
+  QStringList panned = renderLabels( renderer, QgsRectangle( 20, 10, 70, 60 ) );
+  labeling->labelCacheStatistics( sizeHits, candidateHits );
+  QgsRectangle newExtent = renderer->extent();
+  QCOMPARE( newExtent.width(), oldExtent.width() );
+
+  int pointsInBoth = 0;
+  QSet<QgsFeatureId> newPoints;
+  QgsFeature f;
+  QgsFeatureIterator pointIt = mPointsLayer->getFeatures();
+  while ( pointIt.nextFeature( f ) )
+  {
+    QgsPoint p = f.geometry()->asPoint();
+    if ( newExtent.contains( p ) && oldExtent.contains( p ) )
+      ++pointsInBoth;
+    else if ( newExtent.contains( p ) )
+      newPoints << f.id();
+  }
+  // lines within both extents are not clipped and may reuse their candidates,
+  // lines touching both extents may reuse their size
+  int linesInBoth = 0;
+  int linesTouchingBoth = 0;
+  QgsFeatureIterator lineIt = mLinesLayer->getFeatures();
+  while ( lineIt.nextFeature( f ) )
+  {
+    QgsRectangle bbox = f.geometry()->boundingBox();
+    if ( newExtent.contains( bbox ) && oldExtent.contains( bbox ) )
+      ++linesInBoth;
+    if ( newExtent.intersects( bbox ) && oldExtent.intersects( bbox ) )
+      ++linesTouchingBoth;
+  }
+  QVERIFY( pointsInBoth > 100 );
+  QVERIFY( newPoints.size() > 10 );
+  QVERIFY( candidateHits >= pointsInBoth );
+  QVERIFY( candidateHits <= pointsInBoth + linesInBoth );
+  QVERIFY( sizeHits >= pointsInBoth );
+  QVERIFY( sizeHits <= pointsInBoth + linesTouchingBoth );
+
+  // the points near the new edge are labeled
+  int newPointLabels = 0;
+  foreach( const QString& label, panned )
+  {
+    QStringList parts = label.split( " " );
+    if ( parts[0] == mPointsLayer->id() && newPoints.contains( parts[1].remove( ":" ).toLongLong() ) )
+      ++newPointLabels;
+  }
+  QVERIFY( newPointLabels > 0 );
+
+  // and the panned labeling is kept by the next one
+  QCOMPARE( renderLabels( renderer, QgsRectangle( 20, 10, 70, 60 ) ), panned );
+
+  delete renderer;
+  setLabelSettings( 8, 1 );
+}
+
+QTEST_MAIN( TestQgsPalLabeling )
+#include "moc_testqgspallabeling.cxx"
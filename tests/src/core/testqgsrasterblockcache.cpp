@@ -0,0 +1,124 @@
+/***************************************************************************
+     testqgsrasterblockcache.cpp
+     --------------------------------------
+    Date                 : March 2012
+    Copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QByteArray>
+
+//header for class being tested
+#include <qgsrasterblockcache.h>
+
+class TestQgsRasterBlockCache: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void init();// will be called before each testfunction is executed.
+    void hitsAndMisses();
+    void leastRecentlyUsed();
+    void removeDataset();
+    void tooLargeBlock();
+    void largeCache();
+};
+
+void TestQgsRasterBlockCache::init()
+{
+  QgsRasterBlockCache* cache = QgsRasterBlockCache::instance();
+  cache->setMaxSize( 4 * 1024 );
+  cache->clear();
+  cache->resetStatistics();
+}
+
+void TestQgsRasterBlockCache::hitsAndMisses()
+{
+  QgsRasterBlockCache* cache = QgsRasterBlockCache::instance();
+  QByteArray data;
+  QVERIFY( !cache->block( "a.tif", 1, 0, 2, 3, data ) );
+  cache->insertBlock( "a.tif", 1, 0, 2, 3, QByteArray( 256, 'x' ) );
+  QVERIFY( cache->block( "a.tif", 1, 0, 2, 3, data ) );
+  QCOMPARE( data, QByteArray( 256, 'x' ) );
+
+  // other band, level and position are different blocks
+  QVERIFY( !cache->block( "a.tif", 2, 0, 2, 3, data ) );
+  QVERIFY( !cache->block( "a.tif", 1, 1, 2, 3, data ) );
+  QVERIFY( !cache->block( "a.tif", 1, 0, 3, 2, data ) );
+
+  QCOMPARE( cache->hits(), 1 );
+  QCOMPARE( cache->misses(), 4 );
+  QCOMPARE( cache->size(), Q_INT64_C( 256 ) );
+}
+
+void TestQgsRasterBlockCache::leastRecentlyUsed()
+{
+  QgsRasterBlockCache* cache = QgsRasterBlockCache::instance();
+  for ( int i = 0; i < 4; ++i )
+  {
+    cache->insertBlock( "a.tif", 1, 0, i, 0, QByteArray( 1024, 'a' + i ) );
+  }
+  QCOMPARE( cache->size(), Q_INT64_C( 4 * 1024 ) );
+
+  // touch block 0, so block 1 is the least recently used one
+  QByteArray data;
+  QVERIFY( cache->block( "a.tif", 1, 0, 0, 0, data ) );
+  cache->insertBlock( "a.tif", 1, 0, 4, 0, QByteArray( 1024, 'e' ) );
+
+  QVERIFY( cache->block( "a.tif", 1, 0, 0, 0, data ) );
+  QVERIFY( !cache->block( "a.tif", 1, 0, 1, 0, data ) );
+  QVERIFY( cache->block( "a.tif", 1, 0, 4, 0, data ) );
+  QCOMPARE( data, QByteArray( 1024, 'e' ) );
+  QVERIFY( cache->size() <= cache->maxSize() );
+}
+
+void TestQgsRasterBlockCache::removeDataset()
+{
+  QgsRasterBlockCache* cache = QgsRasterBlockCache::instance();
+  cache->insertBlock( "a.tif", 1, 0, 0, 0, QByteArray( 16, 'a' ) );
+  cache->insertBlock( "a.tif.ovr", 1, 0, 0, 0, QByteArray( 16, 'b' ) );
+  cache->insertBlock( "b.tif", 1, 0, 0, 0, QByteArray( 16, 'c' ) );
+  cache->removeDataset( "a.tif" );
+
+  QByteArray data;
+  QVERIFY( !cache->block( "a.tif", 1, 0, 0, 0, data ) );
+  QVERIFY( cache->block( "a.tif.ovr", 1, 0, 0, 0, data ) );
+  QVERIFY( cache->block( "b.tif", 1, 0, 0, 0, data ) );
+}
+
+void TestQgsRasterBlockCache::tooLargeBlock()
+{
+  QgsRasterBlockCache* cache = QgsRasterBlockCache::instance();
+  cache->insertBlock( "a.tif", 1, 0, 0, 0, QByteArray( 8 * 1024, 'a' ) );
+  QByteArray data;
+  QVERIFY( !cache->block( "a.tif", 1, 0, 0, 0, data ) );
+  QCOMPARE( cache->size(), Q_INT64_C( 0 ) );
+}
+
+void TestQgsRasterBlockCache::largeCache()
+{
+  // more than the int costs of QCache can count in bytes
+  QgsRasterBlockCache* cache = QgsRasterBlockCache::instance();
+  qint64 maxSize = Q_INT64_C( 3 ) * 1024 * 1024 * 1024;
+  cache->setMaxSize( maxSize );
+  QCOMPARE( cache->maxSize(), maxSize );
+  cache->insertBlock( "a.tif", 1, 0, 0, 0, QByteArray( 1024, 'a' ) );
+  QByteArray data;
+  QVERIFY( cache->block( "a.tif", 1, 0, 0, 0, data ) );
+  QCOMPARE( data, QByteArray( 1024, 'a' ) );
+  QVERIFY( cache->size() >= 1024 );
+
+  // back to byte costs
+  cache->setMaxSize( 4 * 1024 );
+  QVERIFY( !cache->block( "a.tif", 1, 0, 0, 0, data ) );
+  QCOMPARE( cache->size(), Q_INT64_C( 0 ) );
+}
+
+QTEST_MAIN( TestQgsRasterBlockCache )
+#include "moc_testqgsrasterblockcache.cxx"
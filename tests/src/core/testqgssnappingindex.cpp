@@ -0,0 +1,241 @@
+/***************************************************************************
+     testqgssnappingindex.cpp
+     --------------------------------------
+    Date                 : March 2012
+    Copyright            : (C) 2012 by the Quantum GIS Project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QMap>
+
+#include <cmath>
+
+//qgis includes...
+#include <qgsgeometry.h>
+//header for class being tested
+#include <qgssnappingindex.h>
+
+class TestQgsSnappingIndex: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void snapToVertex();
+    void snapToSegment();
+    void polygonRingNeighbours();
+    void removeGeometry();
+    void benchmarkIndex();
+    void benchmarkGeometries();
+  private:
+    /** snap the way QgsVectorLayer::snapToGeometry does without an index */
+    void snapGeometries( const QgsPoint& p, double tolerance, QgsSnapper::SnappingType snap_to,
+                         QMultiMap<double, QgsSnappingResult>& results );
+
+    QMap<QgsFeatureId, QgsGeometry*> mGeometries;
+    QgsSnappingIndex* mIndex;
+};
+
+void TestQgsSnappingIndex::initTestCase()
+{
+  // 50 x 50 zigzag lines with 200 vertices each and a few polygons with holes
+  qsrand( 1 );
+  QgsFeatureId fid = 1;
+  for ( int row = 0; row < 50; ++row )
+  {
+    QgsPolyline line;
+    for ( int i = 0; i < 200; ++i )
+    {
+      line << QgsPoint( i * 0.5, row * 2 + ( double ) qrand() / RAND_MAX );
+    }
+    mGeometries.insert( fid++, QgsGeometry::fromPolyline( line ) );
+  }
+
+  for ( int i = 0; i < 10; ++i )
+  {
+    QgsPolyline outer, inner;
+    double x = i * 10, y = -20;
+    outer << QgsPoint( x, y ) << QgsPoint( x + 8, y ) << QgsPoint( x + 8, y + 8 ) << QgsPoint( x, y + 8 ) << QgsPoint( x, y );
+    inner << QgsPoint( x + 2, y + 2 ) << QgsPoint( x + 6, y + 2 ) << QgsPoint( x + 6, y + 6 ) << QgsPoint( x + 2, y + 2 );
+    QgsPolygon polygon;
+    polygon << outer << inner;
+    mGeometries.insert( fid++, QgsGeometry::fromPolygon( polygon ) );
+  }
+
+  mIndex = new QgsSnappingIndex();
+  QMap<QgsFeatureId, QgsGeometry*>::iterator it = mGeometries.begin();
+  for ( ; it != mGeometries.end(); ++it )
+  {
+    mIndex->addGeometry( it.key(), it.value() );
+  }
+}
+
+void TestQgsSnappingIndex::cleanupTestCase()
+{
+  delete mIndex;
+  qDeleteAll( mGeometries );
+}
+
+void TestQgsSnappingIndex::snapGeometries( const QgsPoint& p, double tolerance, QgsSnapper::SnappingType snap_to,
+    QMultiMap<double, QgsSnappingResult>& results )
+{
+  double sqrTolerance = tolerance * tolerance;
+  QMap<QgsFeatureId, QgsGeometry*>::iterator it = mGeometries.begin();
+  for ( ; it != mGeometries.end(); ++it )
+  {
+    QgsGeometry* g = it.value();
+    QgsSnappingResult r;
+    r.snappedAtGeometry = it.key();
+    r.layer = 0;
+
+    int atVertex, beforeVertex, afterVertex;
+    double sqrDist;
+    QgsPoint snapped;
+    if ( snap_to != QgsSnapper::SnapToSegment )
+    {
+      snapped = g->closestVertex( p, atVertex, beforeVertex, afterVertex, sqrDist );
+      if ( sqrDist < sqrTolerance )
+      {
+        r.snappedVertex = snapped;
+        r.snappedVertexNr = atVertex;
+        r.beforeVertexNr = beforeVertex;
+        r.afterVertexNr = afterVertex;
+        results.insert( sqrt( sqrDist ), r );
+        continue;
+      }
+    }
+    if ( snap_to != QgsSnapper::SnapToVertex )
+    {
+      sqrDist = g->closestSegmentWithContext( p, snapped, afterVertex );
+      if ( sqrDist < sqrTolerance )
+      {
+        r.snappedVertex = snapped;
+        r.snappedVertexNr = -1;
+        r.beforeVertexNr = afterVertex - 1;
+        r.afterVertexNr = afterVertex;
+        results.insert( sqrt( sqrDist ), r );
+      }
+    }
+  }
+}
+
+static bool sameResults( const QMultiMap<double, QgsSnappingResult>& r1, const QMultiMap<double, QgsSnappingResult>& r2 )
+{
+  if ( r1.size() != r2.size() )
+    return false;
+
+  // compare per feature, results with equal distance may come in any order
+  QMap<QgsFeatureId, QgsSnappingResult> m1, m2;
+  foreach( const QgsSnappingResult& r, r1.values() )
+    m1.insert( r.snappedAtGeometry, r );
+  foreach( const QgsSnappingResult& r, r2.values() )
+    m2.insert( r.snappedAtGeometry, r );
+
+  QMap<QgsFeatureId, QgsSnappingResult>::const_iterator it = m1.constBegin();
+  for ( ; it != m1.constEnd(); ++it )
+  {
+    if ( !m2.contains( it.key() ) )
+      return false;
+    const QgsSnappingResult& a = it.value();
+    const QgsSnappingResult& b = m2[ it.key()];
+    if ( a.snappedVertexNr != b.snappedVertexNr || a.beforeVertexNr != b.beforeVertexNr || a.afterVertexNr != b.afterVertexNr )
+      return false;
+    if ( a.snappedVertex.sqrDist( b.snappedVertex ) > 1e-18 )
+      return false;
+  }
+  return true;
+}
+
+void TestQgsSnappingIndex::snapToVertex()
+{
+  for ( int i = 0; i < 200; ++i )
+  {
+    QgsPoint p( i * 0.47, i * 0.49 );
+    QMultiMap<double, QgsSnappingResult> indexResults, geometryResults;
+    mIndex->snap( p, 0.8, indexResults, QgsSnapper::SnapToVertex );
+    snapGeometries( p, 0.8, QgsSnapper::SnapToVertex, geometryResults );
+    QVERIFY( sameResults( indexResults, geometryResults ) );
+  }
+}
+
+void TestQgsSnappingIndex::snapToSegment()
+{
+  for ( int i = 0; i < 200; ++i )
+  {
+    QgsPoint p( i * 0.47, i * 0.49 - 20 );
+    QMultiMap<double, QgsSnappingResult> indexResults, geometryResults;
+    mIndex->snap( p, 0.5, indexResults, QgsSnapper::SnapToVertexAndSegment );
+    snapGeometries( p, 0.5, QgsSnapper::SnapToVertexAndSegment, geometryResults );
+    QVERIFY( sameResults( indexResults, geometryResults ) );
+
+    indexResults.clear();
+    geometryResults.clear();
+    mIndex->snap( p, 0.5, indexResults, QgsSnapper::SnapToSegment );
+    snapGeometries( p, 0.5, QgsSnapper::SnapToSegment, geometryResults );
+    QVERIFY( sameResults( indexResults, geometryResults ) );
+  }
+}
+
+void TestQgsSnappingIndex::polygonRingNeighbours()
+{
+  // first vertex of the inner ring of the first polygon
+  QMultiMap<double, QgsSnappingResult> results;
+  mIndex->snap( QgsPoint( 2.01, -17.99 ), 0.1, results, QgsSnapper::SnapToVertex );
+  QCOMPARE( results.size(), 1 );
+  QgsSnappingResult r = results.begin().value();
+  QCOMPARE( r.snappedVertexNr, 5 );
+  QCOMPARE( r.beforeVertexNr, 7 );
+  QCOMPARE( r.afterVertexNr, 6 );
+  QCOMPARE( r.beforeVertex, QgsPoint( 6, -14 ) );
+}
+
+void TestQgsSnappingIndex::removeGeometry()
+{
+  QgsSnappingIndex index;
+  QgsPolyline line;
+  line << QgsPoint( 0, 0 ) << QgsPoint( 10, 0 );
+  QgsGeometry* g = QgsGeometry::fromPolyline( line );
+  index.addGeometry( 1, g );
+  index.addGeometry( 1, g );
+  QCOMPARE( index.featureCount(), 1 );
+
+  QMultiMap<double, QgsSnappingResult> results;
+  QCOMPARE( index.snap( QgsPoint( 5, 0.1 ), 0.5, results, QgsSnapper::SnapToSegment ), 1 );
+  QCOMPARE( results.size(), 1 );
+
+  index.removeGeometry( 1 );
+  results.clear();
+  QCOMPARE( index.snap( QgsPoint( 5, 0.1 ), 0.5, results, QgsSnapper::SnapToSegment ), 0 );
+  QVERIFY( results.isEmpty() );
+  delete g;
+}
+
+void TestQgsSnappingIndex::benchmarkIndex()
+{
+  QMultiMap<double, QgsSnappingResult> results;
+  QBENCHMARK
+  {
+    results.clear();
+    mIndex->snap( QgsPoint( 50, 50 ), 0.5, results, QgsSnapper::SnapToVertexAndSegment );
+  }
+}
+
+void TestQgsSnappingIndex::benchmarkGeometries()
+{
+  QMultiMap<double, QgsSnappingResult> results;
+  QBENCHMARK
+  {
+    results.clear();
+    snapGeometries( QgsPoint( 50, 50 ), 0.5, QgsSnapper::SnapToVertexAndSegment, results );
+  }
+}
+
+QTEST_MAIN( TestQgsSnappingIndex )
+#include "moc_testqgssnappingindex.cxx"
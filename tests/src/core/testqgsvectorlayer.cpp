@@ -28,6 +28,7 @@
 #include <qgsmaplayer.h>
 #include <qgsvectordataprovider.h>
 #include <qgsvectorlayer.h>
+#include <qgsgeometry.h>
 #include <qgsapplication.h>
 #include <qgsproviderregistry.h>
 #include <qgsmaplayerregistry.h>
@@ -158,6 +159,130 @@ class TestQgsVectorLayer: public QObject
       QVERIFY( myCount == 3 );
     };
 
+    void QgsVectorLayerConcurrentIterators()
+    {
+      QgsVectorLayer * myLayer = mpNonSpatialLayer;
+      QgsFeatureRequest myRequest;
+      myRequest.setFlags( QgsFeatureRequest::NoGeometry );
+      QgsFeatureIterator myOuter = myLayer->getFeatures( myRequest );
+      QgsFeature f, g;
+      int myCount = 0;
+      while ( myOuter.nextFeature( f ) )
+      {
+        // an inner iterator (or the old select/nextFeature API) must not disturb the outer one
+        QgsFeatureIterator myInner = myLayer->getFeatures( myRequest );
+        int myInnerCount = 0;
+        while ( myInner.nextFeature( g ) )
+          myInnerCount++;
+        QVERIFY( myInnerCount == 3 );
+
+        myLayer->select( QgsAttributeList(), QgsRectangle(), false );
+        QVERIFY( myLayer->nextFeature( g ) );
+
+        myCount++;
+      }
+      QVERIFY( myCount == 3 );
+
+      QVERIFY( myOuter.rewind() );
+      QVERIFY( myOuter.nextFeature( f ) );
+      myOuter.close();
+      QVERIFY( myOuter.isClosed() );
+      QVERIFY( !myOuter.nextFeature( f ) );
+    };
+
+    void QgsVectorLayerBulkEditCommit()
+    {
+      // add, edit and commit many features through the edit buffer
+      const int myCount = 20000;
+      QBENCHMARK
+      {
+        QgsVectorLayer myLayer( "Point?field=value:integer", "bulk", "memory" );
+        QVERIFY( myLayer.isValid() );
+        QVERIFY( myLayer.startEditing() );
+
+        QList<QgsFeatureId> myIds;
+        for ( int i = 0; i < myCount; ++i )
+        {
+          QgsFeature f;
+          f.setGeometry( QgsGeometry::fromPoint( QgsPoint( i, i ) ) );
+          f.addAttribute( 0, i );
+          QVERIFY( myLayer.addFeature( f, false ) );
+          myIds << f.id();
+        }
+
+        for ( int i = 0; i < myCount; ++i )
+        {
+          QVERIFY( myLayer.changeAttributeValue( myIds[i], 0, QVariant( -i ) ) );
+          QgsGeometry* myGeom = QgsGeometry::fromPoint( QgsPoint( i, -i ) );
+          QVERIFY( myLayer.changeGeometry( myIds[i], myGeom ) );
+          delete myGeom;
+
+          QgsFeature f;
+          QVERIFY( myLayer.featureAtId( myIds[i], f, true, true ) );
+          QCOMPARE( f.attributeMap()[0].toInt(), -i );
+        }
+
+        QVERIFY( myLayer.commitChanges() );
+        QCOMPARE( myLayer.featureCount(), ( long ) myCount );
+
+        // features are committed in the order they were added
+        QgsFeature f;
+        myLayer.select( myLayer.pendingAllAttributesList(), QgsRectangle(), true );
+        QVERIFY( myLayer.nextFeature( f ) );
+        QCOMPARE( f.geometry()->asPoint(), QgsPoint( 0, 0 ) );
+        QVERIFY( myLayer.nextFeature( f ) );
+        QCOMPARE( f.geometry()->asPoint(), QgsPoint( 1, -1 ) );
+        QCOMPARE( f.attributeMap()[0].toInt(), -1 );
+      }
+    }
+
+    void QgsVectorLayerBatchedJoin()
+    {
+      // join the polygon values to the importance of the points without memory cache
+      QgsVectorJoinInfo myJoin;
+      myJoin.targetField = 2;
+      myJoin.joinLayerId = mpPolysLayer->id();
+      myJoin.joinField = 1;
+      myJoin.memoryCache = false;
+      mpPointsLayer->addJoin( myJoin );
+      mpPointsLayer->resetJoinStatistics();
+
+      QgsFeatureRequest myRequest;
+      myRequest.setFlags( QgsFeatureRequest::NoGeometry );
+      QgsFeatureIterator myIterator = mpPointsLayer->getFeatures( myRequest );
+      QgsFeature f;
+      for ( int i = 0; i < 2; ++i )
+      {
+        int myCount = 0;
+        while ( myIterator.nextFeature( f ) )
+        {
+          // the first polygon of a value is joined
+          double myImportance = f.attribute( 2 ).toDouble();
+          if ( myImportance == 10 )
+          {
+            QCOMPARE( f.attribute( 3 ).toString(), QString( "Lake" ) );
+          }
+          else if ( myImportance == 20 )
+          {
+            QCOMPARE( f.attribute( 3 ).toString(), QString( "Dam" ) );
+          }
+          else
+          {
+            QVERIFY( f.attribute( 3 ).isNull() );
+          }
+          myCount++;
+        }
+        QCOMPARE( myCount, 17 );
+        QVERIFY( myIterator.rewind() );
+      }
+
+      // one request for the whole block, the second pass only uses the join row cache
+      QCOMPARE( mpPointsLayer->joinFetchCount(), 1 );
+      QCOMPARE( mpPointsLayer->joinCacheHits(), 2 * 17 );
+
+      mpPointsLayer->removeJoin( mpPolysLayer->id() );
+    }
+
     void QgsVectorLayerstorageType()
     {
 